@@ -27,6 +27,7 @@ LOCAL_C_INCLUDES                                         := \
     $(LOCAL_PATH)/src                                       \
     $(LOCAL_PATH)/src/util                                  \
     $(LOCAL_PATH)/src/ipc-dbus                              \
+    $(LOCAL_PATH)/src/ipc-unix                              \
 	$(LOCAL_PATH)/src/wpantund \
 	$(LOCAL_PATH)/third_party/boost/ \
 	$(LOCAL_PATH)/third_party/fgetln \
@@ -84,6 +85,9 @@ LOCAL_SRC_FILES := \
 	src/ipc-dbus/DBusIPCAPI_v1.h \
 	src/ipc-dbus/wpan-dbus-v1.h \
 	src/ipc-dbus/wpan-dbus-v0.h \
+	src/ipc-unix/UnixIPCServer.cpp \
+	src/ipc-unix/UnixIPCServer.h \
+	src/ipc-unix/wpan-ipc-unix.h \
 	src/util/DBUSHelpers.cpp \
     src/version.c \
     src/wpantund/wpantund.cpp \
@@ -103,6 +107,8 @@ LOCAL_SRC_FILES := \
 	src/wpantund/FirmwareUpgrade.cpp \
 	src/wpantund/StatCollector.h \
 	src/wpantund/StatCollector.cpp \
+	src/wpantund/CounterSampler.h \
+	src/wpantund/CounterSampler.cpp \
 	src/wpantund/RunawayResetBackoffManager.cpp \
 	src/wpantund/RunawayResetBackoffManager.h \
 	src/wpantund/NCPInstanceBase-NetInterface.cpp \
@@ -114,6 +120,10 @@ LOCAL_SRC_FILES := \
 	src/wpantund/NetworkRetain.cpp \
 	src/wpantund/Pcap.h \
 	src/wpantund/Pcap.cpp \
+	src/wpantund/FrameCapture.h \
+	src/wpantund/FrameCapture.cpp \
+	src/wpantund/MainLoopProfiler.h \
+	src/wpantund/MainLoopProfiler.cpp \
 	src/wpantund/wpan-error.c \
 	src/util/IPv6PacketMatcher.cpp \
 	src/util/IPv6Helpers.cpp \
@@ -121,7 +131,11 @@ LOCAL_SRC_FILES := \
 	src/util/netif-mgmt.c \
 	src/util/config-file.c \
 	src/util/socket-utils.c \
+	src/util/serial-baud.c \
+	src/util/shm-frame-link.c \
+	src/util/io-uring.c \
 	src/util/any-to.cpp \
+	src/util/ValueType.cpp \
 	src/util/string-utils.c \
 	src/util/time-utils.c \
 	src/util/nlpt-select.c \
@@ -130,6 +144,7 @@ LOCAL_SRC_FILES := \
 	src/util/SocketAdapter.cpp \
 	src/util/UnixSocket.cpp \
 	src/util/SuperSocket.cpp \
+	src/util/SharedMemorySocket.cpp \
 	src/util/EventHandler.cpp \
 	src/util/TunnelIPv6Interface.cpp \
 	src/util/ValueMap.cpp \
@@ -137,10 +152,27 @@ LOCAL_SRC_FILES := \
 	src/util/sec-random.c \
 	src/ncp-spinel/SpinelNCPControlInterface.cpp \
 	src/ncp-spinel/SpinelNCPControlInterface.h \
+	src/ncp-spinel/SpinelNCPDataPlane.cpp \
+	src/ncp-spinel/SpinelNCPDataPlane-IOURing.cpp \
+	src/ncp-spinel/SpinelNCPDataPlane.h \
+	src/ncp-spinel/SpinelNCPFramePool.cpp \
+	src/ncp-spinel/SpinelNCPFramePool.h \
+	src/ncp-spinel/SpinelNCPFrameTrace.cpp \
+	src/ncp-spinel/SpinelNCPFrameTrace.h \
+	src/ncp-spinel/SpinelNCPFlowControl.cpp \
+	src/ncp-spinel/SpinelNCPFlowControl.h \
+	src/ncp-spinel/SpinelNCPEgressScheduler.cpp \
+	src/ncp-spinel/SpinelNCPEgressScheduler.h \
+	src/ncp-spinel/SpinelNCPHDLC.cpp \
+	src/ncp-spinel/SpinelNCPHDLC.h \
 	src/ncp-spinel/SpinelNCPInstance.cpp \
 	src/ncp-spinel/SpinelNCPInstance.h \
 	src/ncp-spinel/SpinelNCPInstance-DataPump.cpp \
 	src/ncp-spinel/SpinelNCPInstance-Protothreads.cpp \
+	src/ncp-spinel/SpinelNCPLink.cpp \
+	src/ncp-spinel/SpinelNCPLink.h \
+	src/ncp-spinel/SpinelNCPScanPlanner.cpp \
+	src/ncp-spinel/SpinelNCPScanPlanner.h \
 	src/ncp-spinel/SpinelNCPTask.cpp \
 	src/ncp-spinel/SpinelNCPTask.h \
 	src/ncp-spinel/SpinelNCPTaskDeepSleep.cpp \
@@ -155,10 +187,14 @@ LOCAL_SRC_FILES := \
 	src/ncp-spinel/SpinelNCPTaskForm.h \
 	src/ncp-spinel/SpinelNCPTaskJoin.cpp \
 	src/ncp-spinel/SpinelNCPTaskJoin.h \
+	src/ncp-spinel/SpinelNCPTaskJoinerAddBulk.cpp \
+	src/ncp-spinel/SpinelNCPTaskJoinerAddBulk.h \
 	src/ncp-spinel/SpinelNCPTaskLeave.cpp \
 	src/ncp-spinel/SpinelNCPTaskLeave.h \
 	src/ncp-spinel/SpinelNCPTaskPeek.cpp \
 	src/ncp-spinel/SpinelNCPTaskPeek.h \
+	src/ncp-spinel/SpinelNCPTaskSampleCounters.cpp \
+	src/ncp-spinel/SpinelNCPTaskSampleCounters.h \
 	src/ncp-spinel/SpinelNCPTaskScan.cpp \
 	src/ncp-spinel/SpinelNCPTaskScan.h \
 	src/ncp-spinel/SpinelNCPTaskSendCommand.cpp \
@@ -167,6 +203,10 @@ LOCAL_SRC_FILES := \
 	src/ncp-spinel/SpinelNCPTaskWake.h \
 	src/ncp-spinel/SpinelNCPThreadDataset.h \
 	src/ncp-spinel/SpinelNCPThreadDataset.cpp \
+	src/ncp-spinel/SpinelNCPTmfProxySocket.cpp \
+	src/ncp-spinel/SpinelNCPTmfProxySocket.h \
+	src/ncp-spinel/SpinelNCPTopologyCache.cpp \
+	src/ncp-spinel/SpinelNCPTopologyCache.h \
 	src/ncp-spinel/SpinelNCPVendorCustom.h \
 	src/ncp-spinel/SpinelNCPVendorCustom.cpp \
 	third_party/openthread/src/ncp/spinel.c \
@@ -186,6 +226,7 @@ LOCAL_MODULE_TAGS := eng
 LOCAL_C_INCLUDES := \
 	$(LOCAL_PATH)/src \
 	$(LOCAL_PATH)/src/ipc-dbus \
+	$(LOCAL_PATH)/src/ipc-unix \
 	$(LOCAL_PATH)/src/util \
 	$(LOCAL_PATH)/src/wpantund \
 	$(LOCAL_PATH)/third_party/fgetln \
@@ -234,6 +275,7 @@ LOCAL_SRC_FILES := \
 	src/util/string-utils.c \
 	src/wpantund/wpan-error.c \
 	src/wpanctl/wpanctl-utils.c \
+	src/ipc-unix/wpan-ipc-client.c \
 	src/wpanctl/tool-cmd-scan.c \
 	src/wpanctl/tool-cmd-join.c \
 	src/wpanctl/tool-cmd-form.c \
@@ -28,6 +28,7 @@
 #include <ctype.h>
 
 #include <algorithm>
+#include <stdexcept>
 
 #include <boost/bind.hpp>
 
@@ -81,6 +82,7 @@ DBusIPCAPI_v1::init_callback_tables()
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_ROUTE_REMOVE, interface_route_remove_handler);
 
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_JOINER_ADD, interface_joiner_add_handler);
+	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_JOINER_ADD_BULK, interface_joiner_add_bulk_handler);
 
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_DATA_POLL, interface_data_poll_handler);
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_CONFIG_GATEWAY, interface_config_gateway_handler);
@@ -97,6 +99,7 @@ DBusIPCAPI_v1::init_callback_tables()
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_MFG, interface_mfg_handler);
 
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_PROP_GET, interface_prop_get_handler);
+	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_PROP_GET_MULTI, interface_prop_get_multi_handler);
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_PROP_SET, interface_prop_set_handler);
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_PROP_INSERT, interface_prop_insert_handler);
 	INTERFACE_CALLBACK_CONNECT(WPANTUND_IF_CMD_PROP_REMOVE, interface_prop_remove_handler);
@@ -563,6 +566,85 @@ DBusIPCAPI_v1::CallbackWithStatusArg1_Helper(
 	dbus_message_unref(reply);
 }
 
+void
+DBusIPCAPI_v1::prop_get_multi_helper(
+    int status, const boost::any& value, boost::shared_ptr<PropGetMultiContext> context, size_t index
+)
+{
+	context->mStatus[index] = status;
+	context->mValues[index] = value;
+
+	if (--context->mRemaining == 0) {
+		prop_get_multi_send_reply(*context);
+	}
+}
+
+void
+DBusIPCAPI_v1::prop_get_multi_send_reply(const PropGetMultiContext& context)
+{
+	DBusMessage *reply = dbus_message_new_method_return(context.mMessage);
+	DBusMessageIter iter;
+	DBusMessageIter dict_iter;
+	int status = kWPANTUNDStatus_Ok;
+	size_t i;
+
+	syslog(LOG_DEBUG, "Sending DBus response for \"%s\" (%d properties) to \"%s\"", dbus_message_get_member(context.mMessage), (int)context.mKeys.size(), dbus_message_get_sender(context.mMessage));
+
+	dbus_message_iter_init_append(reply, &iter);
+
+	dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &status);
+
+	// One `key => (status, value)` entry per requested key, in the
+	// order they were asked for.
+	dbus_message_iter_open_container(
+		&iter,
+		DBUS_TYPE_ARRAY,
+		DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_STRING_AS_STRING
+			DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+				DBUS_TYPE_INT32_AS_STRING
+				DBUS_TYPE_VARIANT_AS_STRING
+			DBUS_STRUCT_END_CHAR_AS_STRING
+		DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+		&dict_iter
+	);
+
+	for (i = 0; i < context.mKeys.size(); i++) {
+		DBusMessageIter entry_iter;
+		DBusMessageIter struct_iter;
+		DBusMessageIter value_iter;
+		const char* key = context.mKeys[i].c_str();
+		boost::any value = context.mValues[i];
+		int key_status = context.mStatus[i];
+
+		if (!key_status && value.empty()) {
+			key_status = kWPANTUNDStatus_PropertyEmpty;
+		}
+
+		if (value.empty()) {
+			value = std::string("<empty>");
+		}
+
+		dbus_message_iter_open_container(&dict_iter, DBUS_TYPE_DICT_ENTRY, NULL, &entry_iter);
+		dbus_message_iter_append_basic(&entry_iter, DBUS_TYPE_STRING, &key);
+
+		dbus_message_iter_open_container(&entry_iter, DBUS_TYPE_STRUCT, NULL, &struct_iter);
+		dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_INT32, &key_status);
+
+		dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_VARIANT, any_to_dbus_type_string(value).c_str(), &value_iter);
+		append_any_to_dbus_iter(&value_iter, value);
+		dbus_message_iter_close_container(&struct_iter, &value_iter);
+
+		dbus_message_iter_close_container(&entry_iter, &struct_iter);
+		dbus_message_iter_close_container(&dict_iter, &entry_iter);
+	}
+
+	dbus_message_iter_close_container(&iter, &dict_iter);
+
+	dbus_connection_send(mConnection, reply, NULL);
+	dbus_message_unref(context.mMessage);
+	dbus_message_unref(reply);
+}
 
 DBusHandlerResult
 DBusIPCAPI_v1::interface_reset_handler(
@@ -861,6 +943,70 @@ DBusIPCAPI_v1::interface_prop_get_handler(
 	return ret;
 }
 
+DBusHandlerResult
+DBusIPCAPI_v1::interface_prop_get_multi_handler(
+	NCPControlInterface* interface,
+	DBusMessage *        message
+) {
+	DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	boost::shared_ptr<PropGetMultiContext> context(new PropGetMultiContext);
+	char** property_keys = NULL;
+	int property_key_count = 0;
+	int i;
+
+	require(dbus_message_get_args(
+		message, NULL,
+		DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &property_keys, &property_key_count,
+		DBUS_TYPE_INVALID
+	), bail);
+
+	for (i = 0; i < property_key_count; i++) {
+		std::string property_key = property_keys[i];
+
+		if (interface->translate_deprecated_property(property_key)) {
+			syslog(LOG_WARNING, "PropGetMulti: Property \"%s\" is deprecated. Please use \"%s\" instead.", property_keys[i], property_key.c_str());
+		}
+
+		context->mKeys.push_back(property_key);
+	}
+
+	dbus_free_string_array(property_keys);
+
+	dbus_message_ref(message);
+
+	context->mMessage = message;
+	context->mStatus.resize(context->mKeys.size(), kWPANTUNDStatus_Ok);
+	context->mValues.resize(context->mKeys.size());
+	context->mRemaining = context->mKeys.size();
+
+	if (context->mKeys.empty()) {
+		prop_get_multi_send_reply(*context);
+
+	} else {
+		// Every get is started up front so that the NCP tasks behind
+		// them can be queued back to back, rather than waiting for a
+		// bus round trip in between each of them.
+		for (i = 0; i < (int)context->mKeys.size(); i++) {
+			interface->property_get_value(
+				context->mKeys[i],
+				boost::bind(
+					&DBusIPCAPI_v1::prop_get_multi_helper,
+					this,
+					_1,
+					_2,
+					context,
+					static_cast<size_t>(i)
+				)
+			);
+		}
+	}
+
+	ret = DBUS_HANDLER_RESULT_HANDLED;
+
+bail:
+	return ret;
+}
+
 DBusHandlerResult
 DBusIPCAPI_v1::interface_prop_set_handler(
 	NCPControlInterface* interface,
@@ -993,6 +1139,35 @@ bail:
 	return ret;
 }
 
+// Scan methods may be followed by an optional dictionary of extra
+// options (e.g. `Scan:Match:NetworkName`), which is merged into `options`.
+static void
+ipc_get_trailing_options(DBusMessage* message, int arg_count, ValueMap& options)
+{
+	DBusMessageIter iter;
+
+	if (!dbus_message_iter_init(message, &iter)) {
+		return;
+	}
+
+	while (arg_count-- > 0) {
+		if (!dbus_message_iter_next(&iter)) {
+			return;
+		}
+	}
+
+	if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_ARRAY) {
+		try {
+			ValueMap extra_options = value_map_from_dbus_iter(&iter);
+
+			options.insert(extra_options.begin(), extra_options.end());
+
+		} catch (std::invalid_argument& x) {
+			syslog(LOG_WARNING, "Ignoring malformed scan options: %s", x.what());
+		}
+	}
+}
+
 DBusHandlerResult
 DBusIPCAPI_v1::interface_net_scan_start_handler(
 	NCPControlInterface* interface,
@@ -1014,6 +1189,8 @@ DBusIPCAPI_v1::interface_net_scan_start_handler(
 		options[kWPANTUNDValueMapKey_Scan_ChannelMask] = channel_mask;
 	}
 
+	ipc_get_trailing_options(message, 1, options);
+
 	interface->netscan_start(
 		options,
 		boost::bind(
@@ -1061,6 +1238,8 @@ DBusIPCAPI_v1::interface_discover_scan_start_handler(
 	options[kWPANTUNDValueMapKey_Scan_EnableFiltering] = enable_filtering ? true : false;
 	options[kWPANTUNDValueMapKey_Scan_PANIDFilter] = pan_id_filter;
 
+	ipc_get_trailing_options(message, 4, options);
+
 	interface->netscan_start(
 		options,
 		boost::bind(
@@ -1509,6 +1688,42 @@ bail:
 	return ret;
 }
 
+DBusHandlerResult
+DBusIPCAPI_v1::interface_joiner_add_bulk_handler(
+   NCPControlInterface* interface,
+   DBusMessage *        message
+) {
+	DBusHandlerResult ret = DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	std::list<std::string> joiners;
+	char** entries = NULL;
+	int entry_count = 0;
+	uint32_t joiner_timeout = 0;
+
+	require(dbus_message_get_args(
+		message, NULL,
+		DBUS_TYPE_UINT32, &joiner_timeout,
+		DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &entries, &entry_count,
+		DBUS_TYPE_INVALID
+	), bail);
+
+	joiners.insert(joiners.end(), entries, entries + entry_count);
+
+	dbus_free_string_array(entries);
+
+	dbus_message_ref(message);
+	interface->joiner_add_bulk(
+		joiners,
+		joiner_timeout,
+		boost::bind(&DBusIPCAPI_v1::CallbackWithStatusArg1_Helper, this, _1, _2, message)
+	);
+
+	ret = DBUS_HANDLER_RESULT_HANDLED;
+
+bail:
+
+	return ret;
+}
+
 DBusHandlerResult
 DBusIPCAPI_v1::interface_peek_handler(
    NCPControlInterface* interface,
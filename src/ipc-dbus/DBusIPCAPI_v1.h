@@ -22,12 +22,14 @@
 
 #include <map>
 #include <list>
+#include <vector>
 
 #include <dbus/dbus.h>
 
 #include <boost/bind.hpp>
 #include <boost/any.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "NetworkInstance.h"
 #include "NCPTypes.h"
@@ -71,6 +73,19 @@ private:
 
 	void status_response_helper(int ret, NCPControlInterface* interface, DBusMessage *original_message);
 
+	// Results of a `PropGetMulti` call, filled in as the individual
+	// property gets complete.
+	struct PropGetMultiContext {
+		DBusMessage* mMessage;
+		std::vector<std::string> mKeys;
+		std::vector<int> mStatus;
+		std::vector<boost::any> mValues;
+		size_t mRemaining;
+	};
+
+	void prop_get_multi_helper(int status, const boost::any& value, boost::shared_ptr<PropGetMultiContext> context, size_t index);
+	void prop_get_multi_send_reply(const PropGetMultiContext& context);
+
 	// TODO: Remove these...
 	//void scan_response_helper(int ret, DBusMessage *original_message);
 	//void energy_scan_response_helper(int ret, DBusMessage *original_message);
@@ -148,6 +163,11 @@ private:
 		DBusMessage *        message
 	);
 
+	DBusHandlerResult interface_prop_get_multi_handler(
+		NCPControlInterface* interface,
+		DBusMessage *        message
+	);
+
 	DBusHandlerResult interface_prop_set_handler(
 		NCPControlInterface* interface,
 		DBusMessage *        message
@@ -209,6 +229,11 @@ private:
 		DBusMessage *        message
 	);
 
+	DBusHandlerResult interface_joiner_add_bulk_handler(
+		NCPControlInterface* interface,
+		DBusMessage *        message
+	);
+
 	DBusHandlerResult interface_joiner_add_handler(
 		NCPControlInterface* interface,
 		DBusMessage *        message
@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Measures how long it takes to marshal a large neighbor table
+ *      (as returned for `Thread:NeighborTable:AsValMap`) into a
+ *      D-Bus message.
+ *
+ *      Usage: dbus-marshal-bench [entries [iterations]]
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <list>
+#include <algorithm>
+
+#include "DBUSHelpers.h"
+#include "ValueMap.h"
+#include "wpan-properties.h"
+
+using namespace nl;
+
+static uint64_t
+time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Same keys and types as SpinelNCPTaskGetNetworkTopology produces.
+static std::list<ValueMap>
+make_neighbor_table(int entries)
+{
+	std::list<ValueMap> table;
+	int i;
+
+	for (i = 0; i < entries; i++) {
+		ValueMap entry;
+
+		entry[kWPANTUNDValueMapKey_NetworkTopology_ExtAddress] = uint64_t(0x1822330000000000ull + i);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_RLOC16] = uint16_t(0x4400 + i);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_AverageRssi] = int8_t(-60 - (i % 30));
+		entry[kWPANTUNDValueMapKey_NetworkTopology_LastRssi] = int8_t(-58 - (i % 30));
+		entry[kWPANTUNDValueMapKey_NetworkTopology_LinkQualityIn] = uint8_t(i % 4);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_Age] = uint32_t(i * 3);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_RxOnWhenIdle] = bool(i & 1);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_FullFunction] = bool(i & 2);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_SecureDataRequest] = true;
+		entry[kWPANTUNDValueMapKey_NetworkTopology_FullNetworkData] = bool(i & 4);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_LinkFrameCounter] = uint32_t(i * 101);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_MleFrameCounter] = uint32_t(i * 7);
+		entry[kWPANTUNDValueMapKey_NetworkTopology_IsChild] = bool(i % 3 == 0);
+
+		table.push_back(entry);
+	}
+
+	return table;
+}
+
+int
+main(int argc, char* argv[])
+{
+	int entries = (argc > 1) ? atoi(argv[1]) : 500;
+	int iterations = (argc > 2) ? atoi(argv[2]) : 200;
+	boost::any value;
+	uint64_t total = 0;
+	uint64_t best = UINT64_MAX;
+	int i;
+
+	if ((entries <= 0) || (iterations <= 0)) {
+		fprintf(stderr, "usage: %s [entries [iterations]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	value = make_neighbor_table(entries);
+
+	for (i = 0; i < iterations; i++) {
+		DBusMessage* message = dbus_message_new_signal("/org/wpantund/bench", "org.wpantund.Bench", "Table");
+		DBusMessageIter iter;
+		uint64_t start;
+		uint64_t elapsed;
+
+		dbus_message_iter_init_append(message, &iter);
+
+		start = time_ns();
+		DBUSHelpers::append_any_to_dbus_iter(&iter, value);
+		elapsed = time_ns() - start;
+
+		dbus_message_unref(message);
+
+		total += elapsed;
+		best = std::min(best, elapsed);
+	}
+
+	printf("%d entries, %d iterations: min %.1fus, avg %.1fus (%.0fns per entry)\n",
+		entries,
+		iterations,
+		best / 1000.0,
+		(total / (double)iterations) / 1000.0,
+		(total / (double)iterations) / entries
+	);
+
+	return EXIT_SUCCESS;
+}
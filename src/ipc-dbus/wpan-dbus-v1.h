@@ -75,12 +75,14 @@
 #define WPANTUND_IF_SIGNAL_ENERGY_SCAN_RESULT "EnergyScanResult"
 
 #define WPANTUND_IF_CMD_PROP_GET              "PropGet"
+#define WPANTUND_IF_CMD_PROP_GET_MULTI        "PropGetMulti"
 #define WPANTUND_IF_CMD_PROP_SET              "PropSet"
 #define WPANTUND_IF_CMD_PROP_INSERT           "PropInsert"
 #define WPANTUND_IF_CMD_PROP_REMOVE           "PropRemove"
 #define WPANTUND_IF_SIGNAL_PROP_CHANGED       "PropChanged"
 
 #define WPANTUND_IF_CMD_JOINER_ADD            "JoinerAdd"
+#define WPANTUND_IF_CMD_JOINER_ADD_BULK       "JoinerAddBulk"
 
 #define WPANTUND_IF_CMD_PEEK                  "Peek"
 #define WPANTUND_IF_CMD_POKE                  "Poke"
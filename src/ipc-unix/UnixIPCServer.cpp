@@ -0,0 +1,958 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Implementation of the Unix-domain socket IPCServer subclass.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#include "UnixIPCServer.h"
+#include "wpan-ipc-unix.h"
+#include "NCPControlInterface.h"
+#include "wpan-error.h"
+#include "assert-macros.h"
+#include "ValueMap.h"
+#include "ValueType.h"
+#include "Data.h"
+#include "any-to.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/bind.hpp>
+
+using namespace nl;
+using namespace nl::wpantund;
+
+// A client which lets this much of its output pile up (usually by
+// subscribing and then not reading) gets disconnected.
+#define MAX_CLIENT_OUTBOUND_SIZE    (4 * WPAN_IPC_MAX_FRAME_SIZE)
+
+#define MAX_CLIENTS                 32
+#define READ_CHUNK_SIZE             4096
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Encoding
+
+static void
+put_u32(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 24));
+}
+
+static void
+put_u64(std::vector<uint8_t>& out, uint64_t value)
+{
+	put_u32(out, static_cast<uint32_t>(value));
+	put_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static void
+put_bytes(std::vector<uint8_t>& out, const void* ptr, size_t len)
+{
+	const uint8_t* byte_ptr = static_cast<const uint8_t*>(ptr);
+
+	put_u32(out, static_cast<uint32_t>(len));
+	out.insert(out.end(), byte_ptr, byte_ptr + len);
+}
+
+static void
+put_string(std::vector<uint8_t>& out, const std::string& value)
+{
+	put_bytes(out, value.data(), value.size());
+}
+
+static void
+put_uint(std::vector<uint8_t>& out, uint8_t width, uint64_t value)
+{
+	out.push_back(WPAN_IPC_VALUE_UINT);
+	out.push_back(width);
+	put_u64(out, value);
+}
+
+static void
+put_int(std::vector<uint8_t>& out, int64_t value)
+{
+	out.push_back(WPAN_IPC_VALUE_INT);
+	put_u64(out, static_cast<uint64_t>(value));
+}
+
+static void
+put_double(std::vector<uint8_t>& out, double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	out.push_back(WPAN_IPC_VALUE_DOUBLE);
+	put_u64(out, bits);
+}
+
+template <typename T>
+static void
+put_string_list(std::vector<uint8_t>& out, const T& container)
+{
+	typename T::const_iterator iter;
+
+	out.push_back(WPAN_IPC_VALUE_LIST);
+	put_u32(out, static_cast<uint32_t>(container.size()));
+
+	for (iter = container.begin(); iter != container.end(); ++iter) {
+		out.push_back(WPAN_IPC_VALUE_STRING);
+		put_string(out, *iter);
+	}
+}
+
+static void put_value(std::vector<uint8_t>& out, const boost::any& value);
+
+static void
+put_value_map(std::vector<uint8_t>& out, const ValueMap& map)
+{
+	ValueMap::const_iterator iter;
+
+	out.push_back(WPAN_IPC_VALUE_MAP);
+	put_u32(out, static_cast<uint32_t>(map.size()));
+
+	for (iter = map.begin(); iter != map.end(); ++iter) {
+		put_string(out, iter->first);
+		put_value(out, iter->second);
+	}
+}
+
+static void
+put_value(std::vector<uint8_t>& out, const boost::any& value)
+{
+	switch (value_type_of(value)) {
+	case kValueType_Empty:
+		out.push_back(WPAN_IPC_VALUE_EMPTY);
+		break;
+
+	case kValueType_Bool:
+		out.push_back(WPAN_IPC_VALUE_BOOL);
+		out.push_back(value_cast<bool>(value) ? 1 : 0);
+		break;
+
+	case kValueType_String:
+		out.push_back(WPAN_IPC_VALUE_STRING);
+		put_string(out, value_cast<std::string>(value));
+		break;
+
+	case kValueType_Data: {
+		const nl::Data& data = value_cast<nl::Data>(value);
+		out.push_back(WPAN_IPC_VALUE_DATA);
+		put_bytes(out, data.data(), data.size());
+		break;
+	}
+
+	case kValueType_ByteVector: {
+		const std::vector<uint8_t>& data = value_cast< std::vector<uint8_t> >(value);
+		out.push_back(WPAN_IPC_VALUE_DATA);
+		put_bytes(out, data.data(), data.size());
+		break;
+	}
+
+	case kValueType_Int8:
+		put_int(out, value_cast<int8_t>(value));
+		break;
+
+	case kValueType_Int16:
+		put_int(out, value_cast<int16_t>(value));
+		break;
+
+	case kValueType_Int32:
+		put_int(out, value_cast<int32_t>(value));
+		break;
+
+	case kValueType_Int64:
+		put_int(out, value_cast<int64_t>(value));
+		break;
+
+	case kValueType_UInt8:
+		put_uint(out, sizeof(uint8_t), value_cast<uint8_t>(value));
+		break;
+
+	case kValueType_UInt16:
+		put_uint(out, sizeof(uint16_t), value_cast<uint16_t>(value));
+		break;
+
+	case kValueType_UInt32:
+		put_uint(out, sizeof(uint32_t), value_cast<uint32_t>(value));
+		break;
+
+	case kValueType_UInt64:
+		put_uint(out, sizeof(uint64_t), value_cast<uint64_t>(value));
+		break;
+
+	case kValueType_Double:
+		put_double(out, value_cast<double>(value));
+		break;
+
+	case kValueType_Float:
+		put_double(out, value_cast<float>(value));
+		break;
+
+	case kValueType_StringList:
+		put_string_list(out, value_cast< std::list<std::string> >(value));
+		break;
+
+	case kValueType_StringSet:
+		put_string_list(out, value_cast< std::set<std::string> >(value));
+		break;
+
+	case kValueType_ValueMap:
+		put_value_map(out, value_cast<ValueMap>(value));
+		break;
+
+	case kValueType_ValueMapList: {
+		const std::list<ValueMap>& list = value_cast< std::list<ValueMap> >(value);
+		std::list<ValueMap>::const_iterator iter;
+
+		out.push_back(WPAN_IPC_VALUE_LIST);
+		put_u32(out, static_cast<uint32_t>(list.size()));
+
+		for (iter = list.begin(); iter != list.end(); ++iter) {
+			put_value_map(out, *iter);
+		}
+		break;
+	}
+
+	default:
+		// Anything else is sent the way `wpanctl` would have shown it.
+		out.push_back(WPAN_IPC_VALUE_STRING);
+		put_string(out, any_to_string(value));
+		break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Decoding
+
+namespace {
+
+struct Reader {
+	const uint8_t* mPtr;
+	size_t mLen;
+	bool mError;
+
+	Reader(const uint8_t* ptr, size_t len): mPtr(ptr), mLen(len), mError(false) { }
+
+	const uint8_t* take(size_t len) {
+		const uint8_t* ret = mPtr;
+
+		if (mError || (len > mLen)) {
+			mError = true;
+			return NULL;
+		}
+
+		mPtr += len;
+		mLen -= len;
+
+		return ret;
+	}
+
+	uint8_t get_u8(void) {
+		const uint8_t* ptr = take(1);
+		return ptr ? ptr[0] : 0;
+	}
+
+	uint32_t get_u32(void) {
+		const uint8_t* ptr = take(4);
+		return ptr ? (ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (static_cast<uint32_t>(ptr[3]) << 24)) : 0;
+	}
+
+	uint64_t get_u64(void) {
+		uint64_t low = get_u32();
+		return low | (static_cast<uint64_t>(get_u32()) << 32);
+	}
+
+	std::string get_string(void) {
+		uint32_t len = get_u32();
+		const uint8_t* ptr = take(len);
+		return ptr ? std::string(reinterpret_cast<const char*>(ptr), len) : std::string();
+	}
+
+	boost::any get_value(int depth = 0);
+};
+
+boost::any
+Reader::get_value(int depth)
+{
+	boost::any ret;
+	uint8_t tag = get_u8();
+
+	// Nesting is never needed for setting properties, but guard
+	// against a client sending us something pathological.
+	if (depth > 4) {
+		mError = true;
+		return ret;
+	}
+
+	switch (tag) {
+	case WPAN_IPC_VALUE_EMPTY:
+		break;
+
+	case WPAN_IPC_VALUE_BOOL:
+		ret = (get_u8() != 0);
+		break;
+
+	case WPAN_IPC_VALUE_INT: {
+		int64_t value = static_cast<int64_t>(get_u64());
+
+		// The rest of wpantund mostly knows how to handle 32-bit values.
+		if ((value >= INT32_MIN) && (value <= INT32_MAX)) {
+			ret = static_cast<int32_t>(value);
+		} else {
+			ret = value;
+		}
+		break;
+	}
+
+	case WPAN_IPC_VALUE_UINT: {
+		uint64_t value;
+
+		get_u8(); // Width, only needed for display.
+		value = get_u64();
+
+		if (value <= UINT32_MAX) {
+			ret = static_cast<uint32_t>(value);
+		} else {
+			ret = value;
+		}
+		break;
+	}
+
+	case WPAN_IPC_VALUE_DOUBLE: {
+		uint64_t bits = get_u64();
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		ret = value;
+		break;
+	}
+
+	case WPAN_IPC_VALUE_STRING:
+		ret = get_string();
+		break;
+
+	case WPAN_IPC_VALUE_DATA: {
+		uint32_t len = get_u32();
+		const uint8_t* ptr = take(len);
+		if (ptr != NULL) {
+			ret = nl::Data(ptr, len);
+		}
+		break;
+	}
+
+	case WPAN_IPC_VALUE_LIST: {
+		uint32_t count = get_u32();
+		std::list<std::string> list;
+
+		// Lists of strings are the only kind wpantund accepts.
+		while (!mError && count--) {
+			list.push_back(any_to_string(get_value(depth + 1)));
+		}
+		ret = list;
+		break;
+	}
+
+	case WPAN_IPC_VALUE_MAP: {
+		uint32_t count = get_u32();
+		ValueMap map;
+
+		while (!mError && count--) {
+			std::string key = get_string();
+			map[key] = get_value(depth + 1);
+		}
+		ret = map;
+		break;
+	}
+
+	default:
+		mError = true;
+		break;
+	}
+
+	return ret;
+}
+
+}; // namespace
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Server
+
+UnixIPCServer::UnixIPCServer(const std::string& socket_path):
+	mSocketPath(socket_path),
+	mListenFD(-1)
+{
+	struct sockaddr_un addr;
+
+	require_action(socket_path.size() < sizeof(addr.sun_path), bail, errno = ENAMETOOLONG);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+	mListenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+	require(mListenFD >= 0, bail);
+
+	fcntl(mListenFD, F_SETFL, fcntl(mListenFD, F_GETFL) | O_NONBLOCK);
+	fcntl(mListenFD, F_SETFD, FD_CLOEXEC);
+
+	// Remove whatever a previous instance left behind.
+	unlink(socket_path.c_str());
+
+	// Same audience as the D-Bus policy: root and the wpantund group.
+	// The socket is created with these permissions, so that there is
+	// no window in which anybody else could connect.
+	{
+		mode_t old_umask = umask(0117);
+		int ret = bind(mListenFD, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+
+		umask(old_umask);
+
+		require(ret == 0, bail);
+	}
+
+	require(listen(mListenFD, 8) == 0, bail);
+
+	syslog(LOG_NOTICE, "Ready. Using IPC socket \"%s\"", socket_path.c_str());
+
+	return;
+
+bail:
+	{
+		int err = errno;
+
+		if (mListenFD >= 0) {
+			close(mListenFD);
+			mListenFD = -1;
+		}
+
+		throw std::runtime_error(strerror(err));
+	}
+}
+
+UnixIPCServer::~UnixIPCServer()
+{
+	std::list<ClientPtr>::iterator iter;
+
+	for (iter = mClients.begin(); iter != mClients.end(); ++iter) {
+		close((*iter)->mFD);
+	}
+
+	if (mListenFD >= 0) {
+		close(mListenFD);
+		unlink(mSocketPath.c_str());
+	}
+}
+
+int
+UnixIPCServer::add_interface(NCPControlInterface* instance)
+{
+	mInterfaceMap[instance->get_name()] = instance;
+
+	instance->mOnPropertyChanged.connect(
+		boost::bind(
+			&UnixIPCServer::property_changed,
+			this,
+			instance,
+			_1,
+			_2
+		)
+	);
+
+	return 0;
+}
+
+cms_t
+UnixIPCServer::get_ms_to_next_event(void)
+{
+	return CMS_DISTANT_FUTURE;
+}
+
+int
+UnixIPCServer::update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout)
+{
+	std::list<ClientPtr>::const_iterator iter;
+
+	if (read_fd_set != NULL) {
+		FD_SET(mListenFD, read_fd_set);
+	}
+
+	if (max_fd != NULL) {
+		*max_fd = std::max(*max_fd, mListenFD);
+	}
+
+	for (iter = mClients.begin(); iter != mClients.end(); ++iter) {
+		const Client& client = **iter;
+
+		if (read_fd_set != NULL) {
+			FD_SET(client.mFD, read_fd_set);
+		}
+
+		if (error_fd_set != NULL) {
+			FD_SET(client.mFD, error_fd_set);
+		}
+
+		if ((write_fd_set != NULL) && (client.mOutboundSent < client.mOutbound.size())) {
+			FD_SET(client.mFD, write_fd_set);
+		}
+
+		if (max_fd != NULL) {
+			*max_fd = std::max(*max_fd, client.mFD);
+		}
+	}
+
+	return 0;
+}
+
+// Only root and the user wpantund runs as may change anything, the
+// rest of the socket's group may only read properties.
+bool
+UnixIPCServer::peer_may_modify(int fd)
+{
+	uid_t uid;
+
+#if defined(SO_PEERCRED)
+	struct ucred cred;
+	socklen_t cred_len = sizeof(cred);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0) {
+		syslog(LOG_WARNING, "IPC: Unable to get credentials of client on FD%d: %s", fd, strerror(errno));
+		return false;
+	}
+
+	uid = cred.uid;
+#else
+	gid_t gid;
+
+	if (getpeereid(fd, &uid, &gid) != 0) {
+		syslog(LOG_WARNING, "IPC: Unable to get credentials of client on FD%d: %s", fd, strerror(errno));
+		return false;
+	}
+#endif
+
+	return (uid == 0) || (uid == geteuid());
+}
+
+void
+UnixIPCServer::accept_clients(void)
+{
+	int fd;
+
+	while ((fd = accept(mListenFD, NULL, NULL)) >= 0) {
+		ClientPtr client;
+
+		if (mClients.size() >= MAX_CLIENTS) {
+			syslog(LOG_WARNING, "IPC: Too many clients, refusing connection");
+			close(fd);
+			continue;
+		}
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		client = ClientPtr(new Client);
+		client->mFD = fd;
+		client->mClosed = false;
+		client->mMayModify = peer_may_modify(fd);
+		client->mOutboundSent = 0;
+
+		mClients.push_back(client);
+
+		syslog(LOG_DEBUG, "IPC: Client connected on FD%d", fd);
+	}
+}
+
+void
+UnixIPCServer::close_client(const ClientPtr& client, const char* reason)
+{
+	if (!client->mClosed) {
+		syslog(LOG_DEBUG, "IPC: Closing client on FD%d: %s", client->mFD, reason);
+		close(client->mFD);
+		client->mClosed = true;
+	}
+}
+
+void
+UnixIPCServer::read_from_client(const ClientPtr& client)
+{
+	uint8_t buffer[READ_CHUNK_SIZE];
+	ssize_t len;
+	size_t offset = 0;
+
+	len = read(client->mFD, buffer, sizeof(buffer));
+
+	if (len == 0) {
+		close_client(client, "disconnected");
+		return;
+	}
+
+	if (len < 0) {
+		if ((errno != EAGAIN) && (errno != EINTR)) {
+			close_client(client, strerror(errno));
+		}
+		return;
+	}
+
+	client->mInbound.insert(client->mInbound.end(), buffer, buffer + len);
+
+	while (!client->mClosed && (client->mInbound.size() - offset >= WPAN_IPC_HEADER_SIZE)) {
+		Reader reader(&client->mInbound[offset], client->mInbound.size() - offset);
+		uint32_t frame_len = reader.get_u32();
+		uint8_t type;
+		uint32_t id;
+
+		if ((frame_len < WPAN_IPC_HEADER_SIZE - 4) || (frame_len > WPAN_IPC_MAX_FRAME_SIZE)) {
+			close_client(client, "bad frame length");
+			return;
+		}
+
+		if (client->mInbound.size() - offset < 4 + frame_len) {
+			break;
+		}
+
+		type = reader.get_u8();
+		id = reader.get_u32();
+
+		handle_frame(client, type, id, reader.mPtr, frame_len - (WPAN_IPC_HEADER_SIZE - 4));
+
+		offset += 4 + frame_len;
+	}
+
+	client->mInbound.erase(client->mInbound.begin(), client->mInbound.begin() + std::min(offset, client->mInbound.size()));
+}
+
+void
+UnixIPCServer::write_to_client(const ClientPtr& client)
+{
+	while (!client->mClosed && (client->mOutboundSent < client->mOutbound.size())) {
+		ssize_t len = send(
+			client->mFD,
+			&client->mOutbound[client->mOutboundSent],
+			client->mOutbound.size() - client->mOutboundSent,
+			MSG_NOSIGNAL
+		);
+
+		if (len < 0) {
+			if ((errno != EAGAIN) && (errno != EINTR)) {
+				close_client(client, strerror(errno));
+			}
+			break;
+		}
+
+		client->mOutboundSent += len;
+	}
+
+	if (client->mOutboundSent == client->mOutbound.size()) {
+		client->mOutbound.clear();
+		client->mOutboundSent = 0;
+	}
+}
+
+void
+UnixIPCServer::process(void)
+{
+	std::list<ClientPtr>::iterator iter;
+
+	accept_clients();
+
+	for (iter = mClients.begin(); iter != mClients.end();) {
+		ClientPtr client = *iter;
+
+		if (!client->mClosed) {
+			read_from_client(client);
+		}
+
+		if (!client->mClosed) {
+			write_to_client(client);
+		}
+
+		if (client->mClosed) {
+			// Callbacks still in flight only hold weak references.
+			iter = mClients.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+}
+
+void
+UnixIPCServer::send_frame(const ClientPtr& client, uint8_t type, uint32_t id, const std::vector<uint8_t>& body)
+{
+	std::vector<uint8_t>& out = client->mOutbound;
+
+	if (client->mClosed) {
+		return;
+	}
+
+	if (out.size() + WPAN_IPC_HEADER_SIZE + body.size() > MAX_CLIENT_OUTBOUND_SIZE) {
+		close_client(client, "not reading fast enough");
+		return;
+	}
+
+	put_u32(out, static_cast<uint32_t>(WPAN_IPC_HEADER_SIZE - 4 + body.size()));
+	out.push_back(type);
+	put_u32(out, id);
+	out.insert(out.end(), body.begin(), body.end());
+
+	write_to_client(client);
+}
+
+void
+UnixIPCServer::send_result(ClientRef client_ref, uint32_t id, int status, const boost::any& value)
+{
+	ClientPtr client = client_ref.lock();
+	std::vector<uint8_t> body;
+
+	if (client) {
+		if (!status && value.empty()) {
+			status = kWPANTUNDStatus_PropertyEmpty;
+		}
+
+		put_u32(body, static_cast<uint32_t>(status));
+		put_value(body, value);
+		send_frame(client, WPAN_IPC_MSG_RESULT, id, body);
+	}
+}
+
+void
+UnixIPCServer::send_status(ClientRef client_ref, uint32_t id, int status)
+{
+	ClientPtr client = client_ref.lock();
+	std::vector<uint8_t> body;
+
+	if (client) {
+		put_u32(body, static_cast<uint32_t>(status));
+		put_value(body, boost::any());
+		send_frame(client, WPAN_IPC_MSG_RESULT, id, body);
+	}
+}
+
+void
+UnixIPCServer::multi_get_helper(int status, const boost::any& value, boost::shared_ptr<MultiGetContext> context, size_t index)
+{
+	context->mStatus[index] = status;
+	context->mValues[index] = value;
+
+	if (--context->mRemaining == 0) {
+		send_multi_result(*context);
+	}
+}
+
+void
+UnixIPCServer::send_multi_result(const MultiGetContext& context)
+{
+	ClientPtr client = context.mClient.lock();
+	std::vector<uint8_t> body;
+	size_t i;
+
+	if (!client) {
+		return;
+	}
+
+	put_u32(body, kWPANTUNDStatus_Ok);
+	put_u32(body, static_cast<uint32_t>(context.mKeys.size()));
+
+	for (i = 0; i < context.mKeys.size(); i++) {
+		int key_status = context.mStatus[i];
+
+		if (!key_status && context.mValues[i].empty()) {
+			key_status = kWPANTUNDStatus_PropertyEmpty;
+		}
+
+		put_string(body, context.mKeys[i]);
+		put_u32(body, static_cast<uint32_t>(key_status));
+		put_value(body, context.mValues[i]);
+	}
+
+	send_frame(client, WPAN_IPC_MSG_MULTI_RESULT, context.mID, body);
+}
+
+void
+UnixIPCServer::handle_frame(const ClientPtr& client, uint8_t type, uint32_t id, const uint8_t* body, size_t body_len)
+{
+	Reader reader(body, body_len);
+	NCPControlInterface* interface = NULL;
+	std::string interface_name;
+	std::string key;
+
+	if (type == WPAN_IPC_MSG_LIST_INTERFACES) {
+		std::list<std::string> names;
+		std::map<std::string, NCPControlInterface*>::const_iterator iter;
+
+		for (iter = mInterfaceMap.begin(); iter != mInterfaceMap.end(); ++iter) {
+			names.push_back(iter->first);
+		}
+
+		send_result(client, id, kWPANTUNDStatus_Ok, names);
+		return;
+	}
+
+	interface_name = reader.get_string();
+
+	if (mInterfaceMap.count(interface_name)) {
+		interface = mInterfaceMap[interface_name];
+	}
+
+	if (reader.mError) {
+		close_client(client, "malformed request");
+		return;
+	}
+
+	if (interface == NULL) {
+		send_status(client, id, kWPANTUNDStatus_InterfaceNotFound);
+		return;
+	}
+
+	switch (type) {
+	case WPAN_IPC_MSG_GET:
+		key = reader.get_string();
+		require_quiet(!reader.mError, malformed);
+
+		interface->translate_deprecated_property(key);
+
+		interface->property_get_value(
+			key,
+			boost::bind(&UnixIPCServer::send_result, this, ClientRef(client), id, _1, _2)
+		);
+		break;
+
+	case WPAN_IPC_MSG_SET:
+	case WPAN_IPC_MSG_INSERT:
+	case WPAN_IPC_MSG_REMOVE: {
+		boost::any value;
+		CallbackWithStatus cb = boost::bind(&UnixIPCServer::send_status, this, ClientRef(client), id, _1);
+
+		key = reader.get_string();
+		value = reader.get_value();
+		require_quiet(!reader.mError, malformed);
+
+		if (!client->mMayModify) {
+			syslog(LOG_WARNING, "IPC: Client on FD%d may not change \"%s\"", client->mFD, key.c_str());
+			send_status(client, id, kWPANTUNDStatus_PermissionDenied);
+			break;
+		}
+
+		interface->translate_deprecated_property(key, value);
+
+		if (type == WPAN_IPC_MSG_SET) {
+			interface->property_set_value(key, value, cb);
+		} else if (type == WPAN_IPC_MSG_INSERT) {
+			interface->property_insert_value(key, value, cb);
+		} else {
+			interface->property_remove_value(key, value, cb);
+		}
+		break;
+	}
+
+	case WPAN_IPC_MSG_GET_MULTI: {
+		boost::shared_ptr<MultiGetContext> context(new MultiGetContext);
+		uint32_t count = reader.get_u32();
+		size_t i;
+
+		while (!reader.mError && count--) {
+			key = reader.get_string();
+			interface->translate_deprecated_property(key);
+			context->mKeys.push_back(key);
+		}
+		require_quiet(!reader.mError, malformed);
+
+		context->mClient = client;
+		context->mID = id;
+		context->mStatus.resize(context->mKeys.size(), kWPANTUNDStatus_Ok);
+		context->mValues.resize(context->mKeys.size());
+
+		context->mRemaining = context->mKeys.size();
+
+		if (context->mKeys.empty()) {
+			send_multi_result(*context);
+		}
+
+		for (i = 0; i < context->mKeys.size(); i++) {
+			interface->property_get_value(
+				context->mKeys[i],
+				boost::bind(&UnixIPCServer::multi_get_helper, this, _1, _2, context, i)
+			);
+		}
+		break;
+	}
+
+	case WPAN_IPC_MSG_SUBSCRIBE:
+		client->mSubscriptions.insert(interface_name);
+		send_status(client, id, kWPANTUNDStatus_Ok);
+		break;
+
+	case WPAN_IPC_MSG_UNSUBSCRIBE:
+		client->mSubscriptions.erase(interface_name);
+		send_status(client, id, kWPANTUNDStatus_Ok);
+		break;
+
+	default:
+		send_status(client, id, kWPANTUNDStatus_FeatureNotImplemented);
+		break;
+	}
+
+	return;
+
+malformed:
+	close_client(client, "malformed request");
+}
+
+void
+UnixIPCServer::property_changed(NCPControlInterface* interface, const std::string& key, const boost::any& value)
+{
+	const std::string& interface_name = interface->get_name();
+	std::list<ClientPtr>::iterator iter;
+	std::vector<uint8_t> body;
+
+	for (iter = mClients.begin(); iter != mClients.end(); ++iter) {
+		if ((*iter)->mSubscriptions.count(interface_name) == 0) {
+			continue;
+		}
+
+		// Only encode the value if somebody actually wants it.
+		if (body.empty()) {
+			put_string(body, interface_name);
+			put_string(body, key);
+			put_value(body, value);
+		}
+
+		send_frame(*iter, WPAN_IPC_MSG_EVENT, 0, body);
+	}
+}
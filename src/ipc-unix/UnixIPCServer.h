@@ -0,0 +1,104 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Declaration of the Unix-domain socket IPCServer subclass.
+ *
+ */
+
+#ifndef wpantund_UnixIPCServer_h
+#define wpantund_UnixIPCServer_h
+
+#include "IPCServer.h"
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <list>
+#include <string>
+#include <vector>
+#include <boost/any.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+namespace nl {
+namespace wpantund {
+
+class UnixIPCServer : public IPCServer {
+public:
+
+	UnixIPCServer(const std::string& socket_path);
+	virtual ~UnixIPCServer();
+
+	virtual int add_interface(NCPControlInterface* instance);
+	virtual cms_t get_ms_to_next_event(void);
+	virtual void process(void);
+	virtual int update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout);
+
+private:
+	struct Client {
+		int mFD;
+		bool mClosed;
+
+		// From the peer's credentials: true if the client may set,
+		// insert or remove properties.
+		bool mMayModify;
+		std::vector<uint8_t> mInbound;
+		std::vector<uint8_t> mOutbound;
+		size_t mOutboundSent;
+		std::set<std::string> mSubscriptions;
+	};
+
+	typedef boost::shared_ptr<Client> ClientPtr;
+	typedef boost::weak_ptr<Client> ClientRef;
+
+	struct MultiGetContext {
+		ClientRef mClient;
+		uint32_t mID;
+		std::vector<std::string> mKeys;
+		std::vector<int> mStatus;
+		std::vector<boost::any> mValues;
+		size_t mRemaining;
+	};
+
+	void accept_clients(void);
+	static bool peer_may_modify(int fd);
+	void read_from_client(const ClientPtr& client);
+	void write_to_client(const ClientPtr& client);
+	void close_client(const ClientPtr& client, const char* reason);
+
+	void handle_frame(const ClientPtr& client, uint8_t type, uint32_t id, const uint8_t* body, size_t body_len);
+
+	void send_frame(const ClientPtr& client, uint8_t type, uint32_t id, const std::vector<uint8_t>& body);
+	void send_result(ClientRef client_ref, uint32_t id, int status, const boost::any& value);
+	void send_status(ClientRef client_ref, uint32_t id, int status);
+
+	void multi_get_helper(int status, const boost::any& value, boost::shared_ptr<MultiGetContext> context, size_t index);
+	void send_multi_result(const MultiGetContext& context);
+
+	void property_changed(NCPControlInterface* interface, const std::string& key, const boost::any& value);
+
+private:
+	std::string mSocketPath;
+	int mListenFD;
+	std::list<ClientPtr> mClients;
+	std::map<std::string, NCPControlInterface*> mInterfaceMap;
+};
+
+};
+};
+
+#endif
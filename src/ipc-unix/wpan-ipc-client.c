@@ -0,0 +1,938 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Blocking C client for wpantund's Unix-domain IPC socket.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "wpan-ipc-client.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define DEFAULT_TIMEOUT_MS      (10 * 1000)
+#define MAX_VALUE_DEPTH         8
+
+struct wpan_ipc_client_s {
+	int fd;
+	int timeout_ms;
+	uint32_t last_id;
+
+	wpan_ipc_event_cb event_cb;
+	void* event_context;
+
+	// Received bytes. The first `rx_consumed` bytes belong to the
+	// frame most recently handed out and are dropped on the next read.
+	uint8_t* rx_buffer;
+	size_t rx_len;
+	size_t rx_size;
+	size_t rx_consumed;
+};
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Encoding
+
+struct buffer_s {
+	uint8_t* ptr;
+	size_t len;
+	size_t size;
+	int error;
+};
+
+static void
+buffer_append(struct buffer_s* buffer, const void* ptr, size_t len)
+{
+	if (buffer->error || (len == 0)) {
+		return;
+	}
+
+	if (buffer->len + len > buffer->size) {
+		size_t new_size = (buffer->size * 2) + len + 64;
+		uint8_t* new_ptr = realloc(buffer->ptr, new_size);
+
+		if (new_ptr == NULL) {
+			buffer->error = -ENOMEM;
+			return;
+		}
+
+		buffer->ptr = new_ptr;
+		buffer->size = new_size;
+	}
+
+	memcpy(buffer->ptr + buffer->len, ptr, len);
+	buffer->len += len;
+}
+
+static void
+put_u8(struct buffer_s* buffer, uint8_t value)
+{
+	buffer_append(buffer, &value, 1);
+}
+
+static void
+put_u32(struct buffer_s* buffer, uint32_t value)
+{
+	uint8_t bytes[4] = {
+		(uint8_t)value,
+		(uint8_t)(value >> 8),
+		(uint8_t)(value >> 16),
+		(uint8_t)(value >> 24),
+	};
+
+	buffer_append(buffer, bytes, sizeof(bytes));
+}
+
+static void
+put_bytes(struct buffer_s* buffer, const void* ptr, size_t len)
+{
+	put_u32(buffer, (uint32_t)len);
+	buffer_append(buffer, ptr, len);
+}
+
+static void
+put_string(struct buffer_s* buffer, const char* string)
+{
+	put_bytes(buffer, string, strlen(string));
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Decoding
+
+struct reader_s {
+	const uint8_t* ptr;
+	size_t len;
+	int error;
+};
+
+static const uint8_t*
+take(struct reader_s* reader, size_t len)
+{
+	const uint8_t* ret = reader->ptr;
+
+	if (reader->error || (len > reader->len)) {
+		reader->error = -EBADMSG;
+		return NULL;
+	}
+
+	reader->ptr += len;
+	reader->len -= len;
+
+	return ret;
+}
+
+static uint8_t
+get_u8(struct reader_s* reader)
+{
+	const uint8_t* ptr = take(reader, 1);
+	return ptr ? ptr[0] : 0;
+}
+
+static uint32_t
+get_u32(struct reader_s* reader)
+{
+	const uint8_t* ptr = take(reader, 4);
+	return ptr ? (ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32_t)ptr[3] << 24)) : 0;
+}
+
+static uint64_t
+get_u64(struct reader_s* reader)
+{
+	uint64_t low = get_u32(reader);
+	return low | ((uint64_t)get_u32(reader) << 32);
+}
+
+// Returns a NUL-terminated copy, which must be freed.
+static char*
+get_string(struct reader_s* reader)
+{
+	uint32_t len = get_u32(reader);
+	const uint8_t* ptr = take(reader, len);
+	char* ret = NULL;
+
+	if (ptr != NULL) {
+		ret = malloc(len + 1);
+
+		if (ret == NULL) {
+			reader->error = -ENOMEM;
+		} else {
+			memcpy(ret, ptr, len);
+			ret[len] = 0;
+		}
+	}
+
+	return ret;
+}
+
+static void
+skip_value_payload(struct reader_s* reader, uint8_t tag, int depth)
+{
+	uint32_t count;
+
+	if (depth > MAX_VALUE_DEPTH) {
+		reader->error = -EBADMSG;
+		return;
+	}
+
+	switch (tag) {
+	case WPAN_IPC_VALUE_EMPTY:
+		break;
+
+	case WPAN_IPC_VALUE_BOOL:
+		take(reader, 1);
+		break;
+
+	case WPAN_IPC_VALUE_INT:
+	case WPAN_IPC_VALUE_DOUBLE:
+		take(reader, 8);
+		break;
+
+	case WPAN_IPC_VALUE_UINT:
+		take(reader, 1 + 8);
+		break;
+
+	case WPAN_IPC_VALUE_STRING:
+	case WPAN_IPC_VALUE_DATA:
+		count = get_u32(reader);
+		take(reader, count);
+		break;
+
+	case WPAN_IPC_VALUE_LIST:
+		count = get_u32(reader);
+		while (!reader->error && count--) {
+			skip_value_payload(reader, get_u8(reader), depth + 1);
+		}
+		break;
+
+	case WPAN_IPC_VALUE_MAP:
+		count = get_u32(reader);
+		while (!reader->error && count--) {
+			take(reader, get_u32(reader));
+			skip_value_payload(reader, get_u8(reader), depth + 1);
+		}
+		break;
+
+	default:
+		reader->error = -EBADMSG;
+		break;
+	}
+}
+
+static wpan_ipc_value_t
+get_value(struct reader_s* reader)
+{
+	wpan_ipc_value_t value = { reader->ptr, 0 };
+
+	skip_value_payload(reader, get_u8(reader), 0);
+
+	if (!reader->error) {
+		value.len = (size_t)(reader->ptr - value.ptr);
+	}
+
+	return value;
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Transport
+
+static int64_t
+time_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int
+send_request(wpan_ipc_client_t* client, uint8_t type, const struct buffer_s* body, uint32_t* id)
+{
+	struct buffer_s frame = { 0 };
+	size_t sent = 0;
+	int ret = 0;
+
+	if (body->error) {
+		return body->error;
+	}
+
+	*id = ++client->last_id;
+
+	put_u32(&frame, (uint32_t)(WPAN_IPC_HEADER_SIZE - 4 + body->len));
+	put_u8(&frame, type);
+	put_u32(&frame, *id);
+	buffer_append(&frame, body->ptr, body->len);
+
+	ret = frame.error;
+
+	while (!ret && (sent < frame.len)) {
+		ssize_t len = send(client->fd, frame.ptr + sent, frame.len - sent, MSG_NOSIGNAL);
+
+		if (len < 0) {
+			if (errno != EINTR) {
+				ret = -errno;
+			}
+		} else {
+			sent += (size_t)len;
+		}
+	}
+
+	free(frame.ptr);
+
+	return ret;
+}
+
+// Reads the next frame, waiting until `deadline` (from time_ms()) at most.
+static int
+read_frame(wpan_ipc_client_t* client, int64_t deadline, uint8_t* type, uint32_t* id, struct reader_s* body)
+{
+	if (client->rx_consumed) {
+		memmove(client->rx_buffer, client->rx_buffer + client->rx_consumed, client->rx_len - client->rx_consumed);
+		client->rx_len -= client->rx_consumed;
+		client->rx_consumed = 0;
+	}
+
+	while (1) {
+		struct pollfd pfd = { client->fd, POLLIN, 0 };
+		int64_t timeout;
+		ssize_t len;
+
+		if (client->rx_len >= 4) {
+			struct reader_s reader = { client->rx_buffer, client->rx_len, 0 };
+			uint32_t frame_len = get_u32(&reader);
+
+			if ((frame_len < WPAN_IPC_HEADER_SIZE - 4) || (frame_len > WPAN_IPC_MAX_FRAME_SIZE)) {
+				return -EBADMSG;
+			}
+
+			if (client->rx_len >= 4 + frame_len) {
+				*type = get_u8(&reader);
+				*id = get_u32(&reader);
+				body->ptr = reader.ptr;
+				body->len = frame_len - (WPAN_IPC_HEADER_SIZE - 4);
+				body->error = 0;
+				client->rx_consumed = 4 + frame_len;
+				return 0;
+			}
+
+			if (client->rx_size < 4 + frame_len) {
+				uint8_t* new_buffer = realloc(client->rx_buffer, 4 + frame_len);
+
+				if (new_buffer == NULL) {
+					return -ENOMEM;
+				}
+
+				client->rx_buffer = new_buffer;
+				client->rx_size = 4 + frame_len;
+			}
+		}
+
+		if (client->rx_len == client->rx_size) {
+			uint8_t* new_buffer = realloc(client->rx_buffer, client->rx_size + 4096);
+
+			if (new_buffer == NULL) {
+				return -ENOMEM;
+			}
+
+			client->rx_buffer = new_buffer;
+			client->rx_size += 4096;
+		}
+
+		timeout = deadline - time_ms();
+
+		if (timeout < 0) {
+			return -ETIMEDOUT;
+		}
+
+		if (poll(&pfd, 1, (int)timeout) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+
+		len = read(client->fd, client->rx_buffer + client->rx_len, client->rx_size - client->rx_len);
+
+		if (len == 0) {
+			return -ECONNRESET;
+		}
+
+		if (len < 0) {
+			if ((errno == EAGAIN) || (errno == EINTR)) {
+				continue;
+			}
+			return -errno;
+		}
+
+		client->rx_len += (size_t)len;
+	}
+}
+
+static int
+handle_event(wpan_ipc_client_t* client, struct reader_s* body)
+{
+	char* iface = get_string(body);
+	char* key = get_string(body);
+	wpan_ipc_value_t value = get_value(body);
+	int ret = body->error;
+
+	if (!ret && (client->event_cb != NULL)) {
+		client->event_cb(client->event_context, iface, key, &value);
+	}
+
+	free(iface);
+	free(key);
+
+	return ret;
+}
+
+// Waits for the reply to request `id`, handing any events which
+// arrive in the meantime to the event handler.
+static int
+wait_for_reply(wpan_ipc_client_t* client, uint32_t id, uint8_t* type, struct reader_s* body)
+{
+	int64_t deadline = time_ms() + client->timeout_ms;
+	uint32_t frame_id;
+	int ret;
+
+	while ((ret = read_frame(client, deadline, type, &frame_id, body)) == 0) {
+		if (*type == WPAN_IPC_MSG_EVENT) {
+			ret = handle_event(client, body);
+
+			if (ret) {
+				break;
+			}
+		} else if (frame_id == id) {
+			break;
+		}
+	}
+
+	return ret;
+}
+
+// Sends a request whose reply is a plain RESULT.
+static int
+simple_request(wpan_ipc_client_t* client, uint8_t msg_type, const struct buffer_s* request, int* status, wpan_ipc_value_t* value)
+{
+	struct reader_s body;
+	uint8_t type;
+	uint32_t id;
+	int ret;
+
+	ret = send_request(client, msg_type, request, &id);
+
+	if (!ret) {
+		ret = wait_for_reply(client, id, &type, &body);
+	}
+
+	if (!ret) {
+		if (type != WPAN_IPC_MSG_RESULT) {
+			return -EBADMSG;
+		}
+
+		*status = (int32_t)get_u32(&body);
+
+		if (value != NULL) {
+			*value = get_value(&body);
+		}
+
+		ret = body.error;
+	}
+
+	return ret;
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Public API
+
+wpan_ipc_client_t*
+wpan_ipc_client_open(const char* socket_path)
+{
+	wpan_ipc_client_t* client = NULL;
+	struct sockaddr_un addr;
+	int fd = -1;
+
+	if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		goto bail;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		goto bail;
+	}
+
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		goto bail;
+	}
+
+	client = calloc(1, sizeof(*client));
+
+	if (client == NULL) {
+		goto bail;
+	}
+
+	client->fd = fd;
+	client->timeout_ms = DEFAULT_TIMEOUT_MS;
+
+	return client;
+
+bail:
+	if (fd >= 0) {
+		int err = errno;
+		close(fd);
+		errno = err;
+	}
+
+	return NULL;
+}
+
+void
+wpan_ipc_client_close(wpan_ipc_client_t* client)
+{
+	if (client != NULL) {
+		close(client->fd);
+		free(client->rx_buffer);
+		free(client);
+	}
+}
+
+void
+wpan_ipc_client_set_timeout(wpan_ipc_client_t* client, int timeout_ms)
+{
+	client->timeout_ms = timeout_ms;
+}
+
+void
+wpan_ipc_client_set_event_handler(wpan_ipc_client_t* client, wpan_ipc_event_cb cb, void* context)
+{
+	client->event_cb = cb;
+	client->event_context = context;
+}
+
+int
+wpan_ipc_client_get_fd(const wpan_ipc_client_t* client)
+{
+	return client->fd;
+}
+
+int
+wpan_ipc_get(wpan_ipc_client_t* client, const char* iface, const char* key, wpan_ipc_result_cb cb, void* context)
+{
+	struct buffer_s request = { 0 };
+	wpan_ipc_value_t value;
+	int status = 0;
+	int ret;
+
+	put_string(&request, iface);
+	put_string(&request, key);
+
+	ret = simple_request(client, WPAN_IPC_MSG_GET, &request, &status, &value);
+
+	if (!ret) {
+		cb(context, key, status, &value);
+	}
+
+	free(request.ptr);
+
+	return ret;
+}
+
+int
+wpan_ipc_get_multi(wpan_ipc_client_t* client, const char* iface, const char* const* keys, size_t key_count, wpan_ipc_result_cb cb, void* context)
+{
+	struct buffer_s request = { 0 };
+	struct reader_s body;
+	uint8_t type;
+	uint32_t id;
+	size_t i;
+	int ret;
+
+	put_string(&request, iface);
+	put_u32(&request, (uint32_t)key_count);
+
+	for (i = 0; i < key_count; i++) {
+		put_string(&request, keys[i]);
+	}
+
+	ret = send_request(client, WPAN_IPC_MSG_GET_MULTI, &request, &id);
+
+	if (!ret) {
+		ret = wait_for_reply(client, id, &type, &body);
+	}
+
+	if (ret) {
+		goto bail;
+	}
+
+	if (type == WPAN_IPC_MSG_RESULT) {
+		// The whole request failed (unknown interface, for example).
+		int status = (int32_t)get_u32(&body);
+		wpan_ipc_value_t value = get_value(&body);
+
+		ret = body.error;
+
+		for (i = 0; !ret && (i < key_count); i++) {
+			cb(context, keys[i], status, &value);
+		}
+
+	} else if (type == WPAN_IPC_MSG_MULTI_RESULT) {
+		uint32_t count;
+
+		get_u32(&body); // Overall status, always zero.
+		count = get_u32(&body);
+
+		while (!body.error && count--) {
+			char* key = get_string(&body);
+			int status = (int32_t)get_u32(&body);
+			wpan_ipc_value_t value = get_value(&body);
+
+			if (!body.error) {
+				cb(context, key, status, &value);
+			}
+
+			free(key);
+		}
+
+		ret = body.error;
+
+	} else {
+		ret = -EBADMSG;
+	}
+
+bail:
+	free(request.ptr);
+
+	return ret;
+}
+
+int
+wpan_ipc_update_string(wpan_ipc_client_t* client, uint8_t type, const char* iface, const char* key, const char* value, int* status)
+{
+	struct buffer_s request = { 0 };
+	int ret;
+
+	put_string(&request, iface);
+	put_string(&request, key);
+	put_u8(&request, WPAN_IPC_VALUE_STRING);
+	put_string(&request, value);
+
+	ret = simple_request(client, type, &request, status, NULL);
+
+	free(request.ptr);
+
+	return ret;
+}
+
+int
+wpan_ipc_update_data(wpan_ipc_client_t* client, uint8_t type, const char* iface, const char* key, const uint8_t* data, size_t data_len, int* status)
+{
+	struct buffer_s request = { 0 };
+	int ret;
+
+	put_string(&request, iface);
+	put_string(&request, key);
+	put_u8(&request, WPAN_IPC_VALUE_DATA);
+	put_bytes(&request, data, data_len);
+
+	ret = simple_request(client, type, &request, status, NULL);
+
+	free(request.ptr);
+
+	return ret;
+}
+
+int
+wpan_ipc_subscribe(wpan_ipc_client_t* client, const char* iface, int* status)
+{
+	struct buffer_s request = { 0 };
+	int ret;
+
+	put_string(&request, iface);
+
+	ret = simple_request(client, WPAN_IPC_MSG_SUBSCRIBE, &request, status, NULL);
+
+	free(request.ptr);
+
+	return ret;
+}
+
+int
+wpan_ipc_unsubscribe(wpan_ipc_client_t* client, const char* iface, int* status)
+{
+	struct buffer_s request = { 0 };
+	int ret;
+
+	put_string(&request, iface);
+
+	ret = simple_request(client, WPAN_IPC_MSG_UNSUBSCRIBE, &request, status, NULL);
+
+	free(request.ptr);
+
+	return ret;
+}
+
+int
+wpan_ipc_wait_for_events(wpan_ipc_client_t* client, int timeout_ms)
+{
+	int64_t deadline = time_ms() + timeout_ms;
+	struct reader_s body;
+	uint8_t type;
+	uint32_t id;
+	int count = 0;
+	int ret;
+
+	while ((ret = read_frame(client, deadline, &type, &id, &body)) == 0) {
+		if (type == WPAN_IPC_MSG_EVENT) {
+			ret = handle_event(client, &body);
+
+			if (ret) {
+				return ret;
+			}
+
+			count++;
+		}
+	}
+
+	return (ret == -ETIMEDOUT) ? count : ret;
+}
+
+char**
+wpan_ipc_value_to_string_list(const wpan_ipc_value_t* value, size_t* count)
+{
+	struct reader_s reader = { value->ptr, value->len, 0 };
+	char** ret = NULL;
+	char* strings;
+	size_t size;
+	size_t i;
+
+	if (get_u8(&reader) != WPAN_IPC_VALUE_LIST) {
+		return NULL;
+	}
+
+	*count = get_u32(&reader);
+
+	// Every element is at least a tag and a length.
+	if (reader.error || (*count > reader.len / 5)) {
+		return NULL;
+	}
+
+	// Pointers first, followed by the strings themselves. The encoded
+	// length (less the per-element overhead) bounds the string space.
+	size = (*count * sizeof(char*)) + reader.len;
+	ret = malloc(size);
+
+	if (ret == NULL) {
+		return NULL;
+	}
+
+	strings = (char*)(ret + *count);
+
+	for (i = 0; i < *count; i++) {
+		uint32_t len;
+		const uint8_t* ptr;
+
+		if (get_u8(&reader) != WPAN_IPC_VALUE_STRING) {
+			reader.error = -EBADMSG;
+			break;
+		}
+
+		len = get_u32(&reader);
+		ptr = take(&reader, len);
+
+		if (ptr == NULL) {
+			break;
+		}
+
+		memcpy(strings, ptr, len);
+		strings[len] = 0;
+		ret[i] = strings;
+		strings += len + 1;
+	}
+
+	if (reader.error) {
+		free(ret);
+		ret = NULL;
+	}
+
+	return ret;
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Printing
+
+static void
+print_indent(FILE* file, int indent)
+{
+	while (indent-- > 0) {
+		fprintf(file, "\t");
+	}
+}
+
+// Mirrors dump_info_from_iter() in wpanctl-utils.c.
+static void
+print_value(FILE* file, struct reader_s* reader, int indent, bool bare, bool indent_first_line)
+{
+	uint8_t tag = get_u8(reader);
+	uint32_t count;
+
+	if (!bare && indent_first_line) {
+		print_indent(file, indent);
+	}
+
+	switch (tag) {
+	case WPAN_IPC_VALUE_EMPTY:
+		fprintf(file, "<empty>");
+		break;
+
+	case WPAN_IPC_VALUE_BOOL:
+		fprintf(file, "%s", get_u8(reader) ? "true" : "false");
+		break;
+
+	case WPAN_IPC_VALUE_INT:
+		fprintf(file, "%lld", (long long)(int64_t)get_u64(reader));
+		break;
+
+	case WPAN_IPC_VALUE_UINT: {
+		uint8_t width = get_u8(reader);
+		unsigned long long value = get_u64(reader);
+
+		switch (width) {
+		case 1: fprintf(file, "0x%02llX", value); break;
+		case 2: fprintf(file, "0x%04llX", value); break;
+		case 8: fprintf(file, "0x%016llX", value); break;
+		default: fprintf(file, "%llu", value); break;
+		}
+		break;
+	}
+
+	case WPAN_IPC_VALUE_DOUBLE: {
+		uint64_t bits = get_u64(reader);
+		double value;
+
+		memcpy(&value, &bits, sizeof(value));
+		fprintf(file, "%g", value);
+		break;
+	}
+
+	case WPAN_IPC_VALUE_STRING: {
+		char* string = get_string(reader);
+
+		fprintf(file, "\"%s\"", string ? string : "");
+		free(string);
+		break;
+	}
+
+	case WPAN_IPC_VALUE_DATA: {
+		const uint8_t* ptr;
+
+		count = get_u32(reader);
+		ptr = take(reader, count);
+
+		fprintf(file, "[");
+		while (ptr && count--) {
+			fprintf(file, "%02X", *ptr++);
+		}
+		fprintf(file, "]");
+		break;
+	}
+
+	case WPAN_IPC_VALUE_LIST:
+		count = get_u32(reader);
+
+		fprintf(file, count ? "[\n" : "[");
+
+		if (count == 0) {
+			indent = 0;
+		}
+
+		while (!reader->error && count--) {
+			print_value(file, reader, indent + 1, false, true);
+		}
+
+		print_indent(file, indent);
+		fprintf(file, "]");
+		break;
+
+	case WPAN_IPC_VALUE_MAP:
+		count = get_u32(reader);
+
+		fprintf(file, count ? "[\n" : "[");
+
+		if (count == 0) {
+			indent = 0;
+		}
+
+		while (!reader->error && count--) {
+			char* key = get_string(reader);
+
+			print_indent(file, indent + 1);
+			fprintf(file, "\"%s\" => ", key ? key : "");
+			print_value(file, reader, indent + 2, false, false);
+			free(key);
+		}
+
+		print_indent(file, indent);
+		fprintf(file, "]");
+		break;
+
+	default:
+		fprintf(file, "<unknown>");
+		reader->error = -EBADMSG;
+		break;
+	}
+
+	if (!bare) {
+		fprintf(file, "\n");
+	}
+}
+
+void
+wpan_ipc_value_print(FILE* file, const wpan_ipc_value_t* value)
+{
+	struct reader_s reader = { value->ptr, value->len, 0 };
+
+	print_value(file, &reader, 0, false, false);
+}
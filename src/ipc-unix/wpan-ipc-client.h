@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Blocking C client for wpantund's Unix-domain IPC socket.
+ *
+ *      All calls return zero on success or a negative `errno` value if
+ *      talking to wpantund failed. The wpantund status of the request
+ *      itself (a `wpantund_status_t`) is returned through `status`.
+ *
+ *      Values handed to callbacks point into the client's receive
+ *      buffer and are only valid until the callback returns.
+ *
+ */
+
+#ifndef wpantund_wpan_ipc_client_h
+#define wpantund_wpan_ipc_client_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "wpan-ipc-unix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct wpan_ipc_client_s wpan_ipc_client_t;
+
+// An encoded value, starting with its WPAN_IPC_VALUE_* tag.
+typedef struct {
+	const uint8_t* ptr;
+	size_t len;
+} wpan_ipc_value_t;
+
+typedef void (*wpan_ipc_result_cb)(void* context, const char* key, int status, const wpan_ipc_value_t* value);
+typedef void (*wpan_ipc_event_cb)(void* context, const char* iface, const char* key, const wpan_ipc_value_t* value);
+
+wpan_ipc_client_t* wpan_ipc_client_open(const char* socket_path);
+void wpan_ipc_client_close(wpan_ipc_client_t* client);
+
+// Milliseconds to wait for each reply. Defaults to 10 seconds.
+void wpan_ipc_client_set_timeout(wpan_ipc_client_t* client, int timeout_ms);
+
+// Called for every property change event received, including
+// events which arrive while waiting for the reply to a request.
+void wpan_ipc_client_set_event_handler(wpan_ipc_client_t* client, wpan_ipc_event_cb cb, void* context);
+
+int wpan_ipc_client_get_fd(const wpan_ipc_client_t* client);
+
+// `cb` is called once with the value (`key` is the requested key).
+int wpan_ipc_get(wpan_ipc_client_t* client, const char* iface, const char* key, wpan_ipc_result_cb cb, void* context);
+
+// `cb` is called once per key, in the order given.
+int wpan_ipc_get_multi(wpan_ipc_client_t* client, const char* iface, const char* const* keys, size_t key_count, wpan_ipc_result_cb cb, void* context);
+
+// `type` is WPAN_IPC_MSG_SET, WPAN_IPC_MSG_INSERT or WPAN_IPC_MSG_REMOVE.
+// `value` is sent as a string, which wpantund converts as needed.
+int wpan_ipc_update_string(wpan_ipc_client_t* client, uint8_t type, const char* iface, const char* key, const char* value, int* status);
+int wpan_ipc_update_data(wpan_ipc_client_t* client, uint8_t type, const char* iface, const char* key, const uint8_t* data, size_t data_len, int* status);
+
+int wpan_ipc_subscribe(wpan_ipc_client_t* client, const char* iface, int* status);
+int wpan_ipc_unsubscribe(wpan_ipc_client_t* client, const char* iface, int* status);
+
+// Waits up to `timeout_ms` for events and hands them to the event
+// handler. Returns the number of events handled.
+int wpan_ipc_wait_for_events(wpan_ipc_client_t* client, int timeout_ms);
+
+// Copies a list of strings out of `value`. The result is a single
+// allocation, to be released with free(). Returns NULL if `value`
+// isn't a list of strings.
+char** wpan_ipc_value_to_string_list(const wpan_ipc_value_t* value, size_t* count);
+
+// Prints `value` in the same format as `wpanctl getprop`.
+void wpan_ipc_value_print(FILE* file, const wpan_ipc_value_t* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
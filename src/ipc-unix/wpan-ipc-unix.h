@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Binary protocol spoken over wpantund's Unix-domain IPC socket.
+ *
+ *      Every message is a frame:
+ *
+ *          u32 length      Number of bytes which follow
+ *          u8  type        WPAN_IPC_MSG_*
+ *          u32 id          Chosen by the client, echoed in the reply.
+ *                          Always zero for events.
+ *          ... body
+ *
+ *      All integers are little-endian. A "str" is a u32 length followed
+ *      by that many bytes (no terminating NUL). A "value" is a u8
+ *      WPAN_IPC_VALUE_* tag followed by the payload for that tag.
+ *      Unsigned values carry the byte width of the property's native
+ *      type, so that clients can format them the way `wpanctl` does.
+ *
+ *      Requests (client to wpantund):
+ *
+ *          GET             str iface, str key
+ *          SET             str iface, str key, value
+ *          INSERT          str iface, str key, value
+ *          REMOVE          str iface, str key, value
+ *          GET_MULTI       str iface, u32 count, str key[count]
+ *          SUBSCRIBE       str iface
+ *          UNSUBSCRIBE     str iface
+ *          LIST_INTERFACES (no body)
+ *
+ *      Replies and events (wpantund to client):
+ *
+ *          RESULT          i32 status, value
+ *          MULTI_RESULT    i32 status, u32 count,
+ *                          { str key, i32 status, value }[count]
+ *          EVENT           str iface, str key, value
+ *
+ *      Every request gets exactly one RESULT, except GET_MULTI which
+ *      gets a MULTI_RESULT with its keys in the order they were asked
+ *      for. Events for subscribed interfaces may arrive at any time,
+ *      including between a request and its reply.
+ *
+ *      The socket is only accessible to its owner and group. Of those,
+ *      only root and the user wpantund runs as may SET, INSERT or
+ *      REMOVE; anybody else gets `kWPANTUNDStatus_PermissionDenied`.
+ *
+ */
+
+#ifndef wpantund_wpan_ipc_unix_h
+#define wpantund_wpan_ipc_unix_h
+
+#define WPAN_IPC_DEFAULT_SOCKET_PATH    "/var/run/wpantund.sock"
+
+#define WPAN_IPC_HEADER_SIZE            (4 + 1 + 4)
+
+// Larger frames are treated as a protocol error.
+#define WPAN_IPC_MAX_FRAME_SIZE         (1024 * 1024)
+
+#define WPAN_IPC_MSG_GET                0x01
+#define WPAN_IPC_MSG_SET                0x02
+#define WPAN_IPC_MSG_INSERT             0x03
+#define WPAN_IPC_MSG_REMOVE             0x04
+#define WPAN_IPC_MSG_GET_MULTI          0x05
+#define WPAN_IPC_MSG_SUBSCRIBE          0x06
+#define WPAN_IPC_MSG_UNSUBSCRIBE        0x07
+#define WPAN_IPC_MSG_LIST_INTERFACES    0x08
+
+#define WPAN_IPC_MSG_RESULT             0x81
+#define WPAN_IPC_MSG_MULTI_RESULT       0x82
+#define WPAN_IPC_MSG_EVENT              0x83
+
+#define WPAN_IPC_VALUE_EMPTY            0x00    // (no payload)
+#define WPAN_IPC_VALUE_BOOL             0x01    // u8
+#define WPAN_IPC_VALUE_INT              0x02    // i64
+#define WPAN_IPC_VALUE_UINT             0x03    // u8 width, u64
+#define WPAN_IPC_VALUE_DOUBLE           0x04    // IEEE 754 binary64
+#define WPAN_IPC_VALUE_STRING           0x05    // str
+#define WPAN_IPC_VALUE_DATA             0x06    // u32 length, bytes
+#define WPAN_IPC_VALUE_LIST             0x07    // u32 count, value[count]
+#define WPAN_IPC_VALUE_MAP              0x08    // u32 count, { str key, value }[count]
+
+#endif
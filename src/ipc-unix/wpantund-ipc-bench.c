@@ -0,0 +1,275 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Compares the round-trip latency of fetching a property over
+ *      D-Bus with fetching it over the Unix-domain IPC socket.
+ *
+ *      Usage: wpantund-ipc-bench [-I iface] [-U socket-path]
+ *                                [-n count] [property-name]
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dbus/dbus.h>
+
+#include "wpan-dbus-v0.h"
+#include "wpan-dbus-v1.h"
+#include "wpan-ipc-client.h"
+
+typedef int (*bench_fn)(void* context);
+
+struct dbus_bench_s {
+	DBusConnection* connection;
+	DBusMessage* message;
+};
+
+struct ipc_bench_s {
+	wpan_ipc_client_t* client;
+	const char* iface;
+	const char* key;
+	int status;
+};
+
+static uint64_t
+time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int
+compare_u64(const void* a, const void* b)
+{
+	uint64_t lhs = *(const uint64_t*)a;
+	uint64_t rhs = *(const uint64_t*)b;
+
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static int
+dbus_get(void* context)
+{
+	struct dbus_bench_s* bench = context;
+	DBusMessage* reply;
+	DBusError error;
+	int32_t status = -1;
+
+	dbus_error_init(&error);
+
+	reply = dbus_connection_send_with_reply_and_block(bench->connection, bench->message, 10 * 1000, &error);
+
+	if (reply == NULL) {
+		fprintf(stderr, "error: %s\n", error.message);
+		dbus_error_free(&error);
+		return -1;
+	}
+
+	dbus_message_get_args(reply, NULL, DBUS_TYPE_INT32, &status, DBUS_TYPE_INVALID);
+	dbus_message_unref(reply);
+
+	return status;
+}
+
+static void
+ipc_result(void* context, const char* key, int status, const wpan_ipc_value_t* value)
+{
+	struct ipc_bench_s* bench = context;
+
+	(void)key;
+	(void)value;
+
+	bench->status = status;
+}
+
+static int
+ipc_get(void* context)
+{
+	struct ipc_bench_s* bench = context;
+	int ret;
+
+	ret = wpan_ipc_get(bench->client, bench->iface, bench->key, &ipc_result, bench);
+
+	if (ret) {
+		fprintf(stderr, "error: %s\n", strerror(-ret));
+		return -1;
+	}
+
+	return bench->status;
+}
+
+static int
+run(const char* name, bench_fn fn, void* context, int count)
+{
+	uint64_t* samples = calloc((size_t)count, sizeof(*samples));
+	uint64_t total = 0;
+	int ret = 0;
+	int i;
+
+	if (samples == NULL) {
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		uint64_t start = time_ns();
+
+		ret = fn(context);
+		samples[i] = time_ns() - start;
+		total += samples[i];
+
+		if (ret) {
+			fprintf(stderr, "%s: request %d failed (%d)\n", name, i, ret);
+			goto bail;
+		}
+	}
+
+	qsort(samples, (size_t)count, sizeof(*samples), &compare_u64);
+
+	printf("%-8s n=%-6d min=%8.1fus avg=%8.1fus median=%8.1fus p99=%8.1fus max=%8.1fus\n",
+		name,
+		count,
+		samples[0] / 1000.0,
+		(total / (double)count) / 1000.0,
+		samples[count / 2] / 1000.0,
+		samples[(count * 99) / 100] / 1000.0,
+		samples[count - 1] / 1000.0
+	);
+
+bail:
+	free(samples);
+
+	return ret;
+}
+
+int
+main(int argc, char* argv[])
+{
+	const char* iface = "wpan0";
+	const char* socket_path = WPAN_IPC_DEFAULT_SOCKET_PATH;
+	const char* key = "NCP:State";
+	int count = 1000;
+	char path[DBUS_MAXIMUM_NAME_LENGTH + 1];
+	struct dbus_bench_s dbus_bench = { 0 };
+	struct ipc_bench_s ipc_bench = { 0 };
+	DBusError error;
+	int ret = EXIT_FAILURE;
+	int c;
+
+	dbus_error_init(&error);
+
+	while ((c = getopt(argc, argv, "I:U:n:h")) != -1) {
+		switch (c) {
+		case 'I':
+			iface = optarg;
+			break;
+
+		case 'U':
+			socket_path = optarg;
+			break;
+
+		case 'n':
+			count = atoi(optarg);
+			break;
+
+		default:
+			fprintf(stderr, "usage: %s [-I iface] [-U socket-path] [-n count] [property-name]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc) {
+		key = argv[optind];
+	}
+
+	if (count <= 0) {
+		count = 1;
+	}
+
+	// D-Bus, addressed to wpantund's well-known bus name.
+	dbus_bench.connection = dbus_bus_get(DBUS_BUS_STARTER, &error);
+
+	if (dbus_bench.connection == NULL) {
+		dbus_error_free(&error);
+		dbus_error_init(&error);
+		dbus_bench.connection = dbus_bus_get(DBUS_BUS_SYSTEM, &error);
+	}
+
+	if (dbus_bench.connection == NULL) {
+		fprintf(stderr, "error: %s\n", error.message);
+		goto bail;
+	}
+
+	snprintf(path, sizeof(path), "%s/%s", WPANTUND_DBUS_PATH, iface);
+
+	dbus_bench.message = dbus_message_new_method_call(
+		WPAN_TUNNEL_DBUS_NAME,
+		path,
+		WPANTUND_DBUS_APIv1_INTERFACE,
+		WPANTUND_IF_CMD_PROP_GET
+	);
+
+	dbus_message_append_args(dbus_bench.message, DBUS_TYPE_STRING, &key, DBUS_TYPE_INVALID);
+
+	// Unix-domain socket.
+	ipc_bench.client = wpan_ipc_client_open(socket_path);
+	ipc_bench.iface = iface;
+	ipc_bench.key = key;
+
+	if (ipc_bench.client == NULL) {
+		fprintf(stderr, "error: Unable to connect to \"%s\": %s\n", socket_path, strerror(errno));
+		goto bail;
+	}
+
+	printf("Fetching \"%s\" from %s, %d times each\n", key, iface, count);
+
+	if (run("dbus", &dbus_get, &dbus_bench, count) != 0) {
+		goto bail;
+	}
+
+	if (run("unix", &ipc_get, &ipc_bench, count) != 0) {
+		goto bail;
+	}
+
+	ret = EXIT_SUCCESS;
+
+bail:
+	if (dbus_bench.message) {
+		dbus_message_unref(dbus_bench.message);
+	}
+
+	if (dbus_bench.connection) {
+		dbus_connection_unref(dbus_bench.connection);
+	}
+
+	wpan_ipc_client_close(ipc_bench.client);
+
+	dbus_error_free(&error);
+
+	return ret;
+}
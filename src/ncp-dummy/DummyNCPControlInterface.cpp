@@ -183,6 +183,15 @@ DummyNCPControlInterface::joiner_add(
 	cb(kWPANTUNDStatus_FeatureNotImplemented);
 }
 
+void
+DummyNCPControlInterface::joiner_add_bulk(
+	const std::list<std::string>& joiners,
+	uint32_t joiner_timeout,
+	CallbackWithStatusArg1 cb
+) {
+	cb(kWPANTUNDStatus_FeatureNotImplemented, boost::any());
+}
+
 void
 DummyNCPControlInterface::permit_join(
 	int seconds,
@@ -168,6 +168,12 @@ public:
 		CallbackWithStatus cb = NilReturn()
 	);
 
+	virtual void joiner_add_bulk(
+		const std::list<std::string>& joiners,
+		uint32_t joiner_timeout,
+		CallbackWithStatusArg1 cb = NilReturn()
+	);
+
 	virtual void data_poll(
 		CallbackWithStatus cb = NilReturn()
 	);
@@ -55,6 +55,7 @@
 #include "SpinelNCPTaskDeepSleep.h"
 #include "SpinelNCPTaskHostDidWake.h"
 #include "SpinelNCPTaskSendCommand.h"
+#include "SpinelNCPTaskJoinerAddBulk.h"
 
 using namespace nl;
 using namespace nl::wpantund;
@@ -75,6 +76,82 @@ SpinelNCPControlInterface::join(
 	const ValueMap& options,
 	CallbackWithStatus cb
 ) {
+	SpinelNCPScanMatch match;
+
+	// Without a channel, look for the network first. The scan stops at
+	// the first matching beacon and starts with the channels on which
+	// that network was last heard.
+	if ((!options.count(kWPANTUNDProperty_NCPChannel) || (any_to_int(options.at(kWPANTUNDProperty_NCPChannel)) == 0))
+	 && !ncp_state_is_associated(mNCPInstance->get_ncp_state())
+	) {
+		if (options.count(kWPANTUNDProperty_NetworkName)) {
+			match.mNetworkName = any_to_string(options.at(kWPANTUNDProperty_NetworkName));
+		}
+
+		if (options.count(kWPANTUNDProperty_NetworkXPANID)) {
+			match.mXPANID = any_to_uint64(options.at(kWPANTUNDProperty_NetworkXPANID));
+			match.mHasXPANID = (match.mXPANID != 0);
+		}
+
+		if (options.count(kWPANTUNDProperty_NetworkPANID)) {
+			match.mPANID = static_cast<uint16_t>(any_to_int(options.at(kWPANTUNDProperty_NetworkPANID)));
+		}
+	}
+
+	if (match.is_empty()) {
+		mNCPInstance->start_new_task(boost::shared_ptr<SpinelNCPTask>(
+			new SpinelNCPTaskJoin(
+				mNCPInstance,
+				boost::bind(cb,_1),
+				options
+			)
+		));
+
+	} else {
+		mNCPInstance->start_new_task(boost::shared_ptr<SpinelNCPTask>(
+			new SpinelNCPTaskScan(
+				mNCPInstance,
+				boost::bind(&SpinelNCPControlInterface::join_after_scan, this, options, cb, _1, _2),
+				mNCPInstance->get_default_channel_mask(),
+				SpinelNCPTaskScan::kDefaultScanPeriod,
+				SpinelNCPTaskScan::kScanTypeNet,
+				false,
+				false,
+				0xffff,
+				match
+			)
+		));
+	}
+}
+
+void
+SpinelNCPControlInterface::join_after_scan(
+	ValueMap options,
+	CallbackWithStatus cb,
+	int status,
+	const boost::any& value
+) {
+	if (!value.empty()) {
+		const WPAN::NetworkInstance network(boost::any_cast<WPAN::NetworkInstance>(value));
+
+		options[kWPANTUNDProperty_NCPChannel] = static_cast<int>(network.channel);
+
+		if (!options.count(kWPANTUNDProperty_NetworkPANID)
+		 || (any_to_int(options[kWPANTUNDProperty_NetworkPANID]) == 0xFFFF)
+		) {
+			options[kWPANTUNDProperty_NetworkPANID] = network.panid;
+		}
+
+		if (!options.count(kWPANTUNDProperty_NetworkXPANID)
+		 || (any_to_uint64(options[kWPANTUNDProperty_NetworkXPANID]) == 0)
+		) {
+			options[kWPANTUNDProperty_NetworkXPANID] = network.get_xpanid_as_uint64();
+		}
+
+	} else {
+		syslog(LOG_NOTICE, "Join: Network not found by scan (status %d), joining with the given settings", status);
+	}
+
 	mNCPInstance->start_new_task(boost::shared_ptr<SpinelNCPTask>(
 		new SpinelNCPTaskJoin(
 			mNCPInstance,
@@ -115,16 +192,16 @@ SpinelNCPControlInterface::attach(CallbackWithStatus cb)
 	mNCPInstance->start_new_task(
 		SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 			.set_callback(cb)
-			.add_command(SpinelPackData(
+			.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_NET_IF_UP,
 				true
-			))
-			.add_command(SpinelPackData(
+			)
+			.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_NET_STACK_UP,
 				true
-			))
+			)
 			.finish()
 	);
 }
@@ -138,7 +215,7 @@ SpinelNCPControlInterface::reset(CallbackWithStatus cb)
 
 	mNCPInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 		.set_callback(CallbackWithStatus(boost::bind(cb,kWPANTUNDStatus_Ok)))
-		.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_RESET))
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_RESET)
 		.finish()
 	);
 }
@@ -173,7 +250,7 @@ SpinelNCPControlInterface::refresh_state(CallbackWithStatus cb)
 {
 	mNCPInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 		.set_callback(cb)
-		.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_NOOP))
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_NOOP)
 		.finish()
 	);
 }
@@ -183,7 +260,7 @@ SpinelNCPControlInterface::data_poll(CallbackWithStatus cb)
 {
 	mNCPInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 		.set_callback(cb)
-		.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_STREAM_NET))
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_STREAM_NET)
 		.finish()
 	);
 }
@@ -294,7 +371,7 @@ SpinelNCPControlInterface::joiner_add(
 	if (addr) {
 		mNCPInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 			.set_callback(cb)
-			.add_command(SpinelPackData(
+			.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
 					SPINEL_DATATYPE_UTF8_S
 					SPINEL_DATATYPE_UINT32_S
@@ -304,14 +381,14 @@ SpinelNCPControlInterface::joiner_add(
 				psk,
 				joiner_timeout,
 				addr
-			))
+			)
 			.finish()
 		);
 	}
 	else {
 		mNCPInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 			.set_callback(cb)
-			.add_command(SpinelPackData(
+			.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
 					SPINEL_DATATYPE_UTF8_S
 					SPINEL_DATATYPE_UINT32_S
@@ -319,7 +396,7 @@ SpinelNCPControlInterface::joiner_add(
 				SPINEL_PROP_THREAD_JOINERS,
 				psk,
 				joiner_timeout
-			))
+			)
 			.finish()
 		);
 	}
@@ -328,6 +405,27 @@ bail:
 	return;
 }
 
+void
+SpinelNCPControlInterface::joiner_add_bulk(
+		const std::list<std::string>& joiners,
+		uint32_t joiner_timeout,
+		CallbackWithStatusArg1 cb
+) {
+	require_action(mNCPInstance->mEnabled, bail, cb(kWPANTUNDStatus_InvalidWhenDisabled, boost::any()));
+
+	mNCPInstance->start_new_task(boost::shared_ptr<SpinelNCPTask>(
+		new SpinelNCPTaskJoinerAddBulk(
+			mNCPInstance,
+			cb,
+			joiners,
+			joiner_timeout
+		)
+	));
+
+bail:
+	return;
+}
+
 void
 SpinelNCPControlInterface::handle_permit_join_timeout(Timer *timer, int seconds)
 {
@@ -374,11 +472,11 @@ SpinelNCPControlInterface::permit_join(
 	factory.set_callback(cb);
 
 	if (seconds > 0) {
-		factory.add_command(SpinelPackData(
+		factory.add_packed_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S),
 			SPINEL_PROP_THREAD_ASSISTING_PORTS,
 			ntohs(traffic_port)
-		));
+		);
 
 		memcpy(steering_data_addr, mNCPInstance->mSteeringDataAddress, sizeof(steering_data_addr));
 
@@ -387,10 +485,10 @@ SpinelNCPControlInterface::permit_join(
 
 	} else {
 
-		factory.add_command(SpinelPackData(
+		factory.add_packed_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_NULL_S),
 			SPINEL_PROP_THREAD_ASSISTING_PORTS
-		));
+		);
 
 		memset(steering_data_addr, 0, sizeof(steering_data_addr));
 
@@ -398,11 +496,11 @@ SpinelNCPControlInterface::permit_join(
 	}
 
 	if (should_update_steering_data) {
-			factory.add_command(SpinelPackData(
+			factory.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_EUI64_S),
 				SPINEL_PROP_THREAD_STEERING_DATA,
 				steering_data_addr
-			));
+			);
 	}
 
 	mNCPInstance->start_new_task(factory.finish());
@@ -443,6 +541,7 @@ SpinelNCPControlInterface::netscan_start(
 	bool joiner_flag = false;          // Scan for joiner only devices (used in discover scan).
 	bool enable_filtering = false;     // Enable scan result filtering (used in discover scan).
 	uint16_t pan_id_filter = 0xffff;   // PANID used for filtering, 0xFFFF to disable (used in discover scan.)
+	SpinelNCPScanMatch match;
 
 	// Channel mask
 	if (options.count(kWPANTUNDValueMapKey_Scan_ChannelMask)) {
@@ -478,6 +577,24 @@ SpinelNCPControlInterface::netscan_start(
 		scan_period = SpinelNCPTaskScan::kDefaultScanPeriod;
 	}
 
+	// Match predicate, for a scan that stops at the first matching network
+	if (options.count(kWPANTUNDValueMapKey_Scan_MatchNetworkName)) {
+		match.mNetworkName = any_to_string(options.at(kWPANTUNDValueMapKey_Scan_MatchNetworkName));
+	}
+
+	if (options.count(kWPANTUNDValueMapKey_Scan_MatchXPANID)) {
+		match.mXPANID = any_to_uint64(options.at(kWPANTUNDValueMapKey_Scan_MatchXPANID));
+		match.mHasXPANID = true;
+	}
+
+	if (options.count(kWPANTUNDValueMapKey_Scan_MatchPANID)) {
+		match.mPANID = static_cast<uint16_t>(any_to_int(options.at(kWPANTUNDValueMapKey_Scan_MatchPANID)));
+	}
+
+	if (options.count(kWPANTUNDValueMapKey_Scan_MatchMinRSSI)) {
+		match.mMinRSSI = any_to_int(options.at(kWPANTUNDValueMapKey_Scan_MatchMinRSSI));
+	}
+
 	mNCPInstance->start_new_task(boost::shared_ptr<SpinelNCPTask>(
 		new SpinelNCPTaskScan(
 			mNCPInstance,
@@ -487,7 +604,8 @@ SpinelNCPControlInterface::netscan_start(
 			scan_type,
 			joiner_flag,
 			enable_filtering,
-			pan_id_filter
+			pan_id_filter,
+			match
 		)
 	));
 }
@@ -539,11 +657,11 @@ SpinelNCPControlInterface::mfg(
 	mNCPInstance->start_new_task(
 		SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 			.set_callback(cb)
-			.add_command(SpinelPackData(
+			.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UTF8_S),
 				SPINEL_PROP_NEST_STREAM_MFG,
 				mfg_command.c_str()
-			))
+			)
 			.set_reply_format(SPINEL_DATATYPE_UTF8_S)
 			.finish()
 	);
@@ -650,7 +768,7 @@ SpinelNCPControlInterface::poke(uint32_t address, Data bytes, CallbackWithStatus
 		mNCPInstance->start_new_task(
 			SpinelNCPTaskSendCommand::Factory(mNCPInstance)
 				.set_callback(cb)
-				.add_command(SpinelPackData(
+				.add_packed_command(
 					SPINEL_FRAME_PACK_CMD(
 						SPINEL_DATATYPE_UINT32_S   // Address
 						SPINEL_DATATYPE_UINT16_S   // Count
@@ -661,7 +779,7 @@ SpinelNCPControlInterface::poke(uint32_t address, Data bytes, CallbackWithStatus
 					bytes.size(),
 					bytes.data(),
 					bytes.size()
-				))
+				)
 				.finish()
 		);
 	} else {
@@ -170,6 +170,12 @@ public:
 		CallbackWithStatus cb = NilReturn()
 	);
 
+	virtual void joiner_add_bulk(
+		const std::list<std::string>& joiners,
+		uint32_t joiner_timeout,
+		CallbackWithStatusArg1 cb = NilReturn()
+	);
+
 	virtual void data_poll(
 		CallbackWithStatus cb = NilReturn()
 	);
@@ -201,6 +207,7 @@ public:
 
 private:
 	void handle_permit_join_timeout(Timer *timer, int seconds);
+	void join_after_scan(ValueMap options, CallbackWithStatus cb, int status, const boost::any& value);
 
 	SpinelNCPInstance *mNCPInstance;
 	Timer mPermitJoinTimer;
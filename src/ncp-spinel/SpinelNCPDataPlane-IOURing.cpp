@@ -0,0 +1,515 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      io_uring backend of the data-plane thread.
+ *
+ *      Instead of waiting in `poll()` and then calling `read()` or
+ *      `write()` on whatever is ready, the thread keeps reads posted
+ *      on the tunnel (several at once), the serial port and its wake
+ *      pipe, all into registered buffers. Packets for the tunnel are
+ *      queued as writes and go out together with everything else in
+ *      the single `io_uring_enter()` call which also waits for the
+ *      next completion.
+ *
+ *      The serial port is a byte stream, so it only ever has one read
+ *      and one write outstanding, to keep the bytes in order.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "SpinelNCPDataPlane.h"
+#include "assert-macros.h"
+#include "io-uring.h"
+#include "socket-utils.h"
+#include <syslog.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+
+using namespace nl;
+using namespace nl::wpantund;
+
+#if IO_URING_SUPPORTED
+
+// Number of reads kept posted on the tunnel
+#define IO_URING_TUNNEL_READS       4
+
+// Number of packets which may be on their way into the tunnel. The
+// thread stops decoding frames from the NCP while all are taken.
+#define IO_URING_TUNNEL_WRITES      8
+
+#define IO_URING_SERIAL_READ_SIZE   2048
+
+#define IO_URING_ENTRIES            32
+
+enum {
+	kOpWakeRead,
+	kOpSerialRead,
+	kOpSerialWrite,
+	kOpTunnelRead,
+	kOpTunnelWrite,
+
+	// Polls linked ahead of a read or write, for kernels which
+	// complete I/O on non-blocking descriptors with `EAGAIN`.
+	kOpWakePoll,
+	kOpSerialReadPoll,
+	kOpSerialWritePoll,
+	kOpTunnelReadPoll,
+
+	kOpCancel,
+};
+
+// Indexes of the registered buffers
+enum {
+	kBufferWake,
+	kBufferSerialRead,
+	kBufferOutbound,
+	kBufferTunnelRead,
+	kBufferTunnelWrite,
+	kBufferCount,
+};
+
+static uint64_t
+make_user_data(int op, int index)
+{
+	return (static_cast<uint64_t>(op) << 8) | static_cast<uint64_t>(index);
+}
+
+static int
+op_index_count(int op)
+{
+	switch (op) {
+	case kOpTunnelRead:
+	case kOpTunnelReadPoll:
+		return IO_URING_TUNNEL_READS;
+
+	case kOpTunnelWrite:
+		return IO_URING_TUNNEL_WRITES;
+
+	default:
+		return 1;
+	}
+}
+
+struct SpinelNCPDataPlane::IOURing
+{
+	io_uring_t mRing;
+	int mOutstanding;
+
+	uint8_t mWakeBuffer[32];
+
+	uint8_t mSerialRead[IO_URING_SERIAL_READ_SIZE];
+	int mSerialReadLen;
+	int mSerialReadIndex;
+	bool mSerialReadPosted;
+	bool mSerialWritePosted;
+
+	uint8_t mTunnelRead[IO_URING_TUNNEL_READS][SPINEL_FRAME_BUFFER_SIZE];
+	spinel_size_t mTunnelReadLen[IO_URING_TUNNEL_READS];
+
+	// Completed tunnel reads, oldest first
+	int mTunnelReady[IO_URING_TUNNEL_READS];
+	int mTunnelReadyHead;
+	int mTunnelReadyCount;
+
+	uint8_t mTunnelWrite[IO_URING_TUNNEL_WRITES][SPINEL_FRAME_BUFFER_SIZE];
+	unsigned int mTunnelWriteLen[IO_URING_TUNNEL_WRITES];
+	int mFreeTunnelWrite[IO_URING_TUNNEL_WRITES];
+	int mFreeTunnelWriteCount;
+
+	struct io_uring_sqe* get_sqe(void)
+	{
+		struct io_uring_sqe* sqe = io_uring_get_sqe(&mRing);
+
+		if (sqe == NULL) {
+			// Everything prepared so far goes to the kernel early.
+			io_uring_submit(&mRing, 0);
+			sqe = io_uring_get_sqe(&mRing);
+		}
+
+		if (sqe != NULL) {
+			mOutstanding++;
+		}
+
+		return sqe;
+	}
+
+	// With `poll_first`, the read is linked behind a poll for `events`.
+	struct io_uring_sqe* get_sqe_with_poll(bool poll_first, int fd, short events, int poll_op, int index)
+	{
+		struct io_uring_sqe* sqe;
+
+		if (poll_first) {
+			sqe = get_sqe();
+
+			if (sqe != NULL) {
+				io_uring_prep_poll_add(sqe, fd, events, make_user_data(poll_op, index));
+				sqe->flags |= IOSQE_IO_LINK;
+			}
+		}
+
+		return get_sqe();
+	}
+
+	bool post_read(int op, int poll_op, int index, int fd, uint8_t* buffer, unsigned len, int buffer_index, bool poll_first)
+	{
+		struct io_uring_sqe* sqe = get_sqe_with_poll(poll_first, fd, POLLIN, poll_op, index);
+
+		if (sqe != NULL) {
+			io_uring_prep_read_fixed(sqe, fd, buffer, len, static_cast<uint16_t>(buffer_index), make_user_data(op, index));
+		}
+
+		return sqe != NULL;
+	}
+};
+
+int
+SpinelNCPDataPlane::run_io_uring(void)
+{
+	IOURing* uring = new IOURing;
+	const int wake_fd = mThreadWakeFD[0];
+	const int serial_read_fd = mSerial->get_read_fd();
+	const int serial_write_fd = mSerial->get_write_fd();
+	const int tunnel_fd = mTunnel->get_read_fd();
+	struct iovec iov[kBufferCount];
+	struct io_uring_cqe* cqe;
+	uint32_t enter_count;
+	int ret;
+	int i;
+
+	ret = io_uring_init(&uring->mRing, IO_URING_ENTRIES);
+
+	if (ret != 0) {
+		delete uring;
+		return ret;
+	}
+
+	iov[kBufferWake].iov_base = uring->mWakeBuffer;
+	iov[kBufferWake].iov_len = sizeof(uring->mWakeBuffer);
+	iov[kBufferSerialRead].iov_base = uring->mSerialRead;
+	iov[kBufferSerialRead].iov_len = sizeof(uring->mSerialRead);
+	iov[kBufferOutbound].iov_base = mOutboundEscaped;
+	iov[kBufferOutbound].iov_len = sizeof(mOutboundEscaped);
+	iov[kBufferTunnelRead].iov_base = uring->mTunnelRead;
+	iov[kBufferTunnelRead].iov_len = sizeof(uring->mTunnelRead);
+	iov[kBufferTunnelWrite].iov_base = uring->mTunnelWrite;
+	iov[kBufferTunnelWrite].iov_len = sizeof(uring->mTunnelWrite);
+
+	ret = io_uring_register_buffers(&uring->mRing, iov, kBufferCount);
+
+	if (ret != 0) {
+		io_uring_finalize(&uring->mRing);
+		delete uring;
+		return ret;
+	}
+
+	uring->mOutstanding = 0;
+	uring->mSerialReadLen = 0;
+	uring->mSerialReadIndex = 0;
+	uring->mSerialReadPosted = false;
+	uring->mSerialWritePosted = false;
+	uring->mTunnelReadyHead = 0;
+	uring->mTunnelReadyCount = 0;
+	uring->mFreeTunnelWriteCount = IO_URING_TUNNEL_WRITES;
+
+	for (i = 0; i < IO_URING_TUNNEL_WRITES; i++) {
+		uring->mFreeTunnelWrite[i] = i;
+	}
+
+	mIOURing = uring;
+	__atomic_store_n(&mBackend, kBackendIOUring, __ATOMIC_RELEASE);
+
+	syslog(LOG_INFO, "[-NCP-]: Data-plane thread uses io_uring");
+
+	uring->post_read(kOpWakeRead, kOpWakePoll, 0, wake_fd, uring->mWakeBuffer, sizeof(uring->mWakeBuffer), kBufferWake, false);
+
+	for (i = 0; i < IO_URING_TUNNEL_READS; i++) {
+		uring->post_read(kOpTunnelRead, kOpTunnelReadPoll, i, tunnel_fd, &uring->mTunnelRead[i][5], SPINEL_FRAME_BUFFER_SIZE - 5, kBufferTunnelRead, false);
+	}
+
+	while (!__atomic_load_n(&mShouldStop, __ATOMIC_ACQUIRE)) {
+		const bool fast_path = get_fast_path();
+		int err = 0;
+
+		// Frames from the NCP. Each of them may need a tunnel write.
+		while ( (uring->mSerialReadIndex < uring->mSerialReadLen)
+		     && !mToHost.full()
+		     && (uring->mFreeTunnelWriteCount > 0)
+		) {
+			if (mDecoder.decode(uring->mSerialRead[uring->mSerialReadIndex++])) {
+				handle_decoded_frame();
+			}
+		}
+
+		if ((uring->mSerialReadIndex >= uring->mSerialReadLen) && !uring->mSerialReadPosted) {
+			uring->mSerialReadPosted = uring->post_read(kOpSerialRead, kOpSerialReadPoll, 0, serial_read_fd, uring->mSerialRead, sizeof(uring->mSerialRead), kBufferSerialRead, false);
+		}
+
+		// Packets from the tunnel, in the order they were read.
+		while ( (uring->mTunnelReadyCount > 0)
+		     && (fast_path ? (mOutboundEscapedLen == 0) : !mToHost.full())
+		) {
+			const int index = uring->mTunnelReady[uring->mTunnelReadyHead];
+
+			uring->mTunnelReadyHead = (uring->mTunnelReadyHead + 1) % IO_URING_TUNNEL_READS;
+			uring->mTunnelReadyCount--;
+
+			handle_tunnel_packet(uring->mTunnelRead[index], uring->mTunnelReadLen[index], fast_path);
+
+			uring->post_read(kOpTunnelRead, kOpTunnelReadPoll, index, tunnel_fd, &uring->mTunnelRead[index][5], SPINEL_FRAME_BUFFER_SIZE - 5, kBufferTunnelRead, false);
+		}
+
+		// Frames to the NCP
+		if (!uring->mSerialWritePosted) {
+			if (mOutboundEscapedLen == 0) {
+				load_outbound_frame();
+			}
+
+			if (mOutboundEscapedSent < mOutboundEscapedLen) {
+				struct io_uring_sqe* sqe = uring->get_sqe();
+
+				if (sqe != NULL) {
+					io_uring_prep_write_fixed(
+						sqe,
+						serial_write_fd,
+						mOutboundEscaped + mOutboundEscapedSent,
+						mOutboundEscapedLen - mOutboundEscapedSent,
+						kBufferOutbound,
+						make_user_data(kOpSerialWrite, 0)
+					);
+					uring->mSerialWritePosted = true;
+				}
+			}
+		}
+
+		enter_count = uring->mRing.enter_count;
+		ret = io_uring_submit(&uring->mRing, 1);
+		count_syscalls(uring->mRing.enter_count - enter_count);
+
+		if (ret < 0) {
+			syslog(LOG_ERR, "[-NCP-]: Data-plane io_uring_enter failed: %s", strerror(-ret));
+			__atomic_store_n(&mLastError, -ret, __ATOMIC_RELEASE);
+			break;
+		}
+
+		while ((err == 0) && ((cqe = io_uring_peek_cqe(&uring->mRing)) != NULL)) {
+			const int op = static_cast<int>(cqe->user_data >> 8);
+			const int index = static_cast<int>(cqe->user_data & 0xFF);
+			const int res = cqe->res;
+			const bool retry = (res == -EAGAIN) || (res == -EINTR) || (res == -ECANCELED);
+
+			io_uring_cqe_seen(&uring->mRing);
+			uring->mOutstanding--;
+
+			switch (op) {
+			case kOpWakeRead:
+				if ((res < 0) && !retry) {
+					err = -res;
+					break;
+				}
+				uring->post_read(kOpWakeRead, kOpWakePoll, 0, wake_fd, uring->mWakeBuffer, sizeof(uring->mWakeBuffer), kBufferWake, retry);
+				break;
+
+			case kOpSerialRead:
+				uring->mSerialReadPosted = false;
+
+				if (res > 0) {
+					uring->mSerialReadLen = res;
+					uring->mSerialReadIndex = 0;
+
+				} else if ((res == 0) || retry) {
+					if (res == 0) {
+						count_syscalls(1);
+						err = -fd_has_error(serial_read_fd);
+					}
+
+					if (err == 0) {
+						uring->mSerialReadPosted = uring->post_read(kOpSerialRead, kOpSerialReadPoll, 0, serial_read_fd, uring->mSerialRead, sizeof(uring->mSerialRead), kBufferSerialRead, retry);
+					}
+
+				} else {
+					err = -res;
+				}
+
+				if (err != 0) {
+					syslog(LOG_ERR, "[-NCP-]: Socket error on read: %s", strerror(err));
+				}
+				break;
+
+			case kOpSerialWrite:
+				uring->mSerialWritePosted = false;
+
+				if (res >= 0) {
+					mOutboundEscapedSent += static_cast<spinel_size_t>(res);
+
+					if (mOutboundEscapedSent >= mOutboundEscapedLen) {
+						mOutboundEscapedLen = mOutboundEscapedSent = 0;
+					}
+
+				} else if (retry) {
+					struct io_uring_sqe* sqe = uring->get_sqe_with_poll(true, serial_write_fd, POLLOUT, kOpSerialWritePoll, 0);
+
+					if (sqe != NULL) {
+						io_uring_prep_write_fixed(
+							sqe,
+							serial_write_fd,
+							mOutboundEscaped + mOutboundEscapedSent,
+							mOutboundEscapedLen - mOutboundEscapedSent,
+							kBufferOutbound,
+							make_user_data(kOpSerialWrite, 0)
+						);
+						uring->mSerialWritePosted = true;
+					}
+
+				} else {
+					err = -res;
+					syslog(LOG_ERR, "[-NCP-]: Socket error on write: %s", strerror(err));
+				}
+				break;
+
+			case kOpTunnelRead:
+				if (res > 0) {
+					uint8_t* const packet = &uring->mTunnelRead[index][5];
+					spinel_size_t packet_len = static_cast<spinel_size_t>(res);
+
+					// Remove any subheader, as `TunnelIPv6Interface::read()` does.
+					if ((packet_len >= 4) && (packet[0] == 0) && (packet[1] == 0)) {
+						packet_len -= 4;
+						memmove(packet, packet + 4, packet_len);
+					}
+
+					uring->mTunnelReadLen[index] = packet_len;
+					uring->mTunnelReady[(uring->mTunnelReadyHead + uring->mTunnelReadyCount) % IO_URING_TUNNEL_READS] = index;
+					uring->mTunnelReadyCount++;
+
+				} else if ((res == 0) || retry) {
+					uring->post_read(kOpTunnelRead, kOpTunnelReadPoll, index, tunnel_fd, &uring->mTunnelRead[index][5], SPINEL_FRAME_BUFFER_SIZE - 5, kBufferTunnelRead, retry);
+
+				} else {
+					err = -res;
+					syslog(LOG_ERR, "[-NCP-]: Tunnel error on read: %s", strerror(err));
+				}
+				break;
+
+			case kOpTunnelWrite:
+				if (res != static_cast<int>(uring->mTunnelWriteLen[index])) {
+					syslog(LOG_INFO, "[NCP->] IPv6 packet refused by host stack! (ret = %d)", res);
+				}
+
+				uring->mFreeTunnelWrite[uring->mFreeTunnelWriteCount++] = index;
+				break;
+
+			default:
+				// Polls and cancellations have nothing left to do.
+				break;
+			}
+		}
+
+		if (err != 0) {
+			__atomic_store_n(&mLastError, err, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+
+	// Everything still posted refers to our buffers, so it has to be
+	// cancelled (and its completion seen) before they can go away.
+	for (i = kOpWakeRead; i < kOpCancel; i++) {
+		int index;
+
+		for (index = 0; index < op_index_count(i); index++) {
+			struct io_uring_sqe* sqe = uring->get_sqe();
+
+			if (sqe != NULL) {
+				io_uring_prep_cancel(sqe, make_user_data(i, index), make_user_data(kOpCancel, 0));
+			}
+		}
+	}
+
+	while (uring->mOutstanding > 0) {
+		ret = io_uring_submit(&uring->mRing, 1);
+
+		if (ret < 0) {
+			break;
+		}
+
+		while (io_uring_peek_cqe(&uring->mRing) != NULL) {
+			io_uring_cqe_seen(&uring->mRing);
+			uring->mOutstanding--;
+		}
+	}
+
+	mIOURing = NULL;
+	io_uring_finalize(&uring->mRing);
+	delete uring;
+
+	return 0;
+}
+
+void
+SpinelNCPDataPlane::queue_tunnel_write(const uint8_t* packet_ptr, unsigned int packet_len)
+{
+	IOURing* const uring = mIOURing;
+	struct io_uring_sqe* sqe;
+	int index;
+
+	if ((uring->mFreeTunnelWriteCount == 0) || (packet_len > SPINEL_FRAME_BUFFER_SIZE)) {
+		syslog(LOG_INFO, "[NCP->] IPv6 packet refused by host stack! (no buffer)");
+		return;
+	}
+
+	sqe = uring->get_sqe();
+
+	if (sqe == NULL) {
+		syslog(LOG_INFO, "[NCP->] IPv6 packet refused by host stack! (no submission slot)");
+		return;
+	}
+
+	index = uring->mFreeTunnelWrite[--uring->mFreeTunnelWriteCount];
+
+	memcpy(uring->mTunnelWrite[index], packet_ptr, packet_len);
+	uring->mTunnelWriteLen[index] = packet_len;
+
+	io_uring_prep_write_fixed(
+		sqe,
+		mTunnel->get_write_fd(),
+		uring->mTunnelWrite[index],
+		packet_len,
+		kBufferTunnelWrite,
+		make_user_data(kOpTunnelWrite, index)
+	);
+}
+
+#else // IO_URING_SUPPORTED
+
+int
+SpinelNCPDataPlane::run_io_uring(void)
+{
+	return -ENOSYS;
+}
+
+void
+SpinelNCPDataPlane::queue_tunnel_write(const uint8_t* packet_ptr, unsigned int packet_len)
+{
+	(void)packet_ptr;
+	(void)packet_len;
+}
+
+#endif // else IO_URING_SUPPORTED
@@ -0,0 +1,758 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "SpinelNCPDataPlane.h"
+#include "assert-macros.h"
+#include "IPv6Helpers.h"
+#include "io-uring.h"
+#include <syslog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+using namespace nl;
+using namespace nl::wpantund;
+
+// How many bytes to pull from the serial port at once. Bytes which
+// can't be decoded yet (because the ring to the main loop is full)
+// are kept until there is room again.
+#define SERIAL_READ_CHUNK_SIZE      256
+
+static int
+open_wake_pipe(int fds[2])
+{
+	int ret = pipe(fds);
+	int i;
+
+	require_noerr(ret, bail);
+
+	for (i = 0; i < 2; i++) {
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+bail:
+	return ret;
+}
+
+static void
+close_wake_pipe(int fds[2])
+{
+	if (fds[0] >= 0) {
+		close(fds[0]);
+		fds[0] = -1;
+	}
+
+	if (fds[1] >= 0) {
+		close(fds[1]);
+		fds[1] = -1;
+	}
+}
+
+static bool
+frame_looks_like_ascii(const uint8_t* frame_ptr, spinel_size_t frame_len)
+{
+	static const uint8_t kAsciiCR = 13;
+	static const uint8_t kAsciiBEL = 7;
+	spinel_size_t i;
+
+	for (i = 0; i < frame_len; i++) {
+		if ( (frame_ptr[i] == 0)
+		  || ((frame_ptr[i] >= kAsciiBEL) && (frame_ptr[i] <= kAsciiCR))
+		  || ((frame_ptr[i] >= 32) && (frame_ptr[i] <= 127))
+		) {
+			continue;
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+SpinelNCPDataPlane::SpinelNCPDataPlane(void):
+	mHostWakePending(0),
+	mShouldStop(0),
+	mFastPath(0),
+	mLastError(0),
+	mBackend(kBackendPoll),
+	mIsRunning(false),
+	mUseIOURing(false),
+	mDropFirewall(NULL),
+	mIOURing(NULL),
+	mOutboundEscapedLen(0),
+	mOutboundEscapedSent(0)
+{
+	mHostWakeFD[0] = mHostWakeFD[1] = -1;
+	mThreadWakeFD[0] = mThreadWakeFD[1] = -1;
+	memset(&mCounters, 0, sizeof(mCounters));
+}
+
+SpinelNCPDataPlane::~SpinelNCPDataPlane(void)
+{
+	stop();
+}
+
+bool
+SpinelNCPDataPlane::is_supported(void)
+{
+#if WPANTUND_SPINEL_USE_FLEN || OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER
+	return false;
+#else
+	return true;
+#endif
+}
+
+int
+SpinelNCPDataPlane::start(
+	const boost::shared_ptr<SocketWrapper>& serial,
+	const boost::shared_ptr<TunnelIPv6Interface>& tunnel,
+	const IPv6PacketMatcher* drop_firewall,
+	bool use_io_uring
+) {
+	int ret = EALREADY;
+	sigset_t all_signals;
+	sigset_t old_signals;
+
+	require(!mIsRunning, bail);
+
+	ret = errno = 0;
+
+	require_noerr_action(open_wake_pipe(mHostWakeFD), bail, ret = errno);
+	require_noerr_action(open_wake_pipe(mThreadWakeFD), bail, ret = errno);
+
+	mSerial = serial;
+	mTunnel = tunnel;
+	mDropFirewall = drop_firewall;
+	mUseIOURing = use_io_uring && io_uring_is_available();
+
+	if (use_io_uring && !mUseIOURing) {
+		syslog(LOG_WARNING, "[-NCP-]: io_uring not available, data-plane thread uses poll()");
+	}
+
+	mToNCP.clear();
+	mToHost.clear();
+	mPacketTap.clear();
+
+	mDecoder.reset();
+	mOutboundEscapedLen = 0;
+	mOutboundEscapedSent = 0;
+
+	mHostWakePending = 0;
+	mShouldStop = 0;
+	mFastPath = 0;
+	mLastError = 0;
+	mBackend = kBackendPoll;
+	memset(&mCounters, 0, sizeof(mCounters));
+
+	// Signals are for the main loop to handle, so the thread starts
+	// out with all of them blocked.
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+
+	ret = pthread_create(&mThread, NULL, &SpinelNCPDataPlane::thread_main, static_cast<void*>(this));
+
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+	require_noerr(ret, bail);
+
+	mIsRunning = true;
+
+	syslog(LOG_INFO, "[-NCP-]: Data-plane thread started");
+
+bail:
+	if (!mIsRunning && (ret != EALREADY)) {
+		close_wake_pipe(mHostWakeFD);
+		close_wake_pipe(mThreadWakeFD);
+		mSerial.reset();
+		mTunnel.reset();
+	}
+
+	return ret;
+}
+
+void
+SpinelNCPDataPlane::stop(void)
+{
+	if (!mIsRunning) {
+		return;
+	}
+
+	__atomic_store_n(&mShouldStop, 1, __ATOMIC_RELEASE);
+	wake_thread();
+
+	pthread_join(mThread, NULL);
+	mIsRunning = false;
+
+	close_wake_pipe(mHostWakeFD);
+	close_wake_pipe(mThreadWakeFD);
+
+	mSerial.reset();
+	mTunnel.reset();
+	mDropFirewall = NULL;
+
+	mToNCP.clear();
+	mToHost.clear();
+	mPacketTap.clear();
+
+	syslog(LOG_INFO, "[-NCP-]: Data-plane thread stopped");
+}
+
+int
+SpinelNCPDataPlane::get_last_error(void) const
+{
+	return __atomic_load_n(&mLastError, __ATOMIC_ACQUIRE);
+}
+
+void
+SpinelNCPDataPlane::set_fast_path(bool enabled)
+{
+	if (get_fast_path() != enabled) {
+		__atomic_store_n(&mFastPath, enabled ? 1 : 0, __ATOMIC_RELEASE);
+
+		// The thread only polls the tunnel when it has somewhere to
+		// put the packet, and that depends on the fast path.
+		wake_thread();
+	}
+}
+
+bool
+SpinelNCPDataPlane::get_fast_path(void) const
+{
+	return __atomic_load_n(&mFastPath, __ATOMIC_ACQUIRE) != 0;
+}
+
+SpinelNCPDataPlane::Counters
+SpinelNCPDataPlane::get_counters(void) const
+{
+	Counters counters;
+
+	counters.mFastPathToHost = __atomic_load_n(&mCounters.mFastPathToHost, __ATOMIC_RELAXED);
+	counters.mFastPathToNCP = __atomic_load_n(&mCounters.mFastPathToNCP, __ATOMIC_RELAXED);
+	counters.mFramesToHost = __atomic_load_n(&mCounters.mFramesToHost, __ATOMIC_RELAXED);
+	counters.mFramesToNCP = __atomic_load_n(&mCounters.mFramesToNCP, __ATOMIC_RELAXED);
+	counters.mDroppedFrames = __atomic_load_n(&mCounters.mDroppedFrames, __ATOMIC_RELAXED);
+	counters.mCRCErrors = __atomic_load_n(&mCounters.mCRCErrors, __ATOMIC_RELAXED);
+	counters.mSyscalls = __atomic_load_n(&mCounters.mSyscalls, __ATOMIC_RELAXED);
+	counters.mCPUTimeUs = 0;
+
+	if (mIsRunning) {
+		clockid_t clock_id;
+		struct timespec ts;
+
+		if ( (pthread_getcpuclockid(mThread, &clock_id) == 0)
+		  && (clock_gettime(clock_id, &ts) == 0)
+		) {
+			counters.mCPUTimeUs = static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+		}
+	}
+
+	return counters;
+}
+
+SpinelNCPDataPlane::Backend
+SpinelNCPDataPlane::get_backend(void) const
+{
+	return static_cast<Backend>(__atomic_load_n(&mBackend, __ATOMIC_ACQUIRE));
+}
+
+void
+SpinelNCPDataPlane::get_counters_as_string_list(std::list<std::string>& list) const
+{
+	const Counters counters = get_counters();
+	const uint32_t frames = counters.mFastPathToHost + counters.mFastPathToNCP
+		+ counters.mFramesToHost + counters.mFramesToNCP;
+	char line[160];
+
+	snprintf(line, sizeof(line), "Backend: %s", mIsRunning
+		? ((get_backend() == kBackendIOUring) ? "io_uring" : "poll")
+		: "stopped"
+	);
+	list.push_back(line);
+
+	snprintf(
+		line,
+		sizeof(line),
+		"Frames: FastPathToHost:%u FastPathToNCP:%u ToHost:%u ToNCP:%u Dropped:%u CRCErrors:%u",
+		counters.mFastPathToHost,
+		counters.mFastPathToNCP,
+		counters.mFramesToHost,
+		counters.mFramesToNCP,
+		counters.mDroppedFrames,
+		counters.mCRCErrors
+	);
+	list.push_back(line);
+
+	snprintf(
+		line,
+		sizeof(line),
+		"Cost: Syscalls:%u CPUTimeUs:%llu SyscallsPerFrame:%.2f CPUTimeUsPerFrame:%.1f",
+		counters.mSyscalls,
+		static_cast<unsigned long long>(counters.mCPUTimeUs),
+		(frames != 0) ? static_cast<double>(counters.mSyscalls) / frames : 0.0,
+		(frames != 0) ? static_cast<double>(counters.mCPUTimeUs) / frames : 0.0
+	);
+	list.push_back(line);
+}
+
+void
+SpinelNCPDataPlane::drain_fd(int fd)
+{
+	uint8_t buffer[32];
+
+	while (read(fd, buffer, sizeof(buffer)) > 0) {
+	}
+}
+
+void
+SpinelNCPDataPlane::clear_wake(void)
+{
+	// Clear the flag first, so that anything the thread queues from
+	// here on writes a new wake byte.
+	__atomic_store_n(&mHostWakePending, 0, __ATOMIC_SEQ_CST);
+	drain_fd(mHostWakeFD[0]);
+}
+
+void
+SpinelNCPDataPlane::wake_host(void)
+{
+	if (__atomic_exchange_n(&mHostWakePending, 1, __ATOMIC_SEQ_CST) == 0) {
+		IGNORE_RETURN_VALUE(write(mHostWakeFD[1], "", 1));
+		count_syscalls(1);
+	}
+}
+
+void
+SpinelNCPDataPlane::wake_thread(void)
+{
+	IGNORE_RETURN_VALUE(write(mThreadWakeFD[1], "", 1));
+}
+
+void
+SpinelNCPDataPlane::count_syscalls(uint32_t count)
+{
+	__atomic_fetch_add(&mCounters.mSyscalls, count, __ATOMIC_RELAXED);
+}
+
+void
+SpinelNCPDataPlane::commit_send(void)
+{
+	mToNCP.commit_write();
+	__atomic_fetch_add(&mCounters.mFramesToNCP, 1, __ATOMIC_RELAXED);
+	wake_thread();
+}
+
+void
+SpinelNCPDataPlane::commit_receive(void)
+{
+	const bool was_full = mToHost.full();
+
+	mToHost.commit_read();
+
+	if (was_full) {
+		wake_thread();
+	}
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: I/O thread
+
+void*
+SpinelNCPDataPlane::thread_main(void* context)
+{
+	static_cast<SpinelNCPDataPlane*>(context)->run();
+	return NULL;
+}
+
+void
+SpinelNCPDataPlane::run(void)
+{
+	if (mUseIOURing) {
+		int ret = run_io_uring();
+
+		if (ret == 0) {
+			// Let the main loop notice `mLastError`, if set.
+			wake_host();
+			return;
+		}
+
+		syslog(LOG_WARNING, "[-NCP-]: io_uring setup failed (%s), data-plane thread uses poll()", strerror(-ret));
+	}
+
+	run_poll();
+
+	// Let the main loop notice `mLastError`, if set.
+	wake_host();
+}
+
+void
+SpinelNCPDataPlane::run_poll(void)
+{
+	uint8_t serial_buffer[SERIAL_READ_CHUNK_SIZE];
+	ssize_t serial_buffer_len = 0;
+	ssize_t serial_buffer_index = 0;
+
+	while (!__atomic_load_n(&mShouldStop, __ATOMIC_ACQUIRE)) {
+		struct pollfd fds[4];
+		int fd_count = 0;
+		int serial_read_index = -1;
+		int tunnel_index = -1;
+		bool fast_path = get_fast_path();
+
+		// Finish decoding what we already read before reading more.
+		while ((serial_buffer_index < serial_buffer_len) && !mToHost.full()) {
+			if (mDecoder.decode(serial_buffer[serial_buffer_index++])) {
+				handle_decoded_frame();
+			}
+		}
+
+		fds[fd_count].fd = mThreadWakeFD[0];
+		fds[fd_count].events = POLLIN;
+		fd_count++;
+
+		if ((serial_buffer_index >= serial_buffer_len) && !mToHost.full()) {
+			serial_read_index = fd_count;
+			fds[fd_count].fd = mSerial->get_read_fd();
+			fds[fd_count].events = POLLIN;
+			fd_count++;
+		}
+
+		if (mOutboundEscapedSent < mOutboundEscapedLen) {
+			fds[fd_count].fd = mSerial->get_write_fd();
+			fds[fd_count].events = POLLOUT;
+			fd_count++;
+		}
+
+		if (fast_path ? (mOutboundEscapedLen == 0) : !mToHost.full()) {
+			tunnel_index = fd_count;
+			fds[fd_count].fd = mTunnel->get_read_fd();
+			fds[fd_count].events = POLLIN;
+			fd_count++;
+		}
+
+		count_syscalls(1);
+
+		if (poll(fds, fd_count, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			syslog(LOG_ERR, "[-NCP-]: Data-plane poll failed: %s", strerror(errno));
+			__atomic_store_n(&mLastError, errno, __ATOMIC_RELEASE);
+			break;
+		}
+
+		if (fds[0].revents != 0) {
+			drain_fd(mThreadWakeFD[0]);
+			count_syscalls(2);
+		}
+
+		if ((serial_read_index >= 0) && (fds[serial_read_index].revents != 0)) {
+			serial_buffer_len = mSerial->read(serial_buffer, sizeof(serial_buffer));
+			serial_buffer_index = 0;
+			count_syscalls(1);
+
+			if (serial_buffer_len < 0) {
+				syslog(LOG_ERR, "[-NCP-]: Socket error on read: %s", strerror((int)-serial_buffer_len));
+				__atomic_store_n(&mLastError, (int)-serial_buffer_len, __ATOMIC_RELEASE);
+				break;
+			}
+		}
+
+		if ((tunnel_index >= 0) && (fds[tunnel_index].revents != 0)) {
+			if (!read_tunnel_packet(fast_path)) {
+				break;
+			}
+		}
+
+		if (!pump_serial_output()) {
+			break;
+		}
+	}
+}
+
+bool
+SpinelNCPDataPlane::pump_serial_output(void)
+{
+	do {
+		if (mOutboundEscapedSent < mOutboundEscapedLen) {
+			ssize_t ret = mSerial->write(
+				mOutboundEscaped + mOutboundEscapedSent,
+				mOutboundEscapedLen - mOutboundEscapedSent
+			);
+
+			count_syscalls(1);
+
+			if ((ret == -EAGAIN) || (ret == -EINTR) || (ret == 0)) {
+				break;
+			}
+
+			if (ret < 0) {
+				syslog(LOG_ERR, "[-NCP-]: Socket error on write: %s", strerror((int)-ret));
+				__atomic_store_n(&mLastError, (int)-ret, __ATOMIC_RELEASE);
+				return false;
+			}
+
+			mOutboundEscapedSent += static_cast<spinel_size_t>(ret);
+
+			if (mOutboundEscapedSent < mOutboundEscapedLen) {
+				break;
+			}
+
+			mOutboundEscapedLen = mOutboundEscapedSent = 0;
+		}
+	} while (load_outbound_frame());
+
+	return true;
+}
+
+// Encodes the next frame from the main loop into `mOutboundEscaped`,
+// which must be empty. Returns false if there was none.
+bool
+SpinelNCPDataPlane::load_outbound_frame(void)
+{
+	Frame* frame = mToNCP.begin_read();
+	bool was_full;
+
+	if (frame == NULL) {
+		return false;
+	}
+
+	was_full = mToNCP.full();
+
+	mOutboundEscapedLen = hdlc_encode_frame(
+		frame->mData,
+		frame->mLength,
+		mOutboundEscaped,
+		sizeof(mOutboundEscaped)
+	);
+	mOutboundEscapedSent = 0;
+
+	mToNCP.commit_read();
+
+	if (was_full) {
+		// The main loop may be holding a frame for us.
+		wake_host();
+	}
+
+	return true;
+}
+
+bool
+SpinelNCPDataPlane::read_tunnel_packet(bool fast_path)
+{
+	ssize_t packet_len = mTunnel->read(&mTunnelFrame[5], sizeof(mTunnelFrame) - 5);
+
+	count_syscalls(1);
+
+	if (packet_len < 0) {
+		syslog(LOG_ERR, "[-NCP-]: Tunnel error on read: %s", strerror((int)-packet_len));
+		__atomic_store_n(&mLastError, (int)-packet_len, __ATOMIC_RELEASE);
+		return false;
+	}
+
+	if (packet_len > 0) {
+		handle_tunnel_packet(mTunnelFrame, static_cast<spinel_size_t>(packet_len), fast_path);
+	}
+
+	return true;
+}
+
+// `frame_ptr` points five bytes ahead of the packet, where the Spinel
+// header goes if the packet takes the fast path.
+void
+SpinelNCPDataPlane::handle_tunnel_packet(uint8_t* frame_ptr, spinel_size_t packet_len, bool fast_path)
+{
+	uint8_t* const packet = frame_ptr + 5;
+
+	if (!fast_path) {
+		queue_to_host(kFrameTypeNCPBoundPacket, packet, packet_len);
+		return;
+	}
+
+	if (!is_valid_ipv6_packet(packet, packet_len)) {
+		syslog(LOG_DEBUG, "Dropping non-IPv6 outbound packet (first byte was 0x%02X)", packet[0]);
+		return;
+	}
+
+	if ((mDropFirewall != NULL) && (mDropFirewall->match_outbound(packet) != mDropFirewall->end())) {
+		syslog(LOG_INFO, "[->NCP] Dropping matched packet.");
+		return;
+	}
+
+	frame_ptr[0] = SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0;
+	frame_ptr[1] = SPINEL_CMD_PROP_VALUE_SET;
+	frame_ptr[2] = SPINEL_PROP_STREAM_NET;
+	frame_ptr[3] = (packet_len & 0xFF);
+	frame_ptr[4] = ((packet_len >> 8) & 0xFF);
+
+	mOutboundEscapedLen = hdlc_encode_frame(
+		frame_ptr,
+		packet_len + 5,
+		mOutboundEscaped,
+		sizeof(mOutboundEscaped)
+	);
+	mOutboundEscapedSent = 0;
+
+	__atomic_fetch_add(&mCounters.mFastPathToNCP, 1, __ATOMIC_RELAXED);
+	tap_packet(kPacketDirectionNCPBound, packet, packet_len);
+}
+
+void
+SpinelNCPDataPlane::handle_decoded_frame(void)
+{
+	uint8_t* const frame_ptr = mDecoder.get_frame();
+	const spinel_size_t frame_len = mDecoder.get_frame_size() - 2;
+
+#if !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION // Don't do CRC checks when in fuzzing mode
+	if (!hdlc_frame_crc_is_valid(frame_ptr, mDecoder.get_frame_size())) {
+		__atomic_fetch_add(&mCounters.mCRCErrors, 1, __ATOMIC_RELAXED);
+
+		syslog(LOG_ERR, "[NCP->]: Frame CRC Mismatch, Garbage on line?");
+
+		// This frame might be an ASCII backtrace, which the main loop
+		// dumps out to syslog.
+		if (frame_looks_like_ascii(frame_ptr, mDecoder.get_frame_size())) {
+			queue_to_host(kFrameTypeDebugStream, frame_ptr, mDecoder.get_frame_size());
+		}
+
+		return;
+	}
+#endif // !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+
+	if (get_fast_path() && forward_to_tunnel(frame_ptr, frame_len)) {
+		return;
+	}
+
+	queue_to_host(kFrameTypeSpinel, frame_ptr, frame_len);
+}
+
+bool
+SpinelNCPDataPlane::forward_to_tunnel(const uint8_t* frame_ptr, spinel_size_t frame_len)
+{
+	uint8_t header = 0;
+	unsigned int command = 0;
+	unsigned int key = 0;
+	const uint8_t* packet_ptr = NULL;
+	unsigned int packet_len = 0;
+	spinel_ssize_t len;
+
+	len = spinel_datatype_unpack(frame_ptr, frame_len, "Cii", &header, &command, &key);
+
+	// Only unsolicited, secure packets for IID zero take the fast path.
+	if ( (len <= 0)
+	  || ((header & SPINEL_HEADER_FLAG) != SPINEL_HEADER_FLAG)
+	  || (SPINEL_HEADER_GET_IID(header) != 0)
+	  || (SPINEL_HEADER_GET_TID(header) != 0)
+	  || (command != SPINEL_CMD_PROP_VALUE_IS)
+	  || (key != SPINEL_PROP_STREAM_NET)
+	) {
+		return false;
+	}
+
+	len = spinel_datatype_unpack(
+		frame_ptr + len,
+		frame_len - len,
+		SPINEL_DATATYPE_DATA_S SPINEL_DATATYPE_DATA_S,
+		&packet_ptr,
+		&packet_len,
+		NULL,
+		NULL
+	);
+
+	if ((len <= 0) || !is_valid_ipv6_packet(packet_ptr, packet_len)) {
+		// Let the main loop deal with anything unusual.
+		return false;
+	}
+
+	write_to_tunnel(packet_ptr, packet_len);
+
+	__atomic_fetch_add(&mCounters.mFastPathToHost, 1, __ATOMIC_RELAXED);
+	tap_packet(kPacketDirectionHostBound, packet_ptr, packet_len);
+
+	return true;
+}
+
+void
+SpinelNCPDataPlane::write_to_tunnel(const uint8_t* packet_ptr, unsigned int packet_len)
+{
+	ssize_t ret;
+
+	if (mIOURing != NULL) {
+		queue_tunnel_write(packet_ptr, packet_len);
+		return;
+	}
+
+	ret = mTunnel->write(packet_ptr, packet_len);
+	count_syscalls(1);
+
+	if (ret != static_cast<ssize_t>(packet_len)) {
+		syslog(LOG_INFO, "[NCP->] IPv6 packet refused by host stack! (ret = %ld)", (long)ret);
+	}
+}
+
+void
+SpinelNCPDataPlane::queue_to_host(FrameType type, const uint8_t* data_ptr, spinel_size_t data_len)
+{
+	Frame* frame = mToHost.begin_write();
+
+	if ((frame == NULL) || (data_len > sizeof(frame->mData))) {
+		__atomic_fetch_add(&mCounters.mDroppedFrames, 1, __ATOMIC_RELAXED);
+		syslog(LOG_WARNING, "[-NCP-]: Data-plane dropped a frame (type %d, %d bytes)", type, (int)data_len);
+		return;
+	}
+
+	frame->mType = static_cast<uint8_t>(type);
+	frame->mLength = data_len;
+	memcpy(frame->mData, data_ptr, data_len);
+
+	mToHost.commit_write();
+	__atomic_fetch_add(&mCounters.mFramesToHost, 1, __ATOMIC_RELAXED);
+
+	wake_host();
+}
+
+void
+SpinelNCPDataPlane::tap_packet(PacketDirection direction, const uint8_t* packet, spinel_size_t packet_len)
+{
+	PacketHeader* header = mPacketTap.begin_write();
+
+	// Statistics are best-effort, so if the main loop is
+	// behind we just skip this packet.
+	if (header != NULL) {
+		header->mDirection = static_cast<uint8_t>(direction);
+		memset(header->mData, 0, sizeof(header->mData));
+		memcpy(header->mData, packet, std::min<size_t>(packet_len, sizeof(header->mData)));
+
+		mPacketTap.commit_write();
+
+		wake_host();
+	}
+}
@@ -0,0 +1,258 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Optional I/O thread which owns the NCP serial port and the
+ *      tunnel interface.
+ *
+ *      The thread does all of the HDLC framing and CRC work and, while
+ *      the main loop allows it (see `set_fast_path()`), forwards
+ *      `STREAM_NET` traffic between the tunnel and the NCP on its own.
+ *      Everything else is exchanged with the main loop as whole Spinel
+ *      frames over a pair of lock-free single-producer/single-consumer
+ *      rings, so none of the existing driver logic needs to be
+ *      thread-safe.
+ *
+ *      On Linux the thread can drive its file descriptors through
+ *      io_uring instead of `poll()` (see `SpinelNCPDataPlane-IOURing.cpp`).
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPDataPlane__
+#define __wpantund__SpinelNCPDataPlane__
+
+#include <stdint.h>
+#include <pthread.h>
+#include <list>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include "spinel.h"
+#include "SPSCRing.h"
+#include "SocketWrapper.h"
+#include "TunnelIPv6Interface.h"
+#include "IPv6PacketMatcher.h"
+#include "SpinelNCPHDLC.h"
+
+namespace nl {
+namespace wpantund {
+
+class SpinelNCPDataPlane
+{
+public:
+	enum FrameType
+	{
+		// A complete, CRC-checked Spinel frame.
+		kFrameTypeSpinel          = 0,
+
+		// An IPv6 packet read from the tunnel which the main loop
+		// still needs to filter and wrap in a Spinel frame.
+		kFrameTypeNCPBoundPacket  = 1,
+
+		// A frame which failed its CRC check but looks like ASCII
+		// (usually a crash dump from the NCP).
+		kFrameTypeDebugStream     = 2,
+	};
+
+	enum PacketDirection
+	{
+		kPacketDirectionHostBound = 0,
+		kPacketDirectionNCPBound  = 1,
+	};
+
+	enum Backend
+	{
+		kBackendPoll              = 0,
+		kBackendIOUring           = 1,
+	};
+
+	enum
+	{
+		kFrameRingSize     = 32,
+		kPacketTapSize     = 64,
+
+		// Enough of each packet for `StatCollector` to classify it.
+		kPacketHeaderSize  = 48,
+	};
+
+	struct Frame
+	{
+		uint8_t       mType;
+		spinel_size_t mLength;
+		uint8_t       mData[SPINEL_FRAME_BUFFER_SIZE + 2];
+	};
+
+	// Header of a packet forwarded by the fast path, handed back to the
+	// main loop so that it still shows up in the packet statistics.
+	struct PacketHeader
+	{
+		uint8_t       mDirection;
+		uint8_t       mData[kPacketHeaderSize];
+	};
+
+	struct Counters
+	{
+		uint32_t      mFastPathToHost;
+		uint32_t      mFastPathToNCP;
+		uint32_t      mFramesToHost;
+		uint32_t      mFramesToNCP;
+		uint32_t      mDroppedFrames;
+		uint32_t      mCRCErrors;
+
+		// System calls made by the I/O thread, and the CPU time it
+		// has used so far.
+		uint32_t      mSyscalls;
+		uint64_t      mCPUTimeUs;
+	};
+
+public:
+	SpinelNCPDataPlane(void);
+	~SpinelNCPDataPlane(void);
+
+	// Returns false if this build uses framing or encryption which
+	// the data-plane thread doesn't implement.
+	static bool is_supported(void);
+
+	// Starts the I/O thread. From this point until `stop()` returns,
+	// the main loop must not read from or write to `serial` or `tunnel`,
+	// and `drop_firewall` must not be modified.
+	//
+	// With `use_io_uring`, the thread uses io_uring if the kernel
+	// supports it (see `io_uring_is_available()`), and falls back to
+	// `poll()` otherwise.
+	int start(
+		const boost::shared_ptr<SocketWrapper>& serial,
+		const boost::shared_ptr<TunnelIPv6Interface>& tunnel,
+		const IPv6PacketMatcher* drop_firewall,
+		bool use_io_uring = false
+	);
+
+	// Stops and joins the I/O thread. Frames still in either ring
+	// are discarded.
+	void stop(void);
+
+	bool is_running(void) const { return mIsRunning; }
+
+	// Non-zero `errno` value if the I/O thread stopped because of a
+	// socket error.
+	int get_last_error(void) const;
+
+	// While enabled, the I/O thread forwards secure `STREAM_NET` traffic
+	// directly, applying only the drop firewall. The main loop must
+	// only enable this while its own filtering would reduce to that.
+	void set_fast_path(bool enabled);
+	bool get_fast_path(void) const;
+
+	Counters get_counters(void) const;
+
+	// Which backend the I/O thread ended up using.
+	Backend get_backend(void) const;
+
+	// Counters, plus system calls and CPU time per frame, for
+	// `Daemon:DataPlane`.
+	void get_counters_as_string_list(std::list<std::string>& list) const;
+
+	// Main loop side: readable whenever the I/O thread has queued
+	// something for the main loop.
+	int get_wake_fd(void) const { return mHostWakeFD[0]; }
+	void clear_wake(void);
+
+	// Main loop side: frames to send to the NCP.
+	Frame* begin_send(void) { return mToNCP.begin_write(); }
+	void commit_send(void);
+	bool can_send(void) const { return !mToNCP.full(); }
+
+	// Main loop side: frames received from the NCP.
+	Frame* begin_receive(void) { return mToHost.begin_read(); }
+	void commit_receive(void);
+	bool can_receive(void) const { return !mToHost.empty() || !mPacketTap.empty(); }
+
+	// Main loop side: headers of packets forwarded by the fast path.
+	PacketHeader* begin_read_packet_header(void) { return mPacketTap.begin_read(); }
+	void commit_read_packet_header(void) { mPacketTap.commit_read(); }
+
+private:
+	static void* thread_main(void* context);
+
+	void run(void);
+	void run_poll(void);
+	bool pump_serial_output(void);
+	bool load_outbound_frame(void);
+	bool read_tunnel_packet(bool fast_path);
+	void handle_tunnel_packet(uint8_t* frame_ptr, spinel_size_t packet_len, bool fast_path);
+	void handle_decoded_frame(void);
+	bool forward_to_tunnel(const uint8_t* frame_ptr, spinel_size_t frame_len);
+	void write_to_tunnel(const uint8_t* packet_ptr, unsigned int packet_len);
+	void queue_to_host(FrameType type, const uint8_t* data_ptr, spinel_size_t data_len);
+	void tap_packet(PacketDirection direction, const uint8_t* packet, spinel_size_t packet_len);
+	void wake_host(void);
+	void wake_thread(void);
+	void count_syscalls(uint32_t count);
+
+	static void drain_fd(int fd);
+
+	// I/O thread state of the io_uring backend, see
+	// `SpinelNCPDataPlane-IOURing.cpp`.
+	struct IOURing;
+
+	// Returns a negative errno value if no ring could be set up, in
+	// which case nothing has been read or written yet.
+	int run_io_uring(void);
+	void queue_tunnel_write(const uint8_t* packet_ptr, unsigned int packet_len);
+
+	typedef SPSCRing<Frame, kFrameRingSize> FrameRing;
+	typedef SPSCRing<PacketHeader, kPacketTapSize> PacketTap;
+
+private:
+	// Shared between the threads
+	FrameRing mToNCP;
+	FrameRing mToHost;
+	PacketTap mPacketTap;
+	int mHostWakeFD[2];
+	int mThreadWakeFD[2];
+	int mHostWakePending;
+	int mShouldStop;
+	int mFastPath;
+	int mLastError;
+	int mBackend;
+	Counters mCounters;
+
+	// Main loop only
+	pthread_t mThread;
+	bool mIsRunning;
+	bool mUseIOURing;
+
+	// I/O thread only
+	boost::shared_ptr<SocketWrapper> mSerial;
+	boost::shared_ptr<TunnelIPv6Interface> mTunnel;
+	const IPv6PacketMatcher* mDropFirewall;
+
+	HDLCDecoder mDecoder;
+
+	// Non-NULL while the io_uring backend is running.
+	IOURing* mIOURing;
+
+	uint8_t mTunnelFrame[SPINEL_FRAME_BUFFER_SIZE];
+
+	uint8_t mOutboundEscaped[HDLC_ENCODED_SIZE(SPINEL_FRAME_BUFFER_SIZE)];
+	spinel_size_t mOutboundEscapedLen;
+	spinel_size_t mOutboundEscapedSent;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPDataPlane__) */
@@ -0,0 +1,610 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SpinelNCPEgressScheduler.h"
+#include "assert-macros.h"
+#include "string-utils.h"
+#include "time-utils.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+#define IPV6_HEADER_LEN         40
+#define IPPROTO_NUM_HOPOPTS     0
+#define IPPROTO_NUM_TCP         6
+#define IPPROTO_NUM_UDP         17
+#define IPPROTO_NUM_ROUTING     43
+#define IPPROTO_NUM_ICMPV6      58
+#define IPPROTO_NUM_DSTOPTS     60
+
+#define ICMPV6_TYPE_ECHO_REQUEST  128
+#define ICMPV6_TYPE_ECHO_REPLY    129
+
+#define UDP_PORT_MLE            19788
+#define UDP_PORT_COAP           5683
+#define UDP_PORT_COAPS          5684
+#define UDP_PORT_TMF            61631
+
+const uint16_t SpinelNCPEgressScheduler::kQueueLimit[kClassCount] = {
+	kNetworkControlQueueLimit,
+	kInteractiveQueueLimit,
+	kDefaultQueueLimit,
+	kBulkQueueLimit,
+};
+
+// Share of the link under deficit round robin. Network control
+// doesn't take part in it.
+const uint8_t SpinelNCPEgressScheduler::kWeight[kClassCount] = { 0, 4, 2, 1 };
+
+// How long packets of each class may be held while the NCP sleeps. Zero
+// means they are never held.
+const uint16_t SpinelNCPEgressScheduler::kHoldTime[kClassCount] = {
+	0,
+	0,
+	kDefaultHoldTime,
+	kBulkHoldTime,
+};
+
+const char* const SpinelNCPEgressScheduler::kClassName[kClassCount] = {
+	"control",
+	"interactive",
+	"default",
+	"bulk",
+};
+
+SpinelNCPEgressScheduler::SpinelNCPEgressScheduler(void):
+	mEnabled(true),
+	mFreeList(kNoSlot),
+	mQueued(0),
+	mCurrent(kClassNetworkControl + 1),
+	mVisiting(false),
+	mHoldEnabled(false),
+	mNCPAsleep(false),
+	mReleasing(false),
+	mHeldSent(0),
+	mHeldLatencySum(0),
+	mHeldLatencyMax(0),
+	mReleasedOnWake(0),
+	mReleasedOnPriority(0),
+	mReleasedOnDeadline(0),
+	mReleasedOnFull(0)
+{
+	memset(mQueues, 0, sizeof(mQueues));
+
+	for (int c = 0; c < kClassCount; c++) {
+		mQueues[c].mHead = kNoSlot;
+		mQueues[c].mTail = kNoSlot;
+	}
+
+	for (int i = kSlotCount - 1; i >= 0; i--) {
+		mSlots[i].mNext = mFreeList;
+		mFreeList = i;
+	}
+}
+
+void
+SpinelNCPEgressScheduler::set_enabled(bool enabled)
+{
+	mEnabled = enabled;
+
+	if (!mEnabled) {
+		flush();
+	}
+}
+
+void
+SpinelNCPEgressScheduler::set_hold_enabled(bool enabled)
+{
+	mHoldEnabled = enabled;
+}
+
+void
+SpinelNCPEgressScheduler::set_ncp_asleep(bool asleep)
+{
+	if (mNCPAsleep && !asleep) {
+		handle_ncp_activity();
+	}
+
+	mNCPAsleep = asleep;
+}
+
+bool
+SpinelNCPEgressScheduler::is_holding(void) const
+{
+	return mHoldEnabled && mNCPAsleep && !mReleasing;
+}
+
+bool
+SpinelNCPEgressScheduler::is_due(Class c) const
+{
+	const Queue& queue = mQueues[c];
+
+	return (queue.mDepth != 0)
+		&& (time_us() - mSlots[queue.mHead].mEnqueueTime >= static_cast<uint64_t>(kHoldTime[c]) * 1000);
+}
+
+void
+SpinelNCPEgressScheduler::release_held(uint32_t* reason_count)
+{
+	if (is_holding() && (mQueued != 0)) {
+		mReleasing = true;
+		(*reason_count)++;
+	}
+}
+
+void
+SpinelNCPEgressScheduler::handle_ncp_activity(void)
+{
+	if (mHoldEnabled) {
+		release_held(&mReleasedOnWake);
+	}
+}
+
+bool
+SpinelNCPEgressScheduler::is_accepting(void) const
+{
+	if (!has_free_slot()) {
+		return false;
+	}
+
+	for (int c = 0; c < kClassCount; c++) {
+		if (mQueues[c].mDepth >= kQueueLimit[c]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool
+SpinelNCPEgressScheduler::has_ready_packet(void) const
+{
+	if (mQueued == 0) {
+		return false;
+	}
+
+	if (!is_holding()) {
+		return true;
+	}
+
+	for (int c = 0; c < kClassCount; c++) {
+		if ((kHoldTime[c] == 0) ? (mQueues[c].mDepth != 0) : is_due(static_cast<Class>(c))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+cms_t
+SpinelNCPEgressScheduler::get_ms_to_next_event(void) const
+{
+	cms_t cms = CMS_DISTANT_FUTURE;
+
+	if (!is_holding()) {
+		return cms;
+	}
+
+	for (int c = 0; c < kClassCount; c++) {
+		const Queue& queue = mQueues[c];
+
+		if ((kHoldTime[c] != 0) && (queue.mDepth != 0)) {
+			int64_t held_ms = static_cast<int64_t>(time_us() - mSlots[queue.mHead].mEnqueueTime) / 1000;
+
+			if (kHoldTime[c] - held_ms < cms) {
+				cms = static_cast<cms_t>(kHoldTime[c] - held_ms);
+			}
+		}
+	}
+
+	return (cms > 0) ? cms : 0;
+}
+
+bool
+SpinelNCPEgressScheduler::set_rules(const std::string& rules)
+{
+	std::vector<Rule> parsed;
+	char* copy = strdup(rules.c_str());
+	char* saveptr = NULL;
+	char* entry;
+	bool ret = false;
+
+	require(copy != NULL, bail);
+
+	for (entry = strtok_r(copy, ", \t", &saveptr); entry != NULL; entry = strtok_r(NULL, ", \t", &saveptr)) {
+		Rule rule;
+		char* value = strchr(entry, ':');
+		char* class_name = strchr(entry, '=');
+		char* end = NULL;
+		int c;
+
+		require(value != NULL && class_name != NULL && value < class_name, bail);
+
+		*value++ = 0;
+		*class_name++ = 0;
+
+		if (strcaseequal(entry, "dscp")) {
+			rule.mMatch = Rule::kDSCP;
+		} else if (strcaseequal(entry, "flowlabel")) {
+			rule.mMatch = Rule::kFlowLabel;
+		} else if (strcaseequal(entry, "port")) {
+			rule.mMatch = Rule::kPort;
+		} else {
+			goto bail;
+		}
+
+		rule.mValue = static_cast<uint32_t>(strtoul(value, &end, 0));
+		require(end != value && *end == 0, bail);
+		require(rule.mMatch != Rule::kDSCP || rule.mValue < 64, bail);
+		require(rule.mMatch != Rule::kFlowLabel || rule.mValue < (1 << 20), bail);
+		require(rule.mMatch != Rule::kPort || rule.mValue < (1 << 16), bail);
+
+		for (c = 0; c < kClassCount; c++) {
+			if (strcaseequal(class_name, kClassName[c])) {
+				break;
+			}
+		}
+
+		require(c < kClassCount, bail);
+		rule.mClass = static_cast<Class>(c);
+
+		parsed.push_back(rule);
+	}
+
+	mRules.swap(parsed);
+	ret = true;
+
+bail:
+	free(copy);
+	return ret;
+}
+
+bool
+SpinelNCPEgressScheduler::match_rule(const Rule& rule, uint8_t dscp, uint32_t flow_label, int src_port, int dst_port) const
+{
+	switch (rule.mMatch) {
+	case Rule::kDSCP:
+		return dscp == rule.mValue;
+
+	case Rule::kFlowLabel:
+		return flow_label == rule.mValue;
+
+	case Rule::kPort:
+		return (src_port == static_cast<int>(rule.mValue)) || (dst_port == static_cast<int>(rule.mValue));
+	}
+
+	return false;
+}
+
+SpinelNCPEgressScheduler::Class
+SpinelNCPEgressScheduler::classify(const uint8_t* packet, size_t len) const
+{
+	uint8_t dscp;
+	uint32_t flow_label;
+	uint8_t next_header;
+	size_t offset = IPV6_HEADER_LEN;
+	int icmp_type = -1;
+	int src_port = -1;
+	int dst_port = -1;
+
+	if ((len < IPV6_HEADER_LEN) || ((packet[0] >> 4) != 6)) {
+		return kClassDefault;
+	}
+
+	dscp = static_cast<uint8_t>((((packet[0] & 0x0F) << 4) | (packet[1] >> 4)) >> 2);
+	flow_label = (static_cast<uint32_t>(packet[1] & 0x0F) << 16) | (packet[2] << 8) | packet[3];
+	next_header = packet[6];
+
+	// Skip over the extension headers which may come before the
+	// transport header. Fragments are left alone.
+	while ((next_header == IPPROTO_NUM_HOPOPTS)
+		|| (next_header == IPPROTO_NUM_ROUTING)
+		|| (next_header == IPPROTO_NUM_DSTOPTS)
+	) {
+		if (offset + 2 > len) {
+			break;
+		}
+		next_header = packet[offset];
+		offset += (packet[offset + 1] + 1) * 8;
+	}
+
+	if (offset < len) {
+		if (next_header == IPPROTO_NUM_ICMPV6) {
+			icmp_type = packet[offset];
+
+		} else if (((next_header == IPPROTO_NUM_UDP) || (next_header == IPPROTO_NUM_TCP)) && (offset + 4 <= len)) {
+			src_port = (packet[offset] << 8) | packet[offset + 1];
+			dst_port = (packet[offset + 2] << 8) | packet[offset + 3];
+		}
+	}
+
+	for (std::vector<Rule>::const_iterator iter = mRules.begin(); iter != mRules.end(); ++iter) {
+		if (match_rule(*iter, dscp, flow_label, src_port, dst_port)) {
+			return iter->mClass;
+		}
+	}
+
+	switch (dscp) {
+	case 48: // CS6
+	case 56: // CS7
+		return kClassNetworkControl;
+
+	case 46: // EF
+	case 40: // CS5
+	case 32: // CS4
+	case 34: case 36: case 38: // AF4x
+	case 26: case 28: case 30: // AF3x
+		return kClassInteractive;
+
+	case 8:  // CS1
+	case 1:  // LE
+		return kClassBulk;
+	}
+
+	if (icmp_type >= 0) {
+		// Neighbor discovery, MLD and errors are control traffic, pings aren't.
+		if ((icmp_type == ICMPV6_TYPE_ECHO_REQUEST) || (icmp_type == ICMPV6_TYPE_ECHO_REPLY)) {
+			return kClassInteractive;
+		}
+		return kClassNetworkControl;
+	}
+
+	if ((src_port == UDP_PORT_MLE) || (dst_port == UDP_PORT_MLE)) {
+		return kClassNetworkControl;
+	}
+
+	if ((dst_port == UDP_PORT_COAP) || (src_port == UDP_PORT_COAP)
+		|| (dst_port == UDP_PORT_COAPS) || (src_port == UDP_PORT_COAPS)
+		|| (dst_port == UDP_PORT_TMF) || (src_port == UDP_PORT_TMF)
+	) {
+		return kClassInteractive;
+	}
+
+	return kClassDefault;
+}
+
+int
+SpinelNCPEgressScheduler::get_free_slot(void)
+{
+	int slot = mFreeList;
+
+	if (slot != kNoSlot) {
+		mFreeList = mSlots[slot].mNext;
+		mSlots[slot].mNext = kNoSlot;
+	}
+
+	return slot;
+}
+
+void
+SpinelNCPEgressScheduler::release(int slot)
+{
+	mSlots[slot].mNext = mFreeList;
+	mFreeList = slot;
+}
+
+bool
+SpinelNCPEgressScheduler::enqueue(int slot, size_t len, uint8_t frame_type)
+{
+	Slot& packet = mSlots[slot];
+	const Class c = classify(packet.mPacket, len);
+	Queue* queue = &mQueues[c];
+
+	if (queue->mDepth >= kQueueLimit[queue - mQueues]) {
+		queue->mDropped++;
+		release(slot);
+		return false;
+	}
+
+	packet.mLen = static_cast<uint16_t>(len);
+	packet.mFrameType = frame_type;
+	packet.mEnqueueTime = time_us();
+	packet.mHeld = is_holding() && (kHoldTime[c] != 0);
+	packet.mNext = kNoSlot;
+
+	if (queue->mTail == kNoSlot) {
+		queue->mHead = slot;
+	} else {
+		mSlots[queue->mTail].mNext = slot;
+	}
+	queue->mTail = slot;
+
+	queue->mEnqueued++;
+	queue->mDepth++;
+	if (queue->mPeakDepth < queue->mDepth) {
+		queue->mPeakDepth = queue->mDepth;
+	}
+	mQueued++;
+
+	// Holding on any longer would only cost packets.
+	if (packet.mHeld && (queue->mDepth >= kQueueLimit[c])) {
+		release_held(&mReleasedOnFull);
+	}
+
+	return true;
+}
+
+int
+SpinelNCPEgressScheduler::pop(Class c)
+{
+	Queue& queue = mQueues[c];
+	int slot = queue.mHead;
+
+	queue.mHead = mSlots[slot].mNext;
+	if (queue.mHead == kNoSlot) {
+		queue.mTail = kNoSlot;
+	}
+	queue.mDepth--;
+	mQueued--;
+
+	return slot;
+}
+
+size_t
+SpinelNCPEgressScheduler::dequeue(uint8_t* packet, uint8_t* frame_type)
+{
+	Class c = kClassNetworkControl;
+	int slot;
+	uint32_t latency;
+	size_t len;
+
+	if (mQueued == 0) {
+		return 0;
+	}
+
+	if (is_holding()) {
+		// Whatever goes out wakes the NCP up, so everything which is
+		// held goes out along with it.
+		if (!has_ready_packet()) {
+			return 0;
+		}
+
+		if (is_due(kClassDefault) || is_due(kClassBulk)) {
+			release_held(&mReleasedOnDeadline);
+		} else {
+			release_held(&mReleasedOnPriority);
+		}
+	}
+
+	if (mQueues[kClassNetworkControl].mDepth == 0) {
+		// Deficit round robin. Every class gets `kQuantum` bytes per unit
+		// of weight each time its turn comes, and keeps sending until the
+		// next packet no longer fits. Empty classes don't save up credit.
+		for (;;) {
+			Queue& queue = mQueues[mCurrent];
+
+			if (queue.mDepth == 0) {
+				queue.mDeficit = 0;
+
+			} else {
+				if (!mVisiting) {
+					queue.mDeficit += kQuantum * kWeight[mCurrent];
+					mVisiting = true;
+				}
+
+				if (mSlots[queue.mHead].mLen <= queue.mDeficit) {
+					queue.mDeficit -= mSlots[queue.mHead].mLen;
+					c = static_cast<Class>(mCurrent);
+					break;
+				}
+			}
+
+			mVisiting = false;
+			mCurrent = (mCurrent + 1 < kClassCount) ? mCurrent + 1 : kClassNetworkControl + 1;
+		}
+	}
+
+	slot = pop(c);
+	len = mSlots[slot].mLen;
+	latency = static_cast<uint32_t>(time_us() - mSlots[slot].mEnqueueTime);
+
+	memcpy(packet, mSlots[slot].mPacket, len);
+	*frame_type = mSlots[slot].mFrameType;
+
+	mQueues[c].mSent++;
+	mQueues[c].mBytesSent += len;
+	mQueues[c].mLatencySum += latency;
+	if (mQueues[c].mLatencyMax < latency) {
+		mQueues[c].mLatencyMax = latency;
+	}
+
+	if (mSlots[slot].mHeld) {
+		mHeldSent++;
+		mHeldLatencySum += latency;
+		if (mHeldLatencyMax < latency) {
+			mHeldLatencyMax = latency;
+		}
+	}
+
+	if (mReleasing && (mQueues[kClassDefault].mDepth == 0) && (mQueues[kClassBulk].mDepth == 0)) {
+		mReleasing = false;
+	}
+
+	release(slot);
+
+	return len;
+}
+
+void
+SpinelNCPEgressScheduler::flush(void)
+{
+	for (int c = 0; c < kClassCount; c++) {
+		while (mQueues[c].mDepth != 0) {
+			mQueues[c].mDropped++;
+			release(pop(static_cast<Class>(c)));
+		}
+		mQueues[c].mDeficit = 0;
+	}
+
+	mVisiting = false;
+	mReleasing = false;
+}
+
+void
+SpinelNCPEgressScheduler::get_counters_as_string_list(std::list<std::string> &list) const
+{
+	char line[200];
+
+	for (int c = 0; c < kClassCount; c++) {
+		const Queue& queue = mQueues[c];
+
+		snprintf(
+			line,
+			sizeof(line),
+			"%s: Queued:%u/%u Peak:%u Sent:%u Bytes:%llu Dropped:%u Latency(avg/max):%.1f/%.1fms",
+			kClassName[c],
+			queue.mDepth,
+			kQueueLimit[c],
+			queue.mPeakDepth,
+			queue.mSent,
+			static_cast<unsigned long long>(queue.mBytesSent),
+			queue.mDropped,
+			(queue.mSent != 0) ? static_cast<double>(queue.mLatencySum) / queue.mSent / 1000.0 : 0.0,
+			static_cast<double>(queue.mLatencyMax) / 1000.0
+		);
+		list.push_back(line);
+	}
+
+	if (mHoldEnabled) {
+		const uint32_t extra_wakes = mReleasedOnDeadline + mReleasedOnFull;
+
+		snprintf(
+			line,
+			sizeof(line),
+			"hold: State:%s HeldSent:%u WakesAvoided:%u Released(wake/priority/deadline/full):%u/%u/%u/%u AddedLatency(avg/max):%.1f/%.1fms",
+			!mNCPAsleep ? "ncp-awake" : (mReleasing ? "releasing" : "holding"),
+			mHeldSent,
+			(mHeldSent > extra_wakes) ? mHeldSent - extra_wakes : 0,
+			mReleasedOnWake,
+			mReleasedOnPriority,
+			mReleasedOnDeadline,
+			mReleasedOnFull,
+			(mHeldSent != 0) ? static_cast<double>(mHeldLatencySum) / mHeldSent / 1000.0 : 0.0,
+			static_cast<double>(mHeldLatencyMax) / 1000.0
+		);
+		list.push_back(line);
+	}
+}
@@ -0,0 +1,225 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Classifying egress scheduler for IPv6 packets on their way from
+ *      the network interface to the NCP.
+ *
+ *      Packets are sorted into classes by their DSCP, flow label and
+ *      ports, and held in one queue per class. Network control traffic
+ *      always goes first; the remaining classes share the link through
+ *      deficit round robin, weighted so that interactive traffic gets
+ *      more of it than bulk transfers. Each queue has its own limit, so
+ *      a bulk transfer fills (and drops from) its own queue only.
+ *
+ *      While the NCP sleeps, `default` and `bulk` packets can be held
+ *      back until the NCP wakes up for something else, so that a trickle
+ *      of such packets doesn't wake it up over and over again.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPEgressScheduler__
+#define __wpantund__SpinelNCPEgressScheduler__
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <vector>
+#include "spinel.h"
+#include "time-utils.h"
+
+namespace nl {
+namespace wpantund {
+
+class SpinelNCPEgressScheduler
+{
+public:
+	enum Class
+	{
+		kClassNetworkControl,   // ICMPv6, MLE, CS6/CS7. Strict priority.
+		kClassInteractive,      // CoAP, TMF, ping, EF/AF3x/AF4x/CS4/CS5
+		kClassDefault,
+		kClassBulk,             // CS1 and LE
+
+		kClassCount
+	};
+
+	enum
+	{
+		kNoSlot = -1,
+
+		// Largest packet which is ever read from the network interface.
+		kPacketSize = SPINEL_FRAME_BUFFER_SIZE,
+
+		// Bytes a class may send per round for each unit of its weight.
+		// At least one packet of any size, so every visit sends something.
+		kQuantum = SPINEL_FRAME_BUFFER_SIZE,
+
+		// Packets each class may hold
+		kNetworkControlQueueLimit = 8,
+		kInteractiveQueueLimit    = 16,
+		kDefaultQueueLimit        = 32,
+		kBulkQueueLimit           = 16,
+
+		// How long (in ms) packets may be held while the NCP sleeps
+		kDefaultHoldTime = 1000,
+		kBulkHoldTime    = 5000,
+	};
+
+	SpinelNCPEgressScheduler(void);
+
+	void set_enabled(bool enabled);
+	bool is_enabled(void) const { return mEnabled; }
+
+	// Sets classification rules which are checked (in order) before
+	// the built-in ones. `rules` is a list of `<match>:<value>=<class>`
+	// entries separated by commas or spaces, where `<match>` is `dscp`,
+	// `flowlabel` or `port` (source or destination, UDP or TCP), and
+	// `<class>` is `control`, `interactive`, `default` or `bulk`.
+	// Returns false, leaving the rules unchanged, if `rules` is invalid.
+	bool set_rules(const std::string& rules);
+
+	Class classify(const uint8_t* packet, size_t len) const;
+
+	// Returns a free slot for the next packet read from the network
+	// interface, or `kNoSlot` if every slot is taken.
+	int get_free_slot(void);
+	bool has_free_slot(void) const { return mFreeList != kNoSlot; }
+	uint8_t* get_packet(int slot) { return mSlots[slot].mPacket; }
+
+	// Queues the packet read into `slot` (of `len` bytes), or releases
+	// the slot if the queue of its class is full. Returns false if the
+	// packet was dropped.
+	bool enqueue(int slot, size_t len, uint8_t frame_type);
+
+	// Releases a slot from `get_free_slot()` without queueing it.
+	void release(int slot);
+
+	bool is_empty(void) const { return mQueued == 0; }
+
+	// False once every slot is taken or the queue of any class is
+	// full. Packets should then be left waiting in the network
+	// interface, so that the kernel's queueing discipline sees the
+	// backpressure instead of having them dropped here.
+	bool is_accepting(void) const;
+
+	// While enabled and the NCP is asleep, `default` and `bulk` packets
+	// are held until the NCP wakes up (or until their hold time is up,
+	// a packet of another class is sent, or their queue is full) and
+	// then go out together with everything else which is queued.
+	void set_hold_enabled(bool enabled);
+	bool is_hold_enabled(void) const { return mHoldEnabled; }
+	void set_ncp_asleep(bool asleep);
+
+	// To be called for every frame exchanged with the NCP, which is
+	// awake at that point anyway.
+	void handle_ncp_activity(void);
+
+	// Returns true if `dequeue()` has a packet to send right now.
+	bool has_ready_packet(void) const;
+
+	// Time until a held packet is due.
+	cms_t get_ms_to_next_event(void) const;
+
+	// Copies the next packet to send into `packet`, which must have room
+	// for `kPacketSize` bytes. Returns its length, or zero if nothing is
+	// queued.
+	size_t dequeue(uint8_t* packet, uint8_t* frame_type);
+
+	// Drops every queued packet, e.g. after the NCP was reset.
+	void flush(void);
+
+	void get_counters_as_string_list(std::list<std::string> &list) const;
+
+private:
+	struct Slot {
+		uint8_t mPacket[kPacketSize];
+		uint64_t mEnqueueTime;
+		uint16_t mLen;
+		uint8_t mFrameType;
+		bool mHeld;
+		int mNext;
+	};
+
+	struct Queue {
+		int mHead;
+		int mTail;
+		uint16_t mDepth;
+		uint16_t mPeakDepth;
+		uint32_t mDeficit;
+
+		uint32_t mEnqueued;
+		uint32_t mSent;
+		uint32_t mDropped;
+		uint64_t mBytesSent;
+		uint64_t mLatencySum;   // us
+		uint32_t mLatencyMax;   // us
+	};
+
+	struct Rule {
+		enum { kDSCP, kFlowLabel, kPort } mMatch;
+		uint32_t mValue;
+		Class mClass;
+	};
+
+	static const uint16_t kQueueLimit[kClassCount];
+	static const uint8_t kWeight[kClassCount];
+	static const uint16_t kHoldTime[kClassCount];
+	static const char* const kClassName[kClassCount];
+
+	enum
+	{
+		kSlotCount = kNetworkControlQueueLimit + kInteractiveQueueLimit
+		           + kDefaultQueueLimit + kBulkQueueLimit
+	};
+
+	bool match_rule(const Rule& rule, uint8_t dscp, uint32_t flow_label, int src_port, int dst_port) const;
+	int pop(Class c);
+	bool is_holding(void) const;
+	bool is_due(Class c) const;
+	void release_held(uint32_t* reason_count);
+
+	bool mEnabled;
+	Slot mSlots[kSlotCount];
+	int mFreeList;
+	Queue mQueues[kClassCount];
+	uint16_t mQueued;
+
+	// Deficit round robin among all but `kClassNetworkControl`
+	int mCurrent;
+	bool mVisiting;
+
+	std::vector<Rule> mRules;
+
+	bool mHoldEnabled;
+	bool mNCPAsleep;
+	bool mReleasing;
+	uint32_t mHeldSent;
+	uint64_t mHeldLatencySum;  // us
+	uint32_t mHeldLatencyMax;  // us
+
+	// What ended each hold
+	uint32_t mReleasedOnWake;
+	uint32_t mReleasedOnPriority;
+	uint32_t mReleasedOnDeadline;
+	uint32_t mReleasedOnFull;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPEgressScheduler__) */
@@ -0,0 +1,312 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <syslog.h>
+#include "SpinelNCPFlowControl.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+SpinelNCPFlowControl::SpinelNCPFlowControl(void):
+	mEnabled(true),
+	mPaused(false),
+	mProbePending(false),
+	mProbeUnsupported(false),
+	mRetryPending(false),
+	mWindow(kInitialWindow),
+	mInFlight(0),
+	mTotalBuffers(0),
+	mFreeBuffers(0),
+	mProbeFailures(0),
+	mProbeDeadline(0),
+	mRetryTime(0),
+	mPausedSince(0),
+	mFramesSent(0),
+	mPauseCount(0),
+	mPausedMs(0),
+	mCongestedCount(0),
+	mNCPDropCount(0),
+	mProbeCount(0),
+	mProbeTimeoutCount(0)
+{
+}
+
+void
+SpinelNCPFlowControl::set_enabled(bool enabled)
+{
+	mEnabled = enabled;
+
+	if (!mEnabled) {
+		resume();
+	}
+}
+
+void
+SpinelNCPFlowControl::reset(void)
+{
+	resume();
+
+	mProbePending = false;
+	mProbeUnsupported = false;
+	mRetryPending = false;
+	mWindow = kInitialWindow;
+	mInFlight = 0;
+	mTotalBuffers = 0;
+	mFreeBuffers = 0;
+	mProbeFailures = 0;
+}
+
+void
+SpinelNCPFlowControl::pause(void)
+{
+	if (!mPaused) {
+		mPaused = true;
+		mPausedSince = time_ms();
+		mPauseCount++;
+	}
+}
+
+void
+SpinelNCPFlowControl::resume(void)
+{
+	if (mPaused) {
+		mPaused = false;
+		mPausedMs += static_cast<uint32_t>(time_ms() - mPausedSince);
+	}
+}
+
+void
+SpinelNCPFlowControl::did_send(void)
+{
+	mFramesSent++;
+
+	// Without the buffer counters, only drops reported by the NCP
+	// slow us down.
+	if (!mEnabled || mProbeUnsupported) {
+		return;
+	}
+
+	if (mInFlight < 0xFFFF) {
+		mInFlight++;
+	}
+
+	if (mInFlight >= mWindow) {
+		pause();
+	}
+}
+
+bool
+SpinelNCPFlowControl::wants_probe(void) const
+{
+	return mEnabled
+		&& mPaused
+		&& !mProbeUnsupported
+		&& !mProbePending
+		&& !mRetryPending;
+}
+
+void
+SpinelNCPFlowControl::probe_started(void)
+{
+	mProbePending = true;
+	mProbeDeadline = time_ms() + kProbeTimeout;
+	mProbeCount++;
+}
+
+void
+SpinelNCPFlowControl::handle_buffer_counters(uint16_t total_buffers, uint16_t free_buffers)
+{
+	const uint16_t low_watermark = total_buffers / kLowWatermarkDivisor;
+
+	mTotalBuffers = total_buffers;
+	mFreeBuffers = free_buffers;
+
+	// A reply which took longer than `kProbeTimeout` has already
+	// been given up on, and another probe may be on its way.
+	if (!mProbePending) {
+		return;
+	}
+
+	mProbePending = false;
+	mProbeFailures = 0;
+
+	if (free_buffers < low_watermark) {
+		mCongestedCount++;
+		mWindow = (mWindow / 2 > kMinWindow) ? mWindow / 2 : kMinWindow;
+		mRetryPending = true;
+		mRetryTime = time_ms() + kRetryInterval;
+
+	} else {
+		const uint16_t headroom = (free_buffers - low_watermark) / kBuffersPerFrame;
+
+		if (mWindow < kMaxWindow) {
+			mWindow++;
+		}
+
+		if (mWindow > headroom) {
+			mWindow = (headroom > kMinWindow) ? headroom : kMinWindow;
+		}
+
+		mInFlight = 0;
+		resume();
+	}
+}
+
+void
+SpinelNCPFlowControl::handle_probe_failed(bool unsupported)
+{
+	if (mProbePending) {
+		probe_failed(unsupported);
+	}
+}
+
+void
+SpinelNCPFlowControl::probe_failed(bool unsupported)
+{
+	mProbePending = false;
+
+	if (unsupported || (++mProbeFailures >= kMaxProbeFailures)) {
+		syslog(LOG_NOTICE, "Flow control: NCP message buffer counters are unavailable, relying on reported drops only");
+		mProbeUnsupported = true;
+	}
+
+	mInFlight = 0;
+	resume();
+}
+
+void
+SpinelNCPFlowControl::handle_ncp_drop(void)
+{
+	mNCPDropCount++;
+
+	if (!mEnabled) {
+		return;
+	}
+
+	mWindow = (mWindow / 2 > kMinWindow) ? mWindow / 2 : kMinWindow;
+
+	if (mProbeUnsupported) {
+		// Back off for a little while instead.
+		pause();
+		mRetryPending = true;
+		mRetryTime = time_ms() + kRetryInterval;
+
+	} else if (mInFlight >= mWindow) {
+		pause();
+	}
+}
+
+void
+SpinelNCPFlowControl::process(void)
+{
+	cms_t now;
+
+	if (!mProbePending && !mRetryPending) {
+		return;
+	}
+
+	now = time_ms();
+
+	if (mProbePending && (now - mProbeDeadline >= 0)) {
+		// The NCP is probably busy with something else. Carry on,
+		// more carefully.
+		mProbeTimeoutCount++;
+		mWindow = (mWindow / 2 > kMinWindow) ? mWindow / 2 : kMinWindow;
+		probe_failed(false);
+	}
+
+	if (mRetryPending && (now - mRetryTime >= 0)) {
+		mRetryPending = false;
+
+		if (mProbeUnsupported) {
+			mInFlight = 0;
+			resume();
+		}
+	}
+}
+
+cms_t
+SpinelNCPFlowControl::get_ms_to_next_event(void) const
+{
+	cms_t cms = CMS_DISTANT_FUTURE;
+	cms_t now;
+
+	if (wants_probe()) {
+		return 0;
+	}
+
+	if (!mProbePending && !mRetryPending) {
+		return cms;
+	}
+
+	now = time_ms();
+
+	if (mProbePending && (mProbeDeadline - now < cms)) {
+		cms = mProbeDeadline - now;
+	}
+
+	if (mRetryPending && (mRetryTime - now < cms)) {
+		cms = mRetryTime - now;
+	}
+
+	return (cms > 0) ? cms : 0;
+}
+
+void
+SpinelNCPFlowControl::get_counters_as_string_list(std::list<std::string> &list) const
+{
+	char line[160];
+
+	snprintf(
+		line,
+		sizeof(line),
+		"State: %s Window:%u InFlight:%u",
+		!mEnabled ? "disabled" : (mPaused ? "paused" : "sending"),
+		mWindow,
+		mInFlight
+	);
+	list.push_back(line);
+
+	if (mProbeUnsupported) {
+		snprintf(line, sizeof(line), "NCPBuffers: unavailable");
+	} else {
+		snprintf(line, sizeof(line), "NCPBuffers: Free:%u Total:%u", mFreeBuffers, mTotalBuffers);
+	}
+	list.push_back(line);
+
+	snprintf(
+		line,
+		sizeof(line),
+		"Packets: Sent:%u Pauses:%u PausedMs:%u Congested:%u NCPDrops:%u",
+		mFramesSent,
+		mPauseCount,
+		mPausedMs + (mPaused ? static_cast<uint32_t>(time_ms() - mPausedSince) : 0),
+		mCongestedCount,
+		mNCPDropCount
+	);
+	list.push_back(line);
+
+	snprintf(line, sizeof(line), "Probes: Sent:%u TimedOut:%u", mProbeCount, mProbeTimeoutCount);
+	list.push_back(line);
+}
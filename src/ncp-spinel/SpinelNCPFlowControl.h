@@ -0,0 +1,138 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Flow control of IPv6 packets from the network interface to the NCP.
+ *
+ *      Data frames go to the NCP without a TID, so nothing tells us
+ *      when the NCP is done with them. Instead, after every window's
+ *      worth of packets, reading from the network interface stops
+ *      until the NCP reports (through `SPINEL_PROP_MSG_BUFFER_COUNTERS`)
+ *      that it has enough free message buffers. Meanwhile packets queue
+ *      up in the egress queues (see `SpinelNCPEgressScheduler`) and in
+ *      the kernel, which drop them once they are full. The window grows by one frame for every report
+ *      with room to spare, and is halved whenever the NCP runs low on
+ *      buffers or reports having dropped a packet.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPFlowControl__
+#define __wpantund__SpinelNCPFlowControl__
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include "time-utils.h"
+
+namespace nl {
+namespace wpantund {
+
+class SpinelNCPFlowControl
+{
+public:
+	enum
+	{
+		kInitialWindow       = 8,
+		kMinWindow           = 1,
+		kMaxWindow           = 64,
+
+		// An IPv6 packet of the usual size takes about this many
+		// of the NCP's message buffers.
+		kBuffersPerFrame     = 4,
+
+		// The NCP is congested while fewer than one in this many of
+		// its message buffers are free.
+		kLowWatermarkDivisor = 4,
+
+		// How long to wait for a reply before carrying on without one.
+		kProbeTimeout        = 250, // ms
+
+		// How long to wait before asking a congested NCP again.
+		kRetryInterval       = 20,  // ms
+
+		// Give up asking after this many probes in a row went unanswered.
+		kMaxProbeFailures    = 3,
+	};
+
+public:
+	SpinelNCPFlowControl(void);
+
+	void set_enabled(bool enabled);
+	bool is_enabled(void) const { return mEnabled; }
+
+	// Forgets everything learned about the NCP, e.g. after it was reset.
+	void reset(void);
+
+	// False while packets should be left waiting in the network interface.
+	bool can_send(void) const { return !mEnabled || !mPaused; }
+
+	// To be called for every packet read from the network interface.
+	void did_send(void);
+
+	// True if the NCP should be asked for its message buffer counters.
+	// `probe_started()` is to be called once that request is sent.
+	bool wants_probe(void) const;
+	void probe_started(void);
+	bool is_probe_pending(void) const { return mProbePending; }
+
+	void handle_buffer_counters(uint16_t total_buffers, uint16_t free_buffers);
+	void handle_probe_failed(bool unsupported);
+
+	// The NCP reported (without a TID) that it dropped a packet or ran
+	// out of memory.
+	void handle_ncp_drop(void);
+
+	// Handles timeouts.
+	void process(void);
+	cms_t get_ms_to_next_event(void) const;
+
+	void get_counters_as_string_list(std::list<std::string> &list) const;
+
+private:
+	void pause(void);
+	void resume(void);
+	void probe_failed(bool unsupported);
+
+	bool mEnabled;
+	bool mPaused;
+	bool mProbePending;      // Waiting for a reply before resuming
+	bool mProbeUnsupported;
+	bool mRetryPending;
+
+	uint16_t mWindow;
+	uint16_t mInFlight;
+	uint16_t mTotalBuffers;
+	uint16_t mFreeBuffers;
+	uint16_t mProbeFailures;
+
+	cms_t mProbeDeadline;
+	cms_t mRetryTime;
+	cms_t mPausedSince;
+
+	uint32_t mFramesSent;
+	uint32_t mPauseCount;
+	uint32_t mPausedMs;
+	uint32_t mCongestedCount;
+	uint32_t mNCPDropCount;
+	uint32_t mProbeCount;
+	uint32_t mProbeTimeoutCount;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPFlowControl__) */
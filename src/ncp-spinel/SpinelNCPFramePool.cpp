@@ -0,0 +1,97 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "assert-macros.h"
+#include "SpinelNCPFramePool.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+SpinelNCPFramePool::SpinelNCPFramePool():
+	mAvailable(SPINEL_NCP_FRAME_POOL_SIZE)
+{
+	for (int i = 0; i < SPINEL_NCP_FRAME_POOL_SIZE; i++) {
+		mSlots[i].mFrameLen = 0;
+		mSlots[i].mInUse = false;
+	}
+}
+
+int
+SpinelNCPFramePool::pack(const char* pack_format, ...)
+{
+	va_list args;
+	int slot;
+
+	va_start(args, pack_format);
+	slot = vpack(pack_format, args);
+	va_end(args);
+
+	return slot;
+}
+
+int
+SpinelNCPFramePool::vpack(const char* pack_format, va_list args)
+{
+	int slot = kNoSlot;
+	spinel_ssize_t packed_size;
+
+	require_quiet(mAvailable > 0, bail);
+
+	for (slot = 0; mSlots[slot].mInUse; slot++) { }
+
+	packed_size = spinel_datatype_vpack(mSlots[slot].mFrame, sizeof(mSlots[slot].mFrame), pack_format, args);
+
+	if ((packed_size <= 0) || (packed_size > static_cast<spinel_ssize_t>(sizeof(mSlots[slot].mFrame)))) {
+		slot = kNoSlot;
+		goto bail;
+	}
+
+	mSlots[slot].mFrameLen = static_cast<spinel_size_t>(packed_size);
+	mSlots[slot].mInUse = true;
+	mAvailable--;
+
+bail:
+	return slot;
+}
+
+uint8_t*
+SpinelNCPFramePool::get_frame(int slot)
+{
+	return mSlots[slot].mFrame;
+}
+
+spinel_size_t
+SpinelNCPFramePool::get_frame_len(int slot) const
+{
+	return mSlots[slot].mFrameLen;
+}
+
+void
+SpinelNCPFramePool::release(int slot)
+{
+	if ((slot >= 0) && (slot < SPINEL_NCP_FRAME_POOL_SIZE) && mSlots[slot].mInUse) {
+		mSlots[slot].mInUse = false;
+		mSlots[slot].mFrameLen = 0;
+		mAvailable++;
+	}
+}
@@ -0,0 +1,84 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Preallocated outbound Spinel frames.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPFramePool__
+#define __wpantund__SpinelNCPFramePool__
+
+#include <stdint.h>
+#include <stdarg.h>
+#include "spinel.h"
+
+namespace nl {
+namespace wpantund {
+
+// Number of outbound frames which can be built at the same time
+#define SPINEL_NCP_FRAME_POOL_SIZE              4
+
+// Bytes reserved in front of each frame, so that the length header of
+// the FLEN framing can be written out together with the frame.
+#define SPINEL_NCP_FRAME_HEADROOM               3
+
+// A fixed set of frame slots, each large enough for any Spinel frame.
+//
+// Tasks pack a command directly into a free slot and hand the slot
+// index to the data pump, which sends the frame straight from the slot
+// and then releases it. Building and sending a command therefore
+// neither allocates nor copies the frame.
+class SpinelNCPFramePool
+{
+public:
+	enum {
+		kNoSlot = -1,
+		kFrameSize = SPINEL_FRAME_BUFFER_SIZE,
+	};
+
+	SpinelNCPFramePool();
+
+	// Packs a frame (using the same arguments as `spinel_datatype_pack()`)
+	// into a free slot. Returns the slot index or `kNoSlot` if every slot
+	// is in use or if the frame can't be packed.
+	int pack(const char* pack_format, ...);
+	int vpack(const char* pack_format, va_list args);
+
+	uint8_t* get_frame(int slot);
+	spinel_size_t get_frame_len(int slot) const;
+
+	void release(int slot);
+
+	int get_available(void) const { return mAvailable; }
+
+private:
+	struct Slot {
+		uint8_t mHeadroom[SPINEL_NCP_FRAME_HEADROOM];
+		uint8_t mFrame[kFrameSize];
+		spinel_size_t mFrameLen;
+		bool mInUse;
+	};
+
+	Slot mSlots[SPINEL_NCP_FRAME_POOL_SIZE];
+	int mAvailable;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPFramePool__) */
@@ -0,0 +1,187 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <syslog.h>
+#include "SpinelNCPFrameTrace.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+static const char *
+spinel_command_to_cstr(unsigned int command)
+{
+	const char *ret = NULL;
+
+	switch (command) {
+	case SPINEL_CMD_NOOP:                 ret = "NOOP";                 break;
+	case SPINEL_CMD_RESET:                ret = "RESET";                break;
+	case SPINEL_CMD_PROP_VALUE_GET:       ret = "PROP_VALUE_GET";       break;
+	case SPINEL_CMD_PROP_VALUE_SET:       ret = "PROP_VALUE_SET";       break;
+	case SPINEL_CMD_PROP_VALUE_INSERT:    ret = "PROP_VALUE_INSERT";    break;
+	case SPINEL_CMD_PROP_VALUE_REMOVE:    ret = "PROP_VALUE_REMOVE";    break;
+	case SPINEL_CMD_PROP_VALUE_IS:        ret = "PROP_VALUE_IS";        break;
+	case SPINEL_CMD_PROP_VALUE_INSERTED:  ret = "PROP_VALUE_INSERTED";  break;
+	case SPINEL_CMD_PROP_VALUE_REMOVED:   ret = "PROP_VALUE_REMOVED";   break;
+	case SPINEL_CMD_NET_SAVE:             ret = "NET_SAVE";             break;
+	case SPINEL_CMD_NET_CLEAR:            ret = "NET_CLEAR";            break;
+	case SPINEL_CMD_NET_RECALL:           ret = "NET_RECALL";           break;
+	case SPINEL_CMD_PEEK:                 ret = "PEEK";                 break;
+	case SPINEL_CMD_PEEK_RET:             ret = "PEEK_RET";             break;
+	case SPINEL_CMD_POKE:                 ret = "POKE";                 break;
+	case SPINEL_CMD_PROP_VALUE_MULTI_GET: ret = "PROP_VALUE_MULTI_GET"; break;
+	case SPINEL_CMD_PROP_VALUE_MULTI_SET: ret = "PROP_VALUE_MULTI_SET"; break;
+	case SPINEL_CMD_PROP_VALUES_ARE:      ret = "PROP_VALUES_ARE";      break;
+	default:                                                            break;
+	}
+
+	return ret;
+}
+
+static bool
+spinel_command_has_prop_key(unsigned int command)
+{
+	return ((command >= SPINEL_CMD_PROP_VALUE_GET) && (command <= SPINEL_CMD_PROP_VALUE_REMOVED));
+}
+
+SpinelNCPFrameTrace::SpinelNCPFrameTrace(void)
+{
+	clear();
+}
+
+void
+SpinelNCPFrameTrace::clear(void)
+{
+	mEntries.clear();
+	mTotalRecorded = 0;
+}
+
+void
+SpinelNCPFrameTrace::record(Direction direction, const uint8_t *frame_ptr, spinel_size_t frame_len)
+{
+	Entry entry;
+	unsigned int value = 0;
+	spinel_ssize_t len;
+
+	entry.mTimestamp = time_ms();
+	entry.mDirection = static_cast<uint8_t>(direction);
+	entry.mHeader = (frame_len > 0) ? frame_ptr[0] : 0;
+	entry.mLength = (frame_len > 0xFFFF) ? 0xFFFF : static_cast<uint16_t>(frame_len);
+	entry.mCommand = 0;
+	entry.mKey = 0;
+
+	// Only the packed command and property key are decoded here; this is
+	// called for every frame, so keep it away from the pack-format parser.
+	if (frame_len > 1) {
+		len = spinel_packed_uint_decode(frame_ptr + 1, frame_len - 1, &value);
+
+		if (len > 0) {
+			entry.mCommand = value;
+
+			if (spinel_command_has_prop_key(value)
+			 && (spinel_packed_uint_decode(frame_ptr + 1 + len, frame_len - 1 - len, &value) > 0)
+			) {
+				entry.mKey = value;
+			}
+		}
+	}
+
+	mEntries.force_write(entry);
+	mTotalRecorded++;
+}
+
+std::string
+SpinelNCPFrameTrace::entry_to_string(const Entry &entry, cms_t now)
+{
+	char c_string[200];
+	char command_string[32];
+	const char *command_cstr = spinel_command_to_cstr(entry.mCommand);
+
+	if (command_cstr == NULL) {
+		snprintf(command_string, sizeof(command_string), "CMD(0x%X)", entry.mCommand);
+		command_cstr = command_string;
+	}
+
+	if (spinel_command_has_prop_key(entry.mCommand)) {
+		snprintf(
+			c_string,
+			sizeof(c_string),
+			"%8dms %s %s(%s) iid:%d tid:%d len:%d",
+			static_cast<int>(now - entry.mTimestamp),
+			(entry.mDirection == kDirectionToNCP) ? "[->NCP]" : "[NCP->]",
+			command_cstr,
+			spinel_prop_key_to_cstr(static_cast<spinel_prop_key_t>(entry.mKey)),
+			SPINEL_HEADER_GET_IID(entry.mHeader),
+			SPINEL_HEADER_GET_TID(entry.mHeader),
+			entry.mLength
+		);
+	} else {
+		snprintf(
+			c_string,
+			sizeof(c_string),
+			"%8dms %s %s iid:%d tid:%d len:%d",
+			static_cast<int>(now - entry.mTimestamp),
+			(entry.mDirection == kDirectionToNCP) ? "[->NCP]" : "[NCP->]",
+			command_cstr,
+			SPINEL_HEADER_GET_IID(entry.mHeader),
+			SPINEL_HEADER_GET_TID(entry.mHeader),
+			entry.mLength
+		);
+	}
+
+	return c_string;
+}
+
+void
+SpinelNCPFrameTrace::convert_to_string_list(std::list<std::string> &list) const
+{
+	RingBuffer<Entry, kMaxEntries>::Iterator iter;
+	cms_t now = time_ms();
+	char c_string[100];
+
+	snprintf(
+		c_string,
+		sizeof(c_string),
+		"Frame trace: %d of %u frames (oldest first, age before now)",
+		get_count(),
+		mTotalRecorded
+	);
+	list.push_back(c_string);
+
+	for (iter = mEntries.begin(); iter != mEntries.end(); ++iter) {
+		list.push_back(entry_to_string(*iter, now));
+	}
+}
+
+void
+SpinelNCPFrameTrace::dump_to_syslog(int priority) const
+{
+	std::list<std::string> list;
+	std::list<std::string>::const_iterator iter;
+
+	convert_to_string_list(list);
+
+	for (iter = list.begin(); iter != list.end(); ++iter) {
+		syslog(priority, "%s", iter->c_str());
+	}
+}
@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Fixed-size binary trace of Spinel frames exchanged with the NCP.
+ *
+ *      Recording a frame only decodes the header, command and property
+ *      key into a fixed-size entry; no string formatting is done until
+ *      the trace is dumped.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPFrameTrace__
+#define __wpantund__SpinelNCPFrameTrace__
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include "spinel.h"
+#include "time-utils.h"
+#include "RingBuffer.h"
+
+namespace nl {
+namespace wpantund {
+
+class SpinelNCPFrameTrace
+{
+public:
+	enum Direction
+	{
+		kDirectionToNCP   = 0,
+		kDirectionFromNCP = 1,
+	};
+
+	struct Entry
+	{
+		cms_t    mTimestamp;
+		uint32_t mCommand;
+		uint32_t mKey;
+		uint16_t mLength;
+		uint8_t  mHeader;
+		uint8_t  mDirection;
+	};
+
+	enum
+	{
+		kMaxEntries = 256,
+	};
+
+public:
+	SpinelNCPFrameTrace(void);
+
+	void record(Direction direction, const uint8_t *frame_ptr, spinel_size_t frame_len);
+	void clear(void);
+
+	int get_count(void) const { return mEntries.size(); }
+	uint32_t get_total_recorded(void) const { return mTotalRecorded; }
+
+	void convert_to_string_list(std::list<std::string> &list) const;
+	void dump_to_syslog(int priority) const;
+
+	static std::string entry_to_string(const Entry &entry, cms_t now);
+
+private:
+	RingBuffer<Entry, kMaxEntries> mEntries;
+	uint32_t mTotalRecorded;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPFrameTrace__) */
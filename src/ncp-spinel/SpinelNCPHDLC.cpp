@@ -0,0 +1,209 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "SpinelNCPHDLC.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+bool
+nl::wpantund::hdlc_byte_needs_escape(uint8_t byte)
+{
+	switch(byte) {
+	case HDLC_BYTE_SPECIAL:
+	case HDLC_BYTE_ESC:
+	case HDLC_BYTE_FLAG:
+	case HDLC_BYTE_XOFF:
+	case HDLC_BYTE_XON:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+uint16_t
+nl::wpantund::hdlc_crc16(uint16_t aFcs, uint8_t aByte)
+{
+#if 1
+	// CRC-16/CCITT, CRC-16/CCITT-TRUE, CRC-CCITT
+	// width=16 poly=0x1021 init=0x0000 refin=true refout=true xorout=0x0000 check=0x2189 name="KERMIT"
+	// http://reveng.sourceforge.net/crc-catalogue/16.htm#crc.cat.kermit
+    static const uint16_t sFcsTable[256] =
+    {
+        0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+        0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+        0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+        0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+        0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+        0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+        0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+        0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+        0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+        0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+        0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+        0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+        0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+        0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+        0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+        0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+        0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+        0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+        0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+        0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+        0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+        0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+        0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+        0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+        0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+        0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+        0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+        0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+        0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+        0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+        0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+        0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
+    };
+    return (aFcs >> 8) ^ sFcsTable[(aFcs ^ aByte) & 0xff];
+#else
+	// CRC-16/CCITT-FALSE, same CRC as 802.15.4
+	// width=16 poly=0x1021 init=0xffff refin=false refout=false xorout=0x0000 check=0x29b1 name="CRC-16/CCITT-FALSE"
+	// http://reveng.sourceforge.net/crc-catalogue/16.htm#crc.cat.crc-16-ccitt-false
+	aFcs = (uint16_t)((aFcs >> 8) | (aFcs << 8));
+	aFcs ^= aByte;
+	aFcs ^= ((aFcs & 0xff) >> 4);
+	aFcs ^= (aFcs << 12);
+	aFcs ^= ((aFcs & 0xff) << 5);
+	return aFcs;
+#endif
+}
+
+static spinel_size_t
+hdlc_append_byte(uint8_t byte, uint8_t* out_ptr, spinel_size_t out_index)
+{
+	if (hdlc_byte_needs_escape(byte)) {
+		out_ptr[out_index++] = HDLC_BYTE_ESC;
+		out_ptr[out_index++] = byte ^ HDLC_ESCAPE_XFORM;
+	} else {
+		out_ptr[out_index++] = byte;
+	}
+
+	return out_index;
+}
+
+spinel_size_t
+nl::wpantund::hdlc_encode_frame(const uint8_t* frame_ptr, spinel_size_t frame_len, uint8_t* out_ptr, spinel_size_t out_len)
+{
+	spinel_size_t out_index = 0;
+	spinel_size_t i;
+	uint16_t crc(0xFFFF);
+
+	if (out_len < HDLC_ENCODED_SIZE(frame_len)) {
+		return 0;
+	}
+
+	out_ptr[out_index++] = HDLC_BYTE_FLAG;
+
+	for (i = 0; i < frame_len; i++) {
+		crc = hdlc_crc16(crc, frame_ptr[i]);
+		out_index = hdlc_append_byte(frame_ptr[i], out_ptr, out_index);
+	}
+
+	crc ^= 0xFFFF;
+	out_index = hdlc_append_byte(crc & 0xFF, out_ptr, out_index);
+	out_index = hdlc_append_byte((crc >> 8) & 0xFF, out_ptr, out_index);
+
+	out_ptr[out_index++] = HDLC_BYTE_FLAG;
+
+	return out_index;
+}
+
+bool
+nl::wpantund::hdlc_frame_crc_is_valid(const uint8_t* frame_ptr, spinel_size_t frame_len_with_crc)
+{
+	uint16_t crc(0xFFFF);
+	spinel_size_t i;
+
+	if (frame_len_with_crc < 2) {
+		return false;
+	}
+
+	for (i = 0; i < frame_len_with_crc - 2; i++) {
+		crc = hdlc_crc16(crc, frame_ptr[i]);
+	}
+
+	crc ^= 0xFFFF;
+
+	return crc == (frame_ptr[i] | (frame_ptr[i + 1] << 8));
+}
+
+HDLCDecoder::HDLCDecoder(void)
+{
+	reset();
+}
+
+void
+HDLCDecoder::reset(void)
+{
+	mFrameSize = 0;
+	mEscaped = false;
+	mOverflow = false;
+	mComplete = false;
+}
+
+bool
+HDLCDecoder::decode(uint8_t byte)
+{
+	if (mComplete) {
+		reset();
+	}
+
+	if (byte == HDLC_BYTE_FLAG) {
+		if (!mOverflow && (mFrameSize > 2)) {
+			mComplete = true;
+			return true;
+		}
+
+		reset();
+		return false;
+	}
+
+	if (byte == HDLC_BYTE_ESC) {
+		mEscaped = true;
+		return false;
+	}
+
+	if (mEscaped) {
+		byte ^= HDLC_ESCAPE_XFORM;
+		mEscaped = false;
+	}
+
+	if (mFrameSize >= sizeof(mFrame)) {
+		mOverflow = true;
+		return false;
+	}
+
+	mFrame[mFrameSize++] = byte;
+
+	return false;
+}
@@ -0,0 +1,83 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      HDLC-lite framing shared by the main-loop data pumps and the
+ *      data-plane thread.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPHDLC__
+#define __wpantund__SpinelNCPHDLC__
+
+#include <stdint.h>
+#include "spinel.h"
+
+#define HDLC_BYTE_FLAG             0x7E
+#define HDLC_BYTE_ESC              0x7D
+#define HDLC_BYTE_XON              0x11
+#define HDLC_BYTE_XOFF             0x13
+#define HDLC_BYTE_SPECIAL          0xF8
+#define HDLC_ESCAPE_XFORM          0x20
+
+// Worst case encoded size of a frame: every byte (including the two
+// CRC bytes) escaped, plus the leading and trailing flag bytes.
+#define HDLC_ENCODED_SIZE(len)     (((len) + 2) * 2 + 2)
+
+namespace nl {
+namespace wpantund {
+
+bool hdlc_byte_needs_escape(uint8_t byte);
+
+uint16_t hdlc_crc16(uint16_t fcs, uint8_t byte);
+
+// Escapes `frame_ptr` and appends the CRC and flag bytes. Returns the
+// number of bytes written to `out_ptr`, or zero if `out_len` is too small.
+spinel_size_t hdlc_encode_frame(const uint8_t* frame_ptr, spinel_size_t frame_len, uint8_t* out_ptr, spinel_size_t out_len);
+
+// Checks the two CRC bytes at the end of a decoded frame.
+bool hdlc_frame_crc_is_valid(const uint8_t* frame_ptr, spinel_size_t frame_len_with_crc);
+
+// Incremental HDLC-lite decoder.
+class HDLCDecoder
+{
+public:
+	HDLCDecoder(void);
+
+	void reset(void);
+
+	// Returns true once `byte` completes a frame, which is then
+	// available from `get_frame()` (CRC bytes included) until the
+	// next call.
+	bool decode(uint8_t byte);
+
+	const uint8_t* get_frame(void) const { return mFrame; }
+	uint8_t* get_frame(void) { return mFrame; }
+	spinel_size_t get_frame_size(void) const { return mFrameSize; }
+
+private:
+	uint8_t mFrame[SPINEL_FRAME_BUFFER_SIZE + 2];
+	spinel_size_t mFrameSize;
+	bool mEscaped;
+	bool mOverflow;
+	bool mComplete;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPHDLC__) */
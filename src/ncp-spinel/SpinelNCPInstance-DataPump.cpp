@@ -26,10 +26,14 @@
 #include "assert-macros.h"
 #include <syslog.h>
 #include <errno.h>
+#include <stdio.h>
 #include "socket-utils.h"
 #include <stdexcept>
 #include <sys/file.h>
 #include "SuperSocket.h"
+#include "SpinelNCPHDLC.h"
+#include "spinel-extra.h"
+#include "any-to.h"
 
 #if OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER
 #include "spinel_encrypter.hpp"
@@ -38,85 +42,6 @@
 using namespace nl;
 using namespace wpantund;
 
-#define HDLC_BYTE_FLAG             0x7E
-#define HDLC_BYTE_ESC              0x7D
-#define HDLC_BYTE_XON              0x11
-#define HDLC_BYTE_XOFF             0x13
-#define HDLC_BYTE_SPECIAL          0xF8
-#define HDLC_ESCAPE_XFORM          0x20
-
-static bool
-hdlc_byte_needs_escape(uint8_t byte)
-{
-	switch(byte) {
-	case HDLC_BYTE_SPECIAL:
-	case HDLC_BYTE_ESC:
-	case HDLC_BYTE_FLAG:
-	case HDLC_BYTE_XOFF:
-	case HDLC_BYTE_XON:
-		return true;
-
-	default:
-		return false;
-	}
-}
-
-static uint16_t
-hdlc_crc16(uint16_t aFcs, uint8_t aByte)
-{
-#if 1
-	// CRC-16/CCITT, CRC-16/CCITT-TRUE, CRC-CCITT
-	// width=16 poly=0x1021 init=0x0000 refin=true refout=true xorout=0x0000 check=0x2189 name="KERMIT"
-	// http://reveng.sourceforge.net/crc-catalogue/16.htm#crc.cat.kermit
-    static const uint16_t sFcsTable[256] =
-    {
-        0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
-        0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
-        0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
-        0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
-        0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
-        0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
-        0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
-        0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
-        0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
-        0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
-        0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
-        0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
-        0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
-        0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
-        0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
-        0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
-        0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
-        0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
-        0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
-        0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
-        0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
-        0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
-        0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
-        0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
-        0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
-        0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
-        0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
-        0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
-        0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
-        0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
-        0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
-        0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
-    };
-    return (aFcs >> 8) ^ sFcsTable[(aFcs ^ aByte) & 0xff];
-#else
-	// CRC-16/CCITT-FALSE, same CRC as 802.15.4
-	// width=16 poly=0x1021 init=0xffff refin=false refout=false xorout=0x0000 check=0x29b1 name="CRC-16/CCITT-FALSE"
-	// http://reveng.sourceforge.net/crc-catalogue/16.htm#crc.cat.crc-16-ccitt-false
-	aFcs = (uint16_t)((aFcs >> 8) | (aFcs << 8));
-	aFcs ^= aByte;
-	aFcs ^= ((aFcs & 0xff) >> 4);
-	aFcs ^= (aFcs << 12);
-	aFcs ^= ((aFcs & 0xff) << 5);
-	return aFcs;
-#endif
-}
-
 char
 SpinelNCPInstance::ncp_to_driver_pump()
 {
@@ -134,6 +59,11 @@ SpinelNCPInstance::ncp_to_driver_pump()
 		process_event(EVENT_NCP_CONN_RESET);
 	}
 
+	if (mDataPlane.is_running()) {
+		data_plane_receive();
+		return PT_WAITING;
+	}
+
 	NLPT_BEGIN(pt);
 
 	// This macro abstracts the logic to read a single character into
@@ -165,6 +95,32 @@ SpinelNCPInstance::ncp_to_driver_pump()
 		// even if the socket is already readable.
 		NLPT_YIELD_UNTIL_READABLE_OR_COND(pt, mSerialAdapter->get_read_fd(), mSerialAdapter->can_read());
 
+		if (mSerialAdapter->is_framed()) {
+			// The link hands us whole frames, so there is no
+			// framing or CRC to deal with.
+			ssize_t retlen = mSerialAdapter->read(mInboundFrame, sizeof(mInboundFrame));
+
+			if (retlen == -EMSGSIZE) {
+				syslog(LOG_WARNING, "[NCP->]: Dropping oversized frame");
+				continue;
+			}
+
+			if (retlen < 0) {
+				syslog(LOG_ERR, "[-NCP-]: Socket error on read: %s %d", strerror((int)-retlen), (int)(-retlen));
+				errno = (int)-retlen;
+				signal_fatal_error(ERRORCODE_ERRNO);
+				goto on_error;
+			}
+
+			mInboundFrameSize = (spinel_size_t)retlen;
+
+			if (mInboundFrameSize == 0) {
+				continue;
+			}
+
+			goto on_frame;
+		}
+
 #if WPANTUND_SPINEL_USE_FLEN
 		do {
 			READ_CHARACTER(pt, (void*)&mInboundFrame[0], on_error);
@@ -303,6 +259,7 @@ SpinelNCPInstance::ncp_to_driver_pump()
 			goto on_error;
 		}
 
+on_frame:
 #if OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER
 		size_t dataLen = mInboundFrameSize;
 		if (!SpinelEncrypter::DecryptInbound(mInboundFrame, sizeof(mInboundFrame), &dataLen))
@@ -328,6 +285,8 @@ SpinelNCPInstance::ncp_to_driver_pump()
 				break;
 			}
 
+			mEgressScheduler.handle_ncp_activity();
+
 			handle_ncp_spinel_callback(command_value, mInboundFrame, mInboundFrameSize);
 		}
 	} // while (!ncp_state_is_detached_from_ncp(get_ncp_state()))
@@ -338,11 +297,219 @@ on_error:;
 	NLPT_END(pt);
 }
 
+void
+SpinelNCPInstance::queue_outbound_frame(int slot)
+{
+	mOutboundFrameSlot = slot;
+	mOutboundFrame = mOutboundFramePool.get_frame(slot);
+	mOutboundBufferLen = static_cast<spinel_ssize_t>(mOutboundFramePool.get_frame_len(slot));
+}
+
+void
+SpinelNCPInstance::clear_outbound_frame(void)
+{
+	mOutboundBufferLen = 0;
+
+	if (mOutboundFrameSlot != SpinelNCPFramePool::kNoSlot) {
+		mOutboundFramePool.release(mOutboundFrameSlot);
+		mOutboundFrameSlot = SpinelNCPFramePool::kNoSlot;
+		mOutboundFrame = mOutboundBuffer;
+	}
+}
+
+void
+SpinelNCPInstance::log_outbound_frame(void)
+{
+	if (mOutboundFrame[1] == SPINEL_CMD_PROP_VALUE_GET) {
+		spinel_prop_key_t key;
+		spinel_datatype_unpack(mOutboundFrame, mOutboundBufferLen, "Cii", NULL, NULL, &key);
+		syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_GET(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_PROP_VALUE_SET) {
+		spinel_prop_key_t key;
+		spinel_datatype_unpack(mOutboundFrame, mOutboundBufferLen, "Cii", NULL, NULL, &key);
+		syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_SET(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_PROP_VALUE_INSERT) {
+		spinel_prop_key_t key;
+		spinel_datatype_unpack(mOutboundFrame, mOutboundBufferLen, "Cii", NULL, NULL, &key);
+		syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_INSERT(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_PROP_VALUE_REMOVE) {
+		spinel_prop_key_t key;
+		spinel_datatype_unpack(mOutboundFrame, mOutboundBufferLen, "Cii", NULL, NULL, &key);
+		syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_REMOVE(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_NOOP) {
+		syslog(LOG_INFO, "[->NCP] CMD_NOOP tid:%d", SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_RESET) {
+		syslog(LOG_INFO, "[->NCP] CMD_RESET tid:%d", SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_NET_CLEAR) {
+		syslog(LOG_INFO, "[->NCP] CMD_NET_CLEAR tid:%d", SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_PEEK) {
+		uint32_t address = 0;
+		uint16_t count = 0;
+		spinel_datatype_unpack(mOutboundFrame, mOutboundBufferLen, "CiLS", NULL, NULL, &address, &count);
+		syslog(LOG_INFO, "[->NCP] CMD_PEEK(0x%x,%d) tid:%d", address, count, SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else if (mOutboundFrame[1] == SPINEL_CMD_POKE) {
+		uint32_t address = 0;
+		uint16_t count = 0;
+		spinel_datatype_unpack(mOutboundFrame, mOutboundBufferLen, "CiLS", NULL, NULL, &address, &count);
+		syslog(LOG_INFO, "[->NCP] CMD_NET_POKE(0x%x,%d) tid:%d", address, count, SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	} else {
+		syslog(LOG_INFO, "[->NCP] Spinel command 0x%02X tid:%d", mOutboundFrame[1], SPINEL_HEADER_GET_TID(mOutboundFrame[0]));
+	}
+}
+
+void
+SpinelNCPInstance::update_flow_control(void)
+{
+	mFlowControl.process();
+
+	// A probe which timed out is forgotten, so that its late
+	// reply doesn't get mistaken for the reply to the next one.
+	if (!mFlowControl.is_probe_pending()) {
+		mFlowControlProbeHeader = 0;
+	}
+}
+
+// Returns true if the frame was the reply to the flow control probe.
+bool
+SpinelNCPInstance::handle_flow_control_probe_reply(spinel_prop_key_t key, const uint8_t* value_data_ptr, spinel_size_t value_data_len)
+{
+	if (key == SPINEL_PROP_MSG_BUFFER_COUNTERS) {
+		uint16_t total_buffers = 0;
+		uint16_t free_buffers = 0;
+
+		mFlowControlProbeHeader = 0;
+
+		if (spinel_datatype_unpack(value_data_ptr, value_data_len, "SS", &total_buffers, &free_buffers) > 0) {
+			mFlowControl.handle_buffer_counters(total_buffers, free_buffers);
+		} else {
+			mFlowControl.handle_probe_failed(false);
+		}
+
+	} else if (key == SPINEL_PROP_LAST_STATUS) {
+		spinel_status_t status = SPINEL_STATUS_OK;
+
+		mFlowControlProbeHeader = 0;
+
+		spinel_datatype_unpack(value_data_ptr, value_data_len, "i", &status);
+
+		mFlowControl.handle_probe_failed(
+			(status == SPINEL_STATUS_PROP_NOT_FOUND) || (status == SPINEL_STATUS_INVALID_COMMAND)
+		);
+
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+void
+SpinelNCPInstance::get_flow_control_as_string_list(std::list<std::string>& list)
+{
+	char path[IFNAMSIZ + 64];
+	char line[80];
+	unsigned long long tx_dropped = 0;
+	FILE* file;
+
+	mFlowControl.get_counters_as_string_list(list);
+
+	// What the kernel dropped while we weren't reading from the interface.
+	snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/tx_dropped", mPrimaryInterface->get_interface_name().c_str());
+	file = fopen(path, "r");
+
+	if (file != NULL) {
+		if (fscanf(file, "%llu", &tx_dropped) == 1) {
+			snprintf(line, sizeof(line), "Interface: TxDropped:%llu", tx_dropped);
+			list.push_back(line);
+		}
+		fclose(file);
+	}
+}
+
+// False while packets should be left waiting in the network interface:
+// while flow control is paused, or (with the egress scheduler) once the
+// queue of any class is full. Reading them only to drop them would hide
+// the backpressure from the kernel's queueing discipline.
+bool
+SpinelNCPInstance::should_read_outbound_packets(void) const
+{
+	return mFlowControl.can_send()
+		&& (!mEgressScheduler.is_enabled() || mEgressScheduler.is_accepting());
+}
+
+int
+SpinelNCPInstance::queue_outbound_packets(void)
+{
+	// Bounded so that a flood of packets can't hold up the main loop.
+	static const int kMaxPacketsPerPass = 16;
+	int count;
+
+	for (count = 0; count < kMaxPacketsPerPass; count++) {
+		TunnelIPv6Interface* interface = NULL;
+		uint8_t frame_type = FRAME_TYPE_DATA;
+		uint8_t* packet;
+		ssize_t len;
+		int slot;
+
+		if (mPrimaryInterface->can_read()) {
+			interface = mPrimaryInterface.get();
+
+		} else if (static_cast<bool>(mLegacyInterface) && mLegacyInterface->can_read()) {
+			interface = mLegacyInterface.get();
+			frame_type = FRAME_TYPE_LEGACY_DATA;
+
+		} else {
+			break;
+		}
+
+		// The packets can wait in the kernel until there is room again.
+		if (!should_read_outbound_packets()) {
+			break;
+		}
+
+		slot = mEgressScheduler.get_free_slot();
+
+		if (slot == SpinelNCPEgressScheduler::kNoSlot) {
+			break;
+		}
+
+		packet = mEgressScheduler.get_packet(slot);
+		len = interface->read(packet, sizeof(mOutboundBuffer) - 5);
+
+		if (len <= 0) {
+			mEgressScheduler.release(slot);
+
+			if (len < 0) {
+				return -1;
+			}
+			break;
+		}
+
+		if (frame_type == FRAME_TYPE_DATA) {
+			mFrameCapture.record(FrameCapture::kPacketFromHost, packet, len);
+		}
+
+		if (!should_forward_ncpbound_frame(&frame_type, packet, static_cast<size_t>(len))) {
+			mEgressScheduler.release(slot);
+			continue;
+		}
+
+		mEgressScheduler.enqueue(slot, static_cast<size_t>(len), frame_type);
+	}
+
+	return count;
+}
+
 char
 SpinelNCPInstance::driver_to_ncp_pump()
 {
 	struct nlpt*const pt = &mDriverToNCPPumpPT;
 
+	if (mDataPlane.is_running()) {
+		data_plane_send();
+		return PT_WAITING;
+	}
+
 	NLPT_BEGIN(pt);
 
 	while (!ncp_state_is_detached_from_ncp(get_ncp_state())) {
@@ -365,6 +532,25 @@ SpinelNCPInstance::driver_to_ncp_pump()
 			NLPT_YIELD_UNTIL(pt,(mOutboundBufferLen > 0));
 		}
 #else
+		} else if (!should_read_outbound_packets()) {
+			// The NCP is short on buffers, or an egress queue is full.
+			// Leave packets queued up in the kernel, but keep sending
+			// management frames and whatever is already queued.
+			NLPT_YIELD_UNTIL(
+				pt,
+				(mOutboundBufferLen > 0)
+				|| mFlowControl.wants_probe()
+				|| should_read_outbound_packets()
+				|| (mFlowControl.can_send() && mEgressScheduler.has_ready_packet())
+			);
+
+			if ((mOutboundBufferLen <= 0)
+				&& !mFlowControl.wants_probe()
+				&& !mFlowControl.can_send()
+			) {
+				continue;
+			}
+
 		} else if (static_cast<bool>(mLegacyInterface) && is_legacy_interface_enabled()) {
 			NLPT_YIELD_UNTIL_READABLE2_OR_COND(
 				pt,
@@ -373,13 +559,16 @@ SpinelNCPInstance::driver_to_ncp_pump()
 				(mOutboundBufferLen > 0)
 				|| mLegacyInterface->can_read()
 				|| mPrimaryInterface->can_read()
+				|| (mFlowControl.can_send() && mEgressScheduler.has_ready_packet())
 			);
 
 		} else {
 			NLPT_YIELD_UNTIL_READABLE_OR_COND(
 				pt,
 				mPrimaryInterface->get_read_fd(),
-				mPrimaryInterface->can_read() || (mOutboundBufferLen > 0)
+				mPrimaryInterface->can_read()
+				|| (mOutboundBufferLen > 0)
+				|| (mFlowControl.can_send() && mEgressScheduler.has_ready_packet())
 			);
 		}
 #endif
@@ -387,75 +576,89 @@ SpinelNCPInstance::driver_to_ncp_pump()
 		// Get packet or management command, and also
 		// perform any necessary filtering.
 		if (mOutboundBufferLen > 0) {
-			if (mOutboundBuffer[1] == SPINEL_CMD_PROP_VALUE_GET) {
-				spinel_prop_key_t key;
-				spinel_datatype_unpack(mOutboundBuffer, mOutboundBufferLen, "Cii", NULL, NULL, &key);
-				syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_GET(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_PROP_VALUE_SET) {
-				spinel_prop_key_t key;
-				spinel_datatype_unpack(mOutboundBuffer, mOutboundBufferLen, "Cii", NULL, NULL, &key);
-				syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_SET(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_PROP_VALUE_INSERT) {
-				spinel_prop_key_t key;
-				spinel_datatype_unpack(mOutboundBuffer, mOutboundBufferLen, "Cii", NULL, NULL, &key);
-				syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_INSERT(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_PROP_VALUE_REMOVE) {
-				spinel_prop_key_t key;
-				spinel_datatype_unpack(mOutboundBuffer, mOutboundBufferLen, "Cii", NULL, NULL, &key);
-				syslog(LOG_INFO, "[->NCP] CMD_PROP_VALUE_REMOVE(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_NOOP) {
-				syslog(LOG_INFO, "[->NCP] CMD_NOOP tid:%d", SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_RESET) {
-				syslog(LOG_INFO, "[->NCP] CMD_RESET tid:%d", SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_NET_CLEAR) {
-				syslog(LOG_INFO, "[->NCP] CMD_NET_CLEAR tid:%d", SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_PEEK) {
-				uint32_t address = 0;
-				uint16_t count = 0;
-				spinel_datatype_unpack(mOutboundBuffer, mOutboundBufferLen, "CiLS", NULL, NULL, &address, &count);
-				syslog(LOG_INFO, "[->NCP] CMD_PEEK(0x%x,%d) tid:%d", address, count, SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else if (mOutboundBuffer[1] == SPINEL_CMD_POKE) {
-				uint32_t address = 0;
-				uint16_t count = 0;
-				spinel_datatype_unpack(mOutboundBuffer, mOutboundBufferLen, "CiLS", NULL, NULL, &address, &count);
-				syslog(LOG_INFO, "[->NCP] CMD_NET_POKE(0x%x,%d) tid:%d", address, count, SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
-			} else {
-				syslog(LOG_INFO, "[->NCP] Spinel command 0x%02X tid:%d", mOutboundBuffer[1], SPINEL_HEADER_GET_TID(mOutboundBuffer[0]));
+			if (mFrameLogging) {
+				log_outbound_frame();
+			}
+		} else if (mFlowControl.wants_probe()) {
+			// Ask for the NCP's buffer counters straight from the pump
+			// rather than from a task, so that the question doesn't
+			// wait behind a scan or a join while the tunnel is paused.
+			mOutboundBufferLen = spinel_cmd_prop_value_get(mOutboundBuffer, sizeof(mOutboundBuffer), SPINEL_PROP_MSG_BUFFER_COUNTERS);
+
+			mLastTID = SPINEL_GET_NEXT_TID(mLastTID);
+			mFlowControlProbeHeader = (SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (mLastTID << SPINEL_HEADER_TID_SHIFT));
+			mOutboundBuffer[0] = mFlowControlProbeHeader;
+
+			mFlowControl.probe_started();
+
+			if (mFrameLogging) {
+				log_outbound_frame();
 			}
 		} else {
-			// There is an IPv6 packet waiting on one of the tunnel interfaces.
+			if (mEgressScheduler.is_enabled()) {
+				// Sort whatever is waiting on the tunnel interfaces into the
+				// egress queues, then send the packet which is due next.
+				if (0 > queue_outbound_packets()) {
+					syslog(LOG_ERR,
+					       "driver_to_ncp_pump: Socket error on read: %s",
+					       strerror(errno));
+					signal_fatal_error(ERRORCODE_ERRNO);
+					break;
+				}
 
-			if (mPrimaryInterface->can_read()) {
-				mOutboundBufferLen = (spinel_ssize_t)mPrimaryInterface->read(
-					&mOutboundBuffer[5],
-					sizeof(mOutboundBuffer)-5
-				);
-				mOutboundBufferType = FRAME_TYPE_DATA;
-			} else if (static_cast<bool>(mLegacyInterface)) {
-				mOutboundBufferLen = (spinel_ssize_t)mLegacyInterface->read(
+				if (!mFlowControl.can_send()) {
+					continue;
+				}
+
+				mOutboundBufferLen = (spinel_ssize_t)mEgressScheduler.dequeue(
 					&mOutboundBuffer[5],
-					sizeof(mOutboundBuffer)-5
+					&mOutboundBufferType
 				);
-				mOutboundBufferType = FRAME_TYPE_LEGACY_DATA;
-			}
 
-			if (0 > mOutboundBufferLen) {
-				syslog(LOG_ERR,
-				       "driver_to_ncp_pump: Socket error on read: %s",
-				       strerror(errno));
-				signal_fatal_error(ERRORCODE_ERRNO);
-				break;
-			}
+				if (mOutboundBufferLen <= 0) {
+					mOutboundBufferLen = 0;
+					continue;
+				}
 
-			if (mOutboundBufferLen <= 0) {
-				// No packet...?
-				mOutboundBufferLen = 0;
-				continue;
-			}
+			} else {
+				// There is an IPv6 packet waiting on one of the tunnel interfaces.
+
+				if (mPrimaryInterface->can_read()) {
+					mOutboundBufferLen = (spinel_ssize_t)mPrimaryInterface->read(
+						&mOutboundBuffer[5],
+						sizeof(mOutboundBuffer)-5
+					);
+					mOutboundBufferType = FRAME_TYPE_DATA;
+				} else if (static_cast<bool>(mLegacyInterface)) {
+					mOutboundBufferLen = (spinel_ssize_t)mLegacyInterface->read(
+						&mOutboundBuffer[5],
+						sizeof(mOutboundBuffer)-5
+					);
+					mOutboundBufferType = FRAME_TYPE_LEGACY_DATA;
+				}
 
-			if (!should_forward_ncpbound_frame(&mOutboundBufferType, &mOutboundBuffer[5], mOutboundBufferLen)) {
-				mOutboundBufferLen = 0;
-				continue;
+				if (0 > mOutboundBufferLen) {
+					syslog(LOG_ERR,
+					       "driver_to_ncp_pump: Socket error on read: %s",
+					       strerror(errno));
+					signal_fatal_error(ERRORCODE_ERRNO);
+					break;
+				}
+
+				if (mOutboundBufferLen <= 0) {
+					// No packet...?
+					mOutboundBufferLen = 0;
+					continue;
+				}
+
+				if (mOutboundBufferType == FRAME_TYPE_DATA) {
+					mFrameCapture.record(FrameCapture::kPacketFromHost, &mOutboundBuffer[5], mOutboundBufferLen);
+				}
+
+				if (!should_forward_ncpbound_frame(&mOutboundBufferType, &mOutboundBuffer[5], mOutboundBufferLen)) {
+					mOutboundBufferLen = 0;
+					continue;
+				}
 			}
 
 			if (get_ncp_state() == CREDENTIALS_NEEDED) {
@@ -480,13 +683,18 @@ SpinelNCPInstance::driver_to_ncp_pump()
 				mOutboundBuffer[0] = SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_1;
 				mOutboundBuffer[2] = SPINEL_PROP_STREAM_NET;
 			}
+
+			mFlowControl.did_send();
 		}
 
+		mFrameTrace.record(SpinelNCPFrameTrace::kDirectionToNCP, mOutboundFrame, mOutboundBufferLen);
+		mFrameCapture.record(FrameCapture::kFrameToNCP, mOutboundFrame, mOutboundBufferLen);
+
 #if VERBOSE_DEBUG
 		// Very verbose debugging. Dumps out all outbound packets.
 		{
 			char readable_buffer[300];
-			encode_data_into_string(mOutboundBuffer,
+			encode_data_into_string(mOutboundFrame,
 			                        mOutboundBufferLen,
 			                        readable_buffer,
 			                        sizeof(readable_buffer),
@@ -495,11 +703,39 @@ SpinelNCPInstance::driver_to_ncp_pump()
 		}
 #endif // VERBOSE_DEBUG
 
+#if OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER && !WPANTUND_SPINEL_USE_FLEN
+		{
+			size_t dataLen = mOutboundBufferLen;
+			if (!SpinelEncrypter::EncryptOutbound(mOutboundFrame, SPINEL_FRAME_BUFFER_SIZE, &dataLen))
+			{
+				syslog(LOG_ERR, "[-NCP-]: Unable to transform outbound data");
+				clear_outbound_frame();
+				break;
+			}
+			mOutboundBufferLen = dataLen;
+		}
+#endif // OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER && !WPANTUND_SPINEL_USE_FLEN
+
+		if (mSerialAdapter->is_framed()) {
+			// The whole frame goes out as-is, once there is room for it.
+			// The socket itself takes care of waking us up for that.
+			do {
+				NLPT_WAIT_UNTIL(pt, mSerialAdapter->can_write());
+
+				mOutboundBufferSent = (spinel_ssize_t)mSerialAdapter->write(mOutboundFrame, mOutboundBufferLen);
+			} while (mOutboundBufferSent == 0);
+
+			pt->last_errno = (mOutboundBufferSent < 0) ? (int)-mOutboundBufferSent : 0;
+
+			goto on_sent;
+		}
 
 #if WPANTUND_SPINEL_USE_FLEN
-		mOutboundBufferHeader[0] = HDLC_BYTE_FLAG;
-		mOutboundBufferHeader[1] = (mOutboundBufferLen >> 8);
-		mOutboundBufferHeader[2] = (mOutboundBufferLen & 0xFF);
+		// The header goes right in front of the frame: `mOutboundBufferHeader`
+		// precedes `mOutboundBuffer`, and pool slots have headroom for it.
+		mOutboundFrame[-3] = HDLC_BYTE_FLAG;
+		mOutboundFrame[-2] = (mOutboundBufferLen >> 8);
+		mOutboundFrame[-1] = (mOutboundBufferLen & 0xFF);
 
 		mOutboundBufferSent = 0;
 
@@ -507,56 +743,17 @@ SpinelNCPInstance::driver_to_ncp_pump()
 		NLPT_ASYNC_WRITE_STREAM(
 			pt,
 			mSerialAdapter.get(),
-			mOutboundBufferHeader,
+			mOutboundFrame - sizeof(mOutboundBufferHeader),
 			mOutboundBufferLen + sizeof(mOutboundBufferHeader)
 		);
 		mOutboundBufferSent += pt->byte_count;
 #else
-
-		mOutboundBufferEscapedLen = 1;
-		mOutboundBufferEscaped[0] = HDLC_BYTE_FLAG;
-		{
-			spinel_ssize_t i;
-			uint8_t byte;
-			uint16_t crc(0xFFFF);
-
-#if OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER
-			size_t dataLen = mOutboundBufferLen;
-			if (!SpinelEncrypter::EncryptOutbound(mOutboundBuffer, sizeof(mOutboundBuffer), &dataLen))
-			{
-				syslog(LOG_ERR, "[-NCP-]: Unable to transform outbound data");
-				break;
-			}
-			mOutboundBufferLen = dataLen;
-#endif // OPENTHREAD_ENABLE_NCP_SPINEL_ENCRYPTER
-
-			for (i = 0; i < mOutboundBufferLen; i++) {
-				byte = mOutboundBuffer[i];
-				crc = hdlc_crc16(crc, byte);
-				if (hdlc_byte_needs_escape(byte)) {
-					mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = HDLC_BYTE_ESC;
-					mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = byte ^ HDLC_ESCAPE_XFORM;
-				} else {
-					mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = byte;
-				}
-			}
-			crc ^= 0xFFFF;
-			byte = (crc & 0xFF);
-			if (hdlc_byte_needs_escape(byte)) {
-				mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = HDLC_BYTE_ESC;
-				mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = byte ^ HDLC_ESCAPE_XFORM;
-			} else {
-				mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = byte;
-			}
-			byte = ((crc>>8) & 0xFF);
-			if (hdlc_byte_needs_escape(byte)) {
-				mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = HDLC_BYTE_ESC;
-				mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = byte ^ HDLC_ESCAPE_XFORM;
-			} else {
-				mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = byte;
-			}
-			mOutboundBufferEscaped[mOutboundBufferEscapedLen++] = HDLC_BYTE_FLAG;
-		}
+		mOutboundBufferEscapedLen = hdlc_encode_frame(
+			mOutboundFrame,
+			mOutboundBufferLen,
+			mOutboundBufferEscaped,
+			sizeof(mOutboundBufferEscaped)
+		);
 
 		mOutboundBufferSent = 0;
 
@@ -570,10 +767,13 @@ SpinelNCPInstance::driver_to_ncp_pump()
 		mOutboundBufferSent += pt->byte_count;
 #endif
 
-		mOutboundBufferLen = 0;
+on_sent:
+		clear_outbound_frame();
 
 		require(pt->last_errno == 0, on_error);
 
+		mEgressScheduler.handle_ncp_activity();
+
 		// Go ahead and fire off the "did send" callback.
 		if (!mOutboundCallback.empty()) {
 			mOutboundCallback(kWPANTUNDStatus_Ok);
@@ -592,3 +792,240 @@ on_error:
 
 	NLPT_END(pt);
 }
+
+bool
+SpinelNCPInstance::data_plane_fast_path_allowed(void)
+{
+	// Under these conditions `should_forward_hostbound_frame()` and
+	// `should_forward_ncpbound_frame()` reduce to the drop firewall for
+	// secure traffic, which the data-plane thread can apply by itself.
+	// A frame capture needs to see every frame, so it turns this off.
+	return ncp_state_is_interface_up(get_ncp_state())
+		&& !mFrameCapture.is_enabled()
+		&& !ncp_state_is_joining(get_ncp_state())
+		&& (get_ncp_state() != CREDENTIALS_NEEDED)
+		&& (mCommissioningExpiration == 0)
+		&& mInsecureFirewall.empty()
+		&& mLegacyCommissioningMatcher.empty();
+}
+
+void
+SpinelNCPInstance::update_data_plane(void)
+{
+	if (mDataPlane.is_running()) {
+		int err = mDataPlane.get_last_error();
+
+		if (err != 0) {
+			syslog(LOG_ERR, "[-NCP-]: Data-plane thread stopped: %s", strerror(err));
+			mDataPlane.stop();
+			errno = err;
+			signal_fatal_error(ERRORCODE_ERRNO);
+
+		} else if (ncp_state_is_detached_from_ncp(get_ncp_state())
+			|| static_cast<bool>(mLegacyInterface)
+		) {
+			mDataPlane.stop();
+
+		} else {
+			mDataPlane.set_fast_path(data_plane_fast_path_allowed());
+		}
+
+	} else if (mDataPlaneEnabled
+		&& !ncp_state_is_detached_from_ncp(get_ncp_state())
+		&& (get_upgrade_status() != EINPROGRESS)
+		&& (mSerialAdapter == mRawSerialAdapter)
+		&& !mSerialAdapter->is_framed()
+		&& !static_cast<bool>(mLegacyInterface)
+		&& (mOutboundBufferLen == 0)
+		&& mOutboundCallback.empty()
+		&& mEgressScheduler.is_empty()
+	) {
+		int ret;
+
+		// Neither pump is in the middle of a frame at this point, so
+		// we can simply restart them once the thread is stopped again.
+		NLPT_INIT(&mNCPToDriverPumpPT);
+		NLPT_INIT(&mDriverToNCPPumpPT);
+
+		ret = mDataPlane.start(mSerialAdapter, mPrimaryInterface, &mDropFirewall, mDataPlaneIOUring);
+
+		if (ret != 0) {
+			syslog(LOG_ERR, "[-NCP-]: Unable to start data-plane thread: %s", strerror(ret));
+			mDataPlaneEnabled = false;
+		} else {
+			mDataPlane.set_fast_path(data_plane_fast_path_allowed());
+		}
+	}
+}
+
+void
+SpinelNCPInstance::handle_ncp_frame(const uint8_t* frame_ptr, spinel_size_t frame_len)
+{
+	unsigned int command_value = 0;
+
+	if (spinel_datatype_unpack(frame_ptr, frame_len, "Ci", &mInboundHeader, &command_value) > 0) {
+		if ((mInboundHeader&SPINEL_HEADER_FLAG) != SPINEL_HEADER_FLAG) {
+			// Unrecognized frame.
+			syslog(LOG_ERR, "[-NCP-]: Unrecognized frame (0x%02X)", mInboundHeader);
+			return;
+		}
+
+		if (SPINEL_HEADER_GET_IID(mInboundHeader) != 0) {
+			// We only support IID zero for now.
+#if DEBUG
+			syslog(LOG_INFO, "[-NCP-]: Unsupported IID: %d", SPINEL_HEADER_GET_IID(mInboundHeader));
+#endif
+			return;
+		}
+
+		handle_ncp_spinel_callback(command_value, frame_ptr, frame_len);
+	}
+}
+
+void
+SpinelNCPInstance::handle_ncp_bound_packet(const uint8_t* packet, spinel_size_t packet_len)
+{
+	SpinelNCPDataPlane::Frame* frame;
+	uint8_t type = FRAME_TYPE_DATA;
+
+	mFrameCapture.record(FrameCapture::kPacketFromHost, packet, packet_len);
+
+	if (!should_forward_ncpbound_frame(&type, packet, packet_len)) {
+		return;
+	}
+
+	if (get_ncp_state() == CREDENTIALS_NEEDED) {
+		type = FRAME_TYPE_INSECURE_DATA;
+	}
+
+	frame = mDataPlane.begin_send();
+
+	if (frame == NULL) {
+		syslog(LOG_DEBUG, "[-NCP-]: Data-plane queue full, dropping NCP-bound packet");
+		return;
+	}
+
+	frame->mType = SpinelNCPDataPlane::kFrameTypeSpinel;
+	frame->mData[0] = SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0;
+	frame->mData[1] = SPINEL_CMD_PROP_VALUE_SET;
+	frame->mData[2] = (type == FRAME_TYPE_INSECURE_DATA)
+		? SPINEL_PROP_STREAM_NET_INSECURE
+		: SPINEL_PROP_STREAM_NET;
+	frame->mData[3] = (packet_len & 0xFF);
+	frame->mData[4] = ((packet_len >> 8) & 0xFF);
+	memcpy(&frame->mData[5], packet, packet_len);
+	frame->mLength = packet_len + 5;
+
+	mFrameTrace.record(SpinelNCPFrameTrace::kDirectionToNCP, frame->mData, frame->mLength);
+	mFrameCapture.record(FrameCapture::kFrameToNCP, frame->mData, frame->mLength);
+
+	mDataPlane.commit_send();
+}
+
+void
+SpinelNCPInstance::data_plane_receive(void)
+{
+	SpinelNCPDataPlane::PacketHeader* header;
+	SpinelNCPDataPlane::Frame* frame;
+	int count;
+
+	mDataPlane.clear_wake();
+
+	while ((header = mDataPlane.begin_read_packet_header()) != NULL) {
+		if (header->mDirection == SpinelNCPDataPlane::kPacketDirectionHostBound) {
+			get_stat_collector().record_inbound_packet(header->mData);
+		} else {
+			get_stat_collector().record_outbound_packet(header->mData);
+		}
+		mDataPlane.commit_read_packet_header();
+	}
+
+	// Like the regular pump, we only handle a bounded number of
+	// frames per run through the main loop.
+	for (count = 0; count < SpinelNCPDataPlane::kFrameRingSize; count++) {
+		if ((frame = mDataPlane.begin_receive()) == NULL) {
+			break;
+		}
+
+		switch (frame->mType) {
+		case SpinelNCPDataPlane::kFrameTypeSpinel:
+			handle_ncp_frame(frame->mData, frame->mLength);
+			break;
+
+		case SpinelNCPDataPlane::kFrameTypeNCPBoundPacket:
+			handle_ncp_bound_packet(frame->mData, frame->mLength);
+			break;
+
+		case SpinelNCPDataPlane::kFrameTypeDebugStream:
+			handle_ncp_debug_stream(frame->mData, frame->mLength);
+			break;
+		}
+
+		// Handling the frame may have caused the thread to be stopped
+		// (a reset, for example), in which case the rings are gone.
+		if (!mDataPlane.is_running()) {
+			break;
+		}
+
+		mDataPlane.commit_receive();
+	}
+}
+
+void
+SpinelNCPInstance::data_plane_send(void)
+{
+	SpinelNCPDataPlane::Frame* frame;
+
+	if (mOutboundBufferLen <= 0) {
+		return;
+	}
+
+	// If the ring is full, the thread wakes us up once it has room.
+	if ((frame = mDataPlane.begin_send()) == NULL) {
+		return;
+	}
+
+	if (mFrameLogging) {
+		log_outbound_frame();
+	}
+
+	mFrameTrace.record(SpinelNCPFrameTrace::kDirectionToNCP, mOutboundFrame, mOutboundBufferLen);
+	mFrameCapture.record(FrameCapture::kFrameToNCP, mOutboundFrame, mOutboundBufferLen);
+
+	frame->mType = SpinelNCPDataPlane::kFrameTypeSpinel;
+	frame->mLength = mOutboundBufferLen;
+	memcpy(frame->mData, mOutboundFrame, mOutboundBufferLen);
+
+	mDataPlane.commit_send();
+
+	clear_outbound_frame();
+
+	// The frame now belongs to the thread, which is as close to "sent"
+	// as the main loop gets.
+	if (!mOutboundCallback.empty()) {
+		mOutboundCallback(kWPANTUNDStatus_Ok);
+		mOutboundCallback.clear();
+	}
+}
+
+int
+SpinelNCPInstance::update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout)
+{
+	int ret = NCPInstanceBase::update_fd_set(read_fd_set, write_fd_set, error_fd_set, max_fd, timeout);
+
+	if ((ret == 0) && mDataPlane.is_running() && (read_fd_set != NULL)) {
+		const int fd = mDataPlane.get_wake_fd();
+
+		FD_SET(fd, read_fd_set);
+
+		if ((max_fd != NULL) && (*max_fd < fd)) {
+			*max_fd = fd;
+		}
+	}
+
+	if (ret == 0) {
+		ret = mTmfProxySocket.update_fd_set(read_fd_set, write_fd_set, error_fd_set, max_fd, timeout);
+	}
+
+	return ret;
+}
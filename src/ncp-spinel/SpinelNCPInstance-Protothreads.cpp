@@ -431,6 +431,48 @@ SpinelNCPInstance::vprocess_init(int event, va_list args)
 		// This will cause a reset to occur.
 		require(!ncp_state_is_joining(get_ncp_state()), on_error);
 
+		if (should_upgrade_baud_rate()) {
+			if (mUpgradeBaudBase <= 0) {
+				mUpgradeBaudBase = mSerialAdapter->get_baud_rate();
+			}
+
+			syslog(LOG_NOTICE, "Switching NCP from %d to %d baud", mUpgradeBaudBase, mUpgradeBaud);
+
+			// The NCP answers at the old rate and switches right after.
+			CONTROL_REQUIRE_PREP_TO_SEND_COMMAND_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_error);
+			GetInstance(this)->mOutboundBufferLen = spinel_datatype_pack(GetInstance(this)->mOutboundBuffer, sizeof(GetInstance(this)->mOutboundBuffer), SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S), SPINEL_PROP_UART_BITRATE, mUpgradeBaud);
+			CONTROL_REQUIRE_OUTBOUND_BUFFER_FLUSHED_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_error);
+
+			CONTROL_REQUIRE_COMMAND_RESPONSE_WITHIN(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT, on_error);
+
+			status = peek_ncp_callback_status(event, args);
+
+			if (status != 0) {
+				// The NCP stays at the old rate, carry on with that.
+				syslog(LOG_WARNING, "NCP refused to switch baud rate: \"%s\" (%d)", spinel_status_to_cstr(static_cast<spinel_status_t>(status)), status);
+				mUpgradeBaudFailed = true;
+				mUpgradeBaudBase = 0;
+				status = 0;
+
+			} else if (mSerialAdapter->set_baud_rate(mUpgradeBaud) != 0) {
+				syslog(LOG_ERR, "Unable to switch host to %d baud", mUpgradeBaud);
+				goto on_baud_upgrade_failed;
+
+			} else {
+				// Give the NCP a moment to switch over, then make
+				// sure we can still talk to it.
+				EH_SLEEP_FOR(0.05);
+
+				CONTROL_REQUIRE_PREP_TO_SEND_COMMAND_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_baud_upgrade_failed);
+				GetInstance(this)->mOutboundBufferLen = spinel_datatype_pack(GetInstance(this)->mOutboundBuffer, sizeof(GetInstance(this)->mOutboundBuffer), "Ci", 0, SPINEL_CMD_NOOP);
+				CONTROL_REQUIRE_OUTBOUND_BUFFER_FLUSHED_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_baud_upgrade_failed);
+
+				CONTROL_REQUIRE_COMMAND_RESPONSE_WITHIN(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT, on_baud_upgrade_failed);
+
+				syslog(LOG_NOTICE, "NCP is now at %d baud", mUpgradeBaud);
+			}
+		}
+
 		if (mIsPcapInProgress) {
 			CONTROL_REQUIRE_PREP_TO_SEND_COMMAND_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_error);
 			GetInstance(this)->mOutboundBufferLen = spinel_cmd_prop_value_set_uint(GetInstance(this)->mOutboundBuffer, sizeof(GetInstance(this)->mOutboundBuffer), SPINEL_PROP_MAC_RAW_STREAM_ENABLED, 1);
@@ -522,6 +564,17 @@ SpinelNCPInstance::vprocess_init(int event, va_list args)
 
 		break;
 
+on_baud_upgrade_failed:
+		// Go back to the old rate for good, the hardware reset
+		// below takes the NCP back there as well.
+		syslog(LOG_ERR, "NCP is unresponsive at %d baud, falling back to %d baud", mUpgradeBaud, mUpgradeBaudBase);
+		mSerialAdapter->set_baud_rate(mUpgradeBaudBase);
+		mUpgradeBaudBase = 0;
+		mUpgradeBaudFailed = true;
+
+		// Make sure the next attempt starts with a hardware reset.
+		mFailureCount |= 1;
+
 on_error:
 		if (status) {
 			syslog(LOG_ERR, "Initialization error: %d", status);
@@ -37,7 +37,10 @@
 #include "SpinelNCPTaskJoin.h"
 #include "SpinelNCPTaskGetNetworkTopology.h"
 #include "SpinelNCPTaskGetMsgBufferCounters.h"
+#include "SpinelNCPTaskSampleCounters.h"
 #include "SpinelNCPThreadDataset.h"
+#include "SpinelNCPTopologyCache.h"
+#include "MainLoopProfiler.h"
 #include "any-to.h"
 #include "spinel-extra.h"
 #include "IPv6Helpers.h"
@@ -46,6 +49,10 @@
 
 #define kWPANTUND_Whitelist_RssiOverrideDisabled    127
 
+// Longest allowed `Stat:Counters:Period`, `Stat:Counters:Window` and
+// `Thread:TopologyCache:Period` (in seconds)
+#define kPeriodicUpdateMaxPeriod                    (24 * 60 * 60)
+
 using namespace nl;
 using namespace wpantund;
 
@@ -335,7 +342,7 @@ nl::wpantund::peek_ncp_callback_status(int event, va_list args)
 }
 
 SpinelNCPInstance::SpinelNCPInstance(const Settings& settings) :
-	NCPInstanceBase(settings), mControlInterface(this), mVendorCustom(this)
+	NCPInstanceBase(settings), mControlInterface(this), mTmfProxySocket(this), mVendorCustom(this)
 {
 	mInboundFrameDataLen = 0;
 	mInboundFrameDataPtr = NULL;
@@ -346,12 +353,28 @@ SpinelNCPInstance::SpinelNCPInstance(const Settings& settings) :
 	mIsCommissioned = false;
 	mFilterRLOCAddresses = true;
 	mTickleOnHostDidWake = false;
+	mFrameLogging = false;
+	mDataPlaneEnabled = false;
+	mDataPlaneIOUring = false;
+	mNCPIsLowPower = false;
 	mIsPcapInProgress = false;
+	mCounterSamplePeriod = 0;
+	mCounterSampleWindow = 60 * Timer::kOneSecond;
+	mCounterSampleInProgress = false;
+	mTopologyCache = boost::shared_ptr<SpinelNCPTopologyCache>(new SpinelNCPTopologyCache());
+	mTopologyCachePeriod = 0;
+	mTopologyRefreshInProgress = false;
+	mUpgradeBaud = 0;
+	mUpgradeBaudBase = 0;
+	mUpgradeBaudFailed = false;
 	mLastHeader = 0;
+	mFlowControlProbeHeader = 0;
 	mLastTID = 0;
 	mNetworkKeyIndex = 0;
 	mOutboundBufferEscapedLen = 0;
 	mOutboundBufferLen = 0;
+	mOutboundFrame = mOutboundBuffer;
+	mOutboundFrameSlot = SpinelNCPFramePool::kNoSlot;
 	mOutboundBufferSent = 0;
 	mOutboundBufferType = 0;
 	mResetIsExpected = false;
@@ -367,12 +390,64 @@ SpinelNCPInstance::SpinelNCPInstance(const Settings& settings) :
 
 	memset(mSteeringDataAddress, 0xff, sizeof(mSteeringDataAddress));
 
+	// Dump the frame trace before anyone else gets a
+	// chance to react to the fatal error.
+	mOnFatalError.connect(
+		boost::bind(&SpinelNCPInstance::handle_fatal_error, this, _1),
+		boost::signals2::at_front
+	);
+
 	if (!settings.empty()) {
 		int status;
+		int iid = -1;
+		std::string socket_path = "/dev/null";
 		Settings::const_iterator iter;
 
 		for(iter = settings.begin(); iter != settings.end(); iter++) {
-			if (!NCPInstanceBase::setup_property_supported_by_class(iter->first)) {
+			if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPIID)) {
+				iid = any_to_int(boost::any(iter->second));
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPSocketPath)) {
+				socket_path = iter->second;
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPUpgradeBaud)) {
+				mUpgradeBaud = any_to_int(boost::any(iter->second));
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigDaemonDataPlaneThread)) {
+				mDataPlaneEnabled = any_to_bool(boost::any(iter->second));
+
+				if (mDataPlaneEnabled && !SpinelNCPDataPlane::is_supported()) {
+					syslog(LOG_WARNING, "\"%s\" is not supported by this build, ignoring", iter->first.c_str());
+					mDataPlaneEnabled = false;
+				}
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigDaemonDataPlaneIOUring)) {
+				mDataPlaneIOUring = any_to_bool(boost::any(iter->second));
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPFlowControl)) {
+				mFlowControl.set_enabled(any_to_bool(boost::any(iter->second)));
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPEgressScheduler)) {
+				mEgressScheduler.set_enabled(any_to_bool(boost::any(iter->second)));
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPEgressRules)) {
+				if (!mEgressScheduler.set_rules(iter->second)) {
+					syslog(LOG_WARNING, "Invalid \"%s\" value \"%s\", ignoring", iter->first.c_str(), iter->second.c_str());
+				}
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPHoldWhileAsleep)) {
+				mEgressScheduler.set_hold_enabled(any_to_bool(boost::any(iter->second)));
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigTmfProxySocketPath)) {
+				if (!iter->second.empty()) {
+					status = mTmfProxySocket.open(iter->second);
+
+					if (status != 0) {
+						syslog(LOG_ERR, "Unable to open TMF proxy socket \"%s\": %s", iter->second.c_str(), strerror(-status));
+					}
+				}
+
+			} else if (!NCPInstanceBase::setup_property_supported_by_class(iter->first)) {
 				status = static_cast<NCPControlInterface&>(get_control_interface())
 					.property_set_value(iter->first, iter->second);
 
@@ -381,11 +456,39 @@ SpinelNCPInstance::SpinelNCPInstance(const Settings& settings) :
 				}
 			}
 		}
+
+		if (iid >= 0) {
+			// `NCPInstanceBase` left the socket alone for us.
+			mLinkChannel = SpinelNCPLink::open_channel(socket_path, static_cast<uint8_t>(iid));
+			mRawSerialAdapter = mLinkChannel;
+			mSerialAdapter = mRawSerialAdapter;
+
+			// The data-plane thread wants the serial port to itself.
+			if (mDataPlaneEnabled) {
+				syslog(LOG_WARNING, "\"%s\" is not supported together with \"%s\", ignoring", kWPANTUNDProperty_ConfigDaemonDataPlaneThread, kWPANTUNDProperty_ConfigNCPIID);
+				mDataPlaneEnabled = false;
+			}
+
+			// Nor can one instance change the speed of a shared link.
+			if (mUpgradeBaud > 0) {
+				syslog(LOG_WARNING, "\"%s\" is not supported together with \"%s\", ignoring", kWPANTUNDProperty_ConfigNCPUpgradeBaud, kWPANTUNDProperty_ConfigNCPIID);
+				mUpgradeBaud = 0;
+			}
+		}
 	}
 }
 
 SpinelNCPInstance::~SpinelNCPInstance()
 {
+	mCounterSampleTimer.cancel();
+	mTopologyCacheTimer.cancel();
+}
+
+void
+SpinelNCPInstance::handle_fatal_error(int err)
+{
+	syslog(LOG_CRIT, "[-NCP-]: Fatal error %d, dumping Spinel frame trace", err);
+	mFrameTrace.dump_to_syslog(LOG_CRIT);
 }
 
 std::string
@@ -415,7 +518,16 @@ SpinelNCPInstance::get_thread_mode(void)
 bool
 SpinelNCPInstance::setup_property_supported_by_class(const std::string& prop_name)
 {
-	return NCPInstanceBase::setup_property_supported_by_class(prop_name);
+	return strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigDaemonDataPlaneThread)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigDaemonDataPlaneIOUring)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPIID)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPUpgradeBaud)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPFlowControl)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPEgressScheduler)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPEgressRules)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPHoldWhileAsleep)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigTmfProxySocketPath)
+		|| NCPInstanceBase::setup_property_supported_by_class(prop_name);
 }
 
 SpinelNCPControlInterface&
@@ -451,6 +563,18 @@ SpinelNCPInstance::get_supported_property_keys()const
 	properties.insert(kWPANTUNDProperty_NCPRSSI);
 	properties.insert(kWPANTUNDProperty_NCPExtendedAddress);
 	properties.insert(kWPANTUNDProperty_NCPCCAFailureRate);
+	properties.insert(kWPANTUNDProperty_NCPFrameTrace);
+	properties.insert(kWPANTUNDProperty_NCPFlowControl);
+	properties.insert(kWPANTUNDProperty_NCPEgressScheduler);
+
+	if (mLinkChannel) {
+		properties.insert(kWPANTUNDProperty_NCPLinkCounters);
+	}
+	properties.insert(kWPANTUNDProperty_DaemonFrameLogging);
+
+	if (mDataPlaneEnabled) {
+		properties.insert(kWPANTUNDProperty_DaemonDataPlane);
+	}
 
 	if (mCapabilities.count(SPINEL_CAP_ROLE_SLEEPY)) {
 		properties.insert(kWPANTUNDProperty_NCPSleepyPollInterval);
@@ -475,6 +599,7 @@ SpinelNCPInstance::get_supported_property_keys()const
 		properties.insert(kWPANTUNDProperty_ThreadNeighborTable);
 		properties.insert(kWPANTUNDProperty_ThreadRouterTable);
 		properties.insert(kWPANTUNDProperty_ThreadCommissionerEnabled);
+		properties.insert(kWPANTUNDProperty_ThreadCommissionerJoinerBulkProgress);
 		properties.insert(kWPANTUNDProperty_ThreadOffMeshRoutes);
 		properties.insert(kWPANTUNDProperty_NetworkPartitionId);
 		properties.insert(kWPANTUNDProperty_ThreadRouterUpgradeThreshold);
@@ -482,6 +607,8 @@ SpinelNCPInstance::get_supported_property_keys()const
 		properties.insert(kWPANTUNDProperty_ThreadActiveDataset);
 		properties.insert(kWPANTUNDProperty_ThreadPendingDataset);
 		properties.insert(kWPANTUNDProperty_ThreadAddressCacheTable);
+		properties.insert(kWPANTUNDProperty_ThreadTopologyCachePeriod);
+		properties.insert(kWPANTUNDProperty_ThreadTopologyChanges);
 
 		if (mCapabilities.count(SPINEL_CAP_ERROR_RATE_TRACKING)) {
 			properties.insert(kWPANTUNDProperty_ThreadNeighborTableErrorRates);
@@ -536,6 +663,7 @@ SpinelNCPInstance::get_supported_property_keys()const
 
 	if (mCapabilities.count(SPINEL_CAP_THREAD_TMF_PROXY)) {
 		properties.insert(kWPANTUNDProperty_TmfProxyEnabled);
+		properties.insert(kWPANTUNDProperty_TmfProxyCounters);
 	}
 
 	if (mCapabilities.count(SPINEL_CAP_NEST_LEGACY_INTERFACE))
@@ -567,6 +695,12 @@ SpinelNCPInstance::get_ms_to_next_event(void)
 		return CMS_DISTANT_FUTURE;
 	}
 
+	if (mDataPlane.is_running()) {
+		if (mDataPlane.can_receive() || ((mOutboundBufferLen > 0) && mDataPlane.can_send())) {
+			cms = 0;
+		}
+	}
+
 	// If the control protothread hasn't even started, set cms to zero.
 	if (0 == mControlPT.lc) {
 		cms = 0;
@@ -576,11 +710,28 @@ SpinelNCPInstance::get_ms_to_next_event(void)
 		int tmp_cms = mTaskQueue.front()->get_ms_to_next_event();
 		if (tmp_cms < cms) {
 			cms = tmp_cms;
+			MainLoopProfiler::get_shared().note_timeout(MainLoopProfiler::kSourceNCPTaskQueue, cms);
 		}
 	}
 
 	if (cms > mVendorCustom.get_ms_to_next_event()) {
 		cms = mVendorCustom.get_ms_to_next_event();
+		MainLoopProfiler::get_shared().note_timeout(MainLoopProfiler::kSourceNCPVendorCustom, cms);
+	}
+
+	// Queued packets are ready to go as soon as the pump is free.
+	if ((mOutboundBufferLen == 0) && mFlowControl.can_send() && mEgressScheduler.has_ready_packet()) {
+		cms = 0;
+	}
+
+	if (cms > mEgressScheduler.get_ms_to_next_event()) {
+		cms = mEgressScheduler.get_ms_to_next_event();
+		MainLoopProfiler::get_shared().note_timeout(MainLoopProfiler::kSourceNCPEgressScheduler, cms);
+	}
+
+	if (cms > mFlowControl.get_ms_to_next_event()) {
+		cms = mFlowControl.get_ms_to_next_event();
+		MainLoopProfiler::get_shared().note_timeout(MainLoopProfiler::kSourceNCPFlowControl, cms);
 	}
 
 	if (cms < 0) {
@@ -826,8 +977,8 @@ bail:
 	return ret;
 }
 
-static int
-unpack_ncp_counters_all_mac(const uint8_t *data_in, spinel_size_t data_len, boost::any& value, bool as_val_map)
+int
+nl::wpantund::unpack_ncp_counters_all_mac(const uint8_t *data_in, spinel_size_t data_len, boost::any& value, bool as_val_map)
 {
 	std::list<std::string> result_as_string;
 	ValueMap result_as_val_map;
@@ -1152,6 +1303,178 @@ unpack_thread_network_time(const uint8_t *data_in, spinel_size_t data_len, boost
 	return ret;
 }
 
+void
+SpinelNCPInstance::update_counter_sample_period(Timer::Interval period)
+{
+	mCounterSamplePeriod = period;
+
+	if (period == 0) {
+		mCounterSampleTimer.cancel();
+		mCounterSampler.clear();
+	} else {
+		mCounterSampleTimer.set_slack(period / Timer::kDefaultSlackDivisor);
+		mCounterSampleTimer.schedule(
+			period,
+			boost::bind(&SpinelNCPInstance::counter_sample_timer_did_fire, this),
+			Timer::kPeriodicFixedRate
+		);
+
+		counter_sample_timer_did_fire();
+	}
+}
+
+void
+SpinelNCPInstance::counter_sample_timer_did_fire(void)
+{
+	// Skip this round if the last one hasn't come back yet, or if
+	// getting the counters would mean waking up the NCP.
+	if ( mCounterSampleInProgress
+	  || !mEnabled
+	  || ncp_state_is_initializing(get_ncp_state())
+	  || ncp_state_is_sleeping(get_ncp_state())
+	  || (get_ncp_state() == UPGRADING)
+	) {
+		return;
+	}
+
+	mCounterSampleInProgress = true;
+
+	start_new_task(boost::shared_ptr<SpinelNCPTask>(
+		new SpinelNCPTaskSampleCounters(
+			this,
+			boost::bind(&SpinelNCPInstance::counter_sample_did_finish, this, _1, _2)
+		)
+	));
+}
+
+void
+SpinelNCPInstance::counter_sample_did_finish(int status, const boost::any& value)
+{
+	mCounterSampleInProgress = false;
+
+	if ((status == kWPANTUNDStatus_Ok) && (mCounterSamplePeriod != 0)) {
+		mCounterSampler.record(boost::any_cast<const ValueMap&>(value));
+	}
+}
+
+void
+SpinelNCPInstance::get_sampled_counters(const std::string& key, CallbackWithStatusArg1 cb)
+{
+	ValueMap counters;
+	bool as_val_map = false;
+
+	if (mCounterSamplePeriod == 0) {
+		cb(kWPANTUNDStatus_InvalidForCurrentState, boost::any(std::string("Counter sampling is disabled, set " kWPANTUNDProperty_StatCountersPeriod " to enable it")));
+		return;
+	}
+
+	if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCounters)) {
+		mCounterSampler.get_counters(counters);
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersAsValMap)) {
+		mCounterSampler.get_counters(counters);
+		as_val_map = true;
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersRate)) {
+		mCounterSampler.get_rates(counters);
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersRateAsValMap)) {
+		mCounterSampler.get_rates(counters);
+		as_val_map = true;
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersDelta)) {
+		mCounterSampler.get_deltas(counters);
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersDeltaAsValMap)) {
+		mCounterSampler.get_deltas(counters);
+		as_val_map = true;
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersMinMax)) {
+		mCounterSampler.get_min_max(counters, mCounterSampleWindow);
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersMinMaxAsValMap)) {
+		mCounterSampler.get_min_max(counters, mCounterSampleWindow);
+		as_val_map = true;
+
+	} else {
+		NCPInstanceBase::property_get_value(key, cb);
+		return;
+	}
+
+	if (as_val_map) {
+		cb(kWPANTUNDStatus_Ok, boost::any(counters));
+	} else {
+		std::list<std::string> result;
+		CounterSampler::to_string_list(counters, result);
+		cb(kWPANTUNDStatus_Ok, boost::any(result));
+	}
+}
+
+void
+SpinelNCPInstance::update_topology_cache_period(Timer::Interval period)
+{
+	mTopologyCachePeriod = period;
+
+	if (period == 0) {
+		mTopologyCacheTimer.cancel();
+		mTopologyCache->invalidate();
+	} else {
+		mTopologyCacheTimer.set_slack(period / Timer::kDefaultSlackDivisor);
+		mTopologyCacheTimer.schedule(
+			period,
+			boost::bind(&SpinelNCPInstance::topology_cache_timer_did_fire, this),
+			Timer::kPeriodicFixedRate
+		);
+
+		topology_cache_timer_did_fire();
+	}
+}
+
+void
+SpinelNCPInstance::topology_cache_timer_did_fire(void)
+{
+	if ( mTopologyRefreshInProgress
+	  || !mEnabled
+	  || !ncp_state_is_associated(get_ncp_state())
+	  || ncp_state_is_sleeping(get_ncp_state())
+	) {
+		return;
+	}
+
+	mTopologyRefreshInProgress = true;
+
+	// The replies are picked up by `handle_ncp_spinel_value_is()`,
+	// which updates the cache.
+	start_new_task(SpinelNCPTaskSendCommand::Factory(this)
+		.set_callback(CallbackWithStatus(boost::bind(&SpinelNCPInstance::topology_refresh_did_finish, this, _1)))
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_CHILD_TABLE)
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_NEIGHBOR_TABLE)
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ROUTER_TABLE)
+		.finish()
+	);
+}
+
+void
+SpinelNCPInstance::topology_refresh_did_finish(int status)
+{
+	mTopologyRefreshInProgress = false;
+
+	if (status != kWPANTUNDStatus_Ok) {
+		syslog(LOG_INFO, "Refreshing topology cache failed: %d", status);
+	}
+}
+
+void
+SpinelNCPInstance::signal_topology_changes(const std::list<std::string>& changes)
+{
+	std::list<std::string>::const_iterator iter;
+
+	for (iter = changes.begin(); iter != changes.end(); ++iter) {
+		syslog(LOG_INFO, "[-NCP-]: Topology %s", iter->c_str());
+		signal_property_changed(kWPANTUNDProperty_ThreadTopologyChanges, *iter);
+	}
+}
+
 void
 SpinelNCPInstance::get_dataset_command_help(std::list<std::string> &list)
 {
@@ -1182,41 +1505,35 @@ SpinelNCPInstance::perform_dataset_command(const std::string &command, CallbackW
 	} else if (strcaseequal(command.c_str(), kWPANTUNDDatasetCommand_GetActive)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ACTIVE_DATASET)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ACTIVE_DATASET
 			)
 			.set_reply_unpacker(boost::bind(&SpinelNCPInstance::unpack_and_set_local_dataset, this, _1, _2))
 			.finish()
 		);
 
 	} else if (strcaseequal(command.c_str(), kWPANTUNDDatasetCommand_SetActive)) {
-		Data frame;
-		mLocalDataset.convert_to_spinel_frame(frame);
+		const Data &frame = mLocalDataset.get_spinel_frame();
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(
-					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
-					SPINEL_PROP_THREAD_ACTIVE_DATASET,
-					frame.data(),
-					frame.size()
-				)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
+				SPINEL_PROP_THREAD_ACTIVE_DATASET,
+				frame.data(),
+				frame.size()
 			)
 			.finish()
 		);
 
 	} else if (strcaseequal(command.c_str(), kWPANTUNDDatasetCommand_MgmtSendActive)) {
-		Data frame;
-		mLocalDataset.convert_to_spinel_frame(frame);
+		const Data &frame = mLocalDataset.get_spinel_frame();
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(
-					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
-					SPINEL_PROP_THREAD_MGMT_ACTIVE_DATASET,
-					frame.data(),
-					frame.size()
-				)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
+				SPINEL_PROP_THREAD_MGMT_ACTIVE_DATASET,
+				frame.data(),
+				frame.size()
 			)
 			.finish()
 		);
@@ -1224,41 +1541,35 @@ SpinelNCPInstance::perform_dataset_command(const std::string &command, CallbackW
 	} else if (strcaseequal(command.c_str(), kWPANTUNDDatasetCommand_GetPending)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_PENDING_DATASET)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_PENDING_DATASET
 			)
 			.set_reply_unpacker(boost::bind(&SpinelNCPInstance::unpack_and_set_local_dataset, this, _1, _2))
 			.finish()
 		);
 
 	} else if (strcaseequal(command.c_str(), kWPANTUNDDatasetCommand_SetPending)) {
-		Data frame;
-		mLocalDataset.convert_to_spinel_frame(frame);
+		const Data &frame = mLocalDataset.get_spinel_frame();
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(
-					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
-					SPINEL_PROP_THREAD_PENDING_DATASET,
-					frame.data(),
-					frame.size()
-				)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
+				SPINEL_PROP_THREAD_PENDING_DATASET,
+				frame.data(),
+				frame.size()
 			)
 			.finish()
 		);
 
 	} else if (strcaseequal(command.c_str(), kWPANTUNDDatasetCommand_MgmtSendPending)) {
-		Data frame;
-		mLocalDataset.convert_to_spinel_frame(frame);
+		const Data &frame = mLocalDataset.get_spinel_frame();
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(
-					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
-					SPINEL_PROP_THREAD_MGMT_PENDING_DATASET,
-					frame.data(),
-					frame.size()
-				)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
+				SPINEL_PROP_THREAD_MGMT_PENDING_DATASET,
+				frame.data(),
+				frame.size()
 			)
 			.finish()
 		);
@@ -1344,13 +1655,15 @@ SpinelNCPInstance::property_get_value(
 #define SIMPLE_SPINEL_GET(prop__, type__)                                \
 	start_new_task(SpinelNCPTaskSendCommand::Factory(this)               \
 		.set_callback(cb)                                                \
-		.add_command(                                                    \
-			SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, prop__) \
+		.add_packed_command(                                             \
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, prop__                 \
 		)                                                                \
 		.set_reply_format(type__)                                        \
 		.finish()                                                        \
 	)
 
+	boost::any cached_table;
+
 	if (strcaseequal(key.c_str(), kWPANTUNDProperty_ConfigNCPDriverName)) {
 		cb(0, boost::any(std::string("spinel")));
 
@@ -1392,8 +1705,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MCU_POWER_STATE)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MCU_POWER_STATE
 				)
 				.set_reply_unpacker(unpack_mcu_power_state)
 				.finish()
@@ -1467,6 +1780,9 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadCommissionerEnabled)) {
 		SIMPLE_SPINEL_GET(SPINEL_PROP_THREAD_COMMISSIONER_ENABLED, SPINEL_DATATYPE_BOOL_S);
 
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadCommissionerJoinerBulkProgress)) {
+		cb(kWPANTUNDStatus_Ok, boost::any(mJoinerBulkProgress));
+
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadRouterRoleEnabled)) {
 		SIMPLE_SPINEL_GET(SPINEL_PROP_THREAD_ROUTER_ROLE_ENABLED, SPINEL_DATATYPE_BOOL_S);
 
@@ -1479,8 +1795,8 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadActiveDataset)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ACTIVE_DATASET)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ACTIVE_DATASET
 			)
 			.set_reply_unpacker(boost::bind(unpack_dataset, _1, _2, _3, false))
 			.finish()
@@ -1489,8 +1805,8 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadActiveDatasetAsValMap)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ACTIVE_DATASET)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ACTIVE_DATASET
 			)
 			.set_reply_unpacker(boost::bind(unpack_dataset, _1, _2, _3, true))
 			.finish()
@@ -1499,8 +1815,8 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadPendingDataset)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_PENDING_DATASET)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_PENDING_DATASET
 			)
 			.set_reply_unpacker(boost::bind(unpack_dataset, _1, _2, _3, false))
 			.finish()
@@ -1509,8 +1825,8 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadPendingDatasetAsValMap)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 			.set_callback(cb)
-			.add_command(
-				SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_PENDING_DATASET)
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_PENDING_DATASET
 			)
 			.set_reply_unpacker(boost::bind(unpack_dataset, _1, _2, _3, true))
 			.finish()
@@ -1544,8 +1860,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_WHITELIST)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_WHITELIST
 				)
 				.set_reply_unpacker(boost::bind(unpack_mac_whitelist_entries, _1, _2, _3, false))
 				.finish()
@@ -1558,8 +1874,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_WHITELIST)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_WHITELIST
 				)
 				.set_reply_unpacker(boost::bind(unpack_mac_whitelist_entries, _1, _2, _3, true))
 				.finish()
@@ -1572,8 +1888,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_BLACKLIST)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_BLACKLIST
 				)
 				.set_reply_unpacker(boost::bind(unpack_mac_blacklist_entries, _1, _2, _3, false))
 				.finish()
@@ -1586,8 +1902,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_BLACKLIST)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_BLACKLIST
 				)
 				.set_reply_unpacker(boost::bind(unpack_mac_blacklist_entries, _1, _2, _3, true))
 				.finish()
@@ -1611,6 +1927,11 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_TmfProxyEnabled)) {
 		SIMPLE_SPINEL_GET(SPINEL_PROP_THREAD_TMF_PROXY_ENABLED, SPINEL_DATATYPE_BOOL_S);
 
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_TmfProxyCounters)) {
+		std::list<std::string> list;
+		mTmfProxySocket.get_counters_as_string_list(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_JamDetectionEnable)) {
 		if (!mCapabilities.count(SPINEL_CAP_JAM_DETECT)) {
 			cb(kWPANTUNDStatus_FeatureNotSupported, boost::any(std::string("Jam Detection Feature Not Supported")));
@@ -1645,8 +1966,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_JAM_DETECT_HISTORY_BITMAP)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_JAM_DETECT_HISTORY_BITMAP
 				)
 				.set_reply_unpacker(unpack_jam_detect_history_bitmap)
 				.finish()
@@ -1690,8 +2011,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MONITOR_CHANNEL_OCCUPANCY)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MONITOR_CHANNEL_OCCUPANCY
 				)
 				.set_reply_unpacker(boost::bind(unpack_channel_monitor_channel_quality, _1, _2, _3, false))
 				.finish()
@@ -1704,8 +2025,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MONITOR_CHANNEL_OCCUPANCY)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MONITOR_CHANNEL_OCCUPANCY
 				)
 				.set_reply_unpacker(boost::bind(unpack_channel_monitor_channel_quality, _1, _2, _3, true))
 				.finish()
@@ -1753,8 +2074,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MANAGER_SUPPORTED_CHANNELS)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MANAGER_SUPPORTED_CHANNELS
 				)
 				.set_reply_unpacker(unpack_channel_mask)
 				.finish()
@@ -1767,8 +2088,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MANAGER_FAVORED_CHANNELS)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CHANNEL_MANAGER_FAVORED_CHANNELS
 				)
 				.set_reply_unpacker(unpack_channel_mask)
 				.finish()
@@ -1782,6 +2103,9 @@ SpinelNCPInstance::property_get_value(
 			SIMPLE_SPINEL_GET(SPINEL_PROP_NEST_LEGACY_ULA_PREFIX, SPINEL_DATATYPE_DATA_S);
 		}
 
+	} else if ((mTopologyCachePeriod != 0) && mTopologyCache->get_table_for_property(key, cached_table)) {
+		cb(kWPANTUNDStatus_Ok, cached_table);
+
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadChildTable)) {
 		start_new_task(boost::shared_ptr<SpinelNCPTask>(
 			new SpinelNCPTaskGetNetworkTopology(
@@ -1879,11 +2203,19 @@ SpinelNCPInstance::property_get_value(
 			)
 		));
 
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadTopologyCachePeriod)) {
+		cb(kWPANTUNDStatus_Ok, boost::any(static_cast<int>(mTopologyCachePeriod / Timer::kOneSecond)));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadTopologyChanges)) {
+		std::list<std::string> list;
+		mTopologyCache->get_changes(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadAddressCacheTable)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ADDRESS_CACHE_TABLE)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ADDRESS_CACHE_TABLE
 				)
 				.set_reply_unpacker(boost::bind(unpack_address_cache_table, _1, _2, _3, /* as_val_map */ false))
 				.finish()
@@ -1892,8 +2224,8 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadAddressCacheTableAsValMap)) {
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ADDRESS_CACHE_TABLE)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_ADDRESS_CACHE_TABLE
 				)
 				.set_reply_unpacker(boost::bind(unpack_address_cache_table, _1, _2, _3, /* as_val_map */ true))
 				.finish()
@@ -2027,14 +2359,10 @@ SpinelNCPInstance::property_get_value(
 	} else if ((strcaseequal(key.c_str(), kWPANTUNDProperty_DatasetAllFileds)) ||
 	           (strcaseequal(key.c_str(), kWPANTUNDProperty_DatasetAllFileds_AltString))
 	) {
-		std::list<std::string> list;
-		mLocalDataset.convert_to_string_list(list);
-		cb(kWPANTUNDStatus_Ok, boost::any(list));
+		cb(kWPANTUNDStatus_Ok, boost::any(mLocalDataset.get_string_list()));
 
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DatasetAllFiledsAsValMap)) {
-		ValueMap map;
-		mLocalDataset.convert_to_valuemap(map);
-		cb(kWPANTUNDStatus_Ok, boost::any(map));
+		cb(kWPANTUNDStatus_Ok, boost::any(mLocalDataset.get_valuemap()));
 
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DatasetCommand)) {
 		std::list<std::string> help_string;
@@ -2044,14 +2372,51 @@ SpinelNCPInstance::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonTickleOnHostDidWake)) {
 		cb(kWPANTUNDStatus_Ok, boost::any(mTickleOnHostDidWake));
 
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonFrameLogging)) {
+		cb(kWPANTUNDStatus_Ok, boost::any(mFrameLogging));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_NCPFrameTrace)) {
+		std::list<std::string> list;
+		mFrameTrace.convert_to_string_list(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
+	} else if (mLinkChannel && strcaseequal(key.c_str(), kWPANTUNDProperty_NCPLinkCounters)) {
+		std::list<std::string> list;
+		mLinkChannel->get_link()->get_counters_as_string_list(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonDataPlane)) {
+		std::list<std::string> list;
+		mDataPlane.get_counters_as_string_list(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_NCPFlowControl)) {
+		std::list<std::string> list;
+		get_flow_control_as_string_list(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_NCPEgressScheduler)) {
+		std::list<std::string> list;
+		mEgressScheduler.get_counters_as_string_list(list);
+		cb(kWPANTUNDStatus_Ok, boost::any(list));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersPeriod)) {
+		cb(kWPANTUNDStatus_Ok, boost::any(static_cast<int>(mCounterSamplePeriod / Timer::kOneSecond)));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersWindow)) {
+		cb(kWPANTUNDStatus_Ok, boost::any(static_cast<int>(mCounterSampleWindow / Timer::kOneSecond)));
+
+	} else if (strncaseequal(key.c_str(), kWPANTUNDProperty_StatCounters, sizeof(kWPANTUNDProperty_StatCounters) - 1)) {
+		get_sampled_counters(key, cb);
+
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_NCPCounterAllMac)) {
 		if (!mCapabilities.count(SPINEL_CAP_COUNTERS)) {
 			cb(kWPANTUNDStatus_FeatureNotSupported, boost::any(std::string("Channel Monitoring Feature Not Supported")));
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CNTR_ALL_MAC_COUNTERS)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CNTR_ALL_MAC_COUNTERS
 				)
 				.set_reply_unpacker(boost::bind(unpack_ncp_counters_all_mac, _1, _2, _3, /* as_val_map */ false))
 				.finish()
@@ -2064,8 +2429,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CNTR_ALL_MAC_COUNTERS)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_CNTR_ALL_MAC_COUNTERS
 				)
 				.set_reply_unpacker(boost::bind(unpack_ncp_counters_all_mac, _1, _2, _3, /* as_val_map */ true))
 				.finish()
@@ -2148,8 +2513,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_NETWORK_TIME)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_NETWORK_TIME
 				)
 				.set_reply_unpacker(boost::bind(unpack_thread_network_time, _1, _2, _3, false))
 				.finish()
@@ -2162,8 +2527,8 @@ SpinelNCPInstance::property_get_value(
 		} else {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_NETWORK_TIME)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_THREAD_NETWORK_TIME
 				)
 				.set_reply_unpacker(boost::bind(unpack_thread_network_time, _1, _2, _3, true))
 				.finish()
@@ -2208,14 +2573,44 @@ SpinelNCPInstance::property_set_value(
 		if (mVendorCustom.is_property_key_supported(key)) {
 			mVendorCustom.property_set_value(key, value, cb);
 
+		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersPeriod)) {
+			int period_in_sec = any_to_int(value);
+
+			if ((period_in_sec >= 0) && (period_in_sec <= kPeriodicUpdateMaxPeriod)) {
+				update_counter_sample_period(period_in_sec * Timer::kOneSecond);
+				cb(kWPANTUNDStatus_Ok);
+			} else {
+				cb(kWPANTUNDStatus_InvalidArgument);
+			}
+
+		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatCountersWindow)) {
+			int window_in_sec = any_to_int(value);
+
+			if ((window_in_sec > 0) && (window_in_sec <= kPeriodicUpdateMaxPeriod)) {
+				mCounterSampleWindow = window_in_sec * Timer::kOneSecond;
+				cb(kWPANTUNDStatus_Ok);
+			} else {
+				cb(kWPANTUNDStatus_InvalidArgument);
+			}
+
+		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_ThreadTopologyCachePeriod)) {
+			int period_in_sec = any_to_int(value);
+
+			if ((period_in_sec >= 0) && (period_in_sec <= kPeriodicUpdateMaxPeriod)) {
+				update_topology_cache_period(period_in_sec * Timer::kOneSecond);
+				cb(kWPANTUNDStatus_Ok);
+			} else {
+				cb(kWPANTUNDStatus_InvalidArgument);
+			}
+
 		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_NCPChannel)) {
 			int channel = any_to_int(value);
 			mCurrentNetworkInstance.channel = channel;
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S), SPINEL_PROP_PHY_CHAN, channel)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S), SPINEL_PROP_PHY_CHAN, channel
 				)
 				.finish()
 			);
@@ -2272,8 +2667,8 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S), SPINEL_PROP_MAC_15_4_PANID, panid)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S), SPINEL_PROP_MAC_15_4_PANID, panid
 				)
 				.finish()
 			);
@@ -2283,8 +2678,8 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_NET_PSKC, network_pskc.data(), network_pskc.size())
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_NET_PSKC, network_pskc.data(), network_pskc.size()
 				)
 				.finish()
 			);
@@ -2312,8 +2707,8 @@ SpinelNCPInstance::property_set_value(
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_NET_MASTER_KEY, network_key.data(), network_key.size())
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_NET_MASTER_KEY, network_key.data(), network_key.size()
 					)
 					.finish()
 				);
@@ -2325,12 +2720,10 @@ SpinelNCPInstance::property_set_value(
 			if (eui64_value.size() == sizeof(spinel_eui64_t)) {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(
-							SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_EUI64_S),
-							SPINEL_PROP_MAC_15_4_LADDR,
-							eui64_value.data()
-						)
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_EUI64_S),
+						SPINEL_PROP_MAC_15_4_LADDR,
+						eui64_value.data()
 					)
 					.finish()
 				);
@@ -2344,31 +2737,31 @@ SpinelNCPInstance::property_set_value(
 			if (isup) {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(SpinelPackData(
+					.add_packed_command(
 						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 						SPINEL_PROP_NET_IF_UP,
 						true
-					))
-					.add_command(SpinelPackData(
+					)
+					.add_packed_command(
 						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 						SPINEL_PROP_NET_STACK_UP,
 						true
-					))
+					)
 					.finish()
 				);
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(SpinelPackData(
+					.add_packed_command(
 						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 						SPINEL_PROP_NET_STACK_UP,
 						false
-					))
-					.add_command(SpinelPackData(
+					)
+					.add_packed_command(
 						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 						SPINEL_PROP_NET_IF_UP,
 						false
-					))
+					)
 					.finish()
 				);
 			}
@@ -2379,12 +2772,10 @@ SpinelNCPInstance::property_set_value(
 			if (eui64_value.size() == sizeof(spinel_eui64_t)) {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(
-							SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_EUI64_S),
-							SPINEL_PROP_MAC_EXTENDED_ADDR,
-							eui64_value.data()
-						)
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_EUI64_S),
+						SPINEL_PROP_MAC_EXTENDED_ADDR,
+						eui64_value.data()
 					)
 					.finish()
 				);
@@ -2415,8 +2806,8 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_NET_XPANID, xpanid.data(), xpanid.size())
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_NET_XPANID, xpanid.data(), xpanid.size()
 				)
 				.finish()
 			);
@@ -2428,8 +2819,8 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S), SPINEL_PROP_NET_KEY_SEQUENCE_COUNTER, key_index)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S), SPINEL_PROP_NET_KEY_SEQUENCE_COUNTER, key_index
 				)
 				.finish()
 			);
@@ -2439,8 +2830,8 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S), SPINEL_PROP_NET_KEY_SWITCH_GUARDTIME, guard_time)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S), SPINEL_PROP_NET_KEY_SWITCH_GUARDTIME, guard_time
 				)
 				.finish()
 			);
@@ -2450,7 +2841,7 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UTF8_S), SPINEL_PROP_NET_NETWORK_NAME, str.c_str()))
+				.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UTF8_S), SPINEL_PROP_NET_NETWORK_NAME, str.c_str())
 				.finish()
 			);
 
@@ -2459,7 +2850,7 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S), SPINEL_PROP_NET_ROLE, role))
+				.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S), SPINEL_PROP_NET_ROLE, role)
 				.finish()
 			);
 
@@ -2468,8 +2859,8 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(
-					SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S), SPINEL_PROP_THREAD_PREFERRED_ROUTER_ID, routerId)
+				.add_packed_command(
+					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S), SPINEL_PROP_THREAD_PREFERRED_ROUTER_ID, routerId
 				)
 				.finish()
 			);
@@ -2511,12 +2902,10 @@ SpinelNCPInstance::property_set_value(
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(
-							SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
-							SPINEL_PROP_MAC_WHITELIST_ENABLED,
-							isEnabled
-						)
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
+						SPINEL_PROP_MAC_WHITELIST_ENABLED,
+						isEnabled
 					)
 					.finish()
 				);
@@ -2531,12 +2920,10 @@ SpinelNCPInstance::property_set_value(
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(
-							SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
-							SPINEL_PROP_MAC_BLACKLIST_ENABLED,
-							isEnabled
-						)
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
+						SPINEL_PROP_MAC_BLACKLIST_ENABLED,
+						isEnabled
 					)
 					.finish()
 				);
@@ -2655,11 +3042,11 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(
+				.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 					SPINEL_PROP_THREAD_COMMISSIONER_ENABLED,
 					isEnabled
-				))
+				)
 				.finish()
 			);
 
@@ -2668,11 +3055,11 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(
+				.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 					SPINEL_PROP_THREAD_ROUTER_ROLE_ENABLED,
 					isEnabled
-				))
+				)
 				.finish()
 			);
 
@@ -2681,11 +3068,11 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(
+				.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 					SPINEL_PROP_THREAD_ROUTER_SELECTION_JITTER,
 					jitter
-				))
+				)
 				.finish()
 			);
 
@@ -2694,11 +3081,11 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(
+				.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 					SPINEL_PROP_THREAD_ROUTER_UPGRADE_THRESHOLD,
 					threshold
-				))
+				)
 				.finish()
 			);
 
@@ -2707,11 +3094,11 @@ SpinelNCPInstance::property_set_value(
 
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 				.set_callback(cb)
-				.add_command(SpinelPackData(
+				.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 					SPINEL_PROP_THREAD_ROUTER_DOWNGRADE_THRESHOLD,
 					threshold
-				))
+				)
 				.finish()
 			);
 
@@ -2817,11 +3204,11 @@ SpinelNCPInstance::property_set_value(
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(SpinelPackData(
+					.add_packed_command(
 						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 						SPINEL_PROP_CHANNEL_MANAGER_CHANNEL_SELECT,
 						skip_check
-					))
+					)
 					.finish()
 				);
 			}
@@ -3020,6 +3407,11 @@ SpinelNCPInstance::property_set_value(
 			syslog(LOG_INFO, "TickleOnHostDidWake is %sabled", mTickleOnHostDidWake ? "en" : "dis");
 			cb(kWPANTUNDStatus_Ok);
 
+		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonFrameLogging)) {
+			mFrameLogging = any_to_bool(value);
+			syslog(LOG_INFO, "FrameLogging is %sabled", mFrameLogging ? "en" : "dis");
+			cb(kWPANTUNDStatus_Ok);
+
 		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_TimeSync_Period)) {
 			uint16_t sync_period = any_to_int(value);
 
@@ -3028,8 +3420,8 @@ SpinelNCPInstance::property_set_value(
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S), SPINEL_PROP_TIME_SYNC_PERIOD, sync_period)
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S), SPINEL_PROP_TIME_SYNC_PERIOD, sync_period
 					)
 					.finish()
 				);
@@ -3043,8 +3435,8 @@ SpinelNCPInstance::property_set_value(
 			} else {
 				start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 					.set_callback(cb)
-					.add_command(
-						SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S), SPINEL_PROP_TIME_SYNC_XTAL_THRESHOLD, xtal_threshold)
+					.add_packed_command(
+						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S), SPINEL_PROP_TIME_SYNC_XTAL_THRESHOLD, xtal_threshold
 					)
 					.finish()
 				);
@@ -3094,13 +3486,11 @@ SpinelNCPInstance::property_insert_value(
 				if (ext_address.size() == sizeof(spinel_eui64_t)) {
 					start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 						.set_callback(cb)
-						.add_command(
-							SpinelPackData(
-								SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(SPINEL_DATATYPE_EUI64_S SPINEL_DATATYPE_INT8_S),
-								SPINEL_PROP_MAC_WHITELIST,
-								ext_address.data(),
-								rssi
-							)
+						.add_packed_command(
+							SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(SPINEL_DATATYPE_EUI64_S SPINEL_DATATYPE_INT8_S),
+							SPINEL_PROP_MAC_WHITELIST,
+							ext_address.data(),
+							rssi
 						)
 						.finish()
 					);
@@ -3119,13 +3509,11 @@ SpinelNCPInstance::property_insert_value(
 				if (ext_address.size() == sizeof(spinel_eui64_t)) {
 					start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 						.set_callback(cb)
-						.add_command(
-							SpinelPackData(
-								SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(SPINEL_DATATYPE_EUI64_S SPINEL_DATATYPE_INT8_S),
-								SPINEL_PROP_MAC_BLACKLIST,
-								ext_address.data(),
-								rssi
-							)
+						.add_packed_command(
+							SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(SPINEL_DATATYPE_EUI64_S SPINEL_DATATYPE_INT8_S),
+							SPINEL_PROP_MAC_BLACKLIST,
+							ext_address.data(),
+							rssi
 						)
 						.finish()
 					);
@@ -3170,12 +3558,10 @@ SpinelNCPInstance::property_remove_value(
 				if (ext_address.size() == sizeof(spinel_eui64_t)) {
 					start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 						.set_callback(cb)
-						.add_command(
-							SpinelPackData(
-								SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(SPINEL_DATATYPE_EUI64_S),
-								SPINEL_PROP_MAC_WHITELIST,
-								ext_address.data()
-							)
+						.add_packed_command(
+							SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(SPINEL_DATATYPE_EUI64_S),
+							SPINEL_PROP_MAC_WHITELIST,
+							ext_address.data()
 						)
 						.finish()
 					);
@@ -3193,12 +3579,10 @@ SpinelNCPInstance::property_remove_value(
 				if (ext_address.size() == sizeof(spinel_eui64_t)) {
 					start_new_task(SpinelNCPTaskSendCommand::Factory(this)
 						.set_callback(cb)
-						.add_command(
-							SpinelPackData(
-								SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(SPINEL_DATATYPE_EUI64_S),
-								SPINEL_PROP_MAC_BLACKLIST,
-								ext_address.data()
-							)
+						.add_packed_command(
+							SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(SPINEL_DATATYPE_EUI64_S),
+							SPINEL_PROP_MAC_BLACKLIST,
+							ext_address.data()
 						)
 						.finish()
 					);
@@ -3337,6 +3721,9 @@ SpinelNCPInstance::handle_ncp_spinel_value_is(spinel_prop_key_t key, const uint8
 		syslog(LOG_INFO, "[-NCP-]: Last status (%s, %d)", spinel_status_to_cstr(status), status);
 		if ((status >= SPINEL_STATUS_RESET__BEGIN) && (status <= SPINEL_STATUS_RESET__END)) {
 			syslog(LOG_NOTICE, "[-NCP-]: NCP was reset (%s, %d)", spinel_status_to_cstr(status), status);
+			mFlowControl.reset();
+			mEgressScheduler.flush();
+			mNCPIsLowPower = false;
 			process_event(EVENT_NCP_RESET, status);
 			if (!mResetIsExpected && (mDriverState == NORMAL_OPERATION)) {
 				wpantund_status_t wstatus = kWPANTUNDStatus_NCP_Reset;
@@ -3445,6 +3832,8 @@ SpinelNCPInstance::handle_ncp_spinel_value_is(spinel_prop_key_t key, const uint8
 			syslog(LOG_INFO, "[-NCP-]: MCU power state \"%s\" (%d)",
 				spinel_mcu_power_state_to_cstr(static_cast<spinel_mcu_power_state_t>(power_state)), power_state);
 
+			mNCPIsLowPower = (power_state == SPINEL_MCU_POWER_STATE_LOW_POWER);
+
 			switch (get_ncp_state()) {
 			case OFFLINE:
 			case COMMISSIONED:
@@ -3947,7 +4336,7 @@ SpinelNCPInstance::handle_ncp_spinel_value_is(spinel_prop_key_t key, const uint8
 		__ASSERT_MACROS_check(ret > 0);
 
 		// Analyze the packet to determine if it should be dropped.
-		if ((ret > 0)) {
+		if ((ret > 0) && !mTmfProxySocket.handle_frame_from_ncp(frame_ptr, frame_len, locator, port)) {
 			// append frame
 			data.append(frame_ptr, frame_len);
 			// pack the locator in big endian.
@@ -3996,12 +4385,19 @@ SpinelNCPInstance::handle_ncp_spinel_value_is(spinel_prop_key_t key, const uint8
 
 		SpinelNCPTaskGetNetworkTopology::parse_child_table(value_data_ptr, value_data_len, child_table);
 
-		for (it = child_table.begin(); it != child_table.end(); it++)
-		{
-			num_children++;
-			syslog(LOG_INFO, "[-NCP-] Child: %02d %s", num_children, it->get_as_string().c_str());
+		// With the topology cache on, only what changed is logged.
+		if (mTopologyCachePeriod != 0) {
+			std::list<std::string> changes;
+			mTopologyCache->update_table(SpinelNCPTaskGetNetworkTopology::kChildTable, child_table, changes);
+			signal_topology_changes(changes);
+		} else {
+			for (it = child_table.begin(); it != child_table.end(); it++)
+			{
+				num_children++;
+				syslog(LOG_INFO, "[-NCP-] Child: %02d %s", num_children, it->get_as_string().c_str());
+			}
+			syslog(LOG_INFO, "[-NCP-] Child: Total %d child%s", num_children, (num_children > 1) ? "ren" : "");
 		}
-		syslog(LOG_INFO, "[-NCP-] Child: Total %d child%s", num_children, (num_children > 1) ? "ren" : "");
 
 	} else if (key == SPINEL_PROP_THREAD_NEIGHBOR_TABLE) {
 		SpinelNCPTaskGetNetworkTopology::Table neigh_table;
@@ -4010,12 +4406,18 @@ SpinelNCPInstance::handle_ncp_spinel_value_is(spinel_prop_key_t key, const uint8
 
 		SpinelNCPTaskGetNetworkTopology::parse_neighbor_table(value_data_ptr, value_data_len, neigh_table);
 
-		for (it = neigh_table.begin(); it != neigh_table.end(); it++)
-		{
-			num_neighbor++;
-			syslog(LOG_INFO, "[-NCP-] Neighbor: %02d %s", num_neighbor, it->get_as_string().c_str());
+		if (mTopologyCachePeriod != 0) {
+			std::list<std::string> changes;
+			mTopologyCache->update_table(SpinelNCPTaskGetNetworkTopology::kNeighborTable, neigh_table, changes);
+			signal_topology_changes(changes);
+		} else {
+			for (it = neigh_table.begin(); it != neigh_table.end(); it++)
+			{
+				num_neighbor++;
+				syslog(LOG_INFO, "[-NCP-] Neighbor: %02d %s", num_neighbor, it->get_as_string().c_str());
+			}
+			syslog(LOG_INFO, "[-NCP-] Neighbor: Total %d neighbor%s", num_neighbor, (num_neighbor > 1) ? "s" : "");
 		}
-		syslog(LOG_INFO, "[-NCP-] Neighbor: Total %d neighbor%s", num_neighbor, (num_neighbor > 1) ? "s" : "");
 
 	} else if (key == SPINEL_PROP_THREAD_NEIGHBOR_TABLE_ERROR_RATES) {
 		SpinelNCPTaskGetNetworkTopology::Table neigh_table;
@@ -4038,12 +4440,18 @@ SpinelNCPInstance::handle_ncp_spinel_value_is(spinel_prop_key_t key, const uint8
 
 		SpinelNCPTaskGetNetworkTopology::parse_router_table(value_data_ptr, value_data_len, router_table);
 
-		for (it = router_table.begin(); it != router_table.end(); it++)
-		{
-			num_router++;
-			syslog(LOG_INFO, "[-NCP-] Router: %02d %s", num_router, it->get_as_string().c_str());
+		if (mTopologyCachePeriod != 0) {
+			std::list<std::string> changes;
+			mTopologyCache->update_table(SpinelNCPTaskGetNetworkTopology::kRouterTable, router_table, changes);
+			signal_topology_changes(changes);
+		} else {
+			for (it = router_table.begin(); it != router_table.end(); it++)
+			{
+				num_router++;
+				syslog(LOG_INFO, "[-NCP-] Router: %02d %s", num_router, it->get_as_string().c_str());
+			}
+			syslog(LOG_INFO, "[-NCP-] Router: Total %d router%s", num_router, (num_router > 1) ? "s" : "");
 		}
-		syslog(LOG_INFO, "[-NCP-] Router: Total %d router%s", num_router, (num_router > 1) ? "s" : "");
 
 
 	} else if (key == SPINEL_PROP_THREAD_ADDRESS_CACHE_TABLE) {
@@ -4129,6 +4537,12 @@ SpinelNCPInstance::handle_ncp_spinel_value_inserted(spinel_prop_key_t key, const
 
 		if (status == kWPANTUNDStatus_Ok) {
 			syslog(LOG_INFO, "[-NCP-]: ChildTable entry added: %s", child_entry.get_as_string().c_str());
+
+			if (mTopologyCachePeriod != 0) {
+				std::list<std::string> changes;
+				mTopologyCache->insert_entry(child_entry, changes);
+				signal_topology_changes(changes);
+			}
 		}
 
 	}
@@ -4147,6 +4561,12 @@ SpinelNCPInstance::handle_ncp_spinel_value_removed(spinel_prop_key_t key, const
 
 		if (status == kWPANTUNDStatus_Ok) {
 			syslog(LOG_INFO, "[-NCP-]: ChildTable entry removed: %s", child_entry.get_as_string().c_str());
+
+			if (mTopologyCachePeriod != 0) {
+				std::list<std::string> changes;
+				mTopologyCache->remove_entry(child_entry, changes);
+				signal_topology_changes(changes);
+			}
 		}
 
 	}
@@ -4157,6 +4577,20 @@ SpinelNCPInstance::handle_ncp_spinel_value_removed(spinel_prop_key_t key, const
 void
 SpinelNCPInstance::handle_ncp_state_change(NCPState new_ncp_state, NCPState old_ncp_state)
 {
+	// If we are configured to terminate on fault, the trace
+	// is dumped from `handle_fatal_error()` instead.
+	if ((new_ncp_state == FAULT) && (old_ncp_state != FAULT) && !mTerminateOnFault) {
+		syslog(LOG_WARNING, "[-NCP-]: NCP entered fault state, dumping Spinel frame trace");
+		mFrameTrace.dump_to_syslog(LOG_WARNING);
+	}
+
+	// The serial port is about to be hibernated or reset, so the
+	// data-plane thread needs to let go of it first. It is restarted
+	// from `process()` once we are attached again.
+	if (ncp_state_is_detached_from_ncp(new_ncp_state) != ncp_state_is_detached_from_ncp(old_ncp_state)) {
+		mDataPlane.stop();
+	}
+
 	NCPInstanceBase::handle_ncp_state_change(new_ncp_state, old_ncp_state);
 
 	if ( ncp_state_is_joining_or_joined(old_ncp_state)
@@ -4170,25 +4604,36 @@ SpinelNCPInstance::handle_ncp_state_change(NCPState new_ncp_state, NCPState old_
 		mIsPcapInProgress = false;
 	}
 
+	if (!ncp_state_is_associated(new_ncp_state)
+	 && ncp_state_is_associated(old_ncp_state)
+	) {
+		// The tables are rebuilt once we are associated again.
+		mTopologyCache->invalidate();
+	}
+
 	if (ncp_state_is_associated(new_ncp_state)
 	 && !ncp_state_is_associated(old_ncp_state)
 	) {
 		mIsCommissioned = true;
 		start_new_task(SpinelNCPTaskSendCommand::Factory(this)
-			.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_15_4_LADDR))
-			.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_IPV6_ML_ADDR))
-			.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_NET_XPANID))
-			.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_15_4_PANID))
-			.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_PHY_CHAN))
-			.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_IPV6_ADDRESS_TABLE))
+			.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_15_4_LADDR)
+			.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_IPV6_ML_ADDR)
+			.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_NET_XPANID)
+			.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_MAC_15_4_PANID)
+			.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_PHY_CHAN)
+			.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_IPV6_ADDRESS_TABLE)
 			.finish()
 		);
+
+		if (mTopologyCachePeriod != 0) {
+			topology_cache_timer_did_fire();
+		}
 	} else if (ncp_state_is_joining(new_ncp_state)
 	 && !ncp_state_is_joining(old_ncp_state)
 	) {
 		if (!buffer_is_nonzero(mNCPV6Prefix, 8)) {
 			start_new_task(SpinelNCPTaskSendCommand::Factory(this)
-				.add_command(SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_IPV6_ML_PREFIX))
+				.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_IPV6_ML_PREFIX)
 				.finish()
 			);
 		}
@@ -4198,6 +4643,9 @@ SpinelNCPInstance::handle_ncp_state_change(NCPState new_ncp_state, NCPState old_
 void
 SpinelNCPInstance::handle_ncp_spinel_callback(unsigned int command, const uint8_t* cmd_data_ptr, spinel_size_t cmd_data_len)
 {
+	mFrameTrace.record(SpinelNCPFrameTrace::kDirectionFromNCP, cmd_data_ptr, cmd_data_len);
+	mFrameCapture.record(FrameCapture::kFrameFromNCP, cmd_data_ptr, cmd_data_len);
+
 	switch (command) {
 	case SPINEL_CMD_PROP_VALUE_IS:
 		{
@@ -4214,10 +4662,27 @@ SpinelNCPInstance::handle_ncp_spinel_callback(unsigned int command, const uint8_
 				return;
 			}
 
-			if ((key != SPINEL_PROP_STREAM_DEBUG) && (key != SPINEL_PROP_STREAM_LOG)) {
+			if (mFrameLogging && (key != SPINEL_PROP_STREAM_DEBUG) && (key != SPINEL_PROP_STREAM_LOG)) {
 				syslog(LOG_INFO, "[NCP->] CMD_PROP_VALUE_IS(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(cmd_data_ptr[0]));
 			}
 
+			// Packets go to the NCP without a TID, so a status without
+			// one about memory or dropping can only be about a packet.
+			if ((key == SPINEL_PROP_LAST_STATUS) && (SPINEL_HEADER_GET_TID(cmd_data_ptr[0]) == 0)) {
+				spinel_status_t status = SPINEL_STATUS_OK;
+				spinel_datatype_unpack(value_data_ptr, value_data_len, "i", &status);
+
+				if ((status == SPINEL_STATUS_NOMEM) || (status == SPINEL_STATUS_DROPPED)) {
+					mFlowControl.handle_ncp_drop();
+				}
+			}
+
+			if ((mFlowControlProbeHeader != 0) && (cmd_data_ptr[0] == mFlowControlProbeHeader)) {
+				if (handle_flow_control_probe_reply(key, value_data_ptr, value_data_len)) {
+					return;
+				}
+			}
+
 			return handle_ncp_spinel_value_is(key, value_data_ptr, value_data_len);
 		}
 		break;
@@ -4237,7 +4702,9 @@ SpinelNCPInstance::handle_ncp_spinel_callback(unsigned int command, const uint8_
 				return;
 			}
 
-			syslog(LOG_INFO, "[NCP->] CMD_PROP_VALUE_INSERTED(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(cmd_data_ptr[0]));
+			if (mFrameLogging) {
+				syslog(LOG_INFO, "[NCP->] CMD_PROP_VALUE_INSERTED(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(cmd_data_ptr[0]));
+			}
 
 			return handle_ncp_spinel_value_inserted(key, value_data_ptr, value_data_len);
 		}
@@ -4258,7 +4725,9 @@ SpinelNCPInstance::handle_ncp_spinel_callback(unsigned int command, const uint8_
 				return;
 			}
 
-			syslog(LOG_INFO, "[NCP->] CMD_PROP_VALUE_REMOVED(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(cmd_data_ptr[0]));
+			if (mFrameLogging) {
+				syslog(LOG_INFO, "[NCP->] CMD_PROP_VALUE_REMOVED(%s) tid:%d", spinel_prop_key_to_cstr(key), SPINEL_HEADER_GET_TID(cmd_data_ptr[0]));
+			}
 
 			return handle_ncp_spinel_value_removed(key, value_data_ptr, value_data_len);
 		}
@@ -4274,7 +4743,7 @@ SpinelNCPInstance::handle_ncp_spinel_callback(unsigned int command, const uint8_
 
 			__ASSERT_MACROS_check(ret != -1);
 
-			if (ret > 0) {
+			if (mFrameLogging && (ret > 0)) {
 				syslog(LOG_INFO, "[NCP->] CMD_PEEK_RET(0x%x,%d) tid:%d", address, count, SPINEL_HEADER_GET_TID(cmd_data_ptr[0]));
 			}
 		}
@@ -4344,20 +4813,18 @@ SpinelNCPInstance::add_unicast_address_on_ncp(const struct in6_addr &addr, uint8
 
 	factory.set_callback(cb);
 
-	factory.add_command(
-		SpinelPackData(
-			SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
-				SPINEL_DATATYPE_IPv6ADDR_S   // Address
-				SPINEL_DATATYPE_UINT8_S      // Prefix Length
-				SPINEL_DATATYPE_UINT32_S     // Valid Lifetime
-				SPINEL_DATATYPE_UINT32_S     // Preferred Lifetime
-			),
-			SPINEL_PROP_IPV6_ADDRESS_TABLE,
-			&addr,
-			prefix_len,
-			UINT32_MAX,
-			UINT32_MAX
-		)
+	factory.add_packed_command(
+		SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
+			SPINEL_DATATYPE_IPv6ADDR_S   // Address
+			SPINEL_DATATYPE_UINT8_S      // Prefix Length
+			SPINEL_DATATYPE_UINT32_S     // Valid Lifetime
+			SPINEL_DATATYPE_UINT32_S     // Preferred Lifetime
+		),
+		SPINEL_PROP_IPV6_ADDRESS_TABLE,
+		&addr,
+		prefix_len,
+		UINT32_MAX,
+		UINT32_MAX
 	);
 
 	start_new_task(factory.finish());
@@ -4372,16 +4839,14 @@ SpinelNCPInstance::remove_unicast_address_on_ncp(const struct in6_addr& addr, ui
 
 	factory.set_callback(cb);
 
-	factory.add_command(
-		SpinelPackData(
-			SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(
-				SPINEL_DATATYPE_IPv6ADDR_S   // Address
-				SPINEL_DATATYPE_UINT8_S      // Prefix
-			),
-			SPINEL_PROP_IPV6_ADDRESS_TABLE,
-			&addr,
-			prefix_len
-		)
+	factory.add_packed_command(
+		SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(
+			SPINEL_DATATYPE_IPv6ADDR_S   // Address
+			SPINEL_DATATYPE_UINT8_S      // Prefix
+		),
+		SPINEL_PROP_IPV6_ADDRESS_TABLE,
+		&addr,
+		prefix_len
 	);
 
 	start_new_task(factory.finish());
@@ -4396,14 +4861,12 @@ SpinelNCPInstance::add_multicast_address_on_ncp(const struct in6_addr &addr, Cal
 
 	factory.set_callback(cb);
 
-	factory.add_command(
-		SpinelPackData(
-			SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
-				SPINEL_DATATYPE_IPv6ADDR_S   // Address
-			),
-			SPINEL_PROP_IPV6_MULTICAST_ADDRESS_TABLE,
-			&addr
-		)
+	factory.add_packed_command(
+		SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
+			SPINEL_DATATYPE_IPv6ADDR_S   // Address
+		),
+		SPINEL_PROP_IPV6_MULTICAST_ADDRESS_TABLE,
+		&addr
 	);
 
 	start_new_task(factory.finish());
@@ -4418,14 +4881,12 @@ SpinelNCPInstance::remove_multicast_address_on_ncp(const struct in6_addr &addr,
 
 	factory.set_callback(cb);
 
-	factory.add_command(
-		SpinelPackData(
-			SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(
-				SPINEL_DATATYPE_IPv6ADDR_S   // Address
-			),
-			SPINEL_PROP_IPV6_MULTICAST_ADDRESS_TABLE,
-			&addr
-		)
+	factory.add_packed_command(
+		SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(
+			SPINEL_DATATYPE_IPv6ADDR_S   // Address
+		),
+		SPINEL_PROP_IPV6_MULTICAST_ADDRESS_TABLE,
+		&addr
 	);
 
 	start_new_task(factory.finish());
@@ -4442,7 +4903,7 @@ SpinelNCPInstance::add_on_mesh_prefix_on_ncp(const struct in6_addr &prefix, uint
 	factory.set_lock_property(SPINEL_PROP_THREAD_ALLOW_LOCAL_NET_DATA_CHANGE);
 	factory.set_callback(cb);
 
-	factory.add_command(SpinelPackData(
+	factory.add_packed_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
 			SPINEL_DATATYPE_IPv6ADDR_S
 			SPINEL_DATATYPE_UINT8_S
@@ -4454,7 +4915,7 @@ SpinelNCPInstance::add_on_mesh_prefix_on_ncp(const struct in6_addr &prefix, uint
 		prefix_len,
 		stable,
 		flags
-	));
+	);
 
 	start_new_task(factory.finish());
 }
@@ -4470,7 +4931,7 @@ SpinelNCPInstance::remove_on_mesh_prefix_on_ncp(const struct in6_addr &prefix, u
 	factory.set_lock_property(SPINEL_PROP_THREAD_ALLOW_LOCAL_NET_DATA_CHANGE);
 	factory.set_callback(cb);
 
-	factory.add_command(SpinelPackData(
+	factory.add_packed_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(
 			SPINEL_DATATYPE_IPv6ADDR_S
 			SPINEL_DATATYPE_UINT8_S
@@ -4482,7 +4943,7 @@ SpinelNCPInstance::remove_on_mesh_prefix_on_ncp(const struct in6_addr &prefix, u
 		prefix_len,
 		stable,
 		flags
-	));
+	);
 
 	start_new_task(factory.finish());
 }
@@ -4499,7 +4960,7 @@ SpinelNCPInstance::add_route_on_ncp(const struct in6_addr &route, uint8_t prefix
 	factory.set_lock_property(SPINEL_PROP_THREAD_ALLOW_LOCAL_NET_DATA_CHANGE);
 	factory.set_callback(cb);
 
-	factory.add_command(SpinelPackData(
+	factory.add_packed_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
 			SPINEL_DATATYPE_IPv6ADDR_S
 			SPINEL_DATATYPE_UINT8_S
@@ -4511,7 +4972,7 @@ SpinelNCPInstance::add_route_on_ncp(const struct in6_addr &route, uint8_t prefix
 		prefix_len,
 		stable,
 		convert_route_preference_to_flags(preference)
-	));
+	);
 
 	start_new_task(factory.finish());
 }
@@ -4528,7 +4989,7 @@ SpinelNCPInstance::remove_route_on_ncp(const struct in6_addr &route, uint8_t pre
 	factory.set_lock_property(SPINEL_PROP_THREAD_ALLOW_LOCAL_NET_DATA_CHANGE);
 	factory.set_callback(cb);
 
-	factory.add_command(SpinelPackData(
+	factory.add_packed_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_REMOVE(
 			SPINEL_DATATYPE_IPv6ADDR_S
 			SPINEL_DATATYPE_UINT8_S
@@ -4540,7 +5001,7 @@ SpinelNCPInstance::remove_route_on_ncp(const struct in6_addr &route, uint8_t pre
 		prefix_len,
 		stable,
 		convert_route_preference_to_flags(preference)
-	));
+	);
 
 	start_new_task(factory.finish());
 }
@@ -4600,13 +5061,65 @@ SpinelNCPInstance::is_busy(void)
 		|| !mTaskQueue.empty();
 }
 
+void
+SpinelNCPInstance::hard_reset_ncp(void)
+{
+	mDataPlane.stop();
+
+	NCPInstanceBase::hard_reset_ncp();
+
+	// The NCP comes out of a hardware reset at its default
+	// baud rate, so we need to go back to ours.
+	if ((mUpgradeBaudBase > 0) && can_hard_reset_ncp()) {
+		mSerialAdapter->set_baud_rate(mUpgradeBaudBase);
+		mUpgradeBaudBase = 0;
+	}
+}
+
+bool
+SpinelNCPInstance::should_upgrade_baud_rate(void)
+{
+	int baud;
+
+	if ((mUpgradeBaud <= 0) || mUpgradeBaudFailed) {
+		return false;
+	}
+
+	// Without a hardware reset we would have no way of getting
+	// the NCP back to a rate we know if anything goes wrong.
+	if (!can_hard_reset_ncp()) {
+		syslog(LOG_WARNING, "\"%s\" requires \"%s\", ignoring", kWPANTUNDProperty_ConfigNCPUpgradeBaud, kWPANTUNDProperty_ConfigNCPHardResetPath);
+		mUpgradeBaudFailed = true;
+		return false;
+	}
+
+	baud = mSerialAdapter->get_baud_rate();
+
+	if (baud <= 0) {
+		syslog(LOG_WARNING, "\"%s\" is only supported on serial ports, ignoring", kWPANTUNDProperty_ConfigNCPUpgradeBaud);
+		mUpgradeBaudFailed = true;
+		return false;
+	}
+
+	// Already upgraded (the NCP keeps its rate across software resets).
+	return baud != mUpgradeBaud;
+}
+
 void
 SpinelNCPInstance::process(void)
 {
+	update_data_plane();
+
+	update_flow_control();
+
+	mEgressScheduler.set_ncp_asleep(ncp_state_is_sleeping(get_ncp_state()) || mNCPIsLowPower);
+
 	NCPInstanceBase::process();
 
 	mVendorCustom.process();
 
+	mTmfProxySocket.process();
+
 	if (!is_initializing_ncp() && mTaskQueue.empty()) {
 		bool x = mPcapManager.is_enabled();
 
@@ -4615,31 +5128,31 @@ SpinelNCPInstance::process(void)
 
 			mIsPcapInProgress = x;
 
-			factory.add_command(SpinelPackData(
+			factory.add_packed_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_MAC_RAW_STREAM_ENABLED,
 				mIsPcapInProgress
-			));
+			);
 
 			if (mIsPcapInProgress) {
-				factory.add_command(SpinelPackData(
+				factory.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 					SPINEL_PROP_NET_IF_UP,
 					true
-				));
+				);
 				if (!ncp_state_is_joining_or_joined(get_ncp_state())) {
-					factory.add_command(SpinelPackData(
+					factory.add_packed_command(
 						SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 						SPINEL_PROP_MAC_PROMISCUOUS_MODE,
 						SPINEL_MAC_PROMISCUOUS_MODE_FULL
-					));
+					);
 				}
 			} else {
-				factory.add_command(SpinelPackData(
+				factory.add_packed_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 					SPINEL_PROP_MAC_PROMISCUOUS_MODE,
 					SPINEL_MAC_PROMISCUOUS_MODE_OFF
-				));
+				);
 			}
 
 			start_new_task(factory.finish());
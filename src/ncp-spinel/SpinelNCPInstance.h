@@ -23,10 +23,22 @@
 #include "NCPInstanceBase.h"
 #include "SpinelNCPControlInterface.h"
 #include "SpinelNCPThreadDataset.h"
+#include "SpinelNCPFrameTrace.h"
+#include "SpinelNCPFramePool.h"
+#include "SpinelNCPFlowControl.h"
+#include "SpinelNCPEgressScheduler.h"
+#include "SpinelNCPHDLC.h"
+#include "SpinelNCPDataPlane.h"
+#include "SpinelNCPLink.h"
+#include "SpinelNCPScanPlanner.h"
+#include "SpinelNCPTmfProxySocket.h"
 #include "nlpt.h"
 #include "SocketWrapper.h"
 #include "SocketAsyncOp.h"
 #include "ValueMap.h"
+#include "FixedBlockPool.h"
+#include "CounterSampler.h"
+#include "Timer.h"
 
 #include <queue>
 #include <set>
@@ -35,60 +47,16 @@
 #include "spinel.h"
 
 #include "SpinelNCPVendorCustom.h"
+#include "SpinelNCPInstanceMacros.h"
 
 WPANTUND_DECLARE_NCPINSTANCE_PLUGIN(spinel, SpinelNCPInstance);
 
-#define EVENT_NCP_MARKER         0xAB000000
-#define EVENT_NCP(x)             ((x)|EVENT_NCP_MARKER)
-#define IS_EVENT_FROM_NCP(x)     (((x)&~0xFFFFFF) == EVENT_NCP_MARKER)
-
-
-#define EVENT_NCP_RESET                (0xFF0000|EVENT_NCP_MARKER)
-#define EVENT_NCP_PROP_VALUE_IS        (0xFF0001|EVENT_NCP_MARKER)
-#define EVENT_NCP_PROP_VALUE_INSERTED  (0xFF0002|EVENT_NCP_MARKER)
-#define EVENT_NCP_PROP_VALUE_REMOVED   (0xFF0003|EVENT_NCP_MARKER)
-
-#define NCP_FRAMING_OVERHEAD 3
-
-#define CONTROL_REQUIRE_EMPTY_OUTBOUND_BUFFER_WITHIN(seconds, error_label) do { \
-		EH_WAIT_UNTIL_WITH_TIMEOUT(seconds, (GetInstance(this)->mOutboundBufferLen <= 0) && GetInstance(this)->mOutboundCallback.empty()); \
-		require_string(!eh_did_timeout, error_label, "Timed out while waiting " # seconds " seconds for empty outbound buffer"); \
-	} while (0)
-
-#define CONTROL_REQUIRE_OUTBOUND_BUFFER_FLUSHED_WITHIN(seconds, error_label) do { \
-		static const int ___crsw_send_finished = 0xFF000000 | __LINE__; \
-		static const int ___crsw_send_failed = 0xFE000000 | __LINE__; \
-		__ASSERT_MACROS_check(GetInstance(this)->mOutboundCallback.empty()); \
-		require(GetInstance(this)->mOutboundBufferLen > 0, error_label); \
-		GetInstance(this)->mOutboundCallback = CALLBACK_FUNC_SPLIT( \
-			boost::bind(&NCPInstanceBase::process_event_helper, GetInstance(this), ___crsw_send_finished), \
-			boost::bind(&NCPInstanceBase::process_event_helper, GetInstance(this), ___crsw_send_failed) \
-		); \
-		GetInstance(this)->mOutboundBuffer[0] = mLastHeader; \
-		EH_WAIT_UNTIL_WITH_TIMEOUT(seconds, (event == ___crsw_send_finished) || (event == ___crsw_send_failed)); \
-		require_string(!eh_did_timeout, error_label, "Timed out while trying to send command"); \
-		require_string(event == ___crsw_send_finished, error_label, "Failure while trying to send command"); \
-	} while (0)
-
-#define CONTROL_REQUIRE_PREP_TO_SEND_COMMAND_WITHIN(timeout, error_label) do { \
-		CONTROL_REQUIRE_EMPTY_OUTBOUND_BUFFER_WITHIN(timeout, error_label); \
-		GetInstance(this)->mLastTID = SPINEL_GET_NEXT_TID(GetInstance(this)->mLastTID); \
-		mLastHeader = (SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (GetInstance(this)->mLastTID << SPINEL_HEADER_TID_SHIFT)); \
-	} while (false)
-
-#define CONTROL_REQUIRE_COMMAND_RESPONSE_WITHIN(timeout, error_label) do { \
-		EH_REQUIRE_WITHIN(	\
-			timeout,	\
-			IS_EVENT_FROM_NCP(event) && GetInstance(this)->mInboundHeader == mLastHeader, \
-			error_label	\
-		);	\
-	} while (false)
-
 namespace nl {
 namespace wpantund {
 
 class SpinelNCPTask;
 class SpinelNCPControlInterface;
+class SpinelNCPTopologyCache;
 
 class SpinelNCPInstance : public NCPInstanceBase {
 	friend class SpinelNCPControlInterface;
@@ -104,6 +72,9 @@ class SpinelNCPInstance : public NCPInstanceBase {
 	friend class SpinelNCPTaskSendCommand;
 	friend class SpinelNCPTaskGetNetworkTopology;
 	friend class SpinelNCPTaskGetMsgBufferCounters;
+	friend class SpinelNCPTaskSampleCounters;
+	friend class SpinelNCPTaskJoinerAddBulk;
+	friend class SpinelNCPTmfProxySocket;
 
 public:
 
@@ -113,6 +84,13 @@ public:
 		NORMAL_OPERATION
 	};
 
+	// Task queue nodes come from a fixed pool, so queueing a task
+	// doesn't normally need a heap allocation.
+	typedef std::list<
+		boost::shared_ptr<SpinelNCPTask>,
+		FixedBlockAllocator<boost::shared_ptr<SpinelNCPTask>, 64, 32>
+	> TaskQueue;
+
 public:
 	SpinelNCPInstance(const Settings& settings = Settings());
 
@@ -131,6 +109,24 @@ protected:
 
 	virtual bool is_busy(void);
 
+	virtual void hard_reset_ncp(void);
+
+	bool should_upgrade_baud_rate(void);
+
+	void update_data_plane(void);
+	bool data_plane_fast_path_allowed(void);
+	void data_plane_receive(void);
+	void data_plane_send(void);
+	void handle_ncp_frame(const uint8_t* frame_ptr, spinel_size_t frame_len);
+	void handle_ncp_bound_packet(const uint8_t* packet, spinel_size_t packet_len);
+
+	void update_flow_control(void);
+	bool handle_flow_control_probe_reply(spinel_prop_key_t key, const uint8_t* value_data_ptr, spinel_size_t value_data_len);
+	void get_flow_control_as_string_list(std::list<std::string>& list);
+
+	bool should_read_outbound_packets(void) const;
+	int queue_outbound_packets(void);
+
 protected:
 
 	int vprocess_init(int event, va_list args);
@@ -146,6 +142,10 @@ protected:
 	void handle_ncp_state_change(NCPState new_ncp_state, NCPState old_ncp_state);
 
 	void handle_ncp_log_stream(const uint8_t* data_ptr, int data_len);
+	void log_outbound_frame(void);
+	void queue_outbound_frame(int slot);
+	void clear_outbound_frame(void);
+	void handle_fatal_error(int err);
 	void handle_ncp_spinel_value_is_OFF_MESH_ROUTE(const uint8_t* value_data_ptr, spinel_size_t value_data_len);
 
 	bool should_filter_address(const struct in6_addr &address, uint8_t prefix_len);
@@ -180,6 +180,18 @@ private:
 	void update_mesh_local_address(struct in6_addr *addr);
 	void update_mesh_local_prefix(struct in6_addr *addr);
 
+private:
+	void update_counter_sample_period(Timer::Interval period);
+	void counter_sample_timer_did_fire(void);
+	void counter_sample_did_finish(int status, const boost::any& value);
+	void get_sampled_counters(const std::string& key, CallbackWithStatusArg1 cb);
+
+private:
+	void update_topology_cache_period(Timer::Interval period);
+	void topology_cache_timer_did_fire(void);
+	void topology_refresh_did_finish(int status);
+	void signal_topology_changes(const std::list<std::string>& changes);
+
 private:
 	void get_dataset_command_help(std::list<std::string> &list);
 	int unpack_and_set_local_dataset(const uint8_t *data_in, spinel_size_t data_len);
@@ -197,6 +209,14 @@ public:
 
 	virtual cms_t get_ms_to_next_event(void);
 
+	virtual int update_fd_set(
+		fd_set *read_fd_set,
+		fd_set *write_fd_set,
+		fd_set *error_fd_set,
+		int *max_fd,
+		cms_t *timeout
+	);
+
 	virtual void reset_tasks(wpantund_status_t status = kWPANTUNDStatus_Canceled);
 
 	static void handle_ncp_debug_stream(const uint8_t* data_ptr, int data_len);
@@ -254,10 +274,46 @@ private:
 	uint8_t mOutboundBufferType;
 	spinel_ssize_t mOutboundBufferLen;
 	spinel_ssize_t mOutboundBufferSent;
-	uint8_t mOutboundBufferEscaped[SPINEL_FRAME_BUFFER_SIZE*2];
+	uint8_t mOutboundBufferEscaped[HDLC_ENCODED_SIZE(SPINEL_FRAME_BUFFER_SIZE)];
 	spinel_ssize_t mOutboundBufferEscapedLen;
 	boost::function<void(int)> mOutboundCallback;
 
+	// Frame the pump sends next: `mOutboundBuffer`, or a slot of
+	// `mOutboundFramePool` handed over by a task (`mOutboundFrameSlot`).
+	uint8_t* mOutboundFrame;
+	int mOutboundFrameSlot;
+	SpinelNCPFramePool mOutboundFramePool;
+
+	SpinelNCPFrameTrace mFrameTrace;
+	bool mFrameLogging;
+
+	// Paces packets from the network interface, see `Config:NCP:FlowControl`.
+	SpinelNCPFlowControl mFlowControl;
+
+	// Header of the unanswered flow control probe, or zero. The pump
+	// sends probes itself, so they can't wait behind a long task.
+	uint8_t mFlowControlProbeHeader;
+
+	// Orders packets from the network interface by class, see
+	// `Config:NCP:EgressScheduler`.
+	SpinelNCPEgressScheduler mEgressScheduler;
+
+	// Set while the NCP reports its MCU to be in low-power state.
+	bool mNCPIsLowPower;
+
+	SpinelNCPDataPlane mDataPlane;
+	bool mDataPlaneEnabled;
+	bool mDataPlaneIOUring;
+
+	// Set when this instance shares its serial link with others,
+	// see `Config:NCP:IID`.
+	boost::shared_ptr<SpinelNCPLink::Channel> mLinkChannel;
+
+	// Runtime baud rate upgrade, see `Config:NCP:UpgradeBaud`.
+	int mUpgradeBaud;
+	int mUpgradeBaudBase; //!^ Host baud rate before the upgrade, zero if not upgraded.
+	bool mUpgradeBaudFailed;
+
 	int mTXPower;
 	uint8_t mThreadMode;
 	bool mIsCommissioned;
@@ -269,6 +325,9 @@ private:
 	bool mSetSteeringDataWhenJoinable;
 	uint8_t mSteeringDataAddress[8];
 
+	// Last progress report of a bulk joiner add.
+	std::string mJoinerBulkProgress;
+
 	ThreadDataset mLocalDataset;
 
 	SettingsMap mSettings;
@@ -292,8 +351,28 @@ private:
 
 	bool mIsPcapInProgress;
 
+	// Periodic counter sampling, see `Stat:Counters:Period`.
+	CounterSampler mCounterSampler;
+	Timer mCounterSampleTimer;
+	Timer::Interval mCounterSamplePeriod;
+	Timer::Interval mCounterSampleWindow;
+	bool mCounterSampleInProgress;
+
+	// Cached child/neighbor/router tables, see `Thread:TopologyCache:Period`.
+	boost::shared_ptr<SpinelNCPTopologyCache> mTopologyCache;
+	Timer mTopologyCacheTimer;
+	Timer::Interval mTopologyCachePeriod;
+	bool mTopologyRefreshInProgress;
+
+	// Channels on which beacons were heard, used to order streaming scans.
+	SpinelNCPScanPlanner mScanPlanner;
+
+	// TMF proxy traffic bypassing D-Bus, see `Config:TmfProxy:SocketPath`.
+	// Declared before the task queue, whose tasks call back into it.
+	SpinelNCPTmfProxySocket mTmfProxySocket;
+
 	// Task management
-	std::list<boost::shared_ptr<SpinelNCPTask> > mTaskQueue;
+	TaskQueue mTaskQueue;
 
 	// The vendor custom class needs to
 	// remain as the last thing in this class.
@@ -330,6 +409,8 @@ bool ncp_event_matches_header_from_args(int event, va_list args, uint8_t last_he
 
 int peek_ncp_callback_status(int event, va_list args);
 
+int unpack_ncp_counters_all_mac(const uint8_t *data_in, spinel_size_t data_len, boost::any& value, bool as_val_map);
+
 int spinel_status_to_wpantund_status(int spinel_status);
 
 }; // namespace wpantund
@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright (c) 2016 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Events and control macros shared by `SpinelNCPInstance` and its
+ *      tasks. The macros are expanded inside task event handlers, and
+ *      expect `SpinelNCPInstance` and `GetInstance()` to be declared by
+ *      the time they are.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPInstanceMacros__
+#define __wpantund__SpinelNCPInstanceMacros__
+
+#include <boost/bind.hpp>
+#include "spinel.h"
+
+#define EVENT_NCP_MARKER         0xAB000000
+#define EVENT_NCP(x)             ((x)|EVENT_NCP_MARKER)
+#define IS_EVENT_FROM_NCP(x)     (((x)&~0xFFFFFF) == EVENT_NCP_MARKER)
+
+
+#define EVENT_NCP_RESET                (0xFF0000|EVENT_NCP_MARKER)
+#define EVENT_NCP_PROP_VALUE_IS        (0xFF0001|EVENT_NCP_MARKER)
+#define EVENT_NCP_PROP_VALUE_INSERTED  (0xFF0002|EVENT_NCP_MARKER)
+#define EVENT_NCP_PROP_VALUE_REMOVED   (0xFF0003|EVENT_NCP_MARKER)
+
+#define NCP_FRAMING_OVERHEAD 3
+
+#define CONTROL_REQUIRE_EMPTY_OUTBOUND_BUFFER_WITHIN(seconds, error_label) do { \
+		EH_WAIT_UNTIL_WITH_TIMEOUT(seconds, (GetInstance(this)->mOutboundBufferLen <= 0) && GetInstance(this)->mOutboundCallback.empty()); \
+		require_string(!eh_did_timeout, error_label, "Timed out while waiting " # seconds " seconds for empty outbound buffer"); \
+	} while (0)
+
+#define CONTROL_REQUIRE_OUTBOUND_BUFFER_FLUSHED_WITHIN(seconds, error_label) do { \
+		static const int ___crsw_send_finished = 0xFF000000 | __LINE__; \
+		static const int ___crsw_send_failed = 0xFE000000 | __LINE__; \
+		__ASSERT_MACROS_check(GetInstance(this)->mOutboundCallback.empty()); \
+		require(GetInstance(this)->mOutboundBufferLen > 0, error_label); \
+		GetInstance(this)->mOutboundCallback = boost::bind( \
+			&nl::wpantund::process_send_status_helper<nl::wpantund::SpinelNCPInstance>, \
+			GetInstance(this), \
+			___crsw_send_finished, \
+			___crsw_send_failed, \
+			_1 \
+		); \
+		GetInstance(this)->mOutboundFrame[0] = mLastHeader; \
+		EH_WAIT_UNTIL_WITH_TIMEOUT(seconds, (event == ___crsw_send_finished) || (event == ___crsw_send_failed)); \
+		require_string(!eh_did_timeout, error_label, "Timed out while trying to send command"); \
+		require_string(event == ___crsw_send_finished, error_label, "Failure while trying to send command"); \
+	} while (0)
+
+#define CONTROL_REQUIRE_PREP_TO_SEND_COMMAND_WITHIN(timeout, error_label) do { \
+		CONTROL_REQUIRE_EMPTY_OUTBOUND_BUFFER_WITHIN(timeout, error_label); \
+		GetInstance(this)->mLastTID = SPINEL_GET_NEXT_TID(GetInstance(this)->mLastTID); \
+		mLastHeader = (SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (GetInstance(this)->mLastTID << SPINEL_HEADER_TID_SHIFT)); \
+	} while (false)
+
+#define CONTROL_REQUIRE_COMMAND_RESPONSE_WITHIN(timeout, error_label) do { \
+		EH_REQUIRE_WITHIN(	\
+			timeout,	\
+			IS_EVENT_FROM_NCP(event) && GetInstance(this)->mInboundHeader == mLastHeader, \
+			error_label	\
+		);	\
+	} while (false)
+
+namespace nl {
+namespace wpantund {
+
+// Passes the outcome of sending a command on to the task waiting in
+// `CONTROL_REQUIRE_OUTBOUND_BUFFER_FLUSHED_WITHIN()`. Unlike a pair of
+// callbacks joined with `CALLBACK_FUNC_SPLIT()`, binding this fits in
+// a `boost::function` without allocating.
+template<class Instance>
+inline void
+process_send_status_helper(Instance* instance, int finished_event, int failed_event, int status)
+{
+	instance->process_event_helper((status == 0) ? finished_event : failed_event);
+}
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPInstanceMacros__) */
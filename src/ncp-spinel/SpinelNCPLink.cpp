@@ -0,0 +1,564 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "SpinelNCPLink.h"
+#include "SuperSocket.h"
+#include "assert-macros.h"
+#include "socket-utils.h"
+#include "string-utils.h"
+#include <syslog.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace nl;
+using namespace nl::wpantund;
+
+// Upper bound on serial reads per call to `process()`, so that a busy
+// link can't starve the rest of the main loop.
+#define LINK_MAX_READS_PER_PROCESS  4
+#define LINK_READ_CHUNK_SIZE        256
+
+std::map<std::string, boost::weak_ptr<SpinelNCPLink> > SpinelNCPLink::sLinks;
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Link
+
+SpinelNCPLink::SpinelNCPLink(const std::string& socket_path):
+	mSocketPath(socket_path),
+	mSerial(SuperSocket::create(socket_path)),
+	mIsHibernating(false),
+	mUnroutedFrames(0),
+	mCRCErrors(0),
+	mOutboundEscapedLen(0),
+	mOutboundEscapedSent(0),
+	mNextChannel(0),
+	mLastError(0)
+{
+	memset(mChannels, 0, sizeof(mChannels));
+}
+
+SpinelNCPLink::~SpinelNCPLink()
+{
+	sLinks.erase(mSocketPath);
+}
+
+boost::shared_ptr<SpinelNCPLink::Channel>
+SpinelNCPLink::open_channel(const std::string& socket_path, uint8_t iid)
+{
+	boost::shared_ptr<SpinelNCPLink> link = sLinks[socket_path].lock();
+	boost::shared_ptr<Channel> channel;
+
+	if (iid >= kMaxChannels) {
+		throw std::invalid_argument("Spinel IID must be between 0 and 3");
+	}
+
+	// The multiplexer speaks HDLC, which a shared-memory link doesn't have.
+	if (strcasehasprefix(socket_path.c_str(), SOCKET_SHM_COMMAND_PREFIX)) {
+		throw std::invalid_argument("Spinel IID is not supported on shared-memory links");
+	}
+
+	if (!link) {
+		link = boost::shared_ptr<SpinelNCPLink>(new SpinelNCPLink(socket_path));
+		sLinks[socket_path] = link;
+		syslog(LOG_INFO, "[-NCP-]: Opened shared link to \"%s\"", socket_path.c_str());
+	}
+
+	if (link->mChannels[iid] != NULL) {
+		throw std::invalid_argument("Spinel IID is already in use on this link");
+	}
+
+	channel = boost::shared_ptr<Channel>(new Channel(link, iid));
+	link->mChannels[iid] = channel.get();
+
+	syslog(LOG_INFO, "[-NCP-]: Attached IID %d to shared link \"%s\"", iid, socket_path.c_str());
+
+	return channel;
+}
+
+void
+SpinelNCPLink::remove_channel(Channel* channel)
+{
+	if (mChannels[channel->mIID] == channel) {
+		mChannels[channel->mIID] = NULL;
+	}
+}
+
+void
+SpinelNCPLink::get_counters_as_string_list(std::list<std::string>& list) const
+{
+	char line[160];
+	int i;
+
+	for (i = 0; i < kMaxChannels; i++) {
+		const Channel* channel = mChannels[i];
+
+		if (channel == NULL) {
+			continue;
+		}
+
+		snprintf(
+			line,
+			sizeof(line),
+			"IID %d: FramesToNCP:%u BytesToNCP:%u FramesFromNCP:%u BytesFromNCP:%u Dropped:%u",
+			i,
+			channel->mCounters.mFramesToNCP,
+			channel->mCounters.mBytesToNCP,
+			channel->mCounters.mFramesFromNCP,
+			channel->mCounters.mBytesFromNCP,
+			channel->mCounters.mDroppedFrames
+		);
+		list.push_back(line);
+	}
+
+	snprintf(line, sizeof(line), "Link: Unrouted:%u CRCErrors:%u", mUnroutedFrames, mCRCErrors);
+	list.push_back(line);
+}
+
+void
+SpinelNCPLink::dispatch(uint8_t* frame_ptr, spinel_size_t frame_len_with_crc)
+{
+	spinel_size_t frame_len;
+	Channel* channel;
+
+	if (!hdlc_frame_crc_is_valid(frame_ptr, frame_len_with_crc)) {
+		syslog(LOG_WARNING, "[NCP->]: Frame CRC Mismatch on shared link, Garbage on line?");
+		mCRCErrors++;
+		return;
+	}
+
+	frame_len = frame_len_with_crc - 2;
+	channel = mChannels[SPINEL_HEADER_GET_IID(frame_ptr[0])];
+
+	if (channel == NULL) {
+		mUnroutedFrames++;
+		return;
+	}
+
+	// Every instance believes that it is talking to IID 0.
+	frame_ptr[0] &= ~SPINEL_HEADER_IID_MASK;
+
+	channel->deliver(frame_ptr, frame_len);
+}
+
+bool
+SpinelNCPLink::has_pending_output(void) const
+{
+	int i;
+
+	if (mOutboundEscapedSent < mOutboundEscapedLen) {
+		return true;
+	}
+
+	for (i = 0; i < kMaxChannels; i++) {
+		if ((mChannels[i] != NULL) && !mChannels[i]->mOutbound.empty()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int
+SpinelNCPLink::pump_output(void)
+{
+	int ret = 0;
+
+	while (!mIsHibernating) {
+		if (mOutboundEscapedSent < mOutboundEscapedLen) {
+			ssize_t sent = mSerial->write(
+				mOutboundEscaped + mOutboundEscapedSent,
+				mOutboundEscapedLen - mOutboundEscapedSent
+			);
+
+			if ((sent == -EAGAIN) || (sent == -EINTR) || (sent == 0)) {
+				break;
+			}
+
+			if (sent < 0) {
+				syslog(LOG_ERR, "[-NCP-]: Socket error on write: %s", strerror((int)-sent));
+				mLastError = (int)sent;
+				ret = (int)sent;
+				break;
+			}
+
+			mOutboundEscapedSent += static_cast<spinel_size_t>(sent);
+
+			if (mOutboundEscapedSent < mOutboundEscapedLen) {
+				break;
+			}
+
+			mOutboundEscapedLen = mOutboundEscapedSent = 0;
+		}
+
+		// Give each channel one frame per turn, so that a busy
+		// interface can't lock the others out of the link.
+		{
+			Channel::Frame* frame = NULL;
+			Channel* channel = NULL;
+			int i;
+
+			for (i = 0; i < kMaxChannels; i++) {
+				channel = mChannels[(mNextChannel + i) % kMaxChannels];
+
+				if (channel != NULL) {
+					frame = channel->mOutbound.begin_read();
+
+					if (frame != NULL) {
+						break;
+					}
+				}
+			}
+
+			if (frame == NULL) {
+				break;
+			}
+
+			mNextChannel = (channel->mIID + 1) % kMaxChannels;
+
+			frame->mData[0] = (frame->mData[0] & ~SPINEL_HEADER_IID_MASK)
+			                | (channel->mIID << SPINEL_HEADER_IID_SHIFT);
+
+			mOutboundEscapedLen = hdlc_encode_frame(
+				frame->mData,
+				frame->mLength,
+				mOutboundEscaped,
+				sizeof(mOutboundEscaped)
+			);
+			mOutboundEscapedSent = 0;
+
+			channel->mCounters.mFramesToNCP++;
+			channel->mCounters.mBytesToNCP += frame->mLength;
+			channel->mOutbound.commit_read();
+		}
+	}
+
+	return ret;
+}
+
+int
+SpinelNCPLink::process(void)
+{
+	uint8_t buffer[LINK_READ_CHUNK_SIZE];
+	int reads = 0;
+	int ret = 0;
+
+	require_quiet(!mIsHibernating, bail);
+
+	mSerial->process();
+
+	if (mSerial->did_reset()) {
+		mark_channels_reset();
+	}
+
+	while (reads++ < LINK_MAX_READS_PER_PROCESS) {
+		ssize_t len = mSerial->read(buffer, sizeof(buffer));
+		ssize_t i;
+
+		if (len < 0) {
+			if ((len != -EAGAIN) && (len != -EINTR)) {
+				syslog(LOG_ERR, "[-NCP-]: Socket error on read: %s", strerror((int)-len));
+				mLastError = (int)len;
+				ret = (int)len;
+			}
+			break;
+		}
+
+		for (i = 0; i < len; i++) {
+			if (mDecoder.decode(buffer[i])) {
+				dispatch(mDecoder.get_frame(), mDecoder.get_frame_size());
+			}
+		}
+
+		if (len < (ssize_t)sizeof(buffer)) {
+			break;
+		}
+	}
+
+	if (ret == 0) {
+		ret = pump_output();
+	}
+
+bail:
+	return ret;
+}
+
+void
+SpinelNCPLink::reset(void)
+{
+	int i;
+
+	syslog(LOG_NOTICE, "[-NCP-]: Resetting shared link \"%s\"", mSocketPath.c_str());
+
+	mSerial->reset();
+
+	mIsHibernating = false;
+	mLastError = 0;
+	mDecoder.reset();
+	mOutboundEscapedLen = mOutboundEscapedSent = 0;
+
+	for (i = 0; i < kMaxChannels; i++) {
+		Channel* channel = mChannels[i];
+
+		if (channel != NULL) {
+			channel->mInbound.clear();
+			channel->mDecoder.reset();
+			channel->mOutbound.clear();
+			channel->mIsHibernating = false;
+		}
+	}
+
+	mark_channels_reset();
+}
+
+void
+SpinelNCPLink::mark_channels_reset(void)
+{
+	int i;
+
+	// Every interface on the NCP is affected by a reset, so every
+	// instance needs to hear about it.
+	for (i = 0; i < kMaxChannels; i++) {
+		if (mChannels[i] != NULL) {
+			mChannels[i]->mDidReset = true;
+		}
+	}
+}
+
+void
+SpinelNCPLink::update_hibernation(void)
+{
+	int i;
+
+	for (i = 0; i < kMaxChannels; i++) {
+		if ((mChannels[i] != NULL) && !mChannels[i]->mIsHibernating) {
+			return;
+		}
+	}
+
+	// Only let go of the port once nobody needs it anymore.
+	if (!mIsHibernating) {
+		syslog(LOG_INFO, "[-NCP-]: All interfaces on \"%s\" are hibernating", mSocketPath.c_str());
+		mSerial->hibernate();
+		mIsHibernating = true;
+	}
+}
+
+// ----------------------------------------------------------------------------
+// MARK: -
+// MARK: Channel
+
+SpinelNCPLink::Channel::Channel(const boost::shared_ptr<SpinelNCPLink>& link, uint8_t iid):
+	mLink(link),
+	mIID(iid),
+	mDidReset(false),
+	mIsHibernating(false)
+{
+	memset(&mCounters, 0, sizeof(mCounters));
+}
+
+SpinelNCPLink::Channel::~Channel()
+{
+	mLink->remove_channel(this);
+}
+
+void
+SpinelNCPLink::Channel::deliver(const uint8_t* frame_ptr, spinel_size_t frame_len)
+{
+	uint8_t encoded[HDLC_ENCODED_SIZE(SPINEL_FRAME_BUFFER_SIZE)];
+	spinel_size_t encoded_len;
+
+	encoded_len = hdlc_encode_frame(frame_ptr, frame_len, encoded, sizeof(encoded));
+
+	if ((encoded_len == 0) || (mInbound.space_available() < (int)encoded_len)) {
+		// The instance isn't keeping up. Drop the whole frame rather
+		// than hand it a partial one.
+		mCounters.mDroppedFrames++;
+		return;
+	}
+
+	mInbound.push(encoded, encoded_len);
+
+	mCounters.mFramesFromNCP++;
+	mCounters.mBytesFromNCP += frame_len;
+}
+
+void
+SpinelNCPLink::Channel::flush(void)
+{
+	if (!mLink->mIsHibernating) {
+		mLink->pump_output();
+	}
+}
+
+ssize_t
+SpinelNCPLink::Channel::write(const void* data, size_t len)
+{
+	const uint8_t* byte_ptr = static_cast<const uint8_t*>(data);
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		// Don't accept a byte that might complete a frame
+		// unless there is room to queue that frame.
+		if (mOutbound.full()) {
+			break;
+		}
+
+		if (mDecoder.decode(byte_ptr[i])) {
+			Frame* frame = mOutbound.begin_write();
+			const spinel_size_t frame_len = mDecoder.get_frame_size() - 2;
+
+			// The IID field now selects the channel, so there is no
+			// room left for a legacy interface behind this instance.
+			if (SPINEL_HEADER_GET_IID(mDecoder.get_frame()[0]) != 0) {
+				syslog(LOG_WARNING, "[->NCP]: Dropping frame for IID %d, not supported on shared links", SPINEL_HEADER_GET_IID(mDecoder.get_frame()[0]));
+				mCounters.mDroppedFrames++;
+				continue;
+			}
+
+			memcpy(frame->mData, mDecoder.get_frame(), frame_len);
+			frame->mLength = frame_len;
+			mOutbound.commit_write();
+		}
+	}
+
+	flush();
+
+	return static_cast<ssize_t>(i);
+}
+
+ssize_t
+SpinelNCPLink::Channel::read(void* data, size_t len)
+{
+	if (mInbound.empty()) {
+		return mLink->mLastError;
+	}
+
+	return mInbound.pull(static_cast<uint8_t*>(data), len);
+}
+
+bool
+SpinelNCPLink::Channel::can_read(void)const
+{
+	return !mInbound.empty();
+}
+
+bool
+SpinelNCPLink::Channel::can_write(void)const
+{
+	return !mOutbound.full();
+}
+
+int
+SpinelNCPLink::Channel::process(void)
+{
+	return mLink->process();
+}
+
+int
+SpinelNCPLink::Channel::get_read_fd(void)const
+{
+	return mLink->mSerial->get_read_fd();
+}
+
+int
+SpinelNCPLink::Channel::get_write_fd(void)const
+{
+	return mLink->mSerial->get_write_fd();
+}
+
+cms_t
+SpinelNCPLink::Channel::get_ms_to_next_event(void)const
+{
+	if (!mInbound.empty()) {
+		return 0;
+	}
+
+	return mLink->mSerial->get_ms_to_next_event();
+}
+
+void
+SpinelNCPLink::Channel::send_break(void)
+{
+	mLink->mSerial->send_break();
+}
+
+void
+SpinelNCPLink::Channel::reset(void)
+{
+	if (mIsHibernating) {
+		mIsHibernating = false;
+
+		// Waking up from hibernation only needs the port back if
+		// the link actually let go of it.
+		if (mLink->mIsHibernating) {
+			mLink->reset();
+		}
+
+	} else {
+		mLink->reset();
+	}
+
+	// The other instances sharing the link get told about the reset
+	// through `did_reset()`, but this one asked for it.
+	mDidReset = false;
+}
+
+bool
+SpinelNCPLink::Channel::did_reset(void)
+{
+	bool ret = mDidReset;
+
+	mDidReset = false;
+
+	return ret;
+}
+
+int
+SpinelNCPLink::Channel::hibernate(void)
+{
+	mIsHibernating = true;
+	mLink->update_hibernation();
+	return 0;
+}
+
+int
+SpinelNCPLink::Channel::update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout)
+{
+	int ret = 0;
+
+	if (!mLink->mIsHibernating) {
+		if (mLink->has_pending_output()) {
+			ret = mLink->mSerial->update_fd_set(read_fd_set, write_fd_set, error_fd_set, max_fd, timeout);
+		} else {
+			ret = mLink->mSerial->update_fd_set(read_fd_set, NULL, error_fd_set, max_fd, timeout);
+		}
+	}
+
+	if ((timeout != NULL) && !mInbound.empty()) {
+		*timeout = 0;
+	}
+
+	return ret;
+}
@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Multiplexes several Spinel interfaces (IIDs) over one serial link.
+ *
+ *      Each NCP instance which is configured with `Config:NCP:IID` gets
+ *      a `SpinelNCPLink::Channel` in place of its serial socket. The
+ *      channel looks like a regular HDLC byte stream to the instance,
+ *      in which every frame carries IID 0. The link rewrites the IID
+ *      on the way in and out, and takes turns between the channels
+ *      when writing to the NCP.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPLink__
+#define __wpantund__SpinelNCPLink__
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "spinel.h"
+#include "SocketWrapper.h"
+#include "RingBuffer.h"
+#include "SPSCRing.h"
+#include "SpinelNCPHDLC.h"
+
+namespace nl {
+namespace wpantund {
+
+class SpinelNCPLink : public boost::enable_shared_from_this<SpinelNCPLink>
+{
+public:
+	enum
+	{
+		kMaxChannels      = 4,    // IIDs are two bits wide
+		kOutboundQueueLen = 4,    // Frames per channel
+	};
+
+	struct Counters
+	{
+		uint32_t mFramesToNCP;
+		uint32_t mBytesToNCP;
+		uint32_t mFramesFromNCP;
+		uint32_t mBytesFromNCP;
+		uint32_t mDroppedFrames;
+	};
+
+	class Channel : public SocketWrapper
+	{
+	public:
+		virtual ~Channel();
+
+		virtual ssize_t write(const void* data, size_t len);
+		virtual ssize_t read(void* data, size_t len);
+		virtual bool can_read(void)const;
+		virtual bool can_write(void)const;
+		virtual int process(void);
+
+		virtual int get_read_fd(void)const;
+		virtual int get_write_fd(void)const;
+		virtual cms_t get_ms_to_next_event(void)const;
+
+		virtual void send_break(void);
+
+		virtual void reset(void);
+		virtual bool did_reset(void);
+		virtual int hibernate(void);
+
+		virtual int update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout);
+
+		uint8_t get_iid(void) const { return mIID; }
+		const boost::shared_ptr<SpinelNCPLink>& get_link(void) const { return mLink; }
+
+	private:
+		friend class SpinelNCPLink;
+
+		struct Frame
+		{
+			spinel_size_t mLength;
+			uint8_t       mData[SPINEL_FRAME_BUFFER_SIZE];
+		};
+
+		Channel(const boost::shared_ptr<SpinelNCPLink>& link, uint8_t iid);
+
+		void deliver(const uint8_t* frame_ptr, spinel_size_t frame_len);
+		void flush(void);
+
+		boost::shared_ptr<SpinelNCPLink> mLink;
+		uint8_t mIID;
+		bool mDidReset;
+		bool mIsHibernating;
+		Counters mCounters;
+
+		// HDLC stream waiting to be read by the NCP instance.
+		RingBuffer<uint8_t, 4 * HDLC_ENCODED_SIZE(SPINEL_FRAME_BUFFER_SIZE)> mInbound;
+
+		// Frames written by the NCP instance, waiting for their turn
+		// on the serial link.
+		HDLCDecoder mDecoder;
+		SPSCRing<Frame, kOutboundQueueLen> mOutbound;
+	};
+
+public:
+	// Returns a channel for `iid` on the link to `socket_path`, opening
+	// the link if this is its first channel. Throws if the IID is out
+	// of range or already taken.
+	static boost::shared_ptr<Channel> open_channel(const std::string& socket_path, uint8_t iid);
+
+	~SpinelNCPLink();
+
+	// One line per channel, for `NCP:LinkCounters`.
+	void get_counters_as_string_list(std::list<std::string>& list) const;
+
+private:
+	SpinelNCPLink(const std::string& socket_path);
+
+	int process(void);
+	void reset(void);
+	void mark_channels_reset(void);
+	void update_hibernation(void);
+	void dispatch(uint8_t* frame_ptr, spinel_size_t frame_len_with_crc);
+	bool has_pending_output(void) const;
+	int pump_output(void);
+	void remove_channel(Channel* channel);
+
+	static std::map<std::string, boost::weak_ptr<SpinelNCPLink> > sLinks;
+
+	std::string mSocketPath;
+	boost::shared_ptr<SocketWrapper> mSerial;
+	Channel* mChannels[kMaxChannels];
+	bool mIsHibernating;
+
+	HDLCDecoder mDecoder;
+	uint32_t mUnroutedFrames;
+	uint32_t mCRCErrors;
+
+	uint8_t mOutboundEscaped[HDLC_ENCODED_SIZE(SPINEL_FRAME_BUFFER_SIZE)];
+	spinel_size_t mOutboundEscapedLen;
+	spinel_size_t mOutboundEscapedSent;
+
+	// Channel which gets the next turn on the serial link.
+	int mNextChannel;
+
+	// Negative `errno` value of the last socket error, handed to
+	// every channel until the link is reset.
+	int mLastError;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPLink__) */
@@ -0,0 +1,201 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <algorithm>
+#include "SpinelNCPScanPlanner.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+SpinelNCPScanMatch::SpinelNCPScanMatch():
+	mHasXPANID(false),
+	mXPANID(0),
+	mPANID(0xFFFF),
+	mMinRSSI(-128)
+{
+}
+
+bool
+SpinelNCPScanMatch::is_empty(void) const
+{
+	return mNetworkName.empty() && !mHasXPANID && (mPANID == 0xFFFF) && (mMinRSSI <= -128);
+}
+
+bool
+SpinelNCPScanMatch::matches_network(const WPAN::NetworkInstance& network) const
+{
+	if (!mNetworkName.empty() && (network.name != mNetworkName)) {
+		return false;
+	}
+
+	if (mHasXPANID && (network.get_xpanid_as_uint64() != mXPANID)) {
+		return false;
+	}
+
+	if ((mPANID != 0xFFFF) && (network.panid != mPANID)) {
+		return false;
+	}
+
+	return true;
+}
+
+bool
+SpinelNCPScanMatch::matches(const WPAN::NetworkInstance& network) const
+{
+	return matches_network(network) && (network.rssi >= mMinRSSI);
+}
+
+std::string
+SpinelNCPScanMatch::get_as_string(void) const
+{
+	std::string ret;
+	char buffer[64];
+
+	if (!mNetworkName.empty()) {
+		ret += "name:\"" + mNetworkName + "\" ";
+	}
+
+	if (mHasXPANID) {
+		snprintf(buffer, sizeof(buffer), "xpanid:%016llX ", static_cast<unsigned long long>(mXPANID));
+		ret += buffer;
+	}
+
+	if (mPANID != 0xFFFF) {
+		snprintf(buffer, sizeof(buffer), "panid:0x%04X ", mPANID);
+		ret += buffer;
+	}
+
+	if (mMinRSSI > -128) {
+		snprintf(buffer, sizeof(buffer), "rssi>=%d ", mMinRSSI);
+		ret += buffer;
+	}
+
+	if (!ret.empty()) {
+		ret.erase(ret.size() - 1);
+	}
+
+	return ret;
+}
+
+SpinelNCPScanPlanner::SpinelNCPScanPlanner()
+{
+	clear();
+}
+
+void
+SpinelNCPScanPlanner::clear(void)
+{
+	mSightings.clear();
+
+	for (int i = 0; i < kMaxChannel; i++) {
+		mChannelSeen[i] = false;
+		mChannelLastSeen[i] = 0;
+	}
+}
+
+void
+SpinelNCPScanPlanner::record_beacon(const WPAN::NetworkInstance& network)
+{
+	std::list<Sighting>::iterator iter;
+	Sighting sighting;
+	cms_t now = time_ms();
+
+	if (network.channel >= kMaxChannel) {
+		return;
+	}
+
+	mChannelSeen[network.channel] = true;
+	mChannelLastSeen[network.channel] = now;
+
+	for (iter = mSightings.begin(); iter != mSightings.end(); ++iter) {
+		if (static_cast<const WPAN::NetworkId&>(iter->mNetwork) == network
+		 && (iter->mNetwork.panid == network.panid)
+		) {
+			mSightings.erase(iter);
+			break;
+		}
+	}
+
+	sighting.mNetwork = network;
+	sighting.mLastSeen = now;
+	mSightings.push_front(sighting);
+
+	if (mSightings.size() > SCAN_PLANNER_NETWORK_HISTORY_SIZE) {
+		mSightings.pop_back();
+	}
+}
+
+void
+SpinelNCPScanPlanner::add_channel_passes(std::vector<std::pair<cms_t, uint8_t> >& channels, uint32_t& remaining, std::vector<uint32_t>& passes) const
+{
+	std::vector<std::pair<cms_t, uint8_t> >::iterator iter;
+
+	// Sort by age, so the channel heard most recently comes first.
+	std::sort(channels.begin(), channels.end());
+
+	for (iter = channels.begin(); iter != channels.end(); ++iter) {
+		uint32_t bit = (1U << iter->second);
+
+		if (remaining & bit) {
+			passes.push_back(bit);
+			remaining &= ~bit;
+		}
+	}
+
+	channels.clear();
+}
+
+std::vector<uint32_t>
+SpinelNCPScanPlanner::plan(uint32_t channel_mask, const SpinelNCPScanMatch& match) const
+{
+	std::vector<uint32_t> passes;
+	std::vector<std::pair<cms_t, uint8_t> > channels;
+	std::list<Sighting>::const_iterator iter;
+	uint32_t remaining = channel_mask;
+	cms_t now = time_ms();
+
+	if (!match.is_empty()) {
+		for (iter = mSightings.begin(); iter != mSightings.end(); ++iter) {
+			if (match.matches_network(iter->mNetwork)) {
+				channels.push_back(std::make_pair(now - iter->mLastSeen, iter->mNetwork.channel));
+			}
+		}
+
+		add_channel_passes(channels, remaining, passes);
+
+		for (uint8_t channel = 0; channel < kMaxChannel; channel++) {
+			if (mChannelSeen[channel]) {
+				channels.push_back(std::make_pair(now - mChannelLastSeen[channel], channel));
+			}
+		}
+
+		add_channel_passes(channels, remaining, passes);
+	}
+
+	if ((remaining != 0) || passes.empty()) {
+		passes.push_back(remaining);
+	}
+
+	return passes;
+}
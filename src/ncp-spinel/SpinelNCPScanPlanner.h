@@ -0,0 +1,107 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPScanPlanner__
+#define __wpantund__SpinelNCPScanPlanner__
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <vector>
+#include "NetworkInstance.h"
+#include "time-utils.h"
+
+namespace nl {
+namespace wpantund {
+
+// Number of distinct networks remembered from previous scans
+#define SCAN_PLANNER_NETWORK_HISTORY_SIZE       32
+
+// Predicate for a streaming scan: the scan stops at the first beacon
+// which satisfies every criterion that is set.
+struct SpinelNCPScanMatch
+{
+	SpinelNCPScanMatch();
+
+	std::string mNetworkName;      // Empty to match any name
+	bool mHasXPANID;
+	uint64_t mXPANID;
+	uint16_t mPANID;               // 0xFFFF to match any PANID
+	int mMinRSSI;                  // -128 to accept any RSSI
+
+	bool is_empty(void) const;
+
+	// Only compares the network identifiers (name, XPANID and PANID).
+	bool matches_network(const WPAN::NetworkInstance& network) const;
+
+	bool matches(const WPAN::NetworkInstance& network) const;
+
+	std::string get_as_string(void) const;
+};
+
+// Remembers on which channels beacons were heard during previous scans,
+// so that a scan with a match predicate can visit the most promising
+// channels first instead of sweeping the whole channel mask.
+//
+// A plan is a list of channel masks, scanned one after the other:
+//
+//  1. every channel on which a network satisfying the predicate was
+//     last heard, one channel per pass, most recent first,
+//  2. every other channel on which any beacon was heard, one channel
+//     per pass, most recent first,
+//  3. all the remaining channels together, in a single pass.
+//
+// Scans without a predicate can't stop early, so their plan is always
+// the whole channel mask in a single pass.
+class SpinelNCPScanPlanner
+{
+public:
+	SpinelNCPScanPlanner();
+
+	void clear(void);
+
+	void record_beacon(const WPAN::NetworkInstance& network);
+
+	std::vector<uint32_t> plan(uint32_t channel_mask, const SpinelNCPScanMatch& match) const;
+
+private:
+	struct Sighting
+	{
+		WPAN::NetworkInstance mNetwork;
+		cms_t mLastSeen;
+	};
+
+	enum {
+		kMaxChannel = 32,
+	};
+
+	void add_channel_passes(std::vector<std::pair<cms_t, uint8_t> >& channels, uint32_t& remaining, std::vector<uint32_t>& passes) const;
+
+private:
+	// Most recently heard first
+	std::list<Sighting> mSightings;
+
+	bool mChannelSeen[kMaxChannel];
+	cms_t mChannelLastSeen[kMaxChannel];
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPScanPlanner__) */
@@ -31,12 +31,18 @@ using namespace nl;
 using namespace nl::wpantund;
 
 SpinelNCPTask::SpinelNCPTask(SpinelNCPInstance* _instance, CallbackWithStatusArg1 cb):
-	mInstance(_instance), mCB(cb), mNextCommandTimeout(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT)
+	mInstance(_instance), mCB(cb), mNextCommandTimeout(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT),
+	mNextCommandPtr(NULL), mNextCommandLen(0),
+	mNextCommandSlot(SpinelNCPFramePool::kNoSlot), mNextCommandIsReset(false),
+	mPipelinedCount(0)
 {
+	memset(mPipelinedHeader, 0, sizeof(mPipelinedHeader));
+	memset(mPipelinedCookie, 0, sizeof(mPipelinedCookie));
 }
 
 SpinelNCPTask::~SpinelNCPTask()
 {
+	release_next_command_slot();
 	finish(kWPANTUNDStatus_Canceled);
 }
 
@@ -49,6 +55,83 @@ SpinelNCPTask::finish(int status, const boost::any& value)
 	}
 }
 
+void
+SpinelNCPTask::release_next_command_slot(void)
+{
+	if (mNextCommandSlot != SpinelNCPFramePool::kNoSlot) {
+		GetInstance(this)->mOutboundFramePool.release(mNextCommandSlot);
+		mNextCommandSlot = SpinelNCPFramePool::kNoSlot;
+	}
+}
+
+void
+SpinelNCPTask::pack_next_command(const char* pack_format, ...)
+{
+	va_list args;
+
+	release_next_command_slot();
+	mNextCommandPtr = NULL;
+
+	va_start(args, pack_format);
+	mNextCommandSlot = GetInstance(this)->mOutboundFramePool.vpack(pack_format, args);
+	va_end(args);
+
+	if (mNextCommandSlot == SpinelNCPFramePool::kNoSlot) {
+		va_start(args, pack_format);
+		mNextCommand = SpinelPackDataV(pack_format, args);
+		va_end(args);
+	} else {
+		mNextCommand.clear();
+	}
+}
+
+const uint8_t*
+SpinelNCPTask::next_command_data(void) const
+{
+	if (mNextCommandPtr != NULL) {
+		return mNextCommandPtr;
+	}
+
+	if (mNextCommandSlot != SpinelNCPFramePool::kNoSlot) {
+		return GetInstance(this)->mOutboundFramePool.get_frame(mNextCommandSlot);
+	}
+
+	return mNextCommand.data();
+}
+
+spinel_size_t
+SpinelNCPTask::next_command_size(void) const
+{
+	if (mNextCommandPtr != NULL) {
+		return mNextCommandLen;
+	}
+
+	if (mNextCommandSlot != SpinelNCPFramePool::kNoSlot) {
+		return GetInstance(this)->mOutboundFramePool.get_frame_len(mNextCommandSlot);
+	}
+
+	return static_cast<spinel_size_t>(mNextCommand.size());
+}
+
+void
+SpinelNCPTask::queue_next_command(void)
+{
+	if ((mNextCommandPtr == NULL) && (mNextCommandSlot != SpinelNCPFramePool::kNoSlot)) {
+		// The data pump sends the frame from the slot and releases it.
+		GetInstance(this)->queue_outbound_frame(mNextCommandSlot);
+		mNextCommandSlot = SpinelNCPFramePool::kNoSlot;
+	} else {
+		memcpy(GetInstance(this)->mOutboundBuffer, next_command_data(), next_command_size());
+		GetInstance(this)->mOutboundBufferLen = static_cast<spinel_ssize_t>(next_command_size());
+	}
+}
+
+bool
+SpinelNCPTask::is_ready_to_send(void) const
+{
+	return (GetInstance(this)->mOutboundBufferLen <= 0) && GetInstance(this)->mOutboundCallback.empty();
+}
+
 static bool
 spinel_callback_is_reset(int event, va_list args)
 {
@@ -62,14 +145,17 @@ SpinelNCPTask::vprocess_send_command(int event, va_list args)
 {
 	EH_BEGIN_SUB(&mSubPT);
 
-	require(mNextCommand.size() < sizeof(GetInstance(this)->mOutboundBuffer), on_error);
+	require(next_command_size() < sizeof(GetInstance(this)->mOutboundBuffer), on_error);
+
+	mNextCommandIsReset = (next_command_size() > 1) && (next_command_data()[1] == SPINEL_CMD_RESET);
 
 	CONTROL_REQUIRE_PREP_TO_SEND_COMMAND_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_error);
-	memcpy(GetInstance(this)->mOutboundBuffer, mNextCommand.data(), mNextCommand.size());
-	GetInstance(this)->mOutboundBufferLen = static_cast<spinel_ssize_t>(mNextCommand.size());
+
+	queue_next_command();
+
 	CONTROL_REQUIRE_OUTBOUND_BUFFER_FLUSHED_WITHIN(NCP_DEFAULT_COMMAND_SEND_TIMEOUT, on_error);
 
-	if (mNextCommand[1] == SPINEL_CMD_RESET) {
+	if (mNextCommandIsReset) {
 		mInstance->mResetIsExpected = true;
 		EH_REQUIRE_WITHIN(
 			mNextCommandTimeout,
@@ -93,18 +179,146 @@ SpinelNCPTask::vprocess_send_command(int event, va_list args)
 	EH_EXIT();
 
 on_error:
+	release_next_command_slot();
+	mNextCommandRet = kWPANTUNDStatus_Timeout;
+
+	EH_END();
+}
+
+void
+SpinelNCPTask::handle_pipelined_reply(int cookie, int event, va_list args)
+{
+	(void)cookie;
+	(void)event;
+	(void)args;
+}
+
+bool
+SpinelNCPTask::dispatch_pipelined_reply(int event, va_list args)
+{
+	int i;
+	int cookie;
+
+	if ( (EVENT_NCP_PROP_VALUE_IS != event)
+	  && (EVENT_NCP_PROP_VALUE_INSERTED != event)
+	  && (EVENT_NCP_PROP_VALUE_REMOVED != event)
+	) {
+		return false;
+	}
+
+	for (i = 0; i < kMaxPipelinedCommands; i++) {
+		if ((mPipelinedHeader[i] != 0) && (mPipelinedHeader[i] == GetInstance(this)->mInboundHeader)) {
+			break;
+		}
+	}
+
+	if (i == kMaxPipelinedCommands) {
+		return false;
+	}
+
+	cookie = mPipelinedCookie[i];
+	mPipelinedHeader[i] = 0;
+	mPipelinedCount--;
+
+	handle_pipelined_reply(cookie, event, args);
+
+	return true;
+}
+
+int
+SpinelNCPTask::take_pipelined_command(void)
+{
+	for (int i = 0; i < kMaxPipelinedCommands; i++) {
+		if (mPipelinedHeader[i] != 0) {
+			mPipelinedHeader[i] = 0;
+			mPipelinedCount--;
+			return mPipelinedCookie[i];
+		}
+	}
+
+	return -1;
+}
+
+int
+SpinelNCPTask::vprocess_send_pipelined_command(int event, va_list args, int cookie)
+{
+	static const int kEventSendFinished = 0xFF000000 | __LINE__;
+	static const int kEventSendFailed = 0xFE000000 | __LINE__;
+	int i;
+
+	EH_BEGIN_SUB(&mSubPT);
+
 	mNextCommandRet = kWPANTUNDStatus_Timeout;
 
+	require(next_command_size() < sizeof(GetInstance(this)->mOutboundBuffer), on_error);
+	require(mPipelinedCount < kMaxPipelinedCommands, on_error);
+
+	EH_WAIT_UNTIL_WITH_TIMEOUT(
+		NCP_DEFAULT_COMMAND_SEND_TIMEOUT,
+		(dispatch_pipelined_reply(event, args), is_ready_to_send())
+	);
+	require(!eh_did_timeout, on_error);
+
+	GetInstance(this)->mLastTID = SPINEL_GET_NEXT_TID(GetInstance(this)->mLastTID);
+	mLastHeader = (SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (GetInstance(this)->mLastTID << SPINEL_HEADER_TID_SHIFT));
+
+	for (i = 0; mPipelinedHeader[i] != 0; i++) { }
+
+	mPipelinedHeader[i] = mLastHeader;
+	mPipelinedCookie[i] = cookie;
+	mPipelinedCount++;
+
+	queue_next_command();
+
+	GetInstance(this)->mOutboundCallback = boost::bind(
+		&process_send_status_helper<SpinelNCPInstance>,
+		GetInstance(this),
+		kEventSendFinished,
+		kEventSendFailed,
+		_1
+	);
+	GetInstance(this)->mOutboundFrame[0] = mLastHeader;
+
+	EH_WAIT_UNTIL_WITH_TIMEOUT(
+		NCP_DEFAULT_COMMAND_SEND_TIMEOUT,
+		(dispatch_pipelined_reply(event, args), (event == kEventSendFinished) || (event == kEventSendFailed))
+	);
+	require(!eh_did_timeout, on_error);
+	require_action(event == kEventSendFinished, on_error, mNextCommandRet = kWPANTUNDStatus_Failure);
+
+	mNextCommandRet = kWPANTUNDStatus_Ok;
+
+	EH_EXIT();
+
+on_error:
+	release_next_command_slot();
+
+	// A command which didn't make it out isn't waited for.
+	for (i = 0; i < kMaxPipelinedCommands; i++) {
+		if ((mPipelinedHeader[i] != 0) && (mPipelinedCookie[i] == cookie)) {
+			mPipelinedHeader[i] = 0;
+			mPipelinedCount--;
+		}
+	}
+
 	EH_END();
 }
 
 nl::Data
 nl::wpantund::SpinelPackData(const char* pack_format, ...)
 {
-	Data ret(64);
-
 	va_list args;
 	va_start(args, pack_format);
+	Data ret(SpinelPackDataV(pack_format, args));
+	va_end(args);
+
+	return ret;
+}
+
+nl::Data
+nl::wpantund::SpinelPackDataV(const char* pack_format, va_list args)
+{
+	Data ret(64);
 
 	do {
 		spinel_ssize_t packed_size = spinel_datatype_vpack(ret.data(), (spinel_size_t)ret.size(), pack_format, args);
@@ -120,6 +334,5 @@ nl::wpantund::SpinelPackData(const char* pack_format, ...)
 		break;
 	} while(true);
 
-	va_end(args);
 	return ret;
 }
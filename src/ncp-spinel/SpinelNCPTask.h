@@ -39,7 +39,6 @@ class SpinelNCPInstance;
 
 class SpinelNCPTask
 	: public boost::enable_shared_from_this<SpinelNCPTask>
-	, public boost::signals2::trackable
 	, public nl::EventHandler
 {
 public:
@@ -56,6 +55,12 @@ public:
 
 	int vprocess_send_command(int event, va_list args);
 
+	enum {
+		// Most commands `vprocess_send_pipelined_command()` keeps
+		// outstanding at once.
+		kMaxPipelinedCommands = 4,
+	};
+
 protected:
 	CallbackWithStatusArg1 mCB;
 	uint8_t mLastHeader;
@@ -63,9 +68,63 @@ protected:
 	Data mNextCommand;
 	int mNextCommandRet;
 	int mNextCommandTimeout;
+
+	// If `mNextCommandPtr` is not NULL, `vprocess_send_command()` sends
+	// the `mNextCommandLen` bytes it points to instead of `mNextCommand`.
+	// The pointed-to buffer must stay valid until the command is sent.
+	const uint8_t* mNextCommandPtr;
+	spinel_size_t mNextCommandLen;
+
+	// Packs the next command (using the same arguments as `SpinelPackData()`)
+	// straight into a slot of the instance's outbound frame pool, which
+	// `vprocess_send_command()` then hands over to the data pump. Falls
+	// back to `mNextCommand` if no slot is available.
+	void pack_next_command(const char* pack_format, ...);
+
+	// Sends the command from `pack_next_command()` with its own TID, but
+	// unlike `vprocess_send_command()` doesn't wait for the reply, so
+	// that up to `kMaxPipelinedCommands` commands can be outstanding at
+	// once. `cookie` (not negative, and different for each outstanding
+	// command) is handed to `handle_pipelined_reply()` along with the
+	// reply. Sets `mNextCommandRet` once the command is sent; if it
+	// couldn't be, the command is not waited for. Replies to earlier
+	// commands which arrive in the meantime are dispatched as well.
+	int vprocess_send_pipelined_command(int event, va_list args, int cookie);
+
+	// To be called with every event while pipelined commands are
+	// outstanding. Returns true if the event was the reply to one of
+	// them, after passing it to `handle_pipelined_reply()`.
+	bool dispatch_pipelined_reply(int event, va_list args);
+
+	// Called with the reply to each pipelined command.
+	virtual void handle_pipelined_reply(int cookie, int event, va_list args);
+
+	// True once the data pump is ready for the next command.
+	bool is_ready_to_send(void) const;
+
+	int get_pipelined_count(void) const { return mPipelinedCount; }
+
+	// Forgets one of the outstanding pipelined commands (e.g. after a
+	// timeout) and returns its cookie, or -1 if there are none.
+	int take_pipelined_command(void);
+
+private:
+	void release_next_command_slot(void);
+	void queue_next_command(void);
+
+	const uint8_t* next_command_data(void) const;
+	spinel_size_t next_command_size(void) const;
+
+	int mNextCommandSlot;
+	bool mNextCommandIsReset;
+
+	int mPipelinedCount;
+	uint8_t mPipelinedHeader[kMaxPipelinedCommands];
+	int mPipelinedCookie[kMaxPipelinedCommands];
 };
 
 nl::Data SpinelPackData(const char* pack_format, ...);
+nl::Data SpinelPackDataV(const char* pack_format, va_list args);
 
 }; // namespace wpantund
 }; // namespace nl
@@ -70,7 +70,7 @@ nl::wpantund::SpinelNCPTaskDeepSleep::vprocess_event(int event, va_list args)
 	EH_WAIT_UNTIL_WITH_TIMEOUT(mInstance->mDriverState == SpinelNCPInstance::NORMAL_OPERATION, NCP_DEFAULT_COMMAND_SEND_TIMEOUT);
 
 	if (mInstance->can_set_ncp_power()) {
-		mNextCommand = SpinelPackData(SPINEL_FRAME_PACK_CMD_NOOP);
+		pack_next_command(SPINEL_FRAME_PACK_CMD_NOOP);
 		EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 
 		// Wait for half a second after the last ncp-generated event before
@@ -94,7 +94,7 @@ nl::wpantund::SpinelNCPTaskDeepSleep::vprocess_event(int event, va_list args)
 	if (mInstance->get_ncp_state() != DEEP_SLEEP) {
 
 		if (ncp_state_is_joining_or_joined(mInstance->get_ncp_state())) {
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_NET_STACK_UP,
 				false
@@ -103,7 +103,7 @@ nl::wpantund::SpinelNCPTaskDeepSleep::vprocess_event(int event, va_list args)
 			ret = mNextCommandRet;
 			require_noerr(ret, on_error);
 
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_NET_IF_UP,
 				false
@@ -121,7 +121,7 @@ nl::wpantund::SpinelNCPTaskDeepSleep::vprocess_event(int event, va_list args)
 		if (mInstance->mCapabilities.count(SPINEL_CAP_MCU_POWER_STATE)) {
 			syslog(LOG_NOTICE, "DeepSleep: Putting NCP to low-power.");
 
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 				SPINEL_PROP_MCU_POWER_STATE,
 				SPINEL_MCU_POWER_STATE_LOW_POWER
@@ -134,7 +134,7 @@ nl::wpantund::SpinelNCPTaskDeepSleep::vprocess_event(int event, va_list args)
 			syslog(LOG_WARNING, "DeepSleep: No support for CAP_MCU_POWER_STATE. Will attempt to change configuration to reduce power.");
 
 			// Turn off the phy
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_PHY_ENABLED,
 				false
@@ -159,7 +159,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	mInstance->change_ncp_state(ASSOCIATING);
 
 	// Clear any previously saved network settings
-	mNextCommand = SpinelPackData(SPINEL_FRAME_PACK_CMD_NET_CLEAR);
+	pack_next_command(SPINEL_FRAME_PACK_CMD_NET_CLEAR);
 	EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 	ret = mNextCommandRet;
 
@@ -210,7 +210,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 			} while (0 == ((1 << channel) & mask));
 		}
 
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 			SPINEL_PROP_PHY_CHAN,
 			channel
@@ -224,7 +224,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	require_noerr(ret, on_error);
 
 	// Turn off promiscuous mode, if it happens to be on
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 		SPINEL_PROP_MAC_PROMISCUOUS_MODE,
 		SPINEL_MAC_PROMISCUOUS_MODE_OFF
@@ -235,7 +235,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	check_noerr(ret);
 
 	if (mOptions.count(kWPANTUNDProperty_NetworkPANID)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S),
 			SPINEL_PROP_MAC_15_4_PANID,
 			any_to_int(mOptions[kWPANTUNDProperty_NetworkPANID])
@@ -256,7 +256,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 			reverse_bytes(reinterpret_cast<uint8_t*>(&xpanid), sizeof(xpanid));
 #endif
 
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
 				SPINEL_PROP_NET_XPANID,
 				&xpanid,
@@ -272,7 +272,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	}
 
 	if (mOptions.count(kWPANTUNDProperty_NetworkName)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UTF8_S),
 			SPINEL_PROP_NET_NETWORK_NAME,
 			any_to_string(mOptions[kWPANTUNDProperty_NetworkName]).c_str()
@@ -288,7 +288,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	if (mOptions.count(kWPANTUNDProperty_NetworkKey)) {
 		{
 			nl::Data data(any_to_data(mOptions[kWPANTUNDProperty_NetworkKey]));
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
 				SPINEL_PROP_NET_MASTER_KEY,
 				data.data(),
@@ -304,7 +304,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	}
 
 	if (mOptions.count(kWPANTUNDProperty_NetworkKeyIndex)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S),
 			SPINEL_PROP_NET_KEY_SEQUENCE_COUNTER,
 			any_to_int(mOptions[kWPANTUNDProperty_NetworkKeyIndex])
@@ -320,7 +320,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	if (mOptions.count(kWPANTUNDProperty_IPv6MeshLocalPrefix)) {
 		{
 			struct in6_addr addr = any_to_ipv6(mOptions[kWPANTUNDProperty_IPv6MeshLocalPrefix]);
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_IPv6ADDR_S SPINEL_DATATYPE_UINT8_S),
 				SPINEL_PROP_IPV6_ML_PREFIX,
 				&addr,
@@ -336,7 +336,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 	} else if (mOptions.count(kWPANTUNDProperty_IPv6MeshLocalAddress)) {
 		{
 			struct in6_addr addr = any_to_ipv6(mOptions[kWPANTUNDProperty_IPv6MeshLocalAddress]);
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_IPv6ADDR_S SPINEL_DATATYPE_UINT8_S),
 				SPINEL_PROP_IPV6_ML_PREFIX,
 				&addr,
@@ -355,7 +355,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 		if (mInstance->mCapabilities.count(SPINEL_CAP_NEST_LEGACY_INTERFACE)) {
 			{
 				nl::Data data(any_to_data(mOptions[kWPANTUNDProperty_NestLabs_LegacyMeshLocalPrefix]));
-				mNextCommand = SpinelPackData(
+				pack_next_command(
 					SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
 					SPINEL_PROP_NEST_LEGACY_ULA_PREFIX,
 					data.data(),
@@ -373,7 +373,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 
 	// Now bring up the network by bringing up the interface and the stack.
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_IF_UP,
 		true
@@ -385,7 +385,7 @@ nl::wpantund::SpinelNCPTaskForm::vprocess_event(int event, va_list args)
 
 	require(ret == kWPANTUNDStatus_Ok || ret == kWPANTUNDStatus_Already, on_error);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_STACK_UP,
 		true
@@ -78,7 +78,7 @@ nl::wpantund::SpinelNCPTaskGetMsgBufferCounters::vprocess_event(int event, va_li
 	// to execute.
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET,
 		SPINEL_PROP_MSG_BUFFER_COUNTERS
 	);
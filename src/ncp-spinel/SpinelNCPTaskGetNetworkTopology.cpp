@@ -64,6 +64,35 @@ nl::wpantund::SpinelNCPTaskGetNetworkTopology::TableEntry::clear(void)
 	mMessageErrorRate = 0;
 }
 
+bool
+nl::wpantund::SpinelNCPTaskGetNetworkTopology::TableEntry::operator==(const TableEntry& other) const
+{
+	return (mType == other.mType)
+		&& (memcmp(mExtAddress, other.mExtAddress, sizeof(mExtAddress)) == 0)
+		&& (mRloc16 == other.mRloc16)
+		&& (mAge == other.mAge)
+		&& (mLinkQualityIn == other.mLinkQualityIn)
+		&& (mAverageRssi == other.mAverageRssi)
+		&& (mLastRssi == other.mLastRssi)
+		&& (mRxOnWhenIdle == other.mRxOnWhenIdle)
+		&& (mSecureDataRequest == other.mSecureDataRequest)
+		&& (mFullFunction == other.mFullFunction)
+		&& (mFullNetworkData == other.mFullNetworkData)
+		&& (mTimeout == other.mTimeout)
+		&& (mNetworkDataVersion == other.mNetworkDataVersion)
+		&& (mLinkFrameCounter == other.mLinkFrameCounter)
+		&& (mMleFrameCounter == other.mMleFrameCounter)
+		&& (mIsChild == other.mIsChild)
+		&& (mRouterId == other.mRouterId)
+		&& (mNextHop == other.mNextHop)
+		&& (mPathCost == other.mPathCost)
+		&& (mLinkQualityOut == other.mLinkQualityOut)
+		&& (mLinkEstablished == other.mLinkEstablished)
+		&& (mIPv6Addresses == other.mIPv6Addresses)
+		&& (mFrameErrorRate == other.mFrameErrorRate)
+		&& (mMessageErrorRate == other.mMessageErrorRate);
+}
+
 nl::wpantund::SpinelNCPTaskGetNetworkTopology::SpinelNCPTaskGetNetworkTopology(
 	SpinelNCPInstance* instance,
 	CallbackWithStatusArg1 cb,
@@ -499,7 +528,7 @@ nl::wpantund::SpinelNCPTaskGetNetworkTopology::vprocess_event(int event, va_list
 	// to execute.
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET,
 		property_key_for_type(mType)
 	);
@@ -532,9 +561,12 @@ nl::wpantund::SpinelNCPTaskGetNetworkTopology::vprocess_event(int event, va_list
 
 	ret = kWPANTUNDStatus_Ok;
 
+	// The results are built in place inside the `boost::any` handed to
+	// the callback, so that large tables aren't copied on the way out.
 	if (mResultFormat == kResultFormat_StringArray)
 	{
-		std::list<std::string> result;
+		boost::any result_value = std::list<std::string>();
+		std::list<std::string>& result = *boost::any_cast< std::list<std::string> >(&result_value);
 		Table::iterator it;
 
 		for (it = mTable.begin(); it != mTable.end(); it++)
@@ -542,11 +574,12 @@ nl::wpantund::SpinelNCPTaskGetNetworkTopology::vprocess_event(int event, va_list
 			result.push_back(it->get_as_string());
 		}
 
-		finish(ret, result);
+		finish(ret, result_value);
 	}
 	else if (mResultFormat == kResultFormat_ValueMapArray)
 	{
-		std::list<ValueMap> result;
+		boost::any result_value = std::list<ValueMap>();
+		std::list<ValueMap>& result = *boost::any_cast< std::list<ValueMap> >(&result_value);
 		Table::iterator it;
 
 		for (it = mTable.begin(); it != mTable.end(); it++)
@@ -554,7 +587,7 @@ nl::wpantund::SpinelNCPTaskGetNetworkTopology::vprocess_event(int event, va_list
 			result.push_back(it->get_as_valuemap());
 		}
 
-		finish(ret, result);
+		finish(ret, result_value);
 	}
 	else
 	{
@@ -581,7 +614,7 @@ on_error:
 }
 
 std::string
-SpinelNCPTaskGetNetworkTopology::TableEntry::get_as_string(void)
+SpinelNCPTaskGetNetworkTopology::TableEntry::get_as_string(void) const
 {
 	char c_string[800];
 
@@ -638,7 +671,7 @@ SpinelNCPTaskGetNetworkTopology::TableEntry::get_as_string(void)
 		str += len;
 		remaning_len -= len;
 
-		for (std::list<struct in6_addr>::iterator it = mIPv6Addresses.begin(); it != mIPv6Addresses.end(); ++it) {
+		for (std::list<struct in6_addr>::const_iterator it = mIPv6Addresses.begin(); it != mIPv6Addresses.end(); ++it) {
 
 			len = snprintf(
 				str, remaning_len,
@@ -109,7 +109,9 @@ public:
 		TableEntry(void);
 
 		void clear(void);
-		std::string get_as_string(void);
+		bool operator==(const TableEntry& other) const;
+		bool operator!=(const TableEntry& other) const { return !(*this == other); }
+		std::string get_as_string(void) const;
 		ValueMap get_as_valuemap(void) const;
 	};
 
@@ -72,7 +72,7 @@ nl::wpantund::SpinelNCPTaskHostDidWake::vprocess_event(int event, va_list args)
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
 	if (mShouldTickle) {
-		mNextCommand = SpinelPackData(SPINEL_FRAME_PACK_CMD_NOOP);
+		pack_next_command(SPINEL_FRAME_PACK_CMD_NOOP);
 		EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 		ret = mNextCommandRet;
 		require_noerr(ret, on_error);
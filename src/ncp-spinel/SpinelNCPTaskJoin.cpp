@@ -94,7 +94,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
 	// Clear any previously saved network settings
-	mNextCommand = SpinelPackData(SPINEL_FRAME_PACK_CMD_NET_CLEAR);
+	pack_next_command(SPINEL_FRAME_PACK_CMD_NET_CLEAR);
 	EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 	ret = mNextCommandRet;
 
@@ -139,7 +139,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 			goto on_error;
 		}
 
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			SPINEL_PROP_THREAD_ROUTER_ROLE_ENABLED,
 			router_role_enabled
@@ -169,7 +169,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 			new_thread_mode |= SPINEL_THREAD_MODE_RX_ON_WHEN_IDLE;
 		}
 
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 			SPINEL_PROP_THREAD_MODE,
 			new_thread_mode
@@ -183,7 +183,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	}
 
 	// Turn off promiscuous mode, if it happens to be on
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 		SPINEL_PROP_MAC_PROMISCUOUS_MODE,
 		SPINEL_MAC_PROMISCUOUS_MODE_OFF
@@ -193,7 +193,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	check_noerr(ret);
 
 	if (mOptions.count(kWPANTUNDProperty_NCPChannel)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 			SPINEL_PROP_PHY_CHAN,
 			any_to_int(mOptions[kWPANTUNDProperty_NCPChannel])
@@ -208,7 +208,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	}
 
 	if (mOptions.count(kWPANTUNDProperty_NetworkPANID)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S),
 			SPINEL_PROP_MAC_15_4_PANID,
 			any_to_int(mOptions[kWPANTUNDProperty_NetworkPANID])
@@ -229,7 +229,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 			reverse_bytes(reinterpret_cast<uint8_t*>(&xpanid), sizeof(xpanid));
 #endif
 
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
 				SPINEL_PROP_NET_XPANID,
 				&xpanid,
@@ -245,7 +245,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	}
 
 	if (mOptions.count(kWPANTUNDProperty_NetworkName)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UTF8_S),
 			SPINEL_PROP_NET_NETWORK_NAME,
 			any_to_string(mOptions[kWPANTUNDProperty_NetworkName]).c_str()
@@ -261,7 +261,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	if (mOptions.count(kWPANTUNDProperty_NetworkKey)) {
 		{
 			nl::Data data(any_to_data(mOptions[kWPANTUNDProperty_NetworkKey]));
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
 				SPINEL_PROP_NET_MASTER_KEY,
 				data.data(),
@@ -277,7 +277,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	}
 
 	if (mOptions.count(kWPANTUNDProperty_NetworkKeyIndex)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT32_S),
 			SPINEL_PROP_NET_KEY_SEQUENCE_COUNTER,
 			any_to_int(mOptions[kWPANTUNDProperty_NetworkKeyIndex])
@@ -293,7 +293,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	if (mOptions.count(kWPANTUNDProperty_IPv6MeshLocalAddress)) {
 		{
 			struct in6_addr addr = any_to_ipv6(mOptions[kWPANTUNDProperty_IPv6MeshLocalAddress]);
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_IPv6ADDR_S SPINEL_DATATYPE_UINT8_S),
 				SPINEL_PROP_IPV6_ML_PREFIX,
 				&addr,
@@ -309,7 +309,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 	} else if (mOptions.count(kWPANTUNDProperty_IPv6MeshLocalPrefix)) {
 		{
 			struct in6_addr addr = any_to_ipv6(mOptions[kWPANTUNDProperty_IPv6MeshLocalPrefix]);
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_IPv6ADDR_S SPINEL_DATATYPE_UINT8_S),
 				SPINEL_PROP_IPV6_ML_PREFIX,
 				&addr,
@@ -327,7 +327,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 
 	// Now bring up the network by bringing up the interface and the stack.
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_IF_UP,
 		true
@@ -339,7 +339,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 
 	require((ret == kWPANTUNDStatus_Ok) || (ret == kWPANTUNDStatus_Already), on_error);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_REQUIRE_JOIN_EXISTING,
 		true
@@ -351,7 +351,7 @@ nl::wpantund::SpinelNCPTaskJoin::vprocess_event(int event, va_list args)
 
 	check_noerr(ret);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_STACK_UP,
 		true
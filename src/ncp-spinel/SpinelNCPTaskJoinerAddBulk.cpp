@@ -0,0 +1,325 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "assert-macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include "SpinelNCPTaskJoinerAddBulk.h"
+#include "SpinelNCPInstance.h"
+#include "spinel-extra.h"
+#include "commissioner-utils.h"
+#include "string-utils.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+static std::string
+trim(const std::string& str)
+{
+	static const char kWhitespace[] = " \t\r\n";
+	std::string::size_type begin = str.find_first_not_of(kWhitespace);
+
+	if (begin == std::string::npos) {
+		return std::string();
+	}
+
+	return str.substr(begin, str.find_last_not_of(kWhitespace) - begin + 1);
+}
+
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::SpinelNCPTaskJoinerAddBulk(
+	SpinelNCPInstance* instance,
+	CallbackWithStatusArg1 cb,
+	const std::list<std::string>& joiners,
+	uint32_t joiner_timeout
+):	SpinelNCPTask(instance, cb), mTotalCount(0), mDoneCount(0), mAddedCount(0),
+	mNextIndex(0), mTableFull(false)
+{
+	std::list<std::string>::const_iterator iter;
+	int number = 0;
+
+	mEntries.reserve(joiners.size());
+
+	// Everything is checked up front, so that a typo near the end of a
+	// long list doesn't leave the NCP with only part of it.
+	for (iter = joiners.begin(); iter != joiners.end(); ++iter) {
+		std::string line = trim(*iter);
+		Entry entry;
+		std::string reason;
+
+		number++;
+
+		if (line.empty() || (line[0] == '#')) {
+			continue;
+		}
+
+		entry.mNumber = number;
+		entry.mTimeout = joiner_timeout;
+
+		if (parse_entry(line, entry, reason)) {
+			mEntries.push_back(entry);
+		} else {
+			add_failure(number, reason);
+		}
+
+		mTotalCount++;
+	}
+
+	mDoneCount = static_cast<int>(mFailures.size());
+}
+
+bool
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::parse_entry(const std::string& line, Entry& entry, std::string& reason)
+{
+	std::string::size_type first_comma = line.find(',');
+	std::string::size_type second_comma;
+	std::string ext_address;
+	const char* psk_error;
+
+	if (first_comma == std::string::npos) {
+		reason = "expected \"<EUI64>,<PSKd>[,<timeout>]\"";
+		return false;
+	}
+
+	second_comma = line.find(',', first_comma + 1);
+
+	ext_address = trim(line.substr(0, first_comma));
+	entry.mPSKd = trim(line.substr(first_comma + 1, (second_comma == std::string::npos) ? std::string::npos : second_comma - first_comma - 1));
+
+	if (ext_address.empty() || (ext_address == "*")) {
+		entry.mHasExtAddress = false;
+
+	} else if ( (ext_address.size() != 2 * sizeof(entry.mExtAddress))
+	         || !is_hex(reinterpret_cast<const uint8_t*>(ext_address.c_str()), ext_address.size())
+	         || (parse_string_into_data(entry.mExtAddress, sizeof(entry.mExtAddress), ext_address.c_str()) != sizeof(entry.mExtAddress))
+	) {
+		reason = "invalid EUI64 \"" + ext_address + "\"";
+		return false;
+
+	} else {
+		entry.mHasExtAddress = true;
+	}
+
+	psk_error = joiner_psk_check(entry.mPSKd.c_str());
+
+	if (psk_error != NULL) {
+		reason = psk_error;
+		return false;
+	}
+
+	if (second_comma != std::string::npos) {
+		std::string timeout = trim(line.substr(second_comma + 1));
+		char* end = NULL;
+		unsigned long value = strtoul(timeout.c_str(), &end, 0);
+
+		if (timeout.empty() || (*end != 0) || (value > 0xFFFFFFFFUL)) {
+			reason = "invalid timeout \"" + timeout + "\"";
+			return false;
+		}
+
+		entry.mTimeout = static_cast<uint32_t>(value);
+	}
+
+	return true;
+}
+
+void
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::add_failure(int number, const std::string& reason)
+{
+	char c_string[16];
+
+	snprintf(c_string, sizeof(c_string), "%d: ", number);
+	mFailures.push_back(c_string + reason);
+}
+
+void
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::update_progress(bool force)
+{
+	char c_string[100];
+
+	if (!force && ((mDoneCount % kProgressInterval) != 0)) {
+		return;
+	}
+
+	snprintf(
+		c_string,
+		sizeof(c_string),
+		"%d of %d done, %d added, %d failed",
+		mDoneCount,
+		mTotalCount,
+		mAddedCount,
+		mDoneCount - mAddedCount
+	);
+
+	mInstance->mJoinerBulkProgress = c_string;
+	mInstance->signal_property_changed(kWPANTUNDProperty_ThreadCommissionerJoinerBulkProgress, mInstance->mJoinerBulkProgress);
+}
+
+// `cookie` is the index into `mEntries` of the entry inserted.
+void
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::handle_pipelined_reply(int cookie, int event, va_list args)
+{
+	int status = peek_ncp_callback_status(event, args);
+
+	if (status == SPINEL_STATUS_OK) {
+		mAddedCount++;
+
+	} else {
+		const Entry& entry = mEntries[cookie];
+
+		if (status == SPINEL_STATUS_NOMEM) {
+			mTableFull = true;
+			add_failure(entry.mNumber, "joiner table full");
+		} else {
+			add_failure(entry.mNumber, spinel_status_to_cstr(static_cast<spinel_status_t>(status)));
+		}
+	}
+
+	mDoneCount++;
+
+	update_progress(false);
+}
+
+void
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::pack_entry(const Entry& entry)
+{
+	if (entry.mHasExtAddress) {
+		pack_next_command(
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
+				SPINEL_DATATYPE_UTF8_S
+				SPINEL_DATATYPE_UINT32_S
+				SPINEL_DATATYPE_EUI64_S
+			),
+			SPINEL_PROP_THREAD_JOINERS,
+			entry.mPSKd.c_str(),
+			entry.mTimeout,
+			entry.mExtAddress
+		);
+	} else {
+		pack_next_command(
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_INSERT(
+				SPINEL_DATATYPE_UTF8_S
+				SPINEL_DATATYPE_UINT32_S
+			),
+			SPINEL_PROP_THREAD_JOINERS,
+			entry.mPSKd.c_str(),
+			entry.mTimeout
+		);
+	}
+}
+
+int
+nl::wpantund::SpinelNCPTaskJoinerAddBulk::vprocess_event(int event, va_list args)
+{
+	int ret = kWPANTUNDStatus_Failure;
+
+	EH_BEGIN();
+
+	if (!mInstance->mEnabled) {
+		ret = kWPANTUNDStatus_InvalidWhenDisabled;
+		finish(ret);
+		EH_EXIT();
+	}
+
+	// The first event to a task is EVENT_STARTING_TASK. The following
+	// line makes sure that we don't start processing this task
+	// until it is properly scheduled. All tasks immediately receive
+	// the initial `EVENT_STARTING_TASK` event, but further events
+	// will only be received by that task once it is that task's turn
+	// to execute.
+	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
+
+	// If any entry is invalid, none of them are added.
+	if (!mFailures.empty()) {
+		syslog(LOG_WARNING, "Not adding any joiners, %d of %d entries are invalid", static_cast<int>(mFailures.size()), mTotalCount);
+		ret = kWPANTUNDStatus_InvalidArgument;
+		finish(ret, mFailures);
+		EH_EXIT();
+	}
+
+	update_progress(true);
+
+	while ((!mTableFull && (mNextIndex < static_cast<int>(mEntries.size()))) || (get_pipelined_count() > 0)) {
+		if (!mTableFull && (mNextIndex < static_cast<int>(mEntries.size())) && (get_pipelined_count() < kMaxPipelinedCommands)) {
+			EH_WAIT_UNTIL_WITH_TIMEOUT(
+				NCP_DEFAULT_COMMAND_SEND_TIMEOUT,
+				(dispatch_pipelined_reply(event, args), is_ready_to_send())
+			);
+			require_action(!eh_did_timeout, on_error, ret = kWPANTUNDStatus_Timeout);
+
+			// The reply we just handled may have been the one
+			// telling us that the table is full.
+			if (mTableFull) {
+				continue;
+			}
+
+			pack_entry(mEntries[mNextIndex]);
+
+			EH_SPAWN(&mSubPT, vprocess_send_pipelined_command(event, args, mNextIndex));
+			ret = mNextCommandRet;
+			require_noerr(ret, on_error);
+
+			mNextIndex++;
+
+		} else {
+			EH_WAIT_UNTIL_WITH_TIMEOUT(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT, dispatch_pipelined_reply(event, args));
+			require_action(!eh_did_timeout, on_error, ret = kWPANTUNDStatus_Timeout);
+		}
+	}
+
+	if (mTableFull) {
+		syslog(LOG_WARNING, "Joiner table full after adding %d of %d joiners", mAddedCount, mTotalCount);
+
+		for (; mNextIndex < static_cast<int>(mEntries.size()); mNextIndex++, mDoneCount++) {
+			add_failure(mEntries[mNextIndex].mNumber, "joiner table full");
+		}
+	}
+
+	update_progress(true);
+
+	ret = mFailures.empty() ? kWPANTUNDStatus_Ok : kWPANTUNDStatus_Failure;
+	finish(ret, mFailures);
+
+	EH_EXIT();
+
+on_error:
+
+	syslog(LOG_ERR, "Adding joiners failed: %d", ret);
+
+	// Whatever wasn't confirmed by the NCP is reported as failed.
+	for (int index = take_pipelined_command(); index >= 0; index = take_pipelined_command()) {
+		add_failure(mEntries[index].mNumber, "no response from NCP");
+		mDoneCount++;
+	}
+
+	for (; mNextIndex < static_cast<int>(mEntries.size()); mNextIndex++, mDoneCount++) {
+		add_failure(mEntries[mNextIndex].mNumber, "not sent");
+	}
+
+	update_progress(true);
+
+	finish(ret, mFailures);
+
+	EH_END();
+}
@@ -0,0 +1,89 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPTaskJoinerAddBulk__
+#define __wpantund__SpinelNCPTaskJoinerAddBulk__
+
+#include <list>
+#include <string>
+#include <vector>
+#include "SpinelNCPTask.h"
+#include "SpinelNCPInstance.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+namespace nl {
+namespace wpantund {
+
+// Adds a list of joiners to the NCP's commissioner (see
+// `NCPControlInterface::joiner_add_bulk()`).
+//
+// All entries are parsed and checked before anything is sent, then the
+// inserts are pipelined (see `vprocess_send_pipelined_command()`). Once the NCP reports that its joiner table is full, the
+// remaining entries are not sent. The result is the list of entries
+// which were not added, as "<entry number>: <reason>" strings.
+class SpinelNCPTaskJoinerAddBulk : public SpinelNCPTask
+{
+public:
+	enum {
+		// `Thread:Commissioner:JoinerBulkProgress` is updated each
+		// time this many entries are done.
+		kProgressInterval = 32,
+	};
+
+	SpinelNCPTaskJoinerAddBulk(
+		SpinelNCPInstance* instance,
+		CallbackWithStatusArg1 cb,
+		const std::list<std::string>& joiners,
+		uint32_t joiner_timeout
+	);
+	virtual int vprocess_event(int event, va_list args);
+
+private:
+	struct Entry
+	{
+		int mNumber;                //!< Position in the original list, from 1
+		std::string mPSKd;
+		uint32_t mTimeout;
+		bool mHasExtAddress;
+		uint8_t mExtAddress[8];
+	};
+
+	bool parse_entry(const std::string& line, Entry& entry, std::string& reason);
+	void add_failure(int number, const std::string& reason);
+
+	virtual void handle_pipelined_reply(int cookie, int event, va_list args);
+	void pack_entry(const Entry& entry);
+	void update_progress(bool force);
+
+	std::vector<Entry> mEntries;
+	std::list<std::string> mFailures;
+	int mTotalCount;
+	int mDoneCount;
+	int mAddedCount;
+
+	int mNextIndex;
+	bool mTableFull;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPTaskJoinerAddBulk__) */
@@ -74,7 +74,7 @@ nl::wpantund::SpinelNCPTaskLeave::vprocess_event(int event, va_list args)
 
 	mInstance->mIsCommissioned = false;
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_STACK_UP,
 		false
@@ -83,7 +83,7 @@ nl::wpantund::SpinelNCPTaskLeave::vprocess_event(int event, va_list args)
 	ret = mNextCommandRet;
 	require_noerr(ret, on_error);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 		SPINEL_PROP_NET_IF_UP,
 		false
@@ -93,7 +93,7 @@ nl::wpantund::SpinelNCPTaskLeave::vprocess_event(int event, va_list args)
 	require_noerr(ret, on_error);
 
 	// Clear any saved network settings.
-	mNextCommand = SpinelPackData(SPINEL_FRAME_PACK_CMD_NET_CLEAR);
+	pack_next_command(SPINEL_FRAME_PACK_CMD_NET_CLEAR);
 	EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 	ret = mNextCommandRet;
 
@@ -103,7 +103,7 @@ nl::wpantund::SpinelNCPTaskLeave::vprocess_event(int event, va_list args)
 	mInstance->mNetworkKeyIndex = 0;
 
 	// Issue a Reset
-	mNextCommand = SpinelPackData(SPINEL_FRAME_PACK_CMD_RESET);
+	pack_next_command(SPINEL_FRAME_PACK_CMD_RESET);
 	EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 	ret = mNextCommandRet;
 	require_noerr(ret, on_error);
@@ -74,7 +74,7 @@ nl::wpantund::SpinelNCPTaskPeek::vprocess_event(int event, va_list args)
 	// to execute.
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 	    SPINEL_FRAME_PACK_CMD(
 	        SPINEL_DATATYPE_UINT32_S   // Address
 	        SPINEL_DATATYPE_UINT16_S   // Count
@@ -0,0 +1,165 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "assert-macros.h"
+#include <syslog.h>
+#include <errno.h>
+#include "SpinelNCPTaskSampleCounters.h"
+#include "SpinelNCPInstance.h"
+#include "spinel-extra.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+static const struct {
+	spinel_prop_key_t mKey;
+	const char* mName;
+} kCounterTable[] = {
+	// Must stay first, it is skipped if the NCP lacks `SPINEL_CAP_COUNTERS`.
+	{ SPINEL_PROP_CNTR_ALL_MAC_COUNTERS,  NULL },
+
+	{ SPINEL_PROP_CNTR_TX_IP_SEC_TOTAL,   kWPANTUNDValueMapKey_Counter_TxIpSecTotal },
+	{ SPINEL_PROP_CNTR_TX_IP_INSEC_TOTAL, kWPANTUNDValueMapKey_Counter_TxIpInsecTotal },
+	{ SPINEL_PROP_CNTR_TX_IP_DROPPED,     kWPANTUNDValueMapKey_Counter_TxIpDropped },
+	{ SPINEL_PROP_CNTR_RX_IP_SEC_TOTAL,   kWPANTUNDValueMapKey_Counter_RxIpSecTotal },
+	{ SPINEL_PROP_CNTR_RX_IP_INSEC_TOTAL, kWPANTUNDValueMapKey_Counter_RxIpInsecTotal },
+	{ SPINEL_PROP_CNTR_RX_IP_DROPPED,     kWPANTUNDValueMapKey_Counter_RxIpDropped },
+	{ SPINEL_PROP_CNTR_TX_SPINEL_TOTAL,   kWPANTUNDValueMapKey_Counter_TxSpinelTotal },
+	{ SPINEL_PROP_CNTR_RX_SPINEL_TOTAL,   kWPANTUNDValueMapKey_Counter_RxSpinelTotal },
+	{ SPINEL_PROP_CNTR_RX_SPINEL_ERR,     kWPANTUNDValueMapKey_Counter_RxSpinelErr },
+	{ SPINEL_PROP_CNTR_IP_TX_SUCCESS,     kWPANTUNDValueMapKey_Counter_IpTxSuccess },
+	{ SPINEL_PROP_CNTR_IP_RX_SUCCESS,     kWPANTUNDValueMapKey_Counter_IpRxSuccess },
+	{ SPINEL_PROP_CNTR_IP_TX_FAILURE,     kWPANTUNDValueMapKey_Counter_IpTxFailure },
+	{ SPINEL_PROP_CNTR_IP_RX_FAILURE,     kWPANTUNDValueMapKey_Counter_IpRxFailure },
+};
+
+static const int kCounterTableSize = static_cast<int>(sizeof(kCounterTable) / sizeof(kCounterTable[0]));
+
+nl::wpantund::SpinelNCPTaskSampleCounters::SpinelNCPTaskSampleCounters(
+	SpinelNCPInstance* instance,
+	CallbackWithStatusArg1 cb
+):	SpinelNCPTask(instance, cb), mNextIndex(0)
+{
+}
+
+// `cookie` is the index into `kCounterTable` of the counter asked for.
+void
+nl::wpantund::SpinelNCPTaskSampleCounters::handle_pipelined_reply(int cookie, int event, va_list args)
+{
+	va_list tmp;
+	unsigned int prop_key;
+	const uint8_t* data_in;
+	spinel_size_t data_len;
+
+	(void)event;
+
+	va_copy(tmp, args);
+	prop_key = va_arg(tmp, unsigned int);
+	data_in = va_arg(tmp, const uint8_t*);
+	data_len = va_arg_small(tmp, spinel_size_t);
+	va_end(tmp);
+
+	// Anything other than the requested property (normally a
+	// `LAST_STATUS`) means the NCP doesn't have this counter.
+	if (prop_key != kCounterTable[cookie].mKey) {
+		syslog(LOG_DEBUG, "NCP counter %s not available", spinel_prop_key_to_cstr(kCounterTable[cookie].mKey));
+
+	} else if (prop_key == SPINEL_PROP_CNTR_ALL_MAC_COUNTERS) {
+		boost::any value;
+
+		if (unpack_ncp_counters_all_mac(data_in, data_len, value, /* as_val_map */ true) == kWPANTUNDStatus_Ok) {
+			const ValueMap& mac_counters = boost::any_cast<const ValueMap&>(value);
+			mCounters.insert(mac_counters.begin(), mac_counters.end());
+		}
+
+	} else {
+		uint32_t counter_value;
+
+		if (spinel_datatype_unpack(data_in, data_len, SPINEL_DATATYPE_UINT32_S, &counter_value) > 0) {
+			mCounters[kCounterTable[cookie].mName] = counter_value;
+		}
+	}
+}
+
+int
+nl::wpantund::SpinelNCPTaskSampleCounters::vprocess_event(int event, va_list args)
+{
+	int ret = kWPANTUNDStatus_Failure;
+
+	EH_BEGIN();
+
+	if (!mInstance->mEnabled) {
+		ret = kWPANTUNDStatus_InvalidWhenDisabled;
+		finish(ret);
+		EH_EXIT();
+	}
+
+	// Sampling must never be the reason the NCP gets woken up.
+	if ( ncp_state_is_initializing(mInstance->get_ncp_state())
+	  || ncp_state_is_sleeping(mInstance->get_ncp_state())
+	  || (mInstance->get_ncp_state() == UPGRADING)
+	) {
+		ret = kWPANTUNDStatus_InvalidForCurrentState;
+		finish(ret);
+		EH_EXIT();
+	}
+
+	// The first event to a task is EVENT_STARTING_TASK. The following
+	// line makes sure that we don't start processing this task
+	// until it is properly scheduled. All tasks immediately receive
+	// the initial `EVENT_STARTING_TASK` event, but further events
+	// will only be received by that task once it is that task's turn
+	// to execute.
+	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
+
+	mNextIndex = mInstance->mCapabilities.count(SPINEL_CAP_COUNTERS) ? 0 : 1;
+
+	while ((mNextIndex < kCounterTableSize) || (get_pipelined_count() > 0)) {
+		if ((mNextIndex < kCounterTableSize) && (get_pipelined_count() < kMaxPipelinedCommands)) {
+			pack_next_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, kCounterTable[mNextIndex].mKey);
+
+			EH_SPAWN(&mSubPT, vprocess_send_pipelined_command(event, args, mNextIndex));
+			ret = mNextCommandRet;
+			require_noerr(ret, on_error);
+
+			mNextIndex++;
+
+		} else {
+			EH_WAIT_UNTIL_WITH_TIMEOUT(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT, dispatch_pipelined_reply(event, args));
+			require_action(!eh_did_timeout, on_error, ret = kWPANTUNDStatus_Timeout);
+		}
+	}
+
+	ret = mCounters.empty() ? kWPANTUNDStatus_FeatureNotSupported : kWPANTUNDStatus_Ok;
+	finish(ret, mCounters);
+
+	EH_EXIT();
+
+on_error:
+
+	syslog(LOG_ERR, "Sampling NCP counters failed: %d", ret);
+
+	finish(ret);
+
+	EH_END();
+}
@@ -0,0 +1,58 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPTaskSampleCounters__
+#define __wpantund__SpinelNCPTaskSampleCounters__
+
+#include "ValueMap.h"
+#include "SpinelNCPTask.h"
+#include "SpinelNCPInstance.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+namespace nl {
+namespace wpantund {
+
+// Fetches all of the NCP's MAC, IP and Spinel counters in one go.
+//
+// Rather than waiting for each reply before sending the next get,
+// the gets are pipelined (see `vprocess_send_pipelined_command()`).
+// The result is a `ValueMap` from counter name to `uint32_t` value;
+// counters the NCP doesn't support are left out.
+class SpinelNCPTaskSampleCounters : public SpinelNCPTask
+{
+public:
+	SpinelNCPTaskSampleCounters(
+		SpinelNCPInstance* instance,
+		CallbackWithStatusArg1 cb
+	);
+	virtual int vprocess_event(int event, va_list args);
+
+private:
+	virtual void handle_pipelined_reply(int cookie, int event, va_list args);
+
+	int mNextIndex;
+	ValueMap mCounters;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPTaskSampleCounters__) */
@@ -39,14 +39,26 @@ nl::wpantund::SpinelNCPTaskScan::SpinelNCPTaskScan(
 	ScanType scan_type,
 	bool joiner_flag,
 	bool enable_filtering,
-	uint16_t pan_id
-):	SpinelNCPTask(instance, cb), mChannelMaskLen(0), mScanPeriod(scan_period), mScanType(scan_type),
-	mJoinerFlag(joiner_flag), mEnablerFiltering(enable_filtering), mPanId(pan_id), mShouldInterfaceDown(false)
+	uint16_t pan_id,
+	const SpinelNCPScanMatch& match
+):	SpinelNCPTask(instance, cb), mChannelMask(channel_mask), mChannelMaskLen(0), mScanPeriod(scan_period), mScanType(scan_type),
+	mJoinerFlag(joiner_flag), mEnablerFiltering(enable_filtering), mPanId(pan_id), mShouldInterfaceDown(false),
+	mMatch(match), mPassIndex(0), mScanIdle(false), mMatched(false)
+{
+	if (mScanType == kScanTypeEnergy) {
+		mMatch = SpinelNCPScanMatch();
+	}
+}
+
+void
+nl::wpantund::SpinelNCPTaskScan::set_channel_mask_data(uint32_t channel_mask)
 {
 	uint8_t i;
 
+	mChannelMaskLen = 0;
+
 	for (i = 0; i < 32; i++) {
-		if (channel_mask & (1<<i)) {
+		if (channel_mask & (1U<<i)) {
 			mChannelMaskData[mChannelMaskLen++] = i;
 		}
 	}
@@ -59,6 +71,101 @@ nl::wpantund::SpinelNCPTaskScan::finish(int status, const boost::any& value)
 }
 
 
+void
+nl::wpantund::SpinelNCPTaskScan::handle_scan_result(va_list args)
+{
+	spinel_prop_key_t prop_key = va_arg_small(args, spinel_prop_key_t);
+	const uint8_t* data_ptr = va_arg(args, const uint8_t*);
+	spinel_size_t data_len = va_arg(args, spinel_size_t);
+
+	if ((prop_key == SPINEL_PROP_MAC_SCAN_BEACON)
+	    && ((mScanType == kScanTypeNet) || (mScanType == kScanTypeDiscover))) {
+		const spinel_eui64_t* laddr = NULL;
+		const char* networkid = "";
+		const uint8_t* xpanid = NULL;
+		unsigned int xpanid_len = 0;
+		unsigned int proto = 0;
+		uint16_t panid = 0xFFFF;
+		uint16_t saddr = 0xFFFF;
+		uint8_t chan = 0;
+		uint8_t lqi = 0x00;
+		int8_t rssi = 0x00;
+		uint8_t flags = 0x00;
+
+		syslog(LOG_DEBUG, "Got a beacon");
+
+		spinel_datatype_unpack(
+			data_ptr,
+			data_len,
+			"Cct(ESSC)t(iCUd)",
+			&chan,
+			&rssi,
+
+			&laddr,
+			&saddr,
+			&panid,
+			&lqi,
+
+			&proto,
+			&flags,
+			&networkid,
+			&xpanid, &xpanid_len
+		);
+
+		if ((xpanid_len != 8) && (xpanid_len != 0)) {
+			return;
+		}
+
+		WPAN::NetworkInstance network(
+			networkid,
+			xpanid,
+			panid,
+			chan,
+			(flags & SPINEL_BEACON_THREAD_FLAG_JOINABLE)
+		);
+		network.rssi = rssi;
+		network.type = proto;
+		network.lqi = lqi;
+		network.saddr = saddr;
+
+		if (laddr) {
+			memcpy(network.hwaddr, laddr, sizeof(network.hwaddr));
+		}
+
+		mInstance->mScanPlanner.record_beacon(network);
+
+		mInstance->get_control_interface().mOnNetScanBeacon(network);
+
+		if (!mMatched && !mMatch.is_empty() && mMatch.matches(network)) {
+			mMatched = true;
+			mMatchedNetwork = network;
+		}
+
+	} else if ((prop_key == SPINEL_PROP_MAC_ENERGY_SCAN_RESULT) && (mScanType == kScanTypeEnergy)) {
+		EnergyScanResultEntry result;
+
+		syslog(LOG_DEBUG, "Got an Energy Scan result");
+
+		spinel_datatype_unpack(
+			data_ptr,
+			data_len,
+			"Cc",
+			&result.mChannel,
+			&result.mMaxRssi
+		);
+
+		mInstance->get_control_interface().mOnEnergyScanResult(result);
+
+	} else if (prop_key == SPINEL_PROP_MAC_SCAN_STATE) {
+		int scan_state;
+		spinel_datatype_unpack(data_ptr, data_len, "i", &scan_state);
+
+		if (scan_state == SPINEL_SCAN_STATE_IDLE) {
+			mScanIdle = true;
+		}
+	}
+}
+
 int
 nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 {
@@ -96,22 +203,20 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
 	mShouldInterfaceDown = false;
+	mMatched = false;
 
-	// Set channel mask
-	mNextCommand = SpinelPackData(
-		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
-		SPINEL_PROP_MAC_SCAN_MASK,
-		mChannelMaskData,
-		mChannelMaskLen
-	);
-	EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
-	ret = mNextCommandRet;
-	require_noerr(ret, on_error);
+	// Planned here rather than in the constructor, so that beacons heard
+	// by a scan queued just before this one are taken into account.
+	mPasses = mInstance->mScanPlanner.plan(mChannelMask, mMatch);
+
+	if (!mMatch.is_empty()) {
+		syslog(LOG_INFO, "Scan: Looking for %s in %d pass(es)", mMatch.get_as_string().c_str(), (int)mPasses.size());
+	}
 
 	if (mScanType == kScanTypeDiscover) {
 
 		// Set `discovery joiner flag`
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			SPINEL_PROP_THREAD_DISCOVERY_SCAN_JOINER_FLAG,
 			mJoinerFlag
@@ -121,7 +226,7 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 		require_noerr(ret, on_error);
 
 		// Set the `enable-filtering` property
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			SPINEL_PROP_THREAD_DISCOVERY_SCAN_ENABLE_FILTERING,
 			mEnablerFiltering
@@ -131,7 +236,7 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 		require_noerr(ret, on_error);
 
 		// Set PANID used in Discovery scan for PANID filtering.
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S),
 			SPINEL_PROP_THREAD_DISCOVERY_SCAN_PANID,
 			mPanId
@@ -142,7 +247,7 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 
 		// For discovery scan, interface should be up
 		if (mInstance->get_ncp_state() == OFFLINE) {
-			mNextCommand = SpinelPackData(
+			pack_next_command(
 				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 				SPINEL_PROP_NET_IF_UP,
 				true
@@ -155,7 +260,7 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 	}
 
 	// Set delay period
-	mNextCommand = SpinelPackData(
+	pack_next_command(
 		SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT16_S),
 		SPINEL_PROP_MAC_SCAN_PERIOD,
 		mScanPeriod
@@ -164,131 +269,106 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 	ret = mNextCommandRet;
 	require_noerr(ret, on_error);
 
-	// Start the scan.
-	{
-		spinel_scan_state_t scanState;
-
-		if (mScanType == kScanTypeEnergy) {
-			scanState = SPINEL_SCAN_STATE_ENERGY;
-		} else if (mScanType == kScanTypeDiscover) {
-			scanState = SPINEL_SCAN_STATE_DISCOVER;
-		} else if (mScanType == kScanTypeNet) {
-			scanState = SPINEL_SCAN_STATE_BEACON;
-		} else {
-			ret = kWPANTUNDStatus_InvalidArgument;
-			goto on_error;
-		}
+	for (mPassIndex = 0; mPassIndex < mPasses.size(); mPassIndex++) {
+		// Set channel mask
+		set_channel_mask_data(mPasses[mPassIndex]);
 
-		mNextCommand = SpinelPackData(
-			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
-			SPINEL_PROP_MAC_SCAN_STATE,
-			scanState
+		pack_next_command(
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S),
+			SPINEL_PROP_MAC_SCAN_MASK,
+			mChannelMaskData,
+			mChannelMaskLen
 		);
 		EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 		ret = mNextCommandRet;
 		require_noerr(ret, on_error);
-	}
 
-	do {
-		EH_REQUIRE_WITHIN(
-			15,
-			event == EVENT_NCP_PROP_VALUE_IS
-			|| event == EVENT_NCP_PROP_VALUE_INSERTED,
-			on_error
-		);
+		// Start the scan.
+		{
+			spinel_scan_state_t scanState;
+
+			if (mScanType == kScanTypeEnergy) {
+				scanState = SPINEL_SCAN_STATE_ENERGY;
+			} else if (mScanType == kScanTypeDiscover) {
+				scanState = SPINEL_SCAN_STATE_DISCOVER;
+			} else if (mScanType == kScanTypeNet) {
+				scanState = SPINEL_SCAN_STATE_BEACON;
+			} else {
+				ret = kWPANTUNDStatus_InvalidArgument;
+				goto on_error;
+			}
 
-		spinel_prop_key_t prop_key = va_arg_small(args, spinel_prop_key_t);
-		const uint8_t* data_ptr = va_arg(args, const uint8_t*);
-		spinel_size_t data_len = va_arg(args, spinel_size_t);
-
-		if ((prop_key == SPINEL_PROP_MAC_SCAN_BEACON)
-		    && ((mScanType == kScanTypeNet) || (mScanType == kScanTypeDiscover))) {
-			const spinel_eui64_t* laddr = NULL;
-			const char* networkid = "";
-			const uint8_t* xpanid = NULL;
-			unsigned int xpanid_len = 0;
-			unsigned int proto = 0;
-			uint16_t panid = 0xFFFF;
-			uint16_t saddr = 0xFFFF;
-			uint8_t chan = 0;
-			uint8_t lqi = 0x00;
-			int8_t rssi = 0x00;
-			uint8_t flags = 0x00;
-
-			syslog(LOG_DEBUG, "Got a beacon");
-
-			spinel_datatype_unpack(
-				data_ptr,
-				data_len,
-				"Cct(ESSC)t(iCUd)",
-				&chan,
-				&rssi,
-
-				&laddr,
-				&saddr,
-				&panid,
-				&lqi,
-
-				&proto,
-				&flags,
-				&networkid,
-				&xpanid, &xpanid_len
+			pack_next_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
+				SPINEL_PROP_MAC_SCAN_STATE,
+				scanState
 			);
+			EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
+			ret = mNextCommandRet;
+			require_noerr(ret, on_error);
+		}
 
-			if ((xpanid_len != 8) && (xpanid_len != 0)) {
-				break;
-			}
+		mScanIdle = false;
 
-			WPAN::NetworkInstance network(
-				networkid,
-				xpanid,
-				panid,
-				chan,
-				(flags & SPINEL_BEACON_THREAD_FLAG_JOINABLE)
+		while (!mScanIdle && !mMatched) {
+			EH_REQUIRE_WITHIN(
+				15,
+				event == EVENT_NCP_PROP_VALUE_IS
+				|| event == EVENT_NCP_PROP_VALUE_INSERTED,
+				on_error
 			);
-			network.rssi = rssi;
-			network.type = proto;
-			network.lqi = lqi;
-			network.saddr = saddr;
 
-			if (laddr) {
-				memcpy(network.hwaddr, laddr, sizeof(network.hwaddr));
-			}
+			handle_scan_result(args);
 
-			mInstance->get_control_interface().mOnNetScanBeacon(network);
+			// Change the event type to 'IDLE' so that we
+			// don't try to process this event once than once.
+			event = EVENT_IDLE;
+		}
 
-		} else if ((prop_key == SPINEL_PROP_MAC_ENERGY_SCAN_RESULT) && (mScanType == kScanTypeEnergy)) {
-			EnergyScanResultEntry result;
+		if (mMatched) {
+			break;
+		}
+	}
 
-			syslog(LOG_DEBUG, "Got an Energy Scan result");
+	if (mMatched && !mScanIdle) {
+		syslog(LOG_INFO, "Scan: Found \"%s\" on channel %d, stopping scan", mMatchedNetwork.name.c_str(), mMatchedNetwork.channel);
 
-			spinel_datatype_unpack(
-				data_ptr,
-				data_len,
-				"Cc",
-				&result.mChannel,
-				&result.mMaxRssi
-			);
+		pack_next_command(
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
+			SPINEL_PROP_MAC_SCAN_STATE,
+			SPINEL_SCAN_STATE_IDLE
+		);
+		EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
+		ret = mNextCommandRet;
+		check_noerr(ret);
 
-			mInstance->get_control_interface().mOnEnergyScanResult(result);
+		if ((ret == kWPANTUNDStatus_Ok) && (event == EVENT_NCP_PROP_VALUE_IS)) {
+			// The response carries the scan state after the request,
+			// which is still active on NCPs that can't abort a scan.
+			handle_scan_result(args);
+		}
 
-		} else if (prop_key == SPINEL_PROP_MAC_SCAN_STATE) {
-			int scan_state;
-			spinel_datatype_unpack(data_ptr, data_len, "i", &scan_state);
+		ret = kWPANTUNDStatus_Ok;
 
-			if (scan_state == SPINEL_SCAN_STATE_IDLE) {
-				break;
-			}
-		}
+		// If it couldn't be stopped, let the current pass finish so the
+		// NCP isn't left scanning behind the next task.
+		while (!mScanIdle) {
+			EH_REQUIRE_WITHIN(
+				15,
+				event == EVENT_NCP_PROP_VALUE_IS
+				|| event == EVENT_NCP_PROP_VALUE_INSERTED,
+				on_error
+			);
 
-		// Change the event type to 'IDLE' so that we
-		// don't try to process this event once than once.
-		event = EVENT_IDLE;
-	} while(true);
+			handle_scan_result(args);
+
+			event = EVENT_IDLE;
+		}
+	}
 
 	if (mShouldInterfaceDown)
 	{
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			SPINEL_PROP_NET_IF_UP,
 			false
@@ -299,7 +379,11 @@ nl::wpantund::SpinelNCPTaskScan::vprocess_event(int event, va_list args)
 		mShouldInterfaceDown = false;
 	}
 
-	finish(ret);
+	if (mMatched) {
+		finish(ret, boost::any(mMatchedNetwork));
+	} else {
+		finish(ret);
+	}
 
 	EH_EXIT();
 
@@ -311,7 +395,7 @@ on_error:
 
 	if (mShouldInterfaceDown)
 	{
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			SPINEL_PROP_NET_IF_UP,
 			false
@@ -22,6 +22,8 @@
 
 #include "SpinelNCPTask.h"
 #include "SpinelNCPInstance.h"
+#include "SpinelNCPScanPlanner.h"
+#include <vector>
 
 using namespace nl;
 using namespace nl::wpantund;
@@ -50,12 +52,18 @@ public:
 		ScanType scan_type = kScanTypeNet,
 		bool joiner_flag = false,          // Scan for joiner only devices (used in discover scan).
 		bool enable_filtering = false,     // Enable scan result filtering (used in discover scan).
-		uint16_t pan_id_filter = 0xffff    // PANID used for filtering, 0xFFFF to disable (used in discover scan).
+		uint16_t pan_id_filter = 0xffff,   // PANID used for filtering, 0xFFFF to disable (used in discover scan).
+		const SpinelNCPScanMatch& match = SpinelNCPScanMatch()  // Stop at the first matching beacon (net/discover scan).
 	);
 	virtual int vprocess_event(int event, va_list args);
 	virtual void finish(int status, const boost::any& value = boost::any());
 
 private:
+	void set_channel_mask_data(uint32_t channel_mask);
+	void handle_scan_result(va_list args);
+
+private:
+	uint32_t mChannelMask;
 	uint8_t mChannelMaskData[32];
 	uint8_t mChannelMaskLen;
 	uint16_t mScanPeriod;  // per channel
@@ -65,6 +73,13 @@ private:
 	uint16_t mPanId;
 	bool mShouldInterfaceDown;
 
+	SpinelNCPScanMatch mMatch;
+	std::vector<uint32_t> mPasses;
+	size_t mPassIndex;
+	bool mScanIdle;
+	bool mMatched;
+	WPAN::NetworkInstance mMatchedNetwork;
+
 };
 
 }; // namespace wpantund
@@ -27,17 +27,29 @@
 #include "SpinelNCPTaskSendCommand.h"
 #include "SpinelNCPInstance.h"
 #include "spinel-extra.h"
+#include "FixedBlockPool.h"
+#include <boost/make_shared.hpp>
 
 using namespace nl;
 using namespace nl::wpantund;
 
-static int simple_unpacker(const uint8_t* data_in, spinel_size_t data_len, const std::string& pack_format,
+static int simple_unpacker(const uint8_t* data_in, spinel_size_t data_len, const char* pack_format,
 							boost::any& result);
 
+// Tasks are allocated together with their shared_ptr control block. The
+// extra room in each block accounts for the control block overhead.
+typedef FixedBlockAllocator<
+	SpinelNCPTaskSendCommand,
+	sizeof(SpinelNCPTaskSendCommand) + 64,
+	SpinelNCPTaskSendCommand::kTaskPoolSize
+> TaskAllocator;
+
 SpinelNCPTaskSendCommand::Factory::Factory(SpinelNCPInstance* instance):
 	mInstance(instance),
 	mCb(NilReturn()),
+	mInlineCommandLen(0),
 	mTimeout(NCP_DEFAULT_COMMAND_RESPONSE_TIMEOUT),
+	mReplyFormat(NULL),
 	mLockProperty(0)
 {
 }
@@ -46,20 +58,62 @@ SpinelNCPTaskSendCommand::Factory&
 SpinelNCPTaskSendCommand::Factory::set_callback(const CallbackWithStatusArg1 &cb)
 {
 	mCb = cb;
+	mStatusCb.clear();
 	return *this;
 }
 
 SpinelNCPTaskSendCommand::Factory&
 SpinelNCPTaskSendCommand::Factory::set_callback(const CallbackWithStatus &cb)
 {
-	mCb = boost::bind(cb, _1);
+	// Kept separately rather than wrapped with `boost::bind()`, since
+	// the bound wrapper is too large for `boost::function` to store
+	// without a heap allocation.
+	mCb = NilReturn();
+	mStatusCb = cb;
 	return *this;
 }
 
+bool
+SpinelNCPTaskSendCommand::Factory::has_command(void) const
+{
+	return (mInlineCommandLen != 0) || !mCommandList.empty();
+}
+
 SpinelNCPTaskSendCommand::Factory&
 SpinelNCPTaskSendCommand::Factory::add_command(const Data& command)
 {
-	mCommandList.insert(mCommandList.end(), command);
+	if (!has_command() && !command.empty() && (command.size() <= sizeof(mInlineCommand))) {
+		memcpy(mInlineCommand, command.data(), command.size());
+		mInlineCommandLen = static_cast<spinel_size_t>(command.size());
+	} else {
+		mCommandList.insert(mCommandList.end(), command);
+	}
+	return *this;
+}
+
+SpinelNCPTaskSendCommand::Factory&
+SpinelNCPTaskSendCommand::Factory::add_packed_command(const char* pack_format, ...)
+{
+	bool is_packed = false;
+	va_list args;
+
+	va_start(args, pack_format);
+
+	if (!has_command()) {
+		spinel_ssize_t packed_size = spinel_datatype_vpack(mInlineCommand, sizeof(mInlineCommand), pack_format, args);
+
+		if ((packed_size > 0) && (packed_size <= static_cast<spinel_ssize_t>(sizeof(mInlineCommand)))) {
+			mInlineCommandLen = static_cast<spinel_size_t>(packed_size);
+			is_packed = true;
+		}
+	}
+
+	if (!is_packed) {
+		mCommandList.insert(mCommandList.end(), SpinelPackDataV(pack_format, args));
+	}
+
+	va_end(args);
+
 	return *this;
 }
 
@@ -71,15 +125,17 @@ SpinelNCPTaskSendCommand::Factory::set_timeout(int timeout)
 }
 
 SpinelNCPTaskSendCommand::Factory&
-SpinelNCPTaskSendCommand::Factory::set_reply_format(const std::string& packed_format)
+SpinelNCPTaskSendCommand::Factory::set_reply_format(const char* packed_format)
 {
-	mReplyUnpacker = boost::bind(simple_unpacker, _1, _2, packed_format, _3);
+	mReplyFormat = packed_format;
+	mReplyUnpacker.clear();
 	return *this;
 }
 
 SpinelNCPTaskSendCommand::Factory&
 SpinelNCPTaskSendCommand::Factory::set_reply_unpacker(const ReplyUnpacker& reply_unpacker)
 {
+	mReplyFormat = NULL;
 	mReplyUnpacker = reply_unpacker;
 	return *this;
 }
@@ -94,20 +150,41 @@ SpinelNCPTaskSendCommand::Factory::set_lock_property(int lock_property)
 boost::shared_ptr<SpinelNCPTask>
 SpinelNCPTaskSendCommand::Factory::finish(void)
 {
-	return boost::shared_ptr<SpinelNCPTask>(new SpinelNCPTaskSendCommand(*this));
+	return boost::allocate_shared<SpinelNCPTaskSendCommand>(TaskAllocator(), *this);
 }
 
 nl::wpantund::SpinelNCPTaskSendCommand::SpinelNCPTaskSendCommand(
 	const Factory& factory
 ):	SpinelNCPTask(factory.mInstance, factory.mCb),
+	mStatusCb(factory.mStatusCb),
+	mInlineCommandLen(factory.mInlineCommandLen),
 	mCommandList(factory.mCommandList),
 	mLockProperty(factory.mLockProperty),
+	mReplyFormat(factory.mReplyFormat),
 	mReplyUnpacker(factory.mReplyUnpacker),
 	mRetVal(kWPANTUNDStatus_Failure)
 {
+	memcpy(mInlineCommand, factory.mInlineCommand, mInlineCommandLen);
 	mNextCommandTimeout = factory.mTimeout;
 }
 
+nl::wpantund::SpinelNCPTaskSendCommand::~SpinelNCPTaskSendCommand()
+{
+	// `SpinelNCPTask::~SpinelNCPTask()` can't reach our `finish()`.
+	finish(kWPANTUNDStatus_Canceled);
+}
+
+void
+nl::wpantund::SpinelNCPTaskSendCommand::finish(int status, const boost::any& value)
+{
+	if (!mStatusCb.empty()) {
+		mStatusCb(status);
+		mStatusCb.clear();
+	}
+
+	SpinelNCPTask::finish(status, value);
+}
+
 static boost::any
 spinel_iter_to_any(spinel_datatype_iter_t *iter)
 {
@@ -259,12 +336,12 @@ spinel_packed_to_any(const uint8_t* data_in, spinel_size_t data_len, const char*
 }
 
 static int
-simple_unpacker(const uint8_t* data_in, spinel_size_t data_len, const std::string& pack_format, boost::any& result)
+simple_unpacker(const uint8_t* data_in, spinel_size_t data_len, const char* pack_format, boost::any& result)
 {
 	int retval = kWPANTUNDStatus_Ok;
 
 	try {
-		result = spinel_packed_to_any(data_in, data_len, pack_format.c_str());
+		result = spinel_packed_to_any(data_in, data_len, pack_format);
 
 	} catch(...) {
 		retval = kWPANTUNDStatus_Failure;
@@ -289,7 +366,7 @@ nl::wpantund::SpinelNCPTaskSendCommand::vprocess_event(int event, va_list args)
 	EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
 
 	if (mLockProperty != 0) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			mLockProperty,
 			true
@@ -307,21 +384,35 @@ nl::wpantund::SpinelNCPTaskSendCommand::vprocess_event(int event, va_list args)
 
 	mRetVal = kWPANTUNDStatus_Ok;
 
+	if (mInlineCommandLen != 0) {
+		mNextCommandPtr = mInlineCommand;
+		mNextCommandLen = mInlineCommandLen;
+
+		EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
+
+		mNextCommandPtr = NULL;
+	}
+
 	mCommandIter = mCommandList.begin();
 
 	while ( (mRetVal == kWPANTUNDStatus_Ok)
 	     && (mCommandList.end() != mCommandIter)
 	) {
-		mNextCommand = *mCommandIter++;
+		// Send the command straight out of the list, which outlives it.
+		mNextCommandPtr = mCommandIter->data();
+		mNextCommandLen = static_cast<spinel_size_t>(mCommandIter->size());
+		++mCommandIter;
 
 		EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
 	}
 
+	mNextCommandPtr = NULL;
+
 	mRetVal = mNextCommandRet;
 
 	require_noerr(mRetVal, on_error);
 
-	if ( mReplyUnpacker
+	if ( ((mReplyFormat != NULL) || mReplyUnpacker)
 	  && (kWPANTUNDStatus_Ok == mRetVal)
 	  && (EVENT_NCP_PROP_VALUE_IS == event)
 	) {
@@ -332,7 +423,11 @@ nl::wpantund::SpinelNCPTaskSendCommand::vprocess_event(int event, va_list args)
 		spinel_size_t data_len = va_arg_small(args, spinel_size_t);
 		(void) key; // Ignored
 
-		mRetVal = mReplyUnpacker(data_in, data_len, mReturnValue);
+		if (mReplyFormat != NULL) {
+			mRetVal = simple_unpacker(data_in, data_len, mReplyFormat, mReturnValue);
+		} else {
+			mRetVal = mReplyUnpacker(data_in, data_len, mReturnValue);
+		}
 	}
 
 on_error:
@@ -347,7 +442,7 @@ on_error:
 	// over the protothread EH_SPAWN() call.
 
 	if (mLockProperty != 0) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_BOOL_S),
 			mLockProperty,
 			false
@@ -34,6 +34,16 @@ class SpinelNCPTaskSendCommand : public SpinelNCPTask
 public:
 	typedef boost::function<int (const uint8_t*, spinel_size_t, boost::any&)> ReplyUnpacker;
 
+	enum
+	{
+		// The first command is stored inline if it fits in this many
+		// bytes, which covers practically every single property get/set.
+		kInlineCommandSize = 32,
+
+		// Number of tasks that can be allocated without touching the heap.
+		kTaskPoolSize = 16,
+	};
+
 	class Factory {
 	public:
 
@@ -46,14 +56,23 @@ public:
 		Factory& add_command(const Data& command);
 		Factory& set_timeout(int timeout);
 
+		/* Packs a command directly into the factory, using the same
+		 * arguments as `SpinelPackData()`. Unlike `add_command()`, this
+		 * does not need an intermediate `Data` object when the command
+		 * fits in the inline command buffer.
+		 */
+		Factory& add_packed_command(const char* pack_format, ...);
+
 		/* For simple (single type) reply formats, we can use the
 		 * `set_reply_format()` and specify the spinel packing format.
+		 * The format string is not copied, so it must be a string literal
+		 * (e.g., one of the `SPINEL_DATATYPE_*_S` macros).
 		 * For more complicated reply format (e.g., multiple types, structs)
 		 * a `ReplyUnpakcer` function pointer can be specified using
 		 * `set_reply_unpacker()` which is then used to decode/unpack
 		 * the reply spinel message into a `boost::any` output result.
 		 */
-		Factory& set_reply_format(const std::string& packed_format);
+		Factory& set_reply_format(const char* packed_format);
 		Factory& set_reply_unpacker(const ReplyUnpacker &reply_unpacker);
 
 		Factory& set_lock_property(int lock_property);
@@ -61,23 +80,36 @@ public:
 		boost::shared_ptr<SpinelNCPTask> finish(void);
 
 	private:
+		bool has_command(void) const;
+
 		SpinelNCPInstance* mInstance;
 		CallbackWithStatusArg1 mCb;
+		CallbackWithStatus mStatusCb;
+		uint8_t mInlineCommand[kInlineCommandSize];
+		spinel_size_t mInlineCommandLen;
 		std::list<Data> mCommandList;
 		int mTimeout;
+		const char* mReplyFormat;
 		ReplyUnpacker mReplyUnpacker;
 		int mLockProperty;
 	};
 
 	SpinelNCPTaskSendCommand(const Factory& factory);
+	virtual ~SpinelNCPTaskSendCommand();
 
 	virtual int vprocess_event(int event, va_list args);
 
+	virtual void finish(int status, const boost::any& value = boost::any());
+
 private:
 
+	CallbackWithStatus mStatusCb;
+	uint8_t mInlineCommand[kInlineCommandSize];
+	spinel_size_t mInlineCommandLen;
 	std::list<Data> mCommandList;
 	std::list<Data>::const_iterator mCommandIter;
 	int mLockProperty;
+	const char* mReplyFormat;
 	ReplyUnpacker mReplyUnpacker;
 	int mRetVal;
 	boost::any mReturnValue;
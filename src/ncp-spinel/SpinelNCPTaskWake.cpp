@@ -66,7 +66,7 @@ nl::wpantund::SpinelNCPTaskWake::vprocess_event(int event, va_list args)
 	mInstance->mResetIsExpected = true;
 
 	if (mInstance->mCapabilities.count(SPINEL_CAP_MCU_POWER_STATE)) {
-		mNextCommand = SpinelPackData(
+		pack_next_command(
 			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
 			SPINEL_PROP_MCU_POWER_STATE,
 			SPINEL_MCU_POWER_STATE_ON
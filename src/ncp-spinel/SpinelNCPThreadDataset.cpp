@@ -24,6 +24,8 @@
 #include "assert-macros.h"
 #include <syslog.h>
 #include <errno.h>
+#include <string.h>
+#include <algorithm>
 #include "SpinelNCPInstance.h"
 #include "SpinelNCPTask.h"
 #include "SpinelNCPThreadDataset.h"
@@ -33,6 +35,16 @@
 using namespace nl;
 using namespace nl::wpantund;
 
+ThreadDataset::ThreadDataset(void)
+{
+	memset(mFrameOffset, 0, sizeof(mFrameOffset));
+	memset(mFrameLength, 0, sizeof(mFrameLength));
+	memset(mFrameGeneration, 0, sizeof(mFrameGeneration));
+	memset(mValueMapGeneration, 0, sizeof(mValueMapGeneration));
+	memset(mStringListGeneration, 0, sizeof(mStringListGeneration));
+	memset(mParsedGeneration, 0, sizeof(mParsedGeneration));
+}
+
 void
 ThreadDataset::clear(void)
 {
@@ -51,159 +63,338 @@ ThreadDataset::clear(void)
 	mRawTlvs.clear();
 }
 
+uint32_t
+ThreadDataset::get_field_generation(Field field) const
+{
+	switch (field) {
+	case kFieldActiveTimestamp:  return mActiveTimestamp.get_generation();
+	case kFieldPendingTimestamp: return mPendingTimestamp.get_generation();
+	case kFieldMasterKey:        return mMasterKey.get_generation();
+	case kFieldNetworkName:      return mNetworkName.get_generation();
+	case kFieldExtendedPanId:    return mExtendedPanId.get_generation();
+	case kFieldMeshLocalPrefix:  return mMeshLocalPrefix.get_generation();
+	case kFieldDelay:            return mDelay.get_generation();
+	case kFieldPanId:            return mPanId.get_generation();
+	case kFieldChannel:          return mChannel.get_generation();
+	case kFieldPSKc:             return mPSKc.get_generation();
+	case kFieldChannelMaskPage0: return mChannelMaskPage0.get_generation();
+	case kFieldSecurityPolicy:   return mSecurityPolicy.get_generation();
+	case kFieldRawTlvs:          return mRawTlvs.get_generation();
+	case kFieldCount:            break;
+	}
+
+	return 0;
+}
+
 void
-ThreadDataset::convert_to_valuemap(ValueMap &map)
+ThreadDataset::update_valuemap_field(Field field)
 {
-	map.clear();
+	switch (field) {
+	case kFieldActiveTimestamp:
+		mValueMap.erase(kWPANTUNDProperty_DatasetActiveTimestamp);
+		if (mActiveTimestamp.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetActiveTimestamp] = mActiveTimestamp.get();
+		}
+		break;
 
-	if (mActiveTimestamp.has_value()) {
-		map[kWPANTUNDProperty_DatasetActiveTimestamp] = mActiveTimestamp.get();
-	}
+	case kFieldPendingTimestamp:
+		mValueMap.erase(kWPANTUNDProperty_DatasetPendingTimestamp);
+		if (mPendingTimestamp.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetPendingTimestamp] = mPendingTimestamp.get();
+		}
+		break;
 
-	if (mPendingTimestamp.has_value()) {
-		map[kWPANTUNDProperty_DatasetPendingTimestamp] = mPendingTimestamp.get();
-	}
+	case kFieldMasterKey:
+		mValueMap.erase(kWPANTUNDProperty_DatasetMasterKey);
+		if (mMasterKey.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetMasterKey] = mMasterKey.get();
+		}
+		break;
 
-	if (mMasterKey.has_value()) {
-		map[kWPANTUNDProperty_DatasetMasterKey] = mMasterKey.get();
-	}
+	case kFieldNetworkName:
+		mValueMap.erase(kWPANTUNDProperty_DatasetNetworkName);
+		if (mNetworkName.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetNetworkName] = mNetworkName.get();
+		}
+		break;
 
-	if (mNetworkName.has_value()) {
-		map[kWPANTUNDProperty_DatasetNetworkName] = mNetworkName.get();
-	}
+	case kFieldExtendedPanId:
+		mValueMap.erase(kWPANTUNDProperty_DatasetExtendedPanId);
+		if (mExtendedPanId.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetExtendedPanId] = mExtendedPanId.get();
+		}
+		break;
 
-	if (mExtendedPanId.has_value()) {
-		map[kWPANTUNDProperty_DatasetExtendedPanId] = mExtendedPanId.get();
-	}
+	case kFieldMeshLocalPrefix:
+		mValueMap.erase(kWPANTUNDProperty_DatasetMeshLocalPrefix);
+		if (mMeshLocalPrefix.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetMeshLocalPrefix] = any_to_string(mMeshLocalPrefix.get());
+		}
+		break;
 
-	if (mMeshLocalPrefix.has_value()) {
-		map[kWPANTUNDProperty_DatasetMeshLocalPrefix] = any_to_string(mMeshLocalPrefix.get());
-	}
+	case kFieldDelay:
+		mValueMap.erase(kWPANTUNDProperty_DatasetDelay);
+		if (mDelay.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetDelay] = mDelay.get();
+		}
+		break;
 
-	if (mDelay.has_value()) {
-		map[kWPANTUNDProperty_DatasetDelay] = mDelay.get();
-	}
+	case kFieldPanId:
+		mValueMap.erase(kWPANTUNDProperty_DatasetPanId);
+		if (mPanId.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetPanId] = mPanId.get();
+		}
+		break;
 
-	if (mPanId.has_value()) {
-		map[kWPANTUNDProperty_DatasetPanId] = mPanId.get();
-	}
+	case kFieldChannel:
+		mValueMap.erase(kWPANTUNDProperty_DatasetChannel);
+		if (mChannel.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetChannel] = mChannel.get();
+		}
+		break;
 
-	if (mChannel.has_value()) {
-		map[kWPANTUNDProperty_DatasetChannel] = mChannel.get();
-	}
+	case kFieldPSKc:
+		mValueMap.erase(kWPANTUNDProperty_DatasetPSKc);
+		if (mPSKc.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetPSKc] = mPSKc.get();
+		}
+		break;
 
-	if (mPSKc.has_value()) {
-		map[kWPANTUNDProperty_DatasetPSKc] = mPSKc.get();
-	}
+	case kFieldChannelMaskPage0:
+		mValueMap.erase(kWPANTUNDProperty_DatasetChannelMaskPage0);
+		if (mChannelMaskPage0.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetChannelMaskPage0] = mChannelMaskPage0.get();
+		}
+		break;
 
-	if (mChannelMaskPage0.has_value()) {
-		map[kWPANTUNDProperty_DatasetChannelMaskPage0] = mChannelMaskPage0.get();
-	}
+	case kFieldSecurityPolicy:
+		mValueMap.erase(kWPANTUNDProperty_DatasetSecPolicyKeyRotation);
+		mValueMap.erase(kWPANTUNDProperty_DatasetSecPolicyFlags);
+		if (mSecurityPolicy.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetSecPolicyKeyRotation] = mSecurityPolicy.get().mKeyRotationTime;
+			mValueMap[kWPANTUNDProperty_DatasetSecPolicyFlags] = mSecurityPolicy.get().mFlags;
+		}
+		break;
 
-	if (mRawTlvs.has_value()) {
-		map[kWPANTUNDProperty_DatasetRawTlvs] = mRawTlvs.get();
+	case kFieldRawTlvs:
+		mValueMap.erase(kWPANTUNDProperty_DatasetRawTlvs);
+		if (mRawTlvs.has_value()) {
+			mValueMap[kWPANTUNDProperty_DatasetRawTlvs] = mRawTlvs.get();
+		}
+		break;
+
+	case kFieldCount:
+		break;
 	}
+}
+
+const ValueMap &
+ThreadDataset::get_valuemap(void)
+{
+	for (int i = 0; i < kFieldCount; i++) {
+		Field field = static_cast<Field>(i);
+		uint32_t generation = get_field_generation(field);
 
-	if (mSecurityPolicy.has_value()) {
-		map[kWPANTUNDProperty_DatasetSecPolicyKeyRotation] = mSecurityPolicy.get().mKeyRotationTime;
-		map[kWPANTUNDProperty_DatasetSecPolicyFlags] = mSecurityPolicy.get().mFlags;
+		if (mValueMapGeneration[i] != generation) {
+			update_valuemap_field(field);
+			mValueMapGeneration[i] = generation;
+		}
 	}
+
+	return mValueMap;
 }
 
 void
-ThreadDataset::convert_to_string_list(std::list<std::string> &list)
+ThreadDataset::convert_to_valuemap(ValueMap &map)
+{
+	map = get_valuemap();
+}
+
+void
+ThreadDataset::format_field(Field field, std::list<std::string> &lines) const
 {
 	char str[256];
-	list.clear();
 
-	if (mActiveTimestamp.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  0x%08X%08X", kWPANTUNDProperty_DatasetActiveTimestamp,
-			static_cast<uint32_t>(mActiveTimestamp.get() >> 32),
-			static_cast<uint32_t>(mActiveTimestamp.get() & 0xFFFFFFFF));
-		list.push_back(str);
-	}
+	lines.clear();
 
-	if (mPendingTimestamp.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  0x%08X%08X", kWPANTUNDProperty_DatasetPendingTimestamp,
-			static_cast<uint32_t>(mPendingTimestamp.get() >> 32),
-			static_cast<uint32_t>(mPendingTimestamp.get() & 0xFFFFFFFF)
-		);
-		list.push_back(str);
-	}
+	switch (field) {
+	case kFieldActiveTimestamp:
+		if (mActiveTimestamp.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  0x%08X%08X", kWPANTUNDProperty_DatasetActiveTimestamp,
+				static_cast<uint32_t>(mActiveTimestamp.get() >> 32),
+				static_cast<uint32_t>(mActiveTimestamp.get() & 0xFFFFFFFF));
+			lines.push_back(str);
+		}
+		break;
 
-	if (mChannel.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  %d", kWPANTUNDProperty_DatasetChannel, mChannel.get());
-		list.push_back(str);
-	}
+	case kFieldPendingTimestamp:
+		if (mPendingTimestamp.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  0x%08X%08X", kWPANTUNDProperty_DatasetPendingTimestamp,
+				static_cast<uint32_t>(mPendingTimestamp.get() >> 32),
+				static_cast<uint32_t>(mPendingTimestamp.get() & 0xFFFFFFFF)
+			);
+			lines.push_back(str);
+		}
+		break;
 
-	if (mNetworkName.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  \"%s\"", kWPANTUNDProperty_DatasetNetworkName, mNetworkName.get().c_str());
-		list.push_back(str);
-	}
+	case kFieldChannel:
+		if (mChannel.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  %d", kWPANTUNDProperty_DatasetChannel, mChannel.get());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mPanId.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  0x%02X", kWPANTUNDProperty_DatasetPanId, mPanId.get());
-		list.push_back(str);
-	}
+	case kFieldNetworkName:
+		if (mNetworkName.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  \"%s\"", kWPANTUNDProperty_DatasetNetworkName, mNetworkName.get().c_str());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mExtendedPanId.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  0x%s", kWPANTUNDProperty_DatasetExtendedPanId,
-			any_to_string(mExtendedPanId.get()).c_str());
-		list.push_back(str);
-	}
+	case kFieldPanId:
+		if (mPanId.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  0x%02X", kWPANTUNDProperty_DatasetPanId, mPanId.get());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mMasterKey.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  [%s]", kWPANTUNDProperty_DatasetMasterKey,
-			any_to_string(mMasterKey.get()).c_str());
-		list.push_back(str);
-	}
+	case kFieldExtendedPanId:
+		if (mExtendedPanId.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  0x%s", kWPANTUNDProperty_DatasetExtendedPanId,
+				any_to_string(mExtendedPanId.get()).c_str());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mMeshLocalPrefix.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  %s/64", kWPANTUNDProperty_DatasetMeshLocalPrefix,
-			any_to_string(mMeshLocalPrefix.get()).c_str());
-		list.push_back(str);
-	}
+	case kFieldMasterKey:
+		if (mMasterKey.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  [%s]", kWPANTUNDProperty_DatasetMasterKey,
+				any_to_string(mMasterKey.get()).c_str());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mDelay.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  %d", kWPANTUNDProperty_DatasetDelay, mDelay.get());
-		list.push_back(str);
-	}
+	case kFieldMeshLocalPrefix:
+		if (mMeshLocalPrefix.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  %s/64", kWPANTUNDProperty_DatasetMeshLocalPrefix,
+				any_to_string(mMeshLocalPrefix.get()).c_str());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mChannelMaskPage0.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  0x%08X", kWPANTUNDProperty_DatasetChannelMaskPage0,
-			mChannelMaskPage0.get());
-		list.push_back(str);
-	}
+	case kFieldDelay:
+		if (mDelay.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  %d", kWPANTUNDProperty_DatasetDelay, mDelay.get());
+			lines.push_back(str);
+		}
+		break;
+
+	case kFieldChannelMaskPage0:
+		if (mChannelMaskPage0.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  0x%08X", kWPANTUNDProperty_DatasetChannelMaskPage0,
+				mChannelMaskPage0.get());
+			lines.push_back(str);
+		}
+		break;
+
+	case kFieldPSKc:
+		if (mPSKc.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  [%s]", kWPANTUNDProperty_DatasetPSKc, any_to_string(mPSKc.get()).c_str());
+			lines.push_back(str);
+		}
+		break;
 
-	if (mPSKc.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  [%s]", kWPANTUNDProperty_DatasetPSKc, any_to_string(mPSKc.get()).c_str());
-		list.push_back(str);
+	case kFieldSecurityPolicy:
+		if (mSecurityPolicy.has_value()) {
+			snprintf(str, sizeof(str), "%-32s =  %d", kWPANTUNDProperty_DatasetSecPolicyKeyRotation,
+				mSecurityPolicy.get().mKeyRotationTime);
+			lines.push_back(str);
+			snprintf(str, sizeof(str), "%-32s =  0x%0X", kWPANTUNDProperty_DatasetSecPolicyFlags,
+				mSecurityPolicy.get().mFlags);
+			lines.push_back(str);
+		}
+		break;
+
+	case kFieldRawTlvs:
+		if (mRawTlvs.has_value()) {
+			snprintf(
+				str, sizeof(str), "%-32s =  [%s]", kWPANTUNDProperty_DatasetRawTlvs,
+				any_to_string(mRawTlvs.get()).c_str()
+			);
+			lines.push_back(str);
+		}
+		break;
+
+	case kFieldCount:
+		break;
 	}
+}
 
-	if (mSecurityPolicy.has_value()) {
-		snprintf(str, sizeof(str), "%-32s =  %d", kWPANTUNDProperty_DatasetSecPolicyKeyRotation,
-			mSecurityPolicy.get().mKeyRotationTime);
-		list.push_back(str);
-		snprintf(str, sizeof(str), "%-32s =  0x%0X", kWPANTUNDProperty_DatasetSecPolicyFlags,
-			mSecurityPolicy.get().mFlags);
-		list.push_back(str);
+const std::list<std::string> &
+ThreadDataset::get_string_list(void)
+{
+	// The order the fields are listed in, which is not the frame order.
+	static const Field kListOrder[kFieldCount] = {
+		kFieldActiveTimestamp,
+		kFieldPendingTimestamp,
+		kFieldChannel,
+		kFieldNetworkName,
+		kFieldPanId,
+		kFieldExtendedPanId,
+		kFieldMasterKey,
+		kFieldMeshLocalPrefix,
+		kFieldDelay,
+		kFieldChannelMaskPage0,
+		kFieldPSKc,
+		kFieldSecurityPolicy,
+		kFieldRawTlvs,
+	};
+	bool changed = false;
+
+	for (int i = 0; i < kFieldCount; i++) {
+		Field field = static_cast<Field>(i);
+		uint32_t generation = get_field_generation(field);
+
+		if (mStringListGeneration[i] != generation) {
+			format_field(field, mStringLines[i]);
+			mStringListGeneration[i] = generation;
+			changed = true;
+		}
 	}
 
-	if (mRawTlvs.has_value()) {
-		snprintf(
-			str, sizeof(str), "%-32s =  [%s]", kWPANTUNDProperty_DatasetRawTlvs,
-			any_to_string(mRawTlvs.get()).c_str()
-		);
-		list.push_back(str);
+	if (changed) {
+		mStringList.clear();
+
+		for (int i = 0; i < kFieldCount; i++) {
+			const std::list<std::string> &lines = mStringLines[kListOrder[i]];
+			mStringList.insert(mStringList.end(), lines.begin(), lines.end());
+		}
 	}
+
+	return mStringList;
+}
+
+void
+ThreadDataset::convert_to_string_list(std::list<std::string> &list)
+{
+	list = get_string_list();
 }
 
 int
 ThreadDataset::set_from_spinel_frame(const uint8_t *data_in, spinel_size_t data_len)
 {
 	int ret = kWPANTUNDStatus_Ok;
+	bool unchanged = (mParsedFrame.size() == data_len)
+		&& (0 == memcmp(mParsedFrame.data(), data_in, data_len));
+
+	for (int i = 0; unchanged && (i < kFieldCount); i++) {
+		unchanged = (mParsedGeneration[i] == get_field_generation(static_cast<Field>(i)));
+	}
+
+	require_quiet(!unchanged, bail);
 
 	clear();
+	mParsedFrame = Data(data_in, data_len);
 
 	while (data_len > 0) {
 		spinel_ssize_t len = 0;
@@ -231,6 +422,13 @@ bail:
 
 	if (ret != kWPANTUNDStatus_Ok) {
 		clear();
+		mParsedFrame.clear();
+	}
+
+	if (!unchanged) {
+		for (int i = 0; i < kFieldCount; i++) {
+			mParsedGeneration[i] = get_field_generation(static_cast<Field>(i));
+		}
 	}
 
 	return ret;
@@ -451,168 +649,244 @@ bail:
 }
 
 void
-ThreadDataset::convert_to_spinel_frame(Data &frame)
+ThreadDataset::encode_field(Field field, Data &entry) const
 {
-	frame.clear();
-
-	if (mActiveTimestamp.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UINT64_S
-			),
-			SPINEL_PROP_DATASET_ACTIVE_TIMESTAMP,
-			mActiveTimestamp.get()
-		));
-	}
+	entry.clear();
 
-	if (mPendingTimestamp.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UINT64_S
-			),
-			SPINEL_PROP_DATASET_PENDING_TIMESTAMP,
-			mPendingTimestamp.get()
-		));
-	}
+	switch (field) {
 
-	if (mMasterKey.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_DATA_S
-			),
-			SPINEL_PROP_NET_MASTER_KEY,
-			mMasterKey.get().data(),
-			mMasterKey.get().size()
-		));
-	}
+	case kFieldActiveTimestamp:
+		if (mActiveTimestamp.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UINT64_S
+				),
+				SPINEL_PROP_DATASET_ACTIVE_TIMESTAMP,
+				mActiveTimestamp.get()
+			);
+		}
+		break;
 
-	if (mNetworkName.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UTF8_S
-			),
-			SPINEL_PROP_NET_NETWORK_NAME,
-			mNetworkName.get().c_str()
-		));
-	}
+	case kFieldPendingTimestamp:
+		if (mPendingTimestamp.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UINT64_S
+				),
+				SPINEL_PROP_DATASET_PENDING_TIMESTAMP,
+				mPendingTimestamp.get()
+			);
+		}
+		break;
 
-	if (mExtendedPanId.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_DATA_S
-			),
-			SPINEL_PROP_NET_XPANID,
-			mExtendedPanId.get().data(),
-			mExtendedPanId.get().size()
-		));
-	}
+	case kFieldMasterKey:
+		if (mMasterKey.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_DATA_S
+				),
+				SPINEL_PROP_NET_MASTER_KEY,
+				mMasterKey.get().data(),
+				mMasterKey.get().size()
+			);
+		}
+		break;
 
-	if (mMeshLocalPrefix.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_IPv6ADDR_S
-				SPINEL_DATATYPE_UINT8_S
-			),
-			SPINEL_PROP_IPV6_ML_PREFIX,
-			&mMeshLocalPrefix.get(),
-			kMeshLocalPrefixLen
-		));
-	}
+	case kFieldNetworkName:
+		if (mNetworkName.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UTF8_S
+				),
+				SPINEL_PROP_NET_NETWORK_NAME,
+				mNetworkName.get().c_str()
+			);
+		}
+		break;
 
-	if (mDelay.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UINT32_S
-			),
-			SPINEL_PROP_DATASET_DELAY_TIMER,
-			mDelay.get()
-		));
-	}
+	case kFieldExtendedPanId:
+		if (mExtendedPanId.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_DATA_S
+				),
+				SPINEL_PROP_NET_XPANID,
+				mExtendedPanId.get().data(),
+				mExtendedPanId.get().size()
+			);
+		}
+		break;
 
-	if (mPanId.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UINT16_S
-			),
-			SPINEL_PROP_MAC_15_4_PANID,
-			mPanId.get()
-		));
-	}
+	case kFieldMeshLocalPrefix:
+		if (mMeshLocalPrefix.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_IPv6ADDR_S
+					SPINEL_DATATYPE_UINT8_S
+				),
+				SPINEL_PROP_IPV6_ML_PREFIX,
+				&mMeshLocalPrefix.get(),
+				kMeshLocalPrefixLen
+			);
+		}
+		break;
 
-	if (mChannel.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UINT8_S
-			),
-			SPINEL_PROP_PHY_CHAN,
-			mChannel.get()
-		));
-	}
+	case kFieldDelay:
+		if (mDelay.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UINT32_S
+				),
+				SPINEL_PROP_DATASET_DELAY_TIMER,
+				mDelay.get()
+			);
+		}
+		break;
 
-	if (mPSKc.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_DATA_S
-			),
-			SPINEL_PROP_NET_PSKC,
-			mPSKc.get().data(),
-			mPSKc.get().size()
-		));
-	}
+	case kFieldPanId:
+		if (mPanId.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UINT16_S
+				),
+				SPINEL_PROP_MAC_15_4_PANID,
+				mPanId.get()
+			);
+		}
+		break;
+
+	case kFieldChannel:
+		if (mChannel.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UINT8_S
+				),
+				SPINEL_PROP_PHY_CHAN,
+				mChannel.get()
+			);
+		}
+		break;
+
+	case kFieldPSKc:
+		if (mPSKc.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_DATA_S
+				),
+				SPINEL_PROP_NET_PSKC,
+				mPSKc.get().data(),
+				mPSKc.get().size()
+			);
+		}
+		break;
 
-	if (mChannelMaskPage0.has_value()) {
-		uint8_t mask_data[32];
-		uint8_t mask_len = 0;
+	case kFieldChannelMaskPage0:
+		if (mChannelMaskPage0.has_value()) {
+			uint8_t mask_data[32];
+			uint8_t mask_len = 0;
 
-		for (uint8_t i = 0; i < 32; i++) {
-			if (mChannelMaskPage0.get() & (1U << i)) {
-				mask_data[mask_len++] = i;
+			for (uint8_t i = 0; i < 32; i++) {
+				if (mChannelMaskPage0.get() & (1U << i)) {
+					mask_data[mask_len++] = i;
+				}
 			}
+
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_DATA_S
+				),
+				SPINEL_PROP_PHY_CHAN_SUPPORTED,
+				mask_data,
+				mask_len
+			);
 		}
+		break;
 
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_DATA_S
-			),
-			SPINEL_PROP_PHY_CHAN_SUPPORTED,
-			mask_data,
-			mask_len
-		));
-	}
+	case kFieldSecurityPolicy:
+		if (mSecurityPolicy.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_UINT16_S
+					SPINEL_DATATYPE_UINT8_S
+				),
+				SPINEL_PROP_DATASET_SECURITY_POLICY,
+				mSecurityPolicy.get().mKeyRotationTime,
+				mSecurityPolicy.get().mFlags
+			);
+		}
+		break;
 
-	if (mSecurityPolicy.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_UINT16_S
-				SPINEL_DATATYPE_UINT8_S
-			),
-			SPINEL_PROP_DATASET_SECURITY_POLICY,
-			mSecurityPolicy.get().mKeyRotationTime,
-			mSecurityPolicy.get().mFlags
-		));
+	case kFieldRawTlvs:
+		if (mRawTlvs.has_value()) {
+			entry = SpinelPackData(
+				SPINEL_DATATYPE_STRUCT_S(
+					SPINEL_DATATYPE_UINT_PACKED_S
+					SPINEL_DATATYPE_DATA_S
+				),
+				SPINEL_PROP_DATASET_RAW_TLVS,
+				mRawTlvs.get().data(),
+				mRawTlvs.get().size()
+			);
+		}
+		break;
+
+	case kFieldCount:
+		break;
 	}
+}
+
+const Data &
+ThreadDataset::get_spinel_frame(void)
+{
+	Data entry;
+	long shift = 0;
+
+	for (int i = 0; i < kFieldCount; i++) {
+		Field field = static_cast<Field>(i);
+		uint32_t generation = get_field_generation(field);
+		Data::iterator pos;
+
+		mFrameOffset[i] += shift;
+
+		if (mFrameGeneration[i] == generation) {
+			continue;
+		}
+
+		// Splice the new entry over the old one, leaving the
+		// rest of the frame as it is.
+		encode_field(field, entry);
+		pos = mFrame.begin() + mFrameOffset[i];
+
+		if (entry.size() <= mFrameLength[i]) {
+			std::copy(entry.begin(), entry.end(), pos);
+			mFrame.erase(pos + entry.size(), pos + mFrameLength[i]);
+		} else {
+			std::copy(entry.begin(), entry.begin() + mFrameLength[i], pos);
+			mFrame.insert(pos + mFrameLength[i], entry.begin() + mFrameLength[i], entry.end());
+		}
 
-	if (mRawTlvs.has_value()) {
-		frame.append(SpinelPackData(
-			SPINEL_DATATYPE_STRUCT_S(
-				SPINEL_DATATYPE_UINT_PACKED_S
-				SPINEL_DATATYPE_DATA_S
-			),
-			SPINEL_PROP_DATASET_RAW_TLVS,
-			mRawTlvs.get().data(),
-			mRawTlvs.get().size()
-		));
+		shift += static_cast<long>(entry.size()) - static_cast<long>(mFrameLength[i]);
+		mFrameLength[i] = static_cast<uint32_t>(entry.size());
+		mFrameGeneration[i] = generation;
 	}
+
+	return mFrame;
+}
+
+void
+ThreadDataset::convert_to_spinel_frame(Data &frame)
+{
+	frame = get_spinel_frame();
 }
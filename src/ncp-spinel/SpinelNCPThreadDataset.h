@@ -36,17 +36,22 @@ public:
 	struct Optional
 	{
 	public:
-		Optional(void): mValue(), mHasValue(false) { }
+		Optional(void): mValue(), mHasValue(false), mGeneration(0) { }
 
-		void clear(void) { mHasValue = false; }
+		void clear(void) { if (mHasValue) { mHasValue = false; mGeneration++; } }
 		bool has_value(void) const { return mHasValue; }
 		const Type &get(void) const { return mValue; }
-		void set(const Type &value) { mValue = value; mHasValue = true; }
+		void set(const Type &value) { mValue = value; mHasValue = true; mGeneration++; }
 		void operator=(const Type &value) { set(value); }
 
+		// Changes every time the value is set or cleared, so that the
+		// cached encodings can tell which of their entries are stale.
+		uint32_t get_generation(void) const { return mGeneration; }
+
 	private:
 		Type mValue;
 		bool mHasValue;
+		uint32_t mGeneration;
 	};
 
 	struct SecurityPolicy {
@@ -54,13 +59,23 @@ public:
 		uint8_t  mFlags;
 	};
 
-	ThreadDataset(void) { clear(); }
+	ThreadDataset(void);
 
 	void clear(void);
 
+	// The encodings below are cached, along with the generation of
+	// each field they were built from. Only the entries of fields
+	// which changed since the last call are encoded again, and they
+	// are patched into the cached encoding in place.
+	const ValueMap &get_valuemap(void);
+	const std::list<std::string> &get_string_list(void);
+	const Data &get_spinel_frame(void);
+
 	void convert_to_valuemap(ValueMap &map);
 	void convert_to_string_list(std::list<std::string> &list);
 
+	// Parsing the same frame again, with no field changed since it
+	// was last parsed, is skipped.
 	int  set_from_spinel_frame(const uint8_t *data_in, spinel_size_t data_len);
 	void convert_to_spinel_frame(Data &frame);
 
@@ -85,7 +100,47 @@ private:
 		kMeshLocalPrefixLen = 64,
 	};
 
+	// In the order their entries appear in the spinel frame.
+	enum Field
+	{
+		kFieldActiveTimestamp,
+		kFieldPendingTimestamp,
+		kFieldMasterKey,
+		kFieldNetworkName,
+		kFieldExtendedPanId,
+		kFieldMeshLocalPrefix,
+		kFieldDelay,
+		kFieldPanId,
+		kFieldChannel,
+		kFieldPSKc,
+		kFieldChannelMaskPage0,
+		kFieldSecurityPolicy,
+		kFieldRawTlvs,
+
+		kFieldCount
+	};
+
+	uint32_t get_field_generation(Field field) const;
+	void encode_field(Field field, Data &entry) const;
+	void update_valuemap_field(Field field);
+	void format_field(Field field, std::list<std::string> &lines) const;
+
 	int parse_dataset_entry(const uint8_t *data_in, spinel_size_t data_len);
+
+	Data mFrame;
+	uint32_t mFrameOffset[kFieldCount];
+	uint32_t mFrameLength[kFieldCount];
+	uint32_t mFrameGeneration[kFieldCount];
+
+	ValueMap mValueMap;
+	uint32_t mValueMapGeneration[kFieldCount];
+
+	std::list<std::string> mStringList;
+	std::list<std::string> mStringLines[kFieldCount];
+	uint32_t mStringListGeneration[kFieldCount];
+
+	Data mParsedFrame;
+	uint32_t mParsedGeneration[kFieldCount];
 };
 
 }; // namespace wpantund
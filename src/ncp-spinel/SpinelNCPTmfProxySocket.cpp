@@ -0,0 +1,458 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef ASSERT_MACROS_USE_SYSLOG
+#define ASSERT_MACROS_USE_SYSLOG 1
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "assert-macros.h"
+#include "SpinelNCPTmfProxySocket.h"
+#include "SpinelNCPInstance.h"
+#include "SpinelNCPTaskSendCommand.h"
+#include "spinel-extra.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+// Size of the locator and port which follow the payload of a datagram
+#define TMF_PROXY_TRAILER_SIZE      4
+
+static void
+pack_trailer(uint8_t trailer[TMF_PROXY_TRAILER_SIZE], uint16_t locator, uint16_t port)
+{
+	trailer[0] = static_cast<uint8_t>(locator >> 8);
+	trailer[1] = static_cast<uint8_t>(locator & 0xff);
+	trailer[2] = static_cast<uint8_t>(port >> 8);
+	trailer[3] = static_cast<uint8_t>(port & 0xff);
+}
+
+SpinelNCPTmfProxySocket::SpinelNCPTmfProxySocket(SpinelNCPInstance* instance):
+	mInstance(instance),
+	mListenFD(-1),
+	mClientFD(-1),
+	mInFlight(0),
+	mMalformed(0)
+{
+	memset(&mOtherCounters, 0, sizeof(mOtherCounters));
+}
+
+SpinelNCPTmfProxySocket::~SpinelNCPTmfProxySocket()
+{
+	close();
+}
+
+int
+SpinelNCPTmfProxySocket::open(const std::string& socket_path)
+{
+	struct sockaddr_un addr;
+	int ret = 0;
+
+	close();
+
+	require_action(socket_path.size() < sizeof(addr.sun_path), bail, ret = -ENAMETOOLONG);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+	mListenFD = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	require_action(mListenFD >= 0, bail, ret = -errno);
+
+	fcntl(mListenFD, F_SETFL, fcntl(mListenFD, F_GETFL) | O_NONBLOCK);
+	fcntl(mListenFD, F_SETFD, FD_CLOEXEC);
+
+	// Remove whatever a previous instance left behind.
+	unlink(socket_path.c_str());
+
+	require_action(bind(mListenFD, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0, bail, ret = -errno);
+
+	// Same audience as the D-Bus policy: root and the wpantund group.
+	chmod(socket_path.c_str(), 0660);
+
+	require_action(listen(mListenFD, 1) == 0, bail, ret = -errno);
+
+	mSocketPath = socket_path;
+
+	syslog(LOG_NOTICE, "TmfProxy: Using socket \"%s\"", socket_path.c_str());
+
+bail:
+	if ((ret != 0) && (mListenFD >= 0)) {
+		::close(mListenFD);
+		mListenFD = -1;
+	}
+
+	return ret;
+}
+
+void
+SpinelNCPTmfProxySocket::close(void)
+{
+	close_client("socket closed");
+
+	if (mListenFD >= 0) {
+		::close(mListenFD);
+		mListenFD = -1;
+		unlink(mSocketPath.c_str());
+		mSocketPath.clear();
+	}
+}
+
+bool
+SpinelNCPTmfProxySocket::is_open(void) const
+{
+	return mListenFD >= 0;
+}
+
+bool
+SpinelNCPTmfProxySocket::has_client(void) const
+{
+	return mClientFD >= 0;
+}
+
+SpinelNCPTmfProxySocket::Counters&
+SpinelNCPTmfProxySocket::get_counters(uint16_t locator)
+{
+	std::map<uint16_t, Counters>::iterator iter = mCounters.find(locator);
+
+	if (iter == mCounters.end()) {
+		Counters counters;
+
+		if (mCounters.size() >= TMF_PROXY_SOCKET_MAX_LOCATORS) {
+			return mOtherCounters;
+		}
+
+		memset(&counters, 0, sizeof(counters));
+		iter = mCounters.insert(std::make_pair(locator, counters)).first;
+	}
+
+	return iter->second;
+}
+
+void
+SpinelNCPTmfProxySocket::accept_client(void)
+{
+	int fd;
+
+	while ((fd = accept(mListenFD, NULL, NULL)) >= 0) {
+		if (mClientFD >= 0) {
+			close_client("replaced by a new client");
+		}
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+		mClientFD = fd;
+
+		syslog(LOG_INFO, "TmfProxy: Client connected on FD%d", fd);
+	}
+}
+
+void
+SpinelNCPTmfProxySocket::close_client(const char* reason)
+{
+	if (mClientFD >= 0) {
+		syslog(LOG_INFO, "TmfProxy: Closing client on FD%d: %s", mClientFD, reason);
+		::close(mClientFD);
+		mClientFD = -1;
+	}
+
+	// Whatever was held for the client is lost with it.
+	while (!mQueue.empty()) {
+		const Data& datagram = mQueue.front();
+
+		get_counters(static_cast<uint16_t>((datagram[datagram.size() - 4] << 8) | datagram[datagram.size() - 3])).mRxDropped++;
+		mQueue.pop_front();
+	}
+}
+
+int
+SpinelNCPTmfProxySocket::send_to_client(const uint8_t* frame_ptr, unsigned int frame_len, const uint8_t trailer[TMF_PROXY_TRAILER_SIZE])
+{
+	struct iovec iov[2];
+	struct msghdr msg;
+	ssize_t len;
+
+	iov[0].iov_base = const_cast<uint8_t*>(frame_ptr);
+	iov[0].iov_len = frame_len;
+	iov[1].iov_base = const_cast<uint8_t*>(trailer);
+	iov[1].iov_len = TMF_PROXY_TRAILER_SIZE;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	len = sendmsg(mClientFD, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+	if (len < 0) {
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR) || (errno == ENOBUFS)) {
+			return 0;
+		}
+
+		close_client(strerror(errno));
+		return -1;
+	}
+
+	return 1;
+}
+
+bool
+SpinelNCPTmfProxySocket::handle_frame_from_ncp(const uint8_t* frame_ptr, unsigned int frame_len, uint16_t locator, uint16_t port)
+{
+	uint8_t trailer[TMF_PROXY_TRAILER_SIZE];
+	Counters* counters;
+
+	if (mClientFD < 0) {
+		return false;
+	}
+
+	pack_trailer(trailer, locator, port);
+	counters = &get_counters(locator);
+
+	// Keep the order: nothing goes out directly while older datagrams wait.
+	if (mQueue.empty()) {
+		int sent = send_to_client(frame_ptr, frame_len, trailer);
+
+		if (sent > 0) {
+			counters->mRxFrames++;
+			counters->mRxBytes += frame_len;
+			return true;
+
+		} else if (sent < 0) {
+			counters->mRxDropped++;
+			return true;
+		}
+	}
+
+	if (mQueue.size() >= TMF_PROXY_SOCKET_QUEUE_SIZE) {
+		counters->mRxDropped++;
+
+	} else {
+		mQueue.push_back(Data(frame_ptr, frame_len));
+		mQueue.back().append(trailer, sizeof(trailer));
+	}
+
+	return true;
+}
+
+void
+SpinelNCPTmfProxySocket::flush_queue(void)
+{
+	while ((mClientFD >= 0) && !mQueue.empty()) {
+		const Data& datagram = mQueue.front();
+		const unsigned int frame_len = static_cast<unsigned int>(datagram.size() - TMF_PROXY_TRAILER_SIZE);
+		const uint8_t* trailer = datagram.data() + frame_len;
+		uint16_t locator = static_cast<uint16_t>((trailer[0] << 8) | trailer[1]);
+		int sent = send_to_client(datagram.data(), frame_len, trailer);
+
+		if (sent == 0) {
+			break;
+		}
+
+		if (sent > 0) {
+			Counters& counters = get_counters(locator);
+
+			counters.mRxFrames++;
+			counters.mRxBytes += frame_len;
+			mQueue.pop_front();
+		}
+	}
+}
+
+void
+SpinelNCPTmfProxySocket::send_did_finish(uint16_t locator, unsigned int frame_len, int status)
+{
+	Counters& counters = get_counters(locator);
+
+	mInFlight--;
+
+	if (status == kWPANTUNDStatus_Ok) {
+		counters.mTxFrames++;
+		counters.mTxBytes += frame_len;
+	} else {
+		counters.mTxFailed++;
+	}
+}
+
+void
+SpinelNCPTmfProxySocket::read_from_client(void)
+{
+	uint8_t buffer[SPINEL_FRAME_MAX_SIZE];
+
+	// Datagrams we don't read stay in the socket buffer, which is what
+	// eventually makes the client block.
+	while ((mClientFD >= 0) && (mInFlight < TMF_PROXY_SOCKET_MAX_IN_FLIGHT)) {
+		ssize_t len = recv(mClientFD, buffer, sizeof(buffer), MSG_TRUNC | MSG_DONTWAIT);
+		unsigned int frame_len;
+		uint16_t locator;
+		uint16_t port;
+
+		if (len == 0) {
+			close_client("disconnected");
+			break;
+		}
+
+		if (len < 0) {
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+				close_client(strerror(errno));
+			}
+			break;
+		}
+
+		if ((len <= TMF_PROXY_TRAILER_SIZE) || (len > static_cast<ssize_t>(sizeof(buffer)))) {
+			syslog(LOG_WARNING, "TmfProxy: Dropping datagram of %d bytes from client", static_cast<int>(len));
+			mMalformed++;
+			continue;
+		}
+
+		frame_len = static_cast<unsigned int>(len - TMF_PROXY_TRAILER_SIZE);
+		locator = static_cast<uint16_t>((buffer[frame_len] << 8) | buffer[frame_len + 1]);
+		port = static_cast<uint16_t>((buffer[frame_len + 2] << 8) | buffer[frame_len + 3]);
+
+		mInFlight++;
+
+		mInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(mInstance)
+			.set_callback(CallbackWithStatus(boost::bind(&SpinelNCPTmfProxySocket::send_did_finish, this, locator, frame_len, _1)))
+			.add_packed_command(
+				SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_WLEN_S SPINEL_DATATYPE_UINT16_S SPINEL_DATATYPE_UINT16_S),
+				SPINEL_PROP_THREAD_TMF_PROXY_STREAM,
+				buffer,
+				frame_len,
+				locator,
+				port
+			)
+			.finish()
+		);
+	}
+}
+
+int
+SpinelNCPTmfProxySocket::update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout)
+{
+	(void)error_fd_set;
+	(void)timeout;
+
+	if (mListenFD < 0) {
+		return 0;
+	}
+
+	if (read_fd_set != NULL) {
+		FD_SET(mListenFD, read_fd_set);
+	}
+
+	if (max_fd != NULL) {
+		*max_fd = std::max(*max_fd, mListenFD);
+	}
+
+	if (mClientFD >= 0) {
+		if ((read_fd_set != NULL) && (mInFlight < TMF_PROXY_SOCKET_MAX_IN_FLIGHT)) {
+			FD_SET(mClientFD, read_fd_set);
+		}
+
+		if ((write_fd_set != NULL) && !mQueue.empty()) {
+			FD_SET(mClientFD, write_fd_set);
+		}
+
+		if (max_fd != NULL) {
+			*max_fd = std::max(*max_fd, mClientFD);
+		}
+	}
+
+	return 0;
+}
+
+void
+SpinelNCPTmfProxySocket::process(void)
+{
+	if (mListenFD < 0) {
+		return;
+	}
+
+	accept_client();
+	flush_queue();
+	read_from_client();
+}
+
+void
+SpinelNCPTmfProxySocket::get_counters_as_string_list(std::list<std::string>& list) const
+{
+	std::map<uint16_t, Counters>::const_iterator iter;
+	char c_string[200];
+
+	snprintf(
+		c_string,
+		sizeof(c_string),
+		"Client: %s, %d queued, %d in flight, %u malformed",
+		(mClientFD >= 0) ? "connected" : "none",
+		static_cast<int>(mQueue.size()),
+		mInFlight,
+		mMalformed
+	);
+	list.push_back(c_string);
+
+	for (iter = mCounters.begin(); iter != mCounters.end(); ++iter) {
+		const Counters& counters = iter->second;
+
+		snprintf(
+			c_string,
+			sizeof(c_string),
+			"Locator 0x%04X: RX %u frames %u bytes %u dropped, TX %u frames %u bytes %u failed",
+			iter->first,
+			counters.mRxFrames,
+			counters.mRxBytes,
+			counters.mRxDropped,
+			counters.mTxFrames,
+			counters.mTxBytes,
+			counters.mTxFailed
+		);
+		list.push_back(c_string);
+	}
+
+	if (mCounters.size() >= TMF_PROXY_SOCKET_MAX_LOCATORS) {
+		snprintf(
+			c_string,
+			sizeof(c_string),
+			"Other locators: RX %u frames %u bytes %u dropped, TX %u frames %u bytes %u failed",
+			mOtherCounters.mRxFrames,
+			mOtherCounters.mRxBytes,
+			mOtherCounters.mRxDropped,
+			mOtherCounters.mTxFrames,
+			mOtherCounters.mTxBytes,
+			mOtherCounters.mTxFailed
+		);
+		list.push_back(c_string);
+	}
+}
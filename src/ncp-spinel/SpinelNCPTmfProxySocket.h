@@ -0,0 +1,126 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Local datagram socket carrying TMF proxy traffic between a
+ *      client (typically a border agent) and the NCP, without going
+ *      through D-Bus.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPTmfProxySocket__
+#define __wpantund__SpinelNCPTmfProxySocket__
+
+#include <stdint.h>
+#include <sys/select.h>
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include "Data.h"
+#include "time-utils.h"
+
+namespace nl {
+namespace wpantund {
+
+// Number of datagrams held for a client which doesn't read fast enough
+#define TMF_PROXY_SOCKET_QUEUE_SIZE             16
+
+// Number of datagrams from the client which may be on their way to the
+// NCP. The client isn't read from while that many are outstanding.
+#define TMF_PROXY_SOCKET_MAX_IN_FLIGHT          4
+
+// Number of locators with counters of their own
+#define TMF_PROXY_SOCKET_MAX_LOCATORS           32
+
+class SpinelNCPInstance;
+
+// Serves `Config:TmfProxy:SocketPath`, a `SOCK_SEQPACKET` socket on
+// which each datagram is one TMF proxy frame in the same format as
+// `TmfProxy:Stream`: the payload, then the locator and the port (both
+// big endian).
+//
+// A single client is served at a time, a new connection replaces the
+// previous one. While a client is connected, frames from the NCP are
+// sent to it instead of being signaled as `TmfProxy:Stream`.
+class SpinelNCPTmfProxySocket
+{
+public:
+	SpinelNCPTmfProxySocket(SpinelNCPInstance* instance);
+	~SpinelNCPTmfProxySocket();
+
+	// Returns zero on success, or a negative errno value.
+	int open(const std::string& socket_path);
+	void close(void);
+
+	bool is_open(void) const;
+	bool has_client(void) const;
+
+	// Returns false if there is no client to take the frame, in which
+	// case the caller should signal it the usual way.
+	bool handle_frame_from_ncp(const uint8_t* frame_ptr, unsigned int frame_len, uint16_t locator, uint16_t port);
+
+	int update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout);
+	void process(void);
+
+	void get_counters_as_string_list(std::list<std::string>& list) const;
+
+private:
+	struct Counters
+	{
+		uint32_t mRxFrames;         //!< Delivered to the client
+		uint32_t mRxBytes;
+		uint32_t mRxDropped;        //!< Client queue full
+		uint32_t mTxFrames;         //!< Accepted by the NCP
+		uint32_t mTxBytes;
+		uint32_t mTxFailed;
+	};
+
+	Counters& get_counters(uint16_t locator);
+
+	void accept_client(void);
+	void close_client(const char* reason);
+	void read_from_client(void);
+	void flush_queue(void);
+
+	// Returns 1 if sent, 0 if the client can't take it right now and
+	// -1 if the client was closed.
+	int send_to_client(const uint8_t* frame_ptr, unsigned int frame_len, const uint8_t trailer[4]);
+
+	void send_did_finish(uint16_t locator, unsigned int frame_len, int status);
+
+private:
+	SpinelNCPInstance* mInstance;
+
+	std::string mSocketPath;
+	int mListenFD;
+	int mClientFD;
+
+	// Datagrams (trailer included) waiting for the client to be writable.
+	std::deque<Data> mQueue;
+
+	int mInFlight;
+	uint32_t mMalformed;
+
+	std::map<uint16_t, Counters> mCounters;
+	Counters mOtherCounters;    //!< Locators beyond `TMF_PROXY_SOCKET_MAX_LOCATORS`
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPTmfProxySocket__) */
@@ -0,0 +1,337 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include "SpinelNCPTopologyCache.h"
+#include "wpan-properties.h"
+#include "string-utils.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+static uint64_t
+ext_address_to_uint64(const uint8_t ext_address[8])
+{
+	uint64_t addr = 0;
+
+	for (int i = 0; i < 8; i++) {
+		addr = (addr << 8) | ext_address[i];
+	}
+
+	return addr;
+}
+
+std::string
+SpinelNCPTopologyCache::Change::get_as_string(void) const
+{
+	char c_string[120];
+	const char *change_str = "";
+	const char *table_str = "";
+	int len;
+
+	switch (mChangeType) {
+	case kChangeJoined:      change_str = "Joined";      break;
+	case kChangeLeft:        change_str = "Left";        break;
+	case kChangeLinkQuality: change_str = "LinkQuality"; break;
+	}
+
+	switch (mTableType) {
+	case SpinelNCPTaskGetNetworkTopology::kChildTable:    table_str = "child";    break;
+	case SpinelNCPTaskGetNetworkTopology::kNeighborTable: table_str = "neighbor"; break;
+	case SpinelNCPTaskGetNetworkTopology::kRouterTable:   table_str = "router";   break;
+	default:                                              table_str = "?";        break;
+	}
+
+	len = snprintf(c_string, sizeof(c_string),
+		"%s: %s %02X%02X%02X%02X%02X%02X%02X%02X, RLOC16:%04x",
+		change_str,
+		table_str,
+		mExtAddress[0], mExtAddress[1], mExtAddress[2], mExtAddress[3],
+		mExtAddress[4], mExtAddress[5], mExtAddress[6], mExtAddress[7],
+		mRloc16
+	);
+
+	if ((len > 0) && (len < static_cast<int>(sizeof(c_string)))) {
+		if (mChangeType == kChangeLinkQuality) {
+			snprintf(c_string + len, sizeof(c_string) - len, ", LQIn:%d->%d", mOldLinkQuality, mNewLinkQuality);
+		} else if (mChangeType == kChangeJoined) {
+			snprintf(c_string + len, sizeof(c_string) - len, ", LQIn:%d", mNewLinkQuality);
+		}
+	}
+
+	return std::string(c_string);
+}
+
+SpinelNCPTopologyCache::SpinelNCPTopologyCache()
+{
+	invalidate();
+}
+
+SpinelNCPTopologyCache::CachedTable*
+SpinelNCPTopologyCache::find_table(Type type)
+{
+	CachedTable* ret = NULL;
+
+	switch (type) {
+	case SpinelNCPTaskGetNetworkTopology::kChildTable:    ret = &mChildTable;    break;
+	case SpinelNCPTaskGetNetworkTopology::kNeighborTable: ret = &mNeighborTable; break;
+	case SpinelNCPTaskGetNetworkTopology::kRouterTable:   ret = &mRouterTable;   break;
+	default:                                              ret = NULL;            break;
+	}
+
+	return ret;
+}
+
+const SpinelNCPTopologyCache::CachedTable*
+SpinelNCPTopologyCache::find_table(Type type) const
+{
+	return const_cast<SpinelNCPTopologyCache*>(this)->find_table(type);
+}
+
+void
+SpinelNCPTopologyCache::invalidate(void)
+{
+	CachedTable* tables[] = { &mChildTable, &mNeighborTable, &mRouterTable };
+
+	for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+		tables[i]->mValid = false;
+		tables[i]->mTable.clear();
+		tables[i]->mFormatted[0] = tables[i]->mFormatted[1] = false;
+		tables[i]->mFormattedTable[0] = tables[i]->mFormattedTable[1] = boost::any();
+	}
+}
+
+bool
+SpinelNCPTopologyCache::is_valid(Type type) const
+{
+	const CachedTable* cached = find_table(type);
+
+	return (cached != NULL) && cached->mValid;
+}
+
+bool
+SpinelNCPTopologyCache::same_node(const TableEntry& lhs, const TableEntry& rhs)
+{
+	return memcmp(lhs.mExtAddress, rhs.mExtAddress, sizeof(lhs.mExtAddress)) == 0;
+}
+
+uint8_t
+SpinelNCPTopologyCache::link_quality_of(const TableEntry& entry)
+{
+	// Router table entries stick around after the link to that
+	// router is gone, their link quality is then meaningless.
+	if ((entry.mType == SpinelNCPTaskGetNetworkTopology::kRouterTable) && !entry.mLinkEstablished) {
+		return 0;
+	}
+
+	return entry.mLinkQualityIn;
+}
+
+void
+SpinelNCPTopologyCache::add_change(ChangeType change_type, const TableEntry& entry, uint8_t old_link_quality, std::list<std::string>& changes)
+{
+	Change change;
+
+	change.mChangeType = change_type;
+	change.mTableType = entry.mType;
+	memcpy(change.mExtAddress, entry.mExtAddress, sizeof(change.mExtAddress));
+	change.mRloc16 = entry.mRloc16;
+	change.mOldLinkQuality = old_link_quality;
+	change.mNewLinkQuality = link_quality_of(entry);
+
+	changes.push_back(change.get_as_string());
+	mChangeHistory.push_back(changes.back());
+
+	if (mChangeHistory.size() > TOPOLOGY_CACHE_CHANGE_HISTORY_SIZE) {
+		mChangeHistory.pop_front();
+	}
+}
+
+void
+SpinelNCPTopologyCache::update_table(Type type, const Table& table, std::list<std::string>& changes)
+{
+	CachedTable* cached = find_table(type);
+	std::map<uint64_t, const TableEntry*> old_entries;
+	std::map<uint64_t, const TableEntry*>::iterator old_iter;
+	Table::const_iterator iter;
+
+	if (cached == NULL) {
+		return;
+	}
+
+	if (cached->mValid) {
+		if (cached->mTable == table) {
+			return;
+		}
+
+		for (iter = cached->mTable.begin(); iter != cached->mTable.end(); ++iter) {
+			old_entries[ext_address_to_uint64(iter->mExtAddress)] = &*iter;
+		}
+
+		for (iter = table.begin(); iter != table.end(); ++iter) {
+			old_iter = old_entries.find(ext_address_to_uint64(iter->mExtAddress));
+
+			if (old_iter == old_entries.end()) {
+				add_change(kChangeJoined, *iter, 0, changes);
+
+			} else {
+				if (link_quality_of(*old_iter->second) != link_quality_of(*iter)) {
+					add_change(kChangeLinkQuality, *iter, link_quality_of(*old_iter->second), changes);
+				}
+
+				old_entries.erase(old_iter);
+			}
+		}
+
+		for (old_iter = old_entries.begin(); old_iter != old_entries.end(); ++old_iter) {
+			add_change(kChangeLeft, *old_iter->second, link_quality_of(*old_iter->second), changes);
+		}
+	}
+
+	cached->mValid = true;
+	cached->mTable = table;
+	cached->mFormatted[0] = cached->mFormatted[1] = false;
+}
+
+void
+SpinelNCPTopologyCache::insert_entry(const TableEntry& entry, std::list<std::string>& changes)
+{
+	CachedTable* cached = find_table(entry.mType);
+	Table::iterator iter;
+
+	if ((cached == NULL) || !cached->mValid) {
+		return;
+	}
+
+	for (iter = cached->mTable.begin(); iter != cached->mTable.end(); ++iter) {
+		if (same_node(*iter, entry)) {
+			break;
+		}
+	}
+
+	if (iter == cached->mTable.end()) {
+		cached->mTable.push_back(entry);
+		add_change(kChangeJoined, entry, 0, changes);
+
+	} else {
+		if (link_quality_of(*iter) != link_quality_of(entry)) {
+			add_change(kChangeLinkQuality, entry, link_quality_of(*iter), changes);
+		}
+
+		*iter = entry;
+	}
+
+	cached->mFormatted[0] = cached->mFormatted[1] = false;
+}
+
+void
+SpinelNCPTopologyCache::remove_entry(const TableEntry& entry, std::list<std::string>& changes)
+{
+	CachedTable* cached = find_table(entry.mType);
+	Table::iterator iter;
+
+	if ((cached == NULL) || !cached->mValid) {
+		return;
+	}
+
+	for (iter = cached->mTable.begin(); iter != cached->mTable.end(); ++iter) {
+		if (same_node(*iter, entry)) {
+			add_change(kChangeLeft, *iter, link_quality_of(*iter), changes);
+			cached->mTable.erase(iter);
+			cached->mFormatted[0] = cached->mFormatted[1] = false;
+			break;
+		}
+	}
+}
+
+boost::any
+SpinelNCPTopologyCache::get_table(Type type, ResultFormat format)
+{
+	CachedTable* cached = find_table(type);
+	int index = (format == SpinelNCPTaskGetNetworkTopology::kResultFormat_ValueMapArray) ? 1 : 0;
+	Table::const_iterator iter;
+
+	if ((cached == NULL) || !cached->mValid) {
+		return boost::any();
+	}
+
+	if (!cached->mFormatted[index]) {
+		if (index == 0) {
+			cached->mFormattedTable[index] = std::list<std::string>();
+			std::list<std::string>& result = *boost::any_cast< std::list<std::string> >(&cached->mFormattedTable[index]);
+
+			for (iter = cached->mTable.begin(); iter != cached->mTable.end(); ++iter) {
+				result.push_back(iter->get_as_string());
+			}
+		} else {
+			cached->mFormattedTable[index] = std::list<ValueMap>();
+			std::list<ValueMap>& result = *boost::any_cast< std::list<ValueMap> >(&cached->mFormattedTable[index]);
+
+			for (iter = cached->mTable.begin(); iter != cached->mTable.end(); ++iter) {
+				result.push_back(iter->get_as_valuemap());
+			}
+		}
+
+		cached->mFormatted[index] = true;
+	}
+
+	return cached->mFormattedTable[index];
+}
+
+bool
+SpinelNCPTopologyCache::get_table_for_property(const std::string& key, boost::any& value)
+{
+	static const struct {
+		const char* mKey;
+		Type mType;
+		ResultFormat mFormat;
+	} kTableProperties[] = {
+		{ kWPANTUNDProperty_ThreadChildTable,               SpinelNCPTaskGetNetworkTopology::kChildTable,    SpinelNCPTaskGetNetworkTopology::kResultFormat_StringArray },
+		{ kWPANTUNDProperty_ThreadChildTableAsValMap,       SpinelNCPTaskGetNetworkTopology::kChildTable,    SpinelNCPTaskGetNetworkTopology::kResultFormat_ValueMapArray },
+		{ kWPANTUNDProperty_ThreadNeighborTable,            SpinelNCPTaskGetNetworkTopology::kNeighborTable, SpinelNCPTaskGetNetworkTopology::kResultFormat_StringArray },
+		{ kWPANTUNDProperty_ThreadNeighborTableAsValMap,    SpinelNCPTaskGetNetworkTopology::kNeighborTable, SpinelNCPTaskGetNetworkTopology::kResultFormat_ValueMapArray },
+		{ kWPANTUNDProperty_ThreadRouterTable,              SpinelNCPTaskGetNetworkTopology::kRouterTable,   SpinelNCPTaskGetNetworkTopology::kResultFormat_StringArray },
+		{ kWPANTUNDProperty_ThreadRouterTableAsValMap,      SpinelNCPTaskGetNetworkTopology::kRouterTable,   SpinelNCPTaskGetNetworkTopology::kResultFormat_ValueMapArray },
+	};
+
+	for (size_t i = 0; i < sizeof(kTableProperties) / sizeof(kTableProperties[0]); i++) {
+		if (strcaseequal(key.c_str(), kTableProperties[i].mKey)) {
+			if (!is_valid(kTableProperties[i].mType)) {
+				break;
+			}
+
+			value = get_table(kTableProperties[i].mType, kTableProperties[i].mFormat);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+SpinelNCPTopologyCache::get_changes(std::list<std::string>& changes) const
+{
+	changes = mChangeHistory;
+}
@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __wpantund__SpinelNCPTopologyCache__
+#define __wpantund__SpinelNCPTopologyCache__
+
+#include <list>
+#include <string>
+#include <boost/any.hpp>
+#include "SpinelNCPTaskGetNetworkTopology.h"
+
+namespace nl {
+namespace wpantund {
+
+// Number of changes kept for `Thread:TopologyChanges`
+#define TOPOLOGY_CACHE_CHANGE_HISTORY_SIZE      64
+
+// Keeps the last child, neighbor and router tables read from the NCP,
+// so that `Thread:ChildTable` and friends can be answered from memory.
+//
+// Each time a table is updated, it is compared entry by entry (keyed
+// by extended address) against the cached one, and a change is
+// recorded for every entry that joined, left or whose link quality
+// changed. The string and `ValueMap` forms of a table are only built
+// again after the table has actually changed.
+class SpinelNCPTopologyCache
+{
+public:
+	typedef SpinelNCPTaskGetNetworkTopology::Type Type;
+	typedef SpinelNCPTaskGetNetworkTopology::ResultFormat ResultFormat;
+	typedef SpinelNCPTaskGetNetworkTopology::TableEntry TableEntry;
+	typedef SpinelNCPTaskGetNetworkTopology::Table Table;
+
+public:
+	SpinelNCPTopologyCache();
+
+	// Forgets all cached tables (but not the change history). The
+	// next update of each table is taken as is, without reporting
+	// every entry in it as having joined.
+	void invalidate(void);
+
+	bool is_valid(Type type) const;
+
+	// Replaces a whole table with a fresh copy read from the NCP and
+	// appends a description of each change to `changes`.
+	void update_table(Type type, const Table& table, std::list<std::string>& changes);
+
+	// Applies a single child table insert/remove notification.
+	void insert_entry(const TableEntry& entry, std::list<std::string>& changes);
+	void remove_entry(const TableEntry& entry, std::list<std::string>& changes);
+
+	// Returns the cached table in the given result format (string
+	// array or `ValueMap` array).
+	boost::any get_table(Type type, ResultFormat format);
+
+	// Same as above, but for the table read by the given property
+	// (e.g. `Thread:ChildTable:AsValMap`). Returns false if that table
+	// isn't cached or the cache for it isn't valid yet.
+	bool get_table_for_property(const std::string& key, boost::any& value);
+
+	// Most recent changes, oldest first.
+	void get_changes(std::list<std::string>& changes) const;
+
+private:
+	enum ChangeType
+	{
+		kChangeJoined,
+		kChangeLeft,
+		kChangeLinkQuality,
+	};
+
+	struct Change
+	{
+		ChangeType mChangeType;
+		Type mTableType;
+		uint8_t mExtAddress[8];
+		uint16_t mRloc16;
+		uint8_t mOldLinkQuality;
+		uint8_t mNewLinkQuality;
+
+		std::string get_as_string(void) const;
+	};
+
+	struct CachedTable
+	{
+		bool mValid;
+		Table mTable;
+		bool mFormatted[2];
+		boost::any mFormattedTable[2];
+	};
+
+	CachedTable* find_table(Type type);
+	const CachedTable* find_table(Type type) const;
+
+	void add_change(ChangeType change_type, const TableEntry& entry, uint8_t old_link_quality, std::list<std::string>& changes);
+
+	static bool same_node(const TableEntry& lhs, const TableEntry& rhs);
+	static uint8_t link_quality_of(const TableEntry& entry);
+
+private:
+	CachedTable mChildTable;
+	CachedTable mNeighborTable;
+	CachedTable mRouterTable;
+
+	std::list<std::string> mChangeHistory;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__SpinelNCPTopologyCache__) */
@@ -77,8 +77,8 @@ SpinelNCPVendorCustom::property_get_value(const std::string& key, CallbackWithSt
 #define SIMPLE_SPINEL_GET(prop__, type__)                                \
 	mInstance->start_new_task(SpinelNCPTaskSendCommand::Factory(this)    \
 		.set_callback(cb)                                                \
-		.add_command(                                                    \
-			SpinelPackData(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, prop__) \
+		.add_packed_command(                                             \
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, prop__                 \
 		)                                                                \
 		.set_reply_format(type__)                                        \
 		.finish()                                                        \
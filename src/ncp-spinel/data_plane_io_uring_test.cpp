@@ -0,0 +1,328 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Runs the data-plane thread on its io_uring backend, with socket
+ *      pairs standing in for the NCP's serial port and the tunnel, and
+ *      checks that frames and packets get through in every direction:
+ *      to the NCP, from the NCP, from the tunnel, and (over the fast
+ *      path) from the NCP into the tunnel.
+ *
+ *      Skipped when the kernel doesn't support io_uring.
+ *
+ *      Built with `FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION`, so that
+ *      `TunnelIPv6Interface` doesn't need a real tun device.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include "SpinelNCPDataPlane.h"
+#include "UnixSocket.h"
+#include "io-uring.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+#define ROUND_COUNT         100
+#define PACKET_SIZE         100
+#define IO_TIMEOUT_MS       5000
+
+static int gErrors = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			gErrors++; \
+		} \
+	} while (false)
+
+// A tunnel whose other end is a socket in this test.
+class LoopbackTunnel : public TunnelIPv6Interface
+{
+public:
+	LoopbackTunnel(int fd)
+	{
+		close(mFDRead);
+		mFDRead = mFDWrite = fd;
+	}
+};
+
+static bool
+wait_readable(int fd)
+{
+	struct pollfd pfd = { fd, POLLIN, 0 };
+
+	return poll(&pfd, 1, IO_TIMEOUT_MS) > 0;
+}
+
+// Fills `packet` with an IPv6 header followed by a pattern based on `round`.
+static void
+make_packet(uint8_t* packet, int round)
+{
+	memset(packet, 0, PACKET_SIZE);
+	packet[0] = 0x60;
+	packet[4] = 0;
+	packet[5] = PACKET_SIZE - 40;
+	packet[6] = 59; // No next header
+
+	for (int i = 40; i < PACKET_SIZE; i++) {
+		packet[i] = static_cast<uint8_t>(round + i);
+	}
+}
+
+// Waits for the data-plane thread to hand the main loop a frame.
+static SpinelNCPDataPlane::Frame*
+receive_frame(SpinelNCPDataPlane& data_plane)
+{
+	SpinelNCPDataPlane::Frame* frame;
+
+	while ((frame = data_plane.begin_receive()) == NULL) {
+		if (!wait_readable(data_plane.get_wake_fd())) {
+			return NULL;
+		}
+
+		data_plane.clear_wake();
+	}
+
+	return frame;
+}
+
+// Reads from the NCP's end of the serial port until a whole frame has
+// been decoded, and returns its length (without the CRC), or -1.
+static int
+read_ncp_frame(int fd, HDLCDecoder& decoder)
+{
+	uint8_t byte;
+
+	while (wait_readable(fd) && (read(fd, &byte, 1) == 1)) {
+		if (decoder.decode(byte)) {
+			if (!hdlc_frame_crc_is_valid(decoder.get_frame(), decoder.get_frame_size())) {
+				return -1;
+			}
+
+			return static_cast<int>(decoder.get_frame_size()) - 2;
+		}
+	}
+
+	return -1;
+}
+
+static void
+write_ncp_frame(int fd, const uint8_t* frame, spinel_size_t frame_len)
+{
+	uint8_t encoded[HDLC_ENCODED_SIZE(SPINEL_FRAME_BUFFER_SIZE)];
+	spinel_size_t encoded_len = hdlc_encode_frame(frame, frame_len, encoded, sizeof(encoded));
+
+	CHECK(write(fd, encoded, encoded_len) == static_cast<ssize_t>(encoded_len));
+}
+
+static void
+test_to_ncp(SpinelNCPDataPlane& data_plane, int ncp_fd)
+{
+	HDLCDecoder decoder;
+
+	for (int round = 0; round < ROUND_COUNT; round++) {
+		SpinelNCPDataPlane::Frame* frame = data_plane.begin_send();
+		spinel_ssize_t frame_len;
+		int len;
+
+		CHECK(frame != NULL);
+
+		if (frame == NULL) {
+			return;
+		}
+
+		frame_len = spinel_datatype_pack(
+			frame->mData,
+			sizeof(frame->mData),
+			"Cii" SPINEL_DATATYPE_UINT32_S,
+			SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (1 << SPINEL_HEADER_TID_SHIFT),
+			SPINEL_CMD_PROP_VALUE_SET,
+			SPINEL_PROP_PHY_CHAN,
+			round
+		);
+		frame->mLength = static_cast<spinel_size_t>(frame_len);
+		frame->mType = SpinelNCPDataPlane::kFrameTypeSpinel;
+		data_plane.commit_send();
+
+		len = read_ncp_frame(ncp_fd, decoder);
+
+		CHECK(len == frame_len);
+
+		if (len != frame_len) {
+			return;
+		}
+
+		CHECK(decoder.get_frame()[0] == (SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (1 << SPINEL_HEADER_TID_SHIFT)));
+		CHECK(decoder.get_frame()[frame_len - 4] == round);
+	}
+}
+
+static void
+test_from_ncp(SpinelNCPDataPlane& data_plane, int ncp_fd)
+{
+	for (int round = 0; round < ROUND_COUNT; round++) {
+		uint8_t frame[SPINEL_FRAME_BUFFER_SIZE];
+		spinel_ssize_t frame_len;
+		SpinelNCPDataPlane::Frame* received;
+
+		frame_len = spinel_datatype_pack(
+			frame,
+			sizeof(frame),
+			"Cii" SPINEL_DATATYPE_UINT32_S,
+			SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0 | (2 << SPINEL_HEADER_TID_SHIFT),
+			SPINEL_CMD_PROP_VALUE_IS,
+			SPINEL_PROP_PHY_CHAN,
+			round
+		);
+		write_ncp_frame(ncp_fd, frame, static_cast<spinel_size_t>(frame_len));
+
+		received = receive_frame(data_plane);
+		CHECK(received != NULL);
+
+		if (received == NULL) {
+			return;
+		}
+
+		CHECK(received->mType == SpinelNCPDataPlane::kFrameTypeSpinel);
+		CHECK(received->mLength == static_cast<spinel_size_t>(frame_len));
+		CHECK(memcmp(received->mData, frame, frame_len) == 0);
+		data_plane.commit_receive();
+	}
+}
+
+static void
+test_from_tunnel(SpinelNCPDataPlane& data_plane, int host_fd)
+{
+	for (int round = 0; round < ROUND_COUNT; round++) {
+		uint8_t packet[PACKET_SIZE];
+		SpinelNCPDataPlane::Frame* received;
+
+		make_packet(packet, round);
+		CHECK(write(host_fd, packet, sizeof(packet)) == static_cast<ssize_t>(sizeof(packet)));
+
+		received = receive_frame(data_plane);
+		CHECK(received != NULL);
+
+		if (received == NULL) {
+			return;
+		}
+
+		CHECK(received->mType == SpinelNCPDataPlane::kFrameTypeNCPBoundPacket);
+		CHECK(received->mLength == sizeof(packet));
+		CHECK(memcmp(received->mData, packet, sizeof(packet)) == 0);
+		data_plane.commit_receive();
+	}
+}
+
+static void
+test_fast_path_to_tunnel(SpinelNCPDataPlane& data_plane, int ncp_fd, int host_fd)
+{
+	data_plane.set_fast_path(true);
+
+	for (int round = 0; round < ROUND_COUNT; round++) {
+		uint8_t packet[PACKET_SIZE];
+		uint8_t frame[SPINEL_FRAME_BUFFER_SIZE];
+		uint8_t received[SPINEL_FRAME_BUFFER_SIZE];
+		spinel_ssize_t frame_len;
+
+		make_packet(packet, round);
+
+		frame_len = spinel_datatype_pack(
+			frame,
+			sizeof(frame),
+			"Cii" SPINEL_DATATYPE_DATA_WLEN_S SPINEL_DATATYPE_DATA_S,
+			SPINEL_HEADER_FLAG | SPINEL_HEADER_IID_0,
+			SPINEL_CMD_PROP_VALUE_IS,
+			SPINEL_PROP_STREAM_NET,
+			packet,
+			static_cast<unsigned int>(sizeof(packet)),
+			NULL,
+			0
+		);
+		write_ncp_frame(ncp_fd, frame, static_cast<spinel_size_t>(frame_len));
+
+		CHECK(wait_readable(host_fd));
+		CHECK(read(host_fd, received, sizeof(received)) == static_cast<ssize_t>(sizeof(packet)));
+		CHECK(memcmp(received, packet, sizeof(packet)) == 0);
+	}
+
+	CHECK(data_plane.get_counters().mFastPathToHost == ROUND_COUNT);
+
+	data_plane.set_fast_path(false);
+}
+
+int
+main(void)
+{
+	SpinelNCPDataPlane data_plane;
+	IPv6PacketMatcher drop_firewall;
+	boost::shared_ptr<SocketWrapper> serial;
+	boost::shared_ptr<TunnelIPv6Interface> tunnel;
+	int serial_fds[2];
+	int tunnel_fds[2];
+
+	if (!io_uring_is_available()) {
+		printf("SKIP (no io_uring)\n");
+		return 77;
+	}
+
+	if ( (socketpair(AF_UNIX, SOCK_STREAM, 0, serial_fds) != 0)
+	  || (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, tunnel_fds) != 0)
+	) {
+		perror("socketpair");
+		return EXIT_FAILURE;
+	}
+
+	serial = UnixSocket::create(serial_fds[0], true);
+	tunnel.reset(new LoopbackTunnel(tunnel_fds[0]));
+
+	CHECK(data_plane.start(serial, tunnel, &drop_firewall, true) == 0);
+
+	test_to_ncp(data_plane, serial_fds[1]);
+
+	// By now the thread has picked its backend.
+	CHECK(data_plane.get_backend() == SpinelNCPDataPlane::kBackendIOUring);
+
+	test_from_ncp(data_plane, serial_fds[1]);
+	test_from_tunnel(data_plane, tunnel_fds[1]);
+	test_fast_path_to_tunnel(data_plane, serial_fds[1], tunnel_fds[1]);
+
+	CHECK(data_plane.get_last_error() == 0);
+
+	data_plane.stop();
+
+	close(serial_fds[1]);
+	close(tunnel_fds[1]);
+
+	if (gErrors != 0) {
+		printf("FAIL (%d errors)\n", gErrors);
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
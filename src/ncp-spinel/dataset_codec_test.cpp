@@ -0,0 +1,332 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Verifies that the cached encodings of a `ThreadDataset` stay
+ *      identical to encoding it from scratch as single fields are
+ *      patched, and that a frame survives a parse/encode round trip.
+ *      Also reports how long each of these takes with a large raw
+ *      TLV payload.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SpinelNCPInstance.h"
+#include "SpinelNCPThreadDataset.h"
+#include "any-to.h"
+#include "time-utils.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+// The packing code only needs these from the rest of the driver, and
+// none of them are reached without a real NCP instance.
+int
+nl::wpantund::peek_ncp_callback_status(int event, va_list args)
+{
+	(void)event;
+	(void)args;
+	return 0;
+}
+
+int
+nl::wpantund::spinel_status_to_wpantund_status(int spinel_status)
+{
+	return spinel_status;
+}
+
+int
+NCPInstanceBase::process_event_helper(int event)
+{
+	(void)event;
+	return 0;
+}
+
+void
+SpinelNCPInstance::queue_outbound_frame(int slot)
+{
+	(void)slot;
+}
+
+// As large as still fits in a spinel frame with the rest of the dataset.
+static const size_t kRawTlvsSize = 1024;
+static int gErrors = 0;
+
+// Copies the values only, so that `to` encodes everything from scratch.
+static void
+copy_fields(const ThreadDataset &from, ThreadDataset &to)
+{
+	to.clear();
+
+#define COPY_FIELD(name) if (from.name.has_value()) { to.name = from.name.get(); }
+	COPY_FIELD(mActiveTimestamp);
+	COPY_FIELD(mPendingTimestamp);
+	COPY_FIELD(mMasterKey);
+	COPY_FIELD(mNetworkName);
+	COPY_FIELD(mExtendedPanId);
+	COPY_FIELD(mMeshLocalPrefix);
+	COPY_FIELD(mDelay);
+	COPY_FIELD(mPanId);
+	COPY_FIELD(mChannel);
+	COPY_FIELD(mPSKc);
+	COPY_FIELD(mChannelMaskPage0);
+	COPY_FIELD(mSecurityPolicy);
+	COPY_FIELD(mRawTlvs);
+#undef COPY_FIELD
+}
+
+static void
+fill_dataset(ThreadDataset &dataset)
+{
+	static const uint8_t kMasterKey[16] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+	};
+	static const uint8_t kXPanId[8] = { 0xDE, 0xAD, 0x00, 0xBE, 0xEF, 0x00, 0xCA, 0xFE };
+	struct in6_addr prefix;
+	ThreadDataset::SecurityPolicy policy;
+	Data raw_tlvs(kRawTlvsSize);
+
+	memset(&prefix, 0, sizeof(prefix));
+	prefix.s6_addr[0] = 0xFD;
+	prefix.s6_addr[1] = 0x12;
+
+	policy.mKeyRotationTime = 672;
+	policy.mFlags = 0xF7;
+
+	for (size_t i = 0; i < raw_tlvs.size(); i++) {
+		raw_tlvs[i] = static_cast<uint8_t>(i * 7);
+	}
+
+	dataset.mActiveTimestamp = 0x0000000100000000ULL;
+	dataset.mPendingTimestamp = 0x0000000200000000ULL;
+	dataset.mMasterKey = Data(kMasterKey, sizeof(kMasterKey));
+	dataset.mNetworkName = std::string("wpantund-test");
+	dataset.mExtendedPanId = Data(kXPanId, sizeof(kXPanId));
+	dataset.mMeshLocalPrefix = prefix;
+	dataset.mDelay = 30000;
+	dataset.mPanId = 0x1234;
+	dataset.mChannel = 15;
+	dataset.mPSKc = Data(kMasterKey, sizeof(kMasterKey));
+	dataset.mChannelMaskPage0 = 0x07FFF800;
+	dataset.mSecurityPolicy = policy;
+	dataset.mRawTlvs = raw_tlvs;
+}
+
+// Checks every cached encoding of `dataset` against a fresh one.
+static void
+check_against_fresh(ThreadDataset &dataset, const char *step)
+{
+	ThreadDataset fresh;
+
+	copy_fields(dataset, fresh);
+
+	if (dataset.get_spinel_frame() != fresh.get_spinel_frame()) {
+		printf("%s: spinel frame differs\n", step);
+		gErrors++;
+	}
+
+	if (dataset.get_string_list() != fresh.get_string_list()) {
+		printf("%s: string list differs\n", step);
+		gErrors++;
+	}
+
+	{
+		const ValueMap &cached = dataset.get_valuemap();
+		const ValueMap &expected = fresh.get_valuemap();
+		ValueMap::const_iterator iter;
+
+		if (cached.size() != expected.size()) {
+			printf("%s: value map has %d entries instead of %d\n", step, static_cast<int>(cached.size()), static_cast<int>(expected.size()));
+			gErrors++;
+		}
+
+		for (iter = expected.begin(); iter != expected.end(); ++iter) {
+			ValueMap::const_iterator found = cached.find(iter->first);
+
+			if (found == cached.end()) {
+				printf("%s: value map lacks \"%s\"\n", step, iter->first.c_str());
+				gErrors++;
+
+			} else if ( (found->second.type() != iter->second.type())
+			         || (any_to_string(found->second) != any_to_string(iter->second))
+			) {
+				printf("%s: value map differs at \"%s\"\n", step, iter->first.c_str());
+				gErrors++;
+			}
+		}
+	}
+}
+
+static void
+report(const char *what, uint64_t start_us, int iterations)
+{
+	printf("%-28s %8.2f us\n", what, static_cast<double>(time_us() - start_us) / iterations);
+}
+
+int main(void)
+{
+	static const int kIterations = 2000;
+	ThreadDataset dataset;
+	ThreadDataset parsed;
+	ThreadDataset scratch;
+	Data frame;
+	Data other_frame;
+	uint64_t start;
+
+	fill_dataset(dataset);
+	check_against_fresh(dataset, "initial");
+
+	// Round trip.
+	frame = dataset.get_spinel_frame();
+
+	if (parsed.set_from_spinel_frame(frame.data(), frame.size()) != kWPANTUNDStatus_Ok) {
+		printf("parse failed\n");
+		gErrors++;
+	}
+
+	if (parsed.get_spinel_frame() != frame) {
+		printf("round trip: spinel frame differs\n");
+		gErrors++;
+	}
+
+	if (parsed.get_string_list() != dataset.get_string_list()) {
+		printf("round trip: string list differs\n");
+		gErrors++;
+	}
+
+	// Patch single fields, growing, shrinking and removing entries.
+	dataset.mPanId = 0xFACE;
+	check_against_fresh(dataset, "same size");
+
+	dataset.mNetworkName = std::string("a-much-longer-network-name");
+	check_against_fresh(dataset, "grow");
+
+	dataset.mNetworkName = std::string("short");
+	check_against_fresh(dataset, "shrink");
+
+	dataset.mDelay.clear();
+	check_against_fresh(dataset, "remove");
+
+	dataset.mDelay = 1000;
+	check_against_fresh(dataset, "re-add");
+
+	dataset.mRawTlvs = Data(kRawTlvsSize + 128);
+	dataset.mActiveTimestamp = 0x0000000300000000ULL;
+	check_against_fresh(dataset, "two fields");
+
+	// A frame parsed again must still replace local changes.
+	parsed.mPanId = 0x4321;
+	parsed.set_from_spinel_frame(frame.data(), frame.size());
+
+	if (parsed.mPanId.get() != 0x1234) {
+		printf("reparse kept a local change\n");
+		gErrors++;
+	}
+
+	// Parsing a bad frame leaves the dataset empty.
+	other_frame = frame;
+	other_frame.resize(frame.size() - 1);
+
+	if (parsed.set_from_spinel_frame(other_frame.data(), other_frame.size()) == kWPANTUNDStatus_Ok) {
+		printf("truncated frame was accepted\n");
+		gErrors++;
+	}
+
+	if (!parsed.get_spinel_frame().empty() || parsed.mChannel.has_value()) {
+		printf("failed parse left fields behind\n");
+		gErrors++;
+	}
+
+	// Timings, with a raw TLV payload of kRawTlvsSize bytes.
+	dataset.clear();
+	fill_dataset(dataset);
+	other_frame = dataset.get_spinel_frame();
+	dataset.mPanId = 0x4321;
+	frame = dataset.get_spinel_frame();
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		copy_fields(dataset, scratch);
+		scratch.get_spinel_frame();
+	}
+	report("full encode:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		dataset.get_spinel_frame();
+	}
+	report("cached encode:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		dataset.mPanId = static_cast<uint16_t>(i);
+		dataset.get_spinel_frame();
+	}
+	report("single field patch:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		copy_fields(dataset, scratch);
+		scratch.get_string_list();
+	}
+	report("full string list:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		dataset.mPanId = static_cast<uint16_t>(i);
+		dataset.get_string_list();
+	}
+	report("string list patch:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		if (i & 1) {
+			parsed.set_from_spinel_frame(frame.data(), frame.size());
+		} else {
+			parsed.set_from_spinel_frame(other_frame.data(), other_frame.size());
+		}
+	}
+	report("parse:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		parsed.set_from_spinel_frame(frame.data(), frame.size());
+	}
+	report("parse same frame:", start, kIterations);
+
+	start = time_us();
+	for (int i = 0; i < kIterations; i++) {
+		parsed.set_from_spinel_frame(frame.data(), frame.size());
+		parsed.get_spinel_frame();
+	}
+	report("round trip, unchanged:", start, kIterations);
+
+	if (gErrors != 0) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
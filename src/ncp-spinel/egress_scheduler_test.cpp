@@ -0,0 +1,378 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Checks how `SpinelNCPEgressScheduler` classifies packets, that
+ *      network control traffic always goes first, that the other
+ *      classes share the link by weight, that a full class only
+ *      drops its own packets, that low-priority packets are held
+ *      while the NCP sleeps, and that a flood is left waiting in the
+ *      network interface rather than read and dropped.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SpinelNCPEgressScheduler.h"
+#include "SpinelNCPFlowControl.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+typedef SpinelNCPEgressScheduler Scheduler;
+
+static int gErrors = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			gErrors++; \
+		} \
+	} while (false)
+
+// Builds an IPv6 packet of `len` bytes with the given traffic class
+// and flow label, carrying UDP between the given ports (or ICMPv6 of
+// the given type if `icmp_type` isn't negative).
+static size_t
+make_packet(uint8_t* packet, size_t len, uint8_t dscp, uint32_t flow_label, int icmp_type, uint16_t src_port, uint16_t dst_port)
+{
+	memset(packet, 0, len);
+
+	packet[0] = static_cast<uint8_t>(0x60 | (dscp >> 2));
+	packet[1] = static_cast<uint8_t>(((dscp & 0x03) << 6) | ((flow_label >> 16) & 0x0F));
+	packet[2] = static_cast<uint8_t>(flow_label >> 8);
+	packet[3] = static_cast<uint8_t>(flow_label);
+	packet[4] = static_cast<uint8_t>((len - 40) >> 8);
+	packet[5] = static_cast<uint8_t>(len - 40);
+	packet[7] = 64;
+
+	if (icmp_type >= 0) {
+		packet[6] = 58;
+		packet[40] = static_cast<uint8_t>(icmp_type);
+	} else {
+		packet[6] = 17;
+		packet[40] = static_cast<uint8_t>(src_port >> 8);
+		packet[41] = static_cast<uint8_t>(src_port);
+		packet[42] = static_cast<uint8_t>(dst_port >> 8);
+		packet[43] = static_cast<uint8_t>(dst_port);
+	}
+
+	return len;
+}
+
+static Scheduler::Class
+classify(const Scheduler& scheduler, uint8_t dscp, uint32_t flow_label, int icmp_type, uint16_t src_port, uint16_t dst_port)
+{
+	uint8_t packet[100];
+
+	make_packet(packet, sizeof(packet), dscp, flow_label, icmp_type, src_port, dst_port);
+
+	return scheduler.classify(packet, sizeof(packet));
+}
+
+// Queues a UDP packet of `len` bytes to `dst_port`, with its first
+// payload byte set to `tag`.
+static bool
+enqueue(Scheduler& scheduler, size_t len, uint8_t dscp, uint16_t dst_port, uint8_t tag)
+{
+	int slot = scheduler.get_free_slot();
+
+	if (slot == Scheduler::kNoSlot) {
+		return false;
+	}
+
+	make_packet(scheduler.get_packet(slot), len, dscp, 0, -1, 49152, dst_port);
+	scheduler.get_packet(slot)[48] = tag;
+
+	return scheduler.enqueue(slot, len, 2);
+}
+
+static int
+dequeue_tag(Scheduler& scheduler)
+{
+	static uint8_t packet[Scheduler::kPacketSize];
+	uint8_t frame_type;
+
+	if (scheduler.dequeue(packet, &frame_type) == 0) {
+		return -1;
+	}
+
+	return packet[48];
+}
+
+static void
+test_classify(void)
+{
+	Scheduler scheduler;
+	uint8_t short_packet[20] = { 0x60 };
+
+	CHECK(classify(scheduler, 0, 0, 135, 0, 0) == Scheduler::kClassNetworkControl);  // Neighbor solicitation
+	CHECK(classify(scheduler, 0, 0, 128, 0, 0) == Scheduler::kClassInteractive);     // Echo request
+	CHECK(classify(scheduler, 0, 0, -1, 19788, 19788) == Scheduler::kClassNetworkControl);
+	CHECK(classify(scheduler, 0, 0, -1, 49152, 5683) == Scheduler::kClassInteractive);
+	CHECK(classify(scheduler, 0, 0, -1, 61631, 49152) == Scheduler::kClassInteractive);
+	CHECK(classify(scheduler, 0, 0, -1, 49152, 80) == Scheduler::kClassDefault);
+	CHECK(classify(scheduler, 46, 0, -1, 49152, 80) == Scheduler::kClassInteractive);
+	CHECK(classify(scheduler, 48, 0, -1, 49152, 80) == Scheduler::kClassNetworkControl);
+	CHECK(classify(scheduler, 8, 0, -1, 49152, 5683) == Scheduler::kClassBulk);
+	CHECK(scheduler.classify(short_packet, sizeof(short_packet)) == Scheduler::kClassDefault);
+
+	CHECK(scheduler.set_rules("port:5683=bulk, flowlabel:0xBEEF=control dscp:10=interactive"));
+	CHECK(classify(scheduler, 0, 0, -1, 49152, 5683) == Scheduler::kClassBulk);
+	CHECK(classify(scheduler, 0, 0xBEEF, -1, 49152, 80) == Scheduler::kClassNetworkControl);
+	CHECK(classify(scheduler, 10, 0, -1, 49152, 80) == Scheduler::kClassInteractive);
+
+	// Invalid rules leave the previous ones in place.
+	CHECK(!scheduler.set_rules("port:5683=urgent"));
+	CHECK(!scheduler.set_rules("dscp:64=bulk"));
+	CHECK(!scheduler.set_rules("ttl:1=bulk"));
+	CHECK(classify(scheduler, 0, 0, -1, 49152, 5683) == Scheduler::kClassBulk);
+
+	CHECK(scheduler.set_rules(""));
+	CHECK(classify(scheduler, 0, 0, -1, 49152, 5683) == Scheduler::kClassInteractive);
+}
+
+static void
+test_strict_priority(void)
+{
+	Scheduler scheduler;
+
+	CHECK(enqueue(scheduler, 100, 8, 80, 1));     // bulk
+	CHECK(enqueue(scheduler, 100, 0, 80, 2));     // default
+	CHECK(enqueue(scheduler, 100, 48, 80, 3));    // control
+	CHECK(enqueue(scheduler, 100, 48, 80, 4));    // control
+
+	CHECK(dequeue_tag(scheduler) == 3);
+	CHECK(dequeue_tag(scheduler) == 4);
+	CHECK(dequeue_tag(scheduler) != 3);
+	CHECK(dequeue_tag(scheduler) > 0);
+	CHECK(dequeue_tag(scheduler) == -1);
+	CHECK(scheduler.is_empty());
+}
+
+static void
+test_weights(void)
+{
+	Scheduler scheduler;
+	int sent[Scheduler::kClassCount] = { 0 };
+	int i;
+
+	// Keep every DRR class backlogged with full-sized packets and
+	// count what gets sent.
+	for (i = 0; i < 700; i++) {
+		int tag;
+
+		while (enqueue(scheduler, 1200, 46, 80, Scheduler::kClassInteractive)) { }
+		while (enqueue(scheduler, 1200, 0, 80, Scheduler::kClassDefault)) { }
+		while (enqueue(scheduler, 1200, 8, 80, Scheduler::kClassBulk)) { }
+
+		tag = dequeue_tag(scheduler);
+		CHECK(tag > 0 && tag < Scheduler::kClassCount);
+		if (tag > 0 && tag < Scheduler::kClassCount) {
+			sent[tag]++;
+		}
+	}
+
+	printf("interactive:%d default:%d bulk:%d\n",
+		sent[Scheduler::kClassInteractive],
+		sent[Scheduler::kClassDefault],
+		sent[Scheduler::kClassBulk]);
+
+	// Weights are 4:2:1
+	CHECK(sent[Scheduler::kClassInteractive] >= 390 && sent[Scheduler::kClassInteractive] <= 410);
+	CHECK(sent[Scheduler::kClassDefault] >= 190 && sent[Scheduler::kClassDefault] <= 210);
+	CHECK(sent[Scheduler::kClassBulk] >= 90 && sent[Scheduler::kClassBulk] <= 110);
+}
+
+static void
+test_limits(void)
+{
+	Scheduler scheduler;
+	std::list<std::string> counters;
+	int i;
+
+	// A bulk transfer only fills its own queue...
+	for (i = 0; i < 100; i++) {
+		enqueue(scheduler, 500, 8, 80, 1);
+	}
+
+	// ...so control and default traffic still get in.
+	CHECK(enqueue(scheduler, 100, 48, 80, 2));
+	CHECK(enqueue(scheduler, 100, 0, 80, 3));
+	CHECK(dequeue_tag(scheduler) == 2);
+
+	scheduler.get_counters_as_string_list(counters);
+	CHECK(counters.size() == Scheduler::kClassCount);
+	CHECK(counters.back().find("Queued:16/16") != std::string::npos);
+	CHECK(counters.back().find("Dropped:84") != std::string::npos);
+
+	scheduler.flush();
+	CHECK(scheduler.is_empty());
+	CHECK(dequeue_tag(scheduler) == -1);
+
+	// Every slot is free again.
+	for (i = 0; i < Scheduler::kDefaultQueueLimit; i++) {
+		CHECK(enqueue(scheduler, 100, 0, 80, 4));
+	}
+	CHECK(!enqueue(scheduler, 100, 0, 80, 4));
+}
+
+static void
+test_hold(void)
+{
+	Scheduler scheduler;
+	std::list<std::string> counters;
+	int i;
+
+	scheduler.set_hold_enabled(true);
+	scheduler.set_ncp_asleep(true);
+
+	// Default and bulk packets wait for the NCP to wake up...
+	CHECK(enqueue(scheduler, 100, 0, 80, 1));
+	CHECK(enqueue(scheduler, 100, 8, 80, 2));
+	CHECK(!scheduler.has_ready_packet());
+	CHECK(dequeue_tag(scheduler) == -1);
+	CHECK(scheduler.get_ms_to_next_event() > 0);
+	CHECK(scheduler.get_ms_to_next_event() <= Scheduler::kDefaultHoldTime);
+
+	// ...and then go out together.
+	scheduler.handle_ncp_activity();
+	CHECK(scheduler.has_ready_packet());
+	CHECK(dequeue_tag(scheduler) > 0);
+	CHECK(dequeue_tag(scheduler) > 0);
+	CHECK(scheduler.is_empty());
+
+	// Holding resumes once everything held is out.
+	CHECK(enqueue(scheduler, 100, 0, 80, 3));
+	CHECK(!scheduler.has_ready_packet());
+
+	// Anything else which has to go out takes the held packets along.
+	CHECK(enqueue(scheduler, 100, 48, 80, 4));
+	CHECK(scheduler.has_ready_packet());
+	CHECK(dequeue_tag(scheduler) == 4);
+	CHECK(dequeue_tag(scheduler) == 3);
+	CHECK(scheduler.is_empty());
+
+	// A full queue isn't held any longer.
+	for (i = 0; i < Scheduler::kDefaultQueueLimit - 1; i++) {
+		CHECK(enqueue(scheduler, 100, 0, 80, 5));
+	}
+	CHECK(!scheduler.has_ready_packet());
+	CHECK(enqueue(scheduler, 100, 0, 80, 5));
+	CHECK(scheduler.has_ready_packet());
+
+	scheduler.get_counters_as_string_list(counters);
+	CHECK(counters.size() == Scheduler::kClassCount + 1);
+	CHECK(counters.back().find("HeldSent:3 ") != std::string::npos);
+	CHECK(counters.back().find("full):1/1/0/1 ") != std::string::npos);
+
+	// Nothing is held while the NCP is awake.
+	scheduler.flush();
+	scheduler.set_ncp_asleep(false);
+	CHECK(enqueue(scheduler, 100, 8, 80, 6));
+	CHECK(scheduler.has_ready_packet());
+	CHECK(scheduler.get_ms_to_next_event() == CMS_DISTANT_FUTURE);
+}
+
+// Reads bulk packets from a network interface with `*backlog` of them
+// waiting, for as long as `SpinelNCPInstance::should_read_outbound_packets()`
+// would. Returns how many were read.
+static int
+read_packets(Scheduler& scheduler, const SpinelNCPFlowControl& flow_control, int* backlog)
+{
+	int count = 0;
+
+	while ((*backlog > 0) && flow_control.can_send() && scheduler.is_accepting()) {
+		CHECK(enqueue(scheduler, 500, 8, 80, 1));
+		(*backlog)--;
+		count++;
+	}
+
+	return count;
+}
+
+static void
+test_backpressure(void)
+{
+	Scheduler scheduler;
+	SpinelNCPFlowControl flow_control;
+	std::list<std::string> counters;
+	int backlog = 100;
+	int i;
+
+	flow_control.set_enabled(true);
+
+	for (i = 0; i < SpinelNCPFlowControl::kInitialWindow; i++) {
+		flow_control.did_send();
+	}
+	CHECK(!flow_control.can_send());
+	CHECK(scheduler.is_accepting());
+
+	// While flow control is paused, a bulk flood stays in the kernel
+	// even though the egress queues have room.
+	CHECK(read_packets(scheduler, flow_control, &backlog) == 0);
+	CHECK(backlog == 100);
+
+	// Once the NCP has room again, packets are only read until the
+	// bulk queue is full...
+	flow_control.probe_started();
+	flow_control.handle_buffer_counters(1024, 1024);
+	CHECK(flow_control.can_send());
+
+	CHECK(read_packets(scheduler, flow_control, &backlog) == Scheduler::kBulkQueueLimit);
+	CHECK(backlog == 100 - Scheduler::kBulkQueueLimit);
+	CHECK(!scheduler.is_accepting());
+
+	// ...and each packet sent makes room for one more.
+	CHECK(dequeue_tag(scheduler) == 1);
+	flow_control.did_send();
+	CHECK(read_packets(scheduler, flow_control, &backlog) == 1);
+
+	// Nothing was dropped along the way.
+	scheduler.get_counters_as_string_list(counters);
+	CHECK(counters.back().find("Queued:16/16") != std::string::npos);
+	CHECK(counters.back().find("Dropped:0") != std::string::npos);
+
+	// Neither other classes nor a flood get in while a queue is full.
+	CHECK(enqueue(scheduler, 100, 48, 80, 2));
+	CHECK(!scheduler.is_accepting());
+	CHECK(dequeue_tag(scheduler) == 2);
+}
+
+int
+main(void)
+{
+	test_classify();
+	test_strict_priority();
+	test_weights();
+	test_limits();
+	test_hold();
+	test_backpressure();
+
+	if (gErrors != 0) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Checks that `SpinelNCPFlowControl` pauses after a window's worth
+ *      of packets, grows and shrinks the window with the NCP's replies,
+ *      carries on after a probe times out (ignoring its late reply),
+ *      and stops probing after `kMaxProbeFailures` timeouts in a row.
+ *
+ *      Built with `FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION`, so that
+ *      `time_ms()` only moves when the test says so.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "SpinelNCPFlowControl.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+typedef SpinelNCPFlowControl FlowControl;
+
+static int gErrors = 0;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			gErrors++; \
+		} \
+	} while (false)
+
+// Plenty of free buffers: the window is only limited by `kMaxWindow`.
+static const uint16_t kTotalBuffers = 1024;
+static const uint16_t kFreeBuffers = 1024;
+
+// Fewer free buffers than the low watermark.
+static const uint16_t kCongestedFreeBuffers = kTotalBuffers / FlowControl::kLowWatermarkDivisor - 1;
+
+// Sends packets until flow control pauses, and returns how many went.
+static int
+fill_window(FlowControl& flow_control)
+{
+	int count = 0;
+
+	while (flow_control.can_send() && (count < 0xFFFF)) {
+		flow_control.did_send();
+		count++;
+	}
+
+	return count;
+}
+
+static void
+test_window(void)
+{
+	FlowControl flow_control;
+	int window;
+
+	flow_control.set_enabled(true);
+
+	CHECK(fill_window(flow_control) == FlowControl::kInitialWindow);
+	CHECK(flow_control.wants_probe());
+	CHECK(flow_control.get_ms_to_next_event() == 0);
+
+	// A reply with room to spare resumes sending with a larger window.
+	flow_control.probe_started();
+	CHECK(!flow_control.wants_probe());
+	CHECK(!flow_control.can_send());
+	flow_control.handle_buffer_counters(kTotalBuffers, kFreeBuffers);
+	CHECK(flow_control.can_send());
+
+	window = fill_window(flow_control);
+	CHECK(window == FlowControl::kInitialWindow + 1);
+
+	// A congested NCP halves the window, and is asked again later.
+	flow_control.probe_started();
+	flow_control.handle_buffer_counters(kTotalBuffers, kCongestedFreeBuffers);
+	CHECK(!flow_control.can_send());
+	CHECK(!flow_control.wants_probe());
+	CHECK(flow_control.get_ms_to_next_event() == FlowControl::kRetryInterval);
+
+	fuzz_ff_cms(FlowControl::kRetryInterval);
+	flow_control.process();
+	CHECK(flow_control.wants_probe());
+
+	flow_control.probe_started();
+	flow_control.handle_buffer_counters(kTotalBuffers, kFreeBuffers);
+	CHECK(flow_control.can_send());
+	CHECK(fill_window(flow_control) == window / 2 + 1);
+
+	// The window never grows past what the free buffers can hold.
+	flow_control.probe_started();
+	flow_control.handle_buffer_counters(kTotalBuffers, kTotalBuffers / FlowControl::kLowWatermarkDivisor + 2 * FlowControl::kBuffersPerFrame);
+	CHECK(fill_window(flow_control) == 2);
+
+	// Disabling flow control lets everything through.
+	flow_control.set_enabled(false);
+	CHECK(flow_control.can_send());
+	CHECK(!flow_control.wants_probe());
+}
+
+static void
+test_timeout(void)
+{
+	FlowControl flow_control;
+
+	flow_control.set_enabled(true);
+
+	CHECK(fill_window(flow_control) == FlowControl::kInitialWindow);
+	flow_control.probe_started();
+	CHECK(flow_control.get_ms_to_next_event() == FlowControl::kProbeTimeout);
+
+	// Nothing happens before the deadline.
+	fuzz_ff_cms(FlowControl::kProbeTimeout - 1);
+	flow_control.process();
+	CHECK(!flow_control.can_send());
+	CHECK(flow_control.is_probe_pending());
+
+	// After it, sending carries on with half the window, and the next
+	// time the window fills up another probe goes out.
+	fuzz_ff_cms(1);
+	flow_control.process();
+	CHECK(flow_control.can_send());
+	CHECK(!flow_control.is_probe_pending());
+
+	CHECK(fill_window(flow_control) == FlowControl::kInitialWindow / 2);
+	CHECK(flow_control.wants_probe());
+
+	// The reply to the probe which timed out arrives too late to
+	// count, and changes nothing.
+	flow_control.handle_buffer_counters(kTotalBuffers, kFreeBuffers);
+	CHECK(!flow_control.can_send());
+	CHECK(flow_control.wants_probe());
+
+	flow_control.handle_probe_failed(true);
+	CHECK(!flow_control.can_send());
+	CHECK(flow_control.wants_probe());
+
+	// The new probe is answered as usual.
+	flow_control.probe_started();
+	flow_control.handle_buffer_counters(kTotalBuffers, kFreeBuffers);
+	CHECK(flow_control.can_send());
+	CHECK(fill_window(flow_control) == FlowControl::kInitialWindow / 2 + 1);
+}
+
+static void
+test_max_probe_failures(void)
+{
+	FlowControl flow_control;
+	int i;
+
+	flow_control.set_enabled(true);
+
+	for (i = 0; i < FlowControl::kMaxProbeFailures; i++) {
+		fill_window(flow_control);
+		CHECK(flow_control.wants_probe());
+
+		flow_control.probe_started();
+		fuzz_ff_cms(FlowControl::kProbeTimeout);
+		flow_control.process();
+		CHECK(flow_control.can_send());
+	}
+
+	// The NCP is taken not to have buffer counters: no more probes,
+	// and no more pauses until it reports a drop.
+	for (i = 0; i < 4 * FlowControl::kMaxWindow; i++) {
+		flow_control.did_send();
+	}
+	CHECK(flow_control.can_send());
+	CHECK(!flow_control.wants_probe());
+	CHECK(flow_control.get_ms_to_next_event() == CMS_DISTANT_FUTURE);
+
+	flow_control.handle_ncp_drop();
+	CHECK(!flow_control.can_send());
+	CHECK(!flow_control.wants_probe());
+
+	fuzz_ff_cms(FlowControl::kRetryInterval);
+	flow_control.process();
+	CHECK(flow_control.can_send());
+
+	// A reset (e.g. of the NCP) starts over.
+	flow_control.reset();
+	CHECK(fill_window(flow_control) == FlowControl::kInitialWindow);
+	CHECK(flow_control.wants_probe());
+
+	// A successful reply in between resets the count of failures.
+	flow_control.reset();
+	for (i = 0; i < 2 * FlowControl::kMaxProbeFailures; i++) {
+		fill_window(flow_control);
+		CHECK(flow_control.wants_probe());
+
+		flow_control.probe_started();
+
+		if (i % FlowControl::kMaxProbeFailures == FlowControl::kMaxProbeFailures - 1) {
+			flow_control.handle_buffer_counters(kTotalBuffers, kFreeBuffers);
+		} else {
+			fuzz_ff_cms(FlowControl::kProbeTimeout);
+			flow_control.process();
+		}
+	}
+	fill_window(flow_control);
+	CHECK(flow_control.wants_probe());
+}
+
+int
+main(void)
+{
+	fuzz_set_cms(1000);
+
+	test_window();
+	test_timeout();
+	test_max_probe_failures();
+
+	if (gErrors != 0) {
+		printf("FAIL (%d errors)\n", gErrors);
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
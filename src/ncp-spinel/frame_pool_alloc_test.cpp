@@ -0,0 +1,374 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Runs the real form, join and leave tasks against a stub NCP
+ *      instance, and verifies that the commands they pack go out through
+ *      `SpinelNCPFramePool` slots and are identical to the ones packed
+ *      on the heap when the pool is exhausted, and that sending a pooled
+ *      command and receiving its reply doesn't touch the heap at all.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+// The tasks are built below against a stub instead of the real
+// `SpinelNCPInstance`, with this test taking the place of the data
+// pump and the NCP.
+#include "ncp_instance_stub.h"
+
+#include "SpinelNCPTask.cpp"
+#include "SpinelNCPTaskForm.cpp"
+#include "SpinelNCPTaskJoin.cpp"
+#include "SpinelNCPTaskLeave.cpp"
+
+static bool gCountAllocations = false;
+static int gAllocationCount = 0;
+
+void* operator new(size_t size)
+{
+	void* ptr;
+
+	if (gCountAllocations) {
+		gAllocationCount++;
+	}
+
+	ptr = malloc(size ? size : 1);
+
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void operator delete(void* ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) throw()
+{
+	(void)size;
+	free(ptr);
+}
+
+#define MAX_CYCLE_FRAMES 64
+
+struct SentFrame {
+	uint8_t data[SPINEL_FRAME_BUFFER_SIZE];
+	spinel_ssize_t len;
+	bool from_pool;
+};
+
+static SpinelNCPInstance gInstance;
+static SentFrame gFrames[MAX_CYCLE_FRAMES];
+static int gFrameCount = 0;
+static int gTaskStatus = 0;
+static bool gTaskFinished = false;
+static int gErrors = 0;
+
+static void
+task_callback(int status, const boost::any& value)
+{
+	(void)value;
+	gTaskStatus = status;
+	gTaskFinished = true;
+}
+
+// Sends `count` commands one after the other, each the way every task
+// sends its commands, and nothing else.
+class SendLoopTask : public SpinelNCPTask
+{
+public:
+	SendLoopTask(SpinelNCPInstance* instance, int count):
+		SpinelNCPTask(instance, &task_callback), mCount(count), mSent(0)
+	{
+	}
+
+	virtual int vprocess_event(int event, va_list args)
+	{
+		EH_BEGIN();
+
+		EH_WAIT_UNTIL(EVENT_STARTING_TASK != event);
+
+		for (mSent = 0; mSent < mCount; mSent++) {
+			pack_next_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_PHY_CHAN);
+			EH_SPAWN(&mSubPT, vprocess_send_command(event, args));
+			require_noerr(mNextCommandRet, on_error);
+		}
+
+		finish(kWPANTUNDStatus_Ok);
+
+		EH_EXIT();
+
+	on_error:
+		finish(mNextCommandRet);
+
+		EH_END();
+	}
+
+private:
+	int mCount;
+	int mSent;
+};
+
+// Answers the frame that was just sent the way an NCP would, including
+// the state changes the tasks wait for.
+static void
+respond_to_frame(const SentFrame& frame)
+{
+	uint8_t header = 0;
+	unsigned int command = 0;
+	unsigned int key = 0;
+	const uint8_t* value_ptr = NULL;
+	spinel_size_t value_len = 0;
+	uint8_t status[4];
+	spinel_ssize_t status_len;
+
+	spinel_datatype_unpack(frame.data, frame.len, "Ci", &header, &command);
+
+	if (command == SPINEL_CMD_RESET) {
+		gInstance.change_ncp_state(UNINITIALIZED);
+		gInstance.mDriverState = SpinelNCPInstance::INITIALIZING_WAITING_FOR_RESET;
+		gInstance.mResetIsExpected = false;
+		gInstance.mInboundHeader = SPINEL_HEADER_FLAG;
+		gInstance.mCurrentTask->process_event(EVENT_NCP_RESET, SPINEL_STATUS_RESET_SOFTWARE);
+
+		// Re-initialization of the NCP.
+		gInstance.change_ncp_state(OFFLINE);
+		gInstance.mDriverState = SpinelNCPInstance::NORMAL_OPERATION;
+		gInstance.mCurrentTask->process_event(EVENT_IDLE);
+		return;
+	}
+
+	gInstance.mInboundHeader = header;
+
+	if (command == SPINEL_CMD_PROP_VALUE_SET) {
+		spinel_datatype_unpack(frame.data, frame.len, "CiiD", NULL, NULL, &key, &value_ptr, &value_len);
+
+		if ((key == SPINEL_PROP_NET_STACK_UP) && (value_len == 1) && value_ptr[0]) {
+			gInstance.change_ncp_state(ASSOCIATED);
+		} else if (key == SPINEL_PROP_NET_STACK_UP) {
+			gInstance.change_ncp_state(OFFLINE);
+		}
+
+		gInstance.mCurrentTask->process_event(EVENT_NCP_PROP_VALUE_IS, key, value_ptr, value_len);
+
+	} else {
+		status_len = spinel_datatype_pack(status, sizeof(status), "i", SPINEL_STATUS_OK);
+		gInstance.mCurrentTask->process_event(EVENT_NCP_PROP_VALUE_IS, SPINEL_PROP_LAST_STATUS, status, static_cast<spinel_size_t>(status_len));
+	}
+}
+
+// Plays the data pump and the NCP until the task finishes.
+static void
+run_task(const boost::shared_ptr<SpinelNCPTask>& task, const char* name)
+{
+	int steps;
+
+	gTaskFinished = false;
+	gTaskStatus = kWPANTUNDStatus_Failure;
+	gInstance.mCurrentTask = task;
+
+	task->process_event(EVENT_STARTING_TASK);
+	task->process_event(EVENT_IDLE);
+
+	for (steps = 0; !gTaskFinished && (steps < MAX_CYCLE_FRAMES); steps++) {
+		SentFrame* frame;
+
+		if ((gInstance.mOutboundBufferLen <= 0) || gInstance.mOutboundCallback.empty()) {
+			printf("%s: stalled\n", name);
+			break;
+		}
+
+		frame = &gFrames[gFrameCount % MAX_CYCLE_FRAMES];
+		frame->len = gInstance.mOutboundBufferLen;
+		frame->from_pool = (gInstance.mOutboundFrameSlot != SpinelNCPFramePool::kNoSlot);
+		memcpy(frame->data, gInstance.mOutboundFrame, frame->len);
+		gFrameCount++;
+
+		gInstance.clear_outbound_frame();
+		gInstance.mOutboundCallback(kWPANTUNDStatus_Ok);
+		gInstance.mOutboundCallback.clear();
+
+		respond_to_frame(*frame);
+	}
+
+	if (!gTaskFinished || (gTaskStatus != kWPANTUNDStatus_Ok)) {
+		printf("%s: finished %d, status %d\n", name, gTaskFinished, gTaskStatus);
+		gErrors++;
+	}
+
+	gInstance.mCurrentTask.reset();
+}
+
+static void
+run_form_join_leave_cycle(const ValueMap& form_options, const ValueMap& join_options)
+{
+	run_task(boost::shared_ptr<SpinelNCPTask>(new SpinelNCPTaskForm(&gInstance, &task_callback, form_options)), "form");
+	run_task(boost::shared_ptr<SpinelNCPTask>(new SpinelNCPTaskLeave(&gInstance, &task_callback)), "leave");
+	run_task(boost::shared_ptr<SpinelNCPTask>(new SpinelNCPTaskJoin(&gInstance, &task_callback, join_options)), "join");
+	run_task(boost::shared_ptr<SpinelNCPTask>(new SpinelNCPTaskLeave(&gInstance, &task_callback)), "leave");
+}
+
+int main(void)
+{
+	static const int kIterations = 100;
+	static const int kSendLoopCount = MAX_CYCLE_FRAMES - 1;
+	static const uint8_t kNetworkKey[16] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+	};
+	static SentFrame pool_frames[MAX_CYCLE_FRAMES];
+	ValueMap form_options;
+	ValueMap join_options;
+	int cycle_frames;
+	int slots[SPINEL_NCP_FRAME_POOL_SIZE];
+	uint8_t oversized[SPINEL_FRAME_BUFFER_SIZE];
+
+	gInstance.mCapabilities.insert(SPINEL_CAP_ROLE_ROUTER);
+	gInstance.mSupprotedChannels.insert(15);
+
+	form_options[kWPANTUNDProperty_NetworkName] = std::string("wpantund-test");
+	form_options[kWPANTUNDProperty_NCPChannel] = 15;
+	form_options[kWPANTUNDProperty_NetworkPANID] = 0x1234;
+	form_options[kWPANTUNDProperty_NetworkXPANID] = static_cast<uint64_t>(0xDEAD00BEEF00CAFEULL);
+	form_options[kWPANTUNDProperty_NetworkKey] = Data(kNetworkKey, sizeof(kNetworkKey));
+	form_options[kWPANTUNDProperty_NetworkKeyIndex] = 0;
+
+	join_options = form_options;
+	join_options[kWPANTUNDProperty_NetworkNodeType] = std::string("router");
+
+	// Warm up, so that one-time initialization isn't counted, and keep
+	// the frames of one cycle to compare against.
+	gFrameCount = 0;
+	run_form_join_leave_cycle(form_options, join_options);
+	cycle_frames = gFrameCount;
+	memcpy(pool_frames, gFrames, sizeof(pool_frames));
+
+	for (int i = 0; i < cycle_frames; i++) {
+		if (!pool_frames[i].from_pool) {
+			printf("frame %d was not sent from the pool\n", i);
+			gErrors++;
+		}
+	}
+
+	// Every slot is given back, however many cycles run.
+	for (int i = 0; i < kIterations; i++) {
+		run_form_join_leave_cycle(form_options, join_options);
+	}
+
+	if (gInstance.mOutboundFramePool.get_available() != SPINEL_NCP_FRAME_POOL_SIZE) {
+		printf("%d slots leaked\n", SPINEL_NCP_FRAME_POOL_SIZE - gInstance.mOutboundFramePool.get_available());
+		gErrors++;
+	}
+
+	// In steady state, a pooled send (reply included) allocates nothing.
+	// Only the task itself comes from the heap, before counting starts.
+	{
+		boost::shared_ptr<SpinelNCPTask> task(new SendLoopTask(&gInstance, kSendLoopCount));
+
+		gFrameCount = 0;
+		gAllocationCount = 0;
+		gCountAllocations = true;
+
+		run_task(task, "send loop");
+		task.reset();
+
+		gCountAllocations = false;
+
+		if (gFrameCount != kSendLoopCount) {
+			printf("send loop sent %d frames\n", gFrameCount);
+			gErrors++;
+		}
+
+		for (int i = 0; i < gFrameCount; i++) {
+			if (!gFrames[i].from_pool) {
+				printf("send loop frame %d was not sent from the pool\n", i);
+				gErrors++;
+			}
+		}
+
+		if (gAllocationCount != 0) {
+			printf("%d heap allocations for %d pooled sends\n", gAllocationCount, gFrameCount);
+			gErrors++;
+		}
+	}
+
+	// With the pool exhausted the tasks fall back to packing on the heap,
+	// which must produce the same frames (apart from the transaction ids).
+	for (int i = 0; i < SPINEL_NCP_FRAME_POOL_SIZE; i++) {
+		slots[i] = gInstance.mOutboundFramePool.pack(SPINEL_FRAME_PACK_CMD_NOOP);
+	}
+
+	gFrameCount = 0;
+	run_form_join_leave_cycle(form_options, join_options);
+
+	if (gFrameCount != cycle_frames) {
+		printf("%d frames from the heap, %d from the pool\n", gFrameCount, cycle_frames);
+		gErrors++;
+	}
+
+	for (int i = 0; (i < gFrameCount) && (i < cycle_frames); i++) {
+		if ( gFrames[i].from_pool
+		  || (gFrames[i].len != pool_frames[i].len)
+		  || (0 != memcmp(gFrames[i].data + 1, pool_frames[i].data + 1, gFrames[i].len - 1))
+		) {
+			printf("frame %d: mismatch\n", i);
+			gErrors++;
+		}
+	}
+
+	// An exhausted pool refuses to pack, so the caller can fall back.
+	if (gInstance.mOutboundFramePool.pack(SPINEL_FRAME_PACK_CMD_NOOP) != SpinelNCPFramePool::kNoSlot) {
+		printf("exhausted pool handed out a slot\n");
+		gErrors++;
+	}
+
+	for (int i = 0; i < SPINEL_NCP_FRAME_POOL_SIZE; i++) {
+		gInstance.mOutboundFramePool.release(slots[i]);
+	}
+
+	// So does a frame which doesn't fit in a slot.
+	memset(oversized, 0, sizeof(oversized));
+
+	if (gInstance.mOutboundFramePool.pack(SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_DATA_S), SPINEL_PROP_STREAM_RAW, oversized, sizeof(oversized)) != SpinelNCPFramePool::kNoSlot) {
+		printf("oversized frame was packed\n");
+		gErrors++;
+	}
+
+	if (gInstance.mOutboundFramePool.get_available() != SPINEL_NCP_FRAME_POOL_SIZE) {
+		printf("%d slots leaked\n", SPINEL_NCP_FRAME_POOL_SIZE - gInstance.mOutboundFramePool.get_available());
+		gErrors++;
+	}
+
+	if (gErrors != 0) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
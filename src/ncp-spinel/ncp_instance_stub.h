@@ -0,0 +1,184 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Stub `SpinelNCPInstance` for tests which run real tasks without
+ *      a tunnel interface or an NCP. It only has what the tasks use.
+ *      Include it in place of `SpinelNCPInstance.h`, then include the
+ *      `.cpp` files of the tasks under test. The test takes the place
+ *      of the data pump and the NCP: it sends whatever the task leaves
+ *      in `mOutboundFrame`, calls `mOutboundCallback`, and passes the
+ *      replies to `mCurrentTask`.
+ *
+ */
+
+#ifndef __wpantund__ncp_instance_stub__
+#define __wpantund__ncp_instance_stub__
+
+// Keeps out the real `SpinelNCPInstance.h`, which the tasks include.
+#define __wpantund__SpinelNCPInstance__
+
+#include "NCPInstanceBase.h"
+#include "SpinelNCPFramePool.h"
+#include "Callbacks.h"
+#include "FixedBlockPool.h"
+#include "SpinelNCPInstanceMacros.h"
+#include "spinel.h"
+
+namespace nl {
+namespace wpantund {
+
+class SpinelNCPTask;
+
+class SpinelNCPInstance {
+public:
+	enum DriverState {
+		INITIALIZING,
+		INITIALIZING_WAITING_FOR_RESET,
+		NORMAL_OPERATION
+	};
+
+	typedef std::list<
+		boost::shared_ptr<SpinelNCPTask>,
+		FixedBlockAllocator<boost::shared_ptr<SpinelNCPTask>, 64, 32>
+	> TaskQueue;
+
+	SpinelNCPInstance():
+		mEnabled(true), mNCPState(OFFLINE), mThreadMode(0),
+		mIsCommissioned(false), mXPANIDWasExplicitlySet(false),
+		mNetworkKeyIndex(0), mResetIsExpected(false), mDriverState(NORMAL_OPERATION),
+		mLastTID(0), mInboundHeader(0), mOutboundBufferLen(0),
+		mOutboundFrame(mOutboundBuffer), mOutboundFrameSlot(SpinelNCPFramePool::kNoSlot)
+	{
+	}
+
+	NCPState get_ncp_state() const { return mNCPState; }
+	void change_ncp_state(NCPState new_ncp_state) { mNCPState = new_ncp_state; }
+	uint32_t get_default_channel_mask(void) { return 0x07FFF800; }
+	uint8_t get_thread_mode(void) { return mThreadMode; }
+	void reinitialize_ncp(void) { }
+
+	void queue_outbound_frame(int slot)
+	{
+		mOutboundFrameSlot = slot;
+		mOutboundFrame = mOutboundFramePool.get_frame(slot);
+		mOutboundBufferLen = static_cast<spinel_ssize_t>(mOutboundFramePool.get_frame_len(slot));
+	}
+
+	void clear_outbound_frame(void)
+	{
+		mOutboundBufferLen = 0;
+
+		if (mOutboundFrameSlot != SpinelNCPFramePool::kNoSlot) {
+			mOutboundFramePool.release(mOutboundFrameSlot);
+			mOutboundFrameSlot = SpinelNCPFramePool::kNoSlot;
+			mOutboundFrame = mOutboundBuffer;
+		}
+	}
+
+	int process_event_helper(int event);
+
+	bool mEnabled;
+	NCPState mNCPState;
+	uint8_t mThreadMode;
+	bool mIsCommissioned;
+	bool mXPANIDWasExplicitlySet;
+	WPAN::NetworkInstance mCurrentNetworkInstance;
+	std::set<unsigned int> mCapabilities;
+	std::set<unsigned int> mSupprotedChannels;
+	Data mNetworkKey;
+	uint32_t mNetworkKeyIndex;
+	bool mResetIsExpected;
+	DriverState mDriverState;
+
+	uint8_t mLastTID;
+	uint8_t mInboundHeader;
+	uint8_t mOutboundBuffer[SPINEL_FRAME_BUFFER_SIZE];
+	spinel_ssize_t mOutboundBufferLen;
+	boost::function<void(int)> mOutboundCallback;
+	uint8_t* mOutboundFrame;
+	int mOutboundFrameSlot;
+	SpinelNCPFramePool mOutboundFramePool;
+
+	boost::shared_ptr<SpinelNCPTask> mCurrentTask;
+};
+
+template<class C>
+inline SpinelNCPInstance* GetInstance(C *x)
+{
+	return x->mInstance;
+}
+
+template<>
+inline SpinelNCPInstance* GetInstance<SpinelNCPInstance>(SpinelNCPInstance *x)
+{
+	return x;
+}
+
+int peek_ncp_callback_status(int event, va_list args);
+
+int spinel_status_to_wpantund_status(int spinel_status);
+
+}; // namespace wpantund
+}; // namespace nl
+
+#include "SpinelNCPTask.h"
+
+inline int
+nl::wpantund::peek_ncp_callback_status(int event, va_list args)
+{
+	int ret = 0;
+
+	if (EVENT_NCP_PROP_VALUE_IS == event) {
+		va_list tmp;
+		va_copy(tmp, args);
+		unsigned int key = va_arg(tmp, unsigned int);
+		if (SPINEL_PROP_LAST_STATUS == key) {
+			const uint8_t* spinel_data_ptr = va_arg(tmp, const uint8_t*);
+			spinel_size_t spinel_data_len = va_arg(tmp, spinel_size_t);
+
+			if (spinel_datatype_unpack(spinel_data_ptr, spinel_data_len, "i", &ret) <= 0) {
+				ret = SPINEL_STATUS_PARSE_ERROR;
+			}
+		}
+		va_end(tmp);
+	} else if (EVENT_NCP_RESET == event) {
+		va_list tmp;
+		va_copy(tmp, args);
+		ret = va_arg(tmp, int);
+		va_end(tmp);
+	}
+
+	return ret;
+}
+
+inline int
+nl::wpantund::spinel_status_to_wpantund_status(int spinel_status)
+{
+	return spinel_status ? kWPANTUNDStatus_Failure : kWPANTUNDStatus_Ok;
+}
+
+inline int
+nl::wpantund::SpinelNCPInstance::process_event_helper(int event)
+{
+	if (mCurrentTask) {
+		return mCurrentTask->process_event(event);
+	}
+	return 0;
+}
+
+#endif /* defined(__wpantund__ncp_instance_stub__) */
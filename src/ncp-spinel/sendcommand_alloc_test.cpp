@@ -0,0 +1,349 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Runs single-command `SpinelNCPTaskSendCommand` gets and sets
+ *      through a whole round trip (sent to a stub NCP, answered, and
+ *      their callbacks called) and verifies that the heap is only used
+ *      for the `boost::any` holding a get's value. Also verifies that
+ *      tasks which are dropped without running don't touch the heap
+ *      either, and that an exhausted task pool falls back to the heap.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+// The tasks are built below against a stub instead of the real
+// `SpinelNCPInstance`, with this test taking the place of the data
+// pump and the NCP.
+#include "ncp_instance_stub.h"
+
+#include "SpinelNCPTask.cpp"
+#include "SpinelNCPTaskSendCommand.cpp"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+static bool gCountAllocations = false;
+static int gAllocationCount = 0;
+
+void* operator new(size_t size)
+{
+	void* ptr;
+
+	if (gCountAllocations) {
+		gAllocationCount++;
+	}
+
+	ptr = malloc(size ? size : 1);
+
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void operator delete(void* ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) throw()
+{
+	(void)size;
+	free(ptr);
+}
+
+#define MAX_TASK_FRAMES 8
+
+static SpinelNCPInstance gInstance;
+static int gCallbackCount = 0;
+static int gLastStatus = 0;
+static int gLastChannel = -1;
+static int gFrameCount = 0;
+static int gErrors = 0;
+
+static void
+value_callback(int status, const boost::any& value)
+{
+	const uint8_t* channel = boost::any_cast<uint8_t>(&value);
+
+	gCallbackCount++;
+	gLastStatus = status;
+	gLastChannel = (channel != NULL) ? *channel : -1;
+}
+
+static void
+status_callback(int status)
+{
+	gCallbackCount++;
+	gLastStatus = status;
+}
+
+// Answers the frame that was just sent the way an NCP would: a get
+// with channel 11, and a set with the value that was set.
+static void
+respond_to_frame(const uint8_t* frame, spinel_size_t frame_len)
+{
+	static const uint8_t kChannel[] = { 11 };
+	uint8_t header = 0;
+	unsigned int command = 0;
+	unsigned int key = 0;
+	const uint8_t* value_ptr = NULL;
+	spinel_size_t value_len = 0;
+
+	spinel_datatype_unpack(frame, frame_len, "Cii", &header, &command, &key);
+
+	if (command == SPINEL_CMD_PROP_VALUE_GET) {
+		value_ptr = kChannel;
+		value_len = sizeof(kChannel);
+	} else {
+		spinel_datatype_unpack(frame, frame_len, "CiiD", NULL, NULL, NULL, &value_ptr, &value_len);
+	}
+
+	gInstance.mInboundHeader = header;
+	gInstance.mCurrentTask->process_event(EVENT_NCP_PROP_VALUE_IS, key, value_ptr, value_len);
+}
+
+// Plays the data pump and the NCP until the task has sent everything.
+static void
+run_task(const boost::shared_ptr<SpinelNCPTask>& task)
+{
+	uint8_t frame[SPINEL_FRAME_BUFFER_SIZE];
+	spinel_size_t frame_len;
+
+	gInstance.mCurrentTask = task;
+
+	task->process_event(EVENT_STARTING_TASK);
+	task->process_event(EVENT_IDLE);
+
+	for (int i = 0; i < MAX_TASK_FRAMES; i++) {
+		if ((gInstance.mOutboundBufferLen <= 0) || gInstance.mOutboundCallback.empty()) {
+			break;
+		}
+
+		frame_len = static_cast<spinel_size_t>(gInstance.mOutboundBufferLen);
+		memcpy(frame, gInstance.mOutboundFrame, frame_len);
+		gFrameCount++;
+
+		gInstance.clear_outbound_frame();
+		gInstance.mOutboundCallback(kWPANTUNDStatus_Ok);
+		gInstance.mOutboundCallback.clear();
+
+		respond_to_frame(frame, frame_len);
+	}
+
+	gInstance.mCurrentTask.reset();
+}
+
+static boost::shared_ptr<SpinelNCPTask>
+make_get_task(void)
+{
+	return SpinelNCPTaskSendCommand::Factory(&gInstance)
+		.set_callback(CallbackWithStatusArg1(&value_callback))
+		.add_packed_command(SPINEL_FRAME_PACK_CMD_PROP_VALUE_GET, SPINEL_PROP_PHY_CHAN)
+		.set_reply_format(SPINEL_DATATYPE_UINT8_S)
+		.finish();
+}
+
+static boost::shared_ptr<SpinelNCPTask>
+make_set_task(int lock_property)
+{
+	return SpinelNCPTaskSendCommand::Factory(&gInstance)
+		.set_callback(CallbackWithStatus(&status_callback))
+		.add_packed_command(
+			SPINEL_FRAME_PACK_CMD_PROP_VALUE_SET(SPINEL_DATATYPE_UINT8_S),
+			SPINEL_PROP_PHY_CHAN,
+			11
+		)
+		.set_lock_property(lock_property)
+		.finish();
+}
+
+static void
+issue_get_and_set(SpinelNCPInstance::TaskQueue& queue)
+{
+	queue.push_back(make_get_task());
+	queue.push_back(make_set_task(0));
+
+	while (!queue.empty()) {
+		queue.pop_front();
+	}
+}
+
+// Returns the number of heap allocations made by `run_task()` for
+// `iterations` tasks from `make_task`, checking that each one finished.
+static int
+count_round_trip_allocations(boost::shared_ptr<SpinelNCPTask> (*make_task)(void), int iterations, int frames_per_task)
+{
+	int allocations = 0;
+
+	gCallbackCount = 0;
+	gFrameCount = 0;
+
+	for (int i = 0; i < iterations; i++) {
+		boost::shared_ptr<SpinelNCPTask> task(make_task());
+
+		gAllocationCount = 0;
+		gCountAllocations = true;
+
+		run_task(task);
+		task.reset();
+
+		gCountAllocations = false;
+		allocations += gAllocationCount;
+
+		if (gLastStatus != kWPANTUNDStatus_Ok) {
+			printf("round trip %d: status %d\n", i, gLastStatus);
+			gErrors++;
+		}
+	}
+
+	if ((gCallbackCount != iterations) || (gFrameCount != iterations * frames_per_task)) {
+		printf("%d callbacks and %d frames for %d round trips\n", gCallbackCount, gFrameCount, iterations);
+		gErrors++;
+	}
+
+	return allocations;
+}
+
+static boost::shared_ptr<SpinelNCPTask>
+make_plain_set_task(void)
+{
+	return make_set_task(0);
+}
+
+static boost::shared_ptr<SpinelNCPTask>
+make_locked_set_task(void)
+{
+	return make_set_task(SPINEL_PROP_THREAD_ALLOW_LOCAL_NET_DATA_CHANGE);
+}
+
+int main(void)
+{
+	static const int kIterations = 1000;
+	SpinelNCPInstance::TaskQueue queue;
+	int value_allocations;
+	int allocations;
+
+	// Warm up, so that one-time initialization isn't counted.
+	issue_get_and_set(queue);
+	run_task(make_get_task());
+	run_task(make_locked_set_task());
+
+	// Tasks which are dropped without running only cancel their callback.
+	gCallbackCount = 0;
+	gAllocationCount = 0;
+	gCountAllocations = true;
+
+	for (int i = 0; i < kIterations; i++) {
+		issue_get_and_set(queue);
+	}
+
+	gCountAllocations = false;
+
+	if (gAllocationCount != 0) {
+		printf("%d heap allocations for %d dropped get/set tasks\n", gAllocationCount, 2 * kIterations);
+		gErrors++;
+	}
+
+	if ((gCallbackCount != 2 * kIterations) || (gLastStatus != kWPANTUNDStatus_Canceled)) {
+		printf("callback was called %d times, last status %d\n", gCallbackCount, gLastStatus);
+		gErrors++;
+	}
+
+	// A get's value is handed over in a `boost::any`, which always
+	// holds it on the heap. That is the only allocation it may make.
+	gAllocationCount = 0;
+	gCountAllocations = true;
+	{
+		boost::any value(static_cast<uint8_t>(11));
+	}
+	gCountAllocations = false;
+	value_allocations = gAllocationCount;
+
+	allocations = count_round_trip_allocations(&make_get_task, kIterations, 1);
+
+	if (allocations != kIterations * value_allocations) {
+		printf("%d heap allocations for %d get round trips\n", allocations, kIterations);
+		gErrors++;
+	}
+
+	if (gLastChannel != 11) {
+		printf("get returned the wrong value\n");
+		gErrors++;
+	}
+
+	// A set makes no allocations at all, including the lock property
+	// being set and cleared around it.
+	allocations = count_round_trip_allocations(&make_plain_set_task, kIterations, 1);
+
+	if (allocations != 0) {
+		printf("%d heap allocations for %d set round trips\n", allocations, kIterations);
+		gErrors++;
+	}
+
+	allocations = count_round_trip_allocations(&make_locked_set_task, kIterations, 3);
+
+	if (allocations != 0) {
+		printf("%d heap allocations for %d locked set round trips\n", allocations, kIterations);
+		gErrors++;
+	}
+
+	if (gInstance.mOutboundFramePool.get_available() != SPINEL_NCP_FRAME_POOL_SIZE) {
+		printf("%d frame pool slots leaked\n", SPINEL_NCP_FRAME_POOL_SIZE - gInstance.mOutboundFramePool.get_available());
+		gErrors++;
+	}
+
+	// Exhausting the pool falls back to the heap rather than failing.
+	{
+		std::list<boost::shared_ptr<SpinelNCPTask> > tasks;
+		Data large_command(2 * SpinelNCPTaskSendCommand::kInlineCommandSize);
+
+		large_command[0] = SPINEL_HEADER_FLAG;
+		large_command[1] = SPINEL_CMD_NOOP;
+
+		for (int i = 0; i < 2 * SpinelNCPTaskSendCommand::kTaskPoolSize; i++) {
+			tasks.push_back(SpinelNCPTaskSendCommand::Factory(&gInstance)
+				.add_command(large_command)
+				.add_packed_command(SPINEL_FRAME_PACK_CMD_NOOP)
+				.finish()
+			);
+
+			if (!tasks.back()) {
+				printf("task allocation %d failed\n", i);
+				gErrors++;
+			}
+		}
+	}
+
+	if (gErrors != 0) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
@@ -35,6 +35,7 @@
 #include <exception>
 #include <stdexcept>
 #include "ValueMap.h"
+#include "ValueType.h"
 
 using namespace DBUSHelpers;
 
@@ -153,140 +154,231 @@ DBUSHelpers::any_from_dbus_iter(DBusMessageIter *iter)
 	return ret;
 }
 
-void
-DBUSHelpers::append_any_to_dbus_iter(
-    DBusMessageIter *iter, const boost::any &value
-    )
+// D-Bus signature for a value of the given type, or NULL if it
+// can't be sent over D-Bus.
+static const char*
+dbus_signature_of(nl::ValueType type)
 {
-	if (value.type() == typeid(std::string)) {
-		std::string v = boost::any_cast<std::string>(value);
-		const char* cstr = v.c_str();
+	switch (type) {
+	case nl::kValueType_String:
+	case nl::kValueType_CString:
+		return DBUS_TYPE_STRING_AS_STRING;
+
+	case nl::kValueType_Bool:
+		return DBUS_TYPE_BOOLEAN_AS_STRING;
+
+	case nl::kValueType_UInt8:
+		return DBUS_TYPE_BYTE_AS_STRING;
+
+	case nl::kValueType_Int8:
+	case nl::kValueType_Int16:
+		return DBUS_TYPE_INT16_AS_STRING;
+
+	case nl::kValueType_UInt16:
+		return DBUS_TYPE_UINT16_AS_STRING;
+
+	case nl::kValueType_UInt32:
+		return DBUS_TYPE_UINT32_AS_STRING;
+
+	case nl::kValueType_Int32:
+		return DBUS_TYPE_INT32_AS_STRING;
+
+	case nl::kValueType_UInt64:
+		return DBUS_TYPE_UINT64_AS_STRING;
+
+	case nl::kValueType_Int64:
+		return DBUS_TYPE_INT64_AS_STRING;
+
+	case nl::kValueType_Double:
+	case nl::kValueType_Float:
+		return DBUS_TYPE_DOUBLE_AS_STRING;
+
+	case nl::kValueType_Data:
+	case nl::kValueType_ByteVector:
+		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_BYTE_AS_STRING;
+
+	case nl::kValueType_StringList:
+	case nl::kValueType_StringSet:
+		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_STRING_AS_STRING;
+
+	case nl::kValueType_IntSet:
+		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_INT32_AS_STRING;
+
+	case nl::kValueType_ValueMap:
+		return DBUS_TYPE_ARRAY_AS_STRING
+			DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+				DBUS_TYPE_STRING_AS_STRING
+				DBUS_TYPE_VARIANT_AS_STRING
+			DBUS_DICT_ENTRY_END_CHAR_AS_STRING;
+
+	case nl::kValueType_ValueMapList:
+		return DBUS_TYPE_ARRAY_AS_STRING
+			DBUS_TYPE_ARRAY_AS_STRING
+				DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					DBUS_TYPE_STRING_AS_STRING
+					DBUS_TYPE_VARIANT_AS_STRING
+				DBUS_DICT_ENTRY_END_CHAR_AS_STRING;
+
+	default:
+		return NULL;
+	}
+}
+
+template <typename T>
+static void
+append_string_array(DBusMessageIter *iter, const T& container)
+{
+	DBusMessageIter array_iter;
+	typename T::const_iterator container_iter;
+
+	dbus_message_iter_open_container(
+	    iter,
+	    DBUS_TYPE_ARRAY,
+	    DBUS_TYPE_STRING_AS_STRING,
+	    &array_iter
+	    );
+
+	for (container_iter = container.begin();
+	     container_iter != container.end();
+	     container_iter++) {
+		const char* cstr = container_iter->c_str();
+		dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING,
+		                               &cstr);
+	}
+
+	dbus_message_iter_close_container(iter, &array_iter);
+}
+
+static void
+append_byte_array(DBusMessageIter *iter, const uint8_t* bytes, int len)
+{
+	DBusMessageIter array_iter;
+
+	dbus_message_iter_open_container(
+	    iter,
+	    DBUS_TYPE_ARRAY,
+	    DBUS_TYPE_BYTE_AS_STRING,
+	    &array_iter
+	    );
+
+	dbus_message_iter_append_fixed_array(&array_iter, DBUS_TYPE_BYTE, &bytes, len);
+
+	dbus_message_iter_close_container(iter, &array_iter);
+}
+
+static void
+append_value_map(DBusMessageIter *iter, const nl::ValueMap& value_map)
+{
+	DBusMessageIter array_iter;
+	nl::ValueMap::const_iterator value_map_iter;
+
+	// Open a container as "Dictionary/Array of Strings to Variants" (dbus type "a{sv}")
+	dbus_message_iter_open_container(
+		iter,
+		DBUS_TYPE_ARRAY,
+		DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+			DBUS_TYPE_STRING_AS_STRING
+			DBUS_TYPE_VARIANT_AS_STRING
+		DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+		&array_iter
+		);
+
+	for (value_map_iter = value_map.begin(); value_map_iter != value_map.end(); ++value_map_iter) {
+		append_dict_entry(&array_iter, value_map_iter->first.c_str(), value_map_iter->second);
+	}
+
+	dbus_message_iter_close_container(iter, &array_iter);
+}
+
+static void
+append_typed_value(DBusMessageIter *iter, nl::ValueType type, const boost::any &value)
+{
+	switch (type) {
+	case nl::kValueType_String: {
+		const char* cstr = nl::value_cast<std::string>(value).c_str();
 		dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &cstr);
-	} else if (value.type() == typeid(char*)) {
-		std::string v = boost::any_cast<char*>(value);
-		const char* cstr = v.c_str();
+		break;
+	}
+
+	case nl::kValueType_CString: {
+		const char* cstr = nl::value_cast<char*>(value);
 		dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &cstr);
-	} else if (value.type() == typeid(bool)) {
-		dbus_bool_t v = boost::any_cast<bool>(value);
+		break;
+	}
+
+	case nl::kValueType_Bool: {
+		dbus_bool_t v = nl::value_cast<bool>(value);
 		dbus_message_iter_append_basic(iter, DBUS_TYPE_BOOLEAN, &v);
-	} else if (value.type() == typeid(uint8_t)) {
-		uint8_t v = boost::any_cast<uint8_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_BYTE, &v);
-	} else if (value.type() == typeid(int8_t)) {
-		int16_t v = boost::any_cast<int8_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT16, &v);
-	} else if (value.type() == typeid(uint16_t)) {
-		uint16_t v = boost::any_cast<uint16_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT16, &v);
-	} else if (value.type() == typeid(int16_t)) {
-		int16_t v = boost::any_cast<int16_t>(value);
+		break;
+	}
+
+	case nl::kValueType_UInt8:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_BYTE, &nl::value_cast<uint8_t>(value));
+		break;
+
+	case nl::kValueType_Int8: {
+		int16_t v = nl::value_cast<int8_t>(value);
 		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT16, &v);
-	} else if (value.type() == typeid(uint32_t)) {
-		uint32_t v = boost::any_cast<uint32_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32, &v);
-	} else if (value.type() == typeid(int32_t)) {
-		int32_t v = boost::any_cast<int32_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT32, &v);
-	} else if (value.type() == typeid(uint64_t)) {
-		uint64_t v = boost::any_cast<uint64_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT64, &v);
-	} else if (value.type() == typeid(int64_t)) {
-		int64_t v = boost::any_cast<int64_t>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT64, &v);
-	} else if (value.type() == typeid(double)) {
-		double v = boost::any_cast<double>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_DOUBLE, &v);
-	} else if (value.type() == typeid(float)) {
-		double v = boost::any_cast<float>(value);
-		dbus_message_iter_append_basic(iter, DBUS_TYPE_DOUBLE, &v);
-	} else if (value.type() == typeid(std::list<std::string>)) {
-		DBusMessageIter array_iter;
-		const std::list<std::string>& list_of_strings =
-		    boost::any_cast< std::list<std::string> >(value);
-		std::list<std::string>::const_iterator list_iter;
-		dbus_message_iter_open_container(
-		    iter,
-		    DBUS_TYPE_ARRAY,
-		    DBUS_TYPE_STRING_AS_STRING,
-		    &array_iter
-		    );
+		break;
+	}
 
-		for (list_iter = list_of_strings.begin();
-		     list_iter != list_of_strings.end();
-		     list_iter++) {
-			const char* cstr = list_iter->c_str();
-			dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING,
-			                               &cstr);
-		}
+	case nl::kValueType_UInt16:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT16, &nl::value_cast<uint16_t>(value));
+		break;
 
-		dbus_message_iter_close_container(iter, &array_iter);
+	case nl::kValueType_Int16:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT16, &nl::value_cast<int16_t>(value));
+		break;
 
-	} else if (value.type() == typeid(std::set<std::string>)) {
-		DBusMessageIter array_iter;
-		const std::set<std::string>& set_of_strings =
-		    boost::any_cast< std::set<std::string> >(value);
-		std::set<std::string>::const_iterator set_iter;
-		dbus_message_iter_open_container(
-		    iter,
-		    DBUS_TYPE_ARRAY,
-		    DBUS_TYPE_STRING_AS_STRING,
-		    &array_iter
-		    );
+	case nl::kValueType_UInt32:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT32, &nl::value_cast<uint32_t>(value));
+		break;
 
-		for (set_iter = set_of_strings.begin();
-		     set_iter != set_of_strings.end();
-		     set_iter++) {
-			const char* cstr = set_iter->c_str();
-			dbus_message_iter_append_basic(&array_iter, DBUS_TYPE_STRING,
-			                               &cstr);
-		}
+	case nl::kValueType_Int32:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT32, &nl::value_cast<int32_t>(value));
+		break;
 
-		dbus_message_iter_close_container(iter, &array_iter);
-	} else if (value.type() == typeid(nl::Data)) {
-		DBusMessageIter array_iter;
-		const nl::Data& vector = boost::any_cast< nl::Data >(value);
-		nl::Data::const_iterator vector_iter;
-		dbus_message_iter_open_container(
-		    iter,
-		    DBUS_TYPE_ARRAY,
-		    DBUS_TYPE_BYTE_AS_STRING,
-		    &array_iter
-		    );
+	case nl::kValueType_UInt64:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_UINT64, &nl::value_cast<uint64_t>(value));
+		break;
 
-		for (vector_iter = vector.begin();
-		     vector_iter != vector.end();
-		     vector_iter++) {
-			dbus_message_iter_append_basic(&array_iter,
-			                               DBUS_TYPE_BYTE,
-			                               &*vector_iter);
-		}
+	case nl::kValueType_Int64:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_INT64, &nl::value_cast<int64_t>(value));
+		break;
 
-		dbus_message_iter_close_container(iter, &array_iter);
-	} else if (value.type() == typeid(std::vector<uint8_t>)) {
-		DBusMessageIter array_iter;
-		const std::vector<uint8_t>& vector =
-		    boost::any_cast< std::vector<uint8_t> >(value);
-		std::vector<uint8_t>::const_iterator vector_iter;
-		dbus_message_iter_open_container(
-		    iter,
-		    DBUS_TYPE_ARRAY,
-		    DBUS_TYPE_BYTE_AS_STRING,
-		    &array_iter
-		    );
+	case nl::kValueType_Double:
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_DOUBLE, &nl::value_cast<double>(value));
+		break;
 
-		for (vector_iter = vector.begin();
-		     vector_iter != vector.end();
-		     vector_iter++) {
-			dbus_message_iter_append_basic(&array_iter,
-			                               DBUS_TYPE_BYTE,
-			                               &*vector_iter);
-		}
+	case nl::kValueType_Float: {
+		double v = nl::value_cast<float>(value);
+		dbus_message_iter_append_basic(iter, DBUS_TYPE_DOUBLE, &v);
+		break;
+	}
 
-		dbus_message_iter_close_container(iter, &array_iter);
-	} else if (value.type() == typeid(std::set<int>)) {
+	case nl::kValueType_StringList:
+		append_string_array(iter, nl::value_cast< std::list<std::string> >(value));
+		break;
+
+	case nl::kValueType_StringSet:
+		append_string_array(iter, nl::value_cast< std::set<std::string> >(value));
+		break;
+
+	case nl::kValueType_Data: {
+		const nl::Data& data = nl::value_cast<nl::Data>(value);
+		append_byte_array(iter, data.data(), static_cast<int>(data.size()));
+		break;
+	}
+
+	case nl::kValueType_ByteVector: {
+		const std::vector<uint8_t>& vector = nl::value_cast< std::vector<uint8_t> >(value);
+		append_byte_array(iter, vector.empty() ? NULL : &vector[0], static_cast<int>(vector.size()));
+		break;
+	}
+
+	case nl::kValueType_IntSet: {
 		DBusMessageIter array_iter;
-		const std::set<int>& container =
-		    boost::any_cast< std::set<int> >(value);
+		const std::set<int>& container = nl::value_cast< std::set<int> >(value);
 		std::set<int>::const_iterator container_iter;
 		dbus_message_iter_open_container(
 		    iter,
@@ -304,30 +396,16 @@ DBUSHelpers::append_any_to_dbus_iter(
 		}
 
 		dbus_message_iter_close_container(iter, &array_iter);
-	} else if (value.type() == typeid(nl::ValueMap)) {
-		DBusMessageIter array_iter;
-		const nl::ValueMap& value_map = boost::any_cast<nl::ValueMap>(value);
-		nl::ValueMap::const_iterator value_map_iter;
-
-		// Open a container as "Dictionary/Array of Strings to Variants" (dbus type "a{sv}")
-		dbus_message_iter_open_container(
-			iter,
-			DBUS_TYPE_ARRAY,
-			DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
-				DBUS_TYPE_STRING_AS_STRING
-				DBUS_TYPE_VARIANT_AS_STRING
-			DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
-			&array_iter
-			);
+		break;
+	}
 
-		for (value_map_iter = value_map.begin(); value_map_iter != value_map.end(); ++value_map_iter) {
-			append_dict_entry(&array_iter, value_map_iter->first.c_str(), value_map_iter->second);
-		}
+	case nl::kValueType_ValueMap:
+		append_value_map(iter, nl::value_cast<nl::ValueMap>(value));
+		break;
 
-		dbus_message_iter_close_container(iter, &array_iter);
-	} else if (value.type() == typeid(std::list<nl::ValueMap>)) {
+	case nl::kValueType_ValueMapList: {
 		DBusMessageIter array_iter;
-		const std::list<nl::ValueMap>& value_map_list = boost::any_cast< std::list<nl::ValueMap> >(value);
+		const std::list<nl::ValueMap>& value_map_list = nl::value_cast< std::list<nl::ValueMap> >(value);
 		std::list<nl::ValueMap>::const_iterator list_iter;
 
 		// Open a container as "Array of Dictionaries/Arrays of Strings to Variants" (dbus type "aa{sv}")
@@ -343,66 +421,32 @@ DBUSHelpers::append_any_to_dbus_iter(
 			);
 
 		for (list_iter = value_map_list.begin(); list_iter != value_map_list.end(); ++list_iter) {
-			append_any_to_dbus_iter(&array_iter, *list_iter);
+			append_value_map(&array_iter, *list_iter);
 		}
 
 		dbus_message_iter_close_container(iter, &array_iter);
-	} else {
+		break;
+	}
+
+	default:
 		throw std::invalid_argument("Unsupported type");
 	}
 }
 
+void
+DBUSHelpers::append_any_to_dbus_iter(
+    DBusMessageIter *iter, const boost::any &value
+    )
+{
+	append_typed_value(iter, nl::value_type_of(value), value);
+}
+
 std::string
 DBUSHelpers::any_to_dbus_type_string(const boost::any &value)
 {
-	if (value.type() == typeid(std::string)) {
-		return DBUS_TYPE_STRING_AS_STRING;
-	} else if (value.type() == typeid(bool)) {
-		return DBUS_TYPE_BOOLEAN_AS_STRING;
-	} else if (value.type() == typeid(uint8_t)) {
-		return DBUS_TYPE_BYTE_AS_STRING;
-	} else if (value.type() == typeid(int8_t)) {
-		return DBUS_TYPE_INT16_AS_STRING;
-	} else if (value.type() == typeid(uint16_t)) {
-		return DBUS_TYPE_UINT16_AS_STRING;
-	} else if (value.type() == typeid(int16_t)) {
-		return DBUS_TYPE_INT16_AS_STRING;
-	} else if (value.type() == typeid(uint32_t)) {
-		return DBUS_TYPE_UINT32_AS_STRING;
-	} else if (value.type() == typeid(int32_t)) {
-		return DBUS_TYPE_INT32_AS_STRING;
-	} else if (value.type() == typeid(uint64_t)) {
-		return DBUS_TYPE_UINT64_AS_STRING;
-	} else if (value.type() == typeid(int64_t)) {
-		return DBUS_TYPE_INT64_AS_STRING;
-	} else if (value.type() == typeid(double)) {
-		return DBUS_TYPE_DOUBLE_AS_STRING;
-	} else if (value.type() == typeid(float)) {
-		return DBUS_TYPE_DOUBLE_AS_STRING;
-	} else if (value.type() == typeid(nl::Data)) {
-		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_BYTE_AS_STRING;
-	} else if (value.type() == typeid(std::vector<uint8_t>)) {
-		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_BYTE_AS_STRING;
-	} else if (value.type() == typeid(std::list<std::string>)) {
-		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_STRING_AS_STRING;
-	} else if (value.type() == typeid(std::set<std::string>)) {
-		return DBUS_TYPE_ARRAY_AS_STRING DBUS_TYPE_STRING_AS_STRING;
-	} else if (value.type() == typeid(nl::ValueMap)) {
-		return std::string(DBUS_TYPE_ARRAY_AS_STRING) +
-					DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING +
-						DBUS_TYPE_STRING_AS_STRING +
-						DBUS_TYPE_VARIANT_AS_STRING +
-					DBUS_DICT_ENTRY_END_CHAR_AS_STRING;
-	} else if (value.type() == typeid(std::list<nl::ValueMap>)) {
-		return  std::string(DBUS_TYPE_ARRAY_AS_STRING) +
-					DBUS_TYPE_ARRAY_AS_STRING +
-						DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING +
-							DBUS_TYPE_STRING_AS_STRING +
-							DBUS_TYPE_VARIANT_AS_STRING +
-						DBUS_DICT_ENTRY_END_CHAR_AS_STRING;
-	}
+	const char* signature = dbus_signature_of(nl::value_type_of(value));
 
-	return "";
+	return signature ? signature : "";
 }
 
 void
@@ -412,16 +456,17 @@ DBUSHelpers::append_dict_entry(
 {
 	DBusMessageIter entry;
 	DBusMessageIter value_iter;
-	std::string sig = any_to_dbus_type_string(value);
+	nl::ValueType type = nl::value_type_of(value);
+	const char* sig = dbus_signature_of(type);
 
 	dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
 
 	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
 
 	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT,
-	                                 sig.c_str(), &value_iter);
+	                                 sig ? sig : "", &value_iter);
 
-	append_any_to_dbus_iter(&value_iter, value);
+	append_typed_value(&value_iter, type, value);
 
 	dbus_message_iter_close_container(&entry, &value_iter);
 
@@ -0,0 +1,220 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Fixed-size block pool and a matching STL allocator (not thread-safe)
+ *
+ */
+
+#ifndef wpantund_FixedBlockPool_h
+#define wpantund_FixedBlockPool_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+
+namespace nl {
+
+// NOTE: The below implementation of FixedBlockPool<> is NOT thread-safe.
+
+// A pool of `C` raw memory blocks of `S` bytes each. Unlike `ObjectPool<>`
+// the free list is kept inside the unused blocks themselves, so neither
+// allocating nor freeing a block touches the heap.
+template <size_t S, int C>
+class FixedBlockPool
+{
+public:
+	typedef int size_type;
+
+	static const size_t block_size = S;
+	static const size_type block_count = C;
+
+public:
+	FixedBlockPool()
+	{
+		free_all();
+	}
+
+	// Returns the pool instance shared by every user of this block geometry.
+	static FixedBlockPool& shared(void)
+	{
+		static FixedBlockPool sPool;
+		return sPool;
+	}
+
+	void free_all(void)
+	{
+		mFreeList = NULL;
+
+		for (size_type i = block_count; i > 0; i--) {
+			mBlocks[i - 1].mNext = mFreeList;
+			mFreeList = &mBlocks[i - 1];
+		}
+
+		mAvailable = block_count;
+	}
+
+	// Returns a block of at least `size` bytes, or NULL if `size` is
+	// larger than `block_size` or if the pool is exhausted.
+	void* alloc(size_t size)
+	{
+		Block* block = NULL;
+
+		if ((size <= block_size) && (mFreeList != NULL)) {
+			block = mFreeList;
+			mFreeList = block->mNext;
+			mAvailable--;
+		}
+
+		return block;
+	}
+
+	void free(void* ptr)
+	{
+		if (owns(ptr)) {
+			Block* block = static_cast<Block*>(ptr);
+			block->mNext = mFreeList;
+			mFreeList = block;
+			mAvailable++;
+		}
+	}
+
+	bool owns(const void* ptr) const
+	{
+		return (ptr >= static_cast<const void*>(&mBlocks[0]))
+		    && (ptr < static_cast<const void*>(&mBlocks[block_count]));
+	}
+
+	size_type available(void) const
+	{
+		return mAvailable;
+	}
+
+private:
+	union Block {
+		Block* mNext;
+		uint8_t mBytes[block_size];
+
+		// Only present to force worst-case alignment.
+		long double mAlignLongDouble;
+		long long mAlignLongLong;
+		void (*mAlignFuncPtr)(void);
+	};
+
+	Block mBlocks[block_count];
+	Block* mFreeList;
+	size_type mAvailable;
+};
+
+// STL-compatible allocator which serves single-element allocations of up
+// to `S` bytes out of `FixedBlockPool<S, C>::shared()` and transparently
+// falls back to the heap for anything else (array allocations, objects
+// that don't fit in a block, or an exhausted pool).
+template <typename T, size_t S, int C>
+class FixedBlockAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	typedef FixedBlockPool<S, C> pool_type;
+
+	template <typename U>
+	struct rebind {
+		typedef FixedBlockAllocator<U, S, C> other;
+	};
+
+public:
+	FixedBlockAllocator() { }
+
+	template <typename U>
+	FixedBlockAllocator(const FixedBlockAllocator<U, S, C>&) { }
+
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void* hint = 0)
+	{
+		void* ptr = NULL;
+
+		(void)hint;
+
+		if (n == 1) {
+			ptr = pool_type::shared().alloc(sizeof(T));
+		}
+
+		if (ptr == NULL) {
+			ptr = ::operator new(n * sizeof(T));
+		}
+
+		return static_cast<pointer>(ptr);
+	}
+
+	void deallocate(pointer ptr, size_type n)
+	{
+		(void)n;
+
+		if (pool_type::shared().owns(ptr)) {
+			pool_type::shared().free(ptr);
+		} else {
+			::operator delete(ptr);
+		}
+	}
+
+	size_type max_size(void) const
+	{
+		return static_cast<size_type>(-1) / sizeof(T);
+	}
+
+	void construct(pointer ptr, const T& value)
+	{
+		new (static_cast<void*>(ptr)) T(value);
+	}
+
+#if __cplusplus >= 201103L
+	// Without this, `allocate_shared()` constructs a temporary and copies
+	// it into place, which runs the temporary's destructor.
+	template <typename U, typename... Args>
+	void construct(U* ptr, Args&&... args)
+	{
+		new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+	}
+#endif
+
+	void destroy(pointer ptr)
+	{
+		ptr->~T();
+	}
+
+	template <typename U>
+	bool operator==(const FixedBlockAllocator<U, S, C>&) const { return true; }
+
+	template <typename U>
+	bool operator!=(const FixedBlockAllocator<U, S, C>&) const { return false; }
+};
+
+}; // namespace nl
+
+#endif // wpantund_FixedBlockPool_h
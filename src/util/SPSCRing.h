@@ -0,0 +1,129 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Lock-free single-producer/single-consumer ring of fixed-size slots
+ *
+ */
+
+#ifndef wpantund_SPSCRing_h
+#define wpantund_SPSCRing_h
+
+#include <stdint.h>
+
+namespace nl {
+
+// A bounded queue shared between exactly one producer thread and exactly
+// one consumer thread. Slots are written and read in place, so large
+// entries (like whole frames) are never copied through the queue.
+//
+// Producer side:
+//
+//     T* slot = ring.begin_write();
+//     if (slot != NULL) { ...fill in *slot...; ring.commit_write(); }
+//
+// Consumer side:
+//
+//     T* slot = ring.begin_read();
+//     if (slot != NULL) { ...use *slot...; ring.commit_read(); }
+//
+// `N` must be a power of two.
+template <typename T, uint32_t N>
+class SPSCRing
+{
+	typedef char N_must_be_a_power_of_two[((N != 0) && ((N & (N - 1)) == 0)) ? 1 : -1];
+
+public:
+	SPSCRing(): mHead(0), mTail(0) { }
+
+	// Only safe to call while neither side is using the ring.
+	void clear(void)
+	{
+		mHead = mTail = 0;
+	}
+
+	bool empty(void) const
+	{
+		return __atomic_load_n(&mTail, __ATOMIC_ACQUIRE) == __atomic_load_n(&mHead, __ATOMIC_ACQUIRE);
+	}
+
+	bool full(void) const
+	{
+		return size() >= N;
+	}
+
+	uint32_t size(void) const
+	{
+		return __atomic_load_n(&mTail, __ATOMIC_ACQUIRE) - __atomic_load_n(&mHead, __ATOMIC_ACQUIRE);
+	}
+
+	static uint32_t capacity(void)
+	{
+		return N;
+	}
+
+	// Producer: Returns the next free slot, or NULL if the ring is full.
+	T* begin_write(void)
+	{
+		const uint32_t tail = __atomic_load_n(&mTail, __ATOMIC_RELAXED);
+
+		if (tail - __atomic_load_n(&mHead, __ATOMIC_ACQUIRE) >= N) {
+			return NULL;
+		}
+
+		return &mSlots[tail & (N - 1)];
+	}
+
+	// Producer: Publishes the slot returned by `begin_write()`.
+	void commit_write(void)
+	{
+		__atomic_store_n(&mTail, __atomic_load_n(&mTail, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+	}
+
+	// Consumer: Returns the oldest published slot, or NULL if empty.
+	T* begin_read(void)
+	{
+		const uint32_t head = __atomic_load_n(&mHead, __ATOMIC_RELAXED);
+
+		if (__atomic_load_n(&mTail, __ATOMIC_ACQUIRE) == head) {
+			return NULL;
+		}
+
+		return &mSlots[head & (N - 1)];
+	}
+
+	// Consumer: Releases the slot returned by `begin_read()`.
+	void commit_read(void)
+	{
+		__atomic_store_n(&mHead, __atomic_load_n(&mHead, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+	}
+
+private:
+	T mSlots[N];
+
+	// Written only by the consumer.
+	uint32_t mHead;
+
+	// Written only by the producer. Kept off of `mHead`'s cache line
+	// so that the two sides don't keep stealing it from each other.
+	uint8_t mPad[64 - sizeof(uint32_t)];
+	uint32_t mTail;
+};
+
+}; // namespace nl
+
+#endif // wpantund_SPSCRing_h
@@ -0,0 +1,280 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      This file implements the SharedMemorySocket class.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "assert-macros.h"
+
+#include "SharedMemorySocket.h"
+#include <syslog.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+using namespace nl;
+
+// How often to check on the child if we can't get a descriptor for it.
+#define SHM_CHILD_POLL_INTERVAL_MS      1000
+
+SharedMemorySocket::SharedMemorySocket(const std::string& command)
+	:mCommand(command), mChildPID(-1), mChildFD(-1)
+{
+	memset(&mLink, 0, sizeof(mLink));
+	mLink.wake_fd = -1;
+
+	start();
+}
+
+SharedMemorySocket::~SharedMemorySocket()
+{
+	stop();
+}
+
+boost::shared_ptr<SocketWrapper>
+SharedMemorySocket::create(const std::string& command)
+{
+	return boost::shared_ptr<SocketWrapper>(new SharedMemorySocket(command));
+}
+
+void
+SharedMemorySocket::start(void)
+{
+	if (shm_frame_link_create(&mLink) != 0) {
+		syslog(LOG_ERR, "SharedMemorySocket: Unable to set up shared memory, errno=%d (%s)", errno, strerror(errno));
+		throw SocketError("Unable to set up shared memory");
+	}
+
+	mChildPID = shm_frame_link_spawn(&mLink, mCommand.c_str());
+
+	if (mChildPID < 0) {
+		syslog(LOG_ERR, "SharedMemorySocket: Unable to start <%s>, errno=%d (%s)", mCommand.c_str(), errno, strerror(errno));
+		shm_frame_link_close(&mLink);
+		throw SocketError("Unable to start simulator");
+	}
+
+#if defined(__linux__) && defined(SYS_pidfd_open)
+	mChildFD = (int)syscall(SYS_pidfd_open, mChildPID, 0);
+#endif
+
+	syslog(LOG_INFO, "SharedMemorySocket: Started <%s> as PID %d", mCommand.c_str(), (int)mChildPID);
+}
+
+void
+SharedMemorySocket::stop(void)
+{
+	if (mChildPID > 0) {
+		pid_t pid = 0;
+		int status = 0;
+		int i;
+
+		kill(mChildPID, SIGHUP);
+
+		for (i = 0; i < 10; i++) {
+			pid = waitpid(mChildPID, &status, WNOHANG);
+			if (pid != 0) {
+				break;
+			}
+			usleep(100000);
+		}
+
+		if (pid == 0) {
+			syslog(LOG_WARNING, "SharedMemorySocket: PID %d didn't respond to SIGHUP, killing it", (int)mChildPID);
+			kill(mChildPID, SIGKILL);
+			waitpid(mChildPID, &status, 0);
+		}
+	}
+
+	mChildPID = -1;
+
+	if (mChildFD >= 0) {
+		close(mChildFD);
+		mChildFD = -1;
+	}
+
+	if (mLink.region != NULL) {
+		shm_frame_link_close(&mLink);
+	}
+}
+
+bool
+SharedMemorySocket::child_has_exited(void)const
+{
+	if (mChildPID > 0) {
+		int status = 0;
+
+		if (waitpid(mChildPID, &status, WNOHANG) == mChildPID) {
+			syslog(LOG_ERR, "SharedMemorySocket: PID %d exited (status %d)", (int)mChildPID, status);
+			mChildPID = -1;
+
+			if (mChildFD >= 0) {
+				close(mChildFD);
+				mChildFD = -1;
+			}
+		}
+	}
+
+	return mChildPID <= 0;
+}
+
+ssize_t
+SharedMemorySocket::write(const void* data, size_t len)
+{
+	int ret;
+
+	if (child_has_exited()) {
+		return -EPIPE;
+	}
+
+	ret = shm_frame_link_send(&mLink, data, len);
+
+	if (ret == -EAGAIN) {
+		return 0;
+	}
+
+	return (ret < 0) ? ret : (ssize_t)len;
+}
+
+ssize_t
+SharedMemorySocket::read(void* data, size_t len)
+{
+	ssize_t ret;
+
+	if (mLink.region == NULL) {
+		return -EPIPE;
+	}
+
+	ret = shm_frame_link_receive(&mLink, data, len);
+
+	// Anything the simulator sent before it went away is still handed up.
+	if ((ret == 0) && child_has_exited()) {
+		ret = -EPIPE;
+	}
+
+	return ret;
+}
+
+bool
+SharedMemorySocket::can_read(void)const
+{
+	return (mLink.region == NULL)
+		|| shm_frame_link_can_receive(&mLink)
+		|| child_has_exited();
+}
+
+bool
+SharedMemorySocket::can_write(void)const
+{
+	return (mLink.region == NULL)
+		|| shm_frame_link_can_send(&mLink)
+		|| child_has_exited();
+}
+
+int
+SharedMemorySocket::get_read_fd(void)const
+{
+	return mLink.wake_fd;
+}
+
+int
+SharedMemorySocket::update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout)
+{
+	if (mLink.region == NULL) {
+		return 0;
+	}
+
+	// This runs right before `select()`, which makes it the place to
+	// ask the simulator for a wakeup: the pumps may not have called
+	// `can_read()` since the last one was used up. Frames that are
+	// already waiting (they are picked up one per pass) make
+	// `wake_fd` readable right away, just like bytes left in a pipe.
+	if (shm_frame_link_can_receive(&mLink)) {
+		shm_frame_link_wake_self(&mLink);
+	}
+
+	if (read_fd_set != NULL) {
+		FD_SET(mLink.wake_fd, read_fd_set);
+
+		if ((max_fd != NULL) && (*max_fd < mLink.wake_fd)) {
+			*max_fd = mLink.wake_fd;
+		}
+
+		// There is no EOF to tell us that the simulator went away.
+		if (mChildFD >= 0) {
+			FD_SET(mChildFD, read_fd_set);
+
+			if ((max_fd != NULL) && (*max_fd < mChildFD)) {
+				*max_fd = mChildFD;
+			}
+		}
+	}
+
+	if ((mChildFD < 0) && (mChildPID > 0) && (timeout != NULL)) {
+		*timeout = std::min(*timeout, (cms_t)SHM_CHILD_POLL_INTERVAL_MS);
+	}
+
+	return 0;
+}
+
+int
+SharedMemorySocket::process(void)
+{
+	// This is the only place the wakeup descriptor is emptied. Both
+	// directions share it, and the pumps look at the rings themselves
+	// right after this, so no wakeup can get lost in between.
+	if (mLink.region != NULL) {
+		shm_frame_link_clear_wake(&mLink);
+	}
+
+	return 0;
+}
+
+bool
+SharedMemorySocket::is_framed(void)const
+{
+	return true;
+}
+
+int
+SharedMemorySocket::hibernate(void)
+{
+	stop();
+
+	return 0;
+}
+
+void
+SharedMemorySocket::reset(void)
+{
+	syslog(LOG_DEBUG, "SharedMemorySocket::reset()");
+
+#if !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+	stop();
+	start();
+#endif // if !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+}
@@ -0,0 +1,73 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      This file declares the SharedMemorySocket class, which runs an
+ *      NCP simulator as a child process and exchanges whole frames
+ *      with it over shared memory (see `shm-frame-link.h`).
+ *
+ */
+
+#ifndef __wpantund__SharedMemorySocket__
+#define __wpantund__SharedMemorySocket__
+
+#include "SocketWrapper.h"
+#include "shm-frame-link.h"
+#include <sys/types.h>
+
+namespace nl {
+class SharedMemorySocket : public SocketWrapper {
+protected:
+	SharedMemorySocket(const std::string& command);
+
+public:
+	virtual ~SharedMemorySocket();
+
+	static boost::shared_ptr<SocketWrapper> create(const std::string& command);
+
+	//! Writes one whole frame. Returns zero if there is no room for it yet.
+	virtual ssize_t write(const void* data, size_t len);
+
+	//! Reads one whole frame. Returns zero if there isn't one.
+	virtual ssize_t read(void* data, size_t len);
+
+	virtual bool can_read(void)const;
+	virtual bool can_write(void)const;
+	virtual int get_read_fd(void)const;
+	virtual int update_fd_set(fd_set *read_fd_set, fd_set *write_fd_set, fd_set *error_fd_set, int *max_fd, cms_t *timeout);
+	virtual int process(void);
+	virtual bool is_framed(void)const;
+
+	virtual void reset(void);
+	virtual int hibernate(void);
+
+private:
+	void start(void);
+	void stop(void);
+	bool child_has_exited(void)const;
+
+	std::string mCommand;
+	mutable struct shm_frame_link mLink;
+	mutable pid_t mChildPID;
+
+	//! Becomes readable when the child exits, where supported.
+	mutable int mChildFD;
+}; // class SharedMemorySocket
+
+}; // namespace nl
+
+#endif /* defined(__wpantund__SharedMemorySocket__) */
@@ -116,6 +116,24 @@ SocketAdapter::send_break()
 		mParent->send_break();
 };
 
+int
+SocketAdapter::set_baud_rate(int baud)
+{
+	return mParent ? mParent->set_baud_rate(baud) : -EINVAL;
+}
+
+int
+SocketAdapter::get_baud_rate(void)const
+{
+	return mParent ? mParent->get_baud_rate() : -EINVAL;
+}
+
+bool
+SocketAdapter::is_framed(void)const
+{
+	return mParent ? mParent->is_framed() : false;
+}
+
 bool
 SocketAdapter::did_reset()
 {
@@ -44,6 +44,9 @@ public:
 	virtual int process(void);
 	virtual cms_t get_ms_to_next_event(void)const;
 	virtual void send_break();
+	virtual int set_baud_rate(int baud);
+	virtual int get_baud_rate(void)const;
+	virtual bool is_framed(void)const;
 
 	virtual void reset();
 	virtual bool did_reset();
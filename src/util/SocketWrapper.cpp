@@ -85,6 +85,20 @@ SocketWrapper::send_break(void)
 {
 }
 
+int
+SocketWrapper::set_baud_rate(int baud)
+{
+	errno = ENOTSUP;
+	return -ENOTSUP;
+}
+
+int
+SocketWrapper::get_baud_rate(void)const
+{
+	errno = ENOTSUP;
+	return -ENOTSUP;
+}
+
 off_t
 SocketWrapper::lseek(off_t offset, int whence)
 {
@@ -92,6 +106,12 @@ SocketWrapper::lseek(off_t offset, int whence)
 	return -ENOTSUP;
 }
 
+bool
+SocketWrapper::is_framed(void)const
+{
+	return false;
+}
+
 void
 SocketWrapper::reset(void)
 {
@@ -58,6 +58,15 @@ public:
 
 	virtual void send_break(void);
 
+	//! Changes the baud rate of the underlying serial port, if there is one.
+	virtual int set_baud_rate(int baud);
+
+	//! Returns the baud rate of the underlying serial port, or a negative error.
+	virtual int get_baud_rate(void)const;
+
+	//! True if `read()` and `write()` always move exactly one whole frame.
+	virtual bool is_framed(void)const;
+
 	virtual void reset(void);
 	virtual bool did_reset(void);
 
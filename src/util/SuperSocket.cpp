@@ -29,6 +29,8 @@
 #include "assert-macros.h"
 
 #include "SuperSocket.h"
+#include "SharedMemorySocket.h"
+#include "string-utils.h"
 #include "socket-utils.h"
 #include "time-utils.h"
 #include <syslog.h>
@@ -80,6 +82,11 @@ SuperSocket::~SuperSocket()
 boost::shared_ptr<SocketWrapper>
 SuperSocket::create(const std::string& path)
 {
+	// Not a file descriptor at all, so it gets its own class.
+	if (strcasehasprefix(path.c_str(), SOCKET_SHM_COMMAND_PREFIX)) {
+		return SharedMemorySocket::create(path.substr(sizeof(SOCKET_SHM_COMMAND_PREFIX) - 1));
+	}
+
 	return boost::shared_ptr<SocketWrapper>(new SuperSocket(path));
 }
 
@@ -35,6 +35,8 @@ const Timer::Interval Timer::kOneMinute      = Timer::kOneSecond * 60;
 const Timer::Interval Timer::kOneHour        = Timer::kOneMinute * 60;
 const Timer::Interval Timer::kOneDay         = Timer::kOneHour * 24;
 
+const int Timer::kDefaultSlackDivisor = 8;
+
 Timer *const Timer::kListEndMarker = (Timer *)(&Timer::mListHead);
 Timer *Timer::mListHead = kListEndMarker;
 
@@ -49,6 +51,7 @@ Timer::Timer() :
 {
 	mType = kOneShot;
 	mInterval = 0;
+	mSlack = 0;
 	mNext = NULL;
 	mCallback = &null_timer_callback;
 }
@@ -100,6 +103,18 @@ Timer::get_type(void) const
 	return mType;
 }
 
+void
+Timer::set_slack(Interval slack)
+{
+	mSlack = (slack > 0) ? slack : 0;
+}
+
+Timer::Interval
+Timer::get_slack(void) const
+{
+	return mSlack;
+}
+
 void
 Timer::add(Timer *timer)
 {
@@ -215,12 +230,30 @@ cms_t
 Timer::get_ms_to_next_event(void)
 {
 	cms_t cms = CMS_DISTANT_FUTURE;
+	Timer *timer;
+
+	// Wake up at the earliest deadline (fire-time plus slack), by which
+	// time every timer whose fire-time has passed gets processed as well.
+	// The list is sorted by fire-time, so no later timer can have an
+	// earlier deadline once its fire-time is past the current one.
+	for (timer = mListHead; timer != kListEndMarker; timer = timer->mNext) {
+		cms_t fire_cms = timer->mFireTime.get_ms_till_time();
+		int64_t deadline_cms;
+
+		if (fire_cms >= cms) {
+			break;
+		}
 
-	if (mListHead != kListEndMarker) {
-		cms = mListHead->mFireTime.get_ms_till_time();
-		if (cms < 0) {
-			cms = 0;
+		deadline_cms = static_cast<int64_t>(fire_cms) + timer->mSlack;
+
+		if (deadline_cms < cms) {
+			cms = static_cast<cms_t>(deadline_cms);
 		}
 	}
+
+	if (cms < 0) {
+		cms = 0;
+	}
+
 	return cms;
 }
@@ -53,6 +53,9 @@ public:
 	static const Interval kOneHour;
 	static const Interval kOneDay;
 
+	// Periodic housekeeping timers use a slack of their period divided by this
+	static const int kDefaultSlackDivisor;
+
 public:
 	Timer();
 	virtual ~Timer();
@@ -78,6 +81,14 @@ public:
 	// Returns the type of the timer.
 	Type get_type(void) const;
 
+	// Sets how late the timer is allowed to fire (zero by default).
+	//    A timer with slack fires anywhere between its fire-time and its fire-time plus slack, so
+	//    that it can share a wakeup with other timers instead of waking the process up by itself.
+	void set_slack(Interval slack);
+
+	// Returns the slack of the timer
+	Interval get_slack(void) const;
+
 
 public:
 	static int process(void);
@@ -109,6 +120,7 @@ private:
 
 	ClockTime mFireTime;
 	cms_t mInterval;
+	cms_t mSlack;
 	Callback mCallback;
 	Type mType;
 	Timer *mNext;       // for linked-list
@@ -168,6 +168,43 @@ UnixSocket::send_break()
 	}
 };
 
+int
+UnixSocket::set_baud_rate(int baud)
+{
+	int ret = -ENOTSUP;
+
+	if (isatty(mFDWrite)) {
+		syslog(mLogLevel, "UnixSocket: Changing baud rate to %d", baud);
+
+		// Anything still queued up goes out at the old rate.
+		tcdrain(mFDWrite);
+
+		ret = set_serial_baud_rate(mFDWrite, baud);
+
+		if (ret != 0) {
+			ret = -errno;
+		}
+	}
+
+	return ret;
+}
+
+int
+UnixSocket::get_baud_rate(void)const
+{
+	int ret = -ENOTSUP;
+
+	if (isatty(mFDWrite)) {
+		ret = get_serial_baud_rate(mFDWrite);
+
+		if (ret < 0) {
+			ret = -errno;
+		}
+	}
+
+	return ret;
+}
+
 int
 UnixSocket::get_read_fd(void)const
 {
@@ -43,6 +43,8 @@ public:
 	virtual int get_write_fd(void)const;
 	virtual int process(void);
 	virtual void send_break();
+	virtual int set_baud_rate(int baud);
+	virtual int get_baud_rate(void)const;
 	virtual int set_log_level(int log_level);
 
 protected:
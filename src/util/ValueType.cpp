@@ -0,0 +1,112 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Type tags for the values carried around in `boost::any`.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "ValueType.h"
+#include "ValueMap.h"
+#include "Data.h"
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+#include <typeinfo>
+
+using namespace nl;
+
+namespace {
+
+struct TypeEntry {
+	const std::type_info* mInfo;
+	ValueType mType;
+};
+
+// Roughly ordered by how often each type shows up.
+const TypeEntry*
+type_table(size_t* count)
+{
+	static const TypeEntry sTable[] = {
+		{ &typeid(std::string),              kValueType_String },
+		{ &typeid(bool),                     kValueType_Bool },
+		{ &typeid(uint8_t),                  kValueType_UInt8 },
+		{ &typeid(uint16_t),                 kValueType_UInt16 },
+		{ &typeid(uint32_t),                 kValueType_UInt32 },
+		{ &typeid(int8_t),                   kValueType_Int8 },
+		{ &typeid(int16_t),                  kValueType_Int16 },
+		{ &typeid(int32_t),                  kValueType_Int32 },
+		{ &typeid(uint64_t),                 kValueType_UInt64 },
+		{ &typeid(int64_t),                  kValueType_Int64 },
+		{ &typeid(nl::Data),                 kValueType_Data },
+		{ &typeid(nl::ValueMap),             kValueType_ValueMap },
+		{ &typeid(std::list<nl::ValueMap>),  kValueType_ValueMapList },
+		{ &typeid(std::list<std::string>),   kValueType_StringList },
+		{ &typeid(std::set<std::string>),    kValueType_StringSet },
+		{ &typeid(std::vector<uint8_t>),     kValueType_ByteVector },
+		{ &typeid(double),                   kValueType_Double },
+		{ &typeid(float),                    kValueType_Float },
+		{ &typeid(char*),                    kValueType_CString },
+		{ &typeid(std::list<int>),           kValueType_IntList },
+		{ &typeid(std::set<int>),            kValueType_IntSet },
+		{ &typeid(std::list<boost::any>),    kValueType_AnyList },
+		{ &typeid(struct in6_addr),          kValueType_IPv6Address },
+	};
+
+	*count = sizeof(sTable) / sizeof(sTable[0]);
+
+	return sTable;
+}
+
+}; // namespace
+
+ValueType
+nl::value_type_of(const boost::any& value)
+{
+	const std::type_info& info = value.type();
+	size_t count;
+	const TypeEntry* table = type_table(&count);
+	size_t i;
+
+	if (value.empty()) {
+		return kValueType_Empty;
+	}
+
+	// Fast path: the same `type_info` object, so just a pointer compare.
+	for (i = 0; i < count; i++) {
+		if (table[i].mInfo == &info) {
+			return table[i].mType;
+		}
+	}
+
+	// Values created in a separately loaded plugin may carry their
+	// own copy of the `type_info`, so compare by name as well.
+	for (i = 0; i < count; i++) {
+		if (*table[i].mInfo == info) {
+			return table[i].mType;
+		}
+	}
+
+	return kValueType_Unknown;
+}
@@ -0,0 +1,77 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Type tags for the values carried around in `boost::any`.
+ *
+ *      Comparing `std::type_info` objects can fall back to `strcmp()`
+ *      on the mangled type names, so testing a value against a long
+ *      chain of `typeid()`s is slow when done for every entry of a
+ *      large table. `value_type_of()` identifies a value once, after
+ *      which code can `switch` on the tag and use `value_cast<>()`.
+ *
+ */
+
+#ifndef wpantund_ValueType_h
+#define wpantund_ValueType_h
+
+#include <boost/any.hpp>
+
+namespace nl {
+
+enum ValueType {
+	kValueType_Unknown,
+	kValueType_Empty,
+	kValueType_Bool,
+	kValueType_UInt8,
+	kValueType_Int8,
+	kValueType_UInt16,
+	kValueType_Int16,
+	kValueType_UInt32,
+	kValueType_Int32,
+	kValueType_UInt64,
+	kValueType_Int64,
+	kValueType_Double,
+	kValueType_Float,
+	kValueType_String,          // std::string
+	kValueType_CString,         // char*
+	kValueType_Data,            // nl::Data
+	kValueType_ByteVector,      // std::vector<uint8_t>
+	kValueType_StringList,      // std::list<std::string>
+	kValueType_StringSet,       // std::set<std::string>
+	kValueType_IntList,         // std::list<int>
+	kValueType_IntSet,          // std::set<int>
+	kValueType_AnyList,         // std::list<boost::any>
+	kValueType_ValueMap,        // nl::ValueMap
+	kValueType_ValueMapList,    // std::list<nl::ValueMap>
+	kValueType_IPv6Address,     // struct in6_addr
+};
+
+extern ValueType value_type_of(const boost::any& value);
+
+// Like `boost::any_cast<const T&>()`, for when the type is already
+// known from `value_type_of()`. Does not copy and does not check.
+template <typename T>
+inline const T&
+value_cast(const boost::any& value)
+{
+	return *boost::unsafe_any_cast<T>(&value);
+}
+
+}; // namespace nl
+
+#endif
@@ -33,6 +33,7 @@
 #include <list>
 #include "string-utils.h"
 #include "IPv6Helpers.h"
+#include "ValueType.h"
 
 using namespace nl;
 
@@ -74,27 +75,35 @@ int any_to_int(const boost::any& value)
 {
 	int32_t ret = 0;
 
-	if (value.type() == typeid(std::string)) {
-		std::string key_string = boost::any_cast<std::string>(value);
-		ret = (int)strtol(key_string.c_str(), NULL, 0);
-	} else if (value.type() == typeid(uint8_t)) {
-		ret = boost::any_cast<uint8_t>(value);
-	} else if (value.type() == typeid(int8_t)) {
-		ret = boost::any_cast<int8_t>(value);
-	} else if (value.type() == typeid(uint16_t)) {
-		ret = boost::any_cast<uint16_t>(value);
-	} else if (value.type() == typeid(int16_t)) {
-		ret = boost::any_cast<int16_t>(value);
-	} else if (value.type() == typeid(uint32_t)) {
-		ret = boost::any_cast<uint32_t>(value);
-	} else if (value.type() == typeid(int32_t)) {
-		ret = boost::any_cast<int32_t>(value);
-	} else if (value.type() == typeid(bool)) {
-		ret = boost::any_cast<bool>(value);
-	} else if (value.type() == typeid(unsigned int)) {
-		ret = boost::any_cast<unsigned int>(value);
-	} else {
+	switch (value_type_of(value)) {
+	case kValueType_String:
+		ret = (int)strtol(value_cast<std::string>(value).c_str(), NULL, 0);
+		break;
+	case kValueType_UInt8:
+		ret = value_cast<uint8_t>(value);
+		break;
+	case kValueType_Int8:
+		ret = value_cast<int8_t>(value);
+		break;
+	case kValueType_UInt16:
+		ret = value_cast<uint16_t>(value);
+		break;
+	case kValueType_Int16:
+		ret = value_cast<int16_t>(value);
+		break;
+	case kValueType_UInt32:
+		ret = value_cast<uint32_t>(value);
+		break;
+	case kValueType_Int32:
+		ret = value_cast<int32_t>(value);
+		break;
+	case kValueType_Bool:
+		ret = value_cast<bool>(value);
+		break;
+	default:
+		// Throws boost::bad_any_cast for anything else.
 		ret = boost::any_cast<int>(value);
+		break;
 	}
 	return ret;
 }
@@ -178,18 +187,23 @@ bool any_to_bool(const boost::any& value)
 {
 	bool ret = 0;
 
-	if (value.type() == typeid(std::string)) {
-		std::string key_string = boost::any_cast<std::string>(value);
+	switch (value_type_of(value)) {
+	case kValueType_String: {
+		const std::string& key_string = value_cast<std::string>(value);
 		if (key_string=="true" || key_string=="yes" || key_string=="1" || key_string == "TRUE" || key_string == "YES")
 			ret = true;
 		else if (key_string=="false" || key_string=="no" || key_string=="0" || key_string == "FALSE" || key_string == "NO")
 			ret = false;
 		else
 			ret = (bool)strtol(key_string.c_str(), NULL, 0);
-	} else if (value.type() == typeid(bool)) {
-		ret = boost::any_cast<bool>(value);
-	} else {
+		break;
+	}
+	case kValueType_Bool:
+		ret = value_cast<bool>(value);
+		break;
+	default:
 		ret = any_to_int(value) != 0;
+		break;
 	}
 	return ret;
 }
@@ -197,54 +211,51 @@ bool any_to_bool(const boost::any& value)
 std::string any_to_string(const boost::any& value)
 {
 	std::string ret;
-
-	if (value.type() == typeid(std::string)) {
-		ret = boost::any_cast<std::string>(value);
-	} else if (value.type() == typeid(uint8_t)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%u", boost::any_cast<uint8_t>(value));
+	char tmp[20];
+
+	switch (value_type_of(value)) {
+	case kValueType_String:
+		ret = value_cast<std::string>(value);
+		break;
+	case kValueType_UInt8:
+		snprintf(tmp, sizeof(tmp), "%u", value_cast<uint8_t>(value));
 		ret = tmp;
-	} else if (value.type() == typeid(int8_t)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%d", boost::any_cast<int8_t>(value));
+		break;
+	case kValueType_Int8:
+		snprintf(tmp, sizeof(tmp), "%d", value_cast<int8_t>(value));
 		ret = tmp;
-	} else if (value.type() == typeid(uint16_t)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%u", boost::any_cast<uint16_t>(value));
+		break;
+	case kValueType_UInt16:
+		snprintf(tmp, sizeof(tmp), "%u", value_cast<uint16_t>(value));
 		ret = tmp;
-	} else if (value.type() == typeid(int16_t)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%d", boost::any_cast<int16_t>(value));
+		break;
+	case kValueType_Int16:
+		snprintf(tmp, sizeof(tmp), "%d", value_cast<int16_t>(value));
 		ret = tmp;
-	} else if (value.type() == typeid(uint32_t)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%u", (unsigned int)boost::any_cast<uint32_t>(value));
+		break;
+	case kValueType_UInt32:
+		snprintf(tmp, sizeof(tmp), "%u", (unsigned int)value_cast<uint32_t>(value));
 		ret = tmp;
-	} else if (value.type() == typeid(int32_t)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%d", (int)boost::any_cast<int32_t>(value));
+		break;
+	case kValueType_Int32:
+		snprintf(tmp, sizeof(tmp), "%d", (int)value_cast<int32_t>(value));
 		ret = tmp;
-	} else if (value.type() == typeid(uint64_t)) {
-		char tmp[20];
-		uint64_t u64_val = boost::any_cast<uint64_t>(value);
+		break;
+	case kValueType_UInt64: {
+		uint64_t u64_val = value_cast<uint64_t>(value);
 		snprintf(tmp,
 		         sizeof(tmp),
 		         "%08x%08x",
 		         static_cast<uint32_t>(u64_val >> 32),
 		         static_cast<uint32_t>(u64_val & 0xFFFFFFFF));
 		ret = tmp;
-	} else if (value.type() == typeid(unsigned int)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%u", boost::any_cast<unsigned int>(value));
-		ret = tmp;
-	} else if (value.type() == typeid(int)) {
-		char tmp[10];
-		snprintf(tmp, sizeof(tmp), "%d", boost::any_cast<int>(value));
-		ret = tmp;
-	} else if (value.type() == typeid(bool)) {
-		ret = (boost::any_cast<bool>(value))? "true" : "false";
-	} else if (value.type() == typeid(nl::Data)) {
-		nl::Data data = boost::any_cast<nl::Data>(value);
+		break;
+	}
+	case kValueType_Bool:
+		ret = (value_cast<bool>(value))? "true" : "false";
+		break;
+	case kValueType_Data: {
+		const nl::Data& data = value_cast<nl::Data>(value);
 		ret = std::string(data.size()*2,0);
 
 		// Reserve the zero termination
@@ -255,8 +266,10 @@ std::string any_to_string(const boost::any& value)
 								&ret[0],
 								ret.capacity(),
 								0);
-	} else if (value.type() == typeid(std::list<std::string>)) {
-		std::list<std::string> l = boost::any_cast<std::list<std::string> >(value);
+		break;
+	}
+	case kValueType_StringList: {
+		const std::list<std::string>& l = value_cast<std::list<std::string> >(value);
 		if (!l.empty()) {
 			std::list<std::string>::const_iterator iter;
 			ret = "{\n";
@@ -267,14 +280,16 @@ std::string any_to_string(const boost::any& value)
 		} else {
 			ret = "{ }";
 		}
-	} else if (value.type() == typeid(struct in6_addr)) {
-		struct in6_addr addr = boost::any_cast<struct in6_addr>(value);
-		ret = in6_addr_to_string(addr);
-
-	} else {
+		break;
+	}
+	case kValueType_IPv6Address:
+		ret = in6_addr_to_string(value_cast<struct in6_addr>(value));
+		break;
+	default:
 		ret += "<";
 		ret += value.type().name();
 		ret += ">";
+		break;
 	}
 	return ret;
 }
@@ -27,4 +27,30 @@
 #define EXT_ADDRESS_LENGTH          8
 #define EXT_ADDRESS_LENGTH_CHAR     (2*EXT_ADDRESS_LENGTH)
 #define DEFAULT_JOINER_TIMEOUT      120
+
+#include <string.h>
+#include "string-utils.h"
+
+// Returns NULL if `psk` is acceptable as a joiner PSKd, otherwise a
+// short description of what is wrong with it.
+static inline const char*
+joiner_psk_check(const char* psk)
+{
+	size_t psk_len = strnlen(psk, PSK_MAX_LENGTH + 1);
+
+	if ((psk_len < PSK_MIN_LENGTH) || (psk_len > PSK_MAX_LENGTH)) {
+		return "invalid PSKd length";
+	}
+
+	if (!is_uppercase_or_digit((const uint8_t*)psk, psk_len)) {
+		return "PSKd must consist of uppercase letters and digits";
+	}
+
+	if (strpbrk(psk, INVALID_PSK_CHARACTERS) != NULL) {
+		return "PSKd must not contain I, O, Q or Z";
+	}
+
+	return NULL;
+}
+
 #endif
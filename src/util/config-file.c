@@ -115,6 +115,8 @@ fread_config(
 	char* line = NULL;
 	size_t line_len = 0;
 	int line_number = 0;
+	char section[64] = "";
+	char section_key[256];
 
 	if (file == NULL) {
 		ret = -1;
@@ -133,6 +135,14 @@ fread_config(
 
 		key[strnlen(key,line_len)] = 0;
 
+		// A line like `[wpan1]` starts a new section. Keys inside of a
+		// section are handed to the setter as `[wpan1]Key`.
+		if ((key[0] == '[') && (strlen(key) > 2) && (key[strlen(key) - 1] == ']')) {
+			key[strlen(key) - 1] = 0;
+			snprintf(section, sizeof(section), "%s", key + 1);
+			continue;
+		}
+
 		if (strlen(key) >= line_len) {
 			continue;
 		}
@@ -143,6 +153,12 @@ fread_config(
 			continue;
 		}
 		value[strnlen(value, line_len)] = 0;
+
+		if (section[0] != 0) {
+			snprintf(section_key, sizeof(section_key), "[%s]%s", section, key);
+			key = section_key;
+		}
+
 		ret = setter(context, key, value);
 	}
 
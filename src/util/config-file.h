@@ -25,6 +25,8 @@ typedef int (*config_param_set_func)(void* context, const char* key, const char*
 
 extern int read_config(const char* filename, config_param_set_func setter, void* context);
 
+// Keys which appear after a `[name]` section header are passed to
+// `setter` prefixed with that header, like `[name]Config:NCP:SocketPath`.
 extern int fread_config(FILE* file, config_param_set_func setter, void* context);
 __END_DECLS
 
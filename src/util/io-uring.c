@@ -0,0 +1,305 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Minimal io_uring wrapper.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "io-uring.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#if IO_URING_SUPPORTED
+
+#include <sys/mman.h>
+
+static int
+sys_io_uring_setup(unsigned entries, struct io_uring_params* params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int
+sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+int
+io_uring_init(io_uring_t* ring, unsigned entries)
+{
+	struct io_uring_params params;
+	uint8_t* sq_ptr;
+	uint8_t* cq_ptr;
+	int ret;
+
+	memset(ring, 0, sizeof(*ring));
+	memset(&params, 0, sizeof(params));
+
+	ring->fd = sys_io_uring_setup(entries, &params);
+
+	if (ring->fd < 0) {
+		ring->fd = -1;
+		return -errno;
+	}
+
+	if ( !(params.features & IORING_FEAT_NODROP)
+	  || !(params.features & IORING_FEAT_FAST_POLL)
+	) {
+		ret = -ENOTSUP;
+		goto bail;
+	}
+
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size) {
+			ring->sq_ring_size = ring->cq_ring_size;
+		}
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring_ptr = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+
+	if (ring->sq_ring_ptr == MAP_FAILED) {
+		ring->sq_ring_ptr = NULL;
+		ret = -errno;
+		goto bail;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ring_ptr = ring->sq_ring_ptr;
+
+	} else {
+		ring->cq_ring_ptr = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+
+		if (ring->cq_ring_ptr == MAP_FAILED) {
+			ring->cq_ring_ptr = NULL;
+			ret = -errno;
+			goto bail;
+		}
+	}
+
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+	if (ring->sqes == MAP_FAILED) {
+		ring->sqes = NULL;
+		ret = -errno;
+		goto bail;
+	}
+
+	sq_ptr = (uint8_t*)ring->sq_ring_ptr;
+	ring->sq_head = (unsigned*)(sq_ptr + params.sq_off.head);
+	ring->sq_tail = (unsigned*)(sq_ptr + params.sq_off.tail);
+	ring->sq_mask = (unsigned*)(sq_ptr + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)(sq_ptr + params.sq_off.array);
+	ring->sq_entries = params.sq_entries;
+
+	cq_ptr = (uint8_t*)ring->cq_ring_ptr;
+	ring->cq_head = (unsigned*)(cq_ptr + params.cq_off.head);
+	ring->cq_tail = (unsigned*)(cq_ptr + params.cq_off.tail);
+	ring->cq_mask = (unsigned*)(cq_ptr + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(cq_ptr + params.cq_off.cqes);
+
+	return 0;
+
+bail:
+	io_uring_finalize(ring);
+	return ret;
+}
+
+void
+io_uring_finalize(io_uring_t* ring)
+{
+	if (ring->sqes != NULL) {
+		munmap(ring->sqes, ring->sqes_size);
+		ring->sqes = NULL;
+	}
+
+	if ((ring->cq_ring_ptr != NULL) && (ring->cq_ring_ptr != ring->sq_ring_ptr)) {
+		munmap(ring->cq_ring_ptr, ring->cq_ring_size);
+	}
+	ring->cq_ring_ptr = NULL;
+
+	if (ring->sq_ring_ptr != NULL) {
+		munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+		ring->sq_ring_ptr = NULL;
+	}
+
+	if (ring->fd >= 0) {
+		close(ring->fd);
+		ring->fd = -1;
+	}
+}
+
+int
+io_uring_register_buffers(io_uring_t* ring, const struct iovec* iov, unsigned count)
+{
+	if (sys_io_uring_register(ring->fd, IORING_REGISTER_BUFFERS, iov, count) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+struct io_uring_sqe*
+io_uring_get_sqe(io_uring_t* ring)
+{
+	const unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	const unsigned tail = *ring->sq_tail + ring->sq_queued;
+	struct io_uring_sqe* sqe;
+
+	if (tail - head >= ring->sq_entries) {
+		return NULL;
+	}
+
+	sqe = &ring->sqes[tail & *ring->sq_mask];
+	ring->sq_array[tail & *ring->sq_mask] = tail & *ring->sq_mask;
+	ring->sq_queued++;
+
+	memset(sqe, 0, sizeof(*sqe));
+
+	return sqe;
+}
+
+static void
+prep_rw(struct io_uring_sqe* sqe, uint8_t opcode, int fd, const void* buf, unsigned len, uint64_t user_data)
+{
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = len;
+	sqe->user_data = user_data;
+}
+
+void
+io_uring_prep_read_fixed(struct io_uring_sqe* sqe, int fd, void* buf, unsigned len, uint16_t buf_index, uint64_t user_data)
+{
+	prep_rw(sqe, IORING_OP_READ_FIXED, fd, buf, len, user_data);
+	sqe->buf_index = buf_index;
+}
+
+void
+io_uring_prep_write_fixed(struct io_uring_sqe* sqe, int fd, const void* buf, unsigned len, uint16_t buf_index, uint64_t user_data)
+{
+	prep_rw(sqe, IORING_OP_WRITE_FIXED, fd, buf, len, user_data);
+	sqe->buf_index = buf_index;
+}
+
+void
+io_uring_prep_poll_add(struct io_uring_sqe* sqe, int fd, short events, uint64_t user_data)
+{
+	prep_rw(sqe, IORING_OP_POLL_ADD, fd, NULL, 0, user_data);
+	sqe->poll_events = (uint16_t)events;
+}
+
+void
+io_uring_prep_cancel(struct io_uring_sqe* sqe, uint64_t target_user_data, uint64_t user_data)
+{
+	prep_rw(sqe, IORING_OP_ASYNC_CANCEL, -1, (const void*)(uintptr_t)target_user_data, 0, user_data);
+}
+
+int
+io_uring_submit(io_uring_t* ring, unsigned wait_nr)
+{
+	unsigned to_submit;
+	int ret;
+
+	if (ring->sq_queued != 0) {
+		__atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->sq_queued, __ATOMIC_RELEASE);
+		ring->sq_queued = 0;
+	}
+
+	// Counted from the kernel's head rather than what we just queued,
+	// so that anything left over by an interrupted call goes too.
+	to_submit = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+	if ((to_submit == 0) && (wait_nr == 0)) {
+		return 0;
+	}
+
+	do {
+		ring->enter_count++;
+		ret = sys_io_uring_enter(ring->fd, to_submit, wait_nr, (wait_nr != 0) ? IORING_ENTER_GETEVENTS : 0);
+	} while ((ret < 0) && (errno == EINTR));
+
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return ret;
+}
+
+struct io_uring_cqe*
+io_uring_peek_cqe(io_uring_t* ring)
+{
+	const unsigned head = *ring->cq_head;
+
+	if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+
+	return &ring->cqes[head & *ring->cq_mask];
+}
+
+void
+io_uring_cqe_seen(io_uring_t* ring)
+{
+	__atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+bool
+io_uring_is_available(void)
+{
+	io_uring_t ring;
+
+	if (io_uring_init(&ring, 2) != 0) {
+		return false;
+	}
+
+	io_uring_finalize(&ring);
+
+	return true;
+}
+
+#else // IO_URING_SUPPORTED
+
+bool
+io_uring_is_available(void)
+{
+	errno = ENOSYS;
+	return false;
+}
+
+#endif // else IO_URING_SUPPORTED
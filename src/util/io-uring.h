@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Minimal io_uring wrapper, on top of the raw system calls so
+ *      that there is no dependency on liburing.
+ *
+ *      Only what the data-plane thread needs is here: one ring,
+ *      registered buffers, reads, writes, polls and cancellation.
+ *      Everything else reports `ENOSYS` when wpantund was built
+ *      without `<linux/io_uring.h>`, so callers can simply fall back
+ *      to their `poll()` based code.
+ *
+ */
+
+#ifndef wpantund_io_uring_h
+#define wpantund_io_uring_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#if HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define IO_URING_SUPPORTED 1
+#endif
+#endif
+
+#ifndef IO_URING_SUPPORTED
+#define IO_URING_SUPPORTED 0
+#endif
+
+#ifndef __BEGIN_DECLS
+#ifdef __cplusplus
+#define __BEGIN_DECLS extern "C" {
+#define __END_DECLS }
+#else
+#define __BEGIN_DECLS
+#define __END_DECLS
+#endif
+#endif
+
+__BEGIN_DECLS
+
+#if IO_URING_SUPPORTED
+
+typedef struct {
+	int fd;
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	unsigned sq_entries;
+	unsigned sq_queued;        // Prepared, not yet handed to the kernel
+
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void *sq_ring_ptr;
+	size_t sq_ring_size;
+	void *cq_ring_ptr;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	// Number of `io_uring_enter()` calls made so far.
+	uint32_t enter_count;
+} io_uring_t;
+
+// Sets up a ring with room for `entries` submissions. Fails with
+// `ENOTSUP` if the kernel lacks `IORING_FEAT_NODROP` or
+// `IORING_FEAT_FAST_POLL` (i.e. is older than 5.7), which the
+// callers rely on. Returns zero on success, or a negative errno value.
+extern int io_uring_init(io_uring_t* ring, unsigned entries);
+extern void io_uring_finalize(io_uring_t* ring);
+
+// Returns zero on success, or a negative errno value.
+extern int io_uring_register_buffers(io_uring_t* ring, const struct iovec* iov, unsigned count);
+
+// Returns NULL if every submission slot is taken, in which case
+// `io_uring_submit()` has to be called first.
+extern struct io_uring_sqe* io_uring_get_sqe(io_uring_t* ring);
+
+extern void io_uring_prep_read_fixed(struct io_uring_sqe* sqe, int fd, void* buf, unsigned len, uint16_t buf_index, uint64_t user_data);
+extern void io_uring_prep_write_fixed(struct io_uring_sqe* sqe, int fd, const void* buf, unsigned len, uint16_t buf_index, uint64_t user_data);
+extern void io_uring_prep_poll_add(struct io_uring_sqe* sqe, int fd, short events, uint64_t user_data);
+extern void io_uring_prep_cancel(struct io_uring_sqe* sqe, uint64_t target_user_data, uint64_t user_data);
+
+// Hands everything prepared to the kernel and, if `wait_nr` is
+// non-zero, waits until at least that many completions are available.
+// This is a single system call. Returns the number of submissions
+// consumed, or a negative errno value.
+extern int io_uring_submit(io_uring_t* ring, unsigned wait_nr);
+
+// Returns NULL if there is no completion to look at.
+extern struct io_uring_cqe* io_uring_peek_cqe(io_uring_t* ring);
+extern void io_uring_cqe_seen(io_uring_t* ring);
+
+#endif // IO_URING_SUPPORTED
+
+// True if this build has io_uring support and the running kernel
+// allows setting up a ring which `io_uring_init()` would accept.
+extern bool io_uring_is_available(void);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Setting serial baud rates that have no `Bxxx` constant.
+ *
+ *      This lives in its own file because the Linux `termios2`
+ *      definitions in <asm/termbits.h> clash with the ones
+ *      from <termios.h> used by `socket-utils.c`.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "socket-utils.h"
+#include <errno.h>
+
+#if defined(__linux__)
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#endif
+
+#if defined(__linux__) && defined(BOTHER) && defined(TCGETS2)
+
+int
+set_serial_custom_baud_rate(int fd, int baud)
+{
+	struct termios2 tios2;
+
+	if (ioctl(fd, TCGETS2, &tios2) != 0) {
+		return -1;
+	}
+
+	tios2.c_cflag &= ~CBAUD;
+	tios2.c_cflag |= BOTHER;
+	tios2.c_ospeed = baud;
+
+#ifdef IBSHIFT
+	// Input rate follows the output rate.
+	tios2.c_cflag &= ~(CBAUD << IBSHIFT);
+	tios2.c_ispeed = 0;
+#else
+	tios2.c_ispeed = baud;
+#endif
+
+	return ioctl(fd, TCSETS2, &tios2);
+}
+
+int
+get_serial_custom_baud_rate(int fd)
+{
+	struct termios2 tios2;
+
+	if (ioctl(fd, TCGETS2, &tios2) != 0) {
+		return -1;
+	}
+
+	return (int)tios2.c_ospeed;
+}
+
+#else
+
+int
+set_serial_custom_baud_rate(int fd, int baud)
+{
+	errno = ENOTSUP;
+	return -1;
+}
+
+int
+get_serial_custom_baud_rate(int fd)
+{
+	errno = ENOTSUP;
+	return -1;
+}
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Opens the slave end of a pseudo-terminal with `open_super_socket()`
+ *      at high and non-standard baud rates, checks that the rate sticks,
+ *      and measures how fast HDLC-sized frames can be bounced off a
+ *      simulated NCP sitting on the master end.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define _GNU_SOURCE 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include "socket-utils.h"
+#include "time-utils.h"
+
+#if HAVE_PTY_H
+#include <pty.h>
+#endif
+
+#if HAVE_UTIL_H
+#include <util.h>
+#endif
+
+#define FRAME_SIZE          1300
+#define FRAME_COUNT         2000
+#define IO_TIMEOUT_MS       5000
+
+static int
+open_simulated_ncp(int* master_fd, int baud, const char* extra_options)
+{
+	char socket_name[128];
+	int slave_fd = -1;
+	int fd = -1;
+	struct termios tios;
+
+	if (openpty(master_fd, &slave_fd, NULL, NULL, NULL) != 0) {
+		perror("openpty");
+		return -1;
+	}
+
+	// The NCP side of the link must not echo or mangle anything.
+	tcgetattr(*master_fd, &tios);
+	cfmakeraw(&tios);
+	tcsetattr(*master_fd, TCSANOW, &tios);
+
+	snprintf(socket_name, sizeof(socket_name), "serial:%s,raw,b%d%s", ttyname(slave_fd), baud, extra_options);
+
+	fd = open_super_socket(socket_name);
+
+	close(slave_fd);
+
+	if (fd < 0) {
+		printf("unable to open \"%s\"\n", socket_name);
+		close(*master_fd);
+	}
+
+	return fd;
+}
+
+// Writes all of `len` bytes to non-blocking `fd`.
+static bool
+write_all(int fd, const uint8_t* data, size_t len)
+{
+	while (len > 0) {
+		ssize_t ret = write(fd, data, len);
+
+		if (ret < 0) {
+			if ((errno != EAGAIN) && (errno != EINTR)) {
+				return false;
+			}
+
+			struct pollfd pfd = { fd, POLLOUT, 0 };
+
+			if (poll(&pfd, 1, IO_TIMEOUT_MS) <= 0) {
+				return false;
+			}
+
+			continue;
+		}
+
+		data += ret;
+		len -= (size_t)ret;
+	}
+
+	return true;
+}
+
+// Reads exactly `len` bytes from (possibly non-blocking) `fd`.
+static bool
+read_all(int fd, uint8_t* data, size_t len)
+{
+	while (len > 0) {
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		ssize_t ret;
+
+		if (poll(&pfd, 1, IO_TIMEOUT_MS) <= 0) {
+			return false;
+		}
+
+		ret = read(fd, data, len);
+
+		if (ret < 0) {
+			if ((errno != EAGAIN) && (errno != EINTR)) {
+				return false;
+			}
+
+			continue;
+		}
+
+		if (ret == 0) {
+			return false;
+		}
+
+		data += ret;
+		len -= (size_t)ret;
+	}
+
+	return true;
+}
+
+static bool
+test_baud_rate(int baud)
+{
+	int master_fd = -1;
+	int fd = open_simulated_ncp(&master_fd, baud, "");
+	int actual;
+
+	if (fd < 0) {
+		return false;
+	}
+
+	actual = get_serial_baud_rate(fd);
+
+	close(fd);
+	close(master_fd);
+
+	printf("b%d -> %d baud\n", baud, actual);
+
+	return actual == baud;
+}
+
+static bool
+test_throughput(int baud)
+{
+	static uint8_t tx_frame[FRAME_SIZE];
+	static uint8_t rx_frame[FRAME_SIZE];
+	static uint8_t ncp_frame[FRAME_SIZE];
+	int master_fd = -1;
+	int fd = open_simulated_ncp(&master_fd, baud, ",vmin=0,vtime=0");
+	bool ret = false;
+	cms_t start;
+	cms_t elapsed;
+	int i;
+
+	if (fd < 0) {
+		return false;
+	}
+
+	start = time_ms();
+
+	for (i = 0; i < FRAME_COUNT; i++) {
+		memset(tx_frame, (uint8_t)i, sizeof(tx_frame));
+		tx_frame[0] = 0x7E;
+		tx_frame[sizeof(tx_frame) - 1] = 0x7E;
+
+		// Host -> NCP, then the NCP echoes the frame back.
+		if (!write_all(fd, tx_frame, sizeof(tx_frame))
+		 || !read_all(master_fd, ncp_frame, sizeof(ncp_frame))
+		 || !write_all(master_fd, ncp_frame, sizeof(ncp_frame))
+		 || !read_all(fd, rx_frame, sizeof(rx_frame))
+		) {
+			printf("frame %d was lost\n", i);
+			goto bail;
+		}
+
+		if (memcmp(tx_frame, rx_frame, sizeof(tx_frame)) != 0) {
+			printf("frame %d was corrupted\n", i);
+			goto bail;
+		}
+	}
+
+	elapsed = time_ms() - start;
+
+	printf(
+		"%d frames (%d bytes each way) at b%d in %d ms, %d kB/s\n",
+		FRAME_COUNT,
+		FRAME_COUNT * FRAME_SIZE,
+		baud,
+		(int)elapsed,
+		(int)((2LL * FRAME_COUNT * FRAME_SIZE) / (elapsed > 0 ? elapsed : 1))
+	);
+
+	ret = true;
+
+bail:
+	close(fd);
+	close(master_fd);
+	return ret;
+}
+
+int
+main(void)
+{
+	static const int kBaudRates[] = { 115200, 921600, 3000000 };
+	bool failed = false;
+	int fastest = 115200;
+	size_t i;
+
+	for (i = 0; i < sizeof(kBaudRates) / sizeof(kBaudRates[0]); i++) {
+		if (baud_rate_to_termios_constant(kBaudRates[i]) == 0) {
+			printf("b%d not supported on this platform, skipping\n", kBaudRates[i]);
+			continue;
+		}
+
+		failed |= !test_baud_rate(kBaudRates[i]);
+		fastest = kBaudRates[i];
+	}
+
+#if defined(__linux__)
+	// Not a standard rate, only reachable through `termios2`.
+	failed |= !test_baud_rate(1843200);
+#endif
+
+	// A pseudo-terminal doesn't actually pace the data, so this
+	// measures how much the host side can push through at most.
+	failed |= !test_throughput(fastest);
+
+	if (failed) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
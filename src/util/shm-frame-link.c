@@ -0,0 +1,407 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Frame link over a pair of shared-memory rings.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
+#include "shm-frame-link.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#endif
+
+static int
+set_cloexec(int fd, bool cloexec)
+{
+	int flags = fcntl(fd, F_GETFD);
+
+	if (flags < 0) {
+		return -1;
+	}
+
+	return fcntl(fd, F_SETFD, cloexec ? (flags | FD_CLOEXEC) : (flags & ~FD_CLOEXEC));
+}
+
+static int
+create_wake_fds(int* read_fd, int* write_fd)
+{
+#if defined(__linux__) && defined(EFD_NONBLOCK)
+	*read_fd = *write_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	return (*read_fd < 0) ? -1 : 0;
+#else
+	int fds[2];
+
+	if (pipe(fds) != 0) {
+		return -1;
+	}
+
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	set_cloexec(fds[0], true);
+	set_cloexec(fds[1], true);
+
+	*read_fd = fds[0];
+	*write_fd = fds[1];
+
+	return 0;
+#endif
+}
+
+static int
+create_shm_fd(size_t size)
+{
+	int fd = -1;
+
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+	fd = memfd_create("wpantund-shm-frame-link", MFD_CLOEXEC);
+#else
+	{
+		char name[64];
+		static unsigned int counter;
+
+		snprintf(name, sizeof(name), "/wpantund-shm-%d-%u", (int)getpid(), counter++);
+
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+		if (fd >= 0) {
+			// Nobody else needs to find it by name.
+			shm_unlink(name);
+			set_cloexec(fd, true);
+		}
+	}
+#endif
+
+	if ((fd >= 0) && (ftruncate(fd, (off_t)size) != 0)) {
+		close(fd);
+		fd = -1;
+	}
+
+	return fd;
+}
+
+// Both an eventfd and a pipe are fine with eight bytes at a time.
+static void
+wake(int fd)
+{
+	uint64_t value = 1;
+
+	if (write(fd, &value, sizeof(value)) < 0) {
+		// A full pipe already means "wake up".
+	}
+}
+
+static void
+init_link(struct shm_frame_link* link)
+{
+	memset(link, 0, sizeof(*link));
+	link->shm_fd = -1;
+	link->wake_fd = -1;
+	link->peer_wake_fd = -1;
+	link->ncp_wake_read_fd = -1;
+	link->ncp_wake_write_fd = -1;
+	link->host_wake_read_fd = -1;
+	link->host_wake_write_fd = -1;
+}
+
+static int
+map_region(struct shm_frame_link* link)
+{
+	void* region = mmap(NULL, sizeof(struct shm_frame_region), PROT_READ | PROT_WRITE, MAP_SHARED, link->shm_fd, 0);
+
+	if (region == MAP_FAILED) {
+		return -1;
+	}
+
+	link->region = (struct shm_frame_region*)region;
+
+	return 0;
+}
+
+int
+shm_frame_link_create(struct shm_frame_link* link)
+{
+	init_link(link);
+
+	if (((link->shm_fd = create_shm_fd(sizeof(struct shm_frame_region))) < 0)
+	 || (map_region(link) != 0)
+	 || (create_wake_fds(&link->ncp_wake_read_fd, &link->ncp_wake_write_fd) != 0)
+	 || (create_wake_fds(&link->host_wake_read_fd, &link->host_wake_write_fd) != 0)
+	) {
+		int err = errno;
+		shm_frame_link_close(link);
+		errno = err;
+		return -1;
+	}
+
+	// A fresh file is all zeros, which is two empty rings.
+	link->region->magic = SHM_FRAME_LINK_MAGIC;
+	link->region->version = SHM_FRAME_LINK_VERSION;
+
+	link->tx = &link->region->to_ncp;
+	link->rx = &link->region->to_host;
+	link->wake_fd = link->host_wake_read_fd;
+	link->peer_wake_fd = link->ncp_wake_write_fd;
+
+	return 0;
+}
+
+pid_t
+shm_frame_link_spawn(struct shm_frame_link* link, const char* command)
+{
+	pid_t pid = fork();
+
+	if (pid == 0) {
+		char fds[64];
+
+#if defined(__linux__)
+		prctl(PR_SET_PDEATHSIG, SIGHUP);
+#endif
+
+		snprintf(fds, sizeof(fds), "%d,%d,%d,%d,%d",
+			link->shm_fd,
+			link->ncp_wake_read_fd,
+			link->ncp_wake_write_fd,
+			link->host_wake_read_fd,
+			link->host_wake_write_fd
+		);
+
+		setenv(SHM_FRAME_LINK_ENV, fds, 1);
+
+		set_cloexec(link->shm_fd, false);
+		set_cloexec(link->ncp_wake_read_fd, false);
+		set_cloexec(link->ncp_wake_write_fd, false);
+		set_cloexec(link->host_wake_read_fd, false);
+		set_cloexec(link->host_wake_write_fd, false);
+
+		execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+
+		_exit(EXIT_FAILURE);
+	}
+
+	return pid;
+}
+
+int
+shm_frame_link_attach(struct shm_frame_link* link)
+{
+	const char* fds = getenv(SHM_FRAME_LINK_ENV);
+
+	init_link(link);
+
+	if ((fds == NULL)
+	 || (sscanf(fds, "%d,%d,%d,%d,%d",
+			&link->shm_fd,
+			&link->ncp_wake_read_fd,
+			&link->ncp_wake_write_fd,
+			&link->host_wake_read_fd,
+			&link->host_wake_write_fd) != 5)
+	) {
+		init_link(link);
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (map_region(link) != 0) {
+		return -1;
+	}
+
+	if ((link->region->magic != SHM_FRAME_LINK_MAGIC) || (link->region->version != SHM_FRAME_LINK_VERSION)) {
+		munmap(link->region, sizeof(struct shm_frame_region));
+		link->region = NULL;
+		errno = EPROTO;
+		return -1;
+	}
+
+	// Keep our children (if any) out of it.
+	set_cloexec(link->shm_fd, true);
+	set_cloexec(link->ncp_wake_read_fd, true);
+	set_cloexec(link->ncp_wake_write_fd, true);
+	set_cloexec(link->host_wake_read_fd, true);
+	set_cloexec(link->host_wake_write_fd, true);
+
+	fcntl(link->ncp_wake_read_fd, F_SETFL, fcntl(link->ncp_wake_read_fd, F_GETFL) | O_NONBLOCK);
+
+	link->tx = &link->region->to_host;
+	link->rx = &link->region->to_ncp;
+	link->wake_fd = link->ncp_wake_read_fd;
+	link->peer_wake_fd = link->host_wake_write_fd;
+
+	return 0;
+}
+
+static void
+close_fd(int* fd)
+{
+	if (*fd >= 0) {
+		close(*fd);
+	}
+	*fd = -1;
+}
+
+void
+shm_frame_link_close(struct shm_frame_link* link)
+{
+	if (link->region != NULL) {
+		munmap(link->region, sizeof(struct shm_frame_region));
+	}
+
+	// With eventfds, the read and write ends are the same descriptor.
+	if (link->ncp_wake_write_fd == link->ncp_wake_read_fd) {
+		link->ncp_wake_write_fd = -1;
+	}
+
+	if (link->host_wake_write_fd == link->host_wake_read_fd) {
+		link->host_wake_write_fd = -1;
+	}
+
+	close_fd(&link->shm_fd);
+	close_fd(&link->ncp_wake_read_fd);
+	close_fd(&link->ncp_wake_write_fd);
+	close_fd(&link->host_wake_read_fd);
+	close_fd(&link->host_wake_write_fd);
+
+	init_link(link);
+}
+
+int
+shm_frame_link_send(struct shm_frame_link* link, const void* frame, size_t frame_len)
+{
+	struct shm_frame_ring* ring = link->tx;
+	const uint32_t tail = ring->tail;
+	struct shm_frame_slot* slot;
+
+	if (frame_len > SHM_FRAME_LINK_MAX_FRAME_SIZE) {
+		return -EMSGSIZE;
+	}
+
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= SHM_FRAME_LINK_SLOTS) {
+		return -EAGAIN;
+	}
+
+	slot = &ring->slots[tail & (SHM_FRAME_LINK_SLOTS - 1)];
+	slot->length = (uint32_t)frame_len;
+	memcpy(slot->data, frame, frame_len);
+
+	// Publishing the frame and checking for a waiting consumer must
+	// not be reordered, see `shm_frame_link_can_receive()`.
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n(&ring->consumer_waiting, 0, __ATOMIC_SEQ_CST) != 0) {
+		wake(link->peer_wake_fd);
+	}
+
+	return 0;
+}
+
+ssize_t
+shm_frame_link_receive(struct shm_frame_link* link, void* buffer, size_t buffer_len)
+{
+	struct shm_frame_ring* ring = link->rx;
+	const uint32_t head = ring->head;
+	struct shm_frame_slot* slot;
+	ssize_t ret;
+
+	if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+
+	slot = &ring->slots[head & (SHM_FRAME_LINK_SLOTS - 1)];
+
+	if ((slot->length > buffer_len) || (slot->length > SHM_FRAME_LINK_MAX_FRAME_SIZE)) {
+		// Drop it, otherwise it would be stuck there forever.
+		ret = -EMSGSIZE;
+	} else {
+		memcpy(buffer, slot->data, slot->length);
+		ret = (ssize_t)slot->length;
+	}
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_exchange_n(&ring->producer_waiting, 0, __ATOMIC_SEQ_CST) != 0) {
+		wake(link->peer_wake_fd);
+	}
+
+	return ret;
+}
+
+void
+shm_frame_link_clear_wake(struct shm_frame_link* link)
+{
+	uint64_t value[8];
+
+	while (read(link->wake_fd, value, sizeof(value)) > 0) {
+	}
+}
+
+void
+shm_frame_link_wake_self(struct shm_frame_link* link)
+{
+	// Only the host knows both ends of its descriptor; the simulator
+	// is handed the other side's write end as well.
+	wake((link->wake_fd == link->host_wake_read_fd) ? link->host_wake_write_fd : link->ncp_wake_write_fd);
+}
+
+bool
+shm_frame_link_can_receive(struct shm_frame_link* link)
+{
+	struct shm_frame_ring* ring = link->rx;
+
+	if (ring->head != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+		return true;
+	}
+
+	// Nothing there. Ask to be woken up, then look again in case the
+	// producer added a frame before it could have seen our request.
+	__atomic_store_n(&ring->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+
+	return ring->head != __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+}
+
+bool
+shm_frame_link_can_send(struct shm_frame_link* link)
+{
+	struct shm_frame_ring* ring = link->tx;
+
+	if (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) < SHM_FRAME_LINK_SLOTS) {
+		return true;
+	}
+
+	__atomic_store_n(&ring->producer_waiting, 1, __ATOMIC_SEQ_CST);
+
+	return ring->tail - __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) < SHM_FRAME_LINK_SLOTS;
+}
@@ -0,0 +1,151 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Frame link over a pair of shared-memory rings.
+ *
+ *      Used between wpantund and an NCP simulator running on the same
+ *      host (see the `shm:` socket path prefix). Whole frames are copied
+ *      into fixed-size slots, so there is no HDLC framing, CRC or byte
+ *      stream involved. Each side has a wakeup file descriptor (an
+ *      eventfd where available, a pipe otherwise) which is only
+ *      signaled when the other side is actually waiting on it.
+ *
+ *      This file and `shm-frame-link.c` have no other dependencies, so
+ *      that simulators can simply build them in. A simulator started by
+ *      wpantund calls `shm_frame_link_attach()` and then:
+ *
+ *          for (;;) {
+ *              shm_frame_link_clear_wake(&link);
+ *              if (!shm_frame_link_can_receive(&link)) {
+ *                  poll() for POLLIN on link.wake_fd (and anything else);
+ *              }
+ *              while ((len = shm_frame_link_receive(&link, buf, sizeof(buf))) > 0) {
+ *                  ...handle the Spinel frame in `buf`...
+ *              }
+ *              ...shm_frame_link_send(&link, frame, frame_len) as needed...
+ *          }
+ *
+ */
+
+#ifndef wpantund_shm_frame_link_h
+#define wpantund_shm_frame_link_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define SHM_FRAME_LINK_MAGIC            0x53464c4b  // "SFLK"
+#define SHM_FRAME_LINK_VERSION          1
+
+// Number of frame slots in each direction, must be a power of two.
+#define SHM_FRAME_LINK_SLOTS            64
+
+#define SHM_FRAME_LINK_MAX_FRAME_SIZE   2048
+
+// Environment variable through which the simulator learns its file
+// descriptors: "<shm>,<ncp-wake-read>,<ncp-wake-write>,<host-wake-read>,<host-wake-write>"
+#define SHM_FRAME_LINK_ENV              "WPANTUND_SHM_FRAME_LINK"
+
+#ifndef __BEGIN_DECLS
+#ifdef __cplusplus
+#define __BEGIN_DECLS extern "C" {
+#define __END_DECLS }
+#else
+#define __BEGIN_DECLS
+#define __END_DECLS
+#endif
+#endif
+
+__BEGIN_DECLS
+
+struct shm_frame_slot {
+	uint32_t length;
+	uint8_t data[SHM_FRAME_LINK_MAX_FRAME_SIZE];
+};
+
+// The consumer and producer indexes are kept on separate cache lines.
+struct shm_frame_ring {
+	uint32_t head;                  //!^ Written by the consumer only
+	uint32_t consumer_waiting;      //!^ Consumer is waiting for a frame
+	uint8_t pad0[56];
+	uint32_t tail;                  //!^ Written by the producer only
+	uint32_t producer_waiting;      //!^ Producer is waiting for a free slot
+	uint8_t pad1[56];
+	struct shm_frame_slot slots[SHM_FRAME_LINK_SLOTS];
+};
+
+struct shm_frame_region {
+	uint32_t magic;
+	uint32_t version;
+	uint8_t pad[56];
+	struct shm_frame_ring to_ncp;
+	struct shm_frame_ring to_host;
+};
+
+struct shm_frame_link {
+	struct shm_frame_region* region;
+	struct shm_frame_ring* tx;
+	struct shm_frame_ring* rx;
+
+	int shm_fd;
+
+	//! Becomes readable when there is something to receive or room to send.
+	int wake_fd;
+
+	//! Signaled to wake up the other side.
+	int peer_wake_fd;
+
+	// Only used by the host, to hand the other ends to the simulator.
+	int ncp_wake_read_fd;
+	int ncp_wake_write_fd;
+	int host_wake_read_fd;
+	int host_wake_write_fd;
+};
+
+//! Host side: creates the shared memory and the wakeup descriptors.
+int shm_frame_link_create(struct shm_frame_link* link);
+
+//! Host side: runs `command` with `/bin/sh`, handing it the link. Returns the PID.
+pid_t shm_frame_link_spawn(struct shm_frame_link* link, const char* command);
+
+//! Simulator side: attaches to the link described by `SHM_FRAME_LINK_ENV`.
+int shm_frame_link_attach(struct shm_frame_link* link);
+
+void shm_frame_link_close(struct shm_frame_link* link);
+
+//! Returns zero, `-EAGAIN` if there is no free slot or `-EMSGSIZE`.
+int shm_frame_link_send(struct shm_frame_link* link, const void* frame, size_t frame_len);
+
+//! Returns the length of the frame copied into `buffer`, zero if there was no frame or `-EMSGSIZE`.
+ssize_t shm_frame_link_receive(struct shm_frame_link* link, void* buffer, size_t buffer_len);
+
+//! Consumes pending wakeups. Call before checking the rings, not after.
+void shm_frame_link_clear_wake(struct shm_frame_link* link);
+
+//! Makes our own `wake_fd` readable, e.g. to come back for frames still in the ring.
+void shm_frame_link_wake_self(struct shm_frame_link* link);
+
+//! If this returns false, `wake_fd` will become readable once a frame arrives.
+bool shm_frame_link_can_receive(struct shm_frame_link* link);
+
+//! If this returns false, `wake_fd` will become readable once a slot is free.
+bool shm_frame_link_can_send(struct shm_frame_link* link);
+
+__END_DECLS
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Runs itself as a simulated NCP behind `shm_frame_link_spawn()`,
+ *      which echoes every frame back, then checks that frames arrive
+ *      whole and in order (also while the rings are full) and measures
+ *      how many round trips per second the link manages.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "shm-frame-link.h"
+#include "time-utils.h"
+
+#define FRAME_SIZE          1300
+#define FRAME_COUNT         20000
+#define BURST_COUNT         (4 * SHM_FRAME_LINK_SLOTS)
+#define IO_TIMEOUT_MS       5000
+
+static bool
+wait_for_wake(struct shm_frame_link* link)
+{
+	struct pollfd pfd = { link->wake_fd, POLLIN, 0 };
+
+	return poll(&pfd, 1, IO_TIMEOUT_MS) > 0;
+}
+
+// Blocks until there is room, then sends.
+static bool
+send_frame(struct shm_frame_link* link, const uint8_t* frame, size_t len)
+{
+	while (true) {
+		shm_frame_link_clear_wake(link);
+
+		if (shm_frame_link_can_send(link)) {
+			return shm_frame_link_send(link, frame, len) == 0;
+		}
+
+		if (!wait_for_wake(link)) {
+			return false;
+		}
+	}
+}
+
+// Blocks until there is a frame, then receives it.
+static ssize_t
+receive_frame(struct shm_frame_link* link, uint8_t* buffer, size_t len)
+{
+	while (true) {
+		shm_frame_link_clear_wake(link);
+
+		if (shm_frame_link_can_receive(link)) {
+			return shm_frame_link_receive(link, buffer, len);
+		}
+
+		if (!wait_for_wake(link)) {
+			return -ETIMEDOUT;
+		}
+	}
+}
+
+static int
+run_simulator(void)
+{
+	static uint8_t frame[SHM_FRAME_LINK_MAX_FRAME_SIZE];
+	struct shm_frame_link link;
+	ssize_t len;
+
+	if (shm_frame_link_attach(&link) != 0) {
+		perror("shm_frame_link_attach");
+		return EXIT_FAILURE;
+	}
+
+	while ((len = receive_frame(&link, frame, sizeof(frame))) > 0) {
+		if (!send_frame(&link, frame, (size_t)len)) {
+			break;
+		}
+	}
+
+	shm_frame_link_close(&link);
+
+	return EXIT_SUCCESS;
+}
+
+static void
+fill_frame(uint8_t* frame, size_t len, int i)
+{
+	memset(frame, (uint8_t)i, len);
+	frame[0] = (uint8_t)(i >> 8);
+}
+
+static bool
+test_burst(struct shm_frame_link* link)
+{
+	static uint8_t tx_frame[FRAME_SIZE];
+	static uint8_t rx_frame[FRAME_SIZE];
+	int sent = 0;
+	int received = 0;
+
+	// Push far more than fits into both rings, so that each side has to
+	// wait on the other at some point.
+	while (received < BURST_COUNT) {
+		shm_frame_link_clear_wake(link);
+
+		while ((sent < BURST_COUNT) && shm_frame_link_can_send(link)) {
+			// Different lengths, to catch any mixup between slots.
+			fill_frame(tx_frame, 1 + (sent % FRAME_SIZE), sent);
+
+			if (shm_frame_link_send(link, tx_frame, 1 + (sent % FRAME_SIZE)) != 0) {
+				printf("burst frame %d could not be sent\n", sent);
+				return false;
+			}
+			sent++;
+		}
+
+		while (shm_frame_link_can_receive(link)) {
+			ssize_t len = shm_frame_link_receive(link, rx_frame, sizeof(rx_frame));
+
+			fill_frame(tx_frame, 1 + (received % FRAME_SIZE), received);
+
+			if ((len != 1 + (received % FRAME_SIZE)) || (memcmp(tx_frame, rx_frame, (size_t)len) != 0)) {
+				printf("burst frame %d was corrupted or out of order\n", received);
+				return false;
+			}
+			received++;
+		}
+
+		if ((received < BURST_COUNT) && !shm_frame_link_can_receive(link) && !wait_for_wake(link)) {
+			printf("burst stalled after %d sent, %d received\n", sent, received);
+			return false;
+		}
+	}
+
+	printf("%d frames bounced in a burst\n", BURST_COUNT);
+
+	return true;
+}
+
+static bool
+test_round_trips(struct shm_frame_link* link)
+{
+	static uint8_t tx_frame[FRAME_SIZE];
+	static uint8_t rx_frame[FRAME_SIZE];
+	cms_t start = time_ms();
+	cms_t elapsed;
+	int i;
+
+	for (i = 0; i < FRAME_COUNT; i++) {
+		fill_frame(tx_frame, sizeof(tx_frame), i);
+
+		if (!send_frame(link, tx_frame, sizeof(tx_frame))
+		 || (receive_frame(link, rx_frame, sizeof(rx_frame)) != sizeof(rx_frame))
+		) {
+			printf("frame %d was lost\n", i);
+			return false;
+		}
+
+		if (memcmp(tx_frame, rx_frame, sizeof(tx_frame)) != 0) {
+			printf("frame %d was corrupted\n", i);
+			return false;
+		}
+	}
+
+	elapsed = time_ms() - start;
+
+	printf(
+		"%d round trips of %d byte frames in %d ms, %d frames/s, %d kB/s\n",
+		FRAME_COUNT,
+		FRAME_SIZE,
+		(int)elapsed,
+		(int)((1000LL * FRAME_COUNT) / (elapsed > 0 ? elapsed : 1)),
+		(int)((2LL * FRAME_COUNT * FRAME_SIZE) / (elapsed > 0 ? elapsed : 1))
+	);
+
+	return true;
+}
+
+int
+main(int argc, char* argv[])
+{
+	struct shm_frame_link link;
+	char command[512];
+	bool failed = false;
+	pid_t pid;
+	int status = 0;
+
+	if ((argc > 1) && (strcmp(argv[1], "--simulator") == 0)) {
+		return run_simulator();
+	}
+
+	if (shm_frame_link_create(&link) != 0) {
+		perror("shm_frame_link_create");
+		return EXIT_FAILURE;
+	}
+
+	snprintf(command, sizeof(command), "exec '%s' --simulator", argv[0]);
+
+	pid = shm_frame_link_spawn(&link, command);
+
+	if (pid < 0) {
+		perror("shm_frame_link_spawn");
+		return EXIT_FAILURE;
+	}
+
+	{
+		static const uint8_t kTooBig[SHM_FRAME_LINK_MAX_FRAME_SIZE + 1];
+
+		failed |= (shm_frame_link_send(&link, kTooBig, sizeof(kTooBig)) != -EMSGSIZE);
+	}
+
+	failed |= !test_burst(&link);
+	failed |= !test_round_trips(&link);
+
+	kill(pid, SIGTERM);
+	waitpid(pid, &status, 0);
+	shm_frame_link_close(&link);
+
+	if (failed) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
@@ -64,6 +64,10 @@
 #include <sys/prctl.h>
 #endif
 
+#if defined(__linux__)
+#include <linux/serial.h>
+#endif
+
 
 #if !defined(HAVE_PTSNAME) && __APPLE__
 #define HAVE_PTSNAME 1
@@ -663,39 +667,168 @@ get_super_socket_type_from_path(const char* socket_name)
 	return socket_type;
 }
 
+static const struct {
+	int baud;
+	speed_t constant;
+} kBaudRateConstants[] = {
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+#ifdef B230400
+	{ 230400, B230400 },
+#endif
+#ifdef B460800
+	{ 460800, B460800 },
+#endif
+#ifdef B500000
+	{ 500000, B500000 },
+#endif
+#ifdef B576000
+	{ 576000, B576000 },
+#endif
+#ifdef B921600
+	{ 921600, B921600 },
+#endif
+#ifdef B1000000
+	{ 1000000, B1000000 },
+#endif
+#ifdef B1152000
+	{ 1152000, B1152000 },
+#endif
+#ifdef B1500000
+	{ 1500000, B1500000 },
+#endif
+#ifdef B2000000
+	{ 2000000, B2000000 },
+#endif
+#ifdef B2500000
+	{ 2500000, B2500000 },
+#endif
+#ifdef B3000000
+	{ 3000000, B3000000 },
+#endif
+#ifdef B3500000
+	{ 3500000, B3500000 },
+#endif
+#ifdef B4000000
+	{ 4000000, B4000000 },
+#endif
+};
+
 int
 baud_rate_to_termios_constant(int baud)
 {
-	int ret;
+	int ret = 0;
+	size_t i;
 	// Standard "TERMIOS" uses constants to get and set
 	// the baud rate, but we use the actual baud rate.
 	// This function converts from the actual baud rate
 	// to the constant supported by this platform. It
 	// returns zero if the baud rate is unsupported.
-	switch(baud) {
-	case 9600:
-		ret = B9600;
-		break;
-	case 19200:
-		ret = B19200;
-		break;
-	case 38400:
-		ret = B38400;
-		break;
-	case 57600:
-		ret = B57600;
-		break;
-	case 115200:
-		ret = B115200;
-		break;
-#ifdef B230400
-	case 230400:
-		ret = B230400;
-		break;
-#endif
-	default:
+	for (i = 0; i < sizeof(kBaudRateConstants) / sizeof(kBaudRateConstants[0]); i++) {
+		if (kBaudRateConstants[i].baud == baud) {
+			ret = (int)kBaudRateConstants[i].constant;
+			break;
+		}
+	}
+	return ret;
+}
+
+static int
+termios_constant_to_baud_rate(speed_t constant)
+{
+	int ret = 0;
+	size_t i;
+	for (i = 0; i < sizeof(kBaudRateConstants) / sizeof(kBaudRateConstants[0]); i++) {
+		if (kBaudRateConstants[i].constant == constant) {
+			ret = kBaudRateConstants[i].baud;
+			break;
+		}
+	}
+	return ret;
+}
+
+int
+set_serial_baud_rate(int fd, int baud)
+{
+	int ret = -1;
+	int constant = baud_rate_to_termios_constant(baud);
+
+	if (!isatty(fd)) {
+		// Nothing to do for sockets and pipes.
+		errno = ENOTTY;
+		return -1;
+	}
+
+	if (constant != 0) {
+		struct termios tios;
+
+		require(0 == tcgetattr(fd, &tios), bail);
+
+		cfsetspeed(&tios, constant);
+
+		require(0 == tcsetattr(fd, TCSANOW, &tios), bail);
+
 		ret = 0;
-		break;
+	} else {
+		// No constant for this rate, ask the driver
+		// for it directly if the platform allows that.
+		ret = set_serial_custom_baud_rate(fd, baud);
+	}
+
+bail:
+	if (ret != 0) {
+		syslog(LOG_ERR, "Unable to set baud rate to %d. \"%s\" (%d)", baud, strerror(errno), errno);
+	}
+
+	return ret;
+}
+
+int
+get_serial_baud_rate(int fd)
+{
+	int ret = get_serial_custom_baud_rate(fd);
+
+	if (ret <= 0) {
+		struct termios tios;
+
+		if (0 == tcgetattr(fd, &tios)) {
+			ret = termios_constant_to_baud_rate(cfgetospeed(&tios));
+		} else {
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
+
+static int
+set_serial_low_latency(int fd, bool low_latency)
+{
+	int ret = -1;
+#if defined(TIOCGSERIAL) && defined(ASYNC_LOW_LATENCY)
+	struct serial_struct serial;
+
+	require(0 == ioctl(fd, TIOCGSERIAL, &serial), bail);
+
+	if (low_latency) {
+		serial.flags |= ASYNC_LOW_LATENCY;
+	} else {
+		serial.flags &= ~ASYNC_LOW_LATENCY;
+	}
+
+	require(0 == ioctl(fd, TIOCSSERIAL, &serial), bail);
+
+	ret = 0;
+
+bail:
+#else
+	errno = ENOTSUP;
+#endif
+	if (ret != 0) {
+		syslog(LOG_WARNING, "Unable to change low-latency mode of serial port. \"%s\" (%d)", strerror(errno), errno);
 	}
 	return ret;
 }
@@ -881,10 +1014,7 @@ open_super_socket(const char* socket_name)
 		for (; NULL != options; options = strchr(options+1, ',')) {
 			if (strcasehasprefix(options, ",b") && isdigit(options[2])) {
 				// Change Baud rate
-				int baud = baud_rate_to_termios_constant((int)strtol(options+2,NULL,10));
-				FETCH_TERMIOS();
-				cfsetspeed(&tios, baud);
-				COMMIT_TERMIOS();
+				set_serial_baud_rate(fd, (int)strtol(options+2,NULL,10));
 			} else if (strcasehasprefix(options, ",default")) {
 				FETCH_TERMIOS();
 				for (i=0; i < NCCS; i++) {
@@ -897,13 +1027,33 @@ open_super_socket(const char* socket_name)
 				tios.c_lflag = 0;
 
 				cfmakeraw(&tios);
-				cfsetspeed(&tios, baud_rate_to_termios_constant(gSocketWrapperBaud));
 				COMMIT_TERMIOS();
+				set_serial_baud_rate(fd, gSocketWrapperBaud);
 			} else if (strcasehasprefix(options, ",raw")) {
 				// Raw mode
 				FETCH_TERMIOS();
 				cfmakeraw(&tios);
 				COMMIT_TERMIOS();
+			} else if (strcasehasprefix(options, ",low_latency=")) {
+				// Have the driver push received bytes to us
+				// right away instead of batching them up.
+				options = strchr(options,'=');
+				if (options[1] == '1') {
+					set_serial_low_latency(fd, true);
+				} else if (options[1] == '0') {
+					set_serial_low_latency(fd, false);
+				}
+			} else if (strcasehasprefix(options, ",vmin=")) {
+				FETCH_TERMIOS();
+				options = strchr(options,'=');
+				tios.c_cc[VMIN] = (cc_t)strtol(options+1,NULL,10);
+				COMMIT_TERMIOS();
+			} else if (strcasehasprefix(options, ",vtime=")) {
+				// In tenths of a second.
+				FETCH_TERMIOS();
+				options = strchr(options,'=');
+				tios.c_cc[VTIME] = (cc_t)strtol(options+1,NULL,10);
+				COMMIT_TERMIOS();
 			} else if (strcasehasprefix(options, ",clocal=")) {
 				FETCH_TERMIOS();
 				options = strchr(options,'=');
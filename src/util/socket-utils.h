@@ -33,6 +33,7 @@
 #define SOCKET_TCP_COMMAND_PREFIX	"tcp:"
 #define SOCKET_SYSTEM_FORKPTY_COMMAND_PREFIX	"system-forkpty:"
 #define SOCKET_SYSTEM_SOCKETPAIR_COMMAND_PREFIX	"system-socketpair:"
+#define SOCKET_SHM_COMMAND_PREFIX	"shm:"
 
 #ifndef SOCKET_UTILS_DEFAULT_SHELL
 #define SOCKET_UTILS_DEFAULT_SHELL         "/bin/sh"
@@ -47,6 +48,18 @@ int close_super_socket(int fd);
 int fd_has_error(int fd);
 int checkpoll(int fd, int poll_flags);
 
+int baud_rate_to_termios_constant(int baud);
+
+//! Sets the baud rate of a serial port. Rates without a `Bxxx` constant are supported on Linux.
+int set_serial_baud_rate(int fd, int baud);
+
+//! Returns the current baud rate of a serial port, or -1 on error.
+int get_serial_baud_rate(int fd);
+
+// Implemented in `serial-baud.c`, use the two functions above instead.
+int set_serial_custom_baud_rate(int fd, int baud);
+int get_serial_custom_baud_rate(int fd);
+
 enum {
 	SUPER_SOCKET_TYPE_UNKNOWN,
 	SUPER_SOCKET_TYPE_SYSTEM,
@@ -52,6 +52,12 @@ time_ms(void)
 	return (cms_t)sFuzzCms;
 }
 
+uint64_t
+time_us(void)
+{
+	return sFuzzCms * USEC_PER_MSEC;
+}
+
 time_t
 time_get_monotonic(void)
 {
@@ -77,6 +83,22 @@ time_ms(void)
 #endif
 }
 
+uint64_t
+time_us(void)
+{
+#if HAVE_CLOCK_GETTIME
+	struct timespec tv = { 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &tv);
+
+	return (uint64_t)tv.tv_sec * MSEC_PER_SEC * USEC_PER_MSEC + (uint64_t)(tv.tv_nsec / 1000);
+#else
+	struct timeval tv = { 0 };
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * MSEC_PER_SEC * USEC_PER_MSEC + (uint64_t)tv.tv_usec;
+#endif
+}
+
 time_t
 time_get_monotonic(void)
 {
@@ -59,6 +59,7 @@ __BEGIN_DECLS
 typedef int32_t cms_t;
 
 extern cms_t time_ms(void);
+extern uint64_t time_us(void);
 extern time_t time_get_monotonic(void);
 extern cms_t cms_until_time(time_t time);
 
@@ -0,0 +1,180 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Runs a minimal main loop on `Timer` alone and counts how often
+ *      it wakes up: timers with slack must share wakeups, and a loop
+ *      with only the daemon's periodic housekeeping timers must stay
+ *      at about one wakeup per minute in steady state.
+ *
+ *      Built with `FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION`, so that
+ *      `time_ms()` only moves when the loop "sleeps" and hours of
+ *      housekeeping take no time at all.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Timer.h"
+#include "wpantund/MainLoopProfiler.h"
+
+using namespace nl;
+
+static int gFireCount;
+
+static void
+timer_did_fire(Timer *timer)
+{
+	(void)timer;
+	gFireCount++;
+}
+
+// Runs the loop for `duration` ms and returns the number of wakeups.
+static int
+run_main_loop(cms_t duration)
+{
+	nl::wpantund::MainLoopProfiler& profiler(nl::wpantund::MainLoopProfiler::get_shared());
+	cms_t end = time_ms() + duration;
+	int wakeups = 0;
+
+	while (end - time_ms() > 0) {
+		cms_t cms_timeout = end - time_ms();
+
+		Timer::update_timeout(&cms_timeout);
+
+		if (cms_timeout < 0) {
+			cms_timeout = 0;
+		}
+
+		// Sleep
+		fuzz_ff_cms(cms_timeout);
+
+		if (end - time_ms() > 0) {
+			profiler.record_select(cms_timeout, 0, NULL, NULL, 0);
+			wakeups++;
+		}
+
+		Timer::process();
+	}
+
+	return wakeups;
+}
+
+int main(void)
+{
+	static const Timer::Interval kPeriods[] = { 200, 210, 220, 230 };
+	static const int kTimerCount = sizeof(kPeriods) / sizeof(kPeriods[0]);
+	static const cms_t kDuration = 1000;
+	Timer timers[kTimerCount];
+	int fires_without_slack;
+	int wakeups_without_slack;
+	int wakeups;
+	int errors = 0;
+
+	fuzz_set_cms(1);
+
+	// Without slack, every timer wakes the loop up by itself.
+	gFireCount = 0;
+
+	for (int i = 0; i < kTimerCount; i++) {
+		timers[i].schedule(kPeriods[i], &timer_did_fire, Timer::kPeriodicFixedRate);
+	}
+
+	wakeups_without_slack = run_main_loop(kDuration);
+	fires_without_slack = gFireCount;
+
+	// With slack, they fire together.
+	gFireCount = 0;
+
+	for (int i = 0; i < kTimerCount; i++) {
+		timers[i].set_slack(100);
+		timers[i].schedule(kPeriods[i], &timer_did_fire, Timer::kPeriodicFixedRate);
+	}
+
+	wakeups = run_main_loop(kDuration);
+
+	printf("without slack: %d wakeups for %d timer callbacks\n", wakeups_without_slack, fires_without_slack);
+	printf("with slack: %d wakeups for %d timer callbacks\n", wakeups, gFireCount);
+
+	if (gFireCount < fires_without_slack - kTimerCount) {
+		printf("timers with slack fired too rarely\n");
+		errors++;
+	}
+
+	if (2 * wakeups > wakeups_without_slack) {
+		printf("timers with slack didn't share wakeups\n");
+		errors++;
+	}
+
+	// Steady state: only the housekeeping timers (counter sampling,
+	// topology cache, link statistics and the stat auto-log), each
+	// with the default slack like the daemon sets up. They are started
+	// a few seconds apart, as they would be in the daemon, so without
+	// slack they don't happen to fire together.
+	static const Timer::Interval kHousekeepingPeriods[kTimerCount] = {
+		Timer::kOneMinute,
+		5 * Timer::kOneMinute,
+		10 * Timer::kOneMinute,
+		Timer::kOneHour,
+	};
+	static const cms_t kSteadyStateDuration = 2 * Timer::kOneHour;
+	int wakeups_per_minute;
+
+	for (int i = 0; i < kTimerCount; i++) {
+		timers[i].set_slack(0);
+		timers[i].schedule(kHousekeepingPeriods[i], &timer_did_fire, Timer::kPeriodicFixedDelay);
+		fuzz_ff_cms(7 * Timer::kOneSecond);
+	}
+
+	wakeups_without_slack = run_main_loop(kSteadyStateDuration);
+
+	for (int i = 0; i < kTimerCount; i++) {
+		timers[i].set_slack(kHousekeepingPeriods[i] / Timer::kDefaultSlackDivisor);
+		timers[i].schedule(kHousekeepingPeriods[i], &timer_did_fire, Timer::kPeriodicFixedDelay);
+		fuzz_ff_cms(7 * Timer::kOneSecond);
+	}
+
+	wakeups = run_main_loop(kSteadyStateDuration);
+	wakeups_per_minute = nl::wpantund::MainLoopProfiler::get_shared().get_wakeups_per_minute();
+
+	printf("steady state: %d wakeups in %d minutes (%d without slack), %d per minute\n",
+		wakeups, kSteadyStateDuration / Timer::kOneMinute, wakeups_without_slack, wakeups_per_minute);
+
+	// The one-minute timer can't do better than one wakeup a minute,
+	// and everything else has to come along with it.
+	if (wakeups > kSteadyStateDuration / Timer::kOneMinute) {
+		printf("housekeeping timers woke the loop up by themselves\n");
+		errors++;
+	}
+
+	if (wakeups_per_minute > 1) {
+		printf("too many wakeups per minute in steady state\n");
+		errors++;
+	}
+
+	if (errors != 0) {
+		printf("FAIL\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
@@ -25,6 +25,7 @@
 #endif
 
 #include <getopt.h>
+#include <errno.h>
 #include "wpanctl-utils.h"
 #include "tool-cmd-setprop.h"
 #include "tool-cmd-getprop.h"
@@ -43,11 +44,183 @@ static const arg_list_item_t commissioner_option_list[] = {
 	{'e', "start", NULL, "Start native commissioner"},
 	{'d', "stop", NULL, "Stop native commissioner"},
 	{'a', "joiner-add", NULL, "Add joiner"},
+	{'b', "joiner-add-bulk", "file", "Add the joiners listed in a CSV file (EUI64,PSKd[,timeout] per line, - for stdin)"},
 	{'r', "joiner-remove", NULL, "Remove joiner"},
 	{'s', "status", NULL, "Status information"},
 	{0}
 };
 
+// Each joiner takes a round trip to the NCP, so a long list needs
+// more time than a single command.
+#define JOINER_ADD_BULK_TIMEOUT_PER_ENTRY_MS    50
+
+static int
+joiner_add_bulk(const char* prog, const char* file_path, uint32_t joiner_timeout, int timeout)
+{
+	int ret = 0;
+	DBusConnection* connection = NULL;
+	DBusMessage *message = NULL;
+	DBusMessage *reply = NULL;
+	DBusMessageIter iter;
+	DBusError error;
+	FILE* file = NULL;
+	char** entries = NULL;
+	int entry_count = 0;
+	int entry_capacity = 0;
+	char* line = NULL;
+	size_t line_size = 0;
+	ssize_t line_len;
+	char path[DBUS_MAXIMUM_NAME_LENGTH+1];
+	char interface_dbus_name[DBUS_MAXIMUM_NAME_LENGTH+1];
+
+	dbus_error_init(&error);
+
+	if (strcmp(file_path, "-") == 0) {
+		file = stdin;
+	} else {
+		file = fopen(file_path, "r");
+	}
+
+	if (file == NULL) {
+		fprintf(stderr, "%s: error: Unable to open \"%s\": %s\n", prog, file_path, strerror(errno));
+		ret = ERRORCODE_BADARG;
+		goto bail;
+	}
+
+	// Lines are sent as they are, wpantund checks them all (and skips
+	// empty lines and comments) before adding any.
+	while ((line_len = getline(&line, &line_size, file)) >= 0) {
+		if (entry_count == entry_capacity) {
+			char** new_entries;
+
+			entry_capacity = entry_capacity ? 2 * entry_capacity : 64;
+			new_entries = realloc(entries, entry_capacity * sizeof(*entries));
+			require_action(new_entries != NULL, bail, ret = ERRORCODE_ERRNO);
+			entries = new_entries;
+		}
+
+		if ((line_len > 0) && (line[line_len - 1] == '\n')) {
+			line[line_len - 1] = 0;
+		}
+
+		entries[entry_count] = strdup(line);
+		require_action(entries[entry_count] != NULL, bail, ret = ERRORCODE_ERRNO);
+		entry_count++;
+	}
+
+	if (gInterfaceName[0] == 0) {
+		fprintf(stderr,
+				"%s: error: No WPAN interface set (use the `cd` command, or the `-I` argument for `wpanctl`).\n",
+				prog);
+		ret = ERRORCODE_BADARG;
+		goto bail;
+	}
+
+	connection = dbus_bus_get(DBUS_BUS_STARTER, &error);
+
+	if (!connection) {
+		dbus_error_free(&error);
+		dbus_error_init(&error);
+		connection = dbus_bus_get(DBUS_BUS_SYSTEM, &error);
+	}
+
+	require_string(connection != NULL, bail, error.message);
+
+	ret = lookup_dbus_name_from_interface(interface_dbus_name, gInterfaceName);
+	if (ret != 0) {
+		print_error_diagnosis(ret);
+		goto bail;
+	}
+
+	snprintf(path,
+			 sizeof(path),
+			 "%s/%s",
+			 WPANTUND_DBUS_PATH,
+			 gInterfaceName);
+
+	message = dbus_message_new_method_call(
+		interface_dbus_name,
+		path,
+		WPANTUND_DBUS_APIv1_INTERFACE,
+		WPANTUND_IF_CMD_JOINER_ADD_BULK
+	);
+
+	dbus_message_append_args(
+		message,
+		DBUS_TYPE_UINT32, &joiner_timeout,
+		DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &entries, entry_count,
+		DBUS_TYPE_INVALID
+	);
+
+	reply = dbus_connection_send_with_reply_and_block(
+		connection,
+		message,
+		timeout + entry_count * JOINER_ADD_BULK_TIMEOUT_PER_ENTRY_MS,
+		&error
+	);
+
+	if (!reply) {
+		fprintf(stderr, "%s: error: %s\n", prog, error.message);
+		ret = ERRORCODE_TIMEOUT;
+		goto bail;
+	}
+
+	dbus_message_iter_init(reply, &iter);
+	dbus_message_iter_get_basic(&iter, &ret);
+	dbus_message_iter_next(&iter);
+
+	// The entries which couldn't be added, with the reason why
+	if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_ARRAY) {
+		DBusMessageIter list_iter;
+
+		for (dbus_message_iter_recurse(&iter, &list_iter);
+		     dbus_message_iter_get_arg_type(&list_iter) == DBUS_TYPE_STRING;
+		     dbus_message_iter_next(&list_iter)) {
+			const char* failure = NULL;
+
+			dbus_message_iter_get_basic(&list_iter, &failure);
+			fprintf(stderr, "Line %s\n", failure);
+		}
+	}
+
+	if (!ret) {
+		fprintf(stderr, "Joiners added.\n");
+	} else {
+		fprintf(stderr, "%s failed with error %d. %s\n", prog, ret, wpantund_status_to_cstr(ret));
+		print_error_diagnosis(ret);
+	}
+
+bail:
+	if (connection) {
+		dbus_connection_unref(connection);
+	}
+
+	if (message) {
+		dbus_message_unref(message);
+	}
+
+	if (reply) {
+		dbus_message_unref(reply);
+	}
+
+	if ((file != NULL) && (file != stdin)) {
+		fclose(file);
+	}
+
+	if (entries != NULL) {
+		while (entry_count-- > 0) {
+			free(entries[entry_count]);
+		}
+		free(entries);
+	}
+
+	free(line);
+
+	dbus_error_free(&error);
+
+	return ret;
+}
+
 int tool_cmd_commissioner(int argc, char* argv[])
 {
 	int ret = 0;
@@ -77,13 +250,14 @@ int tool_cmd_commissioner(int argc, char* argv[])
 			{"start", no_argument, 0, 'e'},
 			{"stop", no_argument, 0, 'd'},
 			{"joiner-add", no_argument, 0, 'a'},
+			{"joiner-add-bulk", required_argument, 0, 'b'},
 			{"remove", required_argument, 0, 'r'},
 			{"status", no_argument, 0, 's'},
 			{0, 0, 0, 0}
 		};
 
 		int option_index = 0;
-		c = getopt_long(argc, argv, "hst:edr:a", long_options,
+		c = getopt_long(argc, argv, "hst:edr:ab:", long_options,
 						&option_index);
 		if (c == -1)
 			break;
@@ -261,6 +435,24 @@ int tool_cmd_commissioner(int argc, char* argv[])
 
 			goto bail;
 
+		case 'b':
+			// add bulk
+			if (optind < argc) {
+				joiner_timeout = (uint32_t) strtol(argv[optind], NULL, 0);
+				optind++;
+			}
+
+			if (optind < argc) {
+				fprintf(stderr,
+						"%s: error: Unexpected extra argument: \"%s\"\n",
+						argv[0], argv[optind]);
+				ret = ERRORCODE_BADARG;
+				goto bail;
+			}
+
+			ret = joiner_add_bulk(argv[0], optarg, joiner_timeout, timeout);
+			goto bail;
+
 		case 'r':
 			// remove
 			ret = ERRORCODE_NOT_IMPLEMENTED;
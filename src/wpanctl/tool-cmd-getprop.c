@@ -22,12 +22,14 @@
 #endif
 
 #include <getopt.h>
+#include <errno.h>
 #include "wpanctl-utils.h"
 #include "tool-cmd-getprop.h"
 #include "assert-macros.h"
 #include "args.h"
 #include "assert-macros.h"
 #include "wpan-dbus-v1.h"
+#include "wpan-ipc-client.h"
 
 const char getprop_cmd_syntax[] = "[args] <property-name>";
 
@@ -39,6 +41,231 @@ static const arg_list_item_t getprop_option_list[] = {
 	{0}
 };
 
+static void
+print_property_error(const char* property_name, DBusMessageIter *iter, int status)
+{
+	const char* error_cstr = NULL;
+
+	// Try to see if there is an error explanation we can extract
+	if (dbus_message_iter_get_arg_type(iter) == DBUS_TYPE_STRING) {
+		dbus_message_iter_get_basic(iter, &error_cstr);
+	}
+
+	if(!error_cstr || error_cstr[0] == 0) {
+		error_cstr = (status<0)?strerror(-status):"Get failed";
+	}
+
+	fprintf(stderr, "%s: %s (%d)\n", property_name, error_cstr, status);
+}
+
+// Fetches all of `property_names` with a single `PropGetMulti` call.
+// Returns ERRORCODE_NOT_IMPLEMENTED if wpantund doesn't know that
+// method, otherwise the status of the last property (like fetching
+// them one at a time would).
+static int
+getprop_multi(
+	DBusConnection *connection,
+	const char* interface_dbus_name,
+	const char* path,
+	const char** property_names,
+	int property_count,
+	int timeout,
+	bool value_only,
+	const char* argv0
+) {
+	int ret = 0;
+	DBusMessage *message = NULL;
+	DBusMessage *reply = NULL;
+	DBusMessageIter iter;
+	DBusMessageIter dict_iter;
+	DBusError error;
+
+	dbus_error_init(&error);
+
+	message = dbus_message_new_method_call(
+	    interface_dbus_name,
+	    path,
+	    WPANTUND_DBUS_APIv1_INTERFACE,
+	    WPANTUND_IF_CMD_PROP_GET_MULTI
+	    );
+
+	dbus_message_append_args(
+	    message,
+	    DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &property_names, property_count,
+	    DBUS_TYPE_INVALID
+	    );
+
+	reply = dbus_connection_send_with_reply_and_block(
+	    connection,
+	    message,
+	    timeout,
+	    &error
+	    );
+
+	if (!reply) {
+		if (dbus_error_has_name(&error, DBUS_ERROR_UNKNOWN_METHOD)) {
+			ret = ERRORCODE_NOT_IMPLEMENTED;
+		} else {
+			fprintf(stderr, "%s: error: %s\n", argv0, error.message);
+			ret = ERRORCODE_TIMEOUT;
+		}
+		goto bail;
+	}
+
+	dbus_message_iter_init(reply, &iter);
+
+	// Get return code
+	dbus_message_iter_get_basic(&iter, &ret);
+
+	if (ret) {
+		fprintf(stderr, "%s: error: %s (%d)\n", argv0, "Get failed", ret);
+		goto bail;
+	}
+
+	dbus_message_iter_next(&iter);
+	dbus_message_iter_recurse(&iter, &dict_iter);
+
+	for (;
+	     dbus_message_iter_get_arg_type(&dict_iter) == DBUS_TYPE_DICT_ENTRY;
+	     dbus_message_iter_next(&dict_iter)) {
+		DBusMessageIter entry_iter;
+		DBusMessageIter struct_iter;
+		DBusMessageIter value_iter;
+		const char* property_name = NULL;
+
+		dbus_message_iter_recurse(&dict_iter, &entry_iter);
+		dbus_message_iter_get_basic(&entry_iter, &property_name);
+		dbus_message_iter_next(&entry_iter);
+
+		dbus_message_iter_recurse(&entry_iter, &struct_iter);
+		dbus_message_iter_get_basic(&struct_iter, &ret);
+		dbus_message_iter_next(&struct_iter);
+		dbus_message_iter_recurse(&struct_iter, &value_iter);
+
+		if (ret) {
+			print_property_error(property_name, &value_iter, ret);
+			continue;
+		}
+
+		if (!value_only)
+			fprintf(stdout, "%s = ", property_name);
+		dump_info_from_iter(stdout, &value_iter, 0, false, false);
+	}
+
+bail:
+	if (message)
+		dbus_message_unref(message);
+
+	if (reply)
+		dbus_message_unref(reply);
+
+	dbus_error_free(&error);
+
+	return ret;
+}
+
+struct getprop_ipc_context_s {
+	bool value_only;
+	int status;
+	char** names;
+	size_t name_count;
+};
+
+static void
+getprop_ipc_result(void* context, const char* property_name, int status, const wpan_ipc_value_t* value)
+{
+	struct getprop_ipc_context_s* getprop_context = context;
+
+	getprop_context->status = status;
+
+	if (status) {
+		fprintf(stderr, "%s: %s (%d)\n", property_name,
+		        (status < 0) ? strerror(-status) : wpantund_status_to_cstr(status), status);
+		return;
+	}
+
+	if (!getprop_context->value_only && property_name[0])
+		fprintf(stdout, "%s = ", property_name);
+	wpan_ipc_value_print(stdout, value);
+}
+
+static void
+getprop_ipc_names(void* context, const char* property_name, int status, const wpan_ipc_value_t* value)
+{
+	struct getprop_ipc_context_s* getprop_context = context;
+
+	(void)property_name;
+
+	getprop_context->status = status;
+
+	if (status) {
+		fprintf(stderr, "error: %s (%d)\n", wpantund_status_to_cstr(status), status);
+		return;
+	}
+
+	getprop_context->names = wpan_ipc_value_to_string_list(value, &getprop_context->name_count);
+
+	if (getprop_context->names == NULL) {
+		getprop_context->status = ERRORCODE_UNKNOWN;
+	}
+}
+
+// Same as the D-Bus path, but over wpantund's Unix-domain IPC socket.
+static int
+getprop_ipc(
+	const char** property_names,
+	int property_count,
+	bool get_all,
+	int timeout,
+	bool value_only,
+	const char* argv0
+) {
+	int ret = 0;
+	wpan_ipc_client_t* client = NULL;
+	struct getprop_ipc_context_s context = { value_only, 0, NULL, 0 };
+
+	client = wpan_ipc_client_open(gIPCSocketPath);
+
+	if (client == NULL) {
+		fprintf(stderr, "%s: error: Unable to connect to \"%s\": %s\n", argv0, gIPCSocketPath, strerror(errno));
+		ret = ERRORCODE_ERRNO;
+		goto bail;
+	}
+
+	wpan_ipc_client_set_timeout(client, timeout);
+
+	if (get_all) {
+		ret = wpan_ipc_get(client, gInterfaceName, "", &getprop_ipc_names, &context);
+
+		if (ret || context.status) {
+			goto bail;
+		}
+
+		property_names = (const char**)context.names;
+		property_count = (int)context.name_count;
+		context.value_only = false;
+	}
+
+	if (property_count == 1) {
+		ret = wpan_ipc_get(client, gInterfaceName, property_names[0], &getprop_ipc_result, &context);
+	} else {
+		ret = wpan_ipc_get_multi(client, gInterfaceName, property_names, (size_t)property_count, &getprop_ipc_result, &context);
+	}
+
+bail:
+	if (ret < 0) {
+		fprintf(stderr, "%s: error: %s\n", argv0, strerror(-ret));
+		ret = (ret == -ETIMEDOUT) ? ERRORCODE_TIMEOUT : ERRORCODE_ERRNO;
+	} else if (ret == 0) {
+		ret = context.status;
+	}
+
+	free(context.names);
+	wpan_ipc_client_close(client);
+
+	return ret;
+}
+
 int tool_cmd_getprop(int argc, char *argv[])
 {
 	int ret = 0;
@@ -118,18 +345,18 @@ int tool_cmd_getprop(int argc, char *argv[])
 		goto bail;
 	}
 
-	if (optind + 1 < argc) {
-		int cmd_and_flags = optind;
-		int j;
-		for (j = optind; j < argc; j++) {
-			optind = 0;
-			argv[cmd_and_flags] = argv[j];
-			ret = tool_cmd_getprop(cmd_and_flags + 1, argv);
-		}
+	if (gIPCSocketPath != NULL) {
+		ret = getprop_ipc(
+			(const char**)&argv[optind],
+			argc - optind,
+			get_all,
+			timeout,
+			value_only,
+			argv[0]
+		);
 		goto bail;
 	}
 
-
 	connection = dbus_bus_get(DBUS_BUS_STARTER, &error);
 
 	if (!connection) {
@@ -155,6 +382,31 @@ int tool_cmd_getprop(int argc, char *argv[])
 		         WPANTUND_DBUS_PATH,
 		         gInterfaceName);
 
+		if (optind + 1 < argc) {
+			ret = getprop_multi(
+				connection,
+				interface_dbus_name,
+				path,
+				(const char**)&argv[optind],
+				argc - optind,
+				timeout,
+				value_only,
+				argv[0]
+			);
+
+			if (ret == ERRORCODE_NOT_IMPLEMENTED) {
+				// Older wpantund, ask for one property at a time.
+				int cmd_and_flags = optind;
+				int j;
+				for (j = optind; j < argc; j++) {
+					optind = 0;
+					argv[cmd_and_flags] = argv[j];
+					ret = tool_cmd_getprop(cmd_and_flags + 1, argv);
+				}
+			}
+			goto bail;
+		}
+
 		message = dbus_message_new_method_call(
 		    interface_dbus_name,
 		    path,
@@ -187,19 +439,8 @@ int tool_cmd_getprop(int argc, char *argv[])
 		dbus_message_iter_get_basic(&iter, &ret);
 
 		if (ret) {
-			const char* error_cstr = NULL;
-
-			// Try to see if there is an error explanation we can extract
 			dbus_message_iter_next(&iter);
-			if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_STRING) {
-				dbus_message_iter_get_basic(&iter, &error_cstr);
-			}
-
-			if(!error_cstr || error_cstr[0] == 0) {
-				error_cstr = (ret<0)?strerror(-ret):"Get failed";
-			}
-
-			fprintf(stderr, "%s: %s (%d)\n", property_name, error_cstr, ret);
+			print_property_error(property_name, &iter, ret);
 			goto bail;
 		}
 
@@ -207,14 +448,50 @@ int tool_cmd_getprop(int argc, char *argv[])
 		dbus_message_iter_next(&iter);
 
 		if (get_all) {
+			const char** property_names = NULL;
+			int property_count = 0;
+
 			dbus_message_iter_recurse(&iter, &list_iter);
 
 			for (;
 			     dbus_message_iter_get_arg_type(&list_iter) == DBUS_TYPE_STRING;
 			     dbus_message_iter_next(&list_iter)) {
-				char* args[3] = { argv[0] };
-				dbus_message_iter_get_basic(&list_iter, &args[1]);
-				ret = tool_cmd_getprop(2, args);
+				const char** new_names = realloc(property_names, (property_count + 1) * sizeof(*property_names));
+
+				if (new_names == NULL) {
+					free(property_names);
+					ret = ERRORCODE_ALLOC;
+					goto bail;
+				}
+
+				property_names = new_names;
+				dbus_message_iter_get_basic(&list_iter, &property_names[property_count++]);
+			}
+
+			ret = getprop_multi(
+				connection,
+				interface_dbus_name,
+				path,
+				property_names,
+				property_count,
+				timeout,
+				false,
+				argv[0]
+			);
+
+			free(property_names);
+
+			if (ret == ERRORCODE_NOT_IMPLEMENTED) {
+				// Older wpantund, ask for one property at a time.
+				dbus_message_iter_recurse(&iter, &list_iter);
+
+				for (;
+				     dbus_message_iter_get_arg_type(&list_iter) == DBUS_TYPE_STRING;
+				     dbus_message_iter_next(&list_iter)) {
+					char* args[3] = { argv[0] };
+					dbus_message_iter_get_basic(&list_iter, &args[1]);
+					ret = tool_cmd_getprop(2, args);
+				}
 			}
 		} else {
 			if(!value_only && property_name[0])
@@ -26,6 +26,7 @@
 #include "tool-cmd-scan.h"
 #include "assert-macros.h"
 #include "wpan-dbus-v1.h"
+#include "wpan-properties.h"
 #include "string-utils.h"
 #include "args.h"
 
@@ -40,6 +41,10 @@ static const arg_list_item_t scan_option_list[] = {
 	{'j', "joiner-only", NULL, "Scan for joiner only devices (used in discover scan)"},
 	{'f', "enable-filtering", NULL, "Enable scan result filtering (used in discover scan)"},
 	{'p', "panid-filtering", NULL, "PANID used for filtering, 0xFFFF to disable (used in discover scan)"},
+	{'n', "match-name", "name", "Stop at the first network with this name"},
+	{'x', "match-xpanid", "xpanid", "Stop at the first network with this XPANID"},
+	{'P', "match-panid", "panid", "Stop at the first network with this PANID"},
+	{'r', "min-rssi", "dBm", "Only stop at a matching network heard at least this strongly"},
 	{0}
 };
 
@@ -49,6 +54,21 @@ struct wpan_network_info_s gScannedNetworks[SCANNED_NET_BUFFER_SIZE];
 static bool sEnergyScan;
 static bool sMleDiscoverScan;
 
+static void
+append_option_entry(DBusMessageIter *dict, const char *key, int type, const void *value)
+{
+	DBusMessageIter entry;
+	DBusMessageIter variant;
+	char signature[2] = { (char)type, 0 };
+
+	dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+	dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, signature, &variant);
+	dbus_message_iter_append_basic(&variant, type, value);
+	dbus_message_iter_close_container(&entry, &variant);
+	dbus_message_iter_close_container(dict, &entry);
+}
+
 static void
 print_scan_header(void)
 {
@@ -188,6 +208,13 @@ int tool_cmd_scan(int argc, char *argv[])
 	dbus_bool_t joiner_flag = FALSE;
 	dbus_bool_t enable_filtering = FALSE;
 	uint16_t pan_id_filter = 0xffff;
+	const char *match_name = NULL;
+	bool has_match_xpanid = false;
+	uint64_t match_xpanid = 0;
+	bool has_match_panid = false;
+	uint16_t match_panid = 0xffff;
+	bool has_min_rssi = false;
+	int16_t min_rssi = -128;
 
 	dbus_error_init(&error);
 
@@ -204,11 +231,15 @@ int tool_cmd_scan(int argc, char *argv[])
 			{"joiner-only", no_argument, 0, 'j'},
 			{"enable-filtering", no_argument, 0, 'f'},
 			{"panid-filtering", required_argument, 0, 'p'},
+			{"match-name", required_argument, 0, 'n'},
+			{"match-xpanid", required_argument, 0, 'x'},
+			{"match-panid", required_argument, 0, 'P'},
+			{"min-rssi", required_argument, 0, 'r'},
 			{0, 0, 0, 0}
 		};
 
 		int option_index = 0;
-		c = getopt_long(argc, argv, "hc:t:edjfp:", long_options,
+		c = getopt_long(argc, argv, "hc:t:edjfp:n:x:P:r:", long_options,
 				&option_index);
 
 		if (c == -1)
@@ -248,6 +279,25 @@ int tool_cmd_scan(int argc, char *argv[])
 		case 'p':
 			pan_id_filter = strtol(optarg, NULL, 0);
 			break;
+
+		case 'n':
+			match_name = optarg;
+			break;
+
+		case 'x':
+			match_xpanid = strtoull(optarg, NULL, 16);
+			has_match_xpanid = true;
+			break;
+
+		case 'P':
+			match_panid = strtol(optarg, NULL, 0);
+			has_match_panid = true;
+			break;
+
+		case 'r':
+			min_rssi = strtol(optarg, NULL, 0);
+			has_min_rssi = true;
+			break;
 		}
 	}
 
@@ -342,6 +392,39 @@ int tool_cmd_scan(int argc, char *argv[])
 			);
 		}
 
+		if (!sEnergyScan && (match_name || has_match_xpanid || has_match_panid || has_min_rssi)) {
+			DBusMessageIter dict;
+
+			dbus_message_iter_init_append(message, &iter);
+			dbus_message_iter_open_container(
+				&iter,
+				DBUS_TYPE_ARRAY,
+				DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+				DBUS_TYPE_STRING_AS_STRING
+				DBUS_TYPE_VARIANT_AS_STRING
+				DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+				&dict
+			);
+
+			if (match_name) {
+				append_option_entry(&dict, kWPANTUNDValueMapKey_Scan_MatchNetworkName, DBUS_TYPE_STRING, &match_name);
+			}
+
+			if (has_match_xpanid) {
+				append_option_entry(&dict, kWPANTUNDValueMapKey_Scan_MatchXPANID, DBUS_TYPE_UINT64, &match_xpanid);
+			}
+
+			if (has_match_panid) {
+				append_option_entry(&dict, kWPANTUNDValueMapKey_Scan_MatchPANID, DBUS_TYPE_UINT16, &match_panid);
+			}
+
+			if (has_min_rssi) {
+				append_option_entry(&dict, kWPANTUNDValueMapKey_Scan_MatchMinRSSI, DBUS_TYPE_INT16, &min_rssi);
+			}
+
+			dbus_message_iter_close_container(&iter, &dict);
+		}
+
 		print_scan_header();
 
 		if (!sEnergyScan) {
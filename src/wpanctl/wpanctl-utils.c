@@ -38,6 +38,7 @@ char gInterfaceName[32] = "utun2";
 char gInterfaceName[32] = "wpan0";
 #endif
 int gRet = 0;
+const char* gIPCSocketPath = NULL;
 
 void dump_info_from_iter(FILE* file, DBusMessageIter *iter, int indent, bool bare, bool indentFirstLine)
 {
@@ -145,6 +146,13 @@ void dump_info_from_iter(FILE* file, DBusMessageIter *iter, int indent, bool bar
 		fprintf(file, "0x%016llX", (unsigned long long)v);
 	}
 	break;
+	case DBUS_TYPE_DOUBLE:
+	{
+		double v;
+		dbus_message_iter_get_basic(iter, &v);
+		fprintf(file, "%g", v);
+	}
+	break;
 	default:
 		fprintf(file, "<%s>",
 		        dbus_message_type_to_string(dbus_message_iter_get_arg_type(iter)));
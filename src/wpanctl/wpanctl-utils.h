@@ -80,4 +80,7 @@ const char *node_type_int2str(uint16_t node_type);
 extern char gInterfaceName[32];
 extern int gRet;
 
+// Path of wpantund's Unix-domain IPC socket, or NULL to use D-Bus.
+extern const char* gIPCSocketPath;
+
 #endif
@@ -73,6 +73,8 @@ static arg_list_item_t option_list[] = {
 	  "Read commands from file"                                              },
 	{ 'I', "interface", "iface",
 	  "Set interface to use"                                                 },
+	{ 'U', "ipc-socket", "path",
+	  "Use wpantund's IPC socket where supported"                            },
 	{ 0, "ignore-mismatch", NULL, "Ignore driver version mismatch" },
 	{ 0 }
 };
@@ -444,6 +446,7 @@ int main(int argc, char * argv[])
 			{"ignore-mismatch", no_argument, 0, 'i'},
 			{"debug", no_argument, 0, 'd'},
 			{"interface", required_argument, 0, 'I'},
+			{"ipc-socket", required_argument, 0, 'U'},
 			{"file", required_argument, 0, 'f'},
 			{0, 0, 0, 0}
 		};
@@ -456,7 +459,7 @@ int main(int argc, char * argv[])
 			break;
 	}
 
-		c = getopt_long(argc, argv, "hvidI:f:", long_options,
+		c = getopt_long(argc, argv, "hvidI:U:f:", long_options,
 				&option_index);
 
 		if (c == -1)
@@ -486,6 +489,10 @@ int main(int argc, char * argv[])
 				 "%s", optarg);
 			break;
 
+		case 'U':
+			gIPCSocketPath = optarg;
+			break;
+
 		case 'i':
 			ignore_driver_version_mismatch = true;
 			break;
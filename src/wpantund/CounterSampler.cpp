@@ -0,0 +1,263 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Keeps a short history of periodic NCP counter samples and derives
+ *      rates, deltas and min/max values from it.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include "CounterSampler.h"
+#include "ValueType.h"
+#include "any-to.h"
+#include "wpan-properties.h"
+
+using namespace nl;
+using namespace wpantund;
+
+CounterSampler::CounterSampler()
+{
+	clear();
+}
+
+void
+CounterSampler::clear(void)
+{
+	mNames.clear();
+	mSamples.clear();
+	mLastRead.clear();
+}
+
+bool
+CounterSampler::empty(void) const
+{
+	return mSamples.empty();
+}
+
+void
+CounterSampler::record(const ValueMap& counters)
+{
+	Sample sample;
+	ValueMap::const_iterator iter;
+	bool same_names = (counters.size() == mNames.size());
+	size_t i;
+
+	for (iter = counters.begin(), i = 0; same_names && (iter != counters.end()); ++iter, ++i) {
+		same_names = (mNames[i] == iter->first);
+	}
+
+	if (!same_names) {
+		// A different set of counters (e.g. the NCP was replaced),
+		// so older samples can't be compared against this one.
+		clear();
+
+		for (iter = counters.begin(); iter != counters.end(); ++iter) {
+			mNames.push_back(iter->first);
+		}
+	}
+
+	sample.mTime = time_ms();
+	sample.mValues.reserve(counters.size());
+
+	for (iter = counters.begin(); iter != counters.end(); ++iter) {
+		sample.mValues.push_back(static_cast<uint32_t>(any_to_int(iter->second)));
+	}
+
+	if (mLastRead.empty()) {
+		mLastRead = sample.mValues;
+	}
+
+	mSamples.force_write(sample);
+}
+
+const CounterSampler::Sample*
+CounterSampler::previous_sample(void) const
+{
+	RingBuffer<Sample, COUNTER_SAMPLER_HISTORY_SIZE>::ReverseIterator iter = mSamples.rbegin();
+
+	if (iter == mSamples.rend()) {
+		return NULL;
+	}
+
+	++iter;
+
+	return (iter == mSamples.rend()) ? NULL : iter.get_ptr();
+}
+
+// Counters only ever go up, so a smaller value means the NCP was
+// reset and the counter started over from zero. (A 32-bit counter
+// wrapping around is far less likely at 802.15.4 packet rates.)
+uint32_t
+CounterSampler::counter_delta(uint32_t newer, uint32_t older)
+{
+	return (newer >= older) ? (newer - older) : newer;
+}
+
+double
+CounterSampler::rate_per_second(double delta, cms_t interval)
+{
+	return (interval > 0) ? (delta * 1000.0 / interval) : 0.0;
+}
+
+void
+CounterSampler::get_counters(ValueMap& output) const
+{
+	const Sample* last = mSamples.back();
+	size_t i;
+
+	if (last != NULL) {
+		for (i = 0; i < mNames.size(); i++) {
+			output[mNames[i]] = last->mValues[i];
+		}
+	}
+}
+
+void
+CounterSampler::get_rates(ValueMap& output) const
+{
+	const Sample* last = mSamples.back();
+	const Sample* previous = previous_sample();
+	size_t i;
+
+	if (previous != NULL) {
+		for (i = 0; i < mNames.size(); i++) {
+			output[mNames[i]] = rate_per_second(
+				counter_delta(last->mValues[i], previous->mValues[i]),
+				last->mTime - previous->mTime
+			);
+		}
+	}
+}
+
+void
+CounterSampler::get_deltas(ValueMap& output)
+{
+	const Sample* last = mSamples.back();
+	size_t i;
+
+	if (last != NULL) {
+		for (i = 0; i < mNames.size(); i++) {
+			output[mNames[i]] = counter_delta(last->mValues[i], mLastRead[i]);
+		}
+
+		mLastRead = last->mValues;
+	}
+}
+
+void
+CounterSampler::get_min_max(ValueMap& output, cms_t window) const
+{
+	RingBuffer<Sample, COUNTER_SAMPLER_HISTORY_SIZE>::ReverseIterator iter;
+	const Sample* newest = mSamples.back();
+	const Sample* newer = NULL;
+	const Sample* oldest = NULL;
+	std::vector<double> min_rate(mNames.size(), 0.0);
+	std::vector<double> max_rate(mNames.size(), 0.0);
+	std::vector<double> total(mNames.size(), 0.0);
+	cms_t now = time_ms();
+	size_t i;
+
+	for (iter = mSamples.rbegin(); iter != mSamples.rend(); ++iter) {
+		const Sample* older = iter.get_ptr();
+
+		// Always use at least the last two samples, even if the
+		// window is shorter than the sampling period.
+		if ((now - older->mTime > window) && (oldest != NULL)) {
+			break;
+		}
+
+		if (newer != NULL) {
+			for (i = 0; i < mNames.size(); i++) {
+				uint32_t delta = counter_delta(newer->mValues[i], older->mValues[i]);
+				double rate = rate_per_second(delta, newer->mTime - older->mTime);
+
+				if ((oldest == NULL) || (rate < min_rate[i])) {
+					min_rate[i] = rate;
+				}
+
+				if ((oldest == NULL) || (rate > max_rate[i])) {
+					max_rate[i] = rate;
+				}
+
+				total[i] += delta;
+			}
+
+			oldest = older;
+		}
+
+		newer = older;
+	}
+
+	if (oldest != NULL) {
+		for (i = 0; i < mNames.size(); i++) {
+			ValueMap entry;
+
+			entry[kWPANTUNDValueMapKey_CounterRate_Min] = min_rate[i];
+			entry[kWPANTUNDValueMapKey_CounterRate_Max] = max_rate[i];
+			entry[kWPANTUNDValueMapKey_CounterRate_Avg] = rate_per_second(total[i], newest->mTime - oldest->mTime);
+
+			output[mNames[i]] = entry;
+		}
+	}
+}
+
+void
+CounterSampler::to_string_list(const ValueMap& input, std::list<std::string>& output)
+{
+	ValueMap::const_iterator iter;
+	char c_string[200];
+
+	for (iter = input.begin(); iter != input.end(); ++iter) {
+		switch (value_type_of(iter->second)) {
+		case kValueType_UInt32:
+			snprintf(c_string, sizeof(c_string), "%-24s = %u", iter->first.c_str(), value_cast<uint32_t>(iter->second));
+			break;
+
+		case kValueType_Double:
+			// Doubles are always per-second rates here.
+			snprintf(c_string, sizeof(c_string), "%-24s = %.2f/s", iter->first.c_str(), value_cast<double>(iter->second));
+			break;
+
+		case kValueType_ValueMap:
+			{
+				const ValueMap& entry = value_cast<ValueMap>(iter->second);
+
+				snprintf(
+					c_string,
+					sizeof(c_string),
+					"%-24s min = %.2f/s, max = %.2f/s, avg = %.2f/s",
+					iter->first.c_str(),
+					value_cast<double>(entry.find(kWPANTUNDValueMapKey_CounterRate_Min)->second),
+					value_cast<double>(entry.find(kWPANTUNDValueMapKey_CounterRate_Max)->second),
+					value_cast<double>(entry.find(kWPANTUNDValueMapKey_CounterRate_Avg)->second)
+				);
+			}
+			break;
+
+		default:
+			snprintf(c_string, sizeof(c_string), "%-24s = %s", iter->first.c_str(), any_to_string(iter->second).c_str());
+			break;
+		}
+
+		output.push_back(c_string);
+	}
+}
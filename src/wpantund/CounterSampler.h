@@ -0,0 +1,91 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Keeps a short history of periodic NCP counter samples and derives
+ *      rates, deltas and min/max values from it.
+ *
+ */
+
+#ifndef wpantund_CounterSampler_h
+#define wpantund_CounterSampler_h
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <vector>
+#include "time-utils.h"
+#include "RingBuffer.h"
+#include "ValueMap.h"
+
+namespace nl {
+namespace wpantund {
+
+// Number of samples kept (at the default 10 second period, a bit over ten minutes)
+#define COUNTER_SAMPLER_HISTORY_SIZE        64
+
+class CounterSampler
+{
+public:
+	CounterSampler();
+
+	void clear(void);
+	bool empty(void) const;
+
+	// Adds a sample. `counters` maps each counter name to its current
+	// (`uint32_t`) value. If the set of names changes, the history is
+	// discarded and sampling starts over.
+	void record(const ValueMap& counters);
+
+	// Most recent value of each counter.
+	void get_counters(ValueMap& output) const;
+
+	// Per-second rate of each counter between the last two samples.
+	void get_rates(ValueMap& output) const;
+
+	// Change of each counter since the previous call (or since sampling
+	// started, for the first call).
+	void get_deltas(ValueMap& output);
+
+	// Min, max and average per-second rate of each counter over the
+	// samples taken in the last `window` milliseconds.
+	void get_min_max(ValueMap& output, cms_t window) const;
+
+	static void to_string_list(const ValueMap& input, std::list<std::string>& output);
+
+private:
+	struct Sample
+	{
+		cms_t mTime;
+		std::vector<uint32_t> mValues;
+	};
+
+	static uint32_t counter_delta(uint32_t newer, uint32_t older);
+	static double rate_per_second(double delta, cms_t interval);
+
+	const Sample* previous_sample(void) const;
+
+private:
+	std::vector<std::string> mNames;
+	RingBuffer<Sample, COUNTER_SAMPLER_HISTORY_SIZE> mSamples;
+	std::vector<uint32_t> mLastRead;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif  // defined(wpantund_CounterSampler_h)
@@ -0,0 +1,247 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      FrameCapture class implementation.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "assert-macros.h"
+#include "FrameCapture.h"
+
+#include <syslog.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+using namespace nl;
+using namespace wpantund;
+
+// Buffered records are written out at least this often.
+#define FRAME_CAPTURE_FLUSH_INTERVAL_US     1000000
+
+static uint64_t
+capture_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+FrameCapture::FrameCapture():
+	mFile(NULL),
+	mLastTimestamp(0),
+	mLastFlush(0),
+	mRecordCount(0)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	close();
+}
+
+int
+FrameCapture::open(const std::string& path)
+{
+	static const uint8_t header[FRAME_CAPTURE_HEADER_SIZE] = {
+		'W', 'F', 'C', 'P',
+		(FRAME_CAPTURE_VERSION & 0xFF), ((FRAME_CAPTURE_VERSION >> 8) & 0xFF),
+		0, 0
+	};
+	int ret = 0;
+
+	close();
+
+	mFile = fopen(path.c_str(), "wb");
+
+	if (mFile == NULL) {
+		ret = -errno;
+		syslog(LOG_ERR, "FrameCapture: Unable to open \"%s\": %s", path.c_str(), strerror(errno));
+		goto bail;
+	}
+
+	if (fwrite(header, sizeof(header), 1, mFile) != 1) {
+		ret = -errno;
+		syslog(LOG_ERR, "FrameCapture: Unable to write to \"%s\": %s", path.c_str(), strerror(errno));
+		fclose(mFile);
+		mFile = NULL;
+		goto bail;
+	}
+
+	mPath = path;
+	mLastTimestamp = capture_time_us();
+	mLastFlush = mLastTimestamp;
+	mRecordCount = 0;
+
+	syslog(LOG_NOTICE, "FrameCapture: Capturing frames to \"%s\"", path.c_str());
+
+bail:
+	return ret;
+}
+
+void
+FrameCapture::close(void)
+{
+	if (mFile != NULL) {
+		fclose(mFile);
+		mFile = NULL;
+
+		syslog(LOG_NOTICE, "FrameCapture: Captured %u records to \"%s\"", mRecordCount, mPath.c_str());
+	}
+
+	mPath.clear();
+}
+
+void
+FrameCapture::record(RecordType type, const uint8_t* data_ptr, size_t data_len)
+{
+	uint8_t header[FRAME_CAPTURE_RECORD_SIZE];
+	uint64_t now;
+	uint64_t delta;
+
+	require_quiet(mFile != NULL, bail);
+
+	if (data_len > UINT16_MAX) {
+		data_len = UINT16_MAX;
+	}
+
+	now = capture_time_us();
+	delta = now - mLastTimestamp;
+
+	if (delta > UINT32_MAX) {
+		delta = UINT32_MAX;
+	}
+
+	mLastTimestamp = now;
+
+	header[0] = (delta & 0xFF);
+	header[1] = ((delta >> 8) & 0xFF);
+	header[2] = ((delta >> 16) & 0xFF);
+	header[3] = ((delta >> 24) & 0xFF);
+	header[4] = static_cast<uint8_t>(type);
+	header[5] = 0;
+	header[6] = (data_len & 0xFF);
+	header[7] = ((data_len >> 8) & 0xFF);
+
+	if ((fwrite(header, sizeof(header), 1, mFile) != 1)
+	 || ((data_len > 0) && (fwrite(data_ptr, data_len, 1, mFile) != 1))
+	) {
+		syslog(LOG_ERR, "FrameCapture: Write to \"%s\" failed, stopping capture: %s", mPath.c_str(), strerror(errno));
+		close();
+		goto bail;
+	}
+
+	mRecordCount++;
+
+	if (now - mLastFlush >= FRAME_CAPTURE_FLUSH_INTERVAL_US) {
+		fflush(mFile);
+		mLastFlush = now;
+	}
+
+bail:
+	return;
+}
+
+FrameCaptureReader::FrameCaptureReader():
+	mFile(NULL),
+	mTimestamp(0)
+{
+}
+
+FrameCaptureReader::~FrameCaptureReader()
+{
+	close();
+}
+
+int
+FrameCaptureReader::open(const std::string& path)
+{
+	uint8_t header[FRAME_CAPTURE_HEADER_SIZE];
+	int ret = 0;
+
+	close();
+
+	mFile = fopen(path.c_str(), "rb");
+
+	if (mFile == NULL) {
+		ret = -errno;
+		goto bail;
+	}
+
+	if ((fread(header, sizeof(header), 1, mFile) != 1)
+	 || (memcmp(header, FRAME_CAPTURE_MAGIC, 4) != 0)
+	 || ((header[4] | (header[5] << 8)) != FRAME_CAPTURE_VERSION)
+	) {
+		ret = -EINVAL;
+		close();
+		goto bail;
+	}
+
+	mTimestamp = 0;
+
+bail:
+	return ret;
+}
+
+void
+FrameCaptureReader::close(void)
+{
+	if (mFile != NULL) {
+		fclose(mFile);
+		mFile = NULL;
+	}
+}
+
+int
+FrameCaptureReader::read(FrameCaptureRecord& record)
+{
+	uint8_t header[FRAME_CAPTURE_RECORD_SIZE];
+	size_t len;
+	int ret = 0;
+
+	require_action(mFile != NULL, bail, ret = -EBADF);
+
+	len = fread(header, 1, sizeof(header), mFile);
+
+	require_quiet(len != 0, bail);
+	require_action(len == sizeof(header), bail, ret = -EINVAL);
+
+	mTimestamp += (uint32_t)header[0]
+		| ((uint32_t)header[1] << 8)
+		| ((uint32_t)header[2] << 16)
+		| ((uint32_t)header[3] << 24);
+
+	record.mTimestamp = mTimestamp;
+	record.mType = header[4];
+	record.mData.resize(header[6] | (header[7] << 8));
+
+	if (!record.mData.empty()) {
+		require_action(fread(&record.mData[0], record.mData.size(), 1, mFile) == 1, bail, ret = -EINVAL);
+	}
+
+	ret = 1;
+
+bail:
+	return ret;
+}
@@ -0,0 +1,115 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Compact capture of the raw frames exchanged with the NCP and of
+ *      the packets exchanged with the network interface, so that a run
+ *      can later be replayed against the driver (see `wpantund-replay`).
+ *
+ *      File format (all integers little-endian):
+ *
+ *          header:  "WFCP" u16 version, u16 reserved
+ *          record:  u32 microseconds since the previous record (or since
+ *                   the capture started, for the first one),
+ *                   u8 type, u8 reserved, u16 length, payload
+ *
+ *      Frames are stored exactly as passed to or from the NCP driver,
+ *      without any HDLC/FLEN framing.
+ *
+ */
+
+#ifndef __wpantund__FrameCapture__
+#define __wpantund__FrameCapture__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace nl {
+namespace wpantund {
+
+#define FRAME_CAPTURE_MAGIC         "WFCP"
+#define FRAME_CAPTURE_VERSION       1
+#define FRAME_CAPTURE_HEADER_SIZE   8
+#define FRAME_CAPTURE_RECORD_SIZE   8
+
+class FrameCapture
+{
+public:
+	enum RecordType {
+		kFrameToNCP = 1,           //!^ Frame sent to the NCP
+		kFrameFromNCP = 2,         //!^ Frame received from the NCP
+		kPacketFromHost = 3,       //!^ Packet read from the network interface
+		kPacketToHost = 4,         //!^ Packet written to the network interface
+	};
+
+	FrameCapture();
+	~FrameCapture();
+
+	// Starts a new capture file, replacing any capture in progress.
+	// Returns zero or a negative errno.
+	int open(const std::string& path);
+
+	void close(void);
+
+	bool is_enabled(void) const { return mFile != NULL; }
+
+	const std::string& get_path(void) const { return mPath; }
+
+	uint32_t get_record_count(void) const { return mRecordCount; }
+
+	void record(RecordType type, const uint8_t* data_ptr, size_t data_len);
+
+private:
+	FILE* mFile;
+	std::string mPath;
+	uint64_t mLastTimestamp;
+	uint64_t mLastFlush;
+	uint32_t mRecordCount;
+};
+
+struct FrameCaptureRecord {
+	uint64_t mTimestamp;           //!^ Microseconds since the capture started
+	uint8_t mType;
+	std::vector<uint8_t> mData;
+};
+
+class FrameCaptureReader
+{
+public:
+	FrameCaptureReader();
+	~FrameCaptureReader();
+
+	// Returns zero or a negative errno (`-EINVAL` for a bad header).
+	int open(const std::string& path);
+
+	void close(void);
+
+	// Returns 1 if a record was read, zero at the end of the file or a
+	// negative errno if the file is truncated or can't be read.
+	int read(FrameCaptureRecord& record);
+
+private:
+	FILE* mFile;
+	uint64_t mTimestamp;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__FrameCapture__) */
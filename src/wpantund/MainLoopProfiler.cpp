@@ -0,0 +1,414 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <syslog.h>
+#include "MainLoopProfiler.h"
+
+using namespace nl;
+using namespace nl::wpantund;
+
+MainLoopProfiler&
+MainLoopProfiler::get_shared(void)
+{
+	static MainLoopProfiler sProfiler;
+
+	return sProfiler;
+}
+
+MainLoopProfiler::MainLoopProfiler(void):
+	mFds(FD_SETSIZE)
+{
+	add_source("Timer");
+	add_source("NCP");
+	add_source("NCP:TaskQueue");
+	add_source("NCP:VendorCustom");
+	add_source("NCP:FlowControl");
+	add_source("NCP:EgressScheduler");
+
+	add_stage("Select");
+	add_stage("Timer");
+	add_stage("NCP");
+	add_stage("PendingInterfaces");
+
+	clear();
+}
+
+int
+MainLoopProfiler::add_source(const std::string& name)
+{
+	SourceStats source;
+
+	if (mSources.size() >= MAIN_LOOP_PROFILER_MAX_SOURCES) {
+		return kSourceNone;
+	}
+
+	source.mName = name;
+	source.mWakeups = 0;
+	source.mZeroTimeoutWakeups = 0;
+	mSources.push_back(source);
+
+	return static_cast<int>(mSources.size()) - 1;
+}
+
+int
+MainLoopProfiler::add_stage(const std::string& name)
+{
+	StageStats stage;
+
+	if (mStages.size() >= MAIN_LOOP_PROFILER_MAX_STAGES) {
+		return kStageNone;
+	}
+
+	stage.mName = name;
+	mStages.push_back(stage);
+	mStages.back().mCount = 0;
+	mStages.back().mTotalTime = 0;
+	mStages.back().mMaxTime = 0;
+
+	for (int i = 0; i < kHistogramBuckets; i++) {
+		mStages.back().mHistogram[i] = 0;
+	}
+
+	return static_cast<int>(mStages.size()) - 1;
+}
+
+const char*
+MainLoopProfiler::get_source_name(int source) const
+{
+	if ((source < 0) || (source >= static_cast<int>(mSources.size()))) {
+		return "(none)";
+	}
+
+	return mSources[source].mName.c_str();
+}
+
+void
+MainLoopProfiler::clear(void)
+{
+	std::vector<SourceStats>::iterator source_iter;
+	std::vector<StageStats>::iterator stage_iter;
+	std::vector<FdStats>::iterator fd_iter;
+
+	for (source_iter = mSources.begin(); source_iter != mSources.end(); ++source_iter) {
+		source_iter->mWakeups = 0;
+		source_iter->mZeroTimeoutWakeups = 0;
+	}
+
+	for (stage_iter = mStages.begin(); stage_iter != mStages.end(); ++stage_iter) {
+		stage_iter->mCount = 0;
+		stage_iter->mTotalTime = 0;
+		stage_iter->mMaxTime = 0;
+
+		for (int i = 0; i < kHistogramBuckets; i++) {
+			stage_iter->mHistogram[i] = 0;
+		}
+	}
+
+	for (fd_iter = mFds.begin(); fd_iter != mFds.end(); ++fd_iter) {
+		fd_iter->mReadable = 0;
+		fd_iter->mWritable = 0;
+	}
+
+	mInIteration = false;
+	mMinSource = kSourceNone;
+	mMinTimeout = CMS_DISTANT_FUTURE;
+	mIterations = 0;
+	mZeroTimeoutIterations = 0;
+	mZeroTimeoutRun = 0;
+	mLongestZeroTimeoutRun = 0;
+	mIdleWakeups = 0;
+	mWakeups = 0;
+	mStartTime = time_ms();
+	mWakeupWindowStart = mStartTime;
+	mWakeupWindowCount = 0;
+	mWakeupsPerMinute = -1;
+}
+
+void
+MainLoopProfiler::begin_iteration(void)
+{
+	mInIteration = true;
+	mMinSource = kSourceNone;
+	mMinTimeout = CMS_DISTANT_FUTURE;
+}
+
+void
+MainLoopProfiler::note_timeout(int source, cms_t cms)
+{
+	// Components may also compute their timeouts outside of the main
+	// loop, which must not count as wakeups.
+	if (!mInIteration || (source == kSourceNone)) {
+		return;
+	}
+
+	if (cms < 0) {
+		cms = 0;
+	}
+
+	if (cms < mMinTimeout) {
+		mMinTimeout = cms;
+		mMinSource = source;
+	}
+}
+
+int
+MainLoopProfiler::end_iteration(cms_t cms_timeout)
+{
+	mInIteration = false;
+	mIterations++;
+
+	if (mMinSource != kSourceNone) {
+		mSources[mMinSource].mWakeups++;
+	}
+
+	if (cms_timeout <= 0) {
+		if (mMinSource != kSourceNone) {
+			mSources[mMinSource].mZeroTimeoutWakeups++;
+		}
+
+		mZeroTimeoutIterations++;
+		mZeroTimeoutRun++;
+
+		if (mZeroTimeoutRun > mLongestZeroTimeoutRun) {
+			mLongestZeroTimeoutRun = mZeroTimeoutRun;
+		}
+	} else {
+		mZeroTimeoutRun = 0;
+	}
+
+	return mMinSource;
+}
+
+void
+MainLoopProfiler::record_select(cms_t cms_timeout, int fds_ready, const fd_set* read_fd_set, const fd_set* write_fd_set, int fd_count)
+{
+	if (cms_timeout > 0) {
+		cms_t now = time_ms();
+
+		if (now - mWakeupWindowStart >= MSEC_PER_SEC * 60) {
+			mWakeupsPerMinute = static_cast<int>(static_cast<int64_t>(mWakeupWindowCount) * MSEC_PER_SEC * 60 / (now - mWakeupWindowStart));
+			mWakeupWindowStart = now;
+			mWakeupWindowCount = 0;
+		}
+
+		mWakeups++;
+		mWakeupWindowCount++;
+	}
+
+	if (fds_ready == 0) {
+		mIdleWakeups++;
+	}
+
+	if (fds_ready <= 0) {
+		return;
+	}
+
+	if (fd_count > static_cast<int>(mFds.size())) {
+		fd_count = static_cast<int>(mFds.size());
+	}
+
+	for (int fd = 0; (fd < fd_count) && (fds_ready > 0); fd++) {
+		bool ready = false;
+
+		if (FD_ISSET(fd, read_fd_set)) {
+			mFds[fd].mReadable++;
+			ready = true;
+		}
+
+		if (FD_ISSET(fd, write_fd_set)) {
+			mFds[fd].mWritable++;
+			ready = true;
+		}
+
+		if (ready) {
+			fds_ready--;
+		}
+	}
+}
+
+int
+MainLoopProfiler::get_wakeups_per_minute(void) const
+{
+	cms_t elapsed = time_ms() - mWakeupWindowStart;
+
+	// Nothing woke us up since the last full minute ended.
+	if (elapsed >= MSEC_PER_SEC * 60) {
+		return static_cast<int>(static_cast<int64_t>(mWakeupWindowCount) * MSEC_PER_SEC * 60 / elapsed);
+	}
+
+	if (mWakeupsPerMinute >= 0) {
+		return mWakeupsPerMinute;
+	}
+
+	if (elapsed <= 0) {
+		elapsed = 1;
+	}
+
+	return static_cast<int>(static_cast<int64_t>(mWakeupWindowCount) * MSEC_PER_SEC * 60 / elapsed);
+}
+
+int
+MainLoopProfiler::get_histogram_bucket(uint64_t duration)
+{
+	int bucket = 0;
+
+	for (duration >>= 2; (duration != 0) && (bucket < kHistogramBuckets - 1); duration >>= 2) {
+		bucket++;
+	}
+
+	return bucket;
+}
+
+void
+MainLoopProfiler::record_stage(int stage, uint64_t start)
+{
+	uint64_t duration = time_us() - start;
+	StageStats *stats;
+
+	if ((stage < 0) || (stage >= static_cast<int>(mStages.size()))) {
+		return;
+	}
+
+	stats = &mStages[stage];
+	stats->mCount++;
+	stats->mTotalTime += duration;
+
+	if (duration > stats->mMaxTime) {
+		stats->mMaxTime = duration;
+	}
+
+	stats->mHistogram[get_histogram_bucket(duration)]++;
+}
+
+void
+MainLoopProfiler::convert_to_string_list(std::list<std::string> &list) const
+{
+	std::vector<SourceStats>::const_iterator source_iter;
+	std::vector<StageStats>::const_iterator stage_iter;
+	char buffer[128];
+	cms_t elapsed = time_ms() - mStartTime;
+
+	snprintf(
+		buffer,
+		sizeof(buffer),
+		"Iterations: %u in %ds, %u with zero timeout (longest run %u), %u timed out",
+		mIterations,
+		static_cast<int>(elapsed / MSEC_PER_SEC),
+		mZeroTimeoutIterations,
+		mLongestZeroTimeoutRun,
+		mIdleWakeups
+	);
+	list.push_back(buffer);
+
+	snprintf(
+		buffer,
+		sizeof(buffer),
+		"Wakeups: %u, %d per minute",
+		mWakeups,
+		get_wakeups_per_minute()
+	);
+	list.push_back(buffer);
+
+	for (source_iter = mSources.begin(); source_iter != mSources.end(); ++source_iter) {
+		if (source_iter->mWakeups == 0) {
+			continue;
+		}
+
+		snprintf(
+			buffer,
+			sizeof(buffer),
+			"Timeout %s: shortest %u times, %u of which zero",
+			source_iter->mName.c_str(),
+			source_iter->mWakeups,
+			source_iter->mZeroTimeoutWakeups
+		);
+		list.push_back(buffer);
+	}
+
+	for (stage_iter = mStages.begin(); stage_iter != mStages.end(); ++stage_iter) {
+		std::string line;
+		uint64_t bound = 4;
+
+		if (stage_iter->mCount == 0) {
+			continue;
+		}
+
+		snprintf(
+			buffer,
+			sizeof(buffer),
+			"Stage %s: %u runs, avg %lluus, max %lluus,",
+			stage_iter->mName.c_str(),
+			stage_iter->mCount,
+			static_cast<unsigned long long>(stage_iter->mTotalTime / stage_iter->mCount),
+			static_cast<unsigned long long>(stage_iter->mMaxTime)
+		);
+		line = buffer;
+
+		for (int i = 0; i < kHistogramBuckets; i++, bound <<= 2) {
+			if (stage_iter->mHistogram[i] == 0) {
+				continue;
+			}
+
+			if (i == kHistogramBuckets - 1) {
+				snprintf(buffer, sizeof(buffer), " >=%lluus:%u", static_cast<unsigned long long>(bound >> 2), stage_iter->mHistogram[i]);
+			} else {
+				snprintf(buffer, sizeof(buffer), " <%lluus:%u", static_cast<unsigned long long>(bound), stage_iter->mHistogram[i]);
+			}
+			line += buffer;
+		}
+
+		list.push_back(line);
+	}
+
+	for (int fd = 0; fd < static_cast<int>(mFds.size()); fd++) {
+		if ((mFds[fd].mReadable == 0) && (mFds[fd].mWritable == 0)) {
+			continue;
+		}
+
+		snprintf(
+			buffer,
+			sizeof(buffer),
+			"FD %d: readable %u times, writable %u times",
+			fd,
+			mFds[fd].mReadable,
+			mFds[fd].mWritable
+		);
+		list.push_back(buffer);
+	}
+}
+
+void
+MainLoopProfiler::dump_to_syslog(int priority) const
+{
+	std::list<std::string> list;
+	std::list<std::string>::const_iterator iter;
+
+	convert_to_string_list(list);
+
+	syslog(priority, "Main loop profile:");
+
+	for (iter = list.begin(); iter != list.end(); ++iter) {
+		syslog(priority, "  %s", iter->c_str());
+	}
+}
@@ -0,0 +1,157 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *      Main loop instrumentation: which component decided how long each
+ *      iteration slept, which file descriptors woke it up and how long
+ *      each processing stage took.
+ *
+ */
+
+#ifndef __wpantund__MainLoopProfiler__
+#define __wpantund__MainLoopProfiler__
+
+#include <stdint.h>
+#include <sys/select.h>
+#include <list>
+#include <string>
+#include <vector>
+#include "time-utils.h"
+
+namespace nl {
+namespace wpantund {
+
+// Maximum number of timeout sources and of processing stages
+#define MAIN_LOOP_PROFILER_MAX_SOURCES          16
+#define MAIN_LOOP_PROFILER_MAX_STAGES           16
+
+class MainLoopProfiler
+{
+public:
+	// Timeout sources known up front. IPC servers are added at runtime.
+	enum
+	{
+		kSourceNone = -1,
+		kSourceTimer = 0,
+		kSourceNCP,
+		kSourceNCPTaskQueue,
+		kSourceNCPVendorCustom,
+		kSourceNCPFlowControl,
+		kSourceNCPEgressScheduler,
+	};
+
+	// Processing stages known up front. IPC servers are added at runtime.
+	enum
+	{
+		kStageNone = -1,
+		kStageSelect = 0,
+		kStageTimer,
+		kStageNCP,
+		kStagePendingInterfaces,
+	};
+
+	// Stage durations are kept in a histogram with power-of-four
+	// buckets: <4us, <16us, <64us, ... and a last open-ended bucket.
+	enum
+	{
+		kHistogramBuckets = 12,
+	};
+
+public:
+	static MainLoopProfiler& get_shared(void);
+
+	int add_source(const std::string& name);
+	int add_stage(const std::string& name);
+
+	const char* get_source_name(int source) const;
+
+	// Called while the main loop gathers the timeouts of its components.
+	// The source which asks for the shortest timeout gets the blame for
+	// the wakeup; on ties, the source which reported first wins.
+	void begin_iteration(void);
+	void note_timeout(int source, cms_t cms);
+	int end_iteration(cms_t cms_timeout);
+
+	// Called after `select()` returns. Returning from a `select()` which
+	// was allowed to block counts as a wakeup.
+	void record_select(cms_t cms_timeout, int fds_ready, const fd_set* read_fd_set, const fd_set* write_fd_set, int fd_count);
+
+	// Wakeups during the last full minute, or extrapolated from the
+	// current minute if a full one hasn't passed yet.
+	int get_wakeups_per_minute(void) const;
+
+	// `start` is a value previously returned by `time_us()`.
+	void record_stage(int stage, uint64_t start);
+
+	void clear(void);
+
+	void convert_to_string_list(std::list<std::string> &list) const;
+	void dump_to_syslog(int priority) const;
+
+private:
+	MainLoopProfiler(void);
+
+	struct SourceStats
+	{
+		std::string mName;
+		uint32_t mWakeups;
+		uint32_t mZeroTimeoutWakeups;
+	};
+
+	struct StageStats
+	{
+		std::string mName;
+		uint32_t mCount;
+		uint64_t mTotalTime;
+		uint64_t mMaxTime;
+		uint32_t mHistogram[kHistogramBuckets];
+	};
+
+	struct FdStats
+	{
+		uint32_t mReadable;
+		uint32_t mWritable;
+	};
+
+	static int get_histogram_bucket(uint64_t duration);
+
+private:
+	std::vector<SourceStats> mSources;
+	std::vector<StageStats> mStages;
+	std::vector<FdStats> mFds;
+
+	bool mInIteration;
+	int mMinSource;
+	cms_t mMinTimeout;
+
+	uint32_t mIterations;
+	uint32_t mZeroTimeoutIterations;
+	uint32_t mZeroTimeoutRun;
+	uint32_t mLongestZeroTimeoutRun;
+	uint32_t mIdleWakeups;
+	uint32_t mWakeups;
+	cms_t mStartTime;
+
+	cms_t mWakeupWindowStart;
+	uint32_t mWakeupWindowCount;
+	int mWakeupsPerMinute;
+};
+
+}; // namespace wpantund
+}; // namespace nl
+
+#endif /* defined(__wpantund__MainLoopProfiler__) */
@@ -196,6 +196,17 @@ public:
 		CallbackWithStatus cb = NilReturn()
 	) = 0;
 
+	// Adds many joiners at once. Each entry is a line of the form
+	// "<EUI64>,<PSKd>[,<timeout>]", where the EUI64 may be "*" to let any
+	// joiner knowing the PSKd in. `joiner_timeout` is used for entries
+	// without a timeout of their own. The callback gets the list of
+	// entries which could not be added, each with the reason.
+	virtual void joiner_add_bulk(
+		const std::list<std::string>& joiners,
+		uint32_t joiner_timeout,
+		CallbackWithStatusArg1 cb = NilReturn()
+	) = 0;
+
 	virtual void pcap_to_fd(
 		int fd,
 		CallbackWithStatus cb = NilReturn()
@@ -78,6 +78,12 @@ bail:
 	return static_cast<int>(ret);
 }
 
+bool
+NCPInstanceBase::can_hard_reset_ncp(void)
+{
+	return mResetSocket != NULL;
+}
+
 void
 NCPInstanceBase::hard_reset_ncp(void)
 {
@@ -148,8 +154,12 @@ NCPInstanceBase::get_ms_to_next_event(void)
 			ret = temp_cms;
 		}
 
-		if (ret > BUSY_DEBOUNCE_TIME_IN_MS && !is_busy()) {
-			ret = BUSY_DEBOUNCE_TIME_IN_MS;
+		// Wake up exactly when the debounce period is over, so that
+		// `update_busy_indication()` can clear `mWasBusy` in one go.
+		temp_cms = BUSY_DEBOUNCE_TIME_IN_MS - (time_ms() - mLastChangedBusy);
+
+		if (!is_busy() && (temp_cms < ret)) {
+			ret = (temp_cms > 0) ? temp_cms : 0;
 		}
 	}
 
@@ -248,6 +258,10 @@ NCPInstanceBase::process(void)
 
 	if (get_upgrade_status() != EINPROGRESS) {
 		driver_to_ncp_pump();
+
+		// Handle refreshes requested during this pass right away,
+		// instead of spinning through the main loop once more.
+		refresh_address_route_prefix_entries();
 	}
 
     update_busy_indication();
@@ -33,6 +33,7 @@
 #include "wpantund.h"
 #include "any-to.h"
 #include "IPv6Helpers.h"
+#include "MainLoopProfiler.h"
 
 using namespace nl;
 using namespace wpantund;
@@ -46,6 +47,7 @@ NCPInstanceBase::NCPInstanceBase(const Settings& settings):
 	mCommissioningExpiration(0)
 {
 	std::string wpan_interface_name = "wpan0";
+	bool is_multiplexed = false;
 
 	mResetSocket_BeginReset = '0';
 	mResetSocket_EndReset = '1';
@@ -92,6 +94,14 @@ NCPInstanceBase::NCPInstanceBase(const Settings& settings):
 	if (!settings.empty()) {
 		Settings::const_iterator iter;
 
+		// Instances which share the socket with others over separate
+		// Spinel IIDs get their serial adapter from the driver instead.
+		for(iter = settings.begin(); iter != settings.end(); iter++) {
+			if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPIID)) {
+				is_multiplexed = true;
+			}
+		}
+
 		for(iter = settings.begin(); iter != settings.end(); iter++) {
 			if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPHardResetPath)) {
 				mResetSocket = SuperSocket::create(iter->second);
@@ -100,7 +110,9 @@ NCPInstanceBase::NCPInstanceBase(const Settings& settings):
 				mPowerSocket = SuperSocket::create(iter->second);
 
 			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigNCPSocketPath)) {
-				mRawSerialAdapter = SuperSocket::create(iter->second);
+				if (!is_multiplexed) {
+					mRawSerialAdapter = SuperSocket::create(iter->second);
+				}
 
 			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigTUNInterfaceName)) {
 				wpan_interface_name = iter->second;
@@ -116,11 +128,18 @@ NCPInstanceBase::NCPInstanceBase(const Settings& settings):
 
 			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigDaemonNetworkRetainCommand)) {
 				mNetworkRetain.set_network_retain_command(iter->second);
+
+			} else if (strcaseequal(iter->first.c_str(), kWPANTUNDProperty_ConfigDaemonFrameCapture)) {
+				// Started here rather than as a property, so that the
+				// capture includes the initial reset of the NCP.
+				if (!iter->second.empty()) {
+					mFrameCapture.open(iter->second);
+				}
 			}
 		}
 	}
 
-	if (!mRawSerialAdapter) {
+	if (!mRawSerialAdapter && !is_multiplexed) {
 		syslog(LOG_WARNING, kWPANTUNDProperty_ConfigNCPSocketPath " was not specified. Using \"/dev/null\" instead.");
 		mRawSerialAdapter = SuperSocket::create("/dev/null");
 	}
@@ -194,7 +213,8 @@ NCPInstanceBase::setup_property_supported_by_class(const std::string& prop_name)
 		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPFirmwareCheckCommand)
 		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_DaemonAutoFirmwareUpdate)
 		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigNCPFirmwareUpgradeCommand)
-		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigDaemonNetworkRetainCommand);
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigDaemonNetworkRetainCommand)
+		|| strcaseequal(prop_name.c_str(), kWPANTUNDProperty_ConfigDaemonFrameCapture);
 }
 
 NCPInstanceBase::~NCPInstanceBase()
@@ -289,6 +309,9 @@ NCPInstanceBase::get_supported_property_keys(void) const
 
 	properties.insert(kWPANTUNDProperty_DaemonVersion);
 	properties.insert(kWPANTUNDProperty_DaemonTerminateOnFault);
+	properties.insert(kWPANTUNDProperty_DaemonFrameCapture);
+	properties.insert(kWPANTUNDProperty_DaemonProfile);
+	properties.insert(kWPANTUNDProperty_DaemonWakeupsPerMinute);
 
 	properties.insert(kWPANTUNDProperty_NCPVersion);
 	properties.insert(kWPANTUNDProperty_NCPHardwareAddress);
@@ -386,6 +409,17 @@ NCPInstanceBase::property_get_value(
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonTerminateOnFault)) {
 		cb(0, boost::any(mTerminateOnFault));
 
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonFrameCapture)) {
+		cb(0, boost::any(mFrameCapture.get_path()));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonProfile)) {
+		std::list<std::string> result;
+		MainLoopProfiler::get_shared().convert_to_string_list(result);
+		cb(0, boost::any(result));
+
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonWakeupsPerMinute)) {
+		cb(0, boost::any(MainLoopProfiler::get_shared().get_wakeups_per_minute()));
+
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonIPv6AutoUpdateIntfaceAddrOnNCP)) {
 		cb(0, boost::any(mAutoUpdateInterfaceIPv6AddrsOnNCP));
 
@@ -627,6 +661,17 @@ NCPInstanceBase::property_set_value(
 				reinitialize_ncp();
 			}
 
+		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonFrameCapture)) {
+			// A capture can only be started from the configuration
+			// (`Config:Daemon:FrameCapture`): we never open a path
+			// supplied by a client. Clients may only stop it.
+			if (any_to_string(value).empty()) {
+				mFrameCapture.close();
+				cb(0);
+			} else {
+				cb(kWPANTUNDStatus_InvalidArgument);
+			}
+
 		} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_DaemonIPv6AutoUpdateIntfaceAddrOnNCP)) {
 			mAutoUpdateInterfaceIPv6AddrsOnNCP = any_to_bool(value);
 			cb(0);
@@ -31,6 +31,7 @@
 #include "NetworkRetain.h"
 #include "RunawayResetBackoffManager.h"
 #include "Pcap.h"
+#include "FrameCapture.h"
 
 namespace nl {
 namespace wpantund {
@@ -92,6 +93,8 @@ public:
 
 	virtual void hard_reset_ncp(void);
 
+	virtual bool can_hard_reset_ncp(void);
+
 	virtual int set_ncp_power(bool power);
 
 	virtual bool can_set_ncp_power(void);
@@ -567,6 +570,8 @@ protected:
 
 	PcapManager mPcapManager;
 
+	FrameCapture mFrameCapture;
+
 private:
 	// ========================================================================
 	// MARK: Private Data
@@ -56,6 +56,15 @@ using namespace wpantund;
 // Default log level for short auto logs (periodic logging)
 #define STAT_COLLECTOR_AUTO_LOG_DEFAULT_LOG_LEVEL LOG_INFO
 
+// Number of flows to show for "Stat:TopTalkers"
+#define STAT_COLLECTOR_TOP_TALKERS_COUNT          10
+
+// Time constant (in ms) of the moving average used for the rate of a flow
+#define STAT_COLLECTOR_FLOW_RATE_TIME_CONSTANT    10000
+
+// Bytes of IPv6 header added to the payload length of each packet of a flow
+#define STAT_COLLECTOR_FLOW_IPV6_HEADER_LEN       40
+
 // Default period (in min) for automatically logging stat info
 #define STAT_COLLECTOR_AUTO_LOG_PERIOD_IN_MIN     30     // 30 min
 
@@ -195,6 +204,20 @@ StatCollector::IPAddress::operator<(const IPAddress& lhs) const
 	return false;
 }
 
+uint32_t
+StatCollector::IPAddress::hash(uint32_t hash) const
+{
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(mAddressBuffer);
+
+	// FNV-1a
+	for (size_t indx = 0; indx < sizeof(mAddressBuffer); indx++) {
+		hash ^= bytes[indx];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
 //-------------------------------------------------------------------
 // EUI64Address
 
@@ -1074,6 +1097,364 @@ StatCollector::LinkStat::add_link_stat(StringList& output, int count) const
 	}
 }
 
+//-------------------------------------------------------------------
+// FlowStat::FlowKey
+
+void
+StatCollector::FlowStat::FlowKey::read_from(const PacketInfo& packet_info)
+{
+	mSrcAddress = packet_info.mSrcAddress;
+	mDstAddress = packet_info.mDstAddress;
+	mType = packet_info.mType;
+	mSrcPort = packet_info.mSrcPort;
+	mDstPort = packet_info.mDstPort;
+}
+
+uint32_t
+StatCollector::FlowStat::FlowKey::hash(void) const
+{
+	uint32_t hash = 2166136261U;
+	const uint8_t rest[5] = {
+		mType,
+		static_cast<uint8_t>(mSrcPort >> 8), static_cast<uint8_t>(mSrcPort),
+		static_cast<uint8_t>(mDstPort >> 8), static_cast<uint8_t>(mDstPort)
+	};
+
+	hash = mSrcAddress.hash(hash);
+	hash = mDstAddress.hash(hash);
+
+	for (size_t indx = 0; indx < sizeof(rest); indx++) {
+		hash ^= rest[indx];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+std::string
+StatCollector::FlowStat::FlowKey::to_string(void) const
+{
+	switch (mType) {
+	case IPV6_TYPE_TCP:
+	case IPV6_TYPE_UDP:
+		return string_printf(
+			"%s [%s]:%d -> [%s]:%d",
+			(mType == IPV6_TYPE_TCP) ? "TCP" : "UDP",
+			mSrcAddress.to_string().c_str(), mSrcPort,
+			mDstAddress.to_string().c_str(), mDstPort
+		);
+
+	case IPV6_TYPE_ICMP:
+		return string_printf(
+			"ICMP6 [%s] -> [%s]",
+			mSrcAddress.to_string().c_str(),
+			mDstAddress.to_string().c_str()
+		);
+
+	default:
+		return string_printf(
+			"0x%02x [%s] -> [%s]",
+			mType,
+			mSrcAddress.to_string().c_str(),
+			mDstAddress.to_string().c_str()
+		);
+	}
+}
+
+bool
+StatCollector::FlowStat::FlowKey::operator==(const FlowKey& lhs) const
+{
+	return (mSrcPort == lhs.mSrcPort)
+		&& (mDstPort == lhs.mDstPort)
+		&& (mType == lhs.mType)
+		&& (mDstAddress == lhs.mDstAddress)
+		&& (mSrcAddress == lhs.mSrcAddress);
+}
+
+//-------------------------------------------------------------------
+// FlowStat::FlowInfo
+
+void
+StatCollector::FlowStat::FlowInfo::clear(void)
+{
+	mHash = 0;
+	mBytes = 0;
+	mBytesError = 0;
+	mPackets = 0;
+	mRate = 0;
+	mFirstSeen.clear();
+	mLastSeen.clear();
+}
+
+void
+StatCollector::FlowStat::FlowInfo::add(uint16_t bytes)
+{
+	double elapsed = 0;
+
+	if (in_use()) {
+		elapsed = static_cast<double>(mLastSeen.get_ms_till_now());
+	} else {
+		mFirstSeen.set_to_now();
+	}
+
+	// Exponential moving average of the rate, approximated so that it
+	// needs no libm and still settles on the exact rate of a steady flow.
+	mRate = (mRate * STAT_COLLECTOR_FLOW_RATE_TIME_CONSTANT + bytes * 1000.0)
+	      / (STAT_COLLECTOR_FLOW_RATE_TIME_CONSTANT + elapsed);
+
+	mBytes += bytes;
+	mPackets++;
+	mLastSeen.set_to_now();
+}
+
+double
+StatCollector::FlowStat::FlowInfo::get_rate(void) const
+{
+	double elapsed;
+
+	if (!in_use()) {
+		return 0;
+	}
+
+	elapsed = static_cast<double>(mLastSeen.get_ms_till_now());
+
+	return mRate * STAT_COLLECTOR_FLOW_RATE_TIME_CONSTANT / (STAT_COLLECTOR_FLOW_RATE_TIME_CONSTANT + elapsed);
+}
+
+std::string
+StatCollector::FlowStat::FlowInfo::to_string(void) const
+{
+	std::string bytes_str;
+
+	// A flow which took over the entry of another one may have been
+	// credited with some of its traffic.
+	if (mBytesError != 0) {
+		bytes_str = string_printf("~%llu (+-%llu)",
+			static_cast<unsigned long long>(mBytes),
+			static_cast<unsigned long long>(mBytesError));
+	} else {
+		bytes_str = string_printf("%llu", static_cast<unsigned long long>(mBytes));
+	}
+
+	return string_printf(
+		"%s -- bytes:%s packets:%u rate:%.0f B/s first:%s last:%s",
+		mKey.to_string().c_str(),
+		bytes_str.c_str(),
+		mPackets,
+		get_rate(),
+		mFirstSeen.to_string().c_str(),
+		mLastSeen.to_string().c_str()
+	);
+}
+
+//-------------------------------------------------------------------
+// FlowStat
+
+StatCollector::FlowStat::FlowStat():
+	mEnabled(false)
+{
+	clear();
+}
+
+void
+StatCollector::FlowStat::clear(void)
+{
+	for (int indx = 0; indx < STAT_COLLECTOR_MAX_FLOWS; indx++) {
+		mFlowInfo[indx].clear();
+	}
+
+	memset(mSketch, 0, sizeof(mSketch));
+	mBytesTotal = 0;
+	mPacketsTotal = 0;
+	mReplaced = 0;
+}
+
+void
+StatCollector::FlowStat::set_enabled(bool enabled)
+{
+	if (mEnabled != enabled) {
+		mEnabled = enabled;
+		clear();
+	}
+}
+
+uint32_t
+StatCollector::FlowStat::update_sketch(uint32_t hash, uint16_t bytes)
+{
+	// Each row uses its own index, derived from the one hash by double hashing.
+	uint32_t index = hash & 0xFFFF;
+	uint32_t step = (hash >> 16) | 1;
+	uint32_t estimate = UINT32_MAX;
+
+	for (int row = 0; row < STAT_COLLECTOR_FLOW_SKETCH_DEPTH; row++) {
+		uint32_t& counter = mSketch[row][index % STAT_COLLECTOR_FLOW_SKETCH_WIDTH];
+
+		counter = (counter > UINT32_MAX - bytes) ? UINT32_MAX : counter + bytes;
+
+		if (counter < estimate) {
+			estimate = counter;
+		}
+
+		index += step;
+	}
+
+	return estimate;
+}
+
+StatCollector::FlowStat::FlowInfo *
+StatCollector::FlowStat::find_flow_info(const FlowKey& key, uint32_t hash)
+{
+	for (int indx = 0; indx < STAT_COLLECTOR_MAX_FLOWS; indx++) {
+		FlowInfo *flow_info_ptr = &mFlowInfo[indx];
+
+		if (flow_info_ptr->in_use() && (flow_info_ptr->mHash == hash) && (flow_info_ptr->mKey == key)) {
+			return flow_info_ptr;
+		}
+	}
+
+	return NULL;
+}
+
+StatCollector::FlowStat::FlowInfo *
+StatCollector::FlowStat::replace_smallest_flow_info(void)
+{
+	FlowInfo *smallest_ptr = &mFlowInfo[0];
+
+	for (int indx = 0; indx < STAT_COLLECTOR_MAX_FLOWS; indx++) {
+		if (!mFlowInfo[indx].in_use()) {
+			return &mFlowInfo[indx];
+		}
+
+		if (mFlowInfo[indx].mBytes < smallest_ptr->mBytes) {
+			smallest_ptr = &mFlowInfo[indx];
+		}
+	}
+
+	mReplaced++;
+
+	DEBUG_LOG("StatCollector: Flow %s replaced", smallest_ptr->mKey.to_string().c_str());
+
+	return smallest_ptr;
+}
+
+void
+StatCollector::FlowStat::update_from_packet(const PacketInfo& packet_info)
+{
+	uint16_t bytes = packet_info.mPayloadLen + STAT_COLLECTOR_FLOW_IPV6_HEADER_LEN;
+	FlowInfo *flow_info_ptr;
+	uint32_t estimate;
+	uint32_t hash;
+	FlowKey key;
+
+	key.read_from(packet_info);
+	hash = key.hash();
+
+	estimate = update_sketch(hash, bytes);
+
+	mBytesTotal += bytes;
+	mPacketsTotal++;
+
+	flow_info_ptr = find_flow_info(key, hash);
+
+	if (!flow_info_ptr) {
+		uint64_t min_bytes;
+
+		flow_info_ptr = replace_smallest_flow_info();
+		min_bytes = flow_info_ptr->mBytes;
+
+		flow_info_ptr->clear();
+		flow_info_ptr->mKey = key;
+		flow_info_ptr->mHash = hash;
+
+		// Space-saving: the new flow may have sent up to as much as the
+		// flow it replaces while untracked, but never more than the
+		// sketch has seen for it.
+		if (min_bytes > estimate - bytes) {
+			min_bytes = estimate - bytes;
+		}
+
+		flow_info_ptr->mBytes = min_bytes;
+		flow_info_ptr->mBytesError = min_bytes;
+	}
+
+	flow_info_ptr->add(bytes);
+}
+
+void
+StatCollector::FlowStat::get_sorted_flows(std::vector<const FlowInfo*>& flows, bool by_rate) const
+{
+	flows.clear();
+
+	for (int indx = 0; indx < STAT_COLLECTOR_MAX_FLOWS; indx++) {
+		if (mFlowInfo[indx].in_use()) {
+			flows.push_back(&mFlowInfo[indx]);
+		}
+	}
+
+	// Insertion sort, largest first. There are only a few flows.
+	for (size_t i = 1; i < flows.size(); i++) {
+		const FlowInfo *flow_info_ptr = flows[i];
+		double value = by_rate ? flow_info_ptr->get_rate() : static_cast<double>(flow_info_ptr->mBytes);
+		size_t j = i;
+
+		while (j > 0) {
+			double prev_value = by_rate ? flows[j - 1]->get_rate() : static_cast<double>(flows[j - 1]->mBytes);
+
+			if (prev_value >= value) {
+				break;
+			}
+
+			flows[j] = flows[j - 1];
+			j--;
+		}
+
+		flows[j] = flow_info_ptr;
+	}
+}
+
+void
+StatCollector::FlowStat::add_flow_stat(StringList& output) const
+{
+	std::vector<const FlowInfo*> flows;
+
+	if (!mEnabled) {
+		output.push_back("Flow statistics are disabled, set " kWPANTUNDProperty_StatFlowsEnabled " to enable them.");
+		return;
+	}
+
+	get_sorted_flows(flows, false);
+
+	output.push_back(string_printf("Flows: %d tracked (max %d), %d replaced -- %u packet%s, %llu bytes",
+		static_cast<int>(flows.size()), STAT_COLLECTOR_MAX_FLOWS, mReplaced,
+		mPacketsTotal, (mPacketsTotal == 1)? "" : "s",
+		static_cast<unsigned long long>(mBytesTotal)));
+
+	for (size_t indx = 0; indx < flows.size(); indx++) {
+		output.push_back(flows[indx]->to_string());
+	}
+}
+
+void
+StatCollector::FlowStat::add_top_talkers(StringList& output, int count) const
+{
+	std::vector<const FlowInfo*> flows;
+
+	if (!mEnabled) {
+		output.push_back("Flow statistics are disabled, set " kWPANTUNDProperty_StatFlowsEnabled " to enable them.");
+		return;
+	}
+
+	get_sorted_flows(flows, true);
+
+	if (flows.empty()) {
+		output.push_back("No flows seen yet.");
+	}
+
+	for (size_t indx = 0; (indx < flows.size()) && (indx < static_cast<size_t>(count)); indx++) {
+		output.push_back(flows[indx]->to_string());
+	}
+}
+
 //-------------------------------------------------------------------
 // StatCollector
 
@@ -1081,7 +1462,7 @@ StatCollector::StatCollector() :
 		mTxBytesTotal(), mRxBytesTotal(),
 		mRxHistory(), mTxHistory(),
 		mLastBlockingHostSleepTime(),
-		mNodeStat(), mLinkStat(),
+		mNodeStat(), mLinkStat(), mFlowStat(),
 		mAutoLogTimer(), mLinkStatTimer()
 {
 	mControlInterface = NULL;
@@ -1156,6 +1537,10 @@ StatCollector::record_inbound_packet(const uint8_t *packet)
 		mRxHistory.force_write(packet_info);
 
 		mNodeStat.update_from_inbound_packet(packet_info);
+
+		if (mFlowStat.is_enabled()) {
+			mFlowStat.update_from_packet(packet_info);
+		}
 	}
 }
 
@@ -1175,6 +1560,10 @@ StatCollector::record_outbound_packet(const uint8_t *packet)
 		mTxHistory.force_write(packet_info);
 
 		mNodeStat.update_from_outbound_packet(packet_info);
+
+		if (mFlowStat.is_enabled()) {
+			mFlowStat.update_from_packet(packet_info);
+		}
 	}
 }
 
@@ -1373,12 +1762,21 @@ StatCollector::add_help(StringList& output) const
 	output.push_back(string_printf("\t %-26s - List of nodes + RX/TX statistics and packet history for a specific node with given IP address", kWPANTUNDProperty_StatNodeHistoryID "[<ipv6>]"));
 	output.push_back(string_printf("\t %-26s - List of nodes + RX/TX statistics and packet history for a specific node with given index", kWPANTUNDProperty_StatNodeHistoryID "<index>"));
 	output.push_back(string_printf("\t %-26s - Peer link quality history - short version", kWPANTUNDProperty_StatLinkQualityShort));
+	output.push_back(string_printf("\t %-26s - Bytes/packets/rate of each tracked flow, largest first", kWPANTUNDProperty_StatFlows));
+	output.push_back(string_printf("\t %-26s - Flows with the highest current rate", kWPANTUNDProperty_StatTopTalkers));
 	output.push_back(string_printf("\t %-26s - Peer link quality history - long version", kWPANTUNDProperty_StatLinkQualityLong));
 	output.push_back(string_printf("\t %-26s - All info - short version", kWPANTUNDProperty_StatShort));
 	output.push_back(string_printf("\t %-26s - All info - long version", kWPANTUNDProperty_StatLong));
+	output.push_back(string_printf("\t %-26s - Latest sample of the NCP counters", kWPANTUNDProperty_StatCounters));
+	output.push_back(string_printf("\t %-26s - Per-second rate of each NCP counter between the last two samples", kWPANTUNDProperty_StatCountersRate));
+	output.push_back(string_printf("\t %-26s - Change of each NCP counter since this was last read", kWPANTUNDProperty_StatCountersDelta));
+	output.push_back(string_printf("\t %-26s - Min/max/average per-second rate of each NCP counter over the window", kWPANTUNDProperty_StatCountersMinMax));
 	output.push_back(string_printf("\t "));
 	output.push_back(string_printf("\t %-26s - Peer link quality information - get only", kWPANTUNDProperty_StatLinkQuality));
 	output.push_back(string_printf("\t %-26s - Period interval (in seconds) for collecting peer link quality - get/set - zero to disable", kWPANTUNDProperty_StatLinkQualityPeriod));
+	output.push_back(string_printf("\t %-26s - Period interval (in seconds) for sampling NCP counters - get/set - zero to disable", kWPANTUNDProperty_StatCountersPeriod));
+	output.push_back(string_printf("\t %-26s - Window (in seconds) used by %s - get/set", kWPANTUNDProperty_StatCountersWindow, kWPANTUNDProperty_StatCountersMinMax));
+	output.push_back(string_printf("\t %-26s - Per-flow statistics (\'true\',\'false\') - get/set - disabled by default", kWPANTUNDProperty_StatFlowsEnabled));
 	output.push_back(string_printf("\t %-26s - AutoLog information - get only", kWPANTUNDProperty_StatAutoLog));
 	output.push_back(string_printf("\t %-26s - AutoLog state (\'disabled\',\'long\',\'short\'') - get/set", kWPANTUNDProperty_StatAutoLogState));
 	output.push_back(string_printf("\t %-26s - AutoLog period in minutes - get/set", kWPANTUNDProperty_StatAutoLogPeriod));
@@ -1426,6 +1824,10 @@ StatCollector::get_stat_property(const std::string& key, StringList& output) con
 		mLinkStat.add_link_stat(output);
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatLinkQualityShort)) {
 		mLinkStat.add_link_stat(output, STAT_COLLECTOR_LINK_STAT_HISTORY_SIZE);
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatFlows)) {
+		mFlowStat.add_flow_stat(output);
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatTopTalkers)) {
+		mFlowStat.add_top_talkers(output, STAT_COLLECTOR_TOP_TALKERS_COUNT);
 	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatHelp)) {
 		add_help(output);
 	} else {
@@ -1496,6 +1898,9 @@ StatCollector::property_get_value(const std::string& key, CallbackWithStatusArg1
 		int period_in_sec = static_cast<int>(mLinkStatTimer.get_interval() / Timer::kOneSecond);
 		cb(kWPANTUNDStatus_Ok, boost::any(period_in_sec));
 
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatFlowsEnabled)) {
+		cb(kWPANTUNDStatus_Ok, boost::any(mFlowStat.is_enabled()));
+
 	} else {
 		// If not an AutoLog property, check for the stat properties.
 		StringList output;
@@ -1578,6 +1983,8 @@ StatCollector::property_set_value(const std::string& key, const boost::any& valu
 		} else {
 			status = kWPANTUNDStatus_InvalidArgument;
 		}
+	} else if (strcaseequal(key.c_str(), kWPANTUNDProperty_StatFlowsEnabled)) {
+		mFlowStat.set_enabled(any_to_bool(value));
 	} else {
 		StringList output;
 
@@ -1599,6 +2006,7 @@ StatCollector::update_auto_log_timer(void)
 	if (mAutoLogState == kAutoLogDisabled) {
 		mAutoLogTimer.cancel();
 	} else {
+		mAutoLogTimer.set_slack(mAutoLogPeriod / Timer::kDefaultSlackDivisor);
 		mAutoLogTimer.schedule(
 			mAutoLogPeriod,
 			boost::bind(&StatCollector::auto_log_timer_did_fire, this),
@@ -1643,6 +2051,7 @@ StatCollector::update_link_stat_timer(Timer::Interval interval)
 	if (interval == 0) {
 		mLinkStatTimer.cancel();
 	} else {
+		mLinkStatTimer.set_slack(interval / Timer::kDefaultSlackDivisor);
 		mLinkStatTimer.schedule(
 			interval,
 			boost::bind(&StatCollector::link_stat_timer_did_fire, this),
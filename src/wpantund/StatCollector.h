@@ -27,6 +27,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 #include "time-utils.h"
 #include "RingBuffer.h"
 #include "ObjectPool.h"
@@ -61,6 +62,14 @@ namespace wpantund {
 // History length of link quality info per peer
 #define STAT_COLLECTOR_LINK_QUALITY_HISTORY_SIZE 40
 
+// Max number of flows to track at the same time. Any flow carrying more
+// than 1/STAT_COLLECTOR_MAX_FLOWS of the traffic is guaranteed a place.
+#define STAT_COLLECTOR_MAX_FLOWS   32
+
+// Size of the count-min sketch which estimates the traffic of untracked flows
+#define STAT_COLLECTOR_FLOW_SKETCH_DEPTH  4
+#define STAT_COLLECTOR_FLOW_SKETCH_WIDTH  256
+
 class StatCollector
 {
 public:
@@ -91,6 +100,7 @@ private:
 		void read_from(const uint8_t *arr);
 		bool operator==(const IPAddress& lhs) const;
 		bool operator<(const IPAddress& lhs) const;
+		uint32_t hash(uint32_t hash) const;
 	private:
 		uint32_t mAddressBuffer[4];
 	};
@@ -261,6 +271,63 @@ private:
 		std::map<EUI64Address, LinkInfo *> mLinkInfoMap;
 	};
 
+	class FlowStat
+	{
+	public:
+		struct FlowKey
+		{
+			IPAddress mSrcAddress;
+			IPAddress mDstAddress;
+			uint8_t   mType;
+			uint16_t  mSrcPort;
+			uint16_t  mDstPort;
+
+			void read_from(const PacketInfo& packet_info);
+			uint32_t hash(void) const;
+			std::string to_string(void) const;
+			bool operator==(const FlowKey& lhs) const;
+		};
+
+		struct FlowInfo
+		{
+			FlowKey   mKey;
+			uint32_t  mHash;
+			uint64_t  mBytes;
+			uint64_t  mBytesError;    // mBytes may be over by up to this much
+			uint32_t  mPackets;
+			double    mRate;          // bytes/s, as of mLastSeen
+			TimeStamp mFirstSeen;
+			TimeStamp mLastSeen;
+
+			void clear(void);
+			bool in_use(void) const { return !mLastSeen.is_uninitialized(); }
+			void add(uint16_t bytes);
+			double get_rate(void) const;
+			std::string to_string(void) const;
+		};
+
+		FlowStat();
+		void clear(void);
+		void set_enabled(bool enabled);
+		bool is_enabled(void) const { return mEnabled; }
+		void update_from_packet(const PacketInfo& packet_info);
+		void add_flow_stat(StringList& output) const;
+		void add_top_talkers(StringList& output, int count) const;
+
+	private:
+		uint32_t update_sketch(uint32_t hash, uint16_t bytes);
+		FlowInfo *find_flow_info(const FlowKey& key, uint32_t hash);
+		FlowInfo *replace_smallest_flow_info(void);
+		void get_sorted_flows(std::vector<const FlowInfo*>& flows, bool by_rate) const;
+
+		bool mEnabled;
+		FlowInfo mFlowInfo[STAT_COLLECTOR_MAX_FLOWS];
+		uint32_t mSketch[STAT_COLLECTOR_FLOW_SKETCH_DEPTH][STAT_COLLECTOR_FLOW_SKETCH_WIDTH];
+		uint64_t mBytesTotal;
+		uint32_t mPacketsTotal;
+		uint32_t mReplaced;
+	};
+
 	enum AutoLogState
 	{
 		kAutoLogDisabled,
@@ -315,6 +382,7 @@ private:
 
 	NodeStat mNodeStat;
 	LinkStat mLinkStat;
+	FlowStat mFlowStat;
 
 	Timer mAutoLogTimer;
 	Timer mLinkStatTimer;
@@ -62,6 +62,7 @@ const char* wpantund_status_to_cstr(int status)
 	case kWPANTUNDStatus_TryAgainLater: return "TryAgainLater";
 	case kWPANTUNDStatus_InvalidRange: return "InvalidRange";
 	case kWPANTUNDStatus_InterfaceNotFound: return "InterfaceNotFound";
+	case kWPANTUNDStatus_PermissionDenied: return "PermissionDenied";
 	case kWPANTUNDStatus_NCP_Crashed: return "NCPCrashed";
 	case kWPANTUNDStatus_NCP_Fatal: return "NCPFatal";
 	case kWPANTUNDStatus_NCP_InvalidArgument: return "NCPInvalidArgument";
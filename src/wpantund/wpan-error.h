@@ -63,6 +63,8 @@ typedef enum {
 
 	kWPANTUNDStatus_InterfaceNotFound             = 28,
 
+	kWPANTUNDStatus_PermissionDenied              = 29,
+
 	kWPANTUNDStatus_NCPError_First                = 0xEA0000,
 	kWPANTUNDStatus_NCPError_Last                 = 0xEAFFFF,
 } wpantund_status_t;
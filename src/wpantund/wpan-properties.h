@@ -26,6 +26,12 @@
 
 #define kWPANTUNDProperty_ConfigNCPSocketPath                   "Config:NCP:SocketPath"
 #define kWPANTUNDProperty_ConfigNCPSocketBaud                   "Config:NCP:SocketBaud"
+#define kWPANTUNDProperty_ConfigNCPIID                          "Config:NCP:IID"
+#define kWPANTUNDProperty_ConfigNCPUpgradeBaud                  "Config:NCP:UpgradeBaud"
+#define kWPANTUNDProperty_ConfigNCPFlowControl                  "Config:NCP:FlowControl"
+#define kWPANTUNDProperty_ConfigNCPEgressScheduler              "Config:NCP:EgressScheduler"
+#define kWPANTUNDProperty_ConfigNCPEgressRules                  "Config:NCP:EgressRules"
+#define kWPANTUNDProperty_ConfigNCPHoldWhileAsleep              "Config:NCP:HoldWhileAsleep"
 #define kWPANTUNDProperty_ConfigNCPDriverName                   "Config:NCP:DriverName"
 #define kWPANTUNDProperty_ConfigNCPHardResetPath                "Config:NCP:HardResetPath"
 #define kWPANTUNDProperty_ConfigNCPPowerPath                    "Config:NCP:PowerPath"
@@ -37,6 +43,11 @@
 #define kWPANTUNDProperty_ConfigDaemonPrivDropToUser            "Config:Daemon:PrivDropToUser"
 #define kWPANTUNDProperty_ConfigDaemonChroot                    "Config:Daemon:Chroot"
 #define kWPANTUNDProperty_ConfigDaemonNetworkRetainCommand      "Config:Daemon:NetworkRetainCommand"
+#define kWPANTUNDProperty_ConfigDaemonDataPlaneThread           "Config:Daemon:DataPlaneThread"
+#define kWPANTUNDProperty_ConfigDaemonDataPlaneIOUring          "Config:Daemon:DataPlaneIOUring"
+#define kWPANTUNDProperty_ConfigDaemonIPCSocketPath             "Config:Daemon:IPCSocketPath"
+#define kWPANTUNDProperty_ConfigDaemonFrameCapture              "Config:Daemon:FrameCapture"
+#define kWPANTUNDProperty_ConfigTmfProxySocketPath              "Config:TmfProxy:SocketPath"
 
 #define kWPANTUNDProperty_DaemonVersion                         "Daemon:Version"
 #define kWPANTUNDProperty_DaemonEnabled                         "Daemon:Enabled"
@@ -53,6 +64,11 @@
 #define kWPANTUNDProperty_DaemonSetDefRouteForAutoAddedPrefix   "Daemon:SetDefaultRouteForAutoAddedPrefix"
 #define kWPANTUNDProperty_DaemonOffMeshRouteAutoAddOnInterface  "Daemon:OffMeshRoute:AutoAddOnInterface"
 #define kWPANTUNDProperty_DaemonOffMeshRouteFilterSelfAutoAdded "Daemon:OffMeshRoute:FilterSelfAutoAdded"
+#define kWPANTUNDProperty_DaemonFrameLogging                    "Daemon:FrameLogging"
+#define kWPANTUNDProperty_DaemonFrameCapture                    "Daemon:FrameCapture"
+#define kWPANTUNDProperty_DaemonProfile                         "Daemon:Profile"
+#define kWPANTUNDProperty_DaemonWakeupsPerMinute                "Daemon:WakeupsPerMinute"
+#define kWPANTUNDProperty_DaemonDataPlane                       "Daemon:DataPlane"
 
 #define kWPANTUNDProperty_NCPVersion                            "NCP:Version"
 #define kWPANTUNDProperty_NCPState                              "NCP:State"
@@ -69,6 +85,10 @@
 #define kWPANTUNDProperty_NCPRSSI                               "NCP:RSSI"
 #define kWPANTUNDProperty_NCPCCAFailureRate                     "NCP:CCAFailureRate"
 #define kWPANTUNDProperty_NCPMCUPowerState                      "NCP:MCUPowerState"
+#define kWPANTUNDProperty_NCPFrameTrace                         "NCP:FrameTrace"
+#define kWPANTUNDProperty_NCPLinkCounters                       "NCP:LinkCounters"
+#define kWPANTUNDProperty_NCPFlowControl                        "NCP:FlowControl"
+#define kWPANTUNDProperty_NCPEgressScheduler                    "NCP:EgressScheduler"
 
 #define kWPANTUNDProperty_InterfaceUp                           "Interface:Up"
 
@@ -117,6 +137,7 @@
 #define kWPANTUNDProperty_ThreadStableNetworkDataVersion        "Thread:StableNetworkDataVersion"
 #define kWPANTUNDProperty_ThreadPreferredRouterID               "Thread:PreferredRouterID"
 #define kWPANTUNDProperty_ThreadCommissionerEnabled             "Thread:Commissioner:Enabled"
+#define kWPANTUNDProperty_ThreadCommissionerJoinerBulkProgress  "Thread:Commissioner:JoinerBulkProgress"
 #define kWPANTUNDProperty_ThreadDeviceMode                      "Thread:DeviceMode"
 #define kWPANTUNDProperty_ThreadOffMeshRoutes                   "Thread:OffMeshRoutes"
 #define kWPANTUNDProperty_ThreadOnMeshPrefixes                  "Thread:OnMeshPrefixes"
@@ -130,6 +151,8 @@
 #define kWPANTUNDProperty_ThreadPendingDatasetAsValMap          "Thread:PendingDataset:AsValMap"
 #define kWPANTUNDProperty_ThreadAddressCacheTable               "Thread:AddressCacheTable"
 #define kWPANTUNDProperty_ThreadAddressCacheTableAsValMap       "Thread:AddressCacheTable:AsValMap"
+#define kWPANTUNDProperty_ThreadTopologyCachePeriod             "Thread:TopologyCache:Period"
+#define kWPANTUNDProperty_ThreadTopologyChanges                 "Thread:TopologyChanges"
 
 #define kWPANTUNDProperty_DatasetActiveTimestamp                "Dataset:ActiveTimestamp"
 #define kWPANTUNDProperty_DatasetPendingTimestamp               "Dataset:PendingTimestamp"
@@ -204,6 +227,7 @@
 
 #define kWPANTUNDProperty_TmfProxyEnabled                       "TmfProxy:Enabled"
 #define kWPANTUNDProperty_TmfProxyStream                        "TmfProxy:Stream"
+#define kWPANTUNDProperty_TmfProxyCounters                      "TmfProxy:Counters"
 
 #define kWPANTUNDProperty_NestLabs_NetworkAllowingJoin          "com.nestlabs.internal:Network:AllowingJoin"
 #define kWPANTUNDProperty_NestLabs_NetworkPassthruPort          "com.nestlabs.internal:Network:PassthruPort"
@@ -246,6 +270,19 @@
 #define kWPANTUNDProperty_StatLinkQualityShort                  "Stat:LinkQuality:Short"
 #define kWPANTUNDProperty_StatLinkQualityPeriod                 "Stat:LinkQuality:Period"
 #define kWPANTUNDProperty_StatHelp                              "Stat:Help"
+#define kWPANTUNDProperty_StatFlows                             "Stat:Flows"
+#define kWPANTUNDProperty_StatFlowsEnabled                      "Stat:Flows:Enabled"
+#define kWPANTUNDProperty_StatTopTalkers                        "Stat:TopTalkers"
+#define kWPANTUNDProperty_StatCounters                          "Stat:Counters"
+#define kWPANTUNDProperty_StatCountersAsValMap                  "Stat:Counters:AsValMap"
+#define kWPANTUNDProperty_StatCountersRate                      "Stat:Counters:Rate"
+#define kWPANTUNDProperty_StatCountersRateAsValMap              "Stat:Counters:Rate:AsValMap"
+#define kWPANTUNDProperty_StatCountersDelta                     "Stat:Counters:Delta"
+#define kWPANTUNDProperty_StatCountersDeltaAsValMap             "Stat:Counters:Delta:AsValMap"
+#define kWPANTUNDProperty_StatCountersMinMax                    "Stat:Counters:MinMax"
+#define kWPANTUNDProperty_StatCountersMinMaxAsValMap            "Stat:Counters:MinMax:AsValMap"
+#define kWPANTUNDProperty_StatCountersPeriod                    "Stat:Counters:Period"
+#define kWPANTUNDProperty_StatCountersWindow                    "Stat:Counters:Window"
 
 // ----------------------------------------------------------------------------
 
@@ -328,6 +365,13 @@
 #define kWPANTUNDValueMapKey_Scan_EnableFiltering               "Scan:EnableFiltering"
 #define kWPANTUNDValueMapKey_Scan_PANIDFilter                   "Scan:PANID"
 
+// Setting any of these turns the scan into a streaming scan which stops
+// at the first beacon that satisfies all of them.
+#define kWPANTUNDValueMapKey_Scan_MatchNetworkName              "Scan:Match:NetworkName"
+#define kWPANTUNDValueMapKey_Scan_MatchXPANID                   "Scan:Match:XPANID"
+#define kWPANTUNDValueMapKey_Scan_MatchPANID                    "Scan:Match:PANID"
+#define kWPANTUNDValueMapKey_Scan_MatchMinRSSI                  "Scan:Match:MinRSSI"
+
 #define kWPANTUNDValueMapKey_Counter_TxTotal                    "TxTotal"              // Number of transmissions
 #define kWPANTUNDValueMapKey_Counter_TxUnicast                  "TxUnicast"            // Number of unicast transmissions
 #define kWPANTUNDValueMapKey_Counter_TxBroadcast                "TxBroadcast"          // Number of broadcast transmissions
@@ -360,6 +404,23 @@
 #define kWPANTUNDValueMapKey_Counter_RxErrSec                   "RxErrSec"             // Number of received packets with security error
 #define kWPANTUNDValueMapKey_Counter_RxErrFcs                   "RxErrFcs"             // Number of received packets with FCS error
 #define kWPANTUNDValueMapKey_Counter_RxErrOther                 "RxErrOther"           // Number of received packets with other error
+#define kWPANTUNDValueMapKey_Counter_TxIpSecTotal               "TxIpSecTotal"         // Number of secure IPv6 packets sent
+#define kWPANTUNDValueMapKey_Counter_TxIpInsecTotal             "TxIpInsecTotal"       // Number of insecure IPv6 packets sent
+#define kWPANTUNDValueMapKey_Counter_TxIpDropped                "TxIpDropped"          // Number of outbound IPv6 packets dropped
+#define kWPANTUNDValueMapKey_Counter_RxIpSecTotal               "RxIpSecTotal"         // Number of secure IPv6 packets received
+#define kWPANTUNDValueMapKey_Counter_RxIpInsecTotal             "RxIpInsecTotal"       // Number of insecure IPv6 packets received
+#define kWPANTUNDValueMapKey_Counter_RxIpDropped                "RxIpDropped"          // Number of inbound IPv6 packets dropped
+#define kWPANTUNDValueMapKey_Counter_TxSpinelTotal              "TxSpinelTotal"        // Number of Spinel frames sent by the NCP
+#define kWPANTUNDValueMapKey_Counter_RxSpinelTotal              "RxSpinelTotal"        // Number of Spinel frames received by the NCP
+#define kWPANTUNDValueMapKey_Counter_RxSpinelErr                "RxSpinelErr"          // Number of Spinel frames received by the NCP with errors
+#define kWPANTUNDValueMapKey_Counter_IpTxSuccess                "IpTxSuccess"          // Number of IPv6 packets successfully transmitted
+#define kWPANTUNDValueMapKey_Counter_IpRxSuccess                "IpRxSuccess"          // Number of IPv6 packets successfully received
+#define kWPANTUNDValueMapKey_Counter_IpTxFailure                "IpTxFailure"          // Number of IPv6 packets that failed to transmit
+#define kWPANTUNDValueMapKey_Counter_IpRxFailure                "IpRxFailure"          // Number of IPv6 packets that failed to be received
+
+#define kWPANTUNDValueMapKey_CounterRate_Min                    "Min"                  // Lowest per-second rate seen in the window
+#define kWPANTUNDValueMapKey_CounterRate_Max                    "Max"                  // Highest per-second rate seen in the window
+#define kWPANTUNDValueMapKey_CounterRate_Avg                    "Avg"                  // Average per-second rate over the window
 
 #define kWPANTUNDValueMapKey_TimeSync_Time                      "ThreadNetworkTime"
 #define kWPANTUNDValueMapKey_TimeSync_Status                    "TimeSyncStatus"
@@ -0,0 +1,605 @@
+/*
+ *
+ * Copyright (c) 2017 Nest Labs, Inc.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ *    Description:
+ *		This file implements `wpantund-replay`, which feeds a frame capture
+ *		(see `Config:Daemon:FrameCapture`) into a real NCP instance in place
+ *		of the NCP, checks that the driver sends the same frames to the NCP
+ *		as it did when the capture was taken, and reports how long the
+ *		main loop spent processing each frame.
+ *
+ *		Like the fuzzer, it runs the NCP instance in-process over one end of
+ *		a socket pair. Packets that were read from the network interface are
+ *		injected into the interface through a packet socket, which needs
+ *		`CAP_NET_RAW` (creating the interface needs `CAP_NET_ADMIN` anyway).
+ *
+ *		Commands that IPC clients made the driver send while the capture
+ *		was taken are not part of the capture; they show up as missing.
+ *
+ */
+
+#define main __XX_main
+#include "wpantund.cpp"
+#undef main
+
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <time.h>
+#include <vector>
+#include <deque>
+#include "FrameCapture.h"
+
+#if __linux__
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#endif
+
+#define HDLC_BYTE_FLAG             0x7E
+#define HDLC_BYTE_ESC              0x7D
+#define HDLC_BYTE_XON              0x11
+#define HDLC_BYTE_XOFF             0x13
+#define HDLC_BYTE_SPECIAL          0xF8
+#define HDLC_ESCAPE_XFORM          0x20
+
+#define REPLAY_DEFAULT_INTERFACE   "wpanreplay"
+#define REPLAY_DEFAULT_TIMEOUT_MS  1000
+#define REPLAY_MAX_PRINTED_ERRORS  10
+
+static arg_list_item_t replay_option_list[] = {
+	{ 'h', "help",   NULL, "Print Help"},
+	{ 'd', "debug",  NULL, "Enable debug logging"},
+	{ 'm', "max-speed", NULL, "Don't wait for the recorded time before each frame"},
+	{ 't', "timeout", "<ms>", "Extra time to wait for each expected frame (default 1000)"},
+	{ 'I', "interface", "<iface>", "Network interface name (default " REPLAY_DEFAULT_INTERFACE ")"},
+	{ 'o', "option", "<option-string>", "Config option"},
+	{ 0 }
+};
+
+static int sReplayFD = -1;             // Our end of the socket pair
+static int sReplayDaemonFD = -1;       // The end that wpantund reads from
+static int sReplayPacketFD = -1;
+static unsigned int sReplayIfIndex;
+
+static std::deque<std::vector<uint8_t> > sReplayReceivedFrames;
+static std::vector<uint8_t> sReplayDecodeBuffer;
+static bool sReplayDecodeEscaped;
+
+static uint64_t sReplayProcessTime;
+static nl::Timer sReplayWakeTimer;
+
+// Maps the transaction IDs of the capture to the ones the driver is
+// actually using, so that responses still reach the right command when
+// the two have drifted apart (for example because an IPC client sent a
+// command while the capture was taken).
+static uint8_t sReplayTIDMap[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+static uint64_t
+replay_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint16_t
+replay_hdlc_crc16(uint16_t fcs, uint8_t byte)
+{
+	int i;
+
+	fcs ^= byte;
+
+	for (i = 0; i < 8; i++) {
+		fcs = (fcs & 1) ? ((fcs >> 1) ^ 0x8408) : (fcs >> 1);
+	}
+
+	return fcs;
+}
+
+static void
+replay_hdlc_append(std::vector<uint8_t>& out, uint8_t byte)
+{
+	if ((byte == HDLC_BYTE_FLAG)
+	 || (byte == HDLC_BYTE_ESC)
+	 || (byte == HDLC_BYTE_XON)
+	 || (byte == HDLC_BYTE_XOFF)
+	 || (byte == HDLC_BYTE_SPECIAL)
+	) {
+		out.push_back(HDLC_BYTE_ESC);
+		byte ^= HDLC_ESCAPE_XFORM;
+	}
+
+	out.push_back(byte);
+}
+
+static void
+replay_hdlc_encode(const std::vector<uint8_t>& frame, std::vector<uint8_t>& out)
+{
+	uint16_t fcs = 0xFFFF;
+	size_t i;
+
+	out.clear();
+	out.push_back(HDLC_BYTE_FLAG);
+
+	for (i = 0; i < frame.size(); i++) {
+		fcs = replay_hdlc_crc16(fcs, frame[i]);
+		replay_hdlc_append(out, frame[i]);
+	}
+
+	fcs ^= 0xFFFF;
+	replay_hdlc_append(out, fcs & 0xFF);
+	replay_hdlc_append(out, (fcs >> 8) & 0xFF);
+
+	out.push_back(HDLC_BYTE_FLAG);
+}
+
+static void
+replay_hdlc_decode(uint8_t byte)
+{
+	if (byte == HDLC_BYTE_FLAG) {
+		if (sReplayDecodeBuffer.size() > 2) {
+			uint16_t fcs = 0xFFFF;
+			size_t i;
+
+			for (i = 0; i < sReplayDecodeBuffer.size(); i++) {
+				fcs = replay_hdlc_crc16(fcs, sReplayDecodeBuffer[i]);
+			}
+
+			if (fcs == 0xF0B8) {
+				sReplayDecodeBuffer.resize(sReplayDecodeBuffer.size() - 2);
+				sReplayReceivedFrames.push_back(sReplayDecodeBuffer);
+			} else {
+				syslog(LOG_WARNING, "Dropping outbound frame with bad CRC");
+			}
+		}
+		sReplayDecodeBuffer.clear();
+		sReplayDecodeEscaped = false;
+
+	} else if (byte == HDLC_BYTE_ESC) {
+		sReplayDecodeEscaped = true;
+
+	} else {
+		if (sReplayDecodeEscaped) {
+			byte ^= HDLC_ESCAPE_XFORM;
+			sReplayDecodeEscaped = false;
+		}
+		sReplayDecodeBuffer.push_back(byte);
+	}
+}
+
+static void
+replay_read_output(void)
+{
+	uint8_t buffer[512];
+	ssize_t len;
+
+	while ((len = read(sReplayFD, buffer, sizeof(buffer))) > 0) {
+		ssize_t i;
+
+		for (i = 0; i < len; i++) {
+			replay_hdlc_decode(buffer[i]);
+		}
+	}
+}
+
+static void
+replay_wake(nl::Timer*)
+{
+}
+
+// Runs one iteration of the main loop, not waiting past `deadline_us`.
+static void
+replay_step(MainLoop& main_loop, uint64_t deadline_us)
+{
+	uint64_t now = replay_time_us();
+	uint64_t start;
+
+	if (deadline_us > now) {
+		sReplayWakeTimer.schedule((nl::Timer::Interval)((deadline_us - now + 999) / 1000), &replay_wake);
+		main_loop.block_until_ready();
+	}
+
+	start = replay_time_us();
+	main_loop.process();
+	sReplayProcessTime += replay_time_us() - start;
+
+	replay_read_output();
+}
+
+static int
+replay_pending_input(void)
+{
+	int pending = 0;
+
+	if (ioctl(sReplayDaemonFD, FIONREAD, &pending) < 0) {
+		pending = 0;
+	}
+
+	return pending;
+}
+
+static bool
+replay_inject_packet(const std::vector<uint8_t>& packet)
+{
+#if __linux__
+	struct sockaddr_ll addr;
+
+	if (sReplayPacketFD < 0) {
+		return false;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll_family = AF_PACKET;
+	addr.sll_protocol = htons(ETH_P_IPV6);
+	addr.sll_ifindex = sReplayIfIndex;
+
+	return sendto(sReplayPacketFD, &packet[0], packet.size(), 0, (struct sockaddr*)&addr, sizeof(addr)) == (ssize_t)packet.size();
+#else
+	return false;
+#endif
+}
+
+// Compares two Spinel frames, ignoring their transaction IDs.
+static bool
+replay_frames_match(const std::vector<uint8_t>& lhs, const std::vector<uint8_t>& rhs)
+{
+	return (lhs.size() == rhs.size())
+		&& !lhs.empty()
+		&& ((lhs[0] & 0xF0) == (rhs[0] & 0xF0))
+		&& std::equal(lhs.begin() + 1, lhs.end(), rhs.begin() + 1);
+}
+
+static std::string
+replay_frame_to_string(const std::vector<uint8_t>& frame)
+{
+	char buffer[200];
+
+	if (frame.empty()) {
+		return std::string("(none)");
+	}
+
+	encode_data_into_string(&frame[0], frame.size(), buffer, sizeof(buffer), 0);
+
+	return std::string(buffer);
+}
+
+int
+main(int argc, char * argv[])
+{
+	std::map<std::string, std::string> settings;
+	FrameCaptureReader reader;
+	FrameCaptureRecord record;
+	MainLoop* main_loop = NULL;
+	std::vector<uint8_t> encoded;
+	std::vector<uint32_t> process_times;
+	bool max_speed = false;
+	uint64_t timeout_us = REPLAY_DEFAULT_TIMEOUT_MS * 1000;
+	uint64_t start_us = 0;
+	uint64_t last_record_us = 0;
+	uint64_t input_start = 0;
+	bool have_input = false;
+	int fd[2] = { -1, -1 };
+	int ret = ERRORCODE_UNKNOWN;
+	int c;
+
+	unsigned int frames_from_ncp = 0;
+	unsigned int packets_from_host = 0;
+	unsigned int packets_skipped = 0;
+	unsigned int packets_to_host = 0;
+	unsigned int matched = 0;
+	unsigned int mismatched = 0;
+	unsigned int missing = 0;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	openlog(basename(argv[0]), LOG_PERROR, LOG_USER);
+	setlogmask(LOG_UPTO(LOG_WARNING));
+
+	settings[kWPANTUNDProperty_ConfigTUNInterfaceName] = REPLAY_DEFAULT_INTERFACE;
+
+	optind = 0;
+	while(1) {
+		static struct option long_options[] =
+		{
+			{"help",	no_argument,		0,	'h'},
+			{"debug",	no_argument,		0,	'd'},
+			{"max-speed",	no_argument,		0,	'm'},
+			{"timeout",	required_argument,	0,	't'},
+			{"interface",	required_argument,	0,	'I'},
+			{"option",	required_argument,	0,	'o'},
+			{0,		0,			0,	0}
+		};
+
+		int option_index = 0;
+		c = getopt_long(argc, argv, "hdmt:I:o:", long_options, &option_index);
+
+		if (c == -1)
+			break;
+
+		switch(c) {
+		case 'h':
+			print_arg_list_help(replay_option_list, argv[0], "[options] <capture-file>");
+			ret = ERRORCODE_HELP;
+			goto bail;
+
+		case 'd':
+			setlogmask(~0);
+			break;
+
+		case 'm':
+			max_speed = true;
+			break;
+
+		case 't':
+			timeout_us = (uint64_t)strtoul(optarg, NULL, 0) * 1000;
+			break;
+
+		case 'I':
+			settings[kWPANTUNDProperty_ConfigTUNInterfaceName] = optarg;
+			break;
+
+		case 'o':
+			if ((optind >= argc) || (strhasprefix(argv[optind], "-"))) {
+				syslog(LOG_ERR, "Missing argument to '-o'.");
+				ret = ERRORCODE_BADARG;
+				goto bail;
+			}
+			settings[optarg] = argv[optind++];
+			break;
+
+		default:
+			ret = ERRORCODE_BADARG;
+			goto bail;
+		}
+	}
+
+	if (optind + 1 != argc) {
+		print_arg_list_help(replay_option_list, argv[0], "[options] <capture-file>");
+		ret = ERRORCODE_BADARG;
+		goto bail;
+	}
+
+	if (reader.open(argv[optind]) != 0) {
+		fprintf(stderr, "%s: error: Unable to read capture \"%s\"\n", argv[0], argv[optind]);
+		ret = ERRORCODE_BADARG;
+		goto bail;
+	}
+
+	if (socketpair(PF_UNIX, SOCK_STREAM, 0, fd) < 0) {
+		syslog(LOG_ERR, "Call to socketpair() failed: %s (%d)", strerror(errno), errno);
+		ret = ERRORCODE_ERRNO;
+		goto bail;
+	}
+
+	sReplayFD = fd[0];
+	sReplayDaemonFD = fd[1];
+	fcntl(sReplayFD, F_SETFL, fcntl(sReplayFD, F_GETFL) | O_NONBLOCK);
+
+	{
+		char fd_string[32];
+
+		snprintf(fd_string, sizeof(fd_string), "fd:%d", fd[1]);
+		settings[kWPANTUNDProperty_ConfigNCPSocketPath] = fd_string;
+	}
+
+	gRet = 0;
+
+	try {
+		main_loop = new MainLoop(settings);
+	} catch (std::exception x) {
+		syslog(LOG_ERR, "Unable to start the NCP instance: %s", x.what());
+		ret = ERRORCODE_ERRNO;
+		goto bail;
+	}
+
+#if !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+	// The D-Bus server asks for a few properties whenever the state
+	// changes, so it needs to be there for the same frames to be sent.
+	try {
+		main_loop->add_ipc_server(shared_ptr<nl::wpantund::IPCServer>(new DBUSIPCServer()));
+	} catch(std::exception x) {
+		syslog(LOG_WARNING, "Unable to start DBUSIPCServer, replay may diverge: \"%s\"", x.what());
+	}
+#endif
+
+#if __linux__
+	sReplayIfIndex = if_nametoindex(settings[kWPANTUNDProperty_ConfigTUNInterfaceName].c_str());
+	sReplayPacketFD = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_IPV6));
+
+	if (sReplayPacketFD < 0) {
+		syslog(LOG_WARNING, "Unable to open packet socket, packets from the host will be skipped: %s", strerror(errno));
+	}
+#endif
+
+	start_us = replay_time_us();
+
+	while ((gRet == 0) && (reader.read(record) > 0)) {
+		uint64_t record_us = start_us + record.mTimestamp;
+
+		if (max_speed) {
+			// Keep the gaps that the driver's own timers need to fire.
+			record_us = replay_time_us();
+		}
+
+		switch (record.mType) {
+		case FrameCapture::kFrameFromNCP:
+		case FrameCapture::kPacketFromHost:
+			while ((gRet == 0) && (replay_time_us() < record_us)) {
+				replay_step(*main_loop, record_us);
+			}
+
+			if (record.mType == FrameCapture::kFrameFromNCP) {
+				if (!record.mData.empty()) {
+					uint8_t tid = record.mData[0] & 0x0F;
+
+					record.mData[0] = (record.mData[0] & 0xF0) | sReplayTIDMap[tid];
+				}
+
+				replay_hdlc_encode(record.mData, encoded);
+
+				if (write(sReplayFD, &encoded[0], encoded.size()) != (ssize_t)encoded.size()) {
+					syslog(LOG_ERR, "Call to write() failed: %s (%d)", strerror(errno), errno);
+					ret = ERRORCODE_ERRNO;
+					goto bail;
+				}
+				frames_from_ncp++;
+
+			} else if (replay_inject_packet(record.mData)) {
+				packets_from_host++;
+
+			} else {
+				packets_skipped++;
+				break;
+			}
+
+			// Everything processed up to here is charged to the previous input.
+			if (have_input) {
+				process_times.push_back((uint32_t)(sReplayProcessTime - input_start));
+			}
+
+			have_input = true;
+			input_start = sReplayProcessTime;
+
+			// Let the driver take in the whole frame before moving on.
+			{
+				uint64_t deadline = replay_time_us() + timeout_us;
+
+				replay_step(*main_loop, 0);
+
+				while ((gRet == 0) && (replay_pending_input() > 0) && (replay_time_us() < deadline)) {
+					replay_step(*main_loop, deadline);
+				}
+			}
+			break;
+
+		case FrameCapture::kFrameToNCP:
+			{
+				uint64_t deadline = record_us + timeout_us;
+
+				if (!max_speed) {
+					deadline = std::max(deadline, replay_time_us() + timeout_us);
+				} else {
+					deadline += (record.mTimestamp - last_record_us);
+				}
+
+				while ((gRet == 0) && sReplayReceivedFrames.empty() && (replay_time_us() < deadline)) {
+					replay_step(*main_loop, deadline);
+				}
+
+				if (sReplayReceivedFrames.empty()) {
+					if (missing++ < REPLAY_MAX_PRINTED_ERRORS) {
+						fprintf(stderr, "Missing frame at %.3fs: %s\n",
+						        record.mTimestamp / 1000000.0,
+						        replay_frame_to_string(record.mData).c_str());
+					}
+
+				} else if (replay_frames_match(sReplayReceivedFrames.front(), record.mData)) {
+					sReplayTIDMap[record.mData[0] & 0x0F] = sReplayReceivedFrames.front()[0] & 0x0F;
+					sReplayReceivedFrames.pop_front();
+					matched++;
+
+				} else {
+					if (mismatched++ < REPLAY_MAX_PRINTED_ERRORS) {
+						fprintf(stderr, "Mismatched frame at %.3fs:\n  expected %s\n  got      %s\n",
+						        record.mTimestamp / 1000000.0,
+						        replay_frame_to_string(record.mData).c_str(),
+						        replay_frame_to_string(sReplayReceivedFrames.front()).c_str());
+					}
+					sReplayReceivedFrames.pop_front();
+				}
+			}
+			break;
+
+		case FrameCapture::kPacketToHost:
+			packets_to_host++;
+			break;
+
+		default:
+			break;
+		}
+
+		last_record_us = record.mTimestamp;
+	}
+
+	if (have_input) {
+		process_times.push_back((uint32_t)(sReplayProcessTime - input_start));
+	}
+
+	printf("Replayed %u frames from the NCP and %u packets from the host (%u skipped) in %.3fs\n",
+	       frames_from_ncp,
+	       packets_from_host,
+	       packets_skipped,
+	       (replay_time_us() - start_us) / 1000000.0);
+
+	printf("Frames to the NCP: %u matched, %u mismatched, %u missing, %u unexpected\n",
+	       matched,
+	       mismatched,
+	       missing,
+	       (unsigned int)sReplayReceivedFrames.size());
+
+	printf("Packets to the host: %u (not verified)\n", packets_to_host);
+
+	if (!process_times.empty()) {
+		uint64_t total = 0;
+		size_t count = process_times.size();
+		size_t i;
+
+		std::sort(process_times.begin(), process_times.end());
+
+		for (i = 0; i < count; i++) {
+			total += process_times[i];
+		}
+
+		printf("Processing time per input (us): mean %llu, p50 %u, p99 %u, max %u\n",
+		       (unsigned long long)(total / count),
+		       process_times[count / 2],
+		       process_times[(count * 99) / 100],
+		       process_times[count - 1]);
+	}
+
+	if (gRet != 0) {
+		fprintf(stderr, "%s: error: The NCP instance failed (%d)\n", argv[0], gRet);
+		ret = gRet;
+	} else if ((mismatched != 0) || (missing != 0)) {
+		ret = ERRORCODE_UNKNOWN;
+	} else {
+		ret = 0;
+	}
+
+bail:
+	sReplayWakeTimer.cancel();
+
+	delete main_loop;
+
+	if (sReplayPacketFD >= 0) {
+		close(sReplayPacketFD);
+	}
+
+	if (fd[0] >= 0) {
+		close(fd[0]);
+	}
+
+	if (fd[1] >= 0) {
+		close(fd[1]);
+	}
+
+	return ret;
+}
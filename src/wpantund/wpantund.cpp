@@ -51,10 +51,12 @@
 
 #if !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
 #include "DBUSIPCServer.h"
+#include "UnixIPCServer.h"
 #endif
 
 #include "NCPControlInterface.h"
 #include "NCPInstance.h"
+#include "MainLoopProfiler.h"
 
 #include "nlpt.h"
 
@@ -79,6 +81,7 @@
 #include <exception>
 #include <algorithm>
 #include <memory>
+#include <set>
 
 #include "any-to.h"
 #include "sec-random.h"
@@ -154,10 +157,12 @@ static arg_list_item_t option_list[] = {
 };
 
 static int gRet;
+static volatile sig_atomic_t gProfileDumpRequested;
 
 static const char* gProcessName = "wpantund";
 static const char* gPIDFilename = NULL;
 static const char* gChroot = WPANTUND_DEFAULT_CHROOT_PATH;
+static const char* gIPCSocketPath = NULL;
 
 #if HAVE_PWD_H
 static const char* gPrivDropToUser = WPANTUND_DEFAULT_PRIV_DROP_USER;
@@ -219,6 +224,14 @@ signal_SIGHUP(int sig)
 	// loop decide what to do for hangups.
 }
 
+static void
+signal_SIGUSR1(int sig)
+{
+	// The main loop dumps the profile, since
+	// syslog() isn't async signal safe.
+	gProfileDumpRequested = 1;
+}
+
 static void
 signal_critical(int sig, siginfo_t * info, void * ucontext)
 {
@@ -342,6 +355,13 @@ set_config_param(
 			gChroot = strdup(value);
 		}
 		ret = 0;
+	} else if (strcaseequal(key, kWPANTUNDProperty_ConfigDaemonIPCSocketPath)) {
+		if (value[0] == 0) {
+			gIPCSocketPath = NULL;
+		} else {
+			gIPCSocketPath = strdup(value);
+		}
+		ret = 0;
 	} else if (strcaseequal(key, kWPANTUNDProperty_ConfigDaemonPIDFile)) {
 		if (gPIDFilename)
 			goto bail;
@@ -376,6 +396,43 @@ add_to_map(
 	return 0;
 }
 
+// Settings which apply to the whole process rather than to a single
+// NCP instance, and so can't appear in a `[name]` section.
+static bool
+is_process_wide_config_param(const char* key)
+{
+	return strcaseequal(key, kWPANTUNDProperty_ConfigNCPSocketBaud)
+		|| strcaseequal(key, kWPANTUNDProperty_ConfigDaemonPrivDropToUser)
+		|| strcaseequal(key, kWPANTUNDProperty_DaemonSyslogMask)
+		|| strcaseequal(key, kWPANTUNDProperty_ConfigDaemonChroot)
+		|| strcaseequal(key, kWPANTUNDProperty_ConfigDaemonIPCSocketPath)
+		|| strcaseequal(key, kWPANTUNDProperty_ConfigDaemonPIDFile);
+}
+
+static std::map<std::string, std::string>
+translate_deprecated_settings(const std::map<std::string, std::string>& settings)
+{
+	std::map<std::string, std::string> ret;
+	std::map<std::string, std::string>::const_iterator iter;
+
+	for (iter = settings.begin(); iter != settings.end(); iter++) {
+		std::string key(iter->first);
+		boost::any value(iter->second);
+		if (NCPControlInterface::translate_deprecated_property(key, value)) {
+			if (key.empty()) {
+				syslog(LOG_WARNING, "Configuration property \"%s\" is no longer supported. Please remove it from your configuration.", iter->first.c_str());
+			} else {
+				syslog(LOG_WARNING, "CONFIGURATION PROPERTY \"%s\" IS DEPRECATED. Please use \"%s\" instead.", iter->first.c_str(), key.c_str());
+			}
+		}
+		if (!key.empty()) {
+			ret[key] = any_to_string(value);
+		}
+	}
+
+	return ret;
+}
+
 static void
 handle_error(int err)
 {
@@ -503,83 +560,153 @@ syslog_dump_select_info(int loglevel, fd_set *read_fd_set, fd_set *write_fd_set,
 class MainLoop
 {
 	std::list<shared_ptr<nl::wpantund::IPCServer> > mIpcServerList;
-	std::map<std::string, std::string> mSettings;
-	nl::wpantund::NCPInstance * mNcpInstance;
+	std::list<nl::wpantund::NCPInstance*> mNcpInstances;
+
+	// Instances which haven't been exposed via IPC yet.
+	std::list<nl::wpantund::NCPInstance*> mPendingInterfaces;
 
 	int mFdsReady;
-	bool mInterfaceAdded;
 	int mZeroCmsInARowCount;
+
+	// Profiler source and stage indexes, in the order of `mIpcServerList`.
+	std::vector<int> mIpcServerSources;
+	std::vector<int> mIpcServerStages;
 public:
-	MainLoop(const std::map<std::string, std::string>& settings = std::map<std::string, std::string>()):
-		mSettings(settings), mNcpInstance(NCPInstance::alloc(settings)),
-		mFdsReady(0), mInterfaceAdded(false), mZeroCmsInARowCount(0)
+	MainLoop(void):
+		mFdsReady(0), mZeroCmsInARowCount(0)
+	{
+	}
+
+	MainLoop(const std::map<std::string, std::string>& settings):
+		mFdsReady(0), mZeroCmsInARowCount(0)
 	{
-		if (mNcpInstance == NULL) {
+		add_ncp_instance(settings);
+	}
+
+	~MainLoop() {
+		std::list<nl::wpantund::NCPInstance*>::iterator iter;
+
+		for (iter = mNcpInstances.begin(); iter != mNcpInstances.end(); ++iter) {
+			delete *iter;
+		}
+	}
+
+	void add_ncp_instance(const std::map<std::string, std::string>& settings) {
+		nl::wpantund::NCPInstance* ncp_instance = NCPInstance::alloc(settings);
+
+		if (ncp_instance == NULL) {
 			throw std::invalid_argument("Unknown NCP Driver");
 		}
 
-		mNcpInstance->mOnFatalError.connect(&handle_error);
+		ncp_instance->mOnFatalError.connect(&handle_error);
 
-		mNcpInstance->get_stat_collector().set_ncp_control_interface(&mNcpInstance->get_control_interface());
-	}
+		ncp_instance->get_stat_collector().set_ncp_control_interface(&ncp_instance->get_control_interface());
 
-	~MainLoop() {
-		delete mNcpInstance;
+		mNcpInstances.push_back(ncp_instance);
+		mPendingInterfaces.push_back(ncp_instance);
 	}
 
 	void add_ipc_server(shared_ptr<nl::wpantund::IPCServer> ipc_server) {
+		MainLoopProfiler& profiler(MainLoopProfiler::get_shared());
+		char name[32];
+
+		snprintf(name, sizeof(name), "IPCServer:%d", (int)mIpcServerList.size());
+
 		mIpcServerList.push_back(ipc_server);
+		mIpcServerSources.push_back(profiler.add_source(name));
+		mIpcServerStages.push_back(profiler.add_stage(name));
 	}
 
 	void process() {
+		MainLoopProfiler& profiler(MainLoopProfiler::get_shared());
 		std::list<shared_ptr<nl::wpantund::IPCServer> >::iterator ipc_iter;
+		std::list<nl::wpantund::NCPInstance*>::iterator ncp_iter;
+		uint64_t start;
+		int i;
 
 		// Process callback timers.
+		start = time_us();
 		Timer::process();
+		profiler.record_stage(MainLoopProfiler::kStageTimer, start);
 
 		// Process any necessary IPC actions.
-		for (ipc_iter = mIpcServerList.begin(); ipc_iter != mIpcServerList.end(); ++ipc_iter) {
+		for (ipc_iter = mIpcServerList.begin(), i = 0; ipc_iter != mIpcServerList.end(); ++ipc_iter, i++) {
+			start = time_us();
 			(*ipc_iter)->process();
+			profiler.record_stage(mIpcServerStages[i], start);
 		}
 
-		// Process the NCP instance.
-		mNcpInstance->process();
+		// Process the NCP instances.
+		for (ncp_iter = mNcpInstances.begin(); ncp_iter != mNcpInstances.end(); ++ncp_iter) {
+			start = time_us();
+			(*ncp_iter)->process();
+			profiler.record_stage(MainLoopProfiler::kStageNCP, start);
+		}
 
-		// We only expose the interface via IPC after it is
+		start = time_us();
+
+		// We only expose an interface via IPC after it is
 		// successfully initialized for the first time.
-		if (!mInterfaceAdded) {
-			const boost::any value = mNcpInstance->get_control_interface().property_get_value(kWPANTUNDProperty_NCPState);
+		for (ncp_iter = mPendingInterfaces.begin(); ncp_iter != mPendingInterfaces.end();) {
+			const boost::any value = (*ncp_iter)->get_control_interface().property_get_value(kWPANTUNDProperty_NCPState);
 			if ((value.type() == boost::any(std::string()).type())
 			 && (boost::any_cast<std::string>(value) != kWPANTUNDStateUninitialized)
 			) {
 				for (ipc_iter = mIpcServerList.begin(); ipc_iter != mIpcServerList.end(); ++ipc_iter) {
-					(*ipc_iter)->add_interface(&mNcpInstance->get_control_interface());
+					(*ipc_iter)->add_interface(&(*ncp_iter)->get_control_interface());
 				}
-				mInterfaceAdded = true;
+				ncp_iter = mPendingInterfaces.erase(ncp_iter);
+			} else {
+				++ncp_iter;
 			}
 		}
+
+		profiler.record_stage(MainLoopProfiler::kStagePendingInterfaces, start);
 	}
 
 	bool block_until_ready() {
+		MainLoopProfiler& profiler(MainLoopProfiler::get_shared());
 		int fds_ready = 0;
 		const cms_t max_main_loop_timeout(CMS_DISTANT_FUTURE);
 		cms_t cms_timeout(max_main_loop_timeout);
+		cms_t component_timeout;
 		int max_fd(-1);
+		int min_source;
+		uint64_t start;
 		struct timeval timeout;
 		std::list<shared_ptr<nl::wpantund::IPCServer> >::iterator ipc_iter;
+		std::list<nl::wpantund::NCPInstance*>::iterator ncp_iter;
+		int i;
 
 		FD_ZERO(&gReadableFDs);
 		FD_ZERO(&gWritableFDs);
 		FD_ZERO(&gErrorableFDs);
 
-		// Update the FD masks and timeouts
-		mNcpInstance->update_fd_set(&gReadableFDs, &gWritableFDs, &gErrorableFDs, &max_fd, &cms_timeout);
-		Timer::update_timeout(&cms_timeout);
+		profiler.begin_iteration();
 
-		for (ipc_iter = mIpcServerList.begin(); ipc_iter != mIpcServerList.end(); ++ipc_iter) {
-			(*ipc_iter)->update_fd_set(&gReadableFDs, &gWritableFDs, &gErrorableFDs, &max_fd, &cms_timeout);
+		// Update the FD masks and timeouts. Each component reports its
+		// own timeout to the profiler, so we know who wakes us up.
+		for (ncp_iter = mNcpInstances.begin(); ncp_iter != mNcpInstances.end(); ++ncp_iter) {
+			component_timeout = max_main_loop_timeout;
+			(*ncp_iter)->update_fd_set(&gReadableFDs, &gWritableFDs, &gErrorableFDs, &max_fd, &component_timeout);
+			profiler.note_timeout(MainLoopProfiler::kSourceNCP, component_timeout);
+			cms_timeout = std::min(cms_timeout, component_timeout);
 		}
 
+		component_timeout = max_main_loop_timeout;
+		Timer::update_timeout(&component_timeout);
+		profiler.note_timeout(MainLoopProfiler::kSourceTimer, component_timeout);
+		cms_timeout = std::min(cms_timeout, component_timeout);
+
+		for (ipc_iter = mIpcServerList.begin(), i = 0; ipc_iter != mIpcServerList.end(); ++ipc_iter, i++) {
+			component_timeout = max_main_loop_timeout;
+			(*ipc_iter)->update_fd_set(&gReadableFDs, &gWritableFDs, &gErrorableFDs, &max_fd, &component_timeout);
+			profiler.note_timeout(mIpcServerSources[i], component_timeout);
+			cms_timeout = std::min(cms_timeout, component_timeout);
+		}
+
+		min_source = profiler.end_iteration(cms_timeout);
+
 		if (max_fd >= FD_SETSIZE) {
 			syslog(LOG_ERR, "BUG: Too many file descriptors: %d (max %d)", max_fd, FD_SETSIZE);
 			gRet = ERRORCODE_UNKNOWN;
@@ -602,15 +729,16 @@ public:
 
 			switch (++mZeroCmsInARowCount) {
 			case 20:
-				syslog(LOG_INFO, "BUG: Main loop is thrashing! (%f %f %f)", loadavg[0], loadavg[1], loadavg[2]);
+				syslog(LOG_INFO, "BUG: Main loop is thrashing! (%f %f %f) Zero timeout from \"%s\"", loadavg[0], loadavg[1], loadavg[2], profiler.get_source_name(min_source));
 				break;
 
 			case 200:
-				syslog(LOG_WARNING, "BUG: Main loop is still thrashing! Slowing things down. (%f %f %f)", loadavg[0], loadavg[1], loadavg[2]);
+				syslog(LOG_WARNING, "BUG: Main loop is still thrashing! Slowing things down. (%f %f %f) Zero timeout from \"%s\"", loadavg[0], loadavg[1], loadavg[2], profiler.get_source_name(min_source));
 				break;
 
 			case 1000:
-				syslog(LOG_CRIT, "BUG: Main loop had over 1000 iterations in a row with a zero timeout! Terminating. (%f %f %f)", loadavg[0], loadavg[1], loadavg[2]);
+				syslog(LOG_CRIT, "BUG: Main loop had over 1000 iterations in a row with a zero timeout! Terminating. (%f %f %f) Zero timeout from \"%s\"", loadavg[0], loadavg[1], loadavg[2], profiler.get_source_name(min_source));
+				profiler.dump_to_syslog(LOG_CRIT);
 				gRet = ERRORCODE_UNKNOWN;
 				break;
 			}
@@ -635,6 +763,7 @@ public:
 #endif
 
 		// Block until we timeout or there is FD activity.
+		start = time_us();
 		fds_ready = select(
 			max_fd + 1,
 			&gReadableFDs,
@@ -642,6 +771,8 @@ public:
 			&gErrorableFDs,
 			&timeout
 		);
+		profiler.record_stage(MainLoopProfiler::kStageSelect, start);
+		profiler.record_select(cms_timeout, fds_ready, &gReadableFDs, &gWritableFDs, max_fd + 1);
 
 #if VERBOSE_DEBUG
 		syslog_dump_select_info(
@@ -682,6 +813,11 @@ public:
 		while (!gRet) {
 			block_until_ready();
 			process();
+
+			if (gProfileDumpRequested) {
+				gProfileDumpRequested = 0;
+				MainLoopProfiler::get_shared().dump_to_syslog(LOG_NOTICE);
+			}
 		}
 	}
 };
@@ -703,6 +839,7 @@ main(int argc, char * argv[])
 
 	//nl::wpantund::NCPInstance *ncp_instance = NULL;
 	std::map<std::string, std::string> cmd_line_settings;
+	std::map<std::string, std::map<std::string, std::string> > instance_sections;
 
 	// ========================================================================
 	// INITIALIZATION and ARGUMENT PARSING
@@ -710,6 +847,7 @@ main(int argc, char * argv[])
 	gPreviousHandlerForSIGINT = signal(SIGINT, &signal_SIGINT);
 	gPreviousHandlerForSIGTERM = signal(SIGTERM, &signal_SIGTERM);
 	signal(SIGHUP, &signal_SIGHUP);
+	signal(SIGUSR1, &signal_SIGUSR1);
 
 	// Always ignore SIGPIPE.
 	signal(SIGPIPE, SIG_IGN);
@@ -856,27 +994,26 @@ main(int argc, char * argv[])
 		// behavior, we insert into `cmd_line_settings`, not `settings`.
 		cmd_line_settings.insert(settings.begin(), settings.end());
 
-		// Perform depricated property translation
+		// Pull out the `[name]` sections, each of which describes
+		// an additional NCP instance.
 		{
 			std::map<std::string, std::string>::const_iterator iter;
 			settings.clear();
 
 			for (iter = cmd_line_settings.begin(); iter != cmd_line_settings.end(); iter++) {
-				std::string key(iter->first);
-				boost::any value(iter->second);
-				if (NCPControlInterface::translate_deprecated_property(key, value)) {
-					if (key.empty()) {
-						syslog(LOG_WARNING, "Configuration property \"%s\" is no longer supported. Please remove it from your configuration.", iter->first.c_str());
-					} else {
-						syslog(LOG_WARNING, "CONFIGURATION PROPERTY \"%s\" IS DEPRECATED. Please use \"%s\" instead.", iter->first.c_str(), key.c_str());
-					}
-				}
-				if (!key.empty()) {
-					settings[key] = any_to_string(value);
+				std::string::size_type end = iter->first.find(']');
+
+				if ((iter->first[0] == '[') && (end != std::string::npos)) {
+					instance_sections[iter->first.substr(1, end - 1)][iter->first.substr(end + 1)] = iter->second;
+				} else {
+					settings[iter->first] = iter->second;
 				}
 			}
 		}
 
+		// Perform depricated property translation
+		settings = translate_deprecated_settings(settings);
+
 		// Handle all of the options/settings.
 		if (!settings.empty()) {
 			std::map<std::string, std::string>::const_iterator iter;
@@ -893,7 +1030,64 @@ main(int argc, char * argv[])
 			settings = settings_for_ncp_control_interface;
 		}
 
-		main_loop = new MainLoop(settings);
+		if (instance_sections.empty()) {
+			main_loop = new MainLoop(settings);
+
+		} else {
+			std::map<std::string, std::map<std::string, std::string> >::const_iterator section_iter;
+			std::set<std::string> interface_names;
+			std::map<std::string, bool> socket_paths;
+
+			main_loop = new MainLoop();
+
+			for (section_iter = instance_sections.begin(); section_iter != instance_sections.end(); section_iter++) {
+				std::map<std::string, std::string> instance_settings = translate_deprecated_settings(section_iter->second);
+				std::map<std::string, std::string>::iterator iter;
+
+				for (iter = instance_settings.begin(); iter != instance_settings.end();) {
+					if (is_process_wide_config_param(iter->first.c_str())) {
+						syslog(LOG_WARNING, "[%s]: \"%s\" applies to the whole process and is ignored inside of a section", section_iter->first.c_str(), iter->first.c_str());
+						instance_settings.erase(iter++);
+					} else {
+						++iter;
+					}
+				}
+
+				// The section name doubles as the default interface name.
+				if (!instance_settings.count(kWPANTUNDProperty_ConfigTUNInterfaceName)) {
+					instance_settings[kWPANTUNDProperty_ConfigTUNInterfaceName] = section_iter->first;
+				}
+
+				// Everything outside of a section is a default for all of them.
+				instance_settings.insert(settings.begin(), settings.end());
+
+				if (!interface_names.insert(instance_settings[kWPANTUNDProperty_ConfigTUNInterfaceName]).second) {
+					syslog(LOG_ERR, "[%s]: Interface name \"%s\" is used more than once", section_iter->first.c_str(), instance_settings[kWPANTUNDProperty_ConfigTUNInterfaceName].c_str());
+					gRet = ERRORCODE_BADCONFIG;
+					goto bail;
+				}
+
+				// Sections may only share a socket path if every one of
+				// them talks to its own Spinel IID on it.
+				if (instance_settings.count(kWPANTUNDProperty_ConfigNCPSocketPath)) {
+					const std::string& socket_path = instance_settings[kWPANTUNDProperty_ConfigNCPSocketPath];
+					const bool is_multiplexed = (instance_settings.count(kWPANTUNDProperty_ConfigNCPIID) != 0);
+					std::map<std::string, bool>::const_iterator path_iter = socket_paths.find(socket_path);
+
+					if ((path_iter != socket_paths.end()) && !(path_iter->second && is_multiplexed)) {
+						syslog(LOG_ERR, "[%s]: Socket path \"%s\" is used more than once", section_iter->first.c_str(), socket_path.c_str());
+						gRet = ERRORCODE_BADCONFIG;
+						goto bail;
+					}
+
+					socket_paths[socket_path] = is_multiplexed;
+				}
+
+				syslog(LOG_NOTICE, "Starting NCP instance \"%s\"", section_iter->first.c_str());
+
+				main_loop->add_ncp_instance(instance_settings);
+			}
+		}
 
 #if !FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
 		// Set up DBUSIPCServer
@@ -902,6 +1096,15 @@ main(int argc, char * argv[])
 		} catch(std::exception x) {
 			syslog(LOG_ERR, "Unable to start DBUSIPCServer \"%s\"",x.what());
 		}
+
+		// Set up UnixIPCServer
+		if (gIPCSocketPath != NULL) {
+			try {
+				main_loop->add_ipc_server(shared_ptr<nl::wpantund::IPCServer>(new UnixIPCServer(gIPCSocketPath)));
+			} catch(std::runtime_error x) {
+				syslog(LOG_ERR, "Unable to start UnixIPCServer on \"%s\", \"%s\"", gIPCSocketPath, x.what());
+			}
+		}
 #endif
 
 		/*** Add other IPCServers here! ***/